@@ -26,6 +26,7 @@ class BenchmarkRunner(object):
     else:
       build_directory = os.path.join('out', 'Debug')
     self._paths = Paths(build_dir=build_directory)
+    self._results = []
 
   def _list_tests(self):
     for name in os.listdir(self._benchmark_dir):
@@ -39,16 +40,22 @@ class BenchmarkRunner(object):
     if os.path.isfile(run_script_path):
       run_module = '.'.join([test_name, 'run'])
       importlib.import_module(run_module)
-      result = sys.modules[run_module].run(self._args, self._paths)
-
-      #TODO(yzshen): (1) consider using more structured result;
-      #              (2) upload the result to server.
-      print result
+      # Each result is a line in the format that mopy.perf_data_uploader
+      # reads: "<chart>/<trace> <value> <units>".
+      results = sys.modules[run_module].run(self._args, self._paths)
+      for result in results:
+        print result
+      self._results += results
 
   def run(self):
     for test in self._list_tests():
       self._run_test(test)
 
+    if self._args.perf_data_path:
+      with open(self._args.perf_data_path, 'w') as perf_data_file:
+        for result in self._results:
+          perf_data_file.write(result + '\n')
+
 
 def main():
   parser = argparse.ArgumentParser(
@@ -60,6 +67,9 @@ def main():
                            default=True, action='store_true')
   debug_group.add_argument('--debug', help='test against debug build',
                            default=False, dest='release', action='store_false')
+  parser.add_argument('--perf-data-path',
+                      help='write the results to this file, in the format '
+                           'that mojo/tools/perf_test_runner.py uploads')
 
   args = parser.parse_args()
 
@@ -0,0 +1,47 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/c/system/main.h"
+#include "mojo/public/cpp/application/application_connection.h"
+#include "mojo/public/cpp/application/application_delegate.h"
+#include "mojo/public/cpp/application/application_impl.h"
+#include "mojo/public/cpp/application/application_runner.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace benchmarks {
+namespace {
+
+// A dependency of mojo_benchmark_startup_with_dependencies, which connects
+// back to the application that connected to it to tell it that it's started.
+class StartupDependency : public mojo::ApplicationDelegate {
+ public:
+  StartupDependency() : app_(nullptr), connected_back_(false) {}
+  ~StartupDependency() override {}
+
+ private:
+  // mojo::ApplicationDelegate:
+  void Initialize(mojo::ApplicationImpl* app) override { app_ = app; }
+
+  bool ConfigureIncomingConnection(
+      mojo::ApplicationConnection* connection) override {
+    if (!connected_back_) {
+      connected_back_ = true;
+      app_->ConnectToApplication(connection->GetRemoteApplicationURL());
+    }
+    return true;
+  }
+
+  mojo::ApplicationImpl* app_;
+  bool connected_back_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(StartupDependency);
+};
+
+}  // namespace
+}  // namespace benchmarks
+
+MojoResult MojoMain(MojoHandle application_request) {
+  mojo::ApplicationRunner runner(new benchmarks::StartupDependency);
+  return runner.Run(application_request);
+}
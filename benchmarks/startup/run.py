@@ -2,12 +2,54 @@
 # Use of this source code is governed by a BSD-style license that can be
 # found in the LICENSE file.
 
+import json
 import os
+import shutil
 import subprocess
+import sys
+import tempfile
+import time
 import timeit
 
+sys.path.append(os.path.abspath(os.path.join(
+    __file__, os.pardir, os.pardir, os.pardir, 'mojo', 'devtools', 'common')))
+from devtoolslib import http_server
 
-def run(args, paths):
+
+# The numbers of dependencies to start (see with_dependencies.cc for the
+# maximum).
+_DEPENDENCY_COUNTS = [0, 4, 8]
+
+# The number of times each traced configuration is run; the results are
+# averaged.
+_TRACED_ROUNDS = 5
+
+_APP_WITH_DEPENDENCIES = 'mojo:mojo_benchmark_startup_with_dependencies'
+
+# The sizes of the pool of idle child processes that out-of-process
+# configurations are run with (0 disables the pool).
+_CHILD_PROCESS_POOL_SIZES = [0, 4]
+
+# Maps each startup phase to the trace events (recorded by the shell) that
+# make it up. The time spent in each phase is summed over all the
+# applications that are started.
+_PHASES = [
+    ('url_resolution', ['ApplicationManager::ResolveMappings',
+                        'ApplicationManager::ResolveMojoURL']),
+    ('fetch', ['NetworkFetcher::NetworkRequest', 'LocalFetcher::LocalFetcher']),
+    ('disk_cache', ['NetworkFetcher::GetFileFromCache']),
+    ('load_library', ['LoadNativeApplication']),
+    ('child_process_spawn', ['ChildProcessHost::Launch']),
+    ('first_message', ['ShellImpl::WaitForFirstMessage']),
+]
+
+
+def _perf_line(chart, trace, value, units):
+  """Formats a result in the format that mopy.perf_data_uploader reads."""
+  return '%s/%s %f %s' % (chart, trace, value, units)
+
+
+def _measure_startup_time(paths):
   rounds = 1000
 
   # Because mojo_benchmark_startup terminates the process immediately when its
@@ -25,11 +67,152 @@ def run(args, paths):
            os.path.join(paths.build_dir, 'mojo_benchmark_startup_noop')),
       "import subprocess", number=rounds)
 
-  # TODO(yzshen): Consider also testing the startup time when
-  # mojo_benchmark_startup is served by an HTTP server.
-
   # Convert the execution time to milliseconds and compute the average for
   # a single run.
   result = (startup_time - noop_time) * 1000 / rounds
-  return ("Result: rounds tested: %d; average startup time: %f ms" %
-          (rounds, result))
+  return [_perf_line('startup', 'average_startup_time', result, 'ms')]
+
+
+def _get_phase_durations(events):
+  """Returns a dictionary mapping each phase in |_PHASES| to the total time
+  (in milliseconds) spent in it according to the trace |events|."""
+
+  # Durations (in microseconds) by event name.
+  durations = {}
+  # Begin timestamps of unfinished events, by (name, thread/async ID).
+  begin_times = {}
+  for event in events:
+    name = event.get('name')
+    phase = event.get('ph')
+    if phase == 'X':
+      durations[name] = durations.get(name, 0) + event.get('dur', 0)
+    elif phase in ('B', 'S'):
+      key = (name, event.get('tid') if phase == 'B' else event.get('id'))
+      begin_times[key] = event['ts']
+    elif phase in ('E', 'F'):
+      key = (name, event.get('tid') if phase == 'E' else event.get('id'))
+      if key in begin_times:
+        durations[name] = (durations.get(name, 0) + event['ts'] -
+                           begin_times.pop(key))
+
+  result = {}
+  for phase_name, event_names in _PHASES:
+    result[phase_name] = sum(durations.get(n, 0) for n in event_names) / 1000.0
+  return result
+
+
+# Trace events (with a boolean "hit" argument) recording the hits and misses of
+# the shell's startup optimizations, by the name of the reported hit rate.
+_HIT_EVENTS = [
+    ('child_process_pool_hit_rate', 'ChildProcessPool::TakeChildProcessHost'),
+    ('prefetch_hit_rate', 'ApplicationManager::UsePrefetchedApplication'),
+]
+
+
+def _get_hit_counts(events, event_name):
+  """Returns the numbers of hits and misses recorded by the trace events named
+  |event_name| in |events|."""
+  hits = 0
+  misses = 0
+  for event in events:
+    if event.get('name') == event_name:
+      if event.get('args', {}).get('hit'):
+        hits += 1
+      else:
+        misses += 1
+  return hits, misses
+
+
+def _run_traced(paths, origin, home_dir, dependencies, pool_size):
+  """Runs the shell once with tracing, starting |_APP_WITH_DEPENDENCIES| with
+  the given number of dependencies (out of process, with a child process pool
+  of |pool_size|, unless |pool_size| is None), and returns the total time taken
+  (in milliseconds), the durations of the phases and the hit counts (mapping
+  each hit rate name in |_HIT_EVENTS| to a (hits, misses) pair)."""
+  trace_dir = tempfile.mkdtemp()
+  try:
+    command = [paths.mojo_shell_path,
+               '--trace-startup',
+               '--enable-prefetch',
+               '--origin=%s' % origin,
+               '--args-for=%s --dependencies=%d' % (_APP_WITH_DEPENDENCIES,
+                                                    dependencies)]
+    if pool_size is not None:
+      command.append('--enable-multiprocess')
+      command.append('--child-process-pool-size=%d' % pool_size)
+    command.append(_APP_WITH_DEPENDENCIES)
+
+    env = dict(os.environ)
+    env['HOME'] = home_dir
+    start_time = time.time()
+    subprocess.check_call(command, cwd=trace_dir, env=env)
+    total_time = (time.time() - start_time) * 1000
+
+    with open(os.path.join(trace_dir, 'mojo_shell.trace')) as trace_file:
+      events = json.load(trace_file)['traceEvents']
+    hit_counts = dict((name, _get_hit_counts(events, event_name))
+                      for name, event_name in _HIT_EVENTS)
+    return total_time, _get_phase_durations(events), hit_counts
+  finally:
+    shutil.rmtree(trace_dir, True)
+
+
+def _measure_phases(paths, origin, dependencies, pool_size, cold):
+  """Measures starting an application with |dependencies| dependencies from
+  |origin|, in process (if |pool_size| is None) or out of process, with a cold
+  (empty) or warm disk cache, and returns the results (averaged over
+  |_TRACED_ROUNDS| runs)."""
+  if pool_size is None:
+    process_model = 'in_process'
+  else:
+    process_model = 'out_of_process_pool%d' % pool_size
+  chart = 'startup_%ddeps_%s_%s' % (dependencies, process_model,
+                                    'cold' if cold else 'warm')
+
+  # The disk cache lives under $HOME, so use a separate one that we control.
+  home_dir = tempfile.mkdtemp()
+  cache_dir = os.path.join(home_dir, '.mojo_url_response_disk_cache')
+  try:
+    if not cold:
+      # Populate the cache.
+      _run_traced(paths, origin, home_dir, dependencies, pool_size)
+
+    totals = {'total': 0.0}
+    total_hit_counts = {}
+    for _ in range(_TRACED_ROUNDS):
+      if cold:
+        shutil.rmtree(cache_dir, True)
+      total_time, phases, hit_counts = _run_traced(
+          paths, origin, home_dir, dependencies, pool_size)
+      totals['total'] += total_time
+      for phase_name, duration in phases.iteritems():
+        totals[phase_name] = totals.get(phase_name, 0.0) + duration
+      for name, (hits, misses) in hit_counts.iteritems():
+        total_hits, total_misses = total_hit_counts.get(name, (0, 0))
+        total_hit_counts[name] = (total_hits + hits, total_misses + misses)
+
+    results = [_perf_line(chart, name, value / _TRACED_ROUNDS, 'ms')
+               for name, value in sorted(totals.iteritems())]
+    # Only report the hit rates of the optimizations that were used.
+    for name, (hits, misses) in sorted(total_hit_counts.iteritems()):
+      if hits + misses > 0:
+        results.append(_perf_line(chart, name, 100.0 * hits / (hits + misses),
+                                  'percent'))
+    return results
+  finally:
+    shutil.rmtree(home_dir, True)
+
+
+def run(args, paths):
+  results = _measure_startup_time(paths)
+
+  # Serve the applications over HTTP, so that they go through the network
+  # service and the disk cache.
+  host, port = http_server.start_http_server(paths.build_dir)
+  origin = 'http://%s:%d/' % (host, port)
+  for dependencies in _DEPENDENCY_COUNTS:
+    for pool_size in [None] + _CHILD_PROCESS_POOL_SIZES:
+      for cold in (True, False):
+        results += _measure_phases(paths, origin, dependencies, pool_size,
+                                   cold)
+  return results
@@ -0,0 +1,83 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdlib.h>
+
+#include <set>
+#include <sstream>
+#include <string>
+
+#include "mojo/public/c/system/main.h"
+#include "mojo/public/cpp/application/application_connection.h"
+#include "mojo/public/cpp/application/application_delegate.h"
+#include "mojo/public/cpp/application/application_impl.h"
+#include "mojo/public/cpp/application/application_runner.h"
+#include "mojo/public/cpp/environment/logging.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace benchmarks {
+namespace {
+
+const char kDependenciesArg[] = "--dependencies=";
+
+// The number of dependency applications that are built (see BUILD.gn).
+const int kMaxDependencies = 8;
+
+// Connects to the number of dependencies given by --dependencies=<n> (which
+// are distinct applications, so that each has to be fetched and loaded), and
+// quits once each of them has connected back to it. The testing script
+// traces the shell to see how long each phase of starting the dependencies
+// took.
+class StartupWithDependencies : public mojo::ApplicationDelegate {
+ public:
+  StartupWithDependencies() : num_dependencies_(0) {}
+  ~StartupWithDependencies() override {}
+
+ private:
+  // mojo::ApplicationDelegate:
+  void Initialize(mojo::ApplicationImpl* app) override {
+    for (const auto& arg : app->args()) {
+      if (arg.compare(0, sizeof(kDependenciesArg) - 1, kDependenciesArg) == 0)
+        num_dependencies_ = atoi(arg.c_str() + sizeof(kDependenciesArg) - 1);
+    }
+    MOJO_CHECK(num_dependencies_ >= 0 &&
+               num_dependencies_ <= kMaxDependencies);
+
+    if (!num_dependencies_) {
+      mojo::ApplicationImpl::Terminate();
+      return;
+    }
+    for (int i = 0; i < num_dependencies_; i++) {
+      std::ostringstream url;
+      url << "mojo:mojo_benchmark_startup_dependency_" << i;
+      app->ConnectToApplication(url.str());
+    }
+  }
+
+  bool ConfigureIncomingConnection(
+      mojo::ApplicationConnection* connection) override {
+    // Ignore the connection from the shell that started us.
+    const std::string& remote_url = connection->GetRemoteApplicationURL();
+    if (remote_url.empty())
+      return true;
+
+    connected_dependencies_.insert(remote_url);
+    if (static_cast<int>(connected_dependencies_.size()) == num_dependencies_)
+      mojo::ApplicationImpl::Terminate();
+    return true;
+  }
+
+  int num_dependencies_;
+  std::set<std::string> connected_dependencies_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(StartupWithDependencies);
+};
+
+}  // namespace
+}  // namespace benchmarks
+
+MojoResult MojoMain(MojoHandle application_request) {
+  mojo::ApplicationRunner runner(new benchmarks::StartupWithDependencies);
+  return runner.Run(application_request);
+}
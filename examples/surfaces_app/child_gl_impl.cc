@@ -194,7 +194,8 @@ void ChildGLImpl::Draw() {
   scoped_ptr<CompositorFrame> frame(new CompositorFrame);
   frame->delegated_frame_data = delegated_frame_data.Pass();
 
-  surface_->SubmitFrame(local_id_, mojo::Frame::From(*frame), mojo::Closure());
+  surface_->SubmitFrameWithWriters(
+      local_id_, mojo::CompositorFrameWriter(*frame), mojo::Closure());
 
   base::MessageLoop::current()->PostDelayedTask(
       FROM_HERE,
@@ -72,7 +72,8 @@ void ChildImpl::ProduceFrame(ColorPtr color,
   frame->delegated_frame_data = delegated_frame_data.Pass();
 
   surface_->CreateSurface(kLocalId);
-  surface_->SubmitFrame(kLocalId, mojo::Frame::From(*frame), mojo::Closure());
+  surface_->SubmitFrameWithWriters(
+      kLocalId, mojo::CompositorFrameWriter(*frame), mojo::Closure());
   auto qualified_id = mojo::SurfaceId::New();
   qualified_id->id_namespace = id_namespace_;
   qualified_id->local = kLocalId;
@@ -93,8 +93,8 @@ void Embedder::ProduceFrame(cc::SurfaceId child_one,
   frame->delegated_frame_data = delegated_frame_data.Pass();
 
   frame_pending_ = true;
-  display_->SubmitFrame(mojo::Frame::From(*frame),
-                        [this]() { frame_pending_ = false; });
+  display_->SubmitFrameWithWriters(mojo::CompositorFrameWriter(*frame),
+                                   [this]() { frame_pending_ = false; });
 }
 
 }  // namespace examples
@@ -70,21 +70,25 @@ class WatcherBackend : public MessagePumpMojoHandler {
 
  private:
   typedef std::map<Handle, WatchData> HandleToWatchDataMap;
+  typedef std::map<WatcherID, Handle> WatcherIDToHandleMap;
 
   // Invoked when a handle needs to be removed and notified.
   void RemoveAndNotify(const Handle& handle, MojoResult result);
 
-  // Searches through |handle_to_data_| for |watcher_id|. Returns true if found
-  // and sets |handle| to the Handle. Returns false if not a known id.
+  // Looks up |watcher_id|. Returns true if found and sets |handle| to the
+  // Handle. Returns false if not a known id.
   bool GetMojoHandleByWatcherID(WatcherID watcher_id, Handle* handle) const;
 
   // MessagePumpMojoHandler overrides:
   void OnHandleReady(const Handle& handle) override;
   void OnHandleError(const Handle& handle, MojoResult result) override;
 
-  // Maps from assigned id to WatchData.
+  // Maps from handle to WatchData.
   HandleToWatchDataMap handle_to_data_;
 
+  // Maps from assigned id to handle (the inverse of |handle_to_data_|).
+  WatcherIDToHandleMap id_to_handle_;
+
   DISALLOW_COPY_AND_ASSIGN(WatcherBackend);
 };
 
@@ -100,6 +104,7 @@ void WatcherBackend::StartWatching(const WatchData& data) {
   DCHECK_EQ(0u, handle_to_data_.count(data.handle));
 
   handle_to_data_[data.handle] = data;
+  id_to_handle_[data.id] = data.handle;
   MessagePumpMojo::current()->AddHandler(this, data.handle,
                                          data.handle_signals,
                                          data.deadline);
@@ -111,6 +116,7 @@ void WatcherBackend::StopWatching(WatcherID watcher_id) {
   Handle handle;
   if (GetMojoHandleByWatcherID(watcher_id, &handle)) {
     handle_to_data_.erase(handle);
+    id_to_handle_.erase(watcher_id);
     MessagePumpMojo::current()->RemoveHandler(handle);
   }
 }
@@ -122,20 +128,18 @@ void WatcherBackend::RemoveAndNotify(const Handle& handle,
 
   const WatchData data(handle_to_data_[handle]);
   handle_to_data_.erase(handle);
+  id_to_handle_.erase(data.id);
   MessagePumpMojo::current()->RemoveHandler(handle);
   data.task_runner->PostTask(FROM_HERE, base::Bind(data.callback, result));
 }
 
 bool WatcherBackend::GetMojoHandleByWatcherID(WatcherID watcher_id,
                                               Handle* handle) const {
-  for (HandleToWatchDataMap::const_iterator i = handle_to_data_.begin();
-       i != handle_to_data_.end(); ++i) {
-    if (i->second.id == watcher_id) {
-      *handle = i->second.handle;
-      return true;
-    }
-  }
-  return false;
+  WatcherIDToHandleMap::const_iterator it = id_to_handle_.find(watcher_id);
+  if (it == id_to_handle_.end())
+    return false;
+  *handle = it->second;
+  return true;
 }
 
 void WatcherBackend::OnHandleReady(const Handle& handle) {
@@ -22,6 +22,10 @@ namespace {
 base::LazyInstance<base::ThreadLocalPointer<MessagePumpMojo> >::Leaky
     g_tls_current_pump = LAZY_INSTANCE_INITIALIZER;
 
+// The cookie for the control pipe in the wait set. Handlers use their handle
+// values (which are 32-bit) as cookies, so this can't collide with them.
+const uint64_t kControlPipeCookie = static_cast<uint64_t>(1) << 32;
+
 MojoDeadline TimeTicksToMojoDeadline(base::TimeTicks time_ticks,
                                      base::TimeTicks now) {
   // The is_null() check matches that of HandleWatcher as well as how
@@ -35,13 +39,6 @@ MojoDeadline TimeTicksToMojoDeadline(base::TimeTicks time_ticks,
 
 }  // namespace
 
-// State needed for one iteration of WaitMany. The first handle and flags
-// corresponds to that of the control pipe.
-struct MessagePumpMojo::WaitState {
-  std::vector<Handle> handles;
-  std::vector<MojoHandleSignals> wait_signals;
-};
-
 struct MessagePumpMojo::RunState {
   RunState() : should_quit(false) {
     CreateMessagePipe(NULL, &read_handle, &write_handle);
@@ -53,16 +50,37 @@ struct MessagePumpMojo::RunState {
   ScopedMessagePipeHandle read_handle;
   ScopedMessagePipeHandle write_handle;
 
-  // Cached structures to avoid the heap allocation cost of std::vector<>.
-  scoped_ptr<WaitState> wait_state;
-  scoped_ptr<HandleToHandlerList> cloned_handlers;
+  // Cached buffer for the results of waiting on the wait set (to avoid the heap
+  // allocation cost of std::vector<>). This is per-|RunState|, since handlers
+  // may run nested loops.
+  std::vector<MojoWaitSetResult> wait_set_results;
+
+  // Cached buffers for the arguments of |MojoWaitMany()|, when there is no
+  // wait set.
+  std::vector<Handle> wait_many_handles;
+  std::vector<MojoHandleSignals> wait_many_signals;
 
   bool should_quit;
 };
 
-MessagePumpMojo::MessagePumpMojo() : run_state_(NULL), next_handler_id_(0) {
+// static
+const uint32_t MessagePumpMojo::kDefaultMaxHandlersPerWakeup;
+
+MessagePumpMojo::MessagePumpMojo() : MessagePumpMojo(true) {}
+
+MessagePumpMojo::MessagePumpMojo(bool use_wait_set)
+    : run_state_(NULL),
+      max_handlers_per_wakeup_(kDefaultMaxHandlersPerWakeup),
+      num_wakeups_(0),
+      next_handler_id_(0) {
   DCHECK(!current())
       << "There is already a MessagePumpMojo instance on this thread.";
+  if (use_wait_set) {
+    const MojoResult result = CreateWaitSet(nullptr, &wait_set_);
+    LOG_IF(WARNING, result != MOJO_RESULT_OK)
+        << "Wait sets unavailable (result " << result
+        << "); falling back to MojoWaitMany()";
+  }
   g_tls_current_pump.Pointer()->Set(this);
 }
 
@@ -76,6 +94,12 @@ scoped_ptr<base::MessagePump> MessagePumpMojo::Create() {
   return scoped_ptr<MessagePump>(new MessagePumpMojo());
 }
 
+// static
+scoped_ptr<base::MessagePump>
+MessagePumpMojo::CreateWithoutWaitSetForTesting() {
+  return scoped_ptr<MessagePump>(new MessagePumpMojo(false));
+}
+
 // static
 MessagePumpMojo* MessagePumpMojo::current() {
   return g_tls_current_pump.Pointer()->Get();
@@ -95,10 +119,23 @@ void MessagePumpMojo::AddHandler(MessagePumpMojoHandler* handler,
   handler_data.deadline = deadline;
   handler_data.id = next_handler_id_++;
   handlers_[handle] = handler_data;
+  if (!deadline.is_null())
+    deadlines_.insert(std::make_pair(deadline, handle));
+  if (wait_set_.is_valid()) {
+    CHECK_EQ(MOJO_RESULT_OK,
+             WaitSetAdd(wait_set_.get(), handle, wait_signals, handle.value()));
+  }
 }
 
 void MessagePumpMojo::RemoveHandler(const Handle& handle) {
-  handlers_.erase(handle);
+  if (handlers_.count(handle))
+    EraseHandler(handle);
+}
+
+void MessagePumpMojo::SetMaxHandlersPerWakeup(
+    uint32_t max_handlers_per_wakeup) {
+  CHECK_GT(max_handlers_per_wakeup, 0u);
+  max_handlers_per_wakeup_ = max_handlers_per_wakeup;
 }
 
 void MessagePumpMojo::AddObserver(Observer* observer) {
@@ -120,7 +157,14 @@ void MessagePumpMojo::Run(Delegate* delegate) {
     old_state = run_state_;
     run_state_ = &run_state;
   }
+  // Only the innermost run's control pipe is waited on.
+  if (old_state)
+    RemoveControlPipe();
+  AddControlPipe(run_state);
   DoRunLoop(&run_state, delegate);
+  RemoveControlPipe();
+  if (old_state)
+    AddControlPipe(*old_state);
   {
     base::AutoLock auto_lock(run_state_lock_);
     run_state_ = old_state;
@@ -151,7 +195,7 @@ void MessagePumpMojo::DoRunLoop(RunState* run_state, Delegate* delegate) {
   bool more_work_is_plausible = true;
   for (;;) {
     const bool block = !more_work_is_plausible;
-    more_work_is_plausible = DoInternalWork(*run_state, block);
+    more_work_is_plausible = DoInternalWork(run_state, block);
 
     if (run_state->should_quit)
       break;
@@ -174,39 +218,31 @@ void MessagePumpMojo::DoRunLoop(RunState* run_state, Delegate* delegate) {
   }
 }
 
-bool MessagePumpMojo::DoInternalWork(const RunState& run_state, bool block) {
-  const MojoDeadline deadline = block ? GetDeadlineForWait(run_state) : 0;
-  if (!run_state_->wait_state)
-    run_state_->wait_state.reset(new WaitState);
-  GetWaitState(run_state, run_state_->wait_state.get());
-
-  const WaitManyResult wait_many_result =
-      WaitMany(run_state_->wait_state->handles,
-               run_state_->wait_state->wait_signals, deadline, nullptr);
-  const MojoResult result = wait_many_result.result;
+bool MessagePumpMojo::DoInternalWork(RunState* run_state, bool block) {
+  const MojoDeadline deadline = block ? GetDeadlineForWait(*run_state) : 0;
+  // Note: The buffer is only resized here (and not in
+  // |SetMaxHandlersPerWakeup()|), since a handler may change the maximum while
+  // we're iterating over it.
+  run_state->wait_set_results.resize(max_handlers_per_wakeup_);
+  uint32_t num_results = max_handlers_per_wakeup_;
+  const MojoResult result =
+      wait_set_.is_valid()
+          ? WaitSetWait(wait_set_.get(), deadline, &num_results,
+                        &run_state->wait_set_results[0])
+          : WaitWithoutWaitSet(run_state, deadline, &num_results);
   bool did_work = true;
   if (result == MOJO_RESULT_OK) {
-    if (wait_many_result.index == 0) {
-      // Control pipe was written to.
-      ReadMessageRaw(run_state.read_handle.get(), NULL, NULL, NULL, NULL,
-                     MOJO_READ_MESSAGE_FLAG_MAY_DISCARD);
-    } else {
-      DCHECK(handlers_.find(
-                 run_state_->wait_state->handles[wait_many_result.index]) !=
-             handlers_.end());
-      WillSignalHandler();
-      handlers_[run_state_->wait_state->handles[wait_many_result.index]]
-          .handler->OnHandleReady(
-              run_state_->wait_state->handles[wait_many_result.index]);
-      DidSignalHandler();
+    DCHECK_GT(num_results, 0u);
+    num_wakeups_++;
+    const int max_id = next_handler_id_;
+    for (uint32_t i = 0; i < num_results; i++) {
+      DispatchWaitSetResult(*run_state, run_state->wait_set_results[i],
+                            max_id);
+      if (run_state->should_quit)
+        break;
     }
   } else {
     switch (result) {
-      case MOJO_RESULT_CANCELLED:
-      case MOJO_RESULT_FAILED_PRECONDITION:
-        RemoveInvalidHandle(*run_state_->wait_state, result,
-                            wait_many_result.index);
-        break;
       case MOJO_RESULT_DEADLINE_EXCEEDED:
         did_work = false;
         break;
@@ -216,69 +252,140 @@ bool MessagePumpMojo::DoInternalWork(const RunState& run_state, bool block) {
         CHECK(false);
     }
   }
-  // To keep memory usage under control, delete the WaitState object at the end
-  // if it's vectors are too big by a factor of 2. Pre-C++11 doesn't have a way
-  // to shrink vectors, so just get rid of them and re-create on the next round.
-  if (run_state_->wait_state->handles.capacity() >
-      2 * run_state_->wait_state->handles.size()) {
-    // NOTE: |handles| and |wait_signals| are always in sync, so it's reasonable
-    // to only check one of those.
-    run_state_->wait_state.reset();
-  }
 
-  // Notify and remove any handlers whose time has expired. Make a copy in case
-  // someone tries to add/remove new handlers from notification.
-  if (!run_state_->cloned_handlers) {
-    run_state_->cloned_handlers.reset(new HandleToHandlerList);
-  } else {
-    run_state_->cloned_handlers->clear();
-  }
-  run_state_->cloned_handlers->reserve(handlers_.size());
-  for (const auto& handler : handlers_) {
-    run_state_->cloned_handlers->push_back(handler);
-  }
+  // Notify and remove any handlers whose time has expired. Copy the expired
+  // entries first in case someone tries to add/remove new handlers from
+  // notification.
   const base::TimeTicks now(internal::NowTicks());
-  for (HandleToHandlerList::const_iterator i =
-           run_state_->cloned_handlers->begin();
-       i != run_state_->cloned_handlers->end(); ++i) {
-    // Since we're iterating over a clone of the handlers, verify the handler is
-    // still valid before notifying.
-    if (!i->second.deadline.is_null() && i->second.deadline < now &&
-        handlers_.find(i->first) != handlers_.end() &&
-        handlers_[i->first].id == i->second.id) {
+  std::vector<std::pair<Handle, Handler>> expired_handlers;
+  for (DeadlineSet::const_iterator i = deadlines_.begin();
+       i != deadlines_.end() && i->first < now; ++i) {
+    expired_handlers.push_back(*handlers_.find(i->second));
+  }
+  for (const auto& expired : expired_handlers) {
+    // Since we're iterating over a copy, verify the handler is still valid
+    // before notifying.
+    HandleToHandler::const_iterator it = handlers_.find(expired.first);
+    if (it != handlers_.end() && it->second.id == expired.second.id) {
       WillSignalHandler();
-      i->second.handler->OnHandleError(i->first, MOJO_RESULT_DEADLINE_EXCEEDED);
+      expired.second.handler->OnHandleError(expired.first,
+                                            MOJO_RESULT_DEADLINE_EXCEEDED);
       DidSignalHandler();
-      handlers_.erase(i->first);
+      RemoveHandler(expired.first);
       did_work = true;
     }
   }
-  if (run_state_->cloned_handlers->capacity() >
-      2 * run_state_->cloned_handlers->size()) {
-    run_state_->cloned_handlers.reset();
-  }
   return did_work;
 }
 
-void MessagePumpMojo::RemoveInvalidHandle(const WaitState& wait_state,
-                                          MojoResult result,
-                                          uint32_t index) {
-  // TODO(sky): deal with control pipe going bad.
+MojoResult MessagePumpMojo::WaitWithoutWaitSet(RunState* run_state,
+                                               MojoDeadline deadline,
+                                               uint32_t* num_results) {
+  std::vector<Handle>& handles = run_state->wait_many_handles;
+  std::vector<MojoHandleSignals>& signals = run_state->wait_many_signals;
+  handles.clear();
+  signals.clear();
+  handles.push_back(run_state->read_handle.get());
+  signals.push_back(MOJO_HANDLE_SIGNAL_READABLE);
+  for (const auto& handler : handlers_) {
+    handles.push_back(handler.first);
+    signals.push_back(handler.second.wait_signals);
+  }
+
+  WaitManyResult wait_many_result =
+      WaitMany(handles, signals, deadline, nullptr);
+  // A handle closed (not through |RemoveHandler()|) before the wait is
+  // reported like the wait set does for one closed during it.
+  if (wait_many_result.result == MOJO_RESULT_INVALID_ARGUMENT &&
+      wait_many_result.IsIndexValid() && wait_many_result.index > 0)
+    wait_many_result.result = MOJO_RESULT_CANCELLED;
+  switch (wait_many_result.result) {
+    case MOJO_RESULT_OK:
+    case MOJO_RESULT_CANCELLED:
+    case MOJO_RESULT_FAILED_PRECONDITION: {
+      CHECK(wait_many_result.IsIndexValid());
+      MojoWaitSetResult& wait_set_result = run_state->wait_set_results[0];
+      wait_set_result.cookie =
+          wait_many_result.index == 0
+              ? kControlPipeCookie
+              : handles[wait_many_result.index].value();
+      wait_set_result.wait_result = wait_many_result.result;
+      *num_results = 1u;
+      return MOJO_RESULT_OK;
+    }
+    default:
+      return wait_many_result.result;
+  }
+}
+
+void MessagePumpMojo::DispatchWaitSetResult(
+    const RunState& run_state,
+    const MojoWaitSetResult& wait_set_result,
+    int max_id) {
+  if (wait_set_result.cookie == kControlPipeCookie) {
+    // TODO(sky): deal with control pipe going bad.
+    CHECK_EQ(MOJO_RESULT_OK, wait_set_result.wait_result);
+    // Control pipe was written to.
+    ReadMessageRaw(run_state.read_handle.get(), NULL, NULL, NULL, NULL,
+                   MOJO_READ_MESSAGE_FLAG_MAY_DISCARD);
+    return;
+  }
+
+  const Handle handle(static_cast<MojoHandle>(wait_set_result.cookie));
+  // An earlier handler in the same wakeup may have removed (and possibly
+  // re-added) this handler.
+  HandleToHandler::const_iterator it = handlers_.find(handle);
+  if (it == handlers_.end() || it->second.id >= max_id)
+    return;
+
+  if (wait_set_result.wait_result == MOJO_RESULT_OK) {
+    WillSignalHandler();
+    it->second.handler->OnHandleReady(handle);
+    DidSignalHandler();
+  } else {
+    RemoveInvalidHandle(handle, wait_set_result.wait_result);
+  }
+}
+
+void MessagePumpMojo::RemoveInvalidHandle(const Handle& handle,
+                                          MojoResult result) {
   CHECK(result == MOJO_RESULT_FAILED_PRECONDITION ||
         result == MOJO_RESULT_CANCELLED);
-  CHECK_NE(index, 0u);  // Indicates the control pipe went bad.
 
   // Remove the handle first, this way if OnHandleError() tries to remove the
   // handle our iterator isn't invalidated.
-  CHECK(handlers_.find(wait_state.handles[index]) != handlers_.end());
-  MessagePumpMojoHandler* handler =
-      handlers_[wait_state.handles[index]].handler;
-  handlers_.erase(wait_state.handles[index]);
+  CHECK(handlers_.find(handle) != handlers_.end());
+  MessagePumpMojoHandler* handler = handlers_[handle].handler;
+  EraseHandler(handle);
   WillSignalHandler();
-  handler->OnHandleError(wait_state.handles[index], result);
+  handler->OnHandleError(handle, result);
   DidSignalHandler();
 }
 
+void MessagePumpMojo::EraseHandler(const Handle& handle) {
+  HandleToHandler::iterator it = handlers_.find(handle);
+  DCHECK(it != handlers_.end());
+  if (!it->second.deadline.is_null())
+    deadlines_.erase(std::make_pair(it->second.deadline, handle));
+  handlers_.erase(it);
+  if (wait_set_.is_valid())
+    CHECK_EQ(MOJO_RESULT_OK, WaitSetRemove(wait_set_.get(), handle.value()));
+}
+
+void MessagePumpMojo::AddControlPipe(const RunState& run_state) {
+  if (!wait_set_.is_valid())
+    return;
+  CHECK_EQ(MOJO_RESULT_OK,
+           WaitSetAdd(wait_set_.get(), run_state.read_handle.get(),
+                      MOJO_HANDLE_SIGNAL_READABLE, kControlPipeCookie));
+}
+
+void MessagePumpMojo::RemoveControlPipe() {
+  if (!wait_set_.is_valid())
+    return;
+  CHECK_EQ(MOJO_RESULT_OK, WaitSetRemove(wait_set_.get(), kControlPipeCookie));
+}
+
 void MessagePumpMojo::SignalControlPipe(const RunState& run_state) {
   const MojoResult result =
       WriteMessageRaw(run_state.write_handle.get(), NULL, 0, NULL, 0,
@@ -288,33 +395,14 @@ void MessagePumpMojo::SignalControlPipe(const RunState& run_state) {
   CHECK_EQ(MOJO_RESULT_OK, result);
 }
 
-void MessagePumpMojo::GetWaitState(
-    const RunState& run_state,
-    MessagePumpMojo::WaitState* wait_state) const {
-  const size_t num_handles = handlers_.size() + 1;
-  wait_state->handles.clear();
-  wait_state->handles.reserve(num_handles);
-  wait_state->wait_signals.clear();
-  wait_state->wait_signals.reserve(num_handles);
-  wait_state->handles.push_back(run_state.read_handle.get());
-  wait_state->wait_signals.push_back(MOJO_HANDLE_SIGNAL_READABLE);
-
-  for (HandleToHandler::const_iterator i = handlers_.begin();
-       i != handlers_.end(); ++i) {
-    wait_state->handles.push_back(i->first);
-    wait_state->wait_signals.push_back(i->second.wait_signals);
-  }
-}
-
 MojoDeadline MessagePumpMojo::GetDeadlineForWait(
     const RunState& run_state) const {
   const base::TimeTicks now(internal::NowTicks());
   MojoDeadline deadline = TimeTicksToMojoDeadline(run_state.delayed_work_time,
                                                   now);
-  for (HandleToHandler::const_iterator i = handlers_.begin();
-       i != handlers_.end(); ++i) {
+  if (!deadlines_.empty()) {
     deadline = std::min(
-        TimeTicksToMojoDeadline(i->second.deadline, now), deadline);
+        TimeTicksToMojoDeadline(deadlines_.begin()->first, now), deadline);
   }
   return deadline;
 }
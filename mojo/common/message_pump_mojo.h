@@ -6,8 +6,8 @@
 #define MOJO_COMMON_MESSAGE_PUMP_MOJO_H_
 
 #include <map>
+#include <set>
 #include <utility>
-#include <vector>
 
 #include "base/macros.h"
 #include "base/memory/scoped_ptr.h"
@@ -22,7 +22,14 @@ namespace common {
 
 class MessagePumpMojoHandler;
 
-// Mojo implementation of MessagePump.
+// Mojo implementation of MessagePump. Handles registered with |AddHandler()|
+// are kept in a wait set (see "mojo/public/c/system/wait_set.h"), so the cost
+// of waiting doesn't grow with the number of registered handles. Each wakeup
+// dispatches up to |max_handlers_per_wakeup()| ready handles; since the wait
+// set reports ready handles round-robin, handles that don't fit in one wakeup
+// are dispatched first on the next. If the system doesn't provide wait sets
+// (e.g., an app running against an older shell), this falls back to waiting
+// on all the handles with |MojoWaitMany()|, dispatching one handle per wakeup.
 class MessagePumpMojo : public base::MessagePump {
  public:
   class Observer {
@@ -36,6 +43,9 @@ class MessagePumpMojo : public base::MessagePump {
     virtual ~Observer() {}
   };
 
+  // The default value of |max_handlers_per_wakeup()|.
+  static const uint32_t kDefaultMaxHandlersPerWakeup = 64;
+
   MessagePumpMojo();
   ~MessagePumpMojo() override;
 
@@ -43,6 +53,9 @@ class MessagePumpMojo : public base::MessagePump {
   // using |base::Bind()|).
   static scoped_ptr<base::MessagePump> Create();
 
+  // Like |Create()|, but always uses the |MojoWaitMany()| fallback.
+  static scoped_ptr<base::MessagePump> CreateWithoutWaitSetForTesting();
+
   // Returns the MessagePumpMojo instance of the current thread, if it exists.
   static MessagePumpMojo* current();
 
@@ -61,6 +74,18 @@ class MessagePumpMojo : public base::MessagePump {
   void AddObserver(Observer* observer);
   void RemoveObserver(Observer* observer);
 
+  // The maximum number of ready handles that are dispatched per wakeup (before
+  // going back to the |base::MessagePump::Delegate|'s work). Setting this to 1
+  // dispatches only a single handle per wakeup. Note that with a value greater
+  // than 1, a handler may be notified that its handle is ready even though an
+  // earlier handler in the same wakeup has since made it not ready.
+  uint32_t max_handlers_per_wakeup() const { return max_handlers_per_wakeup_; }
+  void SetMaxHandlersPerWakeup(uint32_t max_handlers_per_wakeup);
+
+  // The number of waits that found at least one handle (including the
+  // internal control pipe) ready. Mainly useful for tests.
+  uint64_t num_wakeups() const { return num_wakeups_; }
+
   // MessagePump:
   void Run(Delegate* delegate) override;
   void Quit() override;
@@ -69,7 +94,6 @@ class MessagePumpMojo : public base::MessagePump {
 
  private:
   struct RunState;
-  struct WaitState;
 
   // Contains the data needed to track a request to AddHandler().
   struct Handler {
@@ -83,7 +107,10 @@ class MessagePumpMojo : public base::MessagePump {
   };
 
   typedef std::map<Handle, Handler> HandleToHandler;
-  typedef std::vector<std::pair<Handle, Handler>> HandleToHandlerList;
+  // Handlers with deadlines, ordered by deadline.
+  typedef std::set<std::pair<base::TimeTicks, Handle>> DeadlineSet;
+
+  explicit MessagePumpMojo(bool use_wait_set);
 
   // Implementation of Run().
   void DoRunLoop(RunState* run_state, Delegate* delegate);
@@ -91,19 +118,37 @@ class MessagePumpMojo : public base::MessagePump {
   // Services the set of handles ready. If |block| is true this waits for a
   // handle to become ready, otherwise this does not block. Returns |true| if a
   // handle has become ready, |false| otherwise.
-  bool DoInternalWork(const RunState& run_state, bool block);
-
-  // Removes the given invalid handle. This is called if MojoWaitMany finds an
-  // invalid handle.
-  void RemoveInvalidHandle(const WaitState& wait_state,
-                           MojoResult result,
-                           uint32_t result_index);
+  bool DoInternalWork(RunState* run_state, bool block);
+
+  // Waits on the control pipe of |run_state| and the handles in |handlers_|
+  // with |MojoWaitMany()|, for when there is no |wait_set_|. Returns the same
+  // as |MojoWaitSetWait()| would, with at most one result (which is stored in
+  // |run_state->wait_set_results[0]|).
+  MojoResult WaitWithoutWaitSet(RunState* run_state,
+                                MojoDeadline deadline,
+                                uint32_t* num_results);
+
+  // Dispatches a single result from the wait set. |max_id| is the value of
+  // |next_handler_id_| at the time of the wait; handlers added after the wait
+  // aren't notified.
+  void DispatchWaitSetResult(const RunState& run_state,
+                             const MojoWaitSetResult& wait_set_result,
+                             int max_id);
+
+  // Removes the given invalid handle. This is called if the wait set reports
+  // that |handle| was closed or can never satisfy its signals.
+  void RemoveInvalidHandle(const Handle& handle, MojoResult result);
+
+  // Removes |handle| from |handlers_|, |deadlines_| and |wait_set_| (if any).
+  void EraseHandler(const Handle& handle);
+
+  // Adds/removes the control pipe of |run_state| to/from |wait_set_|.
+  void AddControlPipe(const RunState& run_state);
+  void RemoveControlPipe();
 
   void SignalControlPipe(const RunState& run_state);
 
-  void GetWaitState(const RunState& run_state, WaitState* wait_state) const;
-
-  // Returns the deadline for the call to MojoWaitMany().
+  // Returns the deadline for the call to MojoWaitSetWait().
   MojoDeadline GetDeadlineForWait(const RunState& run_state) const;
 
   void WillSignalHandler();
@@ -120,11 +165,22 @@ class MessagePumpMojo : public base::MessagePump {
 
   HandleToHandler handlers_;
 
+  // The handles in |handlers_| (with cookies equal to their values) and the
+  // control pipe of the innermost |RunState|. Invalid if the system doesn't
+  // provide wait sets.
+  ScopedWaitSetHandle wait_set_;
+
+  // Entries for the handlers in |handlers_| that have a non-null deadline.
+  DeadlineSet deadlines_;
+
+  uint32_t max_handlers_per_wakeup_;
+  uint64_t num_wakeups_;
+
   // An ever increasing value assigned to each Handler::id. Used to detect
   // uniqueness while notifying. That is, while notifying expired timers we copy
-  // |handlers_| and only notify handlers whose id match. If the id does not
-  // match it means the handler was removed then added so that we shouldn't
-  // notify it.
+  // the expired entries of |deadlines_| and only notify handlers whose id
+  // match. If the id does not match it means the handler was removed then added
+  // so that we shouldn't notify it.
   int next_handler_id_;
 
   base::ObserverList<Observer> observers_;
@@ -0,0 +1,120 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/macros.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/timer/elapsed_timer.h"
+#include "mojo/common/message_pump_mojo.h"
+#include "mojo/common/message_pump_mojo_handler.h"
+#include "mojo/public/cpp/system/core.h"
+#include "mojo/public/cpp/test_support/test_support.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace common {
+namespace test {
+namespace {
+
+// Reads one message each time its handle is ready.
+class ReadingHandler : public MessagePumpMojoHandler {
+ public:
+  ReadingHandler() : read_count_(0) {}
+  ~ReadingHandler() override {}
+
+  void OnHandleReady(const Handle& handle) override {
+    char buffer[64];
+    uint32_t num_bytes = static_cast<uint32_t>(sizeof(buffer));
+    CHECK_EQ(MOJO_RESULT_OK,
+             ReadMessageRaw(MessagePipeHandle(handle.value()), buffer,
+                            &num_bytes, nullptr, nullptr,
+                            MOJO_READ_MESSAGE_FLAG_NONE));
+    read_count_++;
+  }
+
+  void OnHandleError(const Handle& handle, MojoResult result) override {
+    CHECK(false);
+  }
+
+  uint64_t read_count() const { return read_count_; }
+
+ private:
+  uint64_t read_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadingHandler);
+};
+
+// Measures a fan-in burst: one message is written to each of |num_pipes| pipes
+// (all watched by the same |MessagePumpMojo|) and the pump is then run until
+// all of them have been read, |num_rounds| times.
+void MeasureFanIn(size_t num_pipes,
+                  size_t num_rounds,
+                  uint32_t max_handlers_per_wakeup) {
+  base::MessageLoop message_loop(MessagePumpMojo::Create());
+  MessagePumpMojo* pump = MessagePumpMojo::current();
+  pump->SetMaxHandlersPerWakeup(max_handlers_per_wakeup);
+
+  ScopedVector<MessagePipe> pipes;
+  ReadingHandler handler;
+  for (size_t i = 0; i < num_pipes; i++) {
+    pipes.push_back(new MessagePipe());
+    pump->AddHandler(&handler, pipes.back()->handle0.get(),
+                     MOJO_HANDLE_SIGNAL_READABLE, base::TimeTicks());
+  }
+
+  static const char kMessage[] = "hello";
+  const uint64_t num_wakeups_before = pump->num_wakeups();
+  base::ElapsedTimer timer;
+  for (size_t round = 0; round < num_rounds; round++) {
+    for (size_t i = 0; i < num_pipes; i++) {
+      CHECK_EQ(MOJO_RESULT_OK,
+               WriteMessageRaw(pipes[i]->handle1.get(), kMessage,
+                               static_cast<uint32_t>(sizeof(kMessage)),
+                               nullptr, 0, MOJO_WRITE_MESSAGE_FLAG_NONE));
+    }
+    base::RunLoop().RunUntilIdle();
+  }
+  const double elapsed_us =
+      static_cast<double>(timer.Elapsed().InMicroseconds());
+  const uint64_t num_wakeups = pump->num_wakeups() - num_wakeups_before;
+
+  const uint64_t num_messages = num_pipes * num_rounds;
+  CHECK_EQ(num_messages, handler.read_count());
+
+  std::string test_name =
+      base::StringPrintf("MessagePumpMojo_FanIn_%upipes_%umax",
+                         static_cast<unsigned>(num_pipes),
+                         static_cast<unsigned>(max_handlers_per_wakeup));
+  mojo::test::LogPerfResult(test_name.c_str(), "WakeupsPerMessage",
+                            static_cast<double>(num_wakeups) / num_messages,
+                            "wakeups/message");
+  mojo::test::LogPerfResult(test_name.c_str(), "TimePerMessage",
+                            elapsed_us / num_messages, "us/message");
+
+  for (size_t i = 0; i < num_pipes; i++)
+    pump->RemoveHandler(pipes[i]->handle0.get());
+}
+
+TEST(MessagePumpMojoPerfTest, FanIn) {
+  const size_t kNumPipes[] = {10, 200};
+  const uint32_t kMaxHandlersPerWakeup[] = {
+      1, 16, MessagePumpMojo::kDefaultMaxHandlersPerWakeup, 256};
+  const size_t kNumMessages = 200000;
+
+  for (size_t num_pipes : kNumPipes) {
+    for (uint32_t max_handlers_per_wakeup : kMaxHandlersPerWakeup)
+      MeasureFanIn(num_pipes, kNumMessages / num_pipes, max_handlers_per_wakeup);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace common
+}  // namespace mojo
@@ -19,6 +19,8 @@ scoped_ptr<base::MessagePump> CreateMojoMessagePump() {
 }
 
 RUN_MESSAGE_LOOP_TESTS(Mojo, &CreateMojoMessagePump);
+RUN_MESSAGE_LOOP_TESTS(MojoWithoutWaitSet,
+                       &MessagePumpMojo::CreateWithoutWaitSetForTesting);
 
 class CountingMojoHandler : public MessagePumpMojoHandler {
  public:
@@ -119,6 +121,135 @@ TEST(MessagePumpMojo, UnregisterAfterDeadline) {
   EXPECT_EQ(1, handler.error_count());
 }
 
+// Removes the handler for another handle when its own handle is ready.
+class RemovingMojoHandler : public CountingMojoHandler {
+ public:
+  explicit RemovingMojoHandler(const Handle& handle_to_remove)
+      : handle_to_remove_(handle_to_remove) {}
+
+  void OnHandleReady(const Handle& handle) override {
+    CountingMojoHandler::OnHandleReady(handle);
+    MessagePumpMojo::current()->RemoveHandler(handle_to_remove_);
+  }
+
+ private:
+  Handle handle_to_remove_;
+
+  DISALLOW_COPY_AND_ASSIGN(RemovingMojoHandler);
+};
+
+TEST(MessagePumpMojo, BatchDispatch) {
+  const size_t kNumPipes = 10;
+  for (uint32_t max_handlers : {1u, 4u, 64u}) {
+    base::MessageLoop message_loop(MessagePumpMojo::Create());
+    MessagePumpMojo* pump = MessagePumpMojo::current();
+    pump->SetMaxHandlersPerWakeup(max_handlers);
+    EXPECT_EQ(max_handlers, pump->max_handlers_per_wakeup());
+
+    CountingMojoHandler handlers[kNumPipes];
+    MessagePipe pipes[kNumPipes];
+    for (size_t i = 0; i < kNumPipes; i++) {
+      pump->AddHandler(&handlers[i], pipes[i].handle0.get(),
+                       MOJO_HANDLE_SIGNAL_READABLE, base::TimeTicks());
+      WriteMessageRaw(pipes[i].handle1.get(), NULL, 0, NULL, 0,
+                      MOJO_WRITE_MESSAGE_FLAG_NONE);
+    }
+
+    const uint64_t num_wakeups_before = pump->num_wakeups();
+    base::RunLoop run_loop;
+    run_loop.RunUntilIdle();
+    for (size_t i = 0; i < kNumPipes; i++)
+      EXPECT_EQ(1, handlers[i].success_count());
+    // Every wakeup dispatches up to |max_handlers| handles (one of which may be
+    // the control pipe).
+    const uint64_t num_wakeups = pump->num_wakeups() - num_wakeups_before;
+    EXPECT_GE(num_wakeups, (kNumPipes + max_handlers - 1) / max_handlers);
+    EXPECT_LE(num_wakeups, kNumPipes + 1);
+
+    for (size_t i = 0; i < kNumPipes; i++)
+      pump->RemoveHandler(pipes[i].handle0.get());
+  }
+}
+
+TEST(MessagePumpMojo, RemoveHandlerDuringBatch) {
+  base::MessageLoop message_loop(MessagePumpMojo::Create());
+  MessagePipe handles1;
+  MessagePipe handles2;
+  RemovingMojoHandler handler1(handles2.handle0.get());
+  RemovingMojoHandler handler2(handles1.handle0.get());
+  MessagePumpMojo::current()->AddHandler(&handler1, handles1.handle0.get(),
+                                         MOJO_HANDLE_SIGNAL_READABLE,
+                                         base::TimeTicks());
+  MessagePumpMojo::current()->AddHandler(&handler2, handles2.handle0.get(),
+                                         MOJO_HANDLE_SIGNAL_READABLE,
+                                         base::TimeTicks());
+  WriteMessageRaw(handles1.handle1.get(), NULL, 0, NULL, 0,
+                  MOJO_WRITE_MESSAGE_FLAG_NONE);
+  WriteMessageRaw(handles2.handle1.get(), NULL, 0, NULL, 0,
+                  MOJO_WRITE_MESSAGE_FLAG_NONE);
+  base::RunLoop run_loop;
+  run_loop.RunUntilIdle();
+  // Whichever handler ran first removed the other one, even though both
+  // handles were ready in the same wakeup.
+  EXPECT_EQ(1, handler1.success_count() + handler2.success_count());
+  MessagePumpMojo::current()->RemoveHandler(handles1.handle0.get());
+  MessagePumpMojo::current()->RemoveHandler(handles2.handle0.get());
+}
+
+TEST(MessagePumpMojo, RemoveHandlerBeforeDeadline) {
+  base::MessageLoop message_loop(MessagePumpMojo::Create());
+  CountingMojoHandler handler1;
+  CountingMojoHandler handler2;
+  MessagePipe handles1;
+  MessagePipe handles2;
+  const base::TimeTicks deadline =
+      base::TimeTicks::Now() - base::TimeDelta::FromSeconds(1);
+  MessagePumpMojo::current()->AddHandler(&handler1, handles1.handle0.get(),
+                                         MOJO_HANDLE_SIGNAL_READABLE, deadline);
+  MessagePumpMojo::current()->AddHandler(&handler2, handles2.handle0.get(),
+                                         MOJO_HANDLE_SIGNAL_READABLE, deadline);
+  MessagePumpMojo::current()->RemoveHandler(handles1.handle0.get());
+  base::RunLoop run_loop;
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(0, handler1.error_count());
+  EXPECT_EQ(1, handler2.error_count());
+
+  // |handles1.handle0| can be added again after having been removed.
+  MessagePumpMojo::current()->AddHandler(&handler1, handles1.handle0.get(),
+                                         MOJO_HANDLE_SIGNAL_READABLE,
+                                         base::TimeTicks());
+  WriteMessageRaw(handles1.handle1.get(), NULL, 0, NULL, 0,
+                  MOJO_WRITE_MESSAGE_FLAG_NONE);
+  base::RunLoop run_loop2;
+  run_loop2.RunUntilIdle();
+  EXPECT_EQ(1, handler1.success_count());
+  MessagePumpMojo::current()->RemoveHandler(handles1.handle0.get());
+}
+
+TEST(MessagePumpMojo, WithoutWaitSet) {
+  base::MessageLoop message_loop(
+      MessagePumpMojo::CreateWithoutWaitSetForTesting());
+  CountingMojoHandler handler1;
+  CountingMojoHandler handler2;
+  MessagePipe handles1;
+  MessagePipe handles2;
+  MessagePumpMojo::current()->AddHandler(&handler1, handles1.handle0.get(),
+                                         MOJO_HANDLE_SIGNAL_READABLE,
+                                         base::TimeTicks());
+  MessagePumpMojo::current()->AddHandler(&handler2, handles2.handle0.get(),
+                                         MOJO_HANDLE_SIGNAL_READABLE,
+                                         base::TimeTicks());
+  WriteMessageRaw(handles1.handle1.get(), NULL, 0, NULL, 0,
+                  MOJO_WRITE_MESSAGE_FLAG_NONE);
+  // Closing the peer makes |handles2.handle0| unable to become readable.
+  handles2.handle1.reset();
+  base::RunLoop run_loop;
+  run_loop.RunUntilIdle();
+  EXPECT_EQ(1, handler1.success_count());
+  EXPECT_EQ(1, handler2.error_count());
+  MessagePumpMojo::current()->RemoveHandler(handles1.handle0.get());
+}
+
 }  // namespace test
 }  // namespace common
 }  // namespace mojo
@@ -7,6 +7,7 @@
 #include "base/logging.h"
 #include "base/trace_event/trace_config.h"
 #include "base/trace_event/trace_event.h"
+#include "mojo/common/trace_event_recorder.h"
 #include "mojo/public/cpp/application/application_connection.h"
 #include "mojo/public/cpp/application/application_impl.h"
 
@@ -14,10 +15,14 @@ namespace mojo {
 
 TraceControllerImpl::TraceControllerImpl(
     InterfaceRequest<tracing::TraceController> request)
-    : tracing_already_started_(false), binding_(this, request.Pass()) {
+    : tracing_already_started_(false),
+      recording_(false),
+      binding_(this, request.Pass()) {
 }
 
 TraceControllerImpl::~TraceControllerImpl() {
+  if (recording_)
+    TraceEventRecorder::GetInstance()->Stop();
 }
 
 void TraceControllerImpl::StartTracing(
@@ -26,16 +31,28 @@ void TraceControllerImpl::StartTracing(
   DCHECK(!collector_.get());
   collector_ = collector.Pass();
   if (!tracing_already_started_) {
-    std::string categories_str = categories.To<std::string>();
-    base::trace_event::TraceLog::GetInstance()->SetEnabled(
-        base::trace_event::TraceConfig(categories_str,
-                                       base::trace_event::RECORD_UNTIL_FULL),
-        base::trace_event::TraceLog::RECORDING_MODE);
+    recording_ = true;
+    TraceEventRecorder::GetInstance()->Start(categories.To<std::string>());
   }
 }
 
 void TraceControllerImpl::StopTracing() {
   DCHECK(collector_);
+  if (recording_) {
+    recording_ = false;
+    TraceEventRecorder* recorder = TraceEventRecorder::GetInstance();
+    recorder->Stop();
+    std::vector<std::vector<uint8_t>> chunks;
+    recorder->TakeRecords(&chunks);
+    for (auto& chunk : chunks) {
+      Array<uint8_t> records;
+      records.Swap(&chunk);
+      collector_->RecordsCollected(records.Pass());
+    }
+    collector_.reset();
+    return;
+  }
+
   base::trace_event::TraceLog::GetInstance()->SetDisabled();
 
   base::trace_event::TraceLog::GetInstance()->Flush(
@@ -46,7 +63,11 @@ void TraceControllerImpl::SendChunk(
     const scoped_refptr<base::RefCountedString>& events_str,
     bool has_more_events) {
   DCHECK(collector_);
-  collector_->DataCollected(mojo::String(events_str->data()));
+  // The trace log is done with |events_str|, so take its data rather than
+  // copying it (the chunks can be large).
+  mojo::String json;
+  json.Swap(&events_str->data());
+  collector_->DataCollected(json);
   if (!has_more_events) {
     collector_.reset();
   }
@@ -21,7 +21,9 @@ class TraceControllerImpl : public tracing::TraceController {
   // Set to true if base::trace_event::TraceLog is enabled externally to this
   // class. If this is set to true this class will save the collector but not
   // enable tracing when it receives a StartTracing message from the tracing
-  // service.
+  // service (and will send the TraceLog's events, as JSON, when it stops).
+  // Otherwise it records events with TraceEventRecorder and sends them as
+  // binary trace records.
   void set_tracing_already_started(bool tracing_already_started) {
     tracing_already_started_ = tracing_already_started;
   }
@@ -36,6 +38,7 @@ class TraceControllerImpl : public tracing::TraceController {
                  bool has_more_events);
 
   bool tracing_already_started_;
+  bool recording_;
   tracing::TraceDataCollectorPtr collector_;
   StrongBinding<tracing::TraceController> binding_;
 
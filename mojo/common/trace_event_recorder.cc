@@ -0,0 +1,167 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/common/trace_event_recorder.h"
+
+#include "base/logging.h"
+#include "base/memory/singleton.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_id_name_manager.h"
+#include "base/trace_event/trace_config.h"
+#include "base/trace_event/trace_event.h"
+#include "mojo/common/trace_records.h"
+
+namespace mojo {
+
+// static
+const size_t TraceEventRecorder::kMaxThreadBufferBytes;
+// static
+const size_t TraceEventRecorder::kMaxChunkBytes;
+
+class TraceEventRecorder::ThreadBuffer {
+ public:
+  // Must be created on its thread.
+  ThreadBuffer()
+      : thread_id_(base::PlatformThread::CurrentId()),
+        chunks_bytes_(0),
+        num_dropped_events_(0) {
+    UpdateThreadName();
+  }
+  ~ThreadBuffer() {}
+
+  void AddEvent(base::TraceTicks timestamp,
+                char phase,
+                const char* category,
+                const char* name,
+                unsigned long long id,
+                int num_args,
+                const char* const arg_names[],
+                const unsigned char arg_types[],
+                const unsigned long long arg_values[],
+                unsigned char flags) {
+    base::AutoLock locker(lock_);
+    if (chunks_bytes_ + writer_.size() >= kMaxThreadBufferBytes) {
+      num_dropped_events_++;
+      return;
+    }
+    writer_.AddEvent(timestamp.ToInternalValue(), phase, category, name, id,
+                     num_args, arg_names, arg_types, arg_values, flags);
+    if (writer_.size() >= kMaxChunkBytes)
+      FinishChunk();
+  }
+
+  // Appends the chunks of records to |chunks| and forgets them.
+  void TakeRecords(std::vector<std::vector<uint8_t>>* chunks) {
+    base::AutoLock locker(lock_);
+    FinishChunk();
+    for (auto& chunk : chunks_) {
+      chunks->push_back(std::vector<uint8_t>());
+      chunks->back().swap(chunk);
+    }
+    chunks_.clear();
+    chunks_bytes_ = 0;
+    if (num_dropped_events_) {
+      LOG(WARNING) << "Dropped " << num_dropped_events_
+                   << " trace events of thread " << thread_id_;
+      num_dropped_events_ = 0;
+    }
+  }
+
+ private:
+  // Moves the records in |writer_| to a new chunk (if there are any).
+  void FinishChunk() {
+    lock_.AssertAcquired();
+    if (!writer_.size())
+      return;
+    // The thread may have exited, in which case its name is gone.
+    if (base::PlatformThread::CurrentId() == thread_id_)
+      UpdateThreadName();
+    chunks_.push_back(std::vector<uint8_t>());
+    writer_.TakeRecords(
+        base::trace_event::TraceLog::GetInstance()->process_id(), thread_id_,
+        thread_name_, &chunks_.back());
+    chunks_bytes_ += chunks_.back().size();
+  }
+
+  void UpdateThreadName() {
+    const char* thread_name =
+        base::ThreadIdNameManager::GetInstance()->GetName(thread_id_);
+    thread_name_ = thread_name ? thread_name : "";
+  }
+
+  const base::PlatformThreadId thread_id_;
+
+  // Protects the members below. It's only ever contended while the records are
+  // being taken.
+  base::Lock lock_;
+  std::string thread_name_;
+  common::TraceRecordWriter writer_;
+  std::vector<std::vector<uint8_t>> chunks_;
+  size_t chunks_bytes_;
+  size_t num_dropped_events_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadBuffer);
+};
+
+// static
+TraceEventRecorder* TraceEventRecorder::GetInstance() {
+  return Singleton<TraceEventRecorder,
+                   LeakySingletonTraits<TraceEventRecorder>>::get();
+}
+
+void TraceEventRecorder::Start(const std::string& categories) {
+  std::vector<std::vector<uint8_t>> discarded;
+  TakeRecords(&discarded);
+  base::trace_event::TraceLog::GetInstance()->SetEventCallbackEnabled(
+      base::trace_event::TraceConfig(categories,
+                                     base::trace_event::RECORD_UNTIL_FULL),
+      &TraceEventRecorder::OnEvent);
+}
+
+void TraceEventRecorder::Stop() {
+  base::trace_event::TraceLog::GetInstance()->SetEventCallbackDisabled();
+}
+
+void TraceEventRecorder::TakeRecords(
+    std::vector<std::vector<uint8_t>>* chunks) {
+  base::AutoLock locker(lock_);
+  for (ThreadBuffer* thread_buffer : thread_buffers_)
+    thread_buffer->TakeRecords(chunks);
+}
+
+TraceEventRecorder::TraceEventRecorder() {
+}
+
+TraceEventRecorder::~TraceEventRecorder() {
+}
+
+// static
+void TraceEventRecorder::OnEvent(base::TraceTicks timestamp,
+                                 char phase,
+                                 const unsigned char* category_group_enabled,
+                                 const char* name,
+                                 unsigned long long id,
+                                 int num_args,
+                                 const char* const arg_names[],
+                                 const unsigned char arg_types[],
+                                 const unsigned long long arg_values[],
+                                 unsigned char flags) {
+  GetInstance()->GetThreadBuffer()->AddEvent(
+      timestamp, phase,
+      base::trace_event::TraceLog::GetCategoryGroupName(category_group_enabled),
+      name, id, num_args, arg_names, arg_types, arg_values, flags);
+}
+
+TraceEventRecorder::ThreadBuffer* TraceEventRecorder::GetThreadBuffer() {
+  ThreadBuffer* thread_buffer = thread_buffer_.Get();
+  if (!thread_buffer) {
+    thread_buffer = new ThreadBuffer();
+    thread_buffer_.Set(thread_buffer);
+    base::AutoLock locker(lock_);
+    thread_buffers_.push_back(thread_buffer);
+  }
+  return thread_buffer;
+}
+
+}  // namespace mojo
@@ -0,0 +1,88 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_COMMON_TRACE_EVENT_RECORDER_H_
+#define MOJO_COMMON_TRACE_EVENT_RECORDER_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_local.h"
+#include "base/time/time.h"
+
+template <typename T>
+struct DefaultSingletonTraits;
+
+namespace mojo {
+
+// TraceEventRecorder records trace events as binary trace records (see
+// mojo/common/trace_records.h), instead of letting base::trace_event::TraceLog
+// record them (TraceLog only hands its events back as JSON). Each thread writes
+// its events to its own buffer, so recording an event only takes an uncontended
+// lock.
+class TraceEventRecorder {
+ public:
+  // The most record data buffered for one thread; events beyond that are
+  // dropped.
+  static const size_t kMaxThreadBufferBytes = 16 * 1024 * 1024;
+
+  // The most record data taken in one piece by |TakeRecords()|.
+  static const size_t kMaxChunkBytes = 1024 * 1024;
+
+  static TraceEventRecorder* GetInstance();
+
+  // Starts recording the events of the given categories (as for
+  // base::trace_event::TraceConfig), discarding any events recorded earlier.
+  void Start(const std::string& categories);
+
+  // Stops recording events. (Events that are being added as this is called may
+  // still be recorded.)
+  void Stop();
+
+  // Takes the events recorded since |Start()|, appending them to |chunks| as
+  // trace records of at most about |kMaxChunkBytes| bytes each.
+  void TakeRecords(std::vector<std::vector<uint8_t>>* chunks);
+
+ private:
+  friend struct DefaultSingletonTraits<TraceEventRecorder>;
+
+  class ThreadBuffer;
+
+  TraceEventRecorder();
+  ~TraceEventRecorder();
+
+  // A base::trace_event::TraceLog::EventCallback.
+  static void OnEvent(base::TraceTicks timestamp,
+                      char phase,
+                      const unsigned char* category_group_enabled,
+                      const char* name,
+                      unsigned long long id,
+                      int num_args,
+                      const char* const arg_names[],
+                      const unsigned char arg_types[],
+                      const unsigned long long arg_values[],
+                      unsigned char flags);
+
+  // Returns the buffer for the current thread, creating it if necessary.
+  ThreadBuffer* GetThreadBuffer();
+
+  base::ThreadLocalPointer<ThreadBuffer> thread_buffer_;
+
+  // Protects |thread_buffers_|.
+  base::Lock lock_;
+  // The buffers of all the threads that have recorded events. They're never
+  // deleted, since the event callback may be running on their threads at any
+  // time (they're emptied when their records are taken, though).
+  std::vector<ThreadBuffer*> thread_buffers_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceEventRecorder);
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_COMMON_TRACE_EVENT_RECORDER_H_
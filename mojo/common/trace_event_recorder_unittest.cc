@@ -0,0 +1,97 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/common/trace_event_recorder.h"
+
+#include <map>
+
+#include "base/bind.h"
+#include "base/json/json_reader.h"
+#include "base/threading/thread.h"
+#include "base/trace_event/trace_event.h"
+#include "base/values.h"
+#include "mojo/common/trace_records.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+void AddEvents(int num_events) {
+  for (int i = 0; i < num_events; i++) {
+    TRACE_EVENT1("mojo_test", "TestEvent", "i", i);
+  }
+  TRACE_EVENT_INSTANT0("mojo_test_disabled", "DisabledEvent",
+                       TRACE_EVENT_SCOPE_THREAD);
+}
+
+// Returns the events in |chunks| as a list of JSON trace events.
+scoped_ptr<base::ListValue> ChunksToEvents(
+    const std::vector<std::vector<uint8_t>>& chunks) {
+  std::string json;
+  for (const auto& chunk : chunks) {
+    if (!common::AppendTraceRecordsAsJSON(&chunk[0], chunk.size(), &json))
+      return nullptr;
+  }
+  scoped_ptr<base::Value> value = base::JSONReader::Read("[" + json + "]");
+  base::ListValue* list = nullptr;
+  if (!value || !value->GetAsList(&list))
+    return nullptr;
+  ignore_result(value.release());
+  return make_scoped_ptr(list);
+}
+
+TEST(TraceEventRecorderTest, RecordsEventsOfAllThreads) {
+  TraceEventRecorder* recorder = TraceEventRecorder::GetInstance();
+  recorder->Start("mojo_test");
+  AddEvents(2);
+  base::Thread thread("trace_event_recorder_test");
+  ASSERT_TRUE(thread.Start());
+  thread.message_loop()->PostTask(FROM_HERE, base::Bind(&AddEvents, 3));
+  thread.Stop();
+  recorder->Stop();
+  // Events after |Stop()| aren't recorded.
+  AddEvents(1);
+
+  std::vector<std::vector<uint8_t>> chunks;
+  recorder->TakeRecords(&chunks);
+  scoped_ptr<base::ListValue> events = ChunksToEvents(chunks);
+  ASSERT_TRUE(events);
+
+  // Each TRACE_EVENT1 is a begin and an end event, and the (named) thread gets
+  // a metadata event for its name.
+  std::map<int, int> num_begin_events_by_thread;
+  size_t num_metadata_events = 0;
+  for (size_t i = 0; i < events->GetSize(); i++) {
+    const base::DictionaryValue* event = nullptr;
+    std::string phase;
+    std::string name;
+    int tid = 0;
+    ASSERT_TRUE(events->GetDictionary(i, &event));
+    ASSERT_TRUE(event->GetString("ph", &phase));
+    ASSERT_TRUE(event->GetString("name", &name));
+    ASSERT_TRUE(event->GetInteger("tid", &tid));
+    if (phase == "M") {
+      num_metadata_events++;
+      continue;
+    }
+    EXPECT_EQ("TestEvent", name);
+    if (phase == "B")
+      num_begin_events_by_thread[tid]++;
+  }
+  EXPECT_EQ(1u, num_metadata_events);
+  EXPECT_EQ(10u, events->GetSize() - num_metadata_events);
+  ASSERT_EQ(2u, num_begin_events_by_thread.size());
+  const int tid = static_cast<int>(base::PlatformThread::CurrentId());
+  EXPECT_EQ(2, num_begin_events_by_thread[tid]);
+  num_begin_events_by_thread.erase(tid);
+  EXPECT_EQ(3, num_begin_events_by_thread.begin()->second);
+
+  // The records have been taken.
+  chunks.clear();
+  recorder->TakeRecords(&chunks);
+  EXPECT_TRUE(chunks.empty());
+}
+
+}  // namespace
+}  // namespace mojo
@@ -0,0 +1,335 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/common/trace_records.h"
+
+#include <string.h>
+
+#include "base/format_macros.h"
+#include "base/json/string_escape.h"
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "base/trace_event/trace_event.h"
+
+namespace mojo {
+namespace common {
+
+namespace {
+
+template <typename T>
+void AppendValue(T value, std::vector<uint8_t>* records) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  records->insert(records->end(), bytes, bytes + sizeof(value));
+}
+
+void AppendString(const char* str, size_t length,
+                  std::vector<uint8_t>* records) {
+  AppendValue(static_cast<uint32_t>(length), records);
+  records->insert(records->end(), str, str + length);
+}
+
+bool IsStringType(unsigned char type) {
+  return type == TRACE_VALUE_TYPE_STRING ||
+         type == TRACE_VALUE_TYPE_COPY_STRING;
+}
+
+// Reads the fields of records, failing (for good) on reading past the end.
+class RecordReader {
+ public:
+  RecordReader(const void* data, size_t num_bytes)
+      : data_(static_cast<const char*>(data)),
+        remaining_(num_bytes),
+        ok_(true) {}
+
+  bool ok() const { return ok_; }
+  bool at_end() const { return !remaining_; }
+
+  template <typename T>
+  T Read() {
+    T value = T();
+    if (Has(sizeof(value))) {
+      memcpy(&value, data_, sizeof(value));
+      Skip(sizeof(value));
+    }
+    return value;
+  }
+
+  std::string ReadString() {
+    uint32_t length = Read<uint32_t>();
+    if (!Has(length))
+      return std::string();
+    std::string str(data_, length);
+    Skip(length);
+    return str;
+  }
+
+ private:
+  bool Has(size_t num_bytes) {
+    if (num_bytes > remaining_)
+      ok_ = false;
+    return ok_;
+  }
+
+  void Skip(size_t num_bytes) {
+    data_ += num_bytes;
+    remaining_ -= num_bytes;
+  }
+
+  const char* data_;
+  size_t remaining_;
+  bool ok_;
+
+  DISALLOW_COPY_AND_ASSIGN(RecordReader);
+};
+
+void AppendSeparator(std::string* json) {
+  if (!json->empty())
+    *json += ",";
+}
+
+}  // namespace
+
+TraceRecordWriter::TraceRecordWriter() : num_strings_(0) {
+}
+
+TraceRecordWriter::~TraceRecordWriter() {
+}
+
+void TraceRecordWriter::AddEvent(int64_t timestamp,
+                                 char phase,
+                                 const char* category,
+                                 const char* name,
+                                 uint64_t id,
+                                 int num_args,
+                                 const char* const arg_names[],
+                                 const unsigned char arg_types[],
+                                 const unsigned long long arg_values[],
+                                 unsigned char flags) {
+  const bool copy = !!(flags & TRACE_EVENT_FLAG_COPY);
+
+  // The strings have to be in the table before the event that refers to them.
+  uint32_t category_index = GetStringIndex(category, false);
+  uint32_t name_index = GetStringIndex(name, copy);
+  uint32_t arg_name_indices[base::trace_event::kTraceMaxNumArgs];
+  uint8_t num_recorded_args = 0;
+  for (int i = 0; i < num_args && i < base::trace_event::kTraceMaxNumArgs;
+       i++) {
+    if (arg_types[i] == TRACE_VALUE_TYPE_CONVERTABLE)
+      continue;
+    arg_name_indices[i] = GetStringIndex(arg_names[i], copy);
+    num_recorded_args++;
+  }
+
+  records_.push_back(TRACE_RECORD_EVENT);
+  AppendValue(timestamp, &records_);
+  AppendValue(id, &records_);
+  AppendValue(static_cast<uint8_t>(phase), &records_);
+  AppendValue(static_cast<uint8_t>(flags), &records_);
+  AppendValue(category_index, &records_);
+  AppendValue(name_index, &records_);
+  AppendValue(num_recorded_args, &records_);
+  for (int i = 0; i < num_args && i < base::trace_event::kTraceMaxNumArgs;
+       i++) {
+    if (arg_types[i] == TRACE_VALUE_TYPE_CONVERTABLE)
+      continue;
+    AppendValue(arg_name_indices[i], &records_);
+    AppendValue(static_cast<uint8_t>(arg_types[i]), &records_);
+    if (IsStringType(arg_types[i])) {
+      const char* value = reinterpret_cast<const char*>(arg_values[i]);
+      if (!value)
+        value = "NULL";
+      AppendString(value, strlen(value), &records_);
+    } else {
+      AppendValue(static_cast<uint64_t>(arg_values[i]), &records_);
+    }
+  }
+}
+
+void TraceRecordWriter::TakeRecords(int32_t process_id,
+                                    int32_t thread_id,
+                                    const std::string& thread_name,
+                                    std::vector<uint8_t>* records) {
+  records->push_back(TRACE_RECORD_THREAD);
+  AppendValue(process_id, records);
+  AppendValue(thread_id, records);
+  AppendString(thread_name.data(), thread_name.size(), records);
+  records->insert(records->end(), records_.begin(), records_.end());
+
+  records_.clear();
+  string_indices_.clear();
+  num_strings_ = 0;
+}
+
+uint32_t TraceRecordWriter::GetStringIndex(const char* str, bool copy) {
+  if (!copy) {
+    auto it = string_indices_.find(str);
+    if (it != string_indices_.end())
+      return it->second;
+    string_indices_[str] = num_strings_;
+  }
+  records_.push_back(TRACE_RECORD_STRING);
+  AppendString(str, strlen(str), &records_);
+  return num_strings_++;
+}
+
+bool AppendTraceRecordsAsJSON(const void* records,
+                              size_t num_bytes,
+                              std::string* json) {
+  RecordReader reader(records, num_bytes);
+  std::vector<std::string> strings;
+  bool have_thread = false;
+  int32_t process_id = 0;
+  int32_t thread_id = 0;
+
+  while (!reader.at_end()) {
+    uint8_t type = reader.Read<uint8_t>();
+    switch (type) {
+      case TRACE_RECORD_THREAD: {
+        process_id = reader.Read<int32_t>();
+        thread_id = reader.Read<int32_t>();
+        std::string thread_name = reader.ReadString();
+        if (!reader.ok())
+          return false;
+        have_thread = true;
+        strings.clear();
+        if (!thread_name.empty()) {
+          AppendSeparator(json);
+          base::StringAppendF(json,
+                              "{\"pid\":%d,\"tid\":%d,\"ts\":0,\"ph\":\"M\","
+                              "\"cat\":\"__metadata\",\"name\":\"thread_name\","
+                              "\"args\":{\"name\":",
+                              process_id, thread_id);
+          base::EscapeJSONString(thread_name, true, json);
+          *json += "}}";
+        }
+        break;
+      }
+
+      case TRACE_RECORD_STRING:
+        strings.push_back(reader.ReadString());
+        if (!reader.ok())
+          return false;
+        break;
+
+      case TRACE_RECORD_EVENT: {
+        int64_t timestamp = reader.Read<int64_t>();
+        uint64_t id = reader.Read<uint64_t>();
+        char phase = static_cast<char>(reader.Read<uint8_t>());
+        uint8_t flags = reader.Read<uint8_t>();
+        uint32_t category_index = reader.Read<uint32_t>();
+        uint32_t name_index = reader.Read<uint32_t>();
+        uint8_t num_args = reader.Read<uint8_t>();
+        if (!reader.ok() || !have_thread || category_index >= strings.size() ||
+            name_index >= strings.size() ||
+            num_args > base::trace_event::kTraceMaxNumArgs) {
+          return false;
+        }
+
+        std::string event;
+        base::StringAppendF(&event,
+                            "{\"pid\":%d,\"tid\":%d,\"ts\":%" PRId64
+                            ",\"ph\":\"%c\",\"cat\":",
+                            process_id, thread_id, timestamp, phase);
+        base::EscapeJSONString(strings[category_index], true, &event);
+        event += ",\"name\":";
+        base::EscapeJSONString(strings[name_index], true, &event);
+        event += ",\"args\":{";
+        for (uint8_t i = 0; i < num_args; i++) {
+          uint32_t arg_name_index = reader.Read<uint32_t>();
+          uint8_t arg_type = reader.Read<uint8_t>();
+          if (!reader.ok() || arg_name_index >= strings.size())
+            return false;
+          if (i > 0)
+            event += ",";
+          base::EscapeJSONString(strings[arg_name_index], true, &event);
+          event += ":";
+          if (IsStringType(arg_type)) {
+            std::string value = reader.ReadString();
+            if (!reader.ok())
+              return false;
+            base::EscapeJSONString(value, true, &event);
+          } else if (arg_type >= TRACE_VALUE_TYPE_BOOL &&
+                     arg_type <= TRACE_VALUE_TYPE_POINTER) {
+            base::trace_event::TraceEvent::TraceValue value;
+            value.as_uint = reader.Read<uint64_t>();
+            if (!reader.ok())
+              return false;
+            base::trace_event::TraceEvent::AppendValueAsJSON(arg_type, value,
+                                                             &event);
+          } else {
+            return false;
+          }
+        }
+        event += "}";
+
+        if (flags & TRACE_EVENT_FLAG_HAS_ID)
+          base::StringAppendF(&event, ",\"id\":\"0x%" PRIx64 "\"", id);
+        if (flags & TRACE_EVENT_FLAG_ASYNC_TTS)
+          event += ",\"use_async_tts\":1";
+        if (phase == TRACE_EVENT_PHASE_INSTANT) {
+          char scope = '?';
+          switch (flags & TRACE_EVENT_FLAG_SCOPE_MASK) {
+            case TRACE_EVENT_SCOPE_GLOBAL:
+              scope = TRACE_EVENT_SCOPE_NAME_GLOBAL;
+              break;
+            case TRACE_EVENT_SCOPE_PROCESS:
+              scope = TRACE_EVENT_SCOPE_NAME_PROCESS;
+              break;
+            case TRACE_EVENT_SCOPE_THREAD:
+              scope = TRACE_EVENT_SCOPE_NAME_THREAD;
+              break;
+          }
+          base::StringAppendF(&event, ",\"s\":\"%c\"", scope);
+        }
+        event += "}";
+
+        AppendSeparator(json);
+        *json += event;
+        break;
+      }
+
+      default:
+        return false;
+    }
+  }
+  return reader.ok();
+}
+
+bool AppendTraceStreamAsJSON(const void* stream,
+                             size_t num_bytes,
+                             std::string* json) {
+  const char* data = static_cast<const char*>(stream);
+  while (num_bytes) {
+    TraceChunkHeader header;
+    if (num_bytes < sizeof(header))
+      return false;
+    memcpy(&header, data, sizeof(header));
+    data += sizeof(header);
+    num_bytes -= sizeof(header);
+    if (header.num_bytes > num_bytes)
+      return false;
+
+    switch (header.type) {
+      case TRACE_CHUNK_JSON:
+        if (header.num_bytes) {
+          AppendSeparator(json);
+          json->append(data, header.num_bytes);
+        }
+        break;
+      case TRACE_CHUNK_RECORDS:
+        if (!AppendTraceRecordsAsJSON(data, header.num_bytes, json))
+          return false;
+        break;
+      default:
+        LOG(WARNING) << "Skipping trace chunk of unknown type " << header.type;
+        break;
+    }
+    data += header.num_bytes;
+    num_bytes -= header.num_bytes;
+  }
+  return true;
+}
+
+}  // namespace common
+}  // namespace mojo
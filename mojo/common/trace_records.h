@@ -0,0 +1,127 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A compact binary format for trace events, and for the trace stream that the
+// tracing service writes to the data pipe given to TraceCoordinator.Start().
+// Both are converted to JSON only by whoever consumes the trace (once tracing
+// has stopped), rather than by the traced applications.
+//
+// All integers are in the host's byte order (the records never leave the
+// machine they're recorded on without first being converted to JSON). A string
+// is a uint32 length followed by that many bytes (with no terminating null).
+//
+// Trace records are a sequence of records, each a uint8 |TraceRecordType|
+// followed by the fields described below. Strings that are used more than once
+// (category names, event names and argument names) are written once, as
+// |TRACE_RECORD_STRING| records, and referred to by their index in the current
+// string table.
+
+#ifndef MOJO_COMMON_TRACE_RECORDS_H_
+#define MOJO_COMMON_TRACE_RECORDS_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/containers/hash_tables.h"
+
+namespace mojo {
+namespace common {
+
+enum TraceRecordType {
+  // Starts the records of a thread: int32 process id, int32 thread id and the
+  // thread's name (a string, which may be empty). Empties the string table.
+  TRACE_RECORD_THREAD = 1,
+  // Appends a string to the string table: the string.
+  TRACE_RECORD_STRING = 2,
+  // An event of the current thread: int64 timestamp (in microseconds), uint64
+  // id, uint8 phase, uint8 flags (TRACE_EVENT_FLAG_*), uint32 category (a
+  // string table index), uint32 name (a string table index) and uint8 number
+  // of arguments. Each argument is a uint32 name (a string table index), a
+  // uint8 type (TRACE_VALUE_TYPE_*) and its value: a string for the string
+  // types and a uint64 (the bits of a base::trace_event::TraceValue) for the
+  // others.
+  TRACE_RECORD_EVENT = 3,
+};
+
+// The trace stream is a sequence of chunks, each a |TraceChunkHeader| followed
+// by |num_bytes| bytes of data of the given |TraceChunkType|.
+struct TraceChunkHeader {
+  uint32_t type;
+  uint32_t num_bytes;
+};
+
+enum TraceChunkType {
+  // A comma-separated list of JSON trace events.
+  TRACE_CHUNK_JSON = 1,
+  // Trace records, starting with a |TRACE_RECORD_THREAD| record.
+  TRACE_CHUNK_RECORDS = 2,
+};
+
+// TraceRecordWriter builds the records of one thread. It isn't thread-safe.
+class TraceRecordWriter {
+ public:
+  TraceRecordWriter();
+  ~TraceRecordWriter();
+
+  // Adds an event. The arguments are as for
+  // base::trace_event::TraceLog::EventCallback (with |category| being the
+  // category group's name). Unless |flags| has TRACE_EVENT_FLAG_COPY set,
+  // |category|, |name| and |arg_names| must stay valid (at the same addresses)
+  // until the records are taken. Arguments of type TRACE_VALUE_TYPE_CONVERTABLE
+  // are skipped, since their values aren't available to event callbacks.
+  void AddEvent(int64_t timestamp,
+                char phase,
+                const char* category,
+                const char* name,
+                uint64_t id,
+                int num_args,
+                const char* const arg_names[],
+                const unsigned char arg_types[],
+                const unsigned long long arg_values[],
+                unsigned char flags);
+
+  // The number of bytes of records added since they were last taken.
+  size_t size() const { return records_.size(); }
+
+  // Appends a |TRACE_RECORD_THREAD| record for the given thread to |records|,
+  // followed by the records added since they were last taken, and forgets
+  // them.
+  void TakeRecords(int32_t process_id,
+                   int32_t thread_id,
+                   const std::string& thread_name,
+                   std::vector<uint8_t>* records);
+
+ private:
+  // Returns the string table index of |str|, adding it to the table if it isn't
+  // already there (or if |copy| is true, in which case |str| may not stay at
+  // the same address).
+  uint32_t GetStringIndex(const char* str, bool copy);
+
+  std::vector<uint8_t> records_;
+  base::hash_map<const char*, uint32_t> string_indices_;
+  uint32_t num_strings_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceRecordWriter);
+};
+
+// Appends the events in |records| (of size |num_bytes|) to |json| as JSON
+// trace events (as base::trace_event::TraceEvent::AppendAsJSON() writes them),
+// each preceded by a comma unless |json| is empty. Returns false if |records|
+// isn't valid (after appending the events before the first invalid record).
+bool AppendTraceRecordsAsJSON(const void* records,
+                              size_t num_bytes,
+                              std::string* json);
+
+// Like |AppendTraceRecordsAsJSON()|, but for a trace stream (see above).
+bool AppendTraceStreamAsJSON(const void* stream,
+                             size_t num_bytes,
+                             std::string* json);
+
+}  // namespace common
+}  // namespace mojo
+
+#endif  // MOJO_COMMON_TRACE_RECORDS_H_
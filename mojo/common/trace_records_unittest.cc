@@ -0,0 +1,224 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/common/trace_records.h"
+
+#include <string.h>
+
+#include "base/json/json_reader.h"
+#include "base/trace_event/trace_event.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace common {
+namespace {
+
+// Parses a comma-separated list of JSON trace events.
+scoped_ptr<base::ListValue> ParseEvents(const std::string& json) {
+  scoped_ptr<base::Value> value = base::JSONReader::Read("[" + json + "]");
+  base::ListValue* list = nullptr;
+  if (!value || !value->GetAsList(&list))
+    return nullptr;
+  ignore_result(value.release());
+  return make_scoped_ptr(list);
+}
+
+void AddEvent(TraceRecordWriter* writer,
+              int64_t timestamp,
+              char phase,
+              const char* name,
+              unsigned char flags) {
+  writer->AddEvent(timestamp, phase, "cat", name, 0, 0, nullptr, nullptr,
+                   nullptr, flags);
+}
+
+void AppendChunk(TraceChunkType type,
+                 const void* data,
+                 size_t num_bytes,
+                 std::string* stream) {
+  TraceChunkHeader header = {type, static_cast<uint32_t>(num_bytes)};
+  stream->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream->append(static_cast<const char*>(data), num_bytes);
+}
+
+TEST(TraceRecordsTest, EventsToJSON) {
+  TraceRecordWriter writer;
+  const char* const arg_names[] = {"int", "str"};
+  const unsigned char arg_types[] = {TRACE_VALUE_TYPE_INT,
+                                     TRACE_VALUE_TYPE_STRING};
+  const unsigned long long arg_values[] = {
+      static_cast<unsigned long long>(-42),
+      reinterpret_cast<unsigned long long>("a \"quoted\" value")};
+  writer.AddEvent(123, TRACE_EVENT_PHASE_BEGIN, "cat1,cat2", "Event", 0, 2,
+                  arg_names, arg_types, arg_values, TRACE_EVENT_FLAG_NONE);
+  writer.AddEvent(456, TRACE_EVENT_PHASE_ASYNC_BEGIN, "cat1,cat2", "Async",
+                  0xabc, 0, nullptr, nullptr, nullptr,
+                  TRACE_EVENT_FLAG_HAS_ID);
+  std::vector<uint8_t> records;
+  writer.TakeRecords(10, 20, "worker", &records);
+  EXPECT_EQ(0u, writer.size());
+
+  std::string json;
+  ASSERT_TRUE(AppendTraceRecordsAsJSON(&records[0], records.size(), &json));
+  scoped_ptr<base::ListValue> events = ParseEvents(json);
+  ASSERT_TRUE(events);
+  ASSERT_EQ(3u, events->GetSize());
+
+  const base::DictionaryValue* event = nullptr;
+  std::string str;
+  int i = 0;
+  ASSERT_TRUE(events->GetDictionary(0, &event));
+  EXPECT_TRUE(event->GetString("ph", &str));
+  EXPECT_EQ("M", str);
+  EXPECT_TRUE(event->GetString("name", &str));
+  EXPECT_EQ("thread_name", str);
+  EXPECT_TRUE(event->GetString("args.name", &str));
+  EXPECT_EQ("worker", str);
+  EXPECT_TRUE(event->GetInteger("tid", &i));
+  EXPECT_EQ(20, i);
+
+  ASSERT_TRUE(events->GetDictionary(1, &event));
+  EXPECT_TRUE(event->GetInteger("pid", &i));
+  EXPECT_EQ(10, i);
+  EXPECT_TRUE(event->GetInteger("tid", &i));
+  EXPECT_EQ(20, i);
+  EXPECT_TRUE(event->GetInteger("ts", &i));
+  EXPECT_EQ(123, i);
+  EXPECT_TRUE(event->GetString("ph", &str));
+  EXPECT_EQ("B", str);
+  EXPECT_TRUE(event->GetString("cat", &str));
+  EXPECT_EQ("cat1,cat2", str);
+  EXPECT_TRUE(event->GetString("name", &str));
+  EXPECT_EQ("Event", str);
+  EXPECT_TRUE(event->GetInteger("args.int", &i));
+  EXPECT_EQ(-42, i);
+  EXPECT_TRUE(event->GetString("args.str", &str));
+  EXPECT_EQ("a \"quoted\" value", str);
+  EXPECT_FALSE(event->HasKey("id"));
+
+  ASSERT_TRUE(events->GetDictionary(2, &event));
+  EXPECT_TRUE(event->GetString("name", &str));
+  EXPECT_EQ("Async", str);
+  EXPECT_TRUE(event->GetString("id", &str));
+  EXPECT_EQ("0xabc", str);
+}
+
+TEST(TraceRecordsTest, StringsAreWrittenOnce) {
+  TraceRecordWriter writer;
+  static const char kName[] = "AVeryLongEventNameThatShouldOnlyBeWrittenOnce";
+  AddEvent(&writer, 1, TRACE_EVENT_PHASE_BEGIN, kName, TRACE_EVENT_FLAG_NONE);
+  size_t first_event_size = writer.size();
+  AddEvent(&writer, 2, TRACE_EVENT_PHASE_END, kName, TRACE_EVENT_FLAG_NONE);
+  EXPECT_LT(writer.size() - first_event_size, sizeof(kName));
+
+  // Once the records have been taken, the strings have to be written again.
+  std::vector<uint8_t> records;
+  writer.TakeRecords(1, 1, std::string(), &records);
+  AddEvent(&writer, 3, TRACE_EVENT_PHASE_BEGIN, kName, TRACE_EVENT_FLAG_NONE);
+  EXPECT_EQ(first_event_size, writer.size());
+  writer.TakeRecords(1, 2, std::string(), &records);
+
+  std::string json;
+  ASSERT_TRUE(AppendTraceRecordsAsJSON(&records[0], records.size(), &json));
+  scoped_ptr<base::ListValue> events = ParseEvents(json);
+  ASSERT_TRUE(events);
+  ASSERT_EQ(3u, events->GetSize());
+  for (size_t i = 0; i < events->GetSize(); i++) {
+    const base::DictionaryValue* event = nullptr;
+    std::string name;
+    ASSERT_TRUE(events->GetDictionary(i, &event));
+    EXPECT_TRUE(event->GetString("name", &name));
+    EXPECT_EQ(kName, name);
+  }
+}
+
+TEST(TraceRecordsTest, CopiedStrings) {
+  TraceRecordWriter writer;
+  // With TRACE_EVENT_FLAG_COPY, the name may be reused (at the same address)
+  // for different strings.
+  char name[] = "First";
+  AddEvent(&writer, 1, TRACE_EVENT_PHASE_INSTANT, name, TRACE_EVENT_FLAG_COPY);
+  strcpy(name, "Other");
+  AddEvent(&writer, 2, TRACE_EVENT_PHASE_INSTANT, name, TRACE_EVENT_FLAG_COPY);
+  std::vector<uint8_t> records;
+  writer.TakeRecords(1, 1, std::string(), &records);
+
+  std::string json;
+  ASSERT_TRUE(AppendTraceRecordsAsJSON(&records[0], records.size(), &json));
+  scoped_ptr<base::ListValue> events = ParseEvents(json);
+  ASSERT_TRUE(events);
+  ASSERT_EQ(2u, events->GetSize());
+  const base::DictionaryValue* event = nullptr;
+  std::string str;
+  ASSERT_TRUE(events->GetDictionary(0, &event));
+  EXPECT_TRUE(event->GetString("name", &str));
+  EXPECT_EQ("First", str);
+  EXPECT_TRUE(event->GetString("s", &str));
+  EXPECT_EQ("g", str);
+  ASSERT_TRUE(events->GetDictionary(1, &event));
+  EXPECT_TRUE(event->GetString("name", &str));
+  EXPECT_EQ("Other", str);
+}
+
+TEST(TraceRecordsTest, InvalidRecords) {
+  TraceRecordWriter writer;
+  AddEvent(&writer, 1, TRACE_EVENT_PHASE_BEGIN, "Event", TRACE_EVENT_FLAG_NONE);
+  std::vector<uint8_t> records;
+  writer.TakeRecords(1, 1, std::string(), &records);
+
+  std::string json;
+  EXPECT_FALSE(
+      AppendTraceRecordsAsJSON(&records[0], records.size() - 1, &json));
+  EXPECT_TRUE(json.empty());
+
+  // Events have to come after a thread record.
+  const size_t kThreadRecordSize = 1 + 4 + 4 + 4;
+  EXPECT_FALSE(AppendTraceRecordsAsJSON(&records[kThreadRecordSize],
+                                        records.size() - kThreadRecordSize,
+                                        &json));
+}
+
+TEST(TraceRecordsTest, StreamToJSON) {
+  TraceRecordWriter writer;
+  AddEvent(&writer, 2, TRACE_EVENT_PHASE_BEGIN, "Binary",
+           TRACE_EVENT_FLAG_NONE);
+  std::vector<uint8_t> records;
+  writer.TakeRecords(1, 1, std::string(), &records);
+
+  const std::string json_chunk1 =
+      "{\"pid\":2,\"tid\":2,\"ts\":1,\"ph\":\"B\",\"cat\":\"c\","
+      "\"name\":\"First\",\"args\":{}}";
+  const std::string json_chunk2 =
+      "{\"pid\":2,\"tid\":2,\"ts\":3,\"ph\":\"E\",\"cat\":\"c\","
+      "\"name\":\"First\",\"args\":{}}";
+  std::string stream;
+  AppendChunk(TRACE_CHUNK_JSON, json_chunk1.data(), json_chunk1.size(),
+              &stream);
+  AppendChunk(TRACE_CHUNK_RECORDS, &records[0], records.size(), &stream);
+  AppendChunk(TRACE_CHUNK_JSON, json_chunk2.data(), json_chunk2.size(),
+              &stream);
+
+  std::string json;
+  ASSERT_TRUE(AppendTraceStreamAsJSON(stream.data(), stream.size(), &json));
+  scoped_ptr<base::ListValue> events = ParseEvents(json);
+  ASSERT_TRUE(events);
+  ASSERT_EQ(3u, events->GetSize());
+  const base::DictionaryValue* event = nullptr;
+  int ts = 0;
+  for (size_t i = 0; i < events->GetSize(); i++) {
+    ASSERT_TRUE(events->GetDictionary(i, &event));
+    EXPECT_TRUE(event->GetInteger("ts", &ts));
+    EXPECT_EQ(static_cast<int>(i + 1), ts);
+  }
+
+  // A truncated chunk isn't valid.
+  json.clear();
+  EXPECT_FALSE(
+      AppendTraceStreamAsJSON(stream.data(), stream.size() - 1, &json));
+}
+
+}  // namespace
+}  // namespace common
+}  // namespace mojo
@@ -137,4 +137,45 @@ gfx::Rect TypeConverter<gfx::Rect, Rect>::Convert(const Rect& input) {
   return gfx::Rect(input.x, input.y, input.width, input.height);
 }
 
+// static
+gfx::PointF TypeConverter<gfx::PointF, PointFView>::Convert(
+    const PointFView& input) {
+  if (input.is_null())
+    return gfx::PointF();
+  return gfx::PointF(input.x(), input.y());
+}
+
+// static
+gfx::Size TypeConverter<gfx::Size, SizeView>::Convert(const SizeView& input) {
+  if (input.is_null())
+    return gfx::Size();
+  return gfx::Size(input.width(), input.height());
+}
+
+// static
+gfx::Rect TypeConverter<gfx::Rect, RectView>::Convert(const RectView& input) {
+  if (input.is_null())
+    return gfx::Rect();
+  return gfx::Rect(input.x(), input.y(), input.width(), input.height());
+}
+
+// static
+gfx::RectF TypeConverter<gfx::RectF, RectFView>::Convert(
+    const RectFView& input) {
+  if (input.is_null())
+    return gfx::RectF();
+  return gfx::RectF(input.x(), input.y(), input.width(), input.height());
+}
+
+// static
+gfx::Transform TypeConverter<gfx::Transform, TransformView>::Convert(
+    const TransformView& input) {
+  if (input.is_null())
+    return gfx::Transform();
+  // |matrix| is validated to have 16 elements.
+  gfx::Transform transform(gfx::Transform::kSkipInitialization);
+  transform.matrix().setRowMajorf(input.matrix().GetData_()->storage());
+  return transform;
+}
+
 }  // namespace mojo
@@ -86,6 +86,33 @@ struct TypeConverter<gfx::Rect, Rect> {
   static gfx::Rect Convert(const Rect& input);
 };
 
+// Views (of validated messages). Like the |...Ptr| converters, these convert
+// null views to the default value.
+template <>
+struct TypeConverter<gfx::PointF, PointFView> {
+  static gfx::PointF Convert(const PointFView& input);
+};
+
+template <>
+struct TypeConverter<gfx::Size, SizeView> {
+  static gfx::Size Convert(const SizeView& input);
+};
+
+template <>
+struct TypeConverter<gfx::Rect, RectView> {
+  static gfx::Rect Convert(const RectView& input);
+};
+
+template <>
+struct TypeConverter<gfx::RectF, RectFView> {
+  static gfx::RectF Convert(const RectFView& input);
+};
+
+template <>
+struct TypeConverter<gfx::Transform, TransformView> {
+  static gfx::Transform Convert(const TransformView& input);
+};
+
 }  // namespace mojo
 
 inline bool operator==(const mojo::Size& lhs, const mojo::Size& rhs) {
@@ -4,6 +4,10 @@
 
 #include "mojo/converters/surfaces/surfaces_type_converters.h"
 
+#include <string.h>
+
+#include <vector>
+
 #include "base/macros.h"
 #include "cc/output/compositor_frame.h"
 #include "cc/output/delegated_frame_data.h"
@@ -190,6 +194,531 @@ bool ConvertDrawQuad(const QuadPtr& input,
   return true;
 }
 
+// The following overloads do the same as the ones above, but read the input
+// directly out of a (validated) message.
+
+cc::SharedQuadState* ConvertSharedQuadState(const SharedQuadStateView& input,
+                                            cc::RenderPass* render_pass) {
+  cc::SharedQuadState* state = render_pass->CreateAndAppendSharedQuadState();
+  state->SetAll(ConvertTo<gfx::Transform>(input.content_to_target_transform()),
+                ConvertTo<gfx::Size>(input.content_bounds()),
+                ConvertTo<gfx::Rect>(input.visible_content_rect()),
+                ConvertTo<gfx::Rect>(input.clip_rect()),
+                input.is_clipped(),
+                input.opacity(),
+                static_cast<::SkXfermode::Mode>(input.blend_mode()),
+                input.sorting_context_id());
+  return state;
+}
+
+bool ConvertDrawQuad(const QuadView& input,
+                     cc::SharedQuadState* sqs,
+                     cc::RenderPass* render_pass) {
+  const gfx::Rect rect = ConvertTo<gfx::Rect>(input.rect());
+  const gfx::Rect opaque_rect = ConvertTo<gfx::Rect>(input.opaque_rect());
+  const gfx::Rect visible_rect = ConvertTo<gfx::Rect>(input.visible_rect());
+  switch (input.material()) {
+    case MATERIAL_RENDER_PASS: {
+      RenderPassQuadStateView render_pass_quad_state =
+          input.render_pass_quad_state();
+      if (render_pass_quad_state.is_null())
+        return false;
+      cc::RenderPassDrawQuad* render_pass_quad =
+          render_pass->CreateAndAppendDrawQuad<cc::RenderPassDrawQuad>();
+      gfx::PointF mask_uv_scale_as_point =
+          ConvertTo<gfx::PointF>(render_pass_quad_state.mask_uv_scale());
+      gfx::PointF filter_scale_as_point =
+          ConvertTo<gfx::PointF>(render_pass_quad_state.filters_scale());
+      render_pass_quad->SetAll(
+          sqs,
+          rect,
+          opaque_rect,
+          visible_rect,
+          input.needs_blending(),
+          ConvertTo<cc::RenderPassId>(render_pass_quad_state.render_pass_id()),
+          render_pass_quad_state.mask_resource_id(),
+          mask_uv_scale_as_point.OffsetFromOrigin(),
+          ConvertTo<gfx::Size>(render_pass_quad_state.mask_texture_size()),
+          cc::FilterOperations(),  // TODO(jamesr): filters
+          filter_scale_as_point.OffsetFromOrigin(),
+          cc::FilterOperations());  // TODO(jamesr): background_filters
+      break;
+    }
+    case MATERIAL_SOLID_COLOR: {
+      SolidColorQuadStateView color_state = input.solid_color_quad_state();
+      if (color_state.is_null())
+        return false;
+      cc::SolidColorDrawQuad* color_quad =
+          render_pass->CreateAndAppendDrawQuad<cc::SolidColorDrawQuad>();
+      color_quad->SetAll(sqs,
+                         rect,
+                         opaque_rect,
+                         visible_rect,
+                         input.needs_blending(),
+                         ConvertTo<SkColor>(color_state.color()),
+                         color_state.force_anti_aliasing_off());
+      break;
+    }
+    case MATERIAL_SURFACE_CONTENT: {
+      SurfaceQuadStateView surface_state = input.surface_quad_state();
+      if (surface_state.is_null())
+        return false;
+      cc::SurfaceDrawQuad* surface_quad =
+          render_pass->CreateAndAppendDrawQuad<cc::SurfaceDrawQuad>();
+      surface_quad->SetAll(sqs,
+                           rect,
+                           opaque_rect,
+                           visible_rect,
+                           input.needs_blending(),
+                           ConvertTo<cc::SurfaceId>(surface_state.surface()));
+      break;
+    }
+    case MATERIAL_TEXTURE_CONTENT: {
+      TextureQuadStateView texture_quad_state = input.texture_quad_state();
+      if (texture_quad_state.is_null() ||
+          texture_quad_state.vertex_opacity().is_null() ||
+          texture_quad_state.background_color().is_null())
+        return false;
+      cc::TextureDrawQuad* texture_quad =
+          render_pass->CreateAndAppendDrawQuad<cc::TextureDrawQuad>();
+      texture_quad->SetAll(
+          sqs,
+          rect,
+          opaque_rect,
+          visible_rect,
+          input.needs_blending(),
+          texture_quad_state.resource_id(),
+          texture_quad_state.premultiplied_alpha(),
+          ConvertTo<gfx::PointF>(texture_quad_state.uv_top_left()),
+          ConvertTo<gfx::PointF>(texture_quad_state.uv_bottom_right()),
+          ConvertTo<SkColor>(texture_quad_state.background_color()),
+          texture_quad_state.vertex_opacity().GetData_()->storage(),
+          texture_quad_state.flipped(),
+          texture_quad_state.nearest_neighbor());
+      break;
+    }
+    case MATERIAL_TILED_CONTENT: {
+      TileQuadStateView tile_state = input.tile_quad_state();
+      if (tile_state.is_null())
+        return false;
+      cc::TileDrawQuad* tile_quad =
+          render_pass->CreateAndAppendDrawQuad<cc::TileDrawQuad>();
+      tile_quad->SetAll(sqs,
+                        rect,
+                        opaque_rect,
+                        visible_rect,
+                        input.needs_blending(),
+                        tile_state.resource_id(),
+                        ConvertTo<gfx::RectF>(tile_state.tex_coord_rect()),
+                        ConvertTo<gfx::Size>(tile_state.texture_size()),
+                        tile_state.swizzle_contents(),
+                        tile_state.nearest_neighbor());
+      break;
+    }
+    case MATERIAL_YUV_VIDEO_CONTENT: {
+      YUVVideoQuadStateView yuv_state = input.yuv_video_quad_state();
+      if (yuv_state.is_null())
+        return false;
+      cc::YUVVideoDrawQuad* yuv_quad =
+          render_pass->CreateAndAppendDrawQuad<cc::YUVVideoDrawQuad>();
+      yuv_quad->SetAll(sqs,
+                       rect,
+                       opaque_rect,
+                       visible_rect,
+                       input.needs_blending(),
+                       ConvertTo<gfx::RectF>(yuv_state.tex_coord_rect()),
+                       gfx::Size(),  // TODO(jamesr): texture size
+                       yuv_state.y_plane_resource_id(),
+                       yuv_state.u_plane_resource_id(),
+                       yuv_state.v_plane_resource_id(),
+                       yuv_state.a_plane_resource_id(),
+                       static_cast<cc::YUVVideoDrawQuad::ColorSpace>(
+                           yuv_state.color_space()));
+      break;
+    }
+    default:
+      NOTREACHED() << "Unsupported material " << input.material();
+      return false;
+  }
+  return true;
+}
+
+const Pass* FindPass(const Array<PassPtr>& passes, int32_t id) {
+  for (size_t i = 0; i < passes.size(); ++i) {
+    if (passes[i]->id == id)
+      return passes[i].get();
+  }
+  return nullptr;
+}
+
+const cc::RenderPass* FindRenderPass(const cc::RenderPassList& passes,
+                                     int32_t id) {
+  for (const cc::RenderPass* pass : passes) {
+    if (pass->id == cc::RenderPassId(1, id))
+      return pass;
+  }
+  return nullptr;
+}
+
+// Builds the pass described by |input| relative to |previous| (null if the
+// previous frame had no such pass). Returns null if |input| isn't valid.
+scoped_ptr<cc::RenderPass> ConvertPassDelta(const PassDeltaPtr& input,
+                                            const cc::RenderPass* previous) {
+  const size_t quad_count = input->quad_count;
+  const size_t sqs_count = input->shared_quad_state_count;
+  const size_t previous_quad_count = previous ? previous->quad_list.size() : 0;
+  const size_t previous_sqs_count =
+      previous ? previous->shared_quad_state_list.size() : 0;
+  // Everything past the end of the previous pass must be updated (which also
+  // bounds the counts by the size of the message).
+  if (quad_count > previous_quad_count + input->quad_updates.size() ||
+      sqs_count > previous_sqs_count + input->shared_quad_state_updates.size())
+    return nullptr;
+
+  std::vector<const SharedQuadStatePtr*> sqs_updates(sqs_count, nullptr);
+  for (size_t i = 0; i < input->shared_quad_state_updates.size(); ++i) {
+    const SharedQuadStateUpdatePtr& update =
+        input->shared_quad_state_updates[i];
+    if (update->index >= sqs_count)
+      return nullptr;
+    sqs_updates[update->index] = &update->shared_quad_state;
+  }
+  std::vector<const QuadPtr*> quad_updates(quad_count, nullptr);
+  for (size_t i = 0; i < input->quad_updates.size(); ++i) {
+    const QuadUpdatePtr& update = input->quad_updates[i];
+    if (update->index >= quad_count)
+      return nullptr;
+    quad_updates[update->index] = &update->quad;
+  }
+
+  scoped_ptr<cc::RenderPass> pass =
+      cc::RenderPass::Create(sqs_count, quad_count);
+  pass->SetAll(cc::RenderPassId(1, input->id),
+               input->output_rect.To<gfx::Rect>(),
+               input->damage_rect.To<gfx::Rect>(),
+               input->transform_to_root_target.To<gfx::Transform>(),
+               input->has_transparent_background);
+
+  std::vector<const cc::SharedQuadState*> previous_sqs_list;
+  std::vector<const cc::DrawQuad*> previous_quad_list;
+  if (previous) {
+    previous_sqs_list.reserve(previous_sqs_count);
+    for (const cc::SharedQuadState* sqs : previous->shared_quad_state_list)
+      previous_sqs_list.push_back(sqs);
+    previous_quad_list.reserve(previous_quad_count);
+    for (const cc::DrawQuad* quad : previous->quad_list)
+      previous_quad_list.push_back(quad);
+  }
+  std::vector<cc::SharedQuadState*> sqs_list(sqs_count);
+  for (size_t i = 0; i < sqs_count; ++i) {
+    if (sqs_updates[i]) {
+      sqs_list[i] = ConvertSharedQuadState(*sqs_updates[i], pass.get());
+      continue;
+    }
+    if (i >= previous_sqs_count)
+      return nullptr;
+    sqs_list[i] = pass->CreateAndAppendSharedQuadState();
+    sqs_list[i]->CopyFrom(previous_sqs_list[i]);
+  }
+
+  // Quads refer to their shared quad states in order.
+  size_t previous_sqs_index = 0;
+  size_t last_sqs_index = 0;
+  for (size_t i = 0; i < quad_count; ++i) {
+    const cc::DrawQuad* previous_quad = nullptr;
+    if (i < previous_quad_count) {
+      previous_quad = previous_quad_list[i];
+      while (previous_quad->shared_quad_state !=
+             previous_sqs_list[previous_sqs_index]) {
+        ++previous_sqs_index;
+        DCHECK_LT(previous_sqs_index, previous_sqs_count);
+      }
+    }
+
+    size_t sqs_index = quad_updates[i]
+                           ? (*quad_updates[i])->shared_quad_state_index
+                           : previous_sqs_index;
+    if (sqs_index >= sqs_count || sqs_index < last_sqs_index)
+      return nullptr;
+    last_sqs_index = sqs_index;
+
+    if (quad_updates[i]) {
+      if (!ConvertDrawQuad(*quad_updates[i], sqs_list[sqs_index], pass.get()))
+        return nullptr;
+    } else if (!previous_quad) {
+      return nullptr;
+    } else if (previous_quad->material == cc::DrawQuad::RENDER_PASS) {
+      const cc::RenderPassDrawQuad* render_pass_quad =
+          cc::RenderPassDrawQuad::MaterialCast(previous_quad);
+      pass->CopyFromAndAppendRenderPassDrawQuad(
+          render_pass_quad, sqs_list[sqs_index],
+          render_pass_quad->render_pass_id);
+    } else {
+      pass->CopyFromAndAppendDrawQuad(previous_quad, sqs_list[sqs_index]);
+    }
+  }
+  return pass.Pass();
+}
+
+// The following write cc types directly into a message (for
+// |CompositorFrameWriter|), producing the same structs as converting them with
+// the type converters and serializing the result would.
+
+internal::Color_Data* WriteColor(SkColor input, internal::Buffer* buf) {
+  internal::Color_Data* color = internal::Color_Data::New(buf);
+  color->rgba = input;
+  return color;
+}
+
+internal::PointF_Data* WritePointF(const gfx::PointF& input,
+                                   internal::Buffer* buf) {
+  internal::PointF_Data* point = internal::PointF_Data::New(buf);
+  point->x = input.x();
+  point->y = input.y();
+  return point;
+}
+
+internal::Size_Data* WriteSize(const gfx::Size& input, internal::Buffer* buf) {
+  internal::Size_Data* size = internal::Size_Data::New(buf);
+  size->width = input.width();
+  size->height = input.height();
+  return size;
+}
+
+internal::Rect_Data* WriteRect(const gfx::Rect& input, internal::Buffer* buf) {
+  internal::Rect_Data* rect = internal::Rect_Data::New(buf);
+  rect->x = input.x();
+  rect->y = input.y();
+  rect->width = input.width();
+  rect->height = input.height();
+  return rect;
+}
+
+internal::RectF_Data* WriteRectF(const gfx::RectF& input,
+                                 internal::Buffer* buf) {
+  internal::RectF_Data* rect = internal::RectF_Data::New(buf);
+  rect->x = input.x();
+  rect->y = input.y();
+  rect->width = input.width();
+  rect->height = input.height();
+  return rect;
+}
+
+internal::Transform_Data* WriteTransform(const gfx::Transform& input,
+                                         internal::Buffer* buf) {
+  internal::Transform_Data* transform = internal::Transform_Data::New(buf);
+  internal::Array_Data<float>* matrix =
+      internal::Array_Data<float>::New(16, buf);
+  input.matrix().asRowMajorf(matrix->storage());
+  transform->matrix.ptr = matrix;
+  return transform;
+}
+
+internal::MailboxHolder_Data* WriteMailboxHolder(
+    const gpu::MailboxHolder& input,
+    internal::Buffer* buf) {
+  internal::MailboxHolder_Data* holder = internal::MailboxHolder_Data::New(buf);
+  internal::Mailbox_Data* mailbox = internal::Mailbox_Data::New(buf);
+  holder->mailbox.ptr = mailbox;
+  internal::Array_Data<int8_t>* name =
+      internal::Array_Data<int8_t>::New(arraysize(input.mailbox.name), buf);
+  memcpy(name->storage(), input.mailbox.name, sizeof(input.mailbox.name));
+  mailbox->name.ptr = name;
+  holder->texture_target = input.texture_target;
+  holder->sync_point = input.sync_point;
+  return holder;
+}
+
+internal::TransferableResource_Data* WriteTransferableResource(
+    const cc::TransferableResource& input,
+    internal::Buffer* buf) {
+  internal::TransferableResource_Data* resource =
+      internal::TransferableResource_Data::New(buf);
+  resource->id = input.id;
+  resource->format = input.format;
+  resource->filter = input.filter;
+  resource->size.ptr = WriteSize(input.size, buf);
+  resource->mailbox_holder.ptr = WriteMailboxHolder(input.mailbox_holder, buf);
+  resource->is_repeated = input.is_repeated;
+  resource->is_software = input.is_software;
+  return resource;
+}
+
+internal::Quad_Data* WriteQuad(const cc::DrawQuad& input,
+                               uint32_t shared_quad_state_index,
+                               internal::Buffer* buf) {
+  internal::Quad_Data* quad = internal::Quad_Data::New(buf);
+  quad->material = input.material;
+  quad->rect.ptr = WriteRect(input.rect, buf);
+  quad->opaque_rect.ptr = WriteRect(input.opaque_rect, buf);
+  quad->visible_rect.ptr = WriteRect(input.visible_rect, buf);
+  quad->needs_blending = input.needs_blending;
+  quad->shared_quad_state_index = shared_quad_state_index;
+  switch (input.material) {
+    case cc::DrawQuad::RENDER_PASS: {
+      const cc::RenderPassDrawQuad* render_pass_quad =
+          cc::RenderPassDrawQuad::MaterialCast(&input);
+      internal::RenderPassQuadState_Data* pass_state =
+          internal::RenderPassQuadState_Data::New(buf);
+      quad->render_pass_quad_state.ptr = pass_state;
+      internal::RenderPassId_Data* pass_id =
+          internal::RenderPassId_Data::New(buf);
+      pass_id->layer_id = render_pass_quad->render_pass_id.layer_id;
+      pass_id->index = render_pass_quad->render_pass_id.index;
+      pass_state->render_pass_id.ptr = pass_id;
+      pass_state->mask_resource_id = render_pass_quad->mask_resource_id;
+      pass_state->mask_uv_scale.ptr = WritePointF(
+          gfx::PointAtOffsetFromOrigin(render_pass_quad->mask_uv_scale), buf);
+      pass_state->mask_texture_size.ptr =
+          WriteSize(render_pass_quad->mask_texture_size, buf);
+      // TODO(jamesr): filters
+      pass_state->filters_scale.ptr = WritePointF(
+          gfx::PointAtOffsetFromOrigin(render_pass_quad->filters_scale), buf);
+      // TODO(jamesr): background_filters
+      break;
+    }
+    case cc::DrawQuad::SOLID_COLOR: {
+      const cc::SolidColorDrawQuad* color_quad =
+          cc::SolidColorDrawQuad::MaterialCast(&input);
+      internal::SolidColorQuadState_Data* color_state =
+          internal::SolidColorQuadState_Data::New(buf);
+      quad->solid_color_quad_state.ptr = color_state;
+      color_state->color.ptr = WriteColor(color_quad->color, buf);
+      color_state->force_anti_aliasing_off =
+          color_quad->force_anti_aliasing_off;
+      break;
+    }
+    case cc::DrawQuad::SURFACE_CONTENT: {
+      const cc::SurfaceDrawQuad* surface_quad =
+          cc::SurfaceDrawQuad::MaterialCast(&input);
+      internal::SurfaceQuadState_Data* surface_state =
+          internal::SurfaceQuadState_Data::New(buf);
+      quad->surface_quad_state.ptr = surface_state;
+      internal::SurfaceId_Data* surface_id = internal::SurfaceId_Data::New(buf);
+      surface_id->local = static_cast<uint32_t>(surface_quad->surface_id.id);
+      surface_id->id_namespace =
+          cc::SurfaceIdAllocator::NamespaceForId(surface_quad->surface_id);
+      surface_state->surface.ptr = surface_id;
+      break;
+    }
+    case cc::DrawQuad::TEXTURE_CONTENT: {
+      const cc::TextureDrawQuad* texture_quad =
+          cc::TextureDrawQuad::MaterialCast(&input);
+      internal::TextureQuadState_Data* texture_state =
+          internal::TextureQuadState_Data::New(buf);
+      quad->texture_quad_state.ptr = texture_state;
+      texture_state->resource_id = texture_quad->resource_id;
+      texture_state->premultiplied_alpha = texture_quad->premultiplied_alpha;
+      texture_state->uv_top_left.ptr =
+          WritePointF(texture_quad->uv_top_left, buf);
+      texture_state->uv_bottom_right.ptr =
+          WritePointF(texture_quad->uv_bottom_right, buf);
+      texture_state->background_color.ptr =
+          WriteColor(texture_quad->background_color, buf);
+      internal::Array_Data<float>* vertex_opacity =
+          internal::Array_Data<float>::New(4, buf);
+      for (size_t i = 0; i < 4; ++i)
+        vertex_opacity->at(i) = texture_quad->vertex_opacity[i];
+      texture_state->vertex_opacity.ptr = vertex_opacity;
+      texture_state->flipped = texture_quad->flipped;
+      texture_state->nearest_neighbor = texture_quad->nearest_neighbor;
+      break;
+    }
+    case cc::DrawQuad::TILED_CONTENT: {
+      const cc::TileDrawQuad* tile_quad =
+          cc::TileDrawQuad::MaterialCast(&input);
+      internal::TileQuadState_Data* tile_state =
+          internal::TileQuadState_Data::New(buf);
+      quad->tile_quad_state.ptr = tile_state;
+      tile_state->tex_coord_rect.ptr =
+          WriteRectF(tile_quad->tex_coord_rect, buf);
+      tile_state->texture_size.ptr = WriteSize(tile_quad->texture_size, buf);
+      tile_state->swizzle_contents = tile_quad->swizzle_contents;
+      tile_state->resource_id = tile_quad->resource_id;
+      tile_state->nearest_neighbor = tile_quad->nearest_neighbor;
+      break;
+    }
+    case cc::DrawQuad::YUV_VIDEO_CONTENT: {
+      const cc::YUVVideoDrawQuad* yuv_quad =
+          cc::YUVVideoDrawQuad::MaterialCast(&input);
+      internal::YUVVideoQuadState_Data* yuv_state =
+          internal::YUVVideoQuadState_Data::New(buf);
+      quad->yuv_video_quad_state.ptr = yuv_state;
+      yuv_state->tex_coord_rect.ptr = WriteRectF(yuv_quad->tex_coord_rect, buf);
+      yuv_state->y_plane_resource_id = yuv_quad->y_plane_resource_id;
+      yuv_state->u_plane_resource_id = yuv_quad->u_plane_resource_id;
+      yuv_state->v_plane_resource_id = yuv_quad->v_plane_resource_id;
+      yuv_state->a_plane_resource_id = yuv_quad->a_plane_resource_id;
+      yuv_state->color_space = yuv_quad->color_space;
+      break;
+    }
+
+    default:
+      NOTREACHED() << "Unsupported material " << input.material;
+  }
+  return quad;
+}
+
+internal::SharedQuadState_Data* WriteSharedQuadState(
+    const cc::SharedQuadState& input,
+    internal::Buffer* buf) {
+  internal::SharedQuadState_Data* state =
+      internal::SharedQuadState_Data::New(buf);
+  state->content_to_target_transform.ptr =
+      WriteTransform(input.content_to_target_transform, buf);
+  state->content_bounds.ptr = WriteSize(input.content_bounds, buf);
+  state->visible_content_rect.ptr = WriteRect(input.visible_content_rect, buf);
+  state->clip_rect.ptr = WriteRect(input.clip_rect, buf);
+  state->is_clipped = input.is_clipped;
+  state->opacity = input.opacity;
+  state->blend_mode = input.blend_mode;
+  state->sorting_context_id = input.sorting_context_id;
+  return state;
+}
+
+internal::Pass_Data* WritePass(const cc::RenderPass& input,
+                               internal::Buffer* buf) {
+  internal::Pass_Data* pass = internal::Pass_Data::New(buf);
+  pass->id = input.id.index;
+  pass->output_rect.ptr = WriteRect(input.output_rect, buf);
+  pass->damage_rect.ptr = WriteRect(input.damage_rect, buf);
+  pass->transform_to_root_target.ptr =
+      WriteTransform(input.transform_to_root_target, buf);
+  pass->has_transparent_background = input.has_transparent_background;
+
+  internal::Array_Data<internal::Quad_Data*>* quads =
+      internal::Array_Data<internal::Quad_Data*>::New(input.quad_list.size(),
+                                                      buf);
+  pass->quads.ptr = quads;
+  // As in the |PassPtr| converter, a quad's shared quad state is the one after
+  // that of the previous quad if their states differ.
+  const cc::SharedQuadState* last_sqs = nullptr;
+  size_t sqs_index = 0;
+  for (auto iter = input.quad_list.cbegin(); iter != input.quad_list.cend();
+       ++iter) {
+    const cc::DrawQuad& quad = **iter;
+    if (quad.shared_quad_state != last_sqs) {
+      last_sqs = quad.shared_quad_state;
+      ++sqs_index;
+    }
+    DCHECK_LE(sqs_index - 1, UINT32_MAX);
+    quads->at(iter.index()) =
+        WriteQuad(quad, static_cast<uint32_t>(sqs_index - 1), buf);
+  }
+  // We should write all shared quad states.
+  DCHECK_EQ(sqs_index, input.shared_quad_state_list.size());
+
+  internal::Array_Data<internal::SharedQuadState_Data*>* shared_quad_states =
+      internal::Array_Data<internal::SharedQuadState_Data*>::New(
+          input.shared_quad_state_list.size(), buf);
+  pass->shared_quad_states.ptr = shared_quad_states;
+  for (auto iter = input.shared_quad_state_list.cbegin();
+       iter != input.shared_quad_state_list.cend(); ++iter) {
+    shared_quad_states->at(iter.index()) = WriteSharedQuadState(**iter, buf);
+  }
+  return pass;
+}
+
 }  // namespace
 
 // static
@@ -210,6 +739,15 @@ cc::SurfaceId TypeConverter<cc::SurfaceId, SurfaceIdPtr>::Convert(
   return cc::SurfaceId(packed_id);
 }
 
+// static
+cc::SurfaceId TypeConverter<cc::SurfaceId, SurfaceIdView>::Convert(
+    const SurfaceIdView& input) {
+  uint64_t packed_id = input.id_namespace();
+  packed_id <<= 32ull;
+  packed_id |= input.local();
+  return cc::SurfaceId(packed_id);
+}
+
 // static
 ColorPtr TypeConverter<ColorPtr, SkColor>::Convert(const SkColor& input) {
   ColorPtr color(Color::New());
@@ -222,6 +760,11 @@ SkColor TypeConverter<SkColor, ColorPtr>::Convert(const ColorPtr& input) {
   return input->rgba;
 }
 
+// static
+SkColor TypeConverter<SkColor, ColorView>::Convert(const ColorView& input) {
+  return input.rgba();
+}
+
 // static
 RenderPassIdPtr TypeConverter<RenderPassIdPtr, cc::RenderPassId>::Convert(
     const cc::RenderPassId& input) {
@@ -237,6 +780,12 @@ cc::RenderPassId TypeConverter<cc::RenderPassId, RenderPassIdPtr>::Convert(
   return cc::RenderPassId(input->layer_id, input->index);
 }
 
+// static
+cc::RenderPassId TypeConverter<cc::RenderPassId, RenderPassIdView>::Convert(
+    const RenderPassIdView& input) {
+  return cc::RenderPassId(input.layer_id(), input.index());
+}
+
 // static
 QuadPtr TypeConverter<QuadPtr, cc::DrawQuad>::Convert(
     const cc::DrawQuad& input) {
@@ -305,6 +854,7 @@ QuadPtr TypeConverter<QuadPtr, cc::DrawQuad>::Convert(
       }
       texture_state->vertex_opacity = vertex_opacity.Pass();
       texture_state->flipped = texture_quad->flipped;
+      texture_state->nearest_neighbor = texture_quad->nearest_neighbor;
       quad->texture_quad_state = texture_state.Pass();
       break;
     }
@@ -316,6 +866,7 @@ QuadPtr TypeConverter<QuadPtr, cc::DrawQuad>::Convert(
       tile_state->texture_size = Size::From(tile_quad->texture_size);
       tile_state->swizzle_contents = tile_quad->swizzle_contents;
       tile_state->resource_id = tile_quad->resource_id;
+      tile_state->nearest_neighbor = tile_quad->nearest_neighbor;
       quad->tile_quad_state = tile_state.Pass();
       break;
     }
@@ -411,7 +962,7 @@ TypeConverter<scoped_ptr<cc::RenderPass>, PassPtr>::Convert(
   cc::SharedQuadStateList::Iterator sqs_iter =
       pass->shared_quad_state_list.begin();
   for (size_t i = 0; i < input->quads.size(); ++i) {
-    QuadPtr quad = input->quads[i].Pass();
+    const QuadPtr& quad = input->quads[i];
     while (quad->shared_quad_state_index > sqs_iter.index()) {
       ++sqs_iter;
     }
@@ -421,6 +972,37 @@ TypeConverter<scoped_ptr<cc::RenderPass>, PassPtr>::Convert(
   return pass.Pass();
 }
 
+// static
+scoped_ptr<cc::RenderPass>
+TypeConverter<scoped_ptr<cc::RenderPass>, PassView>::Convert(
+    const PassView& input) {
+  ArrayView<SharedQuadStateView> shared_quad_states =
+      input.shared_quad_states();
+  ArrayView<QuadView> quads = input.quads();
+  scoped_ptr<cc::RenderPass> pass =
+      cc::RenderPass::Create(shared_quad_states.size(), quads.size());
+  pass->SetAll(cc::RenderPassId(1, input.id()),
+               ConvertTo<gfx::Rect>(input.output_rect()),
+               ConvertTo<gfx::Rect>(input.damage_rect()),
+               ConvertTo<gfx::Transform>(input.transform_to_root_target()),
+               input.has_transparent_background());
+  for (size_t i = 0; i < shared_quad_states.size(); ++i)
+    ConvertSharedQuadState(shared_quad_states[i], pass.get());
+  cc::SharedQuadStateList::Iterator sqs_iter =
+      pass->shared_quad_state_list.begin();
+  for (size_t i = 0; i < quads.size(); ++i) {
+    QuadView quad = quads[i];
+    if (quad.shared_quad_state_index() >= shared_quad_states.size())
+      return scoped_ptr<cc::RenderPass>();
+    while (quad.shared_quad_state_index() > sqs_iter.index()) {
+      ++sqs_iter;
+    }
+    if (!ConvertDrawQuad(quad, *sqs_iter, pass.get()))
+      return scoped_ptr<cc::RenderPass>();
+  }
+  return pass.Pass();
+}
+
 // static
 MailboxPtr TypeConverter<MailboxPtr, gpu::Mailbox>::Convert(
     const gpu::Mailbox& input) {
@@ -442,6 +1024,15 @@ gpu::Mailbox TypeConverter<gpu::Mailbox, MailboxPtr>::Convert(
   return mailbox;
 }
 
+// static
+gpu::Mailbox TypeConverter<gpu::Mailbox, MailboxView>::Convert(
+    const MailboxView& input) {
+  gpu::Mailbox mailbox;
+  if (!input.name().is_null())
+    mailbox.SetName(input.name().GetData_()->storage());
+  return mailbox;
+}
+
 // static
 MailboxHolderPtr TypeConverter<MailboxHolderPtr, gpu::MailboxHolder>::Convert(
     const gpu::MailboxHolder& input) {
@@ -462,6 +1053,17 @@ gpu::MailboxHolder TypeConverter<gpu::MailboxHolder, MailboxHolderPtr>::Convert(
   return holder;
 }
 
+// static
+gpu::MailboxHolder
+TypeConverter<gpu::MailboxHolder, MailboxHolderView>::Convert(
+    const MailboxHolderView& input) {
+  gpu::MailboxHolder holder;
+  holder.mailbox = ConvertTo<gpu::Mailbox>(input.mailbox());
+  holder.texture_target = input.texture_target();
+  holder.sync_point = input.sync_point();
+  return holder;
+}
+
 // static
 TransferableResourcePtr
 TypeConverter<TransferableResourcePtr, cc::TransferableResource>::Convert(
@@ -492,6 +1094,22 @@ TypeConverter<cc::TransferableResource, TransferableResourcePtr>::Convert(
   return transferable;
 }
 
+// static
+cc::TransferableResource
+TypeConverter<cc::TransferableResource, TransferableResourceView>::Convert(
+    const TransferableResourceView& input) {
+  cc::TransferableResource transferable;
+  transferable.id = input.id();
+  transferable.format = static_cast<cc::ResourceFormat>(input.format());
+  transferable.filter = input.filter();
+  transferable.size = ConvertTo<gfx::Size>(input.size());
+  transferable.mailbox_holder =
+      ConvertTo<gpu::MailboxHolder>(input.mailbox_holder());
+  transferable.is_repeated = input.is_repeated();
+  transferable.is_software = input.is_software();
+  return transferable;
+}
+
 // static
 Array<TransferableResourcePtr> TypeConverter<
     Array<TransferableResourcePtr>,
@@ -515,6 +1133,17 @@ TypeConverter<cc::TransferableResourceArray, Array<TransferableResourcePtr> >::
   return resources;
 }
 
+// static
+cc::TransferableResourceArray
+TypeConverter<cc::TransferableResourceArray,
+              ArrayView<TransferableResourceView>>::
+    Convert(const ArrayView<TransferableResourceView>& input) {
+  cc::TransferableResourceArray resources(input.size());
+  for (size_t i = 0; i < input.size(); ++i)
+    resources[i] = ConvertTo<cc::TransferableResource>(input[i]);
+  return resources;
+}
+
 // static
 ReturnedResourcePtr
 TypeConverter<ReturnedResourcePtr, cc::ReturnedResource>::Convert(
@@ -587,4 +1216,129 @@ TypeConverter<scoped_ptr<cc::CompositorFrame>, FramePtr>::Convert(
   return frame.Pass();
 }
 
+// static
+scoped_ptr<cc::CompositorFrame>
+TypeConverter<scoped_ptr<cc::CompositorFrame>, FrameView>::Convert(
+    const FrameView& input) {
+  scoped_ptr<cc::DelegatedFrameData> frame_data(new cc::DelegatedFrameData);
+  frame_data->device_scale_factor = 1.f;
+  frame_data->resource_list =
+      ConvertTo<cc::TransferableResourceArray>(input.resources());
+  ArrayView<PassView> passes = input.passes();
+  frame_data->render_pass_list.reserve(passes.size());
+  for (size_t i = 0; i < passes.size(); ++i) {
+    scoped_ptr<cc::RenderPass> pass =
+        ConvertTo<scoped_ptr<cc::RenderPass>>(passes[i]);
+    if (!pass)
+      return scoped_ptr<cc::CompositorFrame>();
+    frame_data->render_pass_list.push_back(pass.Pass());
+  }
+  scoped_ptr<cc::CompositorFrame> frame(new cc::CompositorFrame);
+  frame->delegated_frame_data = frame_data.Pass();
+  return frame.Pass();
+}
+
+CompositorFrameWriter::CompositorFrameWriter(const cc::CompositorFrame& frame)
+    : frame_(frame) {
+  DCHECK(frame_.delegated_frame_data);
+}
+
+CompositorFrameWriter::~CompositorFrameWriter() {
+}
+
+void CompositorFrameWriter::Serialize(internal::Buffer* buf,
+                                      internal::Frame_Data** output) const {
+  const cc::DelegatedFrameData* frame_data = frame_.delegated_frame_data.get();
+  internal::Frame_Data* frame = internal::Frame_Data::New(buf);
+
+  const cc::TransferableResourceArray& resource_list =
+      frame_data->resource_list;
+  internal::Array_Data<internal::TransferableResource_Data*>* resources =
+      internal::Array_Data<internal::TransferableResource_Data*>::New(
+          resource_list.size(), buf);
+  frame->resources.ptr = resources;
+  for (size_t i = 0; i < resource_list.size(); ++i)
+    resources->at(i) = WriteTransferableResource(resource_list[i], buf);
+
+  const cc::RenderPassList& pass_list = frame_data->render_pass_list;
+  internal::Array_Data<internal::Pass_Data*>* passes =
+      internal::Array_Data<internal::Pass_Data*>::New(pass_list.size(), buf);
+  frame->passes.ptr = passes;
+  for (size_t i = 0; i < pass_list.size(); ++i)
+    passes->at(i) = WritePass(*pass_list[i], buf);
+
+  *output = frame;
+}
+
+FrameDeltaPtr ComputeFrameDelta(const FramePtr& previous,
+                                const FramePtr& frame) {
+  FrameDeltaPtr delta = FrameDelta::New();
+  delta->resources = frame->resources.Clone();
+  delta->passes = Array<PassDeltaPtr>::New(frame->passes.size());
+  for (size_t i = 0; i < frame->passes.size(); ++i) {
+    const PassPtr& pass = frame->passes[i];
+    const Pass* previous_pass =
+        previous ? FindPass(previous->passes, pass->id) : nullptr;
+    PassDeltaPtr pass_delta = PassDelta::New();
+    pass_delta->id = pass->id;
+    pass_delta->output_rect = pass->output_rect.Clone();
+    pass_delta->damage_rect = pass->damage_rect.Clone();
+    pass_delta->transform_to_root_target =
+        pass->transform_to_root_target.Clone();
+    pass_delta->has_transparent_background = pass->has_transparent_background;
+    pass_delta->quad_count = static_cast<uint32_t>(pass->quads.size());
+    pass_delta->shared_quad_state_count =
+        static_cast<uint32_t>(pass->shared_quad_states.size());
+
+    pass_delta->quad_updates = Array<QuadUpdatePtr>::New(0);
+    for (size_t j = 0; j < pass->quads.size(); ++j) {
+      if (previous_pass && j < previous_pass->quads.size() &&
+          pass->quads[j].Equals(previous_pass->quads[j])) {
+        continue;
+      }
+      QuadUpdatePtr update = QuadUpdate::New();
+      update->index = static_cast<uint32_t>(j);
+      update->quad = pass->quads[j].Clone();
+      pass_delta->quad_updates.push_back(update.Pass());
+    }
+
+    pass_delta->shared_quad_state_updates =
+        Array<SharedQuadStateUpdatePtr>::New(0);
+    for (size_t j = 0; j < pass->shared_quad_states.size(); ++j) {
+      if (previous_pass && j < previous_pass->shared_quad_states.size() &&
+          pass->shared_quad_states[j].Equals(
+              previous_pass->shared_quad_states[j])) {
+        continue;
+      }
+      SharedQuadStateUpdatePtr update = SharedQuadStateUpdate::New();
+      update->index = static_cast<uint32_t>(j);
+      update->shared_quad_state = pass->shared_quad_states[j].Clone();
+      pass_delta->shared_quad_state_updates.push_back(update.Pass());
+    }
+    delta->passes[i] = pass_delta.Pass();
+  }
+  return delta.Pass();
+}
+
+scoped_ptr<cc::CompositorFrame> ConvertFrameDelta(
+    const FrameDeltaPtr& delta,
+    const cc::RenderPassList& previous_passes) {
+  scoped_ptr<cc::DelegatedFrameData> frame_data(new cc::DelegatedFrameData);
+  frame_data->device_scale_factor = 1.f;
+  frame_data->resource_list =
+      delta->resources.To<cc::TransferableResourceArray>();
+  frame_data->render_pass_list.reserve(delta->passes.size());
+  for (size_t i = 0; i < delta->passes.size(); ++i) {
+    const PassDeltaPtr& pass_delta = delta->passes[i];
+    scoped_ptr<cc::RenderPass> pass = ConvertPassDelta(
+        pass_delta, FindRenderPass(previous_passes, pass_delta->id));
+    if (!pass)
+      return scoped_ptr<cc::CompositorFrame>();
+    frame_data->render_pass_list.push_back(pass.Pass());
+  }
+  scoped_ptr<cc::CompositorFrame> frame(new cc::CompositorFrame);
+  frame->delegated_frame_data = frame_data.Pass();
+  return frame.Pass();
+}
+
 }  // namespace mojo
@@ -5,12 +5,15 @@
 #ifndef MOJO_CONVERTERS_SURFACES_SURFACES_TYPE_CONVERTERS_H_
 #define MOJO_CONVERTERS_SURFACES_SURFACES_TYPE_CONVERTERS_H_
 
+#include "base/macros.h"
 #include "base/memory/scoped_ptr.h"
+#include "cc/quads/render_pass.h"
 #include "cc/resources/returned_resource.h"
 #include "cc/resources/transferable_resource.h"
 #include "cc/surfaces/surface_id.h"
 #include "gpu/command_buffer/common/mailbox.h"
 #include "gpu/command_buffer/common/mailbox_holder.h"
+#include "mojo/public/cpp/bindings/struct_writer.h"
 #include "mojo/services/surfaces/public/interfaces/quads.mojom.h"
 #include "mojo/services/surfaces/public/interfaces/surface_id.mojom.h"
 #include "mojo/services/surfaces/public/interfaces/surfaces.mojom.h"
@@ -19,8 +22,6 @@
 namespace cc {
 class CompositorFrame;
 class DrawQuad;
-class RenderPass;
-class RenderPassId;
 class SharedQuadState;
 }  // namespace cc
 
@@ -35,6 +36,10 @@ template <>
 struct TypeConverter<cc::SurfaceId, SurfaceIdPtr> {
   static cc::SurfaceId Convert(const SurfaceIdPtr& input);
 };
+template <>
+struct TypeConverter<cc::SurfaceId, SurfaceIdView> {
+  static cc::SurfaceId Convert(const SurfaceIdView& input);
+};
 
 // Types from quads.mojom
 template <>
@@ -45,6 +50,10 @@ template <>
 struct TypeConverter<SkColor, ColorPtr> {
   static SkColor Convert(const ColorPtr& input);
 };
+template <>
+struct TypeConverter<SkColor, ColorView> {
+  static SkColor Convert(const ColorView& input);
+};
 
 template <>
 struct TypeConverter<RenderPassIdPtr, cc::RenderPassId> {
@@ -56,6 +65,11 @@ struct TypeConverter<cc::RenderPassId, RenderPassIdPtr> {
   static cc::RenderPassId Convert(const RenderPassIdPtr& input);
 };
 
+template <>
+struct TypeConverter<cc::RenderPassId, RenderPassIdView> {
+  static cc::RenderPassId Convert(const RenderPassIdView& input);
+};
+
 template <>
 struct TypeConverter<QuadPtr, cc::DrawQuad> {
   static QuadPtr Convert(const cc::DrawQuad& input);
@@ -76,6 +90,13 @@ struct TypeConverter<scoped_ptr<cc::RenderPass>, PassPtr> {
   static scoped_ptr<cc::RenderPass> Convert(const PassPtr& input);
 };
 
+// Builds the pass directly out of the message that |input| points into, without
+// deserializing it into a |PassPtr| first.
+template <>
+struct TypeConverter<scoped_ptr<cc::RenderPass>, PassView> {
+  static scoped_ptr<cc::RenderPass> Convert(const PassView& input);
+};
+
 // Types from surfaces.mojom
 template <>
 struct TypeConverter<MailboxPtr, gpu::Mailbox> {
@@ -85,6 +106,10 @@ template <>
 struct TypeConverter<gpu::Mailbox, MailboxPtr> {
   static gpu::Mailbox Convert(const MailboxPtr& input);
 };
+template <>
+struct TypeConverter<gpu::Mailbox, MailboxView> {
+  static gpu::Mailbox Convert(const MailboxView& input);
+};
 
 template <>
 struct TypeConverter<MailboxHolderPtr, gpu::MailboxHolder> {
@@ -94,6 +119,10 @@ template <>
 struct TypeConverter<gpu::MailboxHolder, MailboxHolderPtr> {
   static gpu::MailboxHolder Convert(const MailboxHolderPtr& input);
 };
+template <>
+struct TypeConverter<gpu::MailboxHolder, MailboxHolderView> {
+  static gpu::MailboxHolder Convert(const MailboxHolderView& input);
+};
 
 template <>
 struct TypeConverter<TransferableResourcePtr, cc::TransferableResource> {
@@ -103,6 +132,11 @@ template <>
 struct TypeConverter<cc::TransferableResource, TransferableResourcePtr> {
   static cc::TransferableResource Convert(const TransferableResourcePtr& input);
 };
+template <>
+struct TypeConverter<cc::TransferableResource, TransferableResourceView> {
+  static cc::TransferableResource Convert(
+      const TransferableResourceView& input);
+};
 
 template <>
 struct TypeConverter<Array<TransferableResourcePtr>,
@@ -116,6 +150,12 @@ struct TypeConverter<cc::TransferableResourceArray,
   static cc::TransferableResourceArray Convert(
       const Array<TransferableResourcePtr>& input);
 };
+template <>
+struct TypeConverter<cc::TransferableResourceArray,
+                     ArrayView<TransferableResourceView>> {
+  static cc::TransferableResourceArray Convert(
+      const ArrayView<TransferableResourceView>& input);
+};
 
 template <>
 struct TypeConverter<ReturnedResourcePtr, cc::ReturnedResource> {
@@ -142,6 +182,48 @@ struct TypeConverter<scoped_ptr<cc::CompositorFrame>, FramePtr> {
   static scoped_ptr<cc::CompositorFrame> Convert(const FramePtr& input);
 };
 
+// Builds the frame directly out of the message that |input| points into (like
+// the |PassView| converter). Returns null if the frame isn't valid.
+template <>
+struct TypeConverter<scoped_ptr<cc::CompositorFrame>, FrameView> {
+  static scoped_ptr<cc::CompositorFrame> Convert(const FrameView& input);
+};
+
+// Serializes a cc frame directly into a message, without building a
+// |FramePtr| (and a |QuadPtr| per quad) first. The result is the same as
+// serializing the |FramePtr| converted from the frame. |frame| must outlive
+// the writer. For example:
+//   surface->SubmitFrameWithWriters(id, CompositorFrameWriter(*frame), ...);
+class CompositorFrameWriter : public StructWriter<Frame> {
+ public:
+  explicit CompositorFrameWriter(const cc::CompositorFrame& frame);
+  ~CompositorFrameWriter() override;
+
+  // |StructWriter<Frame>|:
+  void Serialize(internal::Buffer* buf,
+                 internal::Frame_Data** output) const override;
+
+ private:
+  const cc::CompositorFrame& frame_;
+
+  DISALLOW_COPY_AND_ASSIGN(CompositorFrameWriter);
+};
+
+// Frame deltas (see FrameDelta in surfaces.mojom)
+
+// Returns the delta from |previous| (which may be null) to |frame|: the passes
+// of |frame| with only the quads and shared quad states that differ from those
+// of the pass with the same id in |previous|.
+FrameDeltaPtr ComputeFrameDelta(const FramePtr& previous,
+                                const FramePtr& frame);
+
+// Builds the frame described by |delta| relative to |previous_passes| (the
+// render passes of the previous frame), copying the quads and shared quad
+// states that didn't change from them. Returns null if |delta| isn't valid.
+scoped_ptr<cc::CompositorFrame> ConvertFrameDelta(
+    const FrameDeltaPtr& delta,
+    const cc::RenderPassList& previous_passes);
+
 }  // namespace mojo
 
 #endif  // MOJO_CONVERTERS_SURFACES_SURFACES_TYPE_CONVERTERS_H_
@@ -2,14 +2,24 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
+#include <vector>
+
+#include "cc/output/compositor_frame.h"
+#include "cc/output/delegated_frame_data.h"
 #include "cc/quads/render_pass.h"
+#include "cc/quads/render_pass_draw_quad.h"
 #include "cc/quads/solid_color_draw_quad.h"
 #include "cc/quads/surface_draw_quad.h"
 #include "cc/quads/texture_draw_quad.h"
+#include "cc/quads/tile_draw_quad.h"
 #include "gpu/command_buffer/common/mailbox.h"
 #include "gpu/command_buffer/common/mailbox_holder.h"
 #include "mojo/converters/geometry/geometry_type_converters.h"
 #include "mojo/converters/surfaces/surfaces_type_converters.h"
+#include "mojo/public/cpp/bindings/lib/chunked_buffer.h"
+#include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/skia/include/core/SkColor.h"
 #include "third_party/skia/include/core/SkXfermode.h"
@@ -17,6 +27,62 @@
 namespace mojo {
 namespace {
 
+// Returns a frame with one pass of solid color quads of the given |colors|, the
+// first half of them with one shared quad state and the rest with another.
+FramePtr MakeSolidColorFrame(const std::vector<SkColor>& colors) {
+  scoped_ptr<cc::RenderPass> pass = cc::RenderPass::Create();
+  gfx::Rect output_rect(0, 0, 100, 100);
+  pass->SetAll(cc::RenderPassId(1, 1), output_rect, output_rect,
+               gfx::Transform(), false);
+  cc::SharedQuadState* sqs = nullptr;
+  for (size_t i = 0; i < colors.size(); ++i) {
+    if (i == 0 || i == colors.size() / 2) {
+      sqs = pass->CreateAndAppendSharedQuadState();
+      sqs->SetAll(gfx::Transform(), output_rect.size(), output_rect,
+                  output_rect, false, 1.f, ::SkXfermode::kSrcOver_Mode, 0);
+      sqs->opacity = (i == 0) ? 1.f : 0.5f;
+    }
+    cc::SolidColorDrawQuad* color_quad =
+        pass->CreateAndAppendDrawQuad<cc::SolidColorDrawQuad>();
+    gfx::Rect rect(static_cast<int>(i), 0, 1, 1);
+    color_quad->SetAll(sqs, rect, rect, rect, false, colors[i], false);
+  }
+
+  cc::CompositorFrame frame;
+  frame.delegated_frame_data.reset(new cc::DelegatedFrameData);
+  frame.delegated_frame_data->render_pass_list.push_back(pass.Pass());
+  return Frame::From(frame);
+}
+
+// Expects |pass| to have the solid color quads of |colors|, with shared quad
+// states like those of |MakeSolidColorFrame()|.
+void ExpectSolidColorPass(const std::vector<SkColor>& colors,
+                          const cc::RenderPass& pass) {
+  ASSERT_EQ(colors.size(), pass.quad_list.size());
+  ASSERT_EQ(2u, pass.shared_quad_state_list.size());
+  for (size_t i = 0; i < colors.size(); ++i) {
+    const cc::DrawQuad* quad = pass.quad_list.ElementAt(i);
+    ASSERT_EQ(cc::DrawQuad::SOLID_COLOR, quad->material);
+    EXPECT_EQ(colors[i], cc::SolidColorDrawQuad::MaterialCast(quad)->color);
+    EXPECT_EQ(gfx::Rect(static_cast<int>(i), 0, 1, 1), quad->rect);
+    EXPECT_EQ(pass.shared_quad_state_list.ElementAt(i < colors.size() / 2 ? 0
+                                                                          : 1),
+              quad->shared_quad_state);
+  }
+}
+
+// Serializes |frame| into |buf| and then encodes and decodes the pointers in it
+// (as would happen when sending it in a message), returning a view of it.
+FrameView SerializeAndDecode(FramePtr frame, internal::FixedBuffer* buf) {
+  internal::Frame_Data* data = nullptr;
+  Serialize_(frame.Pass(), buf, &data);
+
+  std::vector<Handle> handles;
+  data->EncodePointersAndHandles(&handles);
+  data->DecodePointersAndHandles(&handles);
+  return FrameView(data);
+}
+
 TEST(SurfaceLibTest, SurfaceIdConverterNullId) {
   cc::SurfaceId null_id;
   cc::SurfaceId round_trip = SurfaceId::From(null_id).To<cc::SurfaceId>();
@@ -460,5 +526,246 @@ TEST(SurfaceLibTest, ReturnedResource) {
   EXPECT_EQ(lost, round_trip_resource.lost);
 }
 
+TEST(SurfaceLibTest, FrameDelta) {
+  std::vector<SkColor> previous_colors(8, SK_ColorRED);
+  FramePtr previous_frame = MakeSolidColorFrame(previous_colors);
+  scoped_ptr<cc::CompositorFrame> previous_cc_frame =
+      previous_frame.To<scoped_ptr<cc::CompositorFrame>>();
+  ASSERT_TRUE(previous_cc_frame);
+  const cc::RenderPassList& previous_passes =
+      previous_cc_frame->delegated_frame_data->render_pass_list;
+
+  // Change a quad and add one at the end.
+  std::vector<SkColor> colors(previous_colors);
+  colors[2] = SK_ColorGREEN;
+  colors.push_back(SK_ColorBLUE);
+  FramePtr frame = MakeSolidColorFrame(colors);
+
+  FrameDeltaPtr delta = ComputeFrameDelta(previous_frame, frame);
+  ASSERT_EQ(1u, delta->passes.size());
+  const PassDeltaPtr& pass_delta = delta->passes[0];
+  EXPECT_EQ(1, pass_delta->id);
+  EXPECT_EQ(9u, pass_delta->quad_count);
+  EXPECT_EQ(2u, pass_delta->shared_quad_state_count);
+  ASSERT_EQ(2u, pass_delta->quad_updates.size());
+  EXPECT_EQ(2u, pass_delta->quad_updates[0]->index);
+  EXPECT_EQ(8u, pass_delta->quad_updates[1]->index);
+  EXPECT_EQ(0u, pass_delta->shared_quad_state_updates.size());
+
+  scoped_ptr<cc::CompositorFrame> cc_frame =
+      ConvertFrameDelta(delta, previous_passes);
+  ASSERT_TRUE(cc_frame);
+  const cc::RenderPassList& passes =
+      cc_frame->delegated_frame_data->render_pass_list;
+  ASSERT_EQ(1u, passes.size());
+  EXPECT_EQ(cc::RenderPassId(1, 1), passes[0]->id);
+  ExpectSolidColorPass(colors, *passes[0]);
+
+  // Without a previous frame, the delta has the whole frame.
+  delta = ComputeFrameDelta(FramePtr(), frame);
+  ASSERT_EQ(1u, delta->passes.size());
+  EXPECT_EQ(9u, delta->passes[0]->quad_updates.size());
+  EXPECT_EQ(2u, delta->passes[0]->shared_quad_state_updates.size());
+  cc_frame = ConvertFrameDelta(delta, cc::RenderPassList());
+  ASSERT_TRUE(cc_frame);
+  ExpectSolidColorPass(colors,
+                       *cc_frame->delegated_frame_data->render_pass_list[0]);
+}
+
+TEST(SurfaceLibTest, FrameDeltaRemovesQuads) {
+  std::vector<SkColor> previous_colors(8, SK_ColorRED);
+  FramePtr previous_frame = MakeSolidColorFrame(previous_colors);
+  scoped_ptr<cc::CompositorFrame> previous_cc_frame =
+      previous_frame.To<scoped_ptr<cc::CompositorFrame>>();
+  ASSERT_TRUE(previous_cc_frame);
+
+  // The second shared quad state moves to the fourth quad: the quads after it
+  // are unchanged.
+  std::vector<SkColor> colors(previous_colors.begin(),
+                              previous_colors.begin() + 6);
+  FramePtr frame = MakeSolidColorFrame(colors);
+  FrameDeltaPtr delta = ComputeFrameDelta(previous_frame, frame);
+  ASSERT_EQ(1u, delta->passes.size());
+  EXPECT_EQ(6u, delta->passes[0]->quad_count);
+  EXPECT_EQ(1u, delta->passes[0]->quad_updates.size());
+  EXPECT_EQ(3u, delta->passes[0]->quad_updates[0]->index);
+
+  scoped_ptr<cc::CompositorFrame> cc_frame = ConvertFrameDelta(
+      delta, previous_cc_frame->delegated_frame_data->render_pass_list);
+  ASSERT_TRUE(cc_frame);
+  ExpectSolidColorPass(colors,
+                       *cc_frame->delegated_frame_data->render_pass_list[0]);
+}
+
+TEST(SurfaceLibTest, FrameDeltaInvalid) {
+  std::vector<SkColor> colors(4, SK_ColorRED);
+  FramePtr previous_frame = MakeSolidColorFrame(colors);
+  scoped_ptr<cc::CompositorFrame> previous_cc_frame =
+      previous_frame.To<scoped_ptr<cc::CompositorFrame>>();
+  ASSERT_TRUE(previous_cc_frame);
+  const cc::RenderPassList& previous_passes =
+      previous_cc_frame->delegated_frame_data->render_pass_list;
+
+  // A quad past the end of the previous pass that isn't updated.
+  FrameDeltaPtr delta = ComputeFrameDelta(previous_frame, previous_frame);
+  delta->passes[0]->quad_count++;
+  EXPECT_FALSE(ConvertFrameDelta(delta, previous_passes));
+
+  // An update past the end of the pass.
+  delta = ComputeFrameDelta(FramePtr(), previous_frame);
+  delta->passes[0]->quad_updates[0]->index = 4u;
+  EXPECT_FALSE(ConvertFrameDelta(delta, previous_passes));
+
+  // A quad referring to a shared quad state before the previous quad's.
+  delta = ComputeFrameDelta(FramePtr(), previous_frame);
+  delta->passes[0]->quad_updates[3]->quad->shared_quad_state_index = 0u;
+  delta->passes[0]->quad_updates[2]->quad->shared_quad_state_index = 1u;
+  EXPECT_FALSE(ConvertFrameDelta(delta, previous_passes));
+
+  // A delta for a pass that the previous frame didn't have.
+  delta = ComputeFrameDelta(previous_frame, previous_frame);
+  delta->passes[0]->id = 2;
+  EXPECT_FALSE(ConvertFrameDelta(delta, previous_passes));
+}
+
+// Returns a frame with two passes, quads of most materials and a resource.
+scoped_ptr<cc::CompositorFrame> MakeTestFrame() {
+  scoped_ptr<cc::RenderPass> child_pass = cc::RenderPass::Create();
+  child_pass->SetAll(cc::RenderPassId(1, 1), gfx::Rect(0, 0, 20, 20),
+                     gfx::Rect(0, 0, 5, 5), gfx::Transform(), true);
+  cc::SharedQuadState* sqs = child_pass->CreateAndAppendSharedQuadState();
+  gfx::Transform content_to_target_transform;
+  content_to_target_transform.Scale3d(0.3f, 0.7f, 0.9f);
+  sqs->SetAll(content_to_target_transform, gfx::Size(57, 39),
+              gfx::Rect(3, 7, 28, 42), gfx::Rect(9, 12, 21, 31), true, 0.65f,
+              ::SkXfermode::kSrcOver_Mode, 13);
+  gfx::Rect rect(5, 7, 13, 19);
+  gfx::Rect visible_rect(9, 11, 5, 7);
+  cc::TextureDrawQuad* texture_quad =
+      child_pass->CreateAndAppendDrawQuad<cc::TextureDrawQuad>();
+  float vertex_opacity[4] = {0.1f, 0.5f, 0.4f, 0.8f};
+  texture_quad->SetAll(sqs, rect, rect, visible_rect, true, 9, true,
+                       gfx::PointF(1.7f, 2.1f), gfx::PointF(-7.f, 16.3f),
+                       SK_ColorYELLOW, vertex_opacity, false, false);
+  cc::TileDrawQuad* tile_quad =
+      child_pass->CreateAndAppendDrawQuad<cc::TileDrawQuad>();
+  tile_quad->SetAll(sqs, rect, rect, visible_rect, false, 10,
+                    gfx::RectF(0.f, 0.5f, 1.f, 0.5f), gfx::Size(256, 256),
+                    true, true);
+
+  scoped_ptr<cc::RenderPass> root_pass = cc::RenderPass::Create();
+  root_pass->SetAll(cc::RenderPassId(1, 2), gfx::Rect(0, 0, 100, 100),
+                    gfx::Rect(0, 0, 100, 100), gfx::Transform(), false);
+  sqs = root_pass->CreateAndAppendSharedQuadState();
+  sqs->SetAll(gfx::Transform(), gfx::Size(100, 100), gfx::Rect(0, 0, 100, 100),
+              gfx::Rect(0, 0, 100, 100), false, 1.f,
+              ::SkXfermode::kSrcOver_Mode, 0);
+  cc::RenderPassDrawQuad* render_pass_quad =
+      root_pass->CreateAndAppendDrawQuad<cc::RenderPassDrawQuad>();
+  render_pass_quad->SetAll(sqs, rect, rect, visible_rect, true,
+                           child_pass->id, 0, gfx::Vector2dF(1.f, 1.f),
+                           gfx::Size(), cc::FilterOperations(),
+                           gfx::Vector2dF(2.f, 2.f), cc::FilterOperations());
+  sqs = root_pass->CreateAndAppendSharedQuadState();
+  sqs->SetAll(gfx::Transform(), gfx::Size(100, 100), gfx::Rect(0, 0, 50, 50),
+              gfx::Rect(0, 0, 50, 50), true, 0.5f,
+              ::SkXfermode::kMultiply_Mode, 1);
+  cc::SolidColorDrawQuad* color_quad =
+      root_pass->CreateAndAppendDrawQuad<cc::SolidColorDrawQuad>();
+  color_quad->SetAll(sqs, rect, rect, visible_rect, false, SK_ColorGREEN,
+                     true);
+  cc::SurfaceDrawQuad* surface_quad =
+      root_pass->CreateAndAppendDrawQuad<cc::SurfaceDrawQuad>();
+  surface_quad->SetAll(sqs, rect, rect, visible_rect, false,
+                       cc::SurfaceId(5));
+
+  scoped_ptr<cc::CompositorFrame> frame(new cc::CompositorFrame);
+  frame->delegated_frame_data.reset(new cc::DelegatedFrameData);
+  cc::TransferableResource resource;
+  resource.id = 9;
+  resource.format = cc::RGBA_8888;
+  resource.size = gfx::Size(13, 19);
+  resource.mailbox_holder.mailbox.name[0] = 7;
+  resource.mailbox_holder.texture_target = 3;
+  resource.mailbox_holder.sync_point = 21;
+  frame->delegated_frame_data->resource_list.push_back(resource);
+  frame->delegated_frame_data->render_pass_list.push_back(child_pass.Pass());
+  frame->delegated_frame_data->render_pass_list.push_back(root_pass.Pass());
+  return frame.Pass();
+}
+
+// Tests that converting a frame directly from the message gives the same frame
+// as deserializing it and converting that.
+TEST(SurfaceLibTest, FrameView) {
+  scoped_ptr<cc::CompositorFrame> frame = MakeTestFrame();
+  FramePtr mojo_frame = Frame::From(*frame);
+  scoped_ptr<cc::CompositorFrame> expected_frame =
+      mojo_frame.To<scoped_ptr<cc::CompositorFrame>>();
+  ASSERT_TRUE(expected_frame);
+
+  internal::FixedBuffer buf(GetSerializedSize_(mojo_frame));
+  scoped_ptr<cc::CompositorFrame> view_frame =
+      ConvertTo<scoped_ptr<cc::CompositorFrame>>(
+          SerializeAndDecode(mojo_frame.Clone(), &buf));
+  ASSERT_TRUE(view_frame);
+
+  // Everything that the converters keep should be the same.
+  EXPECT_TRUE(Frame::From(*view_frame).Equals(Frame::From(*expected_frame)));
+  EXPECT_TRUE(Frame::From(*view_frame).Equals(mojo_frame));
+  const cc::RenderPassList& passes =
+      view_frame->delegated_frame_data->render_pass_list;
+  ASSERT_EQ(2u, passes.size());
+  EXPECT_EQ(passes[1]->shared_quad_state_list.ElementAt(1),
+            passes[1]->quad_list.ElementAt(2)->shared_quad_state);
+  const cc::TransferableResourceArray& resources =
+      view_frame->delegated_frame_data->resource_list;
+  ASSERT_EQ(1u, resources.size());
+  const cc::TransferableResource& resource =
+      frame->delegated_frame_data->resource_list[0];
+  EXPECT_EQ(resource.mailbox_holder.mailbox,
+            resources[0].mailbox_holder.mailbox);
+}
+
+// Tests that writing a frame directly into a message gives the same bytes as
+// converting it to a |FramePtr| and serializing that.
+TEST(SurfaceLibTest, CompositorFrameWriter) {
+  scoped_ptr<cc::CompositorFrame> frame = MakeTestFrame();
+  FramePtr mojo_frame = Frame::From(*frame);
+  size_t size = GetSerializedSize_(mojo_frame);
+  std::vector<Handle> handles;
+
+  internal::ChunkedBuffer expected_buf(size);
+  internal::Frame_Data* expected = nullptr;
+  Serialize_(mojo_frame.Pass(), &expected_buf, &expected);
+  expected->EncodePointersAndHandles(&handles);
+
+  internal::ChunkedBuffer buf(size);
+  internal::Frame_Data* data = nullptr;
+  CompositorFrameWriter(*frame).Serialize(&buf, &data);
+  data->EncodePointersAndHandles(&handles);
+
+  ASSERT_EQ(expected_buf.size(), buf.size());
+  EXPECT_EQ(0, memcmp(expected, data, buf.size()));
+  EXPECT_TRUE(handles.empty());
+}
+
+TEST(SurfaceLibTest, FrameViewInvalid) {
+  std::vector<SkColor> colors(4, SK_ColorRED);
+
+  // A quad referring to a shared quad state past the end of the pass.
+  FramePtr frame = MakeSolidColorFrame(colors);
+  frame->passes[0]->quads[3]->shared_quad_state_index = 2u;
+  internal::FixedBuffer buf(GetSerializedSize_(frame));
+  EXPECT_FALSE(ConvertTo<scoped_ptr<cc::CompositorFrame>>(
+      SerializeAndDecode(frame.Pass(), &buf)));
+
+  // A quad without the state for its material.
+  frame = MakeSolidColorFrame(colors);
+  frame->passes[0]->quads[0]->solid_color_quad_state.reset();
+  internal::FixedBuffer buf2(GetSerializedSize_(frame));
+  EXPECT_FALSE(ConvertTo<scoped_ptr<cc::CompositorFrame>>(
+      SerializeAndDecode(frame.Pass(), &buf2)));
+}
+
 }  // namespace
 }  // namespace mojo
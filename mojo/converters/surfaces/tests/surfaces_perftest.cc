@@ -0,0 +1,225 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/strings/stringprintf.h"
+#include "base/timer/elapsed_timer.h"
+#include "cc/output/compositor_frame.h"
+#include "cc/output/delegated_frame_data.h"
+#include "cc/quads/render_pass.h"
+#include "cc/quads/solid_color_draw_quad.h"
+#include "cc/quads/texture_draw_quad.h"
+#include "mojo/converters/geometry/geometry_type_converters.h"
+#include "mojo/converters/surfaces/surfaces_type_converters.h"
+#include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
+#include "mojo/public/cpp/test_support/test_support.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/skia/include/core/SkColor.h"
+#include "third_party/skia/include/core/SkXfermode.h"
+
+namespace mojo {
+namespace {
+
+// The number of quads that share each shared quad state.
+const size_t kQuadsPerSharedQuadState = 16;
+
+// Returns a frame like that of a UI: one pass of |num_quads| texture and solid
+// color quads, the last of which (the "cursor") is at |cursor_x|.
+FramePtr MakeFrame(size_t num_quads, int cursor_x) {
+  scoped_ptr<cc::RenderPass> pass = cc::RenderPass::Create();
+  gfx::Rect output_rect(0, 0, 1920, 1080);
+  pass->SetAll(cc::RenderPassId(1, 1), output_rect, output_rect,
+               gfx::Transform(), false);
+  cc::SharedQuadState* sqs = nullptr;
+  const float vertex_opacity[4] = {1.f, 1.f, 1.f, 1.f};
+  for (size_t i = 0; i < num_quads; ++i) {
+    if (i % kQuadsPerSharedQuadState == 0) {
+      sqs = pass->CreateAndAppendSharedQuadState();
+      gfx::Transform transform;
+      transform.Translate(static_cast<float>(i), 0.f);
+      sqs->SetAll(transform, output_rect.size(), output_rect, output_rect,
+                  false, 1.f, ::SkXfermode::kSrcOver_Mode, 0);
+    }
+    int x = (i == num_quads - 1) ? cursor_x : static_cast<int>(i % 1920);
+    gfx::Rect rect(x, static_cast<int>(i / 1920) * 16, 16, 16);
+    if (i % 2) {
+      cc::SolidColorDrawQuad* color_quad =
+          pass->CreateAndAppendDrawQuad<cc::SolidColorDrawQuad>();
+      color_quad->SetAll(sqs, rect, rect, rect, false, SK_ColorBLUE, false);
+    } else {
+      cc::TextureDrawQuad* texture_quad =
+          pass->CreateAndAppendDrawQuad<cc::TextureDrawQuad>();
+      texture_quad->SetAll(sqs, rect, rect, rect, true,
+                           static_cast<unsigned>(i + 1), true,
+                           gfx::PointF(0.f, 0.f), gfx::PointF(1.f, 1.f),
+                           SK_ColorTRANSPARENT, vertex_opacity, false, false);
+    }
+  }
+
+  cc::CompositorFrame frame;
+  frame.delegated_frame_data.reset(new cc::DelegatedFrameData);
+  frame.delegated_frame_data->render_pass_list.push_back(pass.Pass());
+  return Frame::From(frame);
+}
+
+// Measures submitting |num_frames| frames of |num_quads| quads in which only
+// the cursor moves, as whole frames and as frame deltas: the serialized size
+// of each, the time for the client to compute the delta, and the time for the
+// surfaces service to convert the frame (including keeping a copy of its
+// render passes for the next delta, as the service does for surfaces that are
+// sent deltas).
+void MeasureFrameDelta(size_t num_quads, size_t num_frames) {
+  std::string test_name = base::StringPrintf(
+      "SurfacesFrameDelta_%uquads", static_cast<unsigned>(num_quads));
+
+  FramePtr previous_frame = MakeFrame(num_quads, 0);
+  FramePtr frame = MakeFrame(num_quads, 1);
+  FrameDeltaPtr delta = ComputeFrameDelta(previous_frame, frame);
+  test::LogPerfResult(test_name.c_str(), "FrameBytes",
+                      static_cast<double>(GetSerializedSize_(frame)),
+                      "bytes/frame");
+  test::LogPerfResult(test_name.c_str(), "FrameDeltaBytes",
+                      static_cast<double>(GetSerializedSize_(delta)),
+                      "bytes/frame");
+
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < num_frames; ++i)
+      delta = ComputeFrameDelta(previous_frame, frame);
+    test::LogPerfResult(
+        test_name.c_str(), "ComputeFrameDelta",
+        static_cast<double>(timer.Elapsed().InMicroseconds()) / num_frames,
+        "us/frame");
+  }
+
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < num_frames; ++i) {
+      scoped_ptr<cc::CompositorFrame> cc_frame =
+          frame.To<scoped_ptr<cc::CompositorFrame>>();
+      CHECK(cc_frame);
+    }
+    test::LogPerfResult(
+        test_name.c_str(), "ConvertFrame",
+        static_cast<double>(timer.Elapsed().InMicroseconds()) / num_frames,
+        "us/frame");
+  }
+
+  scoped_ptr<cc::CompositorFrame> previous_cc_frame =
+      previous_frame.To<scoped_ptr<cc::CompositorFrame>>();
+  base::ElapsedTimer timer;
+  for (size_t i = 0; i < num_frames; ++i) {
+    scoped_ptr<cc::CompositorFrame> cc_frame = ConvertFrameDelta(
+        delta, previous_cc_frame->delegated_frame_data->render_pass_list);
+    CHECK(cc_frame);
+    cc::RenderPassList passes;
+    cc::RenderPass::CopyAll(cc_frame->delegated_frame_data->render_pass_list,
+                            &passes);
+  }
+  test::LogPerfResult(
+      test_name.c_str(), "ConvertFrameDelta",
+      static_cast<double>(timer.Elapsed().InMicroseconds()) / num_frames,
+      "us/frame");
+}
+
+// Serializes |frame| into |buf| and then encodes and decodes the pointers in it
+// (as would happen when sending it in a message), returning the result.
+internal::Frame_Data* SerializeAndDecode(FramePtr frame,
+                                         internal::FixedBuffer* buf) {
+  internal::Frame_Data* data = nullptr;
+  Serialize_(frame.Pass(), buf, &data);
+
+  std::vector<Handle> handles;
+  data->EncodePointersAndHandles(&handles);
+  data->DecodePointersAndHandles(&handles);
+  return data;
+}
+
+// Measures round trips of a frame of |num_quads| quads: the time for the client
+// to serialize a cc frame, by converting it and serializing the result and by
+// writing it directly into the message (see |CompositorFrameWriter|), and for
+// the surfaces service to get a cc frame from the message, by deserializing it
+// and converting the result and by converting it directly out of the message
+// (see |FrameView|).
+void MeasureFrameRoundTrip(size_t num_quads, size_t num_frames) {
+  std::string test_name = base::StringPrintf(
+      "SurfacesFrameRoundTrip_%uquads", static_cast<unsigned>(num_quads));
+
+  FramePtr frame = MakeFrame(num_quads, 0);
+  scoped_ptr<cc::CompositorFrame> cc_frame =
+      frame.To<scoped_ptr<cc::CompositorFrame>>();
+  const size_t size = GetSerializedSize_(frame);
+
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < num_frames; ++i) {
+      FramePtr client_frame = Frame::From(*cc_frame);
+      internal::FixedBuffer buf(size);
+      internal::Frame_Data* data = nullptr;
+      Serialize_(client_frame.Pass(), &buf, &data);
+    }
+    test::LogPerfResult(
+        test_name.c_str(), "Serialize",
+        static_cast<double>(timer.Elapsed().InMicroseconds()) / num_frames,
+        "us/frame");
+  }
+
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < num_frames; ++i) {
+      internal::FixedBuffer buf(size);
+      internal::Frame_Data* data = nullptr;
+      CompositorFrameWriter(*cc_frame).Serialize(&buf, &data);
+    }
+    test::LogPerfResult(
+        test_name.c_str(), "Write",
+        static_cast<double>(timer.Elapsed().InMicroseconds()) / num_frames,
+        "us/frame");
+  }
+
+  internal::FixedBuffer buf(size);
+  internal::Frame_Data* data = SerializeAndDecode(frame.Pass(), &buf);
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < num_frames; ++i) {
+      FramePtr service_frame;
+      Deserialize_(data, &service_frame);
+      CHECK(service_frame.To<scoped_ptr<cc::CompositorFrame>>());
+    }
+    test::LogPerfResult(
+        test_name.c_str(), "DeserializeAndConvert",
+        static_cast<double>(timer.Elapsed().InMicroseconds()) / num_frames,
+        "us/frame");
+  }
+
+  base::ElapsedTimer timer;
+  for (size_t i = 0; i < num_frames; ++i)
+    CHECK(ConvertTo<scoped_ptr<cc::CompositorFrame>>(FrameView(data)));
+  test::LogPerfResult(
+      test_name.c_str(), "ConvertView",
+      static_cast<double>(timer.Elapsed().InMicroseconds()) / num_frames,
+      "us/frame");
+}
+
+TEST(SurfacesPerfTest, FrameDelta) {
+  const size_t kNumQuads[] = {100, 1000, 5000};
+  const size_t kNumFrames = 200;
+
+  for (size_t num_quads : kNumQuads)
+    MeasureFrameDelta(num_quads, kNumFrames);
+}
+
+TEST(SurfacesPerfTest, FrameRoundTrip) {
+  const size_t kNumQuads[] = {100, 1000, 5000};
+  const size_t kNumFrames = 200;
+
+  for (size_t num_quads : kNumQuads)
+    MeasureFrameRoundTrip(num_quads, kNumFrames);
+}
+
+}  // namespace
+}  // namespace mojo
@@ -60,6 +60,20 @@ struct Configuration {
   // (This will also entail some auditing to make sure I'm not messing up my
   // checks anywhere.)
   size_t max_shared_memory_num_bytes;
+
+  // Minimum size of a message (including its header and any serialized
+  // dispatchers), in bytes, for which a |RawChannel| will send the message's
+  // contents in a shared memory segment (rather than writing them to the
+  // underlying OS "pipe"). Messages with platform handles attached are always
+  // sent inline. Zero disables this. The default is 256KB.
+  size_t min_shared_memory_message_num_bytes;
+
+  // Minimum capacity of a data pipe, in bytes, for which the data pipe's
+  // circular buffer will be placed in shared memory (mapped by both the
+  // producer and the consumer) once one of its handles is sent over a
+  // |Channel|. In that case, only the amounts of data written and consumed are
+  // sent as messages. Zero disables this. The default is 64KB.
+  size_t min_shared_memory_data_pipe_capacity_bytes;
 };
 
 }  // namespace embedder
@@ -257,4 +257,44 @@ MojoResult MojoSystemImplUnmapBuffer(MojoSystemImpl system, void* buffer) {
   return core->UnmapBuffer(MakeUserPointer(buffer));
 }
 
+MojoResult MojoSystemImplCreateWaitSet(
+    MojoSystemImpl system,
+    const MojoCreateWaitSetOptions* options,
+    MojoHandle* wait_set_handle) {
+  mojo::system::Core* core = static_cast<mojo::system::Core*>(system);
+  DCHECK(core);
+  return core->CreateWaitSet(MakeUserPointer(options),
+                             MakeUserPointer(wait_set_handle));
+}
+
+MojoResult MojoSystemImplWaitSetAdd(MojoSystemImpl system,
+                                    MojoHandle wait_set_handle,
+                                    MojoHandle handle,
+                                    MojoHandleSignals signals,
+                                    uint64_t cookie) {
+  mojo::system::Core* core = static_cast<mojo::system::Core*>(system);
+  DCHECK(core);
+  return core->WaitSetAdd(wait_set_handle, handle, signals, cookie);
+}
+
+MojoResult MojoSystemImplWaitSetRemove(MojoSystemImpl system,
+                                       MojoHandle wait_set_handle,
+                                       uint64_t cookie) {
+  mojo::system::Core* core = static_cast<mojo::system::Core*>(system);
+  DCHECK(core);
+  return core->WaitSetRemove(wait_set_handle, cookie);
+}
+
+MojoResult MojoSystemImplWaitSetWait(MojoSystemImpl system,
+                                     MojoHandle wait_set_handle,
+                                     MojoDeadline deadline,
+                                     uint32_t* num_results,
+                                     MojoWaitSetResult* results) {
+  mojo::system::Core* core = static_cast<mojo::system::Core*>(system);
+  DCHECK(core);
+  return core->WaitSetWait(wait_set_handle, deadline,
+                           MakeUserPointer(num_results),
+                           MakeUserPointer(results));
+}
+
 }  // extern "C"
@@ -19,19 +19,19 @@ namespace system {
 namespace internal {
 
 bool ShutdownCheckNoLeaks(Core* core) {
-  // No point in taking the lock.
-  const HandleTable::HandleToEntryMap& handle_to_entry_map =
-      core->handle_table_.handle_to_entry_map_;
-
-  if (handle_to_entry_map.empty())
-    return true;
-
-  for (HandleTable::HandleToEntryMap::const_iterator it =
-           handle_to_entry_map.begin();
-       it != handle_to_entry_map.end(); ++it) {
-    LOG(ERROR) << "Mojo embedder shutdown: Leaking handle " << (*it).first;
+  // No point in taking the locks.
+  bool rv = true;
+  for (uint32_t i = 0; i < HandleTable::kNumShards; i++) {
+    const HandleTable::HandleToEntryMap& handle_to_entry_map =
+        core->handle_table_.shards_[i].handle_to_entry_map;
+    for (HandleTable::HandleToEntryMap::const_iterator it =
+             handle_to_entry_map.begin();
+         it != handle_to_entry_map.end(); ++it) {
+      LOG(ERROR) << "Mojo embedder shutdown: Leaking handle " << (*it).first;
+      rv = false;
+    }
   }
-  return false;
+  return rv;
 }
 
 }  // namespace internal
@@ -43,7 +43,7 @@ void Channel::Init(scoped_ptr<RawChannel> raw_channel) {
   // becomes thread-safe.
   DCHECK(!is_running_);
   raw_channel_ = raw_channel.Pass();
-  raw_channel_->Init(this);
+  raw_channel_->Init(this, platform_support_);
   is_running_ = true;
 }
 
@@ -19,7 +19,9 @@ embedder::Configuration g_configuration = {
     256 * 1024 * 1024,    // max_data_pipe_capacity_bytes
     1024 * 1024,          // default_data_pipe_capacity_bytes
     16,                   // data_pipe_buffer_alignment_bytes
-    1024 * 1024 * 1024};  // max_shared_memory_num_bytes
+    1024 * 1024 * 1024,   // max_shared_memory_num_bytes
+    256 * 1024,           // min_shared_memory_message_num_bytes
+    64 * 1024};           // min_shared_memory_data_pipe_capacity_bytes
 
 }  // namespace internal
 }  // namespace system
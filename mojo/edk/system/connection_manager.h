@@ -115,6 +115,10 @@ class MOJO_SYSTEM_IMPL_EXPORT ConnectionManager {
   explicit ConnectionManager(embedder::PlatformSupport* platform_support)
       : platform_support_(platform_support) {}
 
+  embedder::PlatformSupport* platform_support() const {
+    return platform_support_;
+  }
+
  private:
   embedder::PlatformSupport* const platform_support_;
 
@@ -21,6 +21,7 @@
 #include "mojo/edk/system/message_pipe.h"
 #include "mojo/edk/system/message_pipe_dispatcher.h"
 #include "mojo/edk/system/shared_buffer_dispatcher.h"
+#include "mojo/edk/system/wait_set_dispatcher.h"
 #include "mojo/edk/system/waiter.h"
 #include "mojo/public/c/system/macros.h"
 #include "mojo/public/cpp/system/macros.h"
@@ -53,21 +54,27 @@ namespace system {
 // (e.g., |MessagePipe|). To signal/wake a |Waiter|, the object in question --
 // either a |SimpleDispatcher| or a secondary object -- talks to its
 // |AwakableList|.
+//
+// Wait sets (see |WaitSetDispatcher|) are the exception to the above: a wait
+// set's entries are |Awakable|s that stay registered with their dispatchers'
+// |AwakableList|s across waits, and are put on the wait set's ready queue when
+// awoken. (Thus a wait only needs to look at the handles that may be ready.)
 
 // Thread-safety notes
 //
 // Mojo primitives calls are thread-safe. We achieve this with relatively
-// fine-grained locking. There is a global handle table lock. This lock should
-// be held as briefly as possible (TODO(vtl): a future improvement would be to
-// switch it to a reader-writer lock). Each |Dispatcher| object then has a lock
-// (which subclasses can use to protect their data).
+// fine-grained locking. The handle table is divided into shards, each with its
+// own lock (see |HandleTable|). These locks should be held as briefly as
+// possible, and at most one of them is held at a time. Each |Dispatcher| object
+// then has a lock (which subclasses can use to protect their data).
 //
 // The lock ordering is as follows:
-//   1. global handle table lock, global mapping table lock
+//   1. handle table shard locks, global mapping table lock
+//   1.5. |WaitSet| entry registration locks
 //   2. |Dispatcher| locks
 //   3. secondary object locks
 //   ...
-//   INF. |Waiter| locks
+//   INF. |Waiter| locks, |WaitSet| locks
 //
 // Notes:
 //    - While holding a |Dispatcher| lock, you may not unconditionally attempt
@@ -86,7 +93,6 @@ Core::~Core() {
 }
 
 MojoHandle Core::AddDispatcher(const scoped_refptr<Dispatcher>& dispatcher) {
-  MutexLocker locker(&handle_table_mutex_);
   return handle_table_.AddDispatcher(dispatcher);
 }
 
@@ -94,7 +100,6 @@ scoped_refptr<Dispatcher> Core::GetDispatcher(MojoHandle handle) {
   if (handle == MOJO_HANDLE_INVALID)
     return nullptr;
 
-  MutexLocker locker(&handle_table_mutex_);
   return handle_table_.GetDispatcher(handle);
 }
 
@@ -103,7 +108,6 @@ MojoResult Core::GetAndRemoveDispatcher(MojoHandle handle,
   if (handle == MOJO_HANDLE_INVALID)
     return MOJO_RESULT_INVALID_ARGUMENT;
 
-  MutexLocker locker(&handle_table_mutex_);
   return handle_table_.GetAndRemoveDispatcher(handle, dispatcher);
 }
 
@@ -129,17 +133,13 @@ MojoResult Core::Close(MojoHandle handle) {
     return MOJO_RESULT_INVALID_ARGUMENT;
 
   scoped_refptr<Dispatcher> dispatcher;
-  {
-    MutexLocker locker(&handle_table_mutex_);
-    MojoResult result =
-        handle_table_.GetAndRemoveDispatcher(handle, &dispatcher);
-    if (result != MOJO_RESULT_OK)
-      return result;
-  }
+  MojoResult result = handle_table_.GetAndRemoveDispatcher(handle, &dispatcher);
+  if (result != MOJO_RESULT_OK)
+    return result;
 
   // The dispatcher doesn't have a say in being closed, but gets notified of it.
-  // Note: This is done outside of |handle_table_mutex_|. As a result, there's a
-  // race condition that the dispatcher must handle; see the comment in
+  // Note: This is done outside of the handle table's lock. As a result, there's
+  // a race condition that the dispatcher must handle; see the comment in
   // |Dispatcher| in dispatcher.h.
   return dispatcher->Close();
 }
@@ -209,11 +209,8 @@ MojoResult Core::CreateMessagePipe(
   scoped_refptr<MessagePipeDispatcher> dispatcher1 =
       MessagePipeDispatcher::Create(validated_options);
 
-  std::pair<MojoHandle, MojoHandle> handle_pair;
-  {
-    MutexLocker locker(&handle_table_mutex_);
-    handle_pair = handle_table_.AddDispatcherPair(dispatcher0, dispatcher1);
-  }
+  std::pair<MojoHandle, MojoHandle> handle_pair =
+      handle_table_.AddDispatcherPair(dispatcher0, dispatcher1);
   if (handle_pair.first == MOJO_HANDLE_INVALID) {
     DCHECK_EQ(handle_pair.second, MOJO_HANDLE_INVALID);
     LOG(ERROR) << "Handle table full";
@@ -253,8 +250,9 @@ MojoResult Core::WriteMessage(MojoHandle message_pipe_handle,
     return dispatcher->WriteMessage(bytes, num_bytes, nullptr, flags);
 
   // We have to handle |handles| here, since we have to mark them busy in the
-  // global handle table. We can't delegate this to the dispatcher, since the
-  // handle table lock must be acquired before the dispatcher lock.
+  // global handle table, which only we have access to. (Marking them busy also
+  // takes their dispatchers' locks, but only with |TryLock()|, since it's done
+  // while holding handle table locks; see |HandleTable| for the lock ordering.)
   //
   // (This leads to an oddity: |handles|/|num_handles| are always verified for
   // validity, even for dispatchers that don't support |WriteMessage()| and will
@@ -275,32 +273,25 @@ MojoResult Core::WriteMessage(MojoHandle message_pipe_handle,
   // When we pass handles, we have to try to take all their dispatchers' locks
   // and mark the handles as busy. If the call succeeds, we then remove the
   // handles from the handle table.
-  {
-    MutexLocker locker(&handle_table_mutex_);
-    MojoResult result = handle_table_.MarkBusyAndStartTransport(
-        message_pipe_handle, handles_reader.GetPointer(), num_handles,
-        &transports);
-    if (result != MOJO_RESULT_OK)
-      return result;
-  }
+  MojoResult result = handle_table_.MarkBusyAndStartTransport(
+      message_pipe_handle, handles_reader.GetPointer(), num_handles,
+      &transports);
+  if (result != MOJO_RESULT_OK)
+    return result;
 
   MojoResult rv =
       dispatcher->WriteMessage(bytes, num_bytes, &transports, flags);
 
-  // We need to release the dispatcher locks before we take the handle table
-  // lock.
+  // Release the dispatcher locks first, since they're no longer needed. (The
+  // handle table locks may be taken while holding them, but there's no reason
+  // to hold them any longer.)
   for (uint32_t i = 0; i < num_handles; i++)
     transports[i].End();
 
-  {
-    MutexLocker locker(&handle_table_mutex_);
-    if (rv == MOJO_RESULT_OK) {
-      handle_table_.RemoveBusyHandles(handles_reader.GetPointer(), num_handles);
-    } else {
-      handle_table_.RestoreBusyHandles(handles_reader.GetPointer(),
-                                       num_handles);
-    }
-  }
+  if (rv == MOJO_RESULT_OK)
+    handle_table_.RemoveBusyHandles(handles_reader.GetPointer(), num_handles);
+  else
+    handle_table_.RestoreBusyHandles(handles_reader.GetPointer(), num_handles);
 
   return rv;
 }
@@ -331,20 +322,15 @@ MojoResult Core::ReadMessage(MojoHandle message_pipe_handle,
       DCHECK(!num_handles.IsNull());
       DCHECK_LE(dispatchers.size(), static_cast<size_t>(num_handles_value));
 
-      bool success;
       UserPointer<MojoHandle>::Writer handles_writer(handles,
                                                      dispatchers.size());
-      {
-        MutexLocker locker(&handle_table_mutex_);
-        success = handle_table_.AddDispatcherVector(
-            dispatchers, handles_writer.GetPointer());
-      }
-      if (success) {
+      if (handle_table_.AddDispatcherVector(dispatchers,
+                                            handles_writer.GetPointer())) {
         handles_writer.Commit();
       } else {
         LOG(ERROR) << "Received message with " << dispatchers.size()
                    << " handles, but handle table full";
-        // Close dispatchers (outside the lock).
+        // Close dispatchers.
         for (size_t i = 0; i < dispatchers.size(); i++) {
           if (dispatchers[i])
             dispatchers[i]->Close();
@@ -375,12 +361,8 @@ MojoResult Core::CreateDataPipe(
   scoped_refptr<DataPipeConsumerDispatcher> consumer_dispatcher =
       DataPipeConsumerDispatcher::Create();
 
-  std::pair<MojoHandle, MojoHandle> handle_pair;
-  {
-    MutexLocker locker(&handle_table_mutex_);
-    handle_pair = handle_table_.AddDispatcherPair(producer_dispatcher,
-                                                  consumer_dispatcher);
-  }
+  std::pair<MojoHandle, MojoHandle> handle_pair =
+      handle_table_.AddDispatcherPair(producer_dispatcher, consumer_dispatcher);
   if (handle_pair.first == MOJO_HANDLE_INVALID) {
     DCHECK_EQ(handle_pair.second, MOJO_HANDLE_INVALID);
     LOG(ERROR) << "Handle table full";
@@ -554,6 +536,93 @@ MojoResult Core::UnmapBuffer(UserPointer<void> buffer) {
   return mapping_table_.RemoveMapping(buffer.GetPointerValue());
 }
 
+MojoResult Core::CreateWaitSet(
+    UserPointer<const MojoCreateWaitSetOptions> options,
+    UserPointer<MojoHandle> wait_set_handle) {
+  MojoCreateWaitSetOptions validated_options = {};
+  MojoResult result =
+      WaitSetDispatcher::ValidateCreateOptions(options, &validated_options);
+  if (result != MOJO_RESULT_OK)
+    return result;
+
+  scoped_refptr<WaitSetDispatcher> dispatcher =
+      WaitSetDispatcher::Create(validated_options);
+  MojoHandle h = AddDispatcher(dispatcher);
+  if (h == MOJO_HANDLE_INVALID) {
+    LOG(ERROR) << "Handle table full";
+    dispatcher->Close();
+    return MOJO_RESULT_RESOURCE_EXHAUSTED;
+  }
+
+  wait_set_handle.Put(h);
+  return MOJO_RESULT_OK;
+}
+
+MojoResult Core::WaitSetAdd(MojoHandle wait_set_handle,
+                            MojoHandle handle,
+                            MojoHandleSignals signals,
+                            uint64_t cookie) {
+  scoped_refptr<WaitSetDispatcher> wait_set_dispatcher(
+      GetWaitSetDispatcher(wait_set_handle));
+  if (!wait_set_dispatcher)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+
+  if (handle == wait_set_handle)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+  scoped_refptr<Dispatcher> dispatcher(GetDispatcher(handle));
+  if (!dispatcher)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+
+  return wait_set_dispatcher->Add(dispatcher, signals, cookie);
+}
+
+MojoResult Core::WaitSetRemove(MojoHandle wait_set_handle, uint64_t cookie) {
+  scoped_refptr<WaitSetDispatcher> wait_set_dispatcher(
+      GetWaitSetDispatcher(wait_set_handle));
+  if (!wait_set_dispatcher)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+
+  return wait_set_dispatcher->Remove(cookie);
+}
+
+MojoResult Core::WaitSetWait(MojoHandle wait_set_handle,
+                             MojoDeadline deadline,
+                             UserPointer<uint32_t> num_results,
+                             UserPointer<MojoWaitSetResult> results) {
+  scoped_refptr<WaitSetDispatcher> wait_set_dispatcher(
+      GetWaitSetDispatcher(wait_set_handle));
+  if (!wait_set_dispatcher)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+
+  uint32_t max_results = num_results.Get();
+  if (max_results < 1)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+  // There's no point in asking for more results than |WaitMany()| would allow
+  // handles (and this bounds the size of our buffer).
+  if (max_results > GetConfiguration().max_wait_many_num_handles)
+    max_results = static_cast<uint32_t>(
+        GetConfiguration().max_wait_many_num_handles);
+
+  UserPointer<MojoWaitSetResult>::Writer results_writer(results, max_results);
+  uint32_t num_results_value = 0;
+  MojoResult rv = wait_set_dispatcher->Wait(
+      deadline, max_results, results_writer.GetPointer(), &num_results_value);
+  if (rv == MOJO_RESULT_OK) {
+    results_writer.Commit();
+    num_results.Put(num_results_value);
+  }
+  return rv;
+}
+
+scoped_refptr<WaitSetDispatcher> Core::GetWaitSetDispatcher(
+    MojoHandle handle) {
+  scoped_refptr<Dispatcher> dispatcher(GetDispatcher(handle));
+  if (!dispatcher || dispatcher->GetType() != Dispatcher::Type::WAIT_SET)
+    return nullptr;
+  return scoped_refptr<WaitSetDispatcher>(
+      static_cast<WaitSetDispatcher*>(dispatcher.get()));
+}
+
 // Note: We allow |handles| to repeat the same handle multiple times, since
 // different flags may be specified.
 // TODO(vtl): This incurs a performance cost in |Remove()|. Analyze this
@@ -19,6 +19,7 @@
 #include "mojo/public/c/system/data_pipe.h"
 #include "mojo/public/c/system/message_pipe.h"
 #include "mojo/public/c/system/types.h"
+#include "mojo/public/c/system/wait_set.h"
 #include "mojo/public/cpp/system/macros.h"
 
 namespace mojo {
@@ -31,6 +32,7 @@ namespace system {
 
 class Dispatcher;
 struct HandleSignalsState;
+class WaitSetDispatcher;
 
 // |Core| is an object that implements the Mojo system calls. All public methods
 // are thread-safe.
@@ -159,6 +161,20 @@ class MOJO_SYSTEM_IMPL_EXPORT Core {
                        MojoMapBufferFlags flags);
   MojoResult UnmapBuffer(UserPointer<void> buffer);
 
+  // These methods correspond to the API functions defined in
+  // "mojo/public/c/system/wait_set.h":
+  MojoResult CreateWaitSet(UserPointer<const MojoCreateWaitSetOptions> options,
+                           UserPointer<MojoHandle> wait_set_handle);
+  MojoResult WaitSetAdd(MojoHandle wait_set_handle,
+                        MojoHandle handle,
+                        MojoHandleSignals signals,
+                        uint64_t cookie);
+  MojoResult WaitSetRemove(MojoHandle wait_set_handle, uint64_t cookie);
+  MojoResult WaitSetWait(MojoHandle wait_set_handle,
+                         MojoDeadline deadline,
+                         UserPointer<uint32_t> num_results,
+                         UserPointer<MojoWaitSetResult> results);
+
  private:
   friend bool internal::ShutdownCheckNoLeaks(Core*);
 
@@ -173,12 +189,14 @@ class MOJO_SYSTEM_IMPL_EXPORT Core {
                               uint32_t* result_index,
                               HandleSignalsState* signals_states);
 
+  // Looks up the dispatcher for the given handle, which must be a wait set.
+  // Returns null if the handle is invalid or not a wait set.
+  scoped_refptr<WaitSetDispatcher> GetWaitSetDispatcher(MojoHandle handle);
+
   embedder::PlatformSupport* const platform_support_;
 
-  // TODO(vtl): |handle_table_mutex_| should be a reader-writer lock (if only we
-  // had them).
-  Mutex handle_table_mutex_;
-  HandleTable handle_table_ MOJO_GUARDED_BY(handle_table_mutex_);
+  // Note: |handle_table_| does its own (fine-grained) locking.
+  HandleTable handle_table_;
 
   Mutex mapping_table_mutex_;
   MappingTable mapping_table_ MOJO_GUARDED_BY(mapping_table_mutex_);
@@ -0,0 +1,155 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This tests the performance of |Core| when it's used from many threads at
+// once (each using its own handles), which shows how well it scales.
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/test/perf_log.h"
+#include "base/threading/simple_thread.h"
+#include "base/time/time.h"
+#include "mojo/edk/embedder/simple_platform_support.h"
+#include "mojo/edk/system/core.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace system {
+namespace {
+
+// The number of operations each thread does.
+const uint32_t kNumIterations = 100000;
+
+// The thread counts to measure.
+const size_t kThreadCounts[] = {1, 2, 4, 8, 16, 32};
+
+// Each thread creates its own message pipe and then repeatedly does the given
+// operation on it (after all the threads have been started).
+class CorePerfThread : public base::SimpleThread {
+ public:
+  enum Op {
+    // Writes a message to one end and reads it from the other.
+    WRITE_READ_MESSAGE,
+    // Waits for one end to be writable (which it always is), with a zero
+    // deadline.
+    WAIT_ZERO_DEADLINE
+  };
+
+  CorePerfThread(Core* core, base::WaitableEvent* start_event, Op op)
+      : base::SimpleThread("core_perf_thread"),
+        core_(core),
+        start_event_(start_event),
+        op_(op) {}
+  ~CorePerfThread() override {}
+
+ private:
+  void Run() override {
+    MojoHandle h[2] = {MOJO_HANDLE_INVALID, MOJO_HANDLE_INVALID};
+    CHECK_EQ(core_->CreateMessagePipe(NullUserPointer(), MakeUserPointer(&h[0]),
+                                      MakeUserPointer(&h[1])),
+             MOJO_RESULT_OK);
+
+    start_event_->Wait();
+
+    switch (op_) {
+      case WRITE_READ_MESSAGE:
+        for (uint32_t i = 0; i < kNumIterations; i++) {
+          CHECK_EQ(core_->WriteMessage(h[0], UserPointer<const void>(&i),
+                                       sizeof(i), NullUserPointer(), 0,
+                                       MOJO_WRITE_MESSAGE_FLAG_NONE),
+                   MOJO_RESULT_OK);
+          uint32_t buffer = 0;
+          uint32_t buffer_size = sizeof(buffer);
+          CHECK_EQ(core_->ReadMessage(h[1], UserPointer<void>(&buffer),
+                                      MakeUserPointer(&buffer_size),
+                                      NullUserPointer(), NullUserPointer(),
+                                      MOJO_READ_MESSAGE_FLAG_NONE),
+                   MOJO_RESULT_OK);
+          CHECK_EQ(buffer, i);
+        }
+        break;
+      case WAIT_ZERO_DEADLINE:
+        for (uint32_t i = 0; i < kNumIterations; i++) {
+          MojoHandleSignalsState state;
+          CHECK_EQ(core_->Wait(h[0], MOJO_HANDLE_SIGNAL_WRITABLE, 0,
+                               MakeUserPointer(&state)),
+                   MOJO_RESULT_OK);
+        }
+        break;
+    }
+
+    CHECK_EQ(core_->Close(h[0]), MOJO_RESULT_OK);
+    CHECK_EQ(core_->Close(h[1]), MOJO_RESULT_OK);
+  }
+
+  Core* const core_;
+  base::WaitableEvent* const start_event_;
+  const Op op_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(CorePerfThread);
+};
+
+class CorePerfTest : public testing::Test {
+ public:
+  CorePerfTest() {}
+  ~CorePerfTest() override {}
+
+  void SetUp() override { core_.reset(new Core(&platform_support_)); }
+  void TearDown() override { core_.reset(); }
+
+ protected:
+  // Runs |op| on |num_threads| threads at once, and logs the total number of
+  // operations per second.
+  void Measure(const char* name, CorePerfThread::Op op, size_t num_threads) {
+    base::WaitableEvent start_event(true, false);  // Manual reset.
+    ScopedVector<CorePerfThread> threads;
+    for (size_t i = 0; i < num_threads; i++) {
+      threads.push_back(new CorePerfThread(core_.get(), &start_event, op));
+      threads.back()->Start();
+    }
+
+    base::TimeTicks start_time = base::TimeTicks::Now();
+    start_event.Signal();
+    for (size_t i = 0; i < num_threads; i++)
+      threads[i]->Join();
+    base::TimeDelta elapsed = base::TimeTicks::Now() - start_time;
+
+    base::LogPerfResult(
+        base::StringPrintf("%s_%uThreads", name,
+                           static_cast<unsigned>(num_threads)).c_str(),
+        num_threads * kNumIterations / elapsed.InSecondsF(), "ops/s");
+  }
+
+ private:
+  embedder::SimplePlatformSupport platform_support_;
+  scoped_ptr<Core> core_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(CorePerfTest);
+};
+
+TEST_F(CorePerfTest, WriteReadMessage) {
+  for (size_t i = 0; i < arraysize(kThreadCounts); i++) {
+    Measure("CoreWriteReadMessage", CorePerfThread::WRITE_READ_MESSAGE,
+            kThreadCounts[i]);
+  }
+}
+
+TEST_F(CorePerfTest, WaitZeroDeadline) {
+  for (size_t i = 0; i < arraysize(kThreadCounts); i++) {
+    Measure("CoreWaitZeroDeadline", CorePerfThread::WAIT_ZERO_DEADLINE,
+            kThreadCounts[i]);
+  }
+}
+
+}  // namespace
+}  // namespace system
+}  // namespace mojo
@@ -1042,6 +1042,78 @@ TEST_F(CoreTest, DataPipe) {
   EXPECT_EQ(MOJO_RESULT_OK, core()->Close(ch));
 }
 
+// Tests that messages with handles attached (which can't be passed on the fast
+// path between local endpoints) stay in order with the ones without.
+TEST_F(CoreTest, MessagePipeLocalHandlePassingOrder) {
+  char buffer[100];
+  const uint32_t kBufferSize = static_cast<uint32_t>(sizeof(buffer));
+  uint32_t num_bytes;
+  MojoHandle handles[10];
+  uint32_t num_handles;
+
+  MojoHandle h_passing[2];
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->CreateMessagePipe(NullUserPointer(),
+                                      MakeUserPointer(&h_passing[0]),
+                                      MakeUserPointer(&h_passing[1])));
+  MojoHandle h_passed[2];
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->CreateMessagePipe(NullUserPointer(),
+                                      MakeUserPointer(&h_passed[0]),
+                                      MakeUserPointer(&h_passed[1])));
+
+  // Write "a", "b" (with |h_passed[1]| attached), "c", and "d".
+  const char* const kMessages[] = {"a", "b", "c", "d"};
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kMessages); i++) {
+    EXPECT_EQ(MOJO_RESULT_OK,
+              core()->WriteMessage(
+                  h_passing[0], UserPointer<const void>(kMessages[i]), 2,
+                  i == 1 ? MakeUserPointer(&h_passed[1]) : NullUserPointer(),
+                  i == 1 ? 1 : 0, MOJO_WRITE_MESSAGE_FLAG_NONE));
+  }
+
+  // Read them back, in order.
+  MojoHandle h_received = MOJO_HANDLE_INVALID;
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kMessages); i++) {
+    num_bytes = kBufferSize;
+    num_handles = MOJO_ARRAYSIZE(handles);
+    EXPECT_EQ(MOJO_RESULT_OK,
+              core()->ReadMessage(
+                  h_passing[1], UserPointer<void>(buffer),
+                  MakeUserPointer(&num_bytes), MakeUserPointer(handles),
+                  MakeUserPointer(&num_handles), MOJO_READ_MESSAGE_FLAG_NONE));
+    EXPECT_EQ(2u, num_bytes);
+    EXPECT_STREQ(kMessages[i], buffer);
+    if (i == 1) {
+      EXPECT_EQ(1u, num_handles);
+      h_received = handles[0];
+    } else {
+      EXPECT_EQ(0u, num_handles);
+    }
+  }
+  EXPECT_NE(h_received, MOJO_HANDLE_INVALID);
+
+  // Subsequent messages still get through.
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->WriteMessage(h_passing[0], UserPointer<const void>("e"), 2,
+                                 NullUserPointer(), 0,
+                                 MOJO_WRITE_MESSAGE_FLAG_NONE));
+  num_bytes = kBufferSize;
+  num_handles = MOJO_ARRAYSIZE(handles);
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->ReadMessage(
+                h_passing[1], UserPointer<void>(buffer),
+                MakeUserPointer(&num_bytes), MakeUserPointer(handles),
+                MakeUserPointer(&num_handles), MOJO_READ_MESSAGE_FLAG_NONE));
+  EXPECT_STREQ("e", buffer);
+  EXPECT_EQ(0u, num_handles);
+
+  EXPECT_EQ(MOJO_RESULT_OK, core()->Close(h_passing[0]));
+  EXPECT_EQ(MOJO_RESULT_OK, core()->Close(h_passing[1]));
+  EXPECT_EQ(MOJO_RESULT_OK, core()->Close(h_passed[0]));
+  EXPECT_EQ(MOJO_RESULT_OK, core()->Close(h_received));
+}
+
 // Tests passing data pipe producer and consumer handles.
 TEST_F(CoreTest, MessagePipeBasicLocalHandlePassing2) {
   const char kHello[] = "hello";
@@ -1310,6 +1382,73 @@ TEST_F(CoreTest, AsyncWait) {
   EXPECT_EQ(MOJO_RESULT_OK, core()->Close(h));
 }
 
+TEST_F(CoreTest, WaitSet) {
+  MojoHandle ws = MOJO_HANDLE_INVALID;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->CreateWaitSet(NullUserPointer(), MakeUserPointer(&ws)));
+  EXPECT_NE(ws, MOJO_HANDLE_INVALID);
+
+  MojoHandle h[2];
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->CreateMessagePipe(NullUserPointer(), MakeUserPointer(&h[0]),
+                                      MakeUserPointer(&h[1])));
+
+  // A wait set can't contain itself, and only wait set handles are valid.
+  EXPECT_EQ(MOJO_RESULT_INVALID_ARGUMENT,
+            core()->WaitSetAdd(ws, ws, MOJO_HANDLE_SIGNAL_READABLE, 0));
+  EXPECT_EQ(MOJO_RESULT_INVALID_ARGUMENT,
+            core()->WaitSetAdd(h[0], h[1], MOJO_HANDLE_SIGNAL_READABLE, 0));
+  EXPECT_EQ(MOJO_RESULT_INVALID_ARGUMENT,
+            core()->WaitSetAdd(ws, MOJO_HANDLE_INVALID,
+                               MOJO_HANDLE_SIGNAL_READABLE, 0));
+
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->WaitSetAdd(ws, h[0], MOJO_HANDLE_SIGNAL_READABLE, 10));
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->WaitSetAdd(ws, h[1], MOJO_HANDLE_SIGNAL_READABLE, 11));
+
+  MojoWaitSetResult results[2];
+  uint32_t num_results = 0;
+  EXPECT_EQ(MOJO_RESULT_INVALID_ARGUMENT,
+            core()->WaitSetWait(ws, 0, MakeUserPointer(&num_results),
+                                MakeUserPointer(results)));
+  num_results = 2;
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            core()->WaitSetWait(ws, 0, MakeUserPointer(&num_results),
+                                MakeUserPointer(results)));
+
+  // Write to |h[1]|, making |h[0]| readable.
+  char buffer[1] = {'x'};
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->WriteMessage(h[1], UserPointer<const void>(buffer), 1,
+                                 NullUserPointer(), 0,
+                                 MOJO_WRITE_MESSAGE_FLAG_NONE));
+  num_results = 2;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->WaitSetWait(ws, MOJO_DEADLINE_INDEFINITE,
+                                MakeUserPointer(&num_results),
+                                MakeUserPointer(results)));
+  EXPECT_EQ(1u, num_results);
+  EXPECT_EQ(10u, results[0].cookie);
+  EXPECT_EQ(MOJO_RESULT_OK, results[0].wait_result);
+  EXPECT_EQ(MOJO_HANDLE_SIGNAL_READABLE | MOJO_HANDLE_SIGNAL_WRITABLE,
+            results[0].signals_state.satisfied_signals);
+
+  // Closing |h[1]| makes |h[0]| readable only until the message is read, and
+  // cancels its own entry.
+  EXPECT_EQ(MOJO_RESULT_OK, core()->Close(h[1]));
+  num_results = 2;
+  EXPECT_EQ(MOJO_RESULT_OK,
+            core()->WaitSetWait(ws, 0, MakeUserPointer(&num_results),
+                                MakeUserPointer(results)));
+  EXPECT_EQ(2u, num_results);
+  EXPECT_EQ(MOJO_RESULT_OK, core()->WaitSetRemove(ws, 11));
+  EXPECT_EQ(MOJO_RESULT_NOT_FOUND, core()->WaitSetRemove(ws, 11));
+
+  EXPECT_EQ(MOJO_RESULT_OK, core()->Close(ws));
+  EXPECT_EQ(MOJO_RESULT_OK, core()->Close(h[0]));
+}
+
 // TODO(vtl): Test |DuplicateBufferHandle()| and |MapBuffer()|.
 
 }  // namespace
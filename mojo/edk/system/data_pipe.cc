@@ -11,6 +11,8 @@
 
 #include "base/logging.h"
 #include "base/memory/aligned_memory.h"
+#include "mojo/edk/embedder/platform_support.h"
+#include "mojo/edk/embedder/scoped_platform_handle.h"
 #include "mojo/edk/system/awakable_list.h"
 #include "mojo/edk/system/channel.h"
 #include "mojo/edk/system/configuration.h"
@@ -25,6 +27,63 @@
 namespace mojo {
 namespace system {
 
+namespace {
+
+// Deserializes (and maps) the shared buffer for a data pipe, if there is one
+// (i.e., if |platform_handle_index| isn't |kNoSharedBuffer|). |index| is the
+// read or write index given with it, which is validated. Returns false on
+// failure.
+bool DeserializeSharedBuffer(
+    Channel* channel,
+    const MojoCreateDataPipeOptions& validated_options,
+    uint32_t platform_handle_index,
+    uint32_t index,
+    embedder::PlatformHandleVector* platform_handles,
+    scoped_refptr<embedder::PlatformSharedBuffer>* shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping>* shared_buffer_mapping) {
+  if (platform_handle_index == kNoSharedBuffer)
+    return true;
+
+  if (index >= validated_options.capacity_num_bytes ||
+      index % validated_options.element_num_bytes != 0) {
+    LOG(ERROR) << "Invalid serialized data pipe (bad shared buffer index)";
+    return false;
+  }
+
+  if (!platform_handles || platform_handle_index >= platform_handles->size()) {
+    LOG(ERROR) << "Invalid serialized data pipe (missing handles)";
+    return false;
+  }
+
+  // Starts off invalid, which is what we want.
+  embedder::PlatformHandle platform_handle;
+  // We take ownership of the handle, so we have to invalidate the one in
+  // |platform_handles|.
+  std::swap(platform_handle, (*platform_handles)[platform_handle_index]);
+
+  // Note: The size of the shared buffer is checked against the capacity (at
+  // least on POSIX, where this is possible), so the peer can't give us a
+  // buffer that's too small.
+  *shared_buffer = channel->platform_support()->CreateSharedBufferFromHandle(
+      validated_options.capacity_num_bytes,
+      embedder::ScopedPlatformHandle(platform_handle));
+  if (!*shared_buffer) {
+    LOG(ERROR) << "Invalid serialized data pipe (bad shared buffer)";
+    return false;
+  }
+
+  *shared_buffer_mapping =
+      (*shared_buffer)->MapNoCheck(0, validated_options.capacity_num_bytes);
+  if (!*shared_buffer_mapping) {
+    LOG(ERROR) << "Unable to map data pipe shared buffer";
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace
+
 // static
 MojoCreateDataPipeOptions DataPipe::GetDefaultCreateOptions() {
   MojoCreateDataPipeOptions result = {
@@ -101,12 +160,28 @@ DataPipe* DataPipe::CreateLocal(
 DataPipe* DataPipe::CreateRemoteProducerFromExisting(
     const MojoCreateDataPipeOptions& validated_options,
     MessageInTransitQueue* message_queue,
-    ChannelEndpoint* channel_endpoint) {
-  scoped_ptr<char, base::AlignedFreeDeleter> buffer;
-  size_t buffer_num_bytes = 0;
-  if (!RemoteProducerDataPipeImpl::ProcessMessagesFromIncomingEndpoint(
-          validated_options, message_queue, &buffer, &buffer_num_bytes))
-    return nullptr;
+    ChannelEndpoint* channel_endpoint,
+    scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+    size_t shared_buffer_read_index) {
+  scoped_ptr<DataPipeImpl> impl;
+  if (shared_buffer) {
+    size_t buffer_num_bytes = 0;
+    if (!RemoteProducerDataPipeImpl::ProcessSharedWritesFromIncomingEndpoint(
+            validated_options, message_queue, &buffer_num_bytes))
+      return nullptr;
+    impl.reset(new RemoteProducerDataPipeImpl(
+        channel_endpoint, shared_buffer, shared_buffer_mapping.Pass(),
+        shared_buffer_read_index, buffer_num_bytes));
+  } else {
+    scoped_ptr<char, base::AlignedFreeDeleter> buffer;
+    size_t buffer_num_bytes = 0;
+    if (!RemoteProducerDataPipeImpl::ProcessMessagesFromIncomingEndpoint(
+            validated_options, message_queue, &buffer, &buffer_num_bytes))
+      return nullptr;
+    impl.reset(new RemoteProducerDataPipeImpl(channel_endpoint, buffer.Pass(),
+                                              0, buffer_num_bytes));
+  }
 
   // Important: This is called under |IncomingEndpoint|'s (which is a
   // |ChannelEndpointClient|) lock, in particular from
@@ -116,9 +191,7 @@ DataPipe* DataPipe::CreateRemoteProducerFromExisting(
   // make |ChannelEndpoint::OnReadMessage()| retry, until its |ReplaceClient()|
   // is called.
   DataPipe* data_pipe =
-      new DataPipe(false, true, validated_options,
-                   make_scoped_ptr(new RemoteProducerDataPipeImpl(
-                       channel_endpoint, buffer.Pass(), 0, buffer_num_bytes)));
+      new DataPipe(false, true, validated_options, impl.Pass());
   if (channel_endpoint) {
     if (!channel_endpoint->ReplaceClient(data_pipe, 0))
       data_pipe->OnDetachFromChannel(0);
@@ -133,7 +206,10 @@ DataPipe* DataPipe::CreateRemoteConsumerFromExisting(
     const MojoCreateDataPipeOptions& validated_options,
     size_t consumer_num_bytes,
     MessageInTransitQueue* message_queue,
-    ChannelEndpoint* channel_endpoint) {
+    ChannelEndpoint* channel_endpoint,
+    scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+    size_t shared_buffer_write_index) {
   if (!RemoteConsumerDataPipeImpl::ProcessMessagesFromIncomingEndpoint(
           validated_options, &consumer_num_bytes, message_queue))
     return nullptr;
@@ -145,10 +221,11 @@ DataPipe* DataPipe::CreateRemoteConsumerFromExisting(
   // ongoing call to |IncomingEndpoint::OnReadMessage()| return false. This will
   // make |ChannelEndpoint::OnReadMessage()| retry, until its |ReplaceClient()|
   // is called.
-  DataPipe* data_pipe =
-      new DataPipe(true, false, validated_options,
-                   make_scoped_ptr(new RemoteConsumerDataPipeImpl(
-                       channel_endpoint, consumer_num_bytes)));
+  DataPipe* data_pipe = new DataPipe(
+      true, false, validated_options,
+      make_scoped_ptr(new RemoteConsumerDataPipeImpl(
+          channel_endpoint, consumer_num_bytes, shared_buffer,
+          shared_buffer_mapping.Pass(), shared_buffer_write_index)));
   if (channel_endpoint) {
     if (!channel_endpoint->ReplaceClient(data_pipe, 0))
       data_pipe->OnDetachFromChannel(0);
@@ -159,10 +236,12 @@ DataPipe* DataPipe::CreateRemoteConsumerFromExisting(
 }
 
 // static
-bool DataPipe::ProducerDeserialize(Channel* channel,
-                                   const void* source,
-                                   size_t size,
-                                   scoped_refptr<DataPipe>* data_pipe) {
+bool DataPipe::ProducerDeserialize(
+    Channel* channel,
+    const void* source,
+    size_t size,
+    embedder::PlatformHandleVector* platform_handles,
+    scoped_refptr<DataPipe>* data_pipe) {
   DCHECK(!*data_pipe);  // Not technically wrong, but unlikely.
 
   bool consumer_open = false;
@@ -208,6 +287,14 @@ bool DataPipe::ProducerDeserialize(Channel* channel,
     return false;
   }
 
+  scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer;
+  scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping;
+  if (!DeserializeSharedBuffer(channel, revalidated_options,
+                               s->shared_buffer_platform_handle_index,
+                               s->shared_buffer_write_index, platform_handles,
+                               &shared_buffer, &shared_buffer_mapping))
+    return false;
+
   const void* endpoint_source = static_cast<const char*>(source) +
                                 sizeof(SerializedDataPipeProducerDispatcher);
   scoped_refptr<IncomingEndpoint> incoming_endpoint =
@@ -216,7 +303,8 @@ bool DataPipe::ProducerDeserialize(Channel* channel,
     return false;
 
   *data_pipe = incoming_endpoint->ConvertToDataPipeProducer(
-      revalidated_options, s->consumer_num_bytes);
+      revalidated_options, s->consumer_num_bytes, shared_buffer,
+      shared_buffer_mapping.Pass(), s->shared_buffer_write_index);
   if (!*data_pipe)
     return false;
 
@@ -224,10 +312,12 @@ bool DataPipe::ProducerDeserialize(Channel* channel,
 }
 
 // static
-bool DataPipe::ConsumerDeserialize(Channel* channel,
-                                   const void* source,
-                                   size_t size,
-                                   scoped_refptr<DataPipe>* data_pipe) {
+bool DataPipe::ConsumerDeserialize(
+    Channel* channel,
+    const void* source,
+    size_t size,
+    embedder::PlatformHandleVector* platform_handles,
+    scoped_refptr<DataPipe>* data_pipe) {
   DCHECK(!*data_pipe);  // Not technically wrong, but unlikely.
 
   if (size !=
@@ -246,6 +336,14 @@ bool DataPipe::ConsumerDeserialize(Channel* channel,
     return false;
   }
 
+  scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer;
+  scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping;
+  if (!DeserializeSharedBuffer(channel, revalidated_options,
+                               s->shared_buffer_platform_handle_index,
+                               s->shared_buffer_read_index, platform_handles,
+                               &shared_buffer, &shared_buffer_mapping))
+    return false;
+
   const void* endpoint_source = static_cast<const char*>(source) +
                                 sizeof(SerializedDataPipeConsumerDispatcher);
   scoped_refptr<IncomingEndpoint> incoming_endpoint =
@@ -253,8 +351,9 @@ bool DataPipe::ConsumerDeserialize(Channel* channel,
   if (!incoming_endpoint)
     return false;
 
-  *data_pipe =
-      incoming_endpoint->ConvertToDataPipeConsumer(revalidated_options);
+  *data_pipe = incoming_endpoint->ConvertToDataPipeConsumer(
+      revalidated_options, shared_buffer, shared_buffer_mapping.Pass(),
+      s->shared_buffer_read_index);
   if (!*data_pipe)
     return false;
 
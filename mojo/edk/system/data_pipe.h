@@ -11,6 +11,7 @@
 #include "base/memory/scoped_ptr.h"
 #include "base/synchronization/lock.h"
 #include "mojo/edk/embedder/platform_handle_vector.h"
+#include "mojo/edk/embedder/platform_shared_buffer.h"
 #include "mojo/edk/system/channel_endpoint_client.h"
 #include "mojo/edk/system/handle_signals_state.h"
 #include "mojo/edk/system/memory.h"
@@ -63,40 +64,54 @@ class MOJO_SYSTEM_IMPL_EXPORT DataPipe final : public ChannelEndpointClient {
   // existing |ChannelEndpoint| (whose |ReplaceClient()| it'll call) and taking
   // |message_queue|'s contents as already-received incoming messages. If
   // |channel_endpoint| is null, this will create a "half-open" data pipe (with
-  // only the consumer open). Note that this may fail, in which case it returns
-  // null.
+  // only the consumer open). If |shared_buffer| is non-null, the data pipe's
+  // buffer is the (mapped) shared buffer, and the consumer should next read at
+  // |shared_buffer_read_index|. Note that this may fail, in which case it
+  // returns null.
   static DataPipe* CreateRemoteProducerFromExisting(
       const MojoCreateDataPipeOptions& validated_options,
       MessageInTransitQueue* message_queue,
-      ChannelEndpoint* channel_endpoint);
+      ChannelEndpoint* channel_endpoint,
+      scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+      size_t shared_buffer_read_index);
 
   // Creates a data pipe with a local producer and a remote consumer, using an
   // existing |ChannelEndpoint| (whose |ReplaceClient()| it'll call) and taking
   // |message_queue|'s contents as already-received incoming messages
   // (|message_queue| may be null). If |channel_endpoint| is null, this will
-  // create a "half-open" data pipe (with only the producer open). Note that
-  // this may fail, in which case it returns null.
+  // create a "half-open" data pipe (with only the producer open). If
+  // |shared_buffer| is non-null, the data pipe's buffer is the (mapped) shared
+  // buffer, and the producer should next write at |shared_buffer_write_index|.
+  // Note that this may fail, in which case it returns null.
   static DataPipe* CreateRemoteConsumerFromExisting(
       const MojoCreateDataPipeOptions& validated_options,
       size_t consumer_num_bytes,
       MessageInTransitQueue* message_queue,
-      ChannelEndpoint* channel_endpoint);
+      ChannelEndpoint* channel_endpoint,
+      scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+      size_t shared_buffer_write_index);
 
   // Used by |DataPipeProducerDispatcher::Deserialize()|. Returns true on
   // success (in which case, |*data_pipe| is set appropriately) and false on
   // failure (in which case |*data_pipe| may or may not be set to null).
-  static bool ProducerDeserialize(Channel* channel,
-                                  const void* source,
-                                  size_t size,
-                                  scoped_refptr<DataPipe>* data_pipe);
+  static bool ProducerDeserialize(
+      Channel* channel,
+      const void* source,
+      size_t size,
+      embedder::PlatformHandleVector* platform_handles,
+      scoped_refptr<DataPipe>* data_pipe);
 
   // Used by |DataPipeConsumerDispatcher::Deserialize()|. Returns true on
   // success (in which case, |*data_pipe| is set appropriately) and false on
   // failure (in which case |*data_pipe| may or may not be set to null).
-  static bool ConsumerDeserialize(Channel* channel,
-                                  const void* source,
-                                  size_t size,
-                                  scoped_refptr<DataPipe>* data_pipe);
+  static bool ConsumerDeserialize(
+      Channel* channel,
+      const void* source,
+      size_t size,
+      embedder::PlatformHandleVector* platform_handles,
+      scoped_refptr<DataPipe>* data_pipe);
 
   // These are called by the producer dispatcher to implement its methods of
   // corresponding names.
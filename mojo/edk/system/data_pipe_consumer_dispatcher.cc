@@ -22,11 +22,14 @@ Dispatcher::Type DataPipeConsumerDispatcher::GetType() const {
 
 // static
 scoped_refptr<DataPipeConsumerDispatcher>
-DataPipeConsumerDispatcher::Deserialize(Channel* channel,
-                                        const void* source,
-                                        size_t size) {
+DataPipeConsumerDispatcher::Deserialize(
+    Channel* channel,
+    const void* source,
+    size_t size,
+    embedder::PlatformHandleVector* platform_handles) {
   scoped_refptr<DataPipe> data_pipe;
-  if (!DataPipe::ConsumerDeserialize(channel, source, size, &data_pipe))
+  if (!DataPipe::ConsumerDeserialize(channel, source, size, platform_handles,
+                                     &data_pipe))
     return nullptr;
   DCHECK(data_pipe);
 
@@ -33,8 +33,11 @@ class MOJO_SYSTEM_IMPL_EXPORT DataPipeConsumerDispatcher final
 
   // The "opposite" of |SerializeAndClose()|. (Typically this is called by
   // |Dispatcher::Deserialize()|.)
-  static scoped_refptr<DataPipeConsumerDispatcher>
-  Deserialize(Channel* channel, const void* source, size_t size);
+  static scoped_refptr<DataPipeConsumerDispatcher> Deserialize(
+      Channel* channel,
+      const void* source,
+      size_t size,
+      embedder::PlatformHandleVector* platform_handles);
 
   // Get access to the |DataPipe| for testing.
   DataPipe* GetDataPipeForTest();
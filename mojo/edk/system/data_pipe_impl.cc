@@ -8,9 +8,11 @@
 
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
+#include "mojo/edk/embedder/scoped_platform_handle.h"
 #include "mojo/edk/system/configuration.h"
 #include "mojo/edk/system/message_in_transit.h"
 #include "mojo/edk/system/message_in_transit_queue.h"
+#include "mojo/edk/system/remote_data_pipe_ack.h"
 
 namespace mojo {
 namespace system {
@@ -47,5 +49,37 @@ void DataPipeImpl::ConvertDataToMessages(const char* buffer,
   }
 }
 
+// static
+scoped_ptr<MessageInTransit> DataPipeImpl::CreateSharedWriteMessage(
+    size_t num_bytes) {
+  RemoteDataPipeSharedWrite shared_write_data = {};
+  // Note: |num_bytes| fits in a |uint32_t| since the capacity does.
+  shared_write_data.num_bytes_written = static_cast<uint32_t>(num_bytes);
+  return make_scoped_ptr(new MessageInTransit(
+      MessageInTransit::Type::ENDPOINT_CLIENT,
+      MessageInTransit::Subtype::ENDPOINT_CLIENT_DATA_PIPE_SHARED_WRITE,
+      static_cast<uint32_t>(sizeof(shared_write_data)), &shared_write_data));
+}
+
+// static
+bool DataPipeImpl::SerializeSharedBuffer(
+    embedder::PlatformSharedBuffer* shared_buffer,
+    embedder::PlatformHandleVector* platform_handles,
+    uint32_t* platform_handle_index) {
+  DCHECK(shared_buffer);
+  DCHECK(platform_handles);
+
+  embedder::ScopedPlatformHandle platform_handle(
+      shared_buffer->DuplicatePlatformHandle());
+  if (!platform_handle.is_valid()) {
+    LOG(ERROR) << "Failed to duplicate data pipe shared buffer handle";
+    return false;
+  }
+
+  *platform_handle_index = static_cast<uint32_t>(platform_handles->size());
+  platform_handles->push_back(platform_handle.release());
+  return true;
+}
+
 }  // namespace system
 }  // namespace mojo
@@ -7,7 +7,9 @@
 
 #include <stdint.h>
 
+#include "base/memory/scoped_ptr.h"
 #include "mojo/edk/embedder/platform_handle_vector.h"
+#include "mojo/edk/embedder/platform_shared_buffer.h"
 #include "mojo/edk/system/data_pipe.h"
 #include "mojo/edk/system/handle_signals_state.h"
 #include "mojo/edk/system/memory.h"
@@ -98,6 +100,20 @@ class MOJO_SYSTEM_IMPL_EXPORT DataPipeImpl {
                              size_t* current_num_bytes,
                              MessageInTransitQueue* message_queue);
 
+  // Helper to create a |ENDPOINT_CLIENT_DATA_PIPE_SHARED_WRITE| message, which
+  // tells a consumer whose buffer is shared that |num_bytes| more bytes of data
+  // have been written to it.
+  static scoped_ptr<MessageInTransit> CreateSharedWriteMessage(
+      size_t num_bytes);
+
+  // Helper to serialize a (shared) data pipe buffer: Adds a duplicate of
+  // |shared_buffer|'s platform handle to |platform_handles|. On success,
+  // returns true and sets |*platform_handle_index|.
+  static bool SerializeSharedBuffer(
+      embedder::PlatformSharedBuffer* shared_buffer,
+      embedder::PlatformHandleVector* platform_handles,
+      uint32_t* platform_handle_index);
+
   DataPipe* owner() const { return owner_; }
 
   const MojoCreateDataPipeOptions& validated_options() const {
@@ -145,6 +161,12 @@ struct MOJO_ALIGNAS(8) SerializedDataPipeProducerDispatcher {
   // |static_cast<size_t>(-1)| if the consumer is already closed, in which case
   // this will *not* be followed by a serialized |ChannelEndpoint|.
   size_t consumer_num_bytes;
+  // If the data pipe's buffer is in shared memory (mapped by both the producer
+  // and the consumer), the index of the platform handle for it and the index
+  // in the (circular) buffer at which the producer should write next.
+  // Otherwise, the former is |kNoSharedBuffer|.
+  uint32_t shared_buffer_platform_handle_index;
+  uint32_t shared_buffer_write_index;
 };
 
 // Serialized form of a consumer dispatcher. This will actually be followed by a
@@ -153,8 +175,19 @@ struct MOJO_ALIGNAS(8) SerializedDataPipeConsumerDispatcher {
   // Only validated (and thus canonicalized) options should be serialized.
   // However, the deserializer must revalidate (as with everything received).
   MojoCreateDataPipeOptions validated_options;
+  // If the data pipe's buffer is in shared memory, the index of the platform
+  // handle for it and the index in the (circular) buffer at which the consumer
+  // should read next. (The amount of data available is given by the
+  // |ENDPOINT_CLIENT_DATA_PIPE_SHARED_WRITE| messages queued on the endpoint.)
+  // Otherwise, the former is |kNoSharedBuffer|.
+  uint32_t shared_buffer_platform_handle_index;
+  uint32_t shared_buffer_read_index;
 };
 
+// Value of |shared_buffer_platform_handle_index| (above) for data pipes whose
+// buffer isn't shared.
+const uint32_t kNoSharedBuffer = static_cast<uint32_t>(-1);
+
 }  // namespace system
 }  // namespace mojo
 
@@ -19,6 +19,7 @@
 #include "mojo/edk/embedder/simple_platform_support.h"
 #include "mojo/edk/system/channel.h"
 #include "mojo/edk/system/channel_endpoint.h"
+#include "mojo/edk/system/configuration.h"
 #include "mojo/edk/system/data_pipe.h"
 #include "mojo/edk/system/data_pipe_consumer_dispatcher.h"
 #include "mojo/edk/system/data_pipe_producer_dispatcher.h"
@@ -222,10 +223,18 @@ class LocalDataPipeImplTestHelper : public DataPipeImplTestHelper {
 // Base class for |Remote{Producer,Consumer}DataPipeImplTestHelper|.
 class RemoteDataPipeImplTestHelper : public DataPipeImplTestHelper {
  public:
-  RemoteDataPipeImplTestHelper() : io_thread_(base::TestIOThread::kAutoStart) {}
+  RemoteDataPipeImplTestHelper()
+      : io_thread_(base::TestIOThread::kAutoStart),
+        old_min_shared_memory_data_pipe_capacity_bytes_(0) {}
   ~RemoteDataPipeImplTestHelper() override {}
 
   void SetUp() override {
+    // Either put all data pipes' buffers in shared memory or none of them.
+    old_min_shared_memory_data_pipe_capacity_bytes_ =
+        GetConfiguration().min_shared_memory_data_pipe_capacity_bytes;
+    GetMutableConfiguration()->min_shared_memory_data_pipe_capacity_bytes =
+        UsesSharedBuffer() ? 1 : 0;
+
     scoped_refptr<ChannelEndpoint> ep[2];
     message_pipes_[0] = MessagePipe::CreateLocalProxy(&ep[0]);
     message_pipes_[1] = MessagePipe::CreateLocalProxy(&ep[1]);
@@ -241,6 +250,9 @@ class RemoteDataPipeImplTestHelper : public DataPipeImplTestHelper {
     io_thread_.PostTaskAndWait(
         FROM_HERE, base::Bind(&RemoteDataPipeImplTestHelper::TearDownOnIOThread,
                               base::Unretained(this)));
+
+    GetMutableConfiguration()->min_shared_memory_data_pipe_capacity_bytes =
+        old_min_shared_memory_data_pipe_capacity_bytes_;
   }
 
   void Create(const MojoCreateDataPipeOptions& validated_options) override {
@@ -251,6 +263,10 @@ class RemoteDataPipeImplTestHelper : public DataPipeImplTestHelper {
   bool IsStrictCircularBuffer() const override { return false; }
 
  protected:
+  // Returns true if data pipes' buffers should be put in shared memory when
+  // their handles are transferred.
+  virtual bool UsesSharedBuffer() const { return false; }
+
   void SendDispatcher(size_t source_i,
                       scoped_refptr<Dispatcher> to_send,
                       scoped_refptr<Dispatcher>* to_receive) {
@@ -346,6 +362,7 @@ class RemoteDataPipeImplTestHelper : public DataPipeImplTestHelper {
   base::TestIOThread io_thread_;
   scoped_refptr<Channel> channels_[2];
   scoped_refptr<MessagePipe> message_pipes_[2];
+  size_t old_min_shared_memory_data_pipe_capacity_bytes_;
 
   scoped_refptr<DataPipe> dp_;
 
@@ -546,13 +563,37 @@ class RemoteConsumerDataPipeImplTestHelper2
   MOJO_DISALLOW_COPY_AND_ASSIGN(RemoteConsumerDataPipeImplTestHelper2);
 };
 
+// SharedBufferDataPipeImplTestHelper ------------------------------------------
+
+// This is like |Helper| (one of the above "remote" helpers), but the data
+// pipe's buffer is put in shared memory when it's transferred, so that (in
+// particular) the transferred producer writes directly to the consumer's
+// buffer.
+template <class Helper>
+class SharedBufferDataPipeImplTestHelper : public Helper {
+ public:
+  SharedBufferDataPipeImplTestHelper() {}
+  ~SharedBufferDataPipeImplTestHelper() override {}
+
+ protected:
+  bool UsesSharedBuffer() const override { return true; }
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(SharedBufferDataPipeImplTestHelper);
+};
+
 // Test case instantiation -----------------------------------------------------
 
-using HelperTypes = testing::Types<LocalDataPipeImplTestHelper,
-                                   RemoteProducerDataPipeImplTestHelper,
-                                   RemoteConsumerDataPipeImplTestHelper,
-                                   RemoteProducerDataPipeImplTestHelper2,
-                                   RemoteConsumerDataPipeImplTestHelper2>;
+using HelperTypes = testing::Types<
+    LocalDataPipeImplTestHelper,
+    RemoteProducerDataPipeImplTestHelper,
+    RemoteConsumerDataPipeImplTestHelper,
+    RemoteProducerDataPipeImplTestHelper2,
+    RemoteConsumerDataPipeImplTestHelper2,
+    SharedBufferDataPipeImplTestHelper<RemoteProducerDataPipeImplTestHelper>,
+    SharedBufferDataPipeImplTestHelper<RemoteConsumerDataPipeImplTestHelper>,
+    SharedBufferDataPipeImplTestHelper<RemoteProducerDataPipeImplTestHelper2>,
+    SharedBufferDataPipeImplTestHelper<RemoteConsumerDataPipeImplTestHelper2>>;
 
 TYPED_TEST_CASE(DataPipeImplTest, HelperTypes);
 
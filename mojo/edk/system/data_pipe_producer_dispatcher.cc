@@ -22,11 +22,14 @@ Dispatcher::Type DataPipeProducerDispatcher::GetType() const {
 
 // static
 scoped_refptr<DataPipeProducerDispatcher>
-DataPipeProducerDispatcher::Deserialize(Channel* channel,
-                                        const void* source,
-                                        size_t size) {
+DataPipeProducerDispatcher::Deserialize(
+    Channel* channel,
+    const void* source,
+    size_t size,
+    embedder::PlatformHandleVector* platform_handles) {
   scoped_refptr<DataPipe> data_pipe;
-  if (!DataPipe::ProducerDeserialize(channel, source, size, &data_pipe))
+  if (!DataPipe::ProducerDeserialize(channel, source, size, platform_handles,
+                                     &data_pipe))
     return nullptr;
   DCHECK(data_pipe);
 
@@ -37,8 +37,9 @@ DispatcherTransport Dispatcher::HandleTableAccess::TryStartTransport(
     return DispatcherTransport();
 
   // We shouldn't race with things that close dispatchers, since closing can
-  // only take place either under |handle_table_mutex_| or when the handle is
-  // marked as busy.
+  // only take place either after the handle has been removed from the handle
+  // table (under the lock that our caller holds) or when the handle is marked
+  // as busy.
   DCHECK(!dispatcher->is_closed_);
 
   return DispatcherTransport(dispatcher);
@@ -81,11 +82,11 @@ scoped_refptr<Dispatcher> Dispatcher::TransportDataAccess::Deserialize(
       return scoped_refptr<Dispatcher>(
           MessagePipeDispatcher::Deserialize(channel, source, size));
     case Type::DATA_PIPE_PRODUCER:
-      return scoped_refptr<Dispatcher>(
-          DataPipeProducerDispatcher::Deserialize(channel, source, size));
+      return scoped_refptr<Dispatcher>(DataPipeProducerDispatcher::Deserialize(
+          channel, source, size, platform_handles));
     case Type::DATA_PIPE_CONSUMER:
-      return scoped_refptr<Dispatcher>(
-          DataPipeConsumerDispatcher::Deserialize(channel, source, size));
+      return scoped_refptr<Dispatcher>(DataPipeConsumerDispatcher::Deserialize(
+          channel, source, size, platform_handles));
     case Type::SHARED_BUFFER:
       return scoped_refptr<Dispatcher>(SharedBufferDispatcher::Deserialize(
           channel, source, size, platform_handles));
@@ -66,6 +66,7 @@ class MOJO_SYSTEM_IMPL_EXPORT Dispatcher
     DATA_PIPE_PRODUCER,
     DATA_PIPE_CONSUMER,
     SHARED_BUFFER,
+    WAIT_SET,
 
     // "Private" types (not exposed via the public interface):
     PLATFORM_HANDLE = -1
@@ -168,9 +169,11 @@ class MOJO_SYSTEM_IMPL_EXPORT Dispatcher
     // Tests also need this, to avoid needing |Core|.
     friend DispatcherTransport test::DispatcherTryStartTransport(Dispatcher*);
 
-    // This must be called under the handle table lock and only if the handle
-    // table entry is not marked busy. The caller must maintain a reference to
-    // |dispatcher| until |DispatcherTransport::End()| is called.
+    // This must be called under the handle table (shard) lock and only if the
+    // handle table entry is not marked busy. The caller must maintain a
+    // reference to |dispatcher| until |DispatcherTransport::End()| is called.
+    // Note: This must only try to take the dispatcher's lock, never wait for
+    // it (see the lock ordering described in handle_table.h).
     static DispatcherTransport TryStartTransport(Dispatcher* dispatcher);
   };
 
@@ -4,6 +4,7 @@
 
 #include "mojo/edk/system/handle_table.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "base/logging.h"
@@ -24,7 +25,23 @@ HandleTable::Entry::~Entry() {
   DCHECK(!busy);
 }
 
-HandleTable::HandleTable() : next_handle_(MOJO_HANDLE_INVALID + 1) {
+HandleTable::Shard::Shard() {
+}
+
+HandleTable::Shard::~Shard() {
+}
+
+// static
+MOJO_STATIC_CONST_MEMBER_DEFINITION const uint32_t HandleTable::kNumShards;
+
+HandleTable::HandleTable() : size_(0), next_shard_(0) {
+  static_assert((kNumShards & (kNumShards - 1)) == 0,
+                "kNumShards must be a power of two");
+  for (uint32_t i = 0; i < kNumShards; i++) {
+    // Shard 0 can't start at 0, since that's |MOJO_HANDLE_INVALID|.
+    shards_[i].next_handle =
+        (i == MOJO_HANDLE_INVALID) ? static_cast<MojoHandle>(kNumShards) : i;
+  }
 }
 
 HandleTable::~HandleTable() {
@@ -32,13 +49,15 @@ HandleTable::~HandleTable() {
   // the singleton |Core|, which lives forever), except in tests.
 }
 
-Dispatcher* HandleTable::GetDispatcher(MojoHandle handle) {
+scoped_refptr<Dispatcher> HandleTable::GetDispatcher(MojoHandle handle) {
   DCHECK_NE(handle, MOJO_HANDLE_INVALID);
 
-  HandleToEntryMap::iterator it = handle_to_entry_map_.find(handle);
-  if (it == handle_to_entry_map_.end())
+  Shard& shard = GetShard(handle);
+  MutexLocker locker(&shard.mutex);
+  HandleToEntryMap::iterator it = shard.handle_to_entry_map.find(handle);
+  if (it == shard.handle_to_entry_map.end())
     return nullptr;
-  return it->second.dispatcher.get();
+  return it->second.dispatcher;
 }
 
 MojoResult HandleTable::GetAndRemoveDispatcher(
@@ -47,32 +66,36 @@ MojoResult HandleTable::GetAndRemoveDispatcher(
   DCHECK_NE(handle, MOJO_HANDLE_INVALID);
   DCHECK(dispatcher);
 
-  HandleToEntryMap::iterator it = handle_to_entry_map_.find(handle);
-  if (it == handle_to_entry_map_.end())
-    return MOJO_RESULT_INVALID_ARGUMENT;
-  if (it->second.busy)
-    return MOJO_RESULT_BUSY;
-  *dispatcher = it->second.dispatcher;
-  handle_to_entry_map_.erase(it);
+  {
+    Shard& shard = GetShard(handle);
+    MutexLocker locker(&shard.mutex);
+    HandleToEntryMap::iterator it = shard.handle_to_entry_map.find(handle);
+    if (it == shard.handle_to_entry_map.end())
+      return MOJO_RESULT_INVALID_ARGUMENT;
+    if (it->second.busy)
+      return MOJO_RESULT_BUSY;
+    *dispatcher = it->second.dispatcher;
+    shard.handle_to_entry_map.erase(it);
+  }
+  ReleaseHandles(1);
 
   return MOJO_RESULT_OK;
 }
 
 MojoHandle HandleTable::AddDispatcher(
     const scoped_refptr<Dispatcher>& dispatcher) {
-  if (handle_to_entry_map_.size() >= GetConfiguration().max_handle_table_size)
+  if (!ReserveHandles(1))
     return MOJO_HANDLE_INVALID;
-  return AddDispatcherNoSizeCheck(dispatcher);
+  return AddReservedDispatcher(dispatcher);
 }
 
 std::pair<MojoHandle, MojoHandle> HandleTable::AddDispatcherPair(
     const scoped_refptr<Dispatcher>& dispatcher0,
     const scoped_refptr<Dispatcher>& dispatcher1) {
-  if (handle_to_entry_map_.size() + 1 >=
-      GetConfiguration().max_handle_table_size)
+  if (!ReserveHandles(2))
     return std::make_pair(MOJO_HANDLE_INVALID, MOJO_HANDLE_INVALID);
-  return std::make_pair(AddDispatcherNoSizeCheck(dispatcher0),
-                        AddDispatcherNoSizeCheck(dispatcher1));
+  return std::make_pair(AddReservedDispatcher(dispatcher0),
+                        AddReservedDispatcher(dispatcher1));
 }
 
 bool HandleTable::AddDispatcherVector(const DispatcherVector& dispatchers,
@@ -87,15 +110,16 @@ bool HandleTable::AddDispatcherVector(const DispatcherVector& dispatchers,
       std::numeric_limits<size_t>::max())
       << "Addition may overflow";
 
-  if (handle_to_entry_map_.size() + dispatchers.size() > max_handle_table_size)
+  if (!ReserveHandles(dispatchers.size()))
     return false;
 
   for (size_t i = 0; i < dispatchers.size(); i++) {
     if (dispatchers[i]) {
-      handles[i] = AddDispatcherNoSizeCheck(dispatchers[i]);
+      handles[i] = AddReservedDispatcher(dispatchers[i]);
     } else {
       LOG(WARNING) << "Invalid dispatcher at index " << i;
       handles[i] = MOJO_HANDLE_INVALID;
+      ReleaseHandles(1);
     }
   }
   return true;
@@ -125,8 +149,11 @@ MojoResult HandleTable::MarkBusyAndStartTransport(
       break;
     }
 
-    HandleToEntryMap::iterator it = handle_to_entry_map_.find(handles[i]);
-    if (it == handle_to_entry_map_.end()) {
+    Shard& shard = GetShard(handles[i]);
+    MutexLocker locker(&shard.mutex);
+
+    HandleToEntryMap::iterator it = shard.handle_to_entry_map.find(handles[i]);
+    if (it == shard.handle_to_entry_map.end()) {
       error_result = MOJO_RESULT_INVALID_ARGUMENT;
       break;
     }
@@ -176,9 +203,11 @@ MojoResult HandleTable::MarkBusyAndStartTransport(
 
     // Unset the busy flags and release the locks.
     for (uint32_t j = 0; j < i; j++) {
+      (*transports)[j].End();
+      Shard& shard = GetShard(handles[j]);
+      MutexLocker locker(&shard.mutex);
       DCHECK(entries[j]->busy);
       entries[j]->busy = false;
-      (*transports)[j].End();
     }
     return error_result;
   }
@@ -186,28 +215,61 @@ MojoResult HandleTable::MarkBusyAndStartTransport(
   return MOJO_RESULT_OK;
 }
 
-MojoHandle HandleTable::AddDispatcherNoSizeCheck(
+bool HandleTable::ReserveHandles(size_t count) {
+  base::subtle::Atomic32 max_size =
+      static_cast<base::subtle::Atomic32>(std::min(
+          GetConfiguration().max_handle_table_size,
+          static_cast<size_t>(std::numeric_limits<int32_t>::max())));
+  if (count > static_cast<size_t>(max_size))
+    return false;
+
+  base::subtle::Atomic32 delta = static_cast<base::subtle::Atomic32>(count);
+  base::subtle::Atomic32 old_size = base::subtle::NoBarrier_Load(&size_);
+  for (;;) {
+    if (old_size > max_size - delta)
+      return false;
+    base::subtle::Atomic32 prev_size = base::subtle::NoBarrier_CompareAndSwap(
+        &size_, old_size, old_size + delta);
+    if (prev_size == old_size)
+      return true;
+    old_size = prev_size;
+  }
+}
+
+void HandleTable::ReleaseHandles(size_t count) {
+  base::subtle::Atomic32 new_size = base::subtle::NoBarrier_AtomicIncrement(
+      &size_, -static_cast<base::subtle::Atomic32>(count));
+  DCHECK_GE(new_size, 0);
+}
+
+MojoHandle HandleTable::AddReservedDispatcher(
     const scoped_refptr<Dispatcher>& dispatcher) {
   DCHECK(dispatcher);
-  DCHECK_LT(handle_to_entry_map_.size(),
-            GetConfiguration().max_handle_table_size);
-  DCHECK_NE(next_handle_, MOJO_HANDLE_INVALID);
+
+  Shard& shard = shards_[static_cast<uint32_t>(
+                             base::subtle::NoBarrier_AtomicIncrement(
+                                 &next_shard_, 1)) &
+                         (kNumShards - 1)];
+  MutexLocker locker(&shard.mutex);
+  DCHECK_NE(shard.next_handle, MOJO_HANDLE_INVALID);
 
   // TODO(vtl): Maybe we want to do something different/smarter. (Or maybe try
   // assigning randomly?)
-  while (handle_to_entry_map_.find(next_handle_) !=
-         handle_to_entry_map_.end()) {
-    next_handle_++;
-    if (next_handle_ == MOJO_HANDLE_INVALID)
-      next_handle_++;
+  // Note: Since |kNumShards| divides 2^32, the handles stay in the same shard
+  // even when they wrap around.
+  while (shard.handle_to_entry_map.find(shard.next_handle) !=
+         shard.handle_to_entry_map.end()) {
+    shard.next_handle += kNumShards;
+    if (shard.next_handle == MOJO_HANDLE_INVALID)
+      shard.next_handle += kNumShards;
   }
 
-  MojoHandle new_handle = next_handle_;
-  handle_to_entry_map_[new_handle] = Entry(dispatcher);
+  MojoHandle new_handle = shard.next_handle;
+  shard.handle_to_entry_map[new_handle] = Entry(dispatcher);
 
-  next_handle_++;
-  if (next_handle_ == MOJO_HANDLE_INVALID)
-    next_handle_++;
+  shard.next_handle += kNumShards;
+  if (shard.next_handle == MOJO_HANDLE_INVALID)
+    shard.next_handle += kNumShards;
 
   return new_handle;
 }
@@ -218,12 +280,15 @@ void HandleTable::RemoveBusyHandles(const MojoHandle* handles,
   DCHECK_LE(num_handles, GetConfiguration().max_message_num_handles);
 
   for (uint32_t i = 0; i < num_handles; i++) {
-    HandleToEntryMap::iterator it = handle_to_entry_map_.find(handles[i]);
-    DCHECK(it != handle_to_entry_map_.end());
+    Shard& shard = GetShard(handles[i]);
+    MutexLocker locker(&shard.mutex);
+    HandleToEntryMap::iterator it = shard.handle_to_entry_map.find(handles[i]);
+    DCHECK(it != shard.handle_to_entry_map.end());
     DCHECK(it->second.busy);
     it->second.busy = false;  // For the sake of a |DCHECK()|.
-    handle_to_entry_map_.erase(it);
+    shard.handle_to_entry_map.erase(it);
   }
+  ReleaseHandles(num_handles);
 }
 
 void HandleTable::RestoreBusyHandles(const MojoHandle* handles,
@@ -232,8 +297,10 @@ void HandleTable::RestoreBusyHandles(const MojoHandle* handles,
   DCHECK_LE(num_handles, GetConfiguration().max_message_num_handles);
 
   for (uint32_t i = 0; i < num_handles; i++) {
-    HandleToEntryMap::iterator it = handle_to_entry_map_.find(handles[i]);
-    DCHECK(it != handle_to_entry_map_.end());
+    Shard& shard = GetShard(handles[i]);
+    MutexLocker locker(&shard.mutex);
+    HandleToEntryMap::iterator it = shard.handle_to_entry_map.find(handles[i]);
+    DCHECK(it != shard.handle_to_entry_map.end());
     DCHECK(it->second.busy);
     it->second.busy = false;
   }
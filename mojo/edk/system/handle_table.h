@@ -8,8 +8,10 @@
 #include <utility>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/containers/hash_tables.h"
 #include "base/memory/ref_counted.h"
+#include "mojo/edk/system/mutex.h"
 #include "mojo/edk/system/system_impl_export.h"
 #include "mojo/public/c/system/types.h"
 #include "mojo/public/cpp/system/macros.h"
@@ -33,22 +35,36 @@ bool ShutdownCheckNoLeaks(Core*);
 // (valid) |MojoHandle|s to |Dispatcher|s. This is abstracted so that, e.g.,
 // caching may be added.
 //
-// This class is NOT thread-safe; locking is left to |Core| (since it may need
-// to make several changes -- "atomically" or in rapid successsion, in which
-// case the extra locking/unlocking would be unnecessary overhead).
+// This class is thread-safe. So that threads using different handles don't
+// contend with one another, the table is divided into |kNumShards| shards,
+// each with its own lock: a handle lives in the shard given by its low bits,
+// and new handles are assigned to the shards in turn. Operations on a single
+// handle only take the lock for its shard. (Operations on multiple handles
+// take the locks one at a time, so they aren't atomic with respect to other
+// threads, except that adding multiple handles is all-or-nothing.)
+//
+// Lock ordering: At most one shard lock is held at a time, and shard locks may
+// be acquired while holding dispatcher locks (|MarkBusyAndStartTransport()|
+// holds the locks of the dispatchers it has already started transport on while
+// it looks up the next handle). The reverse only happens with a try-lock: while
+// holding a shard lock, a dispatcher lock is only ever acquired by
+// |Dispatcher::HandleTableAccess::TryStartTransport()|, which fails instead of
+// waiting if the lock is held. This is what keeps the two orders from
+// deadlocking, so |TryStartTransport()| must not be changed to wait for the
+// dispatcher lock.
 
 class MOJO_SYSTEM_IMPL_EXPORT HandleTable {
  public:
   HandleTable();
   ~HandleTable();
 
+  // The number of shards (which must be a power of two).
+  static const uint32_t kNumShards = 32;
+
   // Gets the dispatcher for a given handle (which should not be
   // |MOJO_HANDLE_INVALID|). Returns null if there's no dispatcher for the given
   // handle.
-  // WARNING: For efficiency, this returns a dumb pointer. If you're going to
-  // use the result outside |Core|'s lock, you MUST take a reference (e.g., by
-  // storing the result inside a |scoped_refptr|).
-  Dispatcher* GetDispatcher(MojoHandle handle);
+  scoped_refptr<Dispatcher> GetDispatcher(MojoHandle handle);
 
   // On success, gets the dispatcher for a given handle (which should not be
   // |MOJO_HANDLE_INVALID|) and removes it. (On failure, returns an appropriate
@@ -82,7 +98,9 @@ class MOJO_SYSTEM_IMPL_EXPORT HandleTable {
   // Tries to mark the given handles as busy and start transport on them (i.e.,
   // take their dispatcher locks); |transports| must be sized to contain
   // |num_handles| elements. On failure, returns them to their original
-  // (non-busy, unlocked state).
+  // (non-busy, unlocked state). (Each dispatcher lock is only tried, while
+  // holding the relevant shard lock, and the dispatcher locks already taken are
+  // held while taking the next shard lock; see the lock ordering above.)
   MojoResult MarkBusyAndStartTransport(
       MojoHandle disallowed_handle,
       const MojoHandle* handles,
@@ -107,12 +125,11 @@ class MOJO_SYSTEM_IMPL_EXPORT HandleTable {
   // lock.
   //
   // For example, if |Core::WriteMessage()| is called with a handle to be sent,
-  // (under the handle table lock) it must first check that that handle is not
+  // (under the handle's shard lock) it must first check that that handle is not
   // busy (if it is busy, then it fails with |MOJO_RESULT_BUSY|) and then marks
-  // it as busy. To avoid deadlock, it should also try to acquire the locks for
-  // all the dispatchers for the handles that it is sending (and fail with
-  // |MOJO_RESULT_BUSY| if the attempt fails). At this point, it can release the
-  // handle table lock.
+  // it as busy. To avoid deadlock, it should also try to acquire the lock for
+  // the handle's dispatcher (and fail with |MOJO_RESULT_BUSY| if the attempt
+  // fails). At this point, it can release the shard lock.
   //
   // If |Core::Close()| is simultaneously called on that handle, it too checks
   // if the handle is marked busy. If it is, it fails (with |MOJO_RESULT_BUSY|).
@@ -128,12 +145,41 @@ class MOJO_SYSTEM_IMPL_EXPORT HandleTable {
   };
   using HandleToEntryMap = base::hash_map<MojoHandle, Entry>;
 
-  // Adds the given dispatcher to the handle table, not doing any size checks.
-  MojoHandle AddDispatcherNoSizeCheck(
-      const scoped_refptr<Dispatcher>& dispatcher);
+  // Note: Entries in |handle_to_entry_map| are only inserted or removed under
+  // |mutex|, but since busy entries can't be removed (except by whoever marked
+  // them busy), pointers to them remain valid until they're no longer busy.
+  struct Shard {
+    Shard();
+    ~Shard();
+
+    Mutex mutex;
+    HandleToEntryMap handle_to_entry_map MOJO_GUARDED_BY(mutex);
+    // Invariant: never |MOJO_HANDLE_INVALID|, and always in this shard.
+    MojoHandle next_handle MOJO_GUARDED_BY(mutex);
+  };
+
+  Shard& GetShard(MojoHandle handle) {
+    return shards_[handle & (kNumShards - 1)];
+  }
+
+  // Reserves room for |count| more handles in the table (see
+  // |max_handle_table_size| in |Configuration|), returning false if there's
+  // not enough.
+  bool ReserveHandles(size_t count);
+
+  // Releases room for |count| handles previously reserved by
+  // |ReserveHandles()|.
+  void ReleaseHandles(size_t count);
+
+  // Adds the given dispatcher to the handle table, for which room must have
+  // been reserved.
+  MojoHandle AddReservedDispatcher(const scoped_refptr<Dispatcher>& dispatcher);
 
-  HandleToEntryMap handle_to_entry_map_;
-  MojoHandle next_handle_;  // Invariant: never |MOJO_HANDLE_INVALID|.
+  Shard shards_[kNumShards];
+  // The number of handles in (or reserved in) the table.
+  base::subtle::Atomic32 size_;
+  // The shard to which the next handle will be added (modulo |kNumShards|).
+  base::subtle::Atomic32 next_shard_;
 
   MOJO_DISALLOW_COPY_AND_ASSIGN(HandleTable);
 };
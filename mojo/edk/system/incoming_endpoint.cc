@@ -34,20 +34,28 @@ scoped_refptr<MessagePipe> IncomingEndpoint::ConvertToMessagePipe() {
 
 scoped_refptr<DataPipe> IncomingEndpoint::ConvertToDataPipeProducer(
     const MojoCreateDataPipeOptions& validated_options,
-    size_t consumer_num_bytes) {
+    size_t consumer_num_bytes,
+    scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+    size_t shared_buffer_write_index) {
   MutexLocker locker(&mutex_);
   scoped_refptr<DataPipe> data_pipe(DataPipe::CreateRemoteConsumerFromExisting(
-      validated_options, consumer_num_bytes, &message_queue_, endpoint_.get()));
+      validated_options, consumer_num_bytes, &message_queue_, endpoint_.get(),
+      shared_buffer, shared_buffer_mapping.Pass(), shared_buffer_write_index));
   DCHECK(message_queue_.IsEmpty());
   endpoint_ = nullptr;
   return data_pipe;
 }
 
 scoped_refptr<DataPipe> IncomingEndpoint::ConvertToDataPipeConsumer(
-    const MojoCreateDataPipeOptions& validated_options) {
+    const MojoCreateDataPipeOptions& validated_options,
+    scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+    size_t shared_buffer_read_index) {
   MutexLocker locker(&mutex_);
   scoped_refptr<DataPipe> data_pipe(DataPipe::CreateRemoteProducerFromExisting(
-      validated_options, &message_queue_, endpoint_.get()));
+      validated_options, &message_queue_, endpoint_.get(), shared_buffer,
+      shared_buffer_mapping.Pass(), shared_buffer_read_index));
   DCHECK(message_queue_.IsEmpty());
   endpoint_ = nullptr;
   return data_pipe;
@@ -8,6 +8,8 @@
 #include <stddef.h>
 
 #include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "mojo/edk/embedder/platform_shared_buffer.h"
 #include "mojo/edk/system/channel_endpoint_client.h"
 #include "mojo/edk/system/message_in_transit_queue.h"
 #include "mojo/edk/system/mutex.h"
@@ -35,11 +37,19 @@ class MOJO_SYSTEM_IMPL_EXPORT IncomingEndpoint final
   scoped_refptr<ChannelEndpoint> Init() MOJO_NOT_THREAD_SAFE;
 
   scoped_refptr<MessagePipe> ConvertToMessagePipe();
+  // For the following, see |DataPipe::CreateRemoteConsumerFromExisting()| and
+  // |DataPipe::CreateRemoteProducerFromExisting()|, respectively.
   scoped_refptr<DataPipe> ConvertToDataPipeProducer(
       const MojoCreateDataPipeOptions& validated_options,
-      size_t consumer_num_bytes);
+      size_t consumer_num_bytes,
+      scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+      size_t shared_buffer_write_index);
   scoped_refptr<DataPipe> ConvertToDataPipeConsumer(
-      const MojoCreateDataPipeOptions& validated_options);
+      const MojoCreateDataPipeOptions& validated_options,
+      scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+      size_t shared_buffer_read_index);
 
   // Must be called before destroying this object if |ConvertToMessagePipe()|
   // wasn't called (but |Init()| was).
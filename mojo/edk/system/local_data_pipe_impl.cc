@@ -16,6 +16,7 @@
 
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
+#include "mojo/edk/embedder/platform_support.h"
 #include "mojo/edk/system/channel.h"
 #include "mojo/edk/system/configuration.h"
 #include "mojo/edk/system/data_pipe.h"
@@ -161,7 +162,7 @@ void LocalDataPipeImpl::ProducerStartSerialize(Channel* channel,
                                                size_t* max_platform_handles) {
   *max_size = sizeof(SerializedDataPipeProducerDispatcher) +
               channel->GetSerializedEndpointSize();
-  *max_platform_handles = 0;
+  *max_platform_handles = ShouldUseSharedBuffer() ? 1 : 0;
 }
 
 bool LocalDataPipeImpl::ProducerEndSerialize(
@@ -172,6 +173,8 @@ bool LocalDataPipeImpl::ProducerEndSerialize(
   SerializedDataPipeProducerDispatcher* s =
       static_cast<SerializedDataPipeProducerDispatcher*>(destination);
   s->validated_options = validated_options();
+  s->shared_buffer_platform_handle_index = kNoSharedBuffer;
+  s->shared_buffer_write_index = 0;
   void* destination_for_endpoint = static_cast<char*>(destination) +
                                    sizeof(SerializedDataPipeProducerDispatcher);
 
@@ -186,15 +189,40 @@ bool LocalDataPipeImpl::ProducerEndSerialize(
   // |RemoteProducerDataPipeImpl|.
 
   s->consumer_num_bytes = current_num_bytes_;
+
+  // If possible, move the buffer to shared memory, which the remote producer
+  // will write to directly. (We can't if there's a two-phase read, since the
+  // consumer is reading from |buffer_|.)
+  scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer;
+  scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping;
+  if (ShouldUseSharedBuffer() && !consumer_in_two_phase_read() &&
+      CreateSharedBuffer(channel, &shared_buffer, &shared_buffer_mapping) &&
+      SerializeSharedBuffer(shared_buffer.get(), platform_handles,
+                            &s->shared_buffer_platform_handle_index)) {
+    s->shared_buffer_write_index =
+        static_cast<uint32_t>(current_num_bytes_ % capacity_num_bytes());
+  } else {
+    shared_buffer = nullptr;
+    shared_buffer_mapping.reset();
+  }
+
   // Note: We don't use |port|.
   scoped_refptr<ChannelEndpoint> channel_endpoint =
       channel->SerializeEndpointWithLocalPeer(destination_for_endpoint, nullptr,
                                               owner(), 0);
+  scoped_ptr<DataPipeImpl> new_impl;
+  if (shared_buffer) {
+    new_impl.reset(new RemoteProducerDataPipeImpl(
+        channel_endpoint.get(), shared_buffer, shared_buffer_mapping.Pass(), 0,
+        current_num_bytes_));
+  } else {
+    new_impl.reset(new RemoteProducerDataPipeImpl(
+        channel_endpoint.get(), buffer_.Pass(), start_index_,
+        current_num_bytes_));
+  }
   // Note: Keep |*this| alive until the end of this method, to make things
   // slightly easier on ourselves.
-  scoped_ptr<DataPipeImpl> self(owner()->ReplaceImplNoLock(make_scoped_ptr(
-      new RemoteProducerDataPipeImpl(channel_endpoint.get(), buffer_.Pass(),
-                                     start_index_, current_num_bytes_))));
+  scoped_ptr<DataPipeImpl> self(owner()->ReplaceImplNoLock(new_impl.Pass()));
 
   *actual_size = sizeof(SerializedDataPipeProducerDispatcher) +
                  channel->GetSerializedEndpointSize();
@@ -339,7 +367,7 @@ void LocalDataPipeImpl::ConsumerStartSerialize(Channel* channel,
                                                size_t* max_platform_handles) {
   *max_size = sizeof(SerializedDataPipeConsumerDispatcher) +
               channel->GetSerializedEndpointSize();
-  *max_platform_handles = 0;
+  *max_platform_handles = ShouldUseSharedBuffer() ? 1 : 0;
 }
 
 bool LocalDataPipeImpl::ConsumerEndSerialize(
@@ -350,13 +378,33 @@ bool LocalDataPipeImpl::ConsumerEndSerialize(
   SerializedDataPipeConsumerDispatcher* s =
       static_cast<SerializedDataPipeConsumerDispatcher*>(destination);
   s->validated_options = validated_options();
+  s->shared_buffer_platform_handle_index = kNoSharedBuffer;
+  s->shared_buffer_read_index = 0;
   void* destination_for_endpoint = static_cast<char*>(destination) +
                                    sizeof(SerializedDataPipeConsumerDispatcher);
 
   size_t old_num_bytes = current_num_bytes_;
   MessageInTransitQueue message_queue;
-  ConvertDataToMessages(buffer_.get(), &start_index_, &current_num_bytes_,
-                        &message_queue);
+  // If possible, move the buffer to shared memory, which the remote consumer
+  // will read from directly. (This is only worth doing if the producer is still
+  // open, and we can't if there's a two-phase write, since the producer is
+  // writing to |buffer_|.) Then we only have to tell the consumer how much data
+  // there is.
+  scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer;
+  scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping;
+  if (producer_open() && !producer_in_two_phase_write() &&
+      ShouldUseSharedBuffer() &&
+      CreateSharedBuffer(channel, &shared_buffer, &shared_buffer_mapping) &&
+      SerializeSharedBuffer(shared_buffer.get(), platform_handles,
+                            &s->shared_buffer_platform_handle_index)) {
+    if (current_num_bytes_ > 0)
+      message_queue.AddMessage(CreateSharedWriteMessage(current_num_bytes_));
+  } else {
+    shared_buffer = nullptr;
+    shared_buffer_mapping.reset();
+    ConvertDataToMessages(buffer_.get(), &start_index_, &current_num_bytes_,
+                          &message_queue);
+  }
   start_index_ = 0;
   current_num_bytes_ = 0;
 
@@ -378,8 +426,11 @@ bool LocalDataPipeImpl::ConsumerEndSerialize(
                                               &message_queue, owner(), 0);
   // Note: Keep |*this| alive until the end of this method, to make things
   // slightly easier on ourselves.
-  scoped_ptr<DataPipeImpl> self(owner()->ReplaceImplNoLock(make_scoped_ptr(
-      new RemoteConsumerDataPipeImpl(channel_endpoint.get(), old_num_bytes))));
+  scoped_ptr<DataPipeImpl> self(owner()->ReplaceImplNoLock(
+      make_scoped_ptr(new RemoteConsumerDataPipeImpl(
+          channel_endpoint.get(), old_num_bytes, shared_buffer,
+          shared_buffer_mapping.Pass(),
+          old_num_bytes % capacity_num_bytes()))));
 
   *actual_size = sizeof(SerializedDataPipeConsumerDispatcher) +
                  channel->GetSerializedEndpointSize();
@@ -415,6 +466,42 @@ void LocalDataPipeImpl::DestroyBuffer() {
   buffer_.reset();
 }
 
+bool LocalDataPipeImpl::ShouldUseSharedBuffer() const {
+  size_t min_capacity_num_bytes =
+      GetConfiguration().min_shared_memory_data_pipe_capacity_bytes;
+  return min_capacity_num_bytes != 0 &&
+         capacity_num_bytes() >= min_capacity_num_bytes;
+}
+
+bool LocalDataPipeImpl::CreateSharedBuffer(
+    Channel* channel,
+    scoped_refptr<embedder::PlatformSharedBuffer>* shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping>* shared_buffer_mapping) {
+  scoped_refptr<embedder::PlatformSharedBuffer> new_shared_buffer(
+      channel->platform_support()->CreateSharedBuffer(capacity_num_bytes()));
+  if (!new_shared_buffer)
+    return false;
+  scoped_ptr<embedder::PlatformSharedBufferMapping> new_shared_buffer_mapping(
+      new_shared_buffer->MapNoCheck(0, capacity_num_bytes()));
+  if (!new_shared_buffer_mapping)
+    return false;
+
+  if (current_num_bytes_ > 0) {
+    char* dest = static_cast<char*>(new_shared_buffer_mapping->GetBase());
+    size_t num_bytes_to_copy_first = GetMaxNumBytesToRead();
+    memcpy(dest, buffer_.get() + start_index_, num_bytes_to_copy_first);
+    if (num_bytes_to_copy_first < current_num_bytes_) {
+      // The "second read index" is zero.
+      memcpy(dest + num_bytes_to_copy_first, buffer_.get(),
+             current_num_bytes_ - num_bytes_to_copy_first);
+    }
+  }
+
+  *shared_buffer = new_shared_buffer;
+  *shared_buffer_mapping = new_shared_buffer_mapping.Pass();
+  return true;
+}
+
 size_t LocalDataPipeImpl::GetMaxNumBytesToWrite() {
   size_t next_index = start_index_ + current_num_bytes_;
   if (next_index >= capacity_num_bytes()) {
@@ -6,7 +6,9 @@
 #define MOJO_EDK_SYSTEM_LOCAL_DATA_PIPE_IMPL_H_
 
 #include "base/memory/aligned_memory.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "mojo/edk/embedder/platform_shared_buffer.h"
 #include "mojo/edk/system/data_pipe_impl.h"
 #include "mojo/edk/system/system_impl_export.h"
 #include "mojo/public/cpp/system/macros.h"
@@ -73,6 +75,17 @@ class MOJO_SYSTEM_IMPL_EXPORT LocalDataPipeImpl final : public DataPipeImpl {
   void EnsureBuffer();
   void DestroyBuffer();
 
+  // Returns true if the buffer should be moved to shared memory when one of the
+  // handles is sent over a |Channel| (see
+  // |embedder::Configuration::min_shared_memory_data_pipe_capacity_bytes|).
+  bool ShouldUseSharedBuffer() const;
+  // Creates a shared buffer (of size the capacity), maps it, and copies the
+  // current contents of the buffer to its start. Returns false on failure.
+  bool CreateSharedBuffer(
+      Channel* channel,
+      scoped_refptr<embedder::PlatformSharedBuffer>* shared_buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping>* shared_buffer_mapping);
+
   // Get the maximum (single) write/read size right now (in number of elements);
   // result fits in a |uint32_t|.
   size_t GetMaxNumBytesToWrite();
@@ -9,15 +9,19 @@
 #include "base/logging.h"
 #include "mojo/edk/system/dispatcher.h"
 #include "mojo/edk/system/message_in_transit.h"
+#include "mojo/edk/system/message_in_transit_ring.h"
 
 namespace mojo {
 namespace system {
 
 LocalMessagePipeEndpoint::LocalMessagePipeEndpoint(
-    MessageInTransitQueue* message_queue)
-    : is_open_(true), is_peer_open_(true) {
+    MessageInTransitQueue* message_queue,
+    MessageInTransitRing* incoming_ring)
+    : is_open_(true), is_peer_open_(true), incoming_ring_(incoming_ring) {
   if (message_queue)
     message_queue_.Swap(message_queue);
+  if (incoming_ring_ && !message_queue_.IsEmpty())
+    incoming_ring_->Pause();
 }
 
 LocalMessagePipeEndpoint::~LocalMessagePipeEndpoint() {
@@ -48,7 +52,11 @@ void LocalMessagePipeEndpoint::EnqueueMessage(
   DCHECK(is_open_);
   DCHECK(is_peer_open_);
 
-  bool was_empty = message_queue_.IsEmpty();
+  // Messages added to the ring from now on would get ahead of this one.
+  if (incoming_ring_ && message_queue_.IsEmpty())
+    incoming_ring_->Pause();
+
+  bool was_empty = !HasIncomingMessages();
   message_queue_.AddMessage(message.Pass());
   if (was_empty)
     awakable_list_.AwakeForStateChange(GetHandleSignalsState());
@@ -58,6 +66,11 @@ void LocalMessagePipeEndpoint::Close() {
   DCHECK(is_open_);
   is_open_ = false;
   message_queue_.Clear();
+  if (incoming_ring_) {
+    if (!incoming_ring_->is_paused())
+      incoming_ring_->Pause();
+    incoming_ring_->Clear();
+  }
 }
 
 void LocalMessagePipeEndpoint::CancelAllAwakables() {
@@ -77,15 +90,19 @@ MojoResult LocalMessagePipeEndpoint::ReadMessage(
   const uint32_t max_bytes = num_bytes.IsNull() ? 0 : num_bytes.Get();
   const uint32_t max_num_dispatchers = num_dispatchers ? *num_dispatchers : 0;
 
-  if (message_queue_.IsEmpty()) {
+  if (!HasIncomingMessages()) {
     return is_peer_open_ ? MOJO_RESULT_SHOULD_WAIT
                          : MOJO_RESULT_FAILED_PRECONDITION;
   }
 
+  // Messages on the ring come first.
+  bool from_ring = incoming_ring_ && !incoming_ring_->IsEmpty();
+
   // TODO(vtl): If |flags & MOJO_READ_MESSAGE_FLAG_MAY_DISCARD|, we could pop
   // and release the lock immediately.
   bool enough_space = true;
-  MessageInTransit* message = message_queue_.PeekMessage();
+  MessageInTransit* message = from_ring ? incoming_ring_->PeekMessage()
+                                        : message_queue_.PeekMessage();
   if (!num_bytes.IsNull())
     num_bytes.Put(message->num_bytes());
   if (message->num_bytes() <= max_bytes)
@@ -114,10 +131,17 @@ MojoResult LocalMessagePipeEndpoint::ReadMessage(
   message = nullptr;
 
   if (enough_space || (flags & MOJO_READ_MESSAGE_FLAG_MAY_DISCARD)) {
-    message_queue_.DiscardMessage();
+    if (from_ring) {
+      incoming_ring_->DiscardMessage();
+    } else {
+      message_queue_.DiscardMessage();
+      // Once the queue is empty, new messages can go on the ring again.
+      if (incoming_ring_ && message_queue_.IsEmpty())
+        incoming_ring_->Resume();
+    }
 
     // Now it's empty, thus no longer readable.
-    if (message_queue_.IsEmpty()) {
+    if (!HasIncomingMessages()) {
       // It's currently not possible to wait for non-readability, but we should
       // do the state change anyway.
       awakable_list_.AwakeForStateChange(GetHandleSignalsState());
@@ -132,7 +156,7 @@ MojoResult LocalMessagePipeEndpoint::ReadMessage(
 
 HandleSignalsState LocalMessagePipeEndpoint::GetHandleSignalsState() const {
   HandleSignalsState rv;
-  if (!message_queue_.IsEmpty()) {
+  if (HasIncomingMessages()) {
     rv.satisfied_signals |= MOJO_HANDLE_SIGNAL_READABLE;
     rv.satisfiable_signals |= MOJO_HANDLE_SIGNAL_READABLE;
   }
@@ -179,5 +203,32 @@ void LocalMessagePipeEndpoint::RemoveAwakable(
     *signals_state = GetHandleSignalsState();
 }
 
+MessageInTransitQueue* LocalMessagePipeEndpoint::message_queue() {
+  if (!incoming_ring_)
+    return &message_queue_;
+
+  if (!incoming_ring_->is_paused())
+    incoming_ring_->Pause();
+  if (!incoming_ring_->IsEmpty()) {
+    MessageInTransitQueue messages;
+    while (!incoming_ring_->IsEmpty())
+      messages.AddMessage(incoming_ring_->GetMessage());
+    while (!message_queue_.IsEmpty())
+      messages.AddMessage(message_queue_.GetMessage());
+    message_queue_.Swap(&messages);
+  }
+  return &message_queue_;
+}
+
+void LocalMessagePipeEndpoint::OnIncomingRingMessageAdded() {
+  DCHECK(is_open_);
+  awakable_list_.AwakeForStateChange(GetHandleSignalsState());
+}
+
+bool LocalMessagePipeEndpoint::HasIncomingMessages() const {
+  return !message_queue_.IsEmpty() ||
+         (incoming_ring_ && !incoming_ring_->IsEmpty());
+}
+
 }  // namespace system
 }  // namespace mojo
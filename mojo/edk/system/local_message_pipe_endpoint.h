@@ -15,13 +15,19 @@
 namespace mojo {
 namespace system {
 
+class MessageInTransitRing;
+
 class MOJO_SYSTEM_IMPL_EXPORT LocalMessagePipeEndpoint final
     : public MessagePipeEndpoint {
  public:
   // If |message_queue| is non-null, its contents will be taken as the queue of
-  // (already-received) messages.
+  // (already-received) messages. If |incoming_ring| is non-null, messages may
+  // also be received on it, without |EnqueueMessage()| (see
+  // |MessagePipe::WriteMessage()|); it must outlive this object, and must only
+  // be used under the same lock.
   explicit LocalMessagePipeEndpoint(
-      MessageInTransitQueue* message_queue = nullptr);
+      MessageInTransitQueue* message_queue = nullptr,
+      MessageInTransitRing* incoming_ring = nullptr);
   ~LocalMessagePipeEndpoint() override;
 
   // |MessagePipeEndpoint| implementation:
@@ -46,15 +52,25 @@ class MOJO_SYSTEM_IMPL_EXPORT LocalMessagePipeEndpoint final
   void RemoveAwakable(Awakable* awakable,
                       HandleSignalsState* signals_state) override;
 
-  // This is only to be used by |MessagePipe|:
-  MessageInTransitQueue* message_queue() { return &message_queue_; }
+  // These are only to be used by |MessagePipe|:
+  // Returns the queue of incoming messages, after moving any messages on the
+  // incoming ring to it (and disabling the ring), for serialization.
+  MessageInTransitQueue* message_queue();
+  // To be called after a message was added to the incoming ring while it was
+  // empty.
+  void OnIncomingRingMessageAdded();
 
  private:
+  bool HasIncomingMessages() const;
+
   bool is_open_;
   bool is_peer_open_;
 
-  // Queue of incoming messages.
+  // Queue of incoming messages. Messages on |incoming_ring_| (if any) always
+  // precede the ones on the queue: the ring is paused while the queue is
+  // nonempty.
   MessageInTransitQueue message_queue_;
+  MessageInTransitRing* const incoming_ring_;
   AwakableList awakable_list_;
 
   MOJO_DISALLOW_COPY_AND_ASSIGN(LocalMessagePipeEndpoint);
@@ -107,7 +107,7 @@ MasterConnectionManager::Helper::~Helper() {
 }
 
 void MasterConnectionManager::Helper::Init() {
-  raw_channel_->Init(this);
+  raw_channel_->Init(this, owner_->platform_support());
 }
 
 embedder::SlaveInfo MasterConnectionManager::Helper::Shutdown() {
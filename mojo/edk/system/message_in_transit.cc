@@ -22,6 +22,11 @@ struct MessageInTransit::PrivateStructForCompileAsserts {
   // The size of |Header| must be a multiple of the alignment.
   static_assert(sizeof(Header) % kMessageAlignment == 0,
                 "sizeof(MessageInTransit::Header) invalid");
+
+  // Our buffers come from |MessageInTransitBufferPool|.
+  static_assert(
+      MessageInTransitBufferPool::kAlignment % kMessageAlignment == 0,
+      "MessageInTransitBufferPool::kAlignment insufficient");
 };
 
 MessageInTransit::View::View(size_t message_size, const void* buffer)
@@ -74,7 +79,8 @@ MessageInTransit::MessageInTransit(Type type,
                                    const void* bytes)
     : main_buffer_size_(RoundUpMessageAlignment(sizeof(Header) + num_bytes)),
       main_buffer_(static_cast<char*>(
-          base::AlignedAlloc(main_buffer_size_, kMessageAlignment))) {
+          MessageInTransitBufferPool::Allocate(main_buffer_size_))),
+      next_in_queue_(nullptr) {
   ConstructorHelper(type, subtype, num_bytes);
   if (bytes) {
     memcpy(MessageInTransit::bytes(), bytes, num_bytes);
@@ -91,7 +97,8 @@ MessageInTransit::MessageInTransit(Type type,
                                    UserPointer<const void> bytes)
     : main_buffer_size_(RoundUpMessageAlignment(sizeof(Header) + num_bytes)),
       main_buffer_(static_cast<char*>(
-          base::AlignedAlloc(main_buffer_size_, kMessageAlignment))) {
+          MessageInTransitBufferPool::Allocate(main_buffer_size_))),
+      next_in_queue_(nullptr) {
   ConstructorHelper(type, subtype, num_bytes);
   bytes.GetArray(MessageInTransit::bytes(), num_bytes);
   memset(static_cast<char*>(MessageInTransit::bytes()) + num_bytes, 0,
@@ -101,7 +108,8 @@ MessageInTransit::MessageInTransit(Type type,
 MessageInTransit::MessageInTransit(const View& message_view)
     : main_buffer_size_(message_view.main_buffer_size()),
       main_buffer_(static_cast<char*>(
-          base::AlignedAlloc(main_buffer_size_, kMessageAlignment))) {
+          MessageInTransitBufferPool::Allocate(main_buffer_size_))),
+      next_in_queue_(nullptr) {
   DCHECK_GE(main_buffer_size_, sizeof(Header));
   DCHECK_EQ(main_buffer_size_ % kMessageAlignment, 0u);
 
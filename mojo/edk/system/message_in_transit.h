@@ -11,11 +11,11 @@
 #include <ostream>
 #include <vector>
 
-#include "base/memory/aligned_memory.h"
 #include "base/memory/scoped_ptr.h"
 #include "mojo/edk/system/channel_endpoint_id.h"
 #include "mojo/edk/system/dispatcher.h"
 #include "mojo/edk/system/memory.h"
+#include "mojo/edk/system/message_in_transit_buffer_pool.h"
 #include "mojo/edk/system/system_impl_export.h"
 #include "mojo/public/cpp/system/macros.h"
 
@@ -42,6 +42,9 @@ class TransportData;
 //
 // See |TransportData| for a description of the (serialized) transport data
 // buffer.
+//
+// |MessageInTransit|s (and their buffers) are allocated from the
+// |MessageInTransitBufferPool|.
 class MOJO_SYSTEM_IMPL_EXPORT MessageInTransit {
  public:
   enum class Type : uint16_t {
@@ -67,6 +70,10 @@ class MOJO_SYSTEM_IMPL_EXPORT MessageInTransit {
     // Data pipe: consumer -> producer message that data was consumed. Payload
     // is |RemoteDataPipeAck|.
     ENDPOINT_CLIENT_DATA_PIPE_ACK = 1,
+    // Data pipe: producer -> consumer message that data was written to the
+    // shared memory buffer (for data pipes whose buffer is shared). Payload is
+    // |RemoteDataPipeSharedWrite|.
+    ENDPOINT_CLIENT_DATA_PIPE_SHARED_WRITE = 2,
     // Subtypes for type |Type::ENDPOINT|:
     // TODO(vtl): Nothing yet.
     // Subtypes for type |Type::CHANNEL|:
@@ -75,6 +82,12 @@ class MOJO_SYSTEM_IMPL_EXPORT MessageInTransit {
     CHANNEL_REMOVE_ENDPOINT_ACK = 2,
     // Subtypes for type |Type::RAW_CHANNEL|:
     RAW_CHANNEL_POSIX_EXTRA_PLATFORM_HANDLES = 0,
+    // A message whose (serialized) contents are in a shared memory segment
+    // (whose platform handle is attached the first time the segment is used),
+    // and the corresponding acknowledgement that the segment may be reused
+    // (see raw_channel.cc).
+    RAW_CHANNEL_SHARED_MEMORY_MESSAGE = 1,
+    RAW_CHANNEL_SHARED_MEMORY_RELEASE = 2,
     // Subtypes for type |Type::CONNECTION_MANAGER| (the message data is always
     // a buffer containing the connection ID):
     CONNECTION_MANAGER_ALLOW_CONNECT = 0,
@@ -173,6 +186,13 @@ class MOJO_SYSTEM_IMPL_EXPORT MessageInTransit {
 
   ~MessageInTransit();
 
+  static void* operator new(size_t size) {
+    return MessageInTransitBufferPool::Allocate(size);
+  }
+  static void operator delete(void* ptr) {
+    MessageInTransitBufferPool::Free(ptr);
+  }
+
   // Gets the size of the next message from |buffer|, which has |buffer_size|
   // bytes currently available, returning true and setting |*next_message_size|
   // on success. |buffer| should be aligned on a |kMessageAlignment| boundary
@@ -246,6 +266,8 @@ class MOJO_SYSTEM_IMPL_EXPORT MessageInTransit {
   }
 
  private:
+  friend class MessageInTransitQueue;
+
   // To allow us to make compile-assertions about |Header| in the .cc file.
   struct PrivateStructForCompileAsserts;
 
@@ -276,7 +298,8 @@ class MOJO_SYSTEM_IMPL_EXPORT MessageInTransit {
   void UpdateTotalSize();
 
   const size_t main_buffer_size_;
-  const scoped_ptr<char, base::AlignedFreeDeleter> main_buffer_;  // Never null.
+  // Never null.
+  const scoped_ptr<char, MessageInTransitBufferPool::Deleter> main_buffer_;
 
   scoped_ptr<TransportData> transport_data_;  // May be null.
 
@@ -286,6 +309,10 @@ class MOJO_SYSTEM_IMPL_EXPORT MessageInTransit {
   // some reason.)
   scoped_ptr<DispatcherVector> dispatchers_;
 
+  // The next message in the |MessageInTransitQueue| that this message is on
+  // (if any); managed by the queue.
+  MessageInTransit* next_in_queue_;
+
   MOJO_DISALLOW_COPY_AND_ASSIGN(MessageInTransit);
 };
 
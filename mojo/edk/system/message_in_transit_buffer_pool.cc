@@ -0,0 +1,301 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/edk/system/message_in_transit_buffer_pool.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/memory/aligned_memory.h"
+#include "base/threading/thread_local_storage.h"
+#include "mojo/edk/system/mutex.h"
+#include "mojo/edk/system/thread_annotations.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace system {
+
+namespace {
+
+// Every block starts with a |BlockHeader| recording its size class (which is
+// |kUnpooledSizeClass| for blocks that are too large to be pooled). The
+// pointer returned by |Allocate()| points just past it.
+struct BlockHeader {
+  uint32_t size_class;
+  uint32_t unused;
+};
+static_assert(sizeof(BlockHeader) == MessageInTransitBufferPool::kAlignment,
+              "sizeof(BlockHeader) invalid");
+
+// Block sizes (including the header) are 64, 128, ..., 4096 bytes.
+const size_t kMinBlockSizeLog2 = 6;
+const uint32_t kNumSizeClasses = 7;
+const uint32_t kUnpooledSizeClass = kNumSizeClasses;
+
+// The number of free blocks that each thread keeps for each size class. When a
+// thread's free list is full, |kTransferBatchSize| of its blocks are moved to
+// the depot, and when it's empty it's refilled with (up to) that many blocks
+// from the depot.
+const size_t kMaxFreeBlocksPerSizeClass = 64;
+const size_t kTransferBatchSize = kMaxFreeBlocksPerSizeClass / 2;
+
+// The number of free blocks that the depot keeps for each size class. (Any
+// further freed blocks are returned to the system allocator.)
+const size_t kMaxDepotBlocksPerSizeClass = 256;
+
+size_t GetBlockSize(uint32_t size_class) {
+  DCHECK_LT(size_class, kNumSizeClasses);
+  return static_cast<size_t>(1) << (kMinBlockSizeLog2 + size_class);
+}
+
+// Returns the smallest size class for a request for |size| bytes (plus the
+// header), or |kUnpooledSizeClass| if there's none.
+uint32_t GetSizeClass(size_t size) {
+  size_t block_size = static_cast<size_t>(1) << kMinBlockSizeLog2;
+  for (uint32_t size_class = 0; size_class < kNumSizeClasses; size_class++) {
+    if (size + sizeof(BlockHeader) <= block_size)
+      return size_class;
+    block_size <<= 1;
+  }
+  return kUnpooledSizeClass;
+}
+
+// A free block is linked into its free list using the space after its header.
+struct FreeBlock {
+  BlockHeader header;
+  FreeBlock* next;
+};
+
+// A list of free blocks (of a single size class).
+class FreeList {
+ public:
+  FreeList() : head_(nullptr), size_(0) {}
+
+  size_t size() const { return size_; }
+
+  void Push(FreeBlock* block) {
+    block->next = head_;
+    head_ = block;
+    size_++;
+  }
+
+  // Returns null if the list is empty.
+  FreeBlock* Pop() {
+    FreeBlock* block = head_;
+    if (block) {
+      head_ = block->next;
+      size_--;
+    }
+    return block;
+  }
+
+  // Moves up to |max_blocks| blocks from this list to |other|.
+  void MoveTo(FreeList* other, size_t max_blocks) {
+    for (size_t i = 0; i < max_blocks; i++) {
+      FreeBlock* block = Pop();
+      if (!block)
+        break;
+      other->Push(block);
+    }
+  }
+
+  // Returns all the blocks to the system allocator.
+  void FreeAll() {
+    while (FreeBlock* block = Pop())
+      base::AlignedFree(block);
+  }
+
+ private:
+  FreeBlock* head_;
+  size_t size_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(FreeList);
+};
+
+// The free lists shared by all threads. Threads only go to the depot in
+// batches, when their own free lists run empty or full. This lets blocks flow
+// between threads: e.g., messages are typically allocated on the sending thread
+// and freed on the I/O thread (or the other way around on the receiving side).
+class Depot {
+ public:
+  Depot() {}
+  ~Depot() {}
+
+  // Moves up to |kTransferBatchSize| blocks from the depot to |free_list|.
+  void Refill(uint32_t size_class, FreeList* free_list) {
+    MutexLocker locker(&mutex_);
+    free_lists_[size_class].MoveTo(free_list, kTransferBatchSize);
+  }
+
+  // Moves up to |max_blocks| blocks from |free_list| to the depot, returning
+  // the ones that don't fit to the system allocator.
+  void Drain(uint32_t size_class, FreeList* free_list, size_t max_blocks) {
+    size_t num_moved;
+    {
+      MutexLocker locker(&mutex_);
+      FreeList* depot_list = &free_lists_[size_class];
+      num_moved = std::min(
+          max_blocks, kMaxDepotBlocksPerSizeClass - depot_list->size());
+      free_list->MoveTo(depot_list, num_moved);
+    }
+    FreeList excess;
+    free_list->MoveTo(&excess, max_blocks - num_moved);
+    excess.FreeAll();
+  }
+
+  void FreeAllForTesting() {
+    MutexLocker locker(&mutex_);
+    for (uint32_t i = 0; i < kNumSizeClasses; i++)
+      free_lists_[i].FreeAll();
+  }
+
+ private:
+  Mutex mutex_;
+  FreeList free_lists_[kNumSizeClasses] MOJO_GUARDED_BY(mutex_);
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(Depot);
+};
+
+base::LazyInstance<Depot>::Leaky g_depot = LAZY_INSTANCE_INITIALIZER;
+
+// The free lists for a single thread.
+class ThreadCache {
+ public:
+  ThreadCache() {}
+
+  // Gives the thread's free blocks to the depot (so that they may be reused by
+  // other threads).
+  ~ThreadCache() {
+    for (uint32_t i = 0; i < kNumSizeClasses; i++)
+      g_depot.Get().Drain(i, &free_lists_[i], free_lists_[i].size());
+  }
+
+  // Takes a block of size class |size_class| from the free list (refilling it
+  // from the depot if it's empty), returning null if there's none.
+  FreeBlock* Take(uint32_t size_class) {
+    FreeList* free_list = &free_lists_[size_class];
+    if (!free_list->size())
+      g_depot.Get().Refill(size_class, free_list);
+    return free_list->Pop();
+  }
+
+  // Puts |block| on the appropriate free list (first moving some blocks to the
+  // depot if it's full).
+  void Put(FreeBlock* block) {
+    uint32_t size_class = block->header.size_class;
+    FreeList* free_list = &free_lists_[size_class];
+    if (free_list->size() >= kMaxFreeBlocksPerSizeClass)
+      g_depot.Get().Drain(size_class, free_list, kTransferBatchSize);
+    free_list->Push(block);
+  }
+
+ private:
+  FreeList free_lists_[kNumSizeClasses];
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ThreadCache);
+};
+
+void DeleteThreadCache(void* thread_cache) {
+  delete static_cast<ThreadCache*>(thread_cache);
+}
+
+struct ThreadCacheSlot {
+  ThreadCacheSlot() : slot(&DeleteThreadCache) {}
+
+  base::ThreadLocalStorage::Slot slot;
+};
+
+base::LazyInstance<ThreadCacheSlot>::Leaky g_thread_cache_slot =
+    LAZY_INSTANCE_INITIALIZER;
+
+ThreadCache* GetThreadCache() {
+  base::ThreadLocalStorage::Slot& slot = g_thread_cache_slot.Get().slot;
+  ThreadCache* thread_cache = static_cast<ThreadCache*>(slot.Get());
+  if (!thread_cache) {
+    thread_cache = new ThreadCache();
+    slot.Set(thread_cache);
+  }
+  return thread_cache;
+}
+
+// Note: |AtomicWord| is signed, but these never go negative.
+base::subtle::AtomicWord g_num_allocations = 0;
+base::subtle::AtomicWord g_num_hits = 0;
+base::subtle::AtomicWord g_num_unpooled_allocations = 0;
+
+}  // namespace
+
+// static
+MOJO_STATIC_CONST_MEMBER_DEFINITION const size_t
+    MessageInTransitBufferPool::kAlignment;
+
+// static
+const size_t MessageInTransitBufferPool::kMaxPooledSize =
+    (static_cast<size_t>(1) << (kMinBlockSizeLog2 + kNumSizeClasses - 1)) -
+    sizeof(BlockHeader);
+
+// static
+void* MessageInTransitBufferPool::Allocate(size_t size) {
+  base::subtle::NoBarrier_AtomicIncrement(&g_num_allocations, 1);
+
+  uint32_t size_class = GetSizeClass(size);
+  BlockHeader* header;
+  if (size_class == kUnpooledSizeClass) {
+    base::subtle::NoBarrier_AtomicIncrement(&g_num_unpooled_allocations, 1);
+    header = static_cast<BlockHeader*>(
+        base::AlignedAlloc(sizeof(BlockHeader) + size, kAlignment));
+  } else if (FreeBlock* block = GetThreadCache()->Take(size_class)) {
+    base::subtle::NoBarrier_AtomicIncrement(&g_num_hits, 1);
+    header = &block->header;
+    DCHECK_EQ(header->size_class, size_class);
+  } else {
+    header = static_cast<BlockHeader*>(
+        base::AlignedAlloc(GetBlockSize(size_class), kAlignment));
+  }
+  header->size_class = size_class;
+  return header + 1;
+}
+
+// static
+void MessageInTransitBufferPool::Free(void* ptr) {
+  if (!ptr)
+    return;
+
+  BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+  DCHECK_LE(header->size_class, kUnpooledSizeClass);
+  if (header->size_class == kUnpooledSizeClass)
+    base::AlignedFree(header);
+  else
+    GetThreadCache()->Put(reinterpret_cast<FreeBlock*>(header));
+}
+
+// static
+MessageInTransitBufferPool::Stats MessageInTransitBufferPool::GetStats() {
+  Stats rv;
+  rv.num_allocations = static_cast<size_t>(
+      base::subtle::NoBarrier_Load(&g_num_allocations));
+  rv.num_hits = static_cast<size_t>(base::subtle::NoBarrier_Load(&g_num_hits));
+  rv.num_unpooled_allocations = static_cast<size_t>(
+      base::subtle::NoBarrier_Load(&g_num_unpooled_allocations));
+  return rv;
+}
+
+// static
+void MessageInTransitBufferPool::ResetForTesting() {
+  base::ThreadLocalStorage::Slot& slot = g_thread_cache_slot.Get().slot;
+  delete static_cast<ThreadCache*>(slot.Get());
+  slot.Set(nullptr);
+  g_depot.Get().FreeAllForTesting();
+
+  base::subtle::NoBarrier_Store(&g_num_allocations, 0);
+  base::subtle::NoBarrier_Store(&g_num_hits, 0);
+  base::subtle::NoBarrier_Store(&g_num_unpooled_allocations, 0);
+}
+
+}  // namespace system
+}  // namespace mojo
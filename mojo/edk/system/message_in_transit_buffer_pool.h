@@ -0,0 +1,74 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_BUFFER_POOL_H_
+#define MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_BUFFER_POOL_H_
+
+#include <stddef.h>
+
+#include "mojo/edk/system/system_impl_export.h"
+
+namespace mojo {
+namespace system {
+
+// |MessageInTransitBufferPool| provides the memory for |MessageInTransit|s:
+// the objects themselves, their main buffers, and their |TransportData|
+// buffers.
+//
+// Small requests are rounded up to one of a few power-of-two size classes,
+// and freed blocks are kept on per-thread free lists (of bounded length), so
+// that steady-state message passing doesn't need to go to the system
+// allocator at all. Per-thread free lists that overflow move batches of blocks
+// to a shared (locked) depot of bounded size, from which empty ones are
+// refilled, so blocks that are allocated on one thread and freed on another
+// are still reused. Requests that are too large to be pooled are passed
+// straight through to the system allocator.
+//
+// All blocks are |kAlignment|-byte aligned.
+//
+// This class is thread-safe (the free lists are thread-local, the depot is
+// protected by a mutex, and the statistics are maintained atomically).
+class MOJO_SYSTEM_IMPL_EXPORT MessageInTransitBufferPool {
+ public:
+  static const size_t kAlignment = 8;
+
+  // The largest request that may be satisfied from a free list.
+  static const size_t kMaxPooledSize;
+
+  // Process-wide statistics, for monitoring the pool's hit rate.
+  struct Stats {
+    // Total number of calls to |Allocate()|.
+    size_t num_allocations;
+    // Number of allocations satisfied from a free list or the depot (the rest
+    // went to the system allocator).
+    size_t num_hits;
+    // Number of allocations that were too large to be pooled.
+    size_t num_unpooled_allocations;
+  };
+
+  // Deleter for |scoped_ptr|s to memory from |Allocate()|.
+  struct Deleter {
+    inline void operator()(void* ptr) const { Free(ptr); }
+  };
+
+  // Allocates a block of at least |size| bytes. Never returns null.
+  static void* Allocate(size_t size);
+
+  // Frees a block allocated by |Allocate()|. |ptr| may be null.
+  static void Free(void* ptr);
+
+  static Stats GetStats();
+
+  // Resets the statistics (to zero) and releases the current thread's free
+  // lists and the depot. For use by tests.
+  static void ResetForTesting();
+
+ private:
+  MessageInTransitBufferPool() = delete;
+};
+
+}  // namespace system
+}  // namespace mojo
+
+#endif  // MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_BUFFER_POOL_H_
@@ -0,0 +1,159 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/edk/system/message_in_transit_buffer_pool.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "mojo/edk/system/message_in_transit.h"
+#include "mojo/edk/system/message_in_transit_queue.h"
+#include "mojo/edk/system/message_in_transit_test_utils.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace system {
+namespace {
+
+class MessageInTransitBufferPoolTest : public testing::Test {
+ public:
+  MessageInTransitBufferPoolTest() {}
+  ~MessageInTransitBufferPoolTest() override {}
+
+  void SetUp() override { MessageInTransitBufferPool::ResetForTesting(); }
+  void TearDown() override { MessageInTransitBufferPool::ResetForTesting(); }
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(MessageInTransitBufferPoolTest);
+};
+
+TEST_F(MessageInTransitBufferPoolTest, AllocateAndFree) {
+  const size_t kSizes[] = {0u, 1u, 8u, 56u, 57u, 100u, 1000u,
+                           MessageInTransitBufferPool::kMaxPooledSize,
+                           MessageInTransitBufferPool::kMaxPooledSize + 1,
+                           100000u};
+  for (size_t i = 0; i < MOJO_ARRAYSIZE(kSizes); i++) {
+    void* ptr = MessageInTransitBufferPool::Allocate(kSizes[i]);
+    ASSERT_TRUE(ptr);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ptr) %
+                      MessageInTransitBufferPool::kAlignment);
+    // The whole block should be writable.
+    memset(ptr, 'x', kSizes[i]);
+    MessageInTransitBufferPool::Free(ptr);
+  }
+  MessageInTransitBufferPool::Free(nullptr);
+
+  MessageInTransitBufferPool::Stats stats =
+      MessageInTransitBufferPool::GetStats();
+  EXPECT_EQ(MOJO_ARRAYSIZE(kSizes), stats.num_allocations);
+  EXPECT_EQ(2u, stats.num_unpooled_allocations);
+}
+
+TEST_F(MessageInTransitBufferPoolTest, Reuse) {
+  void* ptr1 = MessageInTransitBufferPool::Allocate(100);
+  MessageInTransitBufferPool::Free(ptr1);
+  // A request in the same size class should get the same block back.
+  void* ptr2 = MessageInTransitBufferPool::Allocate(90);
+  EXPECT_EQ(ptr1, ptr2);
+  MessageInTransitBufferPool::Free(ptr2);
+
+  MessageInTransitBufferPool::Stats stats =
+      MessageInTransitBufferPool::GetStats();
+  EXPECT_EQ(2u, stats.num_allocations);
+  EXPECT_EQ(1u, stats.num_hits);
+  EXPECT_EQ(0u, stats.num_unpooled_allocations);
+
+  // Unpooled blocks aren't reused.
+  ptr1 = MessageInTransitBufferPool::Allocate(
+      MessageInTransitBufferPool::kMaxPooledSize + 1);
+  MessageInTransitBufferPool::Free(ptr1);
+  ptr1 = MessageInTransitBufferPool::Allocate(
+      MessageInTransitBufferPool::kMaxPooledSize + 1);
+  MessageInTransitBufferPool::Free(ptr1);
+  stats = MessageInTransitBufferPool::GetStats();
+  EXPECT_EQ(4u, stats.num_allocations);
+  EXPECT_EQ(1u, stats.num_hits);
+  EXPECT_EQ(2u, stats.num_unpooled_allocations);
+}
+
+// Tests that, once warmed up, passing (small) messages through a queue doesn't
+// need any allocations that aren't satisfied by the pool.
+TEST_F(MessageInTransitBufferPoolTest, SteadyStateMessages) {
+  const size_t kQueueLength = 10;
+  const size_t kNumMessages = 1000;
+
+  MessageInTransitQueue queue;
+  for (size_t i = 0; i < kQueueLength; i++)
+    queue.AddMessage(test::MakeTestMessage(static_cast<unsigned>(i)));
+  for (size_t i = 0; i < kQueueLength; i++)
+    queue.DiscardMessage();
+
+  MessageInTransitBufferPool::Stats before =
+      MessageInTransitBufferPool::GetStats();
+  for (size_t i = 0; i < kNumMessages; i++) {
+    queue.AddMessage(test::MakeTestMessage(static_cast<unsigned>(i)));
+    if (queue.Size() == kQueueLength) {
+      for (size_t j = i + 1 - kQueueLength; j <= i; j++)
+        test::VerifyTestMessage(queue.GetMessage().get(),
+                                static_cast<unsigned>(j));
+    }
+  }
+  MessageInTransitBufferPool::Stats after =
+      MessageInTransitBufferPool::GetStats();
+
+  // Each message needs (at least) the object and its main buffer.
+  EXPECT_GE(after.num_allocations - before.num_allocations, 2 * kNumMessages);
+  EXPECT_EQ(after.num_allocations - before.num_allocations,
+            after.num_hits - before.num_hits);
+}
+
+void FreeBlocks(std::vector<void*>* blocks, base::WaitableEvent* done_event) {
+  for (void* block : *blocks)
+    MessageInTransitBufferPool::Free(block);
+  blocks->clear();
+  done_event->Signal();
+}
+
+// Tests that blocks allocated on one thread and freed on another (which keeps
+// running, like an I/O thread) are reused by the allocating thread.
+TEST_F(MessageInTransitBufferPoolTest, FreeOnOtherThread) {
+  const size_t kNumBlocks = 200;
+  const size_t kBlockSize = 100;
+
+  base::Thread freeing_thread("FreeingThread");
+  ASSERT_TRUE(freeing_thread.Start());
+  for (size_t round = 0; round < 3; round++) {
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < kNumBlocks; i++)
+      blocks.push_back(MessageInTransitBufferPool::Allocate(kBlockSize));
+
+    base::WaitableEvent done_event(false, false);
+    freeing_thread.task_runner()->PostTask(
+        FROM_HERE, base::Bind(&FreeBlocks, &blocks, &done_event));
+    done_event.Wait();
+  }
+
+  // The first round's allocations all went to the system allocator. Later
+  // rounds get most of their blocks back from the freeing thread (which keeps
+  // some on its own free list).
+  MessageInTransitBufferPool::Stats stats =
+      MessageInTransitBufferPool::GetStats();
+  EXPECT_EQ(3 * kNumBlocks, stats.num_allocations);
+  EXPECT_GE(stats.num_hits, kNumBlocks);
+  EXPECT_EQ(0u, stats.num_unpooled_allocations);
+
+  freeing_thread.Stop();
+}
+
+}  // namespace
+}  // namespace system
+}  // namespace mojo
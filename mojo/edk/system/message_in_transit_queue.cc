@@ -4,12 +4,15 @@
 
 #include "mojo/edk/system/message_in_transit_queue.h"
 
+#include <algorithm>
+
 #include "base/logging.h"
 
 namespace mojo {
 namespace system {
 
-MessageInTransitQueue::MessageInTransitQueue() {
+MessageInTransitQueue::MessageInTransitQueue()
+    : head_(nullptr), tail_(nullptr), size_(0) {
 }
 
 MessageInTransitQueue::~MessageInTransitQueue() {
@@ -20,13 +23,14 @@ MessageInTransitQueue::~MessageInTransitQueue() {
 }
 
 void MessageInTransitQueue::Clear() {
-  for (auto* message : queue_)
-    delete message;
-  queue_.clear();
+  while (!IsEmpty())
+    DiscardMessage();
 }
 
 void MessageInTransitQueue::Swap(MessageInTransitQueue* other) {
-  queue_.swap(other->queue_);
+  std::swap(head_, other->head_);
+  std::swap(tail_, other->tail_);
+  std::swap(size_, other->size_);
 }
 
 }  // namespace system
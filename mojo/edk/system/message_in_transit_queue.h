@@ -5,8 +5,9 @@
 #ifndef MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_QUEUE_H_
 #define MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_QUEUE_H_
 
-#include <deque>
+#include <stddef.h>
 
+#include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "mojo/edk/system/message_in_transit.h"
 #include "mojo/edk/system/system_impl_export.h"
@@ -15,33 +16,56 @@
 namespace mojo {
 namespace system {
 
-// A simple queue for |MessageInTransit|s (that owns its messages).
+// A simple queue for |MessageInTransit|s (that owns its messages). The queue
+// is intrusive (linked through the messages themselves), so adding and
+// removing messages never allocates. A message may be on at most one queue at
+// a time.
 // This class is not thread-safe.
 class MOJO_SYSTEM_IMPL_EXPORT MessageInTransitQueue {
  public:
   MessageInTransitQueue();
   ~MessageInTransitQueue();
 
-  bool IsEmpty() const { return queue_.empty(); }
-  size_t Size() const { return queue_.size(); }
+  bool IsEmpty() const { return !head_; }
+  size_t Size() const { return size_; }
 
   void AddMessage(scoped_ptr<MessageInTransit> message) {
-    queue_.push_back(message.release());
+    MessageInTransit* m = message.release();
+    DCHECK(!m->next_in_queue_);
+    if (tail_)
+      tail_->next_in_queue_ = m;
+    else
+      head_ = m;
+    tail_ = m;
+    size_++;
   }
 
   scoped_ptr<MessageInTransit> GetMessage() {
-    MessageInTransit* rv = queue_.front();
-    queue_.pop_front();
+    DCHECK(head_);
+    MessageInTransit* rv = head_;
+    head_ = rv->next_in_queue_;
+    if (!head_)
+      tail_ = nullptr;
+    rv->next_in_queue_ = nullptr;
+    size_--;
     return make_scoped_ptr(rv);
   }
 
-  const MessageInTransit* PeekMessage() const { return queue_.front(); }
-  MessageInTransit* PeekMessage() { return queue_.front(); }
+  const MessageInTransit* PeekMessage() const { return head_; }
+  MessageInTransit* PeekMessage() { return head_; }
 
-  void DiscardMessage() {
-    delete queue_.front();
-    queue_.pop_front();
+  // Returns the message after |message| (which must be in this queue), or null
+  // if |message| is the last one. Together with |PeekMessage()|, this allows
+  // the queue to be traversed from front to back.
+  const MessageInTransit* PeekMessageAfter(
+      const MessageInTransit* message) const {
+    return message->next_in_queue_;
   }
+  MessageInTransit* PeekMessageAfter(MessageInTransit* message) {
+    return message->next_in_queue_;
+  }
+
+  void DiscardMessage() { GetMessage(); }
 
   void Clear();
 
@@ -49,9 +73,9 @@ class MOJO_SYSTEM_IMPL_EXPORT MessageInTransitQueue {
   void Swap(MessageInTransitQueue* other);
 
  private:
-  // TODO(vtl): When C++11 is available, switch this to a deque of
-  // |scoped_ptr|/|unique_ptr|s.
-  std::deque<MessageInTransit*> queue_;
+  MessageInTransit* head_;  // Null if empty.
+  MessageInTransit* tail_;  // Null if empty.
+  size_t size_;
 
   MOJO_DISALLOW_COPY_AND_ASSIGN(MessageInTransitQueue);
 };
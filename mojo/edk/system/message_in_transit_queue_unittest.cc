@@ -86,6 +86,47 @@ TEST(MessageInTransitQueueTest, Swap) {
   EXPECT_TRUE(queue1.IsEmpty());
 }
 
+TEST(MessageInTransitQueueTest, PeekMessageAfter) {
+  MessageInTransitQueue queue;
+  queue.AddMessage(test::MakeTestMessage(1));
+  queue.AddMessage(test::MakeTestMessage(2));
+  queue.AddMessage(test::MakeTestMessage(3));
+
+  MessageInTransit* message = queue.PeekMessage();
+  test::VerifyTestMessage(message, 1);
+  message = queue.PeekMessageAfter(message);
+  test::VerifyTestMessage(message, 2);
+  message = queue.PeekMessageAfter(message);
+  test::VerifyTestMessage(message, 3);
+  EXPECT_FALSE(queue.PeekMessageAfter(message));
+
+  // Removing the first message and adding another should leave the links
+  // consistent.
+  queue.DiscardMessage();
+  queue.AddMessage(test::MakeTestMessage(4));
+  EXPECT_EQ(3u, queue.Size());
+  message = queue.PeekMessage();
+  test::VerifyTestMessage(message, 2);
+  message = queue.PeekMessageAfter(message);
+  test::VerifyTestMessage(message, 3);
+  message = queue.PeekMessageAfter(message);
+  test::VerifyTestMessage(message, 4);
+  EXPECT_FALSE(queue.PeekMessageAfter(message));
+
+  // A message taken off one queue may be put on another.
+  MessageInTransitQueue other_queue;
+  while (!queue.IsEmpty())
+    other_queue.AddMessage(queue.GetMessage());
+  EXPECT_EQ(3u, other_queue.Size());
+  message = other_queue.PeekMessage();
+  test::VerifyTestMessage(message, 2);
+  message = other_queue.PeekMessageAfter(message);
+  test::VerifyTestMessage(message, 3);
+  message = other_queue.PeekMessageAfter(message);
+  test::VerifyTestMessage(message, 4);
+  EXPECT_FALSE(other_queue.PeekMessageAfter(message));
+}
+
 }  // namespace
 }  // namespace system
 }  // namespace mojo
@@ -0,0 +1,81 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/edk/system/message_in_transit_ring.h"
+
+#include "base/threading/platform_thread.h"
+
+namespace mojo {
+namespace system {
+
+// static
+const size_t MessageInTransitRing::kCapacity;
+
+MessageInTransitRing::MessageInTransitRing()
+    : num_messages_(0), head_(0), tail_(0), busy_(0), is_paused_(false) {
+  for (size_t i = 0; i < kCapacity; i++)
+    slots_[i] = nullptr;
+}
+
+MessageInTransitRing::~MessageInTransitRing() {
+  DCHECK_EQ(base::subtle::NoBarrier_Load(&busy_), is_paused_ ? 1 : 0);
+  if (!IsEmpty()) {
+    LOG(WARNING) << "Destroying nonempty message ring";
+    Clear();
+  }
+}
+
+bool MessageInTransitRing::TryAddMessage(scoped_ptr<MessageInTransit>* message,
+                                         bool* was_empty) {
+  DCHECK(*message);
+  // Messages with dispatchers attached never go through the ring.
+  DCHECK(!(*message)->has_dispatchers());
+
+  if (base::subtle::Acquire_CompareAndSwap(&busy_, 0, 1) != 0)
+    return false;
+
+  bool added = false;
+  if (static_cast<size_t>(base::subtle::Acquire_Load(&num_messages_)) <
+      kCapacity) {
+    DCHECK(!slots_[tail_]);
+    slots_[tail_] = message->release();
+    tail_ = (tail_ + 1) % kCapacity;
+    *was_empty = base::subtle::Barrier_AtomicIncrement(&num_messages_, 1) == 1;
+    added = true;
+  }
+
+  base::subtle::Release_Store(&busy_, 0);
+  return added;
+}
+
+scoped_ptr<MessageInTransit> MessageInTransitRing::GetMessage() {
+  DCHECK(!IsEmpty());
+  MessageInTransit* rv = slots_[head_];
+  slots_[head_] = nullptr;
+  head_ = (head_ + 1) % kCapacity;
+  base::subtle::Barrier_AtomicIncrement(&num_messages_, -1);
+  return make_scoped_ptr(rv);
+}
+
+void MessageInTransitRing::Clear() {
+  while (!IsEmpty())
+    DiscardMessage();
+}
+
+void MessageInTransitRing::Pause() {
+  DCHECK(!is_paused_);
+  // A producer only holds |busy_| for a few instructions, so just spin.
+  while (base::subtle::Acquire_CompareAndSwap(&busy_, 0, 1) != 0)
+    base::PlatformThread::YieldCurrentThread();
+  is_paused_ = true;
+}
+
+void MessageInTransitRing::Resume() {
+  DCHECK(is_paused_);
+  is_paused_ = false;
+  base::subtle::Release_Store(&busy_, 0);
+}
+
+}  // namespace system
+}  // namespace mojo
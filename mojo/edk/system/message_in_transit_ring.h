@@ -0,0 +1,95 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_RING_H_
+#define MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_RING_H_
+
+#include <stddef.h>
+
+#include "base/atomicops.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "mojo/edk/system/message_in_transit.h"
+#include "mojo/edk/system/system_impl_export.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace system {
+
+// A bounded single-producer/single-consumer ring of |MessageInTransit|s (that
+// owns its messages), used to pass messages between the two local endpoints of
+// a |MessagePipe| without taking the |MessagePipe|'s lock (see
+// |MessagePipe::WriteMessage()|).
+//
+// The producer side, |TryAddMessage()|, may be called on any thread without
+// any lock held. Producers exclude one another using a "busy" flag: a producer
+// that finds the flag set (or the ring full) fails, and should fall back to
+// queueing its message some other (slower, locked) way.
+//
+// Everything else (the consumer side, |Pause()|, and |Resume()|) must be called
+// under a lock (in practice, the |MessagePipe|'s), so that there's only one
+// consumer at a time.
+class MOJO_SYSTEM_IMPL_EXPORT MessageInTransitRing {
+ public:
+  static const size_t kCapacity = 64;
+
+  MessageInTransitRing();
+  ~MessageInTransitRing();
+
+  // Producer side:
+
+  // Adds |*message| to the ring, taking ownership of it, unless the ring is
+  // full or paused, or another message is being added concurrently, in which
+  // case this returns false (and leaves |*message| alone). On success, sets
+  // |*was_empty| to whether the ring was empty before (in which case the
+  // consumer may have to be woken up).
+  bool TryAddMessage(scoped_ptr<MessageInTransit>* message, bool* was_empty);
+
+  // Consumer side:
+
+  bool IsEmpty() const {
+    return base::subtle::Acquire_Load(&num_messages_) == 0;
+  }
+
+  // Returns the oldest message (which remains in the ring), or null if the
+  // ring is empty.
+  MessageInTransit* PeekMessage() {
+    return IsEmpty() ? nullptr : slots_[head_];
+  }
+
+  scoped_ptr<MessageInTransit> GetMessage();
+  void DiscardMessage() { GetMessage(); }
+
+  void Clear();
+
+  // Pauses the producer side: waits for any |TryAddMessage()| in progress to
+  // complete, after which |TryAddMessage()| fails until |Resume()| is called.
+  // (A ring that's paused and never resumed is effectively disabled.)
+  void Pause();
+  void Resume();
+  bool is_paused() const { return is_paused_; }
+
+ private:
+  MessageInTransit* slots_[kCapacity];
+  // The number of messages in the ring. Incremented by the producer (after
+  // filling a slot) and decremented by the consumer (after emptying one), so
+  // that it also publishes the slots to the other side.
+  base::subtle::Atomic32 num_messages_;
+  // The index of the oldest message. Only used by the consumer.
+  size_t head_;
+  // The index of the next slot to fill. Only used by the producer holding
+  // |busy_|.
+  size_t tail_;
+  // Nonzero while a producer is adding a message, or while the ring is paused.
+  base::subtle::Atomic32 busy_;
+  // Only used by the consumer side.
+  bool is_paused_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(MessageInTransitRing);
+};
+
+}  // namespace system
+}  // namespace mojo
+
+#endif  // MOJO_EDK_SYSTEM_MESSAGE_IN_TRANSIT_RING_H_
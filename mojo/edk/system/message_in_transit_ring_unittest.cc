@@ -0,0 +1,163 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/edk/system/message_in_transit_ring.h"
+
+#include "base/threading/platform_thread.h"
+#include "base/threading/simple_thread.h"
+#include "mojo/edk/system/message_in_transit_test_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace system {
+namespace {
+
+TEST(MessageInTransitRingTest, Basic) {
+  MessageInTransitRing ring;
+  EXPECT_TRUE(ring.IsEmpty());
+  EXPECT_FALSE(ring.PeekMessage());
+
+  bool was_empty = false;
+  scoped_ptr<MessageInTransit> message = test::MakeTestMessage(1);
+  EXPECT_TRUE(ring.TryAddMessage(&message, &was_empty));
+  EXPECT_FALSE(message);
+  EXPECT_TRUE(was_empty);
+  ASSERT_FALSE(ring.IsEmpty());
+
+  message = test::MakeTestMessage(2);
+  EXPECT_TRUE(ring.TryAddMessage(&message, &was_empty));
+  EXPECT_FALSE(was_empty);
+
+  test::VerifyTestMessage(ring.PeekMessage(), 1);
+  test::VerifyTestMessage(ring.GetMessage().get(), 1);
+  test::VerifyTestMessage(ring.PeekMessage(), 2);
+  ring.DiscardMessage();
+  EXPECT_TRUE(ring.IsEmpty());
+
+  message = test::MakeTestMessage(3);
+  EXPECT_TRUE(ring.TryAddMessage(&message, &was_empty));
+  EXPECT_TRUE(was_empty);
+  ring.Clear();
+  EXPECT_TRUE(ring.IsEmpty());
+}
+
+TEST(MessageInTransitRingTest, Full) {
+  static const unsigned kCapacity =
+      static_cast<unsigned>(MessageInTransitRing::kCapacity);
+
+  MessageInTransitRing ring;
+  bool was_empty = false;
+
+  // Fill the ring and then remove half of the messages, a few times, so that
+  // it wraps around.
+  unsigned next_to_add = 0;
+  unsigned next_to_get = 0;
+  for (unsigned i = 0; i < 3; i++) {
+    while (next_to_add - next_to_get < kCapacity) {
+      scoped_ptr<MessageInTransit> message =
+          test::MakeTestMessage(next_to_add++);
+      EXPECT_TRUE(ring.TryAddMessage(&message, &was_empty));
+    }
+
+    // It's full now, so adding fails (and leaves the message alone).
+    scoped_ptr<MessageInTransit> message = test::MakeTestMessage(12345);
+    EXPECT_FALSE(ring.TryAddMessage(&message, &was_empty));
+    test::VerifyTestMessage(message.get(), 12345);
+
+    while (next_to_add - next_to_get > kCapacity / 2)
+      test::VerifyTestMessage(ring.GetMessage().get(), next_to_get++);
+  }
+
+  while (!ring.IsEmpty())
+    test::VerifyTestMessage(ring.GetMessage().get(), next_to_get++);
+  EXPECT_EQ(next_to_add, next_to_get);
+}
+
+TEST(MessageInTransitRingTest, PauseResume) {
+  MessageInTransitRing ring;
+  bool was_empty = false;
+
+  scoped_ptr<MessageInTransit> message = test::MakeTestMessage(1);
+  EXPECT_TRUE(ring.TryAddMessage(&message, &was_empty));
+
+  ring.Pause();
+  EXPECT_TRUE(ring.is_paused());
+  message = test::MakeTestMessage(2);
+  EXPECT_FALSE(ring.TryAddMessage(&message, &was_empty));
+  test::VerifyTestMessage(message.get(), 2);
+
+  // The consumer side still works while paused.
+  test::VerifyTestMessage(ring.GetMessage().get(), 1);
+  EXPECT_TRUE(ring.IsEmpty());
+
+  ring.Resume();
+  EXPECT_FALSE(ring.is_paused());
+  EXPECT_TRUE(ring.TryAddMessage(&message, &was_empty));
+  EXPECT_TRUE(was_empty);
+  test::VerifyTestMessage(ring.GetMessage().get(), 2);
+
+  // Leave it paused (i.e., disabled) with a message in it.
+  message = test::MakeTestMessage(3);
+  EXPECT_TRUE(ring.TryAddMessage(&message, &was_empty));
+  ring.Pause();
+}
+
+// Adds |num_messages| test messages (with IDs 0, 1, ...) to a ring, retrying
+// whenever the ring is full or paused.
+class ProducerThread : public base::SimpleThread {
+ public:
+  ProducerThread(MessageInTransitRing* ring, unsigned num_messages)
+      : base::SimpleThread("producer_thread"),
+        ring_(ring),
+        num_messages_(num_messages) {}
+  ~ProducerThread() override { Join(); }
+
+ private:
+  void Run() override {
+    for (unsigned i = 0; i < num_messages_; i++) {
+      scoped_ptr<MessageInTransit> message = test::MakeTestMessage(i);
+      bool was_empty = false;
+      while (!ring_->TryAddMessage(&message, &was_empty))
+        base::PlatformThread::YieldCurrentThread();
+    }
+  }
+
+  MessageInTransitRing* const ring_;
+  const unsigned num_messages_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ProducerThread);
+};
+
+TEST(MessageInTransitRingTest, Threaded) {
+  static const unsigned kNumMessages = 10000;
+
+  MessageInTransitRing ring;
+  {
+    ProducerThread thread(&ring, kNumMessages);
+    thread.Start();
+
+    // Consume the messages, pausing and resuming the ring every so often.
+    unsigned next_id = 0;
+    for (unsigned i = 0; next_id < kNumMessages; i++) {
+      bool pause = i % 8 == 0;
+      if (pause)
+        ring.Pause();
+      while (!ring.IsEmpty()) {
+        unsigned id = 0;
+        scoped_ptr<MessageInTransit> message = ring.GetMessage();
+        EXPECT_TRUE(test::IsTestMessage(message.get(), &id));
+        EXPECT_EQ(next_id, id);
+        next_id++;
+      }
+      if (pause)
+        ring.Resume();
+      base::PlatformThread::YieldCurrentThread();
+    }
+  }  // Joins |thread|.
+  EXPECT_TRUE(ring.IsEmpty());
+}
+
+}  // namespace
+}  // namespace system
+}  // namespace mojo
@@ -11,6 +11,7 @@
 #include "mojo/edk/system/incoming_endpoint.h"
 #include "mojo/edk/system/local_message_pipe_endpoint.h"
 #include "mojo/edk/system/message_in_transit.h"
+#include "mojo/edk/system/message_in_transit_ring.h"
 #include "mojo/edk/system/message_pipe_dispatcher.h"
 #include "mojo/edk/system/message_pipe_endpoint.h"
 #include "mojo/edk/system/proxy_message_pipe_endpoint.h"
@@ -21,8 +22,11 @@ namespace system {
 // static
 MessagePipe* MessagePipe::CreateLocalLocal() {
   MessagePipe* message_pipe = new MessagePipe();
-  message_pipe->endpoints_[0].reset(new LocalMessagePipeEndpoint());
-  message_pipe->endpoints_[1].reset(new LocalMessagePipeEndpoint());
+  for (unsigned port = 0; port < 2; port++) {
+    message_pipe->incoming_rings_[port].reset(new MessageInTransitRing());
+    message_pipe->endpoints_[port].reset(new LocalMessagePipeEndpoint(
+        nullptr, message_pipe->incoming_rings_[port].get()));
+  }
   return message_pipe;
 }
 
@@ -148,13 +152,33 @@ MojoResult MessagePipe::WriteMessage(
     MojoWriteMessageFlags flags) {
   DCHECK(port == 0 || port == 1);
 
+  unsigned peer_port = GetPeerPort(port);
+  scoped_ptr<MessageInTransit> message(new MessageInTransit(
+      MessageInTransit::Type::ENDPOINT_CLIENT,
+      MessageInTransit::Subtype::ENDPOINT_CLIENT_DATA, num_bytes, bytes));
+
+  // Fast path: The ring is paused whenever it can't be used (e.g., if the peer
+  // port was closed or serialized, or if it has messages queued the slow way,
+  // which must not be overtaken), in which case this fails.
+  MessageInTransitRing* peer_ring = incoming_rings_[peer_port].get();
+  bool was_empty = false;
+  if (peer_ring && !transports &&
+      peer_ring->TryAddMessage(&message, &was_empty)) {
+    if (was_empty) {
+      base::AutoLock locker(lock_);
+      // The peer port may have been closed or serialized meanwhile, in which
+      // case the message was already dealt with.
+      if (endpoints_[peer_port] &&
+          endpoints_[peer_port]->GetType() == MessagePipeEndpoint::kTypeLocal) {
+        static_cast<LocalMessagePipeEndpoint*>(endpoints_[peer_port].get())
+            ->OnIncomingRingMessageAdded();
+      }
+    }
+    return MOJO_RESULT_OK;
+  }
+
   base::AutoLock locker(lock_);
-  return EnqueueMessageNoLock(
-      GetPeerPort(port),
-      make_scoped_ptr(new MessageInTransit(
-          MessageInTransit::Type::ENDPOINT_CLIENT,
-          MessageInTransit::Subtype::ENDPOINT_CLIENT_DATA, num_bytes, bytes)),
-      transports);
+  return EnqueueMessageNoLock(peer_port, message.Pass(), transports);
 }
 
 MojoResult MessagePipe::ReadMessage(unsigned port,
@@ -32,6 +32,7 @@ class Awakable;
 class Channel;
 class ChannelEndpoint;
 class MessageInTransitQueue;
+class MessageInTransitRing;
 
 // |MessagePipe| is the secondary object implementing a message pipe (see the
 // explanatory comment in core.cc). It is typically owned by the dispatcher(s)
@@ -84,7 +85,9 @@ class MOJO_SYSTEM_IMPL_EXPORT MessagePipe final : public ChannelEndpointClient {
   void CancelAllAwakables(unsigned port);
   void Close(unsigned port);
   // Unlike |MessagePipeDispatcher::WriteMessage()|, this does not validate its
-  // arguments.
+  // arguments. If both endpoints are local, a message without handles is
+  // normally put on the incoming ring of the peer port without taking |lock_|
+  // (which is then only taken to wake up the peer if the ring was empty).
   MojoResult WriteMessage(unsigned port,
                           UserPointer<const void> bytes,
                           uint32_t num_bytes,
@@ -136,6 +139,12 @@ class MOJO_SYSTEM_IMPL_EXPORT MessagePipe final : public ChannelEndpointClient {
       MessageInTransit* message,
       std::vector<DispatcherTransport>* transports);
 
+  // The rings of messages written to each port by the other one, if they were
+  // both created local (see |WriteMessage()|). These are set on creation and
+  // then never changed (so the pointers may be read without |lock_|), but
+  // their consumer sides are protected by |lock_|.
+  scoped_ptr<MessageInTransitRing> incoming_rings_[2];
+
   base::Lock lock_;  // Protects the following members.
   scoped_ptr<MessagePipeEndpoint> endpoints_[2];
 
@@ -5,6 +5,7 @@
 #include "mojo/edk/system/message_pipe.h"
 
 #include "base/memory/ref_counted.h"
+#include "base/threading/simple_thread.h"
 #include "mojo/edk/system/waiter.h"
 #include "mojo/edk/system/waiter_test_utils.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -567,6 +568,125 @@ TEST(MessagePipeTest, ThreadedWaiting) {
   EXPECT_EQ(4u, context);
 }
 
+// Tests that many messages, more than fit on the fast path between local
+// endpoints, are received in order (also when partially read in between).
+TEST(MessagePipeTest, ManyMessages) {
+  static const int32_t kNumMessages = 1000;
+
+  scoped_refptr<MessagePipe> mp(MessagePipe::CreateLocalLocal());
+
+  int32_t next_to_write = 0;
+  int32_t next_to_read = 0;
+  for (int i = 0; i < 3; i++) {
+    for (int32_t j = 0; j < kNumMessages; j++) {
+      EXPECT_EQ(MOJO_RESULT_OK,
+                mp->WriteMessage(0, UserPointer<const void>(&next_to_write),
+                                 static_cast<uint32_t>(sizeof(next_to_write)),
+                                 nullptr, MOJO_WRITE_MESSAGE_FLAG_NONE));
+      next_to_write++;
+    }
+
+    // Read all but a few (only all of them at the end).
+    while (next_to_write - next_to_read > (i < 2 ? 10 : 0)) {
+      int32_t buffer = -1;
+      uint32_t buffer_size = 0;
+      // Too small a buffer leaves the message in place.
+      EXPECT_EQ(MOJO_RESULT_RESOURCE_EXHAUSTED,
+                mp->ReadMessage(1, NullUserPointer(),
+                                MakeUserPointer(&buffer_size), 0, nullptr,
+                                MOJO_READ_MESSAGE_FLAG_NONE));
+      EXPECT_EQ(static_cast<uint32_t>(sizeof(buffer)), buffer_size);
+      EXPECT_EQ(MOJO_RESULT_OK,
+                mp->ReadMessage(1, UserPointer<void>(&buffer),
+                                MakeUserPointer(&buffer_size), 0, nullptr,
+                                MOJO_READ_MESSAGE_FLAG_NONE));
+      EXPECT_EQ(next_to_read, buffer);
+      next_to_read++;
+    }
+  }
+
+  uint32_t buffer_size = 0;
+  EXPECT_EQ(MOJO_RESULT_SHOULD_WAIT,
+            mp->ReadMessage(1, NullUserPointer(), MakeUserPointer(&buffer_size),
+                            0, nullptr, MOJO_READ_MESSAGE_FLAG_NONE));
+
+  // Leave some messages unread when closing.
+  for (int32_t j = 0; j < kNumMessages; j++) {
+    EXPECT_EQ(MOJO_RESULT_OK,
+              mp->WriteMessage(0, UserPointer<const void>(&j),
+                               static_cast<uint32_t>(sizeof(j)), nullptr,
+                               MOJO_WRITE_MESSAGE_FLAG_NONE));
+  }
+  mp->Close(0);
+  mp->Close(1);
+}
+
+// Writes |num_messages| messages (consisting of 0, 1, ...) to port 0 of a
+// message pipe.
+class WriterThread : public base::SimpleThread {
+ public:
+  WriterThread(scoped_refptr<MessagePipe> mp, int32_t num_messages)
+      : base::SimpleThread("writer_thread"),
+        mp_(mp),
+        num_messages_(num_messages) {}
+  ~WriterThread() override { Join(); }
+
+ private:
+  void Run() override {
+    for (int32_t i = 0; i < num_messages_; i++) {
+      EXPECT_EQ(MOJO_RESULT_OK,
+                mp_->WriteMessage(0, UserPointer<const void>(&i),
+                                  static_cast<uint32_t>(sizeof(i)), nullptr,
+                                  MOJO_WRITE_MESSAGE_FLAG_NONE));
+    }
+  }
+
+  const scoped_refptr<MessagePipe> mp_;
+  const int32_t num_messages_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(WriterThread);
+};
+
+TEST(MessagePipeTest, ThreadedWriteRead) {
+  static const int32_t kNumMessages = 100000;
+
+  scoped_refptr<MessagePipe> mp(MessagePipe::CreateLocalLocal());
+  {
+    WriterThread thread(mp, kNumMessages);
+    thread.Start();
+
+    for (int32_t i = 0; i < kNumMessages;) {
+      int32_t buffer = -1;
+      uint32_t buffer_size = static_cast<uint32_t>(sizeof(buffer));
+      MojoResult result = mp->ReadMessage(1, UserPointer<void>(&buffer),
+                                          MakeUserPointer(&buffer_size), 0,
+                                          nullptr, MOJO_READ_MESSAGE_FLAG_NONE);
+      if (result == MOJO_RESULT_OK) {
+        EXPECT_EQ(i, buffer);
+        i++;
+        continue;
+      }
+      ASSERT_EQ(MOJO_RESULT_SHOULD_WAIT, result);
+
+      // Wait for more messages.
+      Waiter waiter;
+      waiter.Init();
+      result = mp->AddAwakable(1, &waiter, MOJO_HANDLE_SIGNAL_READABLE, 0,
+                               nullptr);
+      if (result == MOJO_RESULT_OK) {
+        EXPECT_EQ(MOJO_RESULT_OK,
+                  waiter.Wait(MOJO_DEADLINE_INDEFINITE, nullptr));
+        mp->RemoveAwakable(1, &waiter, nullptr);
+      } else {
+        EXPECT_EQ(MOJO_RESULT_ALREADY_EXISTS, result);
+      }
+    }
+  }  // Joins |thread|.
+
+  mp->Close(0);
+  mp->Close(1);
+}
+
 }  // namespace
 }  // namespace system
 }  // namespace mojo
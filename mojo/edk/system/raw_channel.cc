@@ -12,26 +12,106 @@
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/message_loop/message_loop.h"
+#include "mojo/edk/embedder/platform_shared_buffer.h"
+#include "mojo/edk/embedder/platform_support.h"
+#include "mojo/edk/system/configuration.h"
 #include "mojo/edk/system/message_in_transit.h"
 #include "mojo/edk/system/transport_data.h"
 
 namespace mojo {
 namespace system {
 
-const size_t kReadSize = 4096;
+namespace {
+
+// The amount of data that we try to read at once adapts to the amount of data
+// that's available, between these limits.
+const size_t kMinReadSize = 4096;
+const size_t kMaxReadSize = 64 * 1024;
+
+// Shared memory segments are created with sizes that are multiples of this.
+const size_t kSharedMemorySegmentGranularity = 64 * 1024;
+
+// Payload of a |RAW_CHANNEL_SHARED_MEMORY_MESSAGE| message. The segment
+// |segment_id| (of size |segment_num_bytes|) contains the serialized message
+// (i.e., its main buffer followed by its transport data buffer, if any) in its
+// first |message_num_bytes| bytes. If the segment is new, its platform handle
+// is attached. If |retired_segment_id| is nonzero, the sender no longer uses
+// (and will never again refer to) that segment.
+struct SharedMemoryMessageData {
+  uint32_t segment_id;
+  uint32_t segment_num_bytes;
+  uint32_t message_num_bytes;
+  uint32_t retired_segment_id;
+};
+
+// Payload of a |RAW_CHANNEL_SHARED_MEMORY_RELEASE| message: The receiver of a
+// |RAW_CHANNEL_SHARED_MEMORY_MESSAGE| is done with segment |segment_id|.
+struct SharedMemoryReleaseData {
+  uint32_t segment_id;
+};
+
+size_t GetNumPlatformHandles(const MessageInTransit* message) {
+  if (!message->transport_data())
+    return 0;
+  const embedder::PlatformHandleVector* platform_handles =
+      message->transport_data()->platform_handles();
+  return platform_handles ? platform_handles->size() : 0;
+}
+
+}  // namespace
+
+MOJO_STATIC_CONST_MEMBER_DEFINITION const size_t
+    RawChannel::kMaxSharedMemorySegments;
+
+// RawChannel::OutgoingSharedMemorySegment -------------------------------------
+
+struct RawChannel::OutgoingSharedMemorySegment {
+  OutgoingSharedMemorySegment(
+      uint32_t id,
+      scoped_refptr<embedder::PlatformSharedBuffer> buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> mapping)
+      : id(id),
+        buffer(buffer),
+        mapping(mapping.Pass()),
+        is_in_use(false) {}
+
+  const uint32_t id;
+  const scoped_refptr<embedder::PlatformSharedBuffer> buffer;
+  const scoped_ptr<embedder::PlatformSharedBufferMapping> mapping;
+  // Set from when a message is copied into the segment until the peer releases
+  // it.
+  bool is_in_use;
+};
+
+// RawChannel::IncomingSharedMemorySegment -------------------------------------
+
+struct RawChannel::IncomingSharedMemorySegment {
+  IncomingSharedMemorySegment(
+      uint32_t id,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> mapping)
+      : id(id), mapping(mapping.Pass()) {}
+
+  const uint32_t id;
+  const scoped_ptr<embedder::PlatformSharedBufferMapping> mapping;
+};
 
 // RawChannel::ReadBuffer ------------------------------------------------------
 
-RawChannel::ReadBuffer::ReadBuffer() : buffer_(kReadSize), num_valid_bytes_(0) {
+RawChannel::ReadBuffer::ReadBuffer()
+    : buffer_(2 * kMinReadSize),
+      start_(0),
+      num_valid_bytes_(0),
+      read_size_(kMinReadSize),
+      base_read_size_(kMinReadSize) {
 }
 
 RawChannel::ReadBuffer::~ReadBuffer() {
 }
 
 void RawChannel::ReadBuffer::GetBuffer(char** addr, size_t* size) {
-  DCHECK_GE(buffer_.size(), num_valid_bytes_ + kReadSize);
-  *addr = &buffer_[0] + num_valid_bytes_;
-  *size = kReadSize;
+  DCHECK_GE(buffer_.size(), start_ + num_valid_bytes_ + read_size_);
+  *addr = &buffer_[0] + start_ + num_valid_bytes_;
+  *size = read_size_;
 }
 
 // RawChannel::WriteBuffer -----------------------------------------------------
@@ -57,16 +137,10 @@ bool RawChannel::WriteBuffer::HavePlatformHandlesToSend() const {
 
   const embedder::PlatformHandleVector* all_platform_handles =
       transport_data->platform_handles();
-  if (!all_platform_handles) {
-    DCHECK_EQ(platform_handles_offset_, 0u);
-    return false;
-  }
-  if (platform_handles_offset_ >= all_platform_handles->size()) {
-    DCHECK_EQ(platform_handles_offset_, all_platform_handles->size());
-    return false;
-  }
-
-  return true;
+  // Note: |platform_handles_offset_| may be larger than the number of platform
+  // handles if |GetBuffersAndPlatformHandles()| was used.
+  return all_platform_handles &&
+         platform_handles_offset_ < all_platform_handles->size();
 }
 
 void RawChannel::WriteBuffer::GetPlatformHandlesToSend(
@@ -101,47 +175,114 @@ void RawChannel::WriteBuffer::GetBuffers(std::vector<Buffer>* buffers) const {
   if (message_queue_.IsEmpty())
     return;
 
-  const MessageInTransit* message = message_queue_.PeekMessage();
-  DCHECK_LT(data_offset_, message->total_size());
-  size_t bytes_to_write = message->total_size() - data_offset_;
+  AppendBuffersForMessage(message_queue_.PeekMessage(), data_offset_, buffers);
+}
+
+void RawChannel::WriteBuffer::GetBuffersAndPlatformHandles(
+    size_t max_buffers,
+    size_t max_num_bytes,
+    size_t max_platform_handles,
+    std::vector<Buffer>* buffers,
+    std::vector<embedder::PlatformHandle*>* platform_handles) {
+  DCHECK_EQ(serialized_platform_handle_size_, 0u);
+  DCHECK_GE(max_buffers, 2u);
+
+  buffers->clear();
+  platform_handles->clear();
+
+  if (message_queue_.IsEmpty())
+    return;
+
+  // If platform handles have already been sent for messages after the first
+  // one, don't send platform handles for any further messages until those
+  // messages have been sent. This bounds the number of platform handles that
+  // the receiver has to hold on to before it gets the messages they belong to.
+  const bool sent_platform_handles_ahead =
+      platform_handles_offset_ >
+      GetNumPlatformHandles(message_queue_.PeekMessage());
+
+  size_t num_platform_handles_to_skip = platform_handles_offset_;
+  size_t data_offset = data_offset_;
+  size_t num_bytes = 0;
+  for (MessageInTransit* message = message_queue_.PeekMessage(); message;
+       message = message_queue_.PeekMessageAfter(message)) {
+    size_t num_platform_handles = GetNumPlatformHandles(message);
+    size_t num_platform_handles_sent =
+        std::min(num_platform_handles_to_skip, num_platform_handles);
+    num_platform_handles_to_skip -= num_platform_handles_sent;
+    size_t num_platform_handles_to_send =
+        num_platform_handles - num_platform_handles_sent;
+
+    size_t message_num_bytes = message->total_size() - data_offset;
+    if (message != message_queue_.PeekMessage()) {
+      // Each message needs at most two buffers.
+      if (buffers->size() + 2 > max_buffers ||
+          num_bytes + message_num_bytes > max_num_bytes)
+        break;
+      if (num_platform_handles_to_send > 0 &&
+          (sent_platform_handles_ahead ||
+           platform_handles->size() + num_platform_handles_to_send >
+               max_platform_handles))
+        break;
+    } else {
+      // Subclasses must make sure that this holds (see
+      // |EnqueueMessageNoLock()|).
+      DCHECK_LE(num_platform_handles_to_send, max_platform_handles);
+    }
+
+    if (num_platform_handles_to_send > 0) {
+      embedder::PlatformHandleVector* all_platform_handles =
+          message->transport_data()->platform_handles();
+      for (size_t j = num_platform_handles_sent; j < num_platform_handles; j++)
+        platform_handles->push_back(&(*all_platform_handles)[j]);
+    }
+    AppendBuffersForMessage(message, data_offset, buffers);
+    num_bytes += message_num_bytes;
+    data_offset = 0;
+  }
+}
+
+// static
+void RawChannel::WriteBuffer::AppendBuffersForMessage(
+    const MessageInTransit* message,
+    size_t data_offset,
+    std::vector<Buffer>* buffers) {
+  DCHECK_LT(data_offset, message->total_size());
+  size_t bytes_to_write = message->total_size() - data_offset;
 
   size_t transport_data_buffer_size =
       message->transport_data() ? message->transport_data()->buffer_size() : 0;
 
   if (!transport_data_buffer_size) {
     // Only write from the main buffer.
-    DCHECK_LT(data_offset_, message->main_buffer_size());
+    DCHECK_LT(data_offset, message->main_buffer_size());
     DCHECK_LE(bytes_to_write, message->main_buffer_size());
     Buffer buffer = {
-        static_cast<const char*>(message->main_buffer()) + data_offset_,
+        static_cast<const char*>(message->main_buffer()) + data_offset,
         bytes_to_write};
     buffers->push_back(buffer);
     return;
   }
 
-  if (data_offset_ >= message->main_buffer_size()) {
+  if (data_offset >= message->main_buffer_size()) {
     // Only write from the transport data buffer.
-    DCHECK_LT(data_offset_ - message->main_buffer_size(),
+    DCHECK_LT(data_offset - message->main_buffer_size(),
               transport_data_buffer_size);
     DCHECK_LE(bytes_to_write, transport_data_buffer_size);
     Buffer buffer = {
         static_cast<const char*>(message->transport_data()->buffer()) +
-            (data_offset_ - message->main_buffer_size()),
+            (data_offset - message->main_buffer_size()),
         bytes_to_write};
     buffers->push_back(buffer);
     return;
   }
 
-  // TODO(vtl): We could actually send out buffers from multiple messages, with
-  // the "stopping" condition being reaching a message with platform handles
-  // attached.
-
   // Write from both buffers.
-  DCHECK_EQ(bytes_to_write, message->main_buffer_size() - data_offset_ +
+  DCHECK_EQ(bytes_to_write, message->main_buffer_size() - data_offset +
                                 transport_data_buffer_size);
   Buffer buffer1 = {
-      static_cast<const char*>(message->main_buffer()) + data_offset_,
-      message->main_buffer_size() - data_offset_};
+      static_cast<const char*>(message->main_buffer()) + data_offset,
+      message->main_buffer_size() - data_offset};
   buffers->push_back(buffer1);
   Buffer buffer2 = {
       static_cast<const char*>(message->transport_data()->buffer()),
@@ -153,8 +294,10 @@ void RawChannel::WriteBuffer::GetBuffers(std::vector<Buffer>* buffers) const {
 
 RawChannel::RawChannel()
     : message_loop_for_io_(nullptr),
+      platform_support_(nullptr),
       delegate_(nullptr),
       set_on_shutdown_(nullptr),
+      next_shared_memory_segment_id_(1),
       write_stopped_(false),
       weak_ptr_factory_(this) {
 }
@@ -169,8 +312,10 @@ RawChannel::~RawChannel() {
   DCHECK(!weak_ptr_factory_.HasWeakPtrs());
 }
 
-void RawChannel::Init(Delegate* delegate) {
+void RawChannel::Init(Delegate* delegate,
+                      embedder::PlatformSupport* platform_support) {
   DCHECK(delegate);
+  DCHECK(platform_support);
 
   DCHECK(!delegate_);
   delegate_ = delegate;
@@ -179,6 +324,8 @@ void RawChannel::Init(Delegate* delegate) {
   DCHECK(!message_loop_for_io_);
   message_loop_for_io_ =
       static_cast<base::MessageLoopForIO*>(base::MessageLoop::current());
+  DCHECK(!platform_support_);
+  platform_support_ = platform_support;
 
   // No need to take the lock. No one should be using us yet.
   DCHECK(!read_buffer_);
@@ -224,6 +371,18 @@ void RawChannel::Shutdown() {
 bool RawChannel::WriteMessage(scoped_ptr<MessageInTransit> message) {
   DCHECK(message);
 
+  if (ShouldUseSharedMemory(*message)) {
+    base::AutoLock locker(shared_memory_lock_);
+    scoped_ptr<MessageInTransit> shared_memory_message =
+        MoveToSharedMemoryNoLock(*message);
+    if (shared_memory_message)
+      return WriteMessageInline(shared_memory_message.Pass());
+  }
+
+  return WriteMessageInline(message.Pass());
+}
+
+bool RawChannel::WriteMessageInline(scoped_ptr<MessageInTransit> message) {
   base::AutoLock locker(write_lock_);
   if (write_stopped_)
     return false;
@@ -284,39 +443,58 @@ void RawChannel::OnReadCompleted(IOResult io_result, size_t bytes_read) {
         return;
     }
 
+    // The amount of data that the completed read asked for.
+    const size_t read_size = read_buffer_->read_size_;
     read_buffer_->num_valid_bytes_ += bytes_read;
 
     // Dispatch all the messages that we can.
     bool did_dispatch_message = false;
     // Tracks the offset of the first undispatched message in |read_buffer_|.
-    // Currently, we copy data to ensure that this is zero at the beginning.
-    size_t read_buffer_start = 0;
+    size_t read_buffer_start = read_buffer_->start_;
     size_t remaining_bytes = read_buffer_->num_valid_bytes_;
     size_t message_size;
     // Note that we rely on short-circuit evaluation here:
     //   - |read_buffer_start| may be an invalid index into
     //     |read_buffer_->buffer_| if |remaining_bytes| is zero.
     //   - |message_size| is only valid if |GetNextMessageSize()| returns true.
-    // TODO(vtl): Use |message_size| more intelligently (e.g., to request the
-    // next read).
     // TODO(vtl): Validate that |message_size| is sane.
     while (remaining_bytes > 0 && MessageInTransit::GetNextMessageSize(
                                       &read_buffer_->buffer_[read_buffer_start],
                                       remaining_bytes, &message_size) &&
            remaining_bytes >= message_size) {
-      MessageInTransit::View message_view(
+      MessageInTransit::View wire_message_view(
           message_size, &read_buffer_->buffer_[read_buffer_start]);
-      DCHECK_EQ(message_view.total_size(), message_size);
+      DCHECK_EQ(wire_message_view.total_size(), message_size);
 
       const char* error_message = nullptr;
-      if (!message_view.IsValid(GetSerializedPlatformHandleSize(),
-                                &error_message)) {
+      if (!wire_message_view.IsValid(GetSerializedPlatformHandleSize(),
+                                     &error_message)) {
         DCHECK(error_message);
         LOG(ERROR) << "Received invalid message: " << error_message;
         CallOnError(Delegate::ERROR_READ_BAD_MESSAGE);
         return;  // |this| may have been destroyed in |CallOnError()|.
       }
 
+      // If the message's contents are in shared memory, dispatch those instead.
+      scoped_ptr<char, base::AlignedFreeDeleter> shared_memory_message_buffer;
+      scoped_ptr<MessageInTransit::View> shared_memory_message_view;
+      if (wire_message_view.type() == MessageInTransit::Type::RAW_CHANNEL &&
+          wire_message_view.subtype() ==
+              MessageInTransit::Subtype::RAW_CHANNEL_SHARED_MEMORY_MESSAGE) {
+        size_t shared_memory_message_size = 0;
+        if (!ReadSharedMemoryMessage(wire_message_view,
+                                     &shared_memory_message_buffer,
+                                     &shared_memory_message_size)) {
+          CallOnError(Delegate::ERROR_READ_BAD_MESSAGE);
+          return;  // |this| may have been destroyed in |CallOnError()|.
+        }
+        shared_memory_message_view.reset(new MessageInTransit::View(
+            shared_memory_message_size, shared_memory_message_buffer.get()));
+      }
+      const MessageInTransit::View& message_view =
+          shared_memory_message_view ? *shared_memory_message_view
+                                     : wire_message_view;
+
       if (message_view.type() == MessageInTransit::Type::RAW_CHANNEL) {
         if (!OnReadMessageForRawChannel(message_view)) {
           CallOnError(Delegate::ERROR_READ_BAD_MESSAGE);
@@ -366,30 +544,9 @@ void RawChannel::OnReadCompleted(IOResult io_result, size_t bytes_read) {
       remaining_bytes -= message_size;
     }
 
-    if (read_buffer_start > 0) {
-      // Move data back to start.
-      read_buffer_->num_valid_bytes_ = remaining_bytes;
-      if (read_buffer_->num_valid_bytes_ > 0) {
-        memmove(&read_buffer_->buffer_[0],
-                &read_buffer_->buffer_[read_buffer_start], remaining_bytes);
-      }
-      read_buffer_start = 0;
-    }
-
-    if (read_buffer_->buffer_.size() - read_buffer_->num_valid_bytes_ <
-        kReadSize) {
-      // Use power-of-2 buffer sizes.
-      // TODO(vtl): Make sure the buffer doesn't get too large (and enforce the
-      // maximum message size to whatever extent necessary).
-      // TODO(vtl): We may often be able to peek at the header and get the real
-      // required extra space (which may be much bigger than |kReadSize|).
-      size_t new_size = std::max(read_buffer_->buffer_.size(), kReadSize);
-      while (new_size < read_buffer_->num_valid_bytes_ + kReadSize)
-        new_size *= 2;
-
-      // TODO(vtl): It's suboptimal to zero out the fresh memory.
-      read_buffer_->buffer_.resize(new_size, 0);
-    }
+    read_buffer_->start_ = read_buffer_start;
+    read_buffer_->num_valid_bytes_ = remaining_bytes;
+    UpdateReadBuffer(bytes_read);
 
     // (1) If we dispatched any messages, stop reading for now (and let the
     // message loop do its thing for another round).
@@ -397,8 +554,8 @@ void RawChannel::OnReadCompleted(IOResult io_result, size_t bytes_read) {
     // a single message. Risks: slower, more complex if we want to avoid lots of
     // copying. ii. Keep reading until there's no more data and dispatch all the
     // messages we can. Risks: starvation of other users of the message loop.)
-    // (2) If we didn't max out |kReadSize|, stop reading for now.
-    bool schedule_for_later = did_dispatch_message || bytes_read < kReadSize;
+    // (2) If we didn't max out |read_size|, stop reading for now.
+    bool schedule_for_later = did_dispatch_message || bytes_read < read_size;
     bytes_read = 0;
     io_result = schedule_for_later ? ScheduleRead() : Read(&bytes_read);
   } while (io_result != IO_PENDING);
@@ -437,12 +594,365 @@ void RawChannel::EnqueueMessageNoLock(scoped_ptr<MessageInTransit> message) {
 
 bool RawChannel::OnReadMessageForRawChannel(
     const MessageInTransit::View& message_view) {
-  // No non-implementation specific |RawChannel| control messages.
+  // (|RAW_CHANNEL_SHARED_MEMORY_MESSAGE|s are handled in |OnReadCompleted()|.)
+  if (message_view.subtype() ==
+      MessageInTransit::Subtype::RAW_CHANNEL_SHARED_MEMORY_RELEASE)
+    return OnSharedMemoryReleaseMessage(message_view);
+
   LOG(ERROR) << "Invalid control message (subtype " << message_view.subtype()
              << ")";
   return false;
 }
 
+bool RawChannel::ShouldUseSharedMemory(const MessageInTransit& message) const {
+  const size_t min_num_bytes =
+      GetConfiguration().min_shared_memory_message_num_bytes;
+  if (!min_num_bytes || message.total_size() < min_num_bytes ||
+      message.total_size() > GetConfiguration().max_shared_memory_num_bytes)
+    return false;
+  // Our own control messages have to be seen by |OnReadMessageForRawChannel()|
+  // as-is.
+  if (message.type() == MessageInTransit::Type::RAW_CHANNEL)
+    return false;
+  // Platform handles have to be sent over the OS "pipe" anyway (and on POSIX
+  // they may have been split off into other messages already).
+  const TransportData* transport_data = message.transport_data();
+  return !transport_data || !transport_data->platform_handles() ||
+         transport_data->platform_handles()->empty();
+}
+
+scoped_ptr<MessageInTransit> RawChannel::MoveToSharedMemoryNoLock(
+    const MessageInTransit& message) {
+  shared_memory_lock_.AssertAcquired();
+
+  const size_t message_num_bytes = message.total_size();
+  SharedMemoryMessageData data = {};
+
+  // Use the smallest free segment that's big enough.
+  OutgoingSharedMemorySegment* segment = nullptr;
+  for (OutgoingSharedMemorySegment* s : outgoing_shared_memory_segments_) {
+    if (!s->is_in_use && s->mapping->GetLength() >= message_num_bytes &&
+        (!segment || s->mapping->GetLength() < segment->mapping->GetLength()))
+      segment = s;
+  }
+
+  // The platform handle of a new segment, sent along with its first message.
+  embedder::ScopedPlatformHandle platform_handle;
+  if (!segment) {
+    // If we have too many segments already, retire the smallest free one.
+    ScopedVector<OutgoingSharedMemorySegment>::iterator retired_it =
+        outgoing_shared_memory_segments_.end();
+    if (outgoing_shared_memory_segments_.size() >= kMaxSharedMemorySegments) {
+      for (ScopedVector<OutgoingSharedMemorySegment>::iterator it =
+               outgoing_shared_memory_segments_.begin();
+           it != outgoing_shared_memory_segments_.end(); ++it) {
+        if (!(*it)->is_in_use &&
+            (retired_it == outgoing_shared_memory_segments_.end() ||
+             (*it)->mapping->GetLength() <
+                 (*retired_it)->mapping->GetLength()))
+          retired_it = it;
+      }
+      // If they're all in use, just send the message inline.
+      if (retired_it == outgoing_shared_memory_segments_.end())
+        return nullptr;
+    }
+
+    size_t segment_num_bytes =
+        (message_num_bytes + kSharedMemorySegmentGranularity - 1) /
+        kSharedMemorySegmentGranularity * kSharedMemorySegmentGranularity;
+    segment_num_bytes = std::min(
+        segment_num_bytes, GetConfiguration().max_shared_memory_num_bytes);
+    scoped_refptr<embedder::PlatformSharedBuffer> buffer(
+        platform_support_->CreateSharedBuffer(segment_num_bytes));
+    if (!buffer) {
+      LOG(WARNING) << "Failed to create shared memory for message; sending it "
+                      "inline";
+      return nullptr;
+    }
+    scoped_ptr<embedder::PlatformSharedBufferMapping> mapping(
+        buffer->MapNoCheck(0, segment_num_bytes));
+    if (!mapping) {
+      LOG(WARNING) << "Failed to map shared memory for message; sending it "
+                      "inline";
+      return nullptr;
+    }
+    // Get the platform handle to send with the segment's first message before
+    // retiring another segment, so that if this fails both sides still agree
+    // about which segments exist.
+    platform_handle = buffer->DuplicatePlatformHandle();
+    if (!platform_handle.is_valid()) {
+      LOG(WARNING) << "Failed to duplicate shared memory handle; sending "
+                      "message inline";
+      return nullptr;
+    }
+
+    if (retired_it != outgoing_shared_memory_segments_.end()) {
+      data.retired_segment_id = (*retired_it)->id;
+      outgoing_shared_memory_segments_.erase(retired_it);
+    }
+    segment = new OutgoingSharedMemorySegment(next_shared_memory_segment_id_++,
+                                              buffer, mapping.Pass());
+    outgoing_shared_memory_segments_.push_back(segment);
+  }
+
+  char* base = static_cast<char*>(segment->mapping->GetBase());
+  memcpy(base, message.main_buffer(), message.main_buffer_size());
+  if (const TransportData* transport_data = message.transport_data()) {
+    DCHECK_EQ(message.main_buffer_size() + transport_data->buffer_size(),
+              message_num_bytes);
+    memcpy(base + message.main_buffer_size(), transport_data->buffer(),
+           transport_data->buffer_size());
+  }
+  segment->is_in_use = true;
+
+  data.segment_id = segment->id;
+  data.segment_num_bytes = static_cast<uint32_t>(segment->mapping->GetLength());
+  data.message_num_bytes = static_cast<uint32_t>(message_num_bytes);
+  scoped_ptr<MessageInTransit> rv(new MessageInTransit(
+      MessageInTransit::Type::RAW_CHANNEL,
+      MessageInTransit::Subtype::RAW_CHANNEL_SHARED_MEMORY_MESSAGE,
+      static_cast<uint32_t>(sizeof(data)), &data));
+  if (platform_handle.is_valid()) {
+    embedder::ScopedPlatformHandleVectorPtr platform_handles(
+        new embedder::PlatformHandleVector());
+    platform_handles->push_back(platform_handle.release());
+    rv->SetTransportData(make_scoped_ptr(new TransportData(
+        platform_handles.Pass(), GetSerializedPlatformHandleSize())));
+  }
+  return rv.Pass();
+}
+
+bool RawChannel::ReadSharedMemoryMessage(
+    const MessageInTransit::View& message_view,
+    scoped_ptr<char, base::AlignedFreeDeleter>* message_buffer,
+    size_t* message_size) {
+  DCHECK_EQ(message_view.type(), MessageInTransit::Type::RAW_CHANNEL);
+  DCHECK_EQ(message_view.subtype(),
+            MessageInTransit::Subtype::RAW_CHANNEL_SHARED_MEMORY_MESSAGE);
+
+  if (message_view.num_bytes() != sizeof(SharedMemoryMessageData)) {
+    LOG(ERROR) << "Invalid shared memory message (bad payload size)";
+    return false;
+  }
+  SharedMemoryMessageData data;
+  memcpy(&data, message_view.bytes(), sizeof(data));
+  if (data.segment_id == 0 || data.segment_num_bytes == 0 ||
+      data.segment_num_bytes > GetConfiguration().max_shared_memory_num_bytes ||
+      data.message_num_bytes > data.segment_num_bytes) {
+    LOG(ERROR) << "Invalid shared memory message (bad sizes)";
+    return false;
+  }
+
+  ScopedVector<IncomingSharedMemorySegment>::iterator it;
+  if (data.retired_segment_id) {
+    for (it = incoming_shared_memory_segments_.begin();
+         it != incoming_shared_memory_segments_.end(); ++it) {
+      if ((*it)->id == data.retired_segment_id)
+        break;
+    }
+    if (it == incoming_shared_memory_segments_.end()) {
+      LOG(ERROR) << "Invalid shared memory message (bad retired segment)";
+      return false;
+    }
+    incoming_shared_memory_segments_.erase(it);
+  }
+
+  for (it = incoming_shared_memory_segments_.begin();
+       it != incoming_shared_memory_segments_.end(); ++it) {
+    if ((*it)->id == data.segment_id)
+      break;
+  }
+
+  size_t num_platform_handles = 0;
+  const void* platform_handle_table = nullptr;
+  if (message_view.transport_data_buffer()) {
+    TransportData::GetPlatformHandleTable(message_view.transport_data_buffer(),
+                                          &num_platform_handles,
+                                          &platform_handle_table);
+  }
+  IncomingSharedMemorySegment* segment = nullptr;
+  if (num_platform_handles == 0) {
+    // Existing segment.
+    if (it == incoming_shared_memory_segments_.end() ||
+        (*it)->mapping->GetLength() != data.segment_num_bytes) {
+      LOG(ERROR) << "Invalid shared memory message (bad segment)";
+      return false;
+    }
+    segment = *it;
+  } else {
+    // New segment.
+    if (num_platform_handles != 1 ||
+        it != incoming_shared_memory_segments_.end() ||
+        incoming_shared_memory_segments_.size() >= kMaxSharedMemorySegments) {
+      LOG(ERROR) << "Invalid shared memory message (bad new segment)";
+      return false;
+    }
+    embedder::ScopedPlatformHandleVectorPtr platform_handles(
+        GetReadPlatformHandles(num_platform_handles, platform_handle_table));
+    if (!platform_handles) {
+      LOG(ERROR) << "Invalid number of platform handles received";
+      return false;
+    }
+    DCHECK_EQ(platform_handles->size(), 1u);
+    embedder::ScopedPlatformHandle platform_handle(platform_handles->front());
+    platform_handles->clear();
+
+    scoped_refptr<embedder::PlatformSharedBuffer> buffer(
+        platform_support_->CreateSharedBufferFromHandle(
+            data.segment_num_bytes, platform_handle.Pass()));
+    if (!buffer) {
+      LOG(ERROR) << "Invalid shared memory message (bad shared memory)";
+      return false;
+    }
+    scoped_ptr<embedder::PlatformSharedBufferMapping> mapping(
+        buffer->MapNoCheck(0, data.segment_num_bytes));
+    if (!mapping) {
+      LOG(ERROR) << "Failed to map shared memory for message";
+      return false;
+    }
+    segment = new IncomingSharedMemorySegment(data.segment_id, mapping.Pass());
+    incoming_shared_memory_segments_.push_back(segment);
+  }
+
+  // Copy the message out of the segment before validating it (the other side
+  // can still write to the segment, so we can't trust its contents to stay
+  // put), and then let the other side reuse the segment.
+  message_buffer->reset(static_cast<char*>(base::AlignedAlloc(
+      std::max(data.message_num_bytes, 1u),
+      MessageInTransit::kMessageAlignment)));
+  memcpy(message_buffer->get(), segment->mapping->GetBase(),
+         data.message_num_bytes);
+  SharedMemoryReleaseData release_data = {data.segment_id};
+  WriteMessageInline(make_scoped_ptr(new MessageInTransit(
+      MessageInTransit::Type::RAW_CHANNEL,
+      MessageInTransit::Subtype::RAW_CHANNEL_SHARED_MEMORY_RELEASE,
+      static_cast<uint32_t>(sizeof(release_data)), &release_data)));
+
+  size_t next_message_size = 0;
+  if (!MessageInTransit::GetNextMessageSize(message_buffer->get(),
+                                            data.message_num_bytes,
+                                            &next_message_size) ||
+      next_message_size != data.message_num_bytes) {
+    LOG(ERROR) << "Invalid shared memory message (size mismatch)";
+    return false;
+  }
+  MessageInTransit::View contained_message_view(data.message_num_bytes,
+                                                message_buffer->get());
+  const char* error_message = nullptr;
+  if (!contained_message_view.IsValid(GetSerializedPlatformHandleSize(),
+                                      &error_message)) {
+    DCHECK(error_message);
+    LOG(ERROR) << "Received invalid message: " << error_message;
+    return false;
+  }
+  if (contained_message_view.type() == MessageInTransit::Type::RAW_CHANNEL) {
+    LOG(ERROR) << "Invalid shared memory message (contains control message)";
+    return false;
+  }
+  if (contained_message_view.transport_data_buffer()) {
+    size_t contained_num_platform_handles = 0;
+    const void* contained_platform_handle_table = nullptr;
+    TransportData::GetPlatformHandleTable(
+        contained_message_view.transport_data_buffer(),
+        &contained_num_platform_handles, &contained_platform_handle_table);
+    if (contained_num_platform_handles > 0) {
+      LOG(ERROR) << "Invalid shared memory message (contains platform handles)";
+      return false;
+    }
+  }
+
+  *message_size = data.message_num_bytes;
+  return true;
+}
+
+bool RawChannel::OnSharedMemoryReleaseMessage(
+    const MessageInTransit::View& message_view) {
+  if (message_view.num_bytes() != sizeof(SharedMemoryReleaseData)) {
+    LOG(ERROR) << "Invalid shared memory release message";
+    return false;
+  }
+  SharedMemoryReleaseData data;
+  memcpy(&data, message_view.bytes(), sizeof(data));
+
+  base::AutoLock locker(shared_memory_lock_);
+  for (OutgoingSharedMemorySegment* segment :
+       outgoing_shared_memory_segments_) {
+    if (segment->id == data.segment_id && segment->is_in_use) {
+      segment->is_in_use = false;
+      return true;
+    }
+  }
+  LOG(ERROR) << "Invalid shared memory release message (bad segment)";
+  return false;
+}
+
+void RawChannel::UpdateReadBuffer(size_t bytes_read) {
+  DCHECK_EQ(base::MessageLoop::current(), message_loop_for_io_);
+
+  ReadBuffer* read_buffer = read_buffer_.get();
+
+  // Read more at once if the last read got as much as it asked for (there's
+  // probably more data available), and less if it got much less.
+  if (bytes_read >= read_buffer->read_size_) {
+    read_buffer->base_read_size_ =
+        std::min(2 * read_buffer->base_read_size_, kMaxReadSize);
+  } else if (bytes_read < read_buffer->base_read_size_ / 4) {
+    read_buffer->base_read_size_ =
+        std::max(read_buffer->base_read_size_ / 2, kMinReadSize);
+  }
+  read_buffer->read_size_ = read_buffer->base_read_size_;
+
+  if (read_buffer->num_valid_bytes_ == 0) {
+    // There's nothing to preserve, so start at the beginning again.
+    read_buffer->start_ = 0;
+  } else {
+    // If we know that we're in the middle of a large message, read (at least)
+    // the rest of it at once. (We don't trust the peer with much here: the
+    // message will have to fit in |read_buffer->buffer_| anyway, and it'll be
+    // validated once we have all of it.)
+    size_t message_size = 0;
+    if (MessageInTransit::GetNextMessageSize(
+            &read_buffer->buffer_[read_buffer->start_],
+            read_buffer->num_valid_bytes_, &message_size) &&
+        message_size > read_buffer->num_valid_bytes_) {
+      size_t rest_of_message_size = std::min(
+          message_size - read_buffer->num_valid_bytes_,
+          static_cast<size_t>(GetConfiguration().max_message_num_bytes));
+      read_buffer->read_size_ =
+          std::max(read_buffer->read_size_, rest_of_message_size);
+    }
+  }
+
+  size_t required_size =
+      read_buffer->num_valid_bytes_ + read_buffer->read_size_;
+  if (read_buffer->start_ + required_size <= read_buffer->buffer_.size())
+    return;
+
+  // Move data back to start.
+  if (read_buffer->start_ > 0) {
+    if (read_buffer->num_valid_bytes_ > 0) {
+      memmove(&read_buffer->buffer_[0],
+              &read_buffer->buffer_[read_buffer->start_],
+              read_buffer->num_valid_bytes_);
+    }
+    read_buffer->start_ = 0;
+  }
+
+  if (read_buffer->buffer_.size() < required_size + read_buffer->read_size_) {
+    // Use power-of-2 buffer sizes, with room for (at least) two reads, so that
+    // data doesn't have to be moved again until at least a read's worth of
+    // data has been dispatched.
+    // TODO(vtl): Make sure the buffer doesn't get too large (and enforce the
+    // maximum message size to whatever extent necessary).
+    size_t new_size = std::max(read_buffer->buffer_.size(), kMinReadSize);
+    while (new_size < required_size + read_buffer->read_size_)
+      new_size *= 2;
+
+    // TODO(vtl): It's suboptimal to zero out the fresh memory.
+    read_buffer->buffer_.resize(new_size, 0);
+  }
+}
+
 // static
 RawChannel::Delegate::Error RawChannel::ReadIOResultToError(
     IOResult io_result) {
@@ -482,16 +992,24 @@ bool RawChannel::OnWriteCompletedNoLock(IOResult io_result,
     write_buffer_->platform_handles_offset_ += platform_handles_written;
     write_buffer_->data_offset_ += bytes_written;
 
-    MessageInTransit* message = write_buffer_->message_queue_.PeekMessage();
-    if (write_buffer_->data_offset_ >= message->total_size()) {
+    // The write may have completed any number of messages (see
+    // |WriteBuffer::GetBuffersAndPlatformHandles()|).
+    while (!write_buffer_->message_queue_.IsEmpty()) {
+      MessageInTransit* message = write_buffer_->message_queue_.PeekMessage();
+      if (write_buffer_->data_offset_ < message->total_size())
+        break;
+
       // Complete write.
-      CHECK_EQ(write_buffer_->data_offset_, message->total_size());
+      size_t num_platform_handles = GetNumPlatformHandles(message);
+      CHECK_GE(write_buffer_->platform_handles_offset_, num_platform_handles);
+      write_buffer_->platform_handles_offset_ -= num_platform_handles;
+      write_buffer_->data_offset_ -= message->total_size();
       write_buffer_->message_queue_.DiscardMessage();
-      write_buffer_->platform_handles_offset_ = 0;
-      write_buffer_->data_offset_ = 0;
-
-      if (write_buffer_->message_queue_.IsEmpty())
-        return true;
+    }
+    if (write_buffer_->message_queue_.IsEmpty()) {
+      CHECK_EQ(write_buffer_->data_offset_, 0u);
+      CHECK_EQ(write_buffer_->platform_handles_offset_, 0u);
+      return true;
     }
 
     // Schedule the next write.
@@ -5,9 +5,13 @@
 #ifndef MOJO_EDK_SYSTEM_RAW_CHANNEL_H_
 #define MOJO_EDK_SYSTEM_RAW_CHANNEL_H_
 
+#include <stdint.h>
+
 #include <vector>
 
+#include "base/memory/aligned_memory.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
 #include "base/memory/weak_ptr.h"
 #include "base/synchronization/lock.h"
 #include "mojo/edk/embedder/platform_handle_vector.h"
@@ -22,6 +26,11 @@ class MessageLoopForIO;
 }
 
 namespace mojo {
+
+namespace embedder {
+class PlatformSupport;
+}
+
 namespace system {
 
 // |RawChannel| is an interface and base class for objects that wrap an OS
@@ -33,6 +42,14 @@ namespace system {
 //    view of the caller. If necessary, messages are queued (to be written on
 //    the aforementioned thread).
 //
+// Large messages (see |embedder::Configuration|'s
+// |min_shared_memory_message_num_bytes|) without platform handles attached are
+// sent by copying their contents into a shared memory segment and writing only
+// a small control message referring to the segment to the OS "pipe". This is
+// transparent to the delegate on the receiving side. Segments are reused: the
+// receiver tells the sender when it's done with a segment, and the segment's
+// platform handle is only sent along with its first message.
+//
 // OS-specific implementation subclasses are to be instantiated using the
 // |Create()| static factory method.
 //
@@ -87,10 +104,12 @@ class MOJO_SYSTEM_IMPL_EXPORT RawChannel {
   static scoped_ptr<RawChannel> Create(embedder::ScopedPlatformHandle handle);
 
   // This must be called (on an I/O thread) before this object is used. Does
-  // *not* take ownership of |delegate|. Both the I/O thread and |delegate| must
-  // remain alive until |Shutdown()| is called (unless this fails); |delegate|
-  // will no longer be used after |Shutdown()|.
-  void Init(Delegate* delegate);
+  // *not* take ownership of |delegate| or |platform_support|. The I/O thread,
+  // |delegate| and |platform_support| must remain alive until |Shutdown()| is
+  // called (unless this fails); |delegate| will no longer be used after
+  // |Shutdown()|. |platform_support| is used to create (and to map the peer's)
+  // shared memory segments.
+  void Init(Delegate* delegate, embedder::PlatformSupport* platform_support);
 
   // This must be called (on the I/O thread) before this object is destroyed.
   void Shutdown();
@@ -135,12 +154,24 @@ class MOJO_SYSTEM_IMPL_EXPORT RawChannel {
    private:
     friend class RawChannel;
 
-    // We store data from |[Schedule]Read()|s in |buffer_|. The start of
-    // |buffer_| is always aligned with a message boundary (we will copy memory
-    // to ensure this), but |buffer_| may be larger than the actual number of
-    // bytes we have.
+    // We store data from |[Schedule]Read()|s in |buffer_|. The data that
+    // hasn't been dispatched yet starts at offset |start_| (which is always
+    // aligned with a message boundary) and is |num_valid_bytes_| long;
+    // |buffer_| may be larger than that. Data is only moved back to the start of
+    // |buffer_| when there isn't enough room after it for the next read, which
+    // (since |buffer_| is kept at least twice as large as a read) happens at
+    // most once per |read_size_| bytes dispatched, rather than after every read
+    // that ends in the middle of a message.
     std::vector<char> buffer_;
+    size_t start_;
     size_t num_valid_bytes_;
+    // The number of bytes to read next (see |GetBuffer()|). This is at least
+    // |base_read_size_|, but may be larger if we know that the next message is
+    // large.
+    size_t read_size_;
+    // Adapted to the observed amount of data available per read (see
+    // |RawChannel::UpdateReadBuffer()|).
+    size_t base_read_size_;
 
     MOJO_DISALLOW_COPY_AND_ASSIGN(ReadBuffer);
   };
@@ -179,15 +210,43 @@ class MOJO_SYSTEM_IMPL_EXPORT RawChannel {
     // |OnWriteCompletedNoLock()|.
     void GetBuffers(std::vector<Buffer>* buffers) const;
 
+    // Like |GetBuffers()|, but gets buffers from as many messages at the front
+    // of |message_queue_| as possible (so that they can be written using a
+    // single system call), together with all the platform handles attached to
+    // those messages that have yet to be sent. The platform handles must be
+    // sent with the first byte of the buffers (and should be closed once
+    // sent). At most |max_buffers| buffers (which must be at least 2),
+    // totalling at most |max_num_bytes| bytes (unless the first message alone
+    // is larger), and at most |max_platform_handles| platform handles are
+    // returned; a message is only included if all of its (remaining) platform
+    // handles fit. This may only be used if |GetSerializedPlatformHandleSize()|
+    // is zero.
+    void GetBuffersAndPlatformHandles(
+        size_t max_buffers,
+        size_t max_num_bytes,
+        size_t max_platform_handles,
+        std::vector<Buffer>* buffers,
+        std::vector<embedder::PlatformHandle*>* platform_handles);
+
    private:
     friend class RawChannel;
 
+    // Appends the buffers for (the remainder of) |message|, starting at
+    // |data_offset|, to |*buffers|. This adds one or two buffers.
+    static void AppendBuffersForMessage(const MessageInTransit* message,
+                                        size_t data_offset,
+                                        std::vector<Buffer>* buffers);
+
     const size_t serialized_platform_handle_size_;
 
     MessageInTransitQueue message_queue_;
-    // Platform handles are sent before the message data, but doing so may
-    // require several passes. |platform_handles_offset_| indicates the position
-    // in the first message's vector of platform handles to send next.
+    // Platform handles are sent before (or with) the message data, but doing so
+    // may require several passes. |platform_handles_offset_| is the number of
+    // platform handles (counting from the first message's first platform
+    // handle) that have already been sent. This may be more than the number of
+    // platform handles attached to the first message, if platform handles for
+    // subsequent messages were sent along with it (see
+    // |GetBuffersAndPlatformHandles()|).
     size_t platform_handles_offset_;
     // The first message's data may have been partially sent. |data_offset_|
     // indicates the position in the first message's data to start the next
@@ -290,6 +349,49 @@ class MOJO_SYSTEM_IMPL_EXPORT RawChannel {
                                 scoped_ptr<WriteBuffer> write_buffer) = 0;
 
  private:
+  struct OutgoingSharedMemorySegment;
+  struct IncomingSharedMemorySegment;
+
+  // Maximum number of shared memory segments (used to send large messages) in
+  // each direction.
+  static const size_t kMaxSharedMemorySegments = 8;
+
+  // Writes (or queues) |message| as-is. See |WriteMessage()|.
+  bool WriteMessageInline(scoped_ptr<MessageInTransit> message);
+
+  // Returns true if |message| should be sent using shared memory.
+  bool ShouldUseSharedMemory(const MessageInTransit& message) const;
+
+  // Copies the serialized |message| into a (possibly newly-created) shared
+  // memory segment and returns a |RAW_CHANNEL_SHARED_MEMORY_MESSAGE| message
+  // referring to it. Returns null if no segment is available (in which case
+  // |message| should be sent as-is). Must be called under
+  // |shared_memory_lock_|, which must be held until the returned message has
+  // been queued (so that the peer sees segments being created and retired in
+  // the same order that we do).
+  scoped_ptr<MessageInTransit> MoveToSharedMemoryNoLock(
+      const MessageInTransit& message);
+
+  // Copies the message contained in the shared memory segment referred to by
+  // |message_view| (which must be a |RAW_CHANNEL_SHARED_MEMORY_MESSAGE|
+  // message) to |*message_buffer|, releases the segment back to the peer, and
+  // checks that the copied message is valid. On success, returns true and sets
+  // |*message_size|. Returns false if |message_view| or the contained message
+  // is invalid. Only called on the I/O thread.
+  bool ReadSharedMemoryMessage(
+      const MessageInTransit::View& message_view,
+      scoped_ptr<char, base::AlignedFreeDeleter>* message_buffer,
+      size_t* message_size);
+
+  // Handles a |RAW_CHANNEL_SHARED_MEMORY_RELEASE| message (from the peer),
+  // returning false if it's invalid. Only called on the I/O thread.
+  bool OnSharedMemoryReleaseMessage(const MessageInTransit::View& message_view);
+
+  // Called after messages have been dispatched from |read_buffer_|, where the
+  // last read got |bytes_read| bytes. Adapts the size of the next read and
+  // makes room for it in |read_buffer_|. Only called on the I/O thread.
+  void UpdateReadBuffer(size_t bytes_read);
+
   // Converts an |IO_FAILED_...| for a read to a |Delegate::Error|.
   static Delegate::Error ReadIOResultToError(IOResult io_result);
 
@@ -309,11 +411,19 @@ class MOJO_SYSTEM_IMPL_EXPORT RawChannel {
   // Set in |Init()| and never changed (hence usable on any thread without
   // locking):
   base::MessageLoopForIO* message_loop_for_io_;
+  embedder::PlatformSupport* platform_support_;
 
   // Only used on the I/O thread:
   Delegate* delegate_;
   bool* set_on_shutdown_;
   scoped_ptr<ReadBuffer> read_buffer_;
+  // Shared memory segments created by the peer (with the peer's IDs).
+  ScopedVector<IncomingSharedMemorySegment> incoming_shared_memory_segments_;
+
+  // Protects the following members. Must be acquired before |write_lock_|.
+  base::Lock shared_memory_lock_;
+  ScopedVector<OutgoingSharedMemorySegment> outgoing_shared_memory_segments_;
+  uint32_t next_shared_memory_segment_id_;
 
   base::Lock write_lock_;  // Protects the following members.
   bool write_stopped_;
@@ -0,0 +1,256 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// These perf tests measure how many system calls |RawChannel| makes per
+// message. They rely on POSIX-specific features (see below), so they're only
+// built on POSIX.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/test/perf_log.h"
+#include "base/test/perf_time_logger.h"
+#include "base/test/test_io_thread.h"
+#include "mojo/edk/embedder/platform_channel_pair.h"
+#include "mojo/edk/embedder/platform_handle.h"
+#include "mojo/edk/embedder/scoped_platform_handle.h"
+#include "mojo/edk/embedder/simple_platform_support.h"
+#include "mojo/edk/system/configuration.h"
+#include "mojo/edk/system/message_in_transit.h"
+#include "mojo/edk/system/raw_channel.h"
+#include "mojo/edk/system/test_utils.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace system {
+namespace {
+
+scoped_ptr<MessageInTransit> MakeMessage(uint32_t num_bytes) {
+  std::vector<unsigned char> bytes(num_bytes, 'x');
+  return make_scoped_ptr(
+      new MessageInTransit(MessageInTransit::Type::ENDPOINT_CLIENT,
+                           MessageInTransit::Subtype::ENDPOINT_CLIENT_DATA,
+                           num_bytes, bytes.empty() ? nullptr : &bytes[0]));
+}
+
+void InitOnIOThread(RawChannel* raw_channel, RawChannel::Delegate* delegate) {
+  // |SimplePlatformSupport| has no state, so all raw channels can share one.
+  static embedder::SimplePlatformSupport* platform_support =
+      new embedder::SimplePlatformSupport();
+  raw_channel->Init(delegate, platform_support);
+}
+
+// Creates a connected pair of nonblocking |SOCK_SEQPACKET| sockets. Unlike
+// with the stream sockets that are normally used, each successful write system
+// call on one end results in exactly one packet being received on the other, so
+// the reader can count the number of write system calls made.
+void CreateSeqPacketSocketPair(embedder::ScopedPlatformHandle* handle0,
+                               embedder::ScopedPlatformHandle* handle1) {
+  int fds[2];
+  PCHECK(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) == 0);
+  for (size_t i = 0; i < 2; i++) {
+    int flags = fcntl(fds[i], F_GETFL);
+    PCHECK(flags != -1);
+    PCHECK(fcntl(fds[i], F_SETFL, flags | O_NONBLOCK) == 0);
+  }
+  handle0->reset(embedder::PlatformHandle(fds[0]));
+  handle1->reset(embedder::PlatformHandle(fds[1]));
+}
+
+class NullRawChannelDelegate : public RawChannel::Delegate {
+ public:
+  NullRawChannelDelegate() {}
+  ~NullRawChannelDelegate() override {}
+
+  // |RawChannel::Delegate| implementation:
+  void OnReadMessage(
+      const MessageInTransit::View& /*message_view*/,
+      embedder::ScopedPlatformHandleVectorPtr /*platform_handles*/) override {
+    CHECK(false);  // Should not get called.
+  }
+  void OnError(Error error) override {
+    // We'll get a read (shutdown) error when the connection is closed.
+    CHECK_EQ(error, ERROR_READ_SHUTDOWN);
+  }
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(NullRawChannelDelegate);
+};
+
+class CountingRawChannelDelegate : public RawChannel::Delegate {
+ public:
+  explicit CountingRawChannelDelegate(size_t expected_count)
+      : done_event_(false, false), expected_count_(expected_count), count_(0) {}
+  ~CountingRawChannelDelegate() override {}
+
+  // |RawChannel::Delegate| implementation (called on the I/O thread):
+  void OnReadMessage(
+      const MessageInTransit::View& /*message_view*/,
+      embedder::ScopedPlatformHandleVectorPtr /*platform_handles*/) override {
+    if (++count_ == expected_count_)
+      done_event_.Signal();
+  }
+  void OnError(Error error) override {
+    // We'll get a read (shutdown) error when the connection is closed.
+    CHECK_EQ(error, ERROR_READ_SHUTDOWN);
+  }
+
+  // Waits for all the messages to have been read.
+  void Wait() { done_event_.Wait(); }
+
+ private:
+  base::WaitableEvent done_event_;
+  const size_t expected_count_;
+  size_t count_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(CountingRawChannelDelegate);
+};
+
+class RawChannelPerfTest : public testing::Test {
+ public:
+  RawChannelPerfTest()
+      : io_thread_(base::TestIOThread::kManualStart),
+        old_min_shared_memory_message_num_bytes_(
+            GetConfiguration().min_shared_memory_message_num_bytes) {}
+  ~RawChannelPerfTest() override {}
+
+  void SetUp() override {
+    // Send everything inline, so that the numbers are comparable across
+    // message sizes.
+    GetMutableConfiguration()->min_shared_memory_message_num_bytes = 0;
+    io_thread_.Start();
+  }
+
+  void TearDown() override {
+    io_thread_.Stop();
+    GetMutableConfiguration()->min_shared_memory_message_num_bytes =
+        old_min_shared_memory_message_num_bytes_;
+  }
+
+ protected:
+  // Writes |message_count| messages of |message_size| bytes (as fast as
+  // possible, so that they pile up in the |RawChannel|'s write queue) and
+  // reports the number of write system calls that were needed per message.
+  void MeasureWriteSyscallsPerMessage(size_t message_count,
+                                      uint32_t message_size) {
+    embedder::ScopedPlatformHandle write_handle;
+    embedder::ScopedPlatformHandle read_handle;
+    CreateSeqPacketSocketPair(&write_handle, &read_handle);
+
+    NullRawChannelDelegate delegate;
+    scoped_ptr<RawChannel> rc(RawChannel::Create(write_handle.Pass()));
+    io_thread_.PostTaskAndWait(
+        FROM_HERE,
+        base::Bind(&InitOnIOThread, rc.get(), base::Unretained(&delegate)));
+
+    size_t total_size = 0;
+    for (size_t i = 0; i < message_count; i++) {
+      scoped_ptr<MessageInTransit> message(MakeMessage(message_size));
+      total_size += message->total_size();
+      CHECK(rc->WriteMessage(message.Pass()));
+    }
+
+    // Each packet that we read corresponds to one write system call.
+    std::vector<char> buffer(1024 * 1024);
+    size_t num_packets = 0;
+    size_t bytes_read = 0;
+    while (bytes_read < total_size) {
+      ssize_t result = recv(read_handle.get().fd, &buffer[0], buffer.size(), 0);
+      if (result < 0) {
+        PCHECK(errno == EAGAIN || errno == EWOULDBLOCK);
+        test::Sleep(test::DeadlineFromMilliseconds(1));
+        continue;
+      }
+      CHECK_GT(result, 0);
+      num_packets++;
+      bytes_read += static_cast<size_t>(result);
+    }
+    CHECK_EQ(bytes_read, total_size);
+
+    io_thread_.PostTaskAndWait(
+        FROM_HERE,
+        base::Bind(&RawChannel::Shutdown, base::Unretained(rc.get())));
+
+    base::LogPerfResult(
+        base::StringPrintf("RawChannel_WriteSyscallsPerMessage_%zux_%u",
+                           message_count, static_cast<unsigned>(message_size))
+            .c_str(),
+        static_cast<double>(num_packets) / static_cast<double>(message_count),
+        "syscalls/message");
+  }
+
+  // Measures the time taken for a |RawChannel| to read |message_count|
+  // messages of |message_size| bytes that were written (as fast as possible)
+  // by another |RawChannel|.
+  void MeasureReadThroughput(size_t message_count, uint32_t message_size) {
+    embedder::PlatformChannelPair channel_pair;
+
+    NullRawChannelDelegate write_delegate;
+    scoped_ptr<RawChannel> rc_write(
+        RawChannel::Create(channel_pair.PassServerHandle()));
+    io_thread_.PostTaskAndWait(FROM_HERE,
+                               base::Bind(&InitOnIOThread, rc_write.get(),
+                                          base::Unretained(&write_delegate)));
+
+    CountingRawChannelDelegate read_delegate(message_count);
+    scoped_ptr<RawChannel> rc_read(
+        RawChannel::Create(channel_pair.PassClientHandle()));
+
+    std::string test_name =
+        base::StringPrintf("RawChannel_ReadThroughput_%zux_%u", message_count,
+                           static_cast<unsigned>(message_size));
+    base::PerfTimeLogger logger(test_name.c_str());
+    io_thread_.PostTaskAndWait(FROM_HERE,
+                               base::Bind(&InitOnIOThread, rc_read.get(),
+                                          base::Unretained(&read_delegate)));
+    for (size_t i = 0; i < message_count; i++)
+      CHECK(rc_write->WriteMessage(MakeMessage(message_size)));
+    read_delegate.Wait();
+    logger.Done();
+
+    io_thread_.PostTaskAndWait(
+        FROM_HERE,
+        base::Bind(&RawChannel::Shutdown, base::Unretained(rc_read.get())));
+    io_thread_.PostTaskAndWait(
+        FROM_HERE,
+        base::Bind(&RawChannel::Shutdown, base::Unretained(rc_write.get())));
+  }
+
+ private:
+  base::TestIOThread io_thread_;
+  const size_t old_min_shared_memory_message_num_bytes_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(RawChannelPerfTest);
+};
+
+TEST_F(RawChannelPerfTest, WriteSyscallsPerMessage) {
+  MeasureWriteSyscallsPerMessage(100000, 8);
+  MeasureWriteSyscallsPerMessage(100000, 100);
+  MeasureWriteSyscallsPerMessage(10000, 1000);
+  MeasureWriteSyscallsPerMessage(1000, 10000);
+}
+
+TEST_F(RawChannelPerfTest, ReadThroughput) {
+  MeasureReadThroughput(100000, 8);
+  MeasureReadThroughput(100000, 100);
+  MeasureReadThroughput(10000, 1000);
+  MeasureReadThroughput(1000, 10000);
+  MeasureReadThroughput(100, 1000000);
+}
+
+}  // namespace
+}  // namespace system
+}  // namespace mojo
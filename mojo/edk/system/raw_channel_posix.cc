@@ -5,11 +5,12 @@
 #include "mojo/edk/system/raw_channel.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
-#include <algorithm>
 #include <deque>
+#include <vector>
 
 #include "base/bind.h"
 #include "base/location.h"
@@ -29,6 +30,12 @@ namespace system {
 
 namespace {
 
+// Limits on what to write using a single system call. (Messages are only
+// batched up to |kMaxBatchNumBytes| bytes, since writing much more than the OS
+// will buffer at once is pointless.)
+const size_t kMaxBufferCount = IOV_MAX;
+const size_t kMaxBatchNumBytes = 64 * 1024;
+
 class RawChannelPosix final : public RawChannel,
                               public base::MessageLoopForIO::Watcher {
  public:
@@ -81,6 +88,11 @@ class RawChannelPosix final : public RawChannel,
   // The following members are used on multiple threads and protected by
   // |write_lock()|:
   bool pending_write_;
+  // These are only used by |WriteNoLock()|; they're members so that their
+  // storage can be reused.
+  std::vector<WriteBuffer::Buffer> buffers_;
+  std::vector<embedder::PlatformHandle*> platform_handles_;
+  std::vector<iovec> iov_;
 
   // This is used for posting tasks from write threads to the I/O thread. It
   // must only be accessed under |write_lock_|. The weak pointers it produces
@@ -219,54 +231,44 @@ RawChannel::IOResult RawChannelPosix::WriteNoLock(
 
   DCHECK(!pending_write_);
 
-  size_t num_platform_handles = 0;
+  // Write as many messages as we can (together with their platform handles)
+  // using a single system call.
+  write_buffer_no_lock()->GetBuffersAndPlatformHandles(
+      kMaxBufferCount, kMaxBatchNumBytes,
+      embedder::kPlatformChannelMaxNumHandles, &buffers_, &platform_handles_);
+  DCHECK(!buffers_.empty());
+  DCHECK_LE(buffers_.size(), kMaxBufferCount);
+
+  size_t num_platform_handles = platform_handles_.size();
   ssize_t write_result;
-  if (write_buffer_no_lock()->HavePlatformHandlesToSend()) {
-    embedder::PlatformHandle* platform_handles;
-    void* serialization_data;  // Actually unused.
-    write_buffer_no_lock()->GetPlatformHandlesToSend(
-        &num_platform_handles, &platform_handles, &serialization_data);
-    DCHECK_GT(num_platform_handles, 0u);
-    DCHECK_LE(num_platform_handles, embedder::kPlatformChannelMaxNumHandles);
-    DCHECK(platform_handles);
-
-    // TODO(vtl): Reduce code duplication. (This is duplicated from below.)
-    std::vector<WriteBuffer::Buffer> buffers;
-    write_buffer_no_lock()->GetBuffers(&buffers);
-    DCHECK(!buffers.empty());
-    const size_t kMaxBufferCount = 10;
-    iovec iov[kMaxBufferCount];
-    size_t buffer_count = std::min(buffers.size(), kMaxBufferCount);
-    for (size_t i = 0; i < buffer_count; ++i) {
-      iov[i].iov_base = const_cast<char*>(buffers[i].addr);
-      iov[i].iov_len = buffers[i].size;
+  if (buffers_.size() == 1 && !num_platform_handles) {
+    write_result = embedder::PlatformChannelWrite(fd_.get(), buffers_[0].addr,
+                                                  buffers_[0].size);
+  } else {
+    iov_.resize(buffers_.size());
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      iov_[i].iov_base = const_cast<char*>(buffers_[i].addr);
+      iov_[i].iov_len = buffers_[i].size;
     }
 
-    write_result = embedder::PlatformChannelSendmsgWithHandles(
-        fd_.get(), iov, buffer_count, platform_handles, num_platform_handles);
-    if (write_result >= 0) {
+    if (num_platform_handles) {
+      DCHECK_LE(num_platform_handles, embedder::kPlatformChannelMaxNumHandles);
+      // The platform handles may come from several messages, so gather them.
+      embedder::PlatformHandle
+          platform_handles[embedder::kPlatformChannelMaxNumHandles];
       for (size_t i = 0; i < num_platform_handles; i++)
-        platform_handles[i].CloseIfNecessary();
-    }
-  } else {
-    std::vector<WriteBuffer::Buffer> buffers;
-    write_buffer_no_lock()->GetBuffers(&buffers);
-    DCHECK(!buffers.empty());
-
-    if (buffers.size() == 1) {
-      write_result = embedder::PlatformChannelWrite(fd_.get(), buffers[0].addr,
-                                                    buffers[0].size);
-    } else {
-      const size_t kMaxBufferCount = 10;
-      iovec iov[kMaxBufferCount];
-      size_t buffer_count = std::min(buffers.size(), kMaxBufferCount);
-      for (size_t i = 0; i < buffer_count; ++i) {
-        iov[i].iov_base = const_cast<char*>(buffers[i].addr);
-        iov[i].iov_len = buffers[i].size;
+        platform_handles[i] = *platform_handles_[i];
+
+      write_result = embedder::PlatformChannelSendmsgWithHandles(
+          fd_.get(), &iov_[0], iov_.size(), platform_handles,
+          num_platform_handles);
+      if (write_result >= 0) {
+        for (size_t i = 0; i < num_platform_handles; i++)
+          platform_handles_[i]->CloseIfNecessary();
       }
-
+    } else {
       write_result =
-          embedder::PlatformChannelWritev(fd_.get(), iov, buffer_count);
+          embedder::PlatformChannelWritev(fd_.get(), &iov_[0], iov_.size());
     }
   }
 
@@ -412,13 +414,15 @@ RawChannel::IOResult RawChannelPosix::ReadImpl(size_t* bytes_read) {
               embedder::kPlatformChannelMaxNumHandles);
 
     // We should never accumulate more than |TransportData::kMaxPlatformHandles
-    // + embedder::kPlatformChannelMaxNumHandles| handles. (The latter part is
-    // possible because we could have accumulated all the handles for a message,
-    // then received the message data plus the first set of handles for the next
-    // message in the subsequent |recvmsg()|.)
+    // + 2 * embedder::kPlatformChannelMaxNumHandles| handles. (The latter part
+    // is possible because we could have accumulated all the handles for a
+    // message, then received the message data plus handles for the next
+    // messages in the subsequent |recvmsg()|. The sender may send the handles
+    // for several messages at once, ahead of (most of) their data, but it
+    // won't do so again until it has sent all that data.)
     if (read_platform_handles_.size() >
         (TransportData::GetMaxPlatformHandles() +
-         embedder::kPlatformChannelMaxNumHandles)) {
+         2 * embedder::kPlatformChannelMaxNumHandles)) {
       LOG(ERROR) << "Received too many platform handles";
       embedder::CloseAllPlatformHandles(&read_platform_handles_);
       read_platform_handles_.clear();
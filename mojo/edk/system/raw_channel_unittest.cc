@@ -26,6 +26,8 @@
 #include "mojo/edk/embedder/platform_channel_pair.h"
 #include "mojo/edk/embedder/platform_handle.h"
 #include "mojo/edk/embedder/scoped_platform_handle.h"
+#include "mojo/edk/embedder/simple_platform_support.h"
+#include "mojo/edk/system/configuration.h"
 #include "mojo/edk/system/message_in_transit.h"
 #include "mojo/edk/system/mutex.h"
 #include "mojo/edk/system/test_utils.h"
@@ -58,7 +60,10 @@ bool CheckMessageData(const void* bytes, uint32_t num_bytes) {
 }
 
 void InitOnIOThread(RawChannel* raw_channel, RawChannel::Delegate* delegate) {
-  raw_channel->Init(delegate);
+  // |SimplePlatformSupport| has no state, so all raw channels can share one.
+  static embedder::SimplePlatformSupport* platform_support =
+      new embedder::SimplePlatformSupport();
+  raw_channel->Init(delegate, platform_support);
 }
 
 bool WriteTestMessageToHandle(const embedder::PlatformHandle& handle,
@@ -71,6 +76,25 @@ bool WriteTestMessageToHandle(const embedder::PlatformHandle& handle,
   return write_size == message->main_buffer_size();
 }
 
+// Sets |min_shared_memory_message_num_bytes| for the lifetime of the object.
+class ScopedMinSharedMemoryMessageNumBytes {
+ public:
+  explicit ScopedMinSharedMemoryMessageNumBytes(size_t num_bytes)
+      : old_num_bytes_(
+            GetConfiguration().min_shared_memory_message_num_bytes) {
+    GetMutableConfiguration()->min_shared_memory_message_num_bytes = num_bytes;
+  }
+  ~ScopedMinSharedMemoryMessageNumBytes() {
+    GetMutableConfiguration()->min_shared_memory_message_num_bytes =
+        old_num_bytes_;
+  }
+
+ private:
+  const size_t old_num_bytes_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ScopedMinSharedMemoryMessageNumBytes);
+};
+
 // -----------------------------------------------------------------------------
 
 class RawChannelTest : public testing::Test {
@@ -193,6 +217,9 @@ class TestMessageReaderAndChecker {
 
 // Tests writing (and verifies reading using our own custom reader).
 TEST_F(RawChannelTest, WriteMessage) {
+  // Our reader only understands messages sent inline.
+  ScopedMinSharedMemoryMessageNumBytes inline_only(0);
+
   WriteOnlyRawChannelDelegate delegate;
   scoped_ptr<RawChannel> rc(RawChannel::Create(handles[0].Pass()));
   TestMessageReaderAndChecker checker(handles[1].get());
@@ -308,6 +335,68 @@ TEST_F(RawChannelTest, OnReadMessage) {
       FROM_HERE, base::Bind(&RawChannel::Shutdown, base::Unretained(rc.get())));
 }
 
+// RawChannelTest.SharedMemoryMessages ----------------------------------------
+
+// Tests that large messages are sent using shared memory, and that they're
+// received intact.
+TEST_F(RawChannelTest, SharedMemoryMessages) {
+  static const uint32_t kMinSharedMemoryMessageNumBytes = 10000;
+  ScopedMinSharedMemoryMessageNumBytes min_num_bytes(
+      kMinSharedMemoryMessageNumBytes);
+
+  WriteOnlyRawChannelDelegate writer_delegate;
+  scoped_ptr<RawChannel> writer_rc(RawChannel::Create(handles[0].Pass()));
+  io_thread()->PostTaskAndWait(FROM_HERE,
+                               base::Bind(&InitOnIOThread, writer_rc.get(),
+                                          base::Unretained(&writer_delegate)));
+
+  // A large message only puts a small control message on the wire.
+  {
+    EXPECT_TRUE(writer_rc->WriteMessage(
+        MakeTestMessage(kMinSharedMemoryMessageNumBytes)));
+    // (|MessageInTransit::View| requires an aligned buffer.)
+    uint64_t buffer[16];
+    size_t read_size = 0;
+    for (size_t i = 0; i < kMessageReaderMaxPollIterations && !read_size; i++) {
+      CHECK(mojo::test::NonBlockingRead(handles[1].get(), buffer,
+                                        sizeof(buffer), &read_size));
+      if (!read_size)
+        test::Sleep(test::DeadlineFromMilliseconds(kMessageReaderSleepMs));
+    }
+    size_t message_size = 0;
+    ASSERT_TRUE(
+        MessageInTransit::GetNextMessageSize(buffer, read_size, &message_size));
+    ASSERT_EQ(message_size, read_size);
+    MessageInTransit::View message_view(message_size, buffer);
+    EXPECT_EQ(MessageInTransit::Type::RAW_CHANNEL, message_view.type());
+    EXPECT_EQ(MessageInTransit::Subtype::RAW_CHANNEL_SHARED_MEMORY_MESSAGE,
+              message_view.subtype());
+  }
+
+  ReadCheckerRawChannelDelegate reader_delegate;
+  scoped_ptr<RawChannel> reader_rc(RawChannel::Create(handles[1].Pass()));
+  io_thread()->PostTaskAndWait(FROM_HERE,
+                               base::Bind(&InitOnIOThread, reader_rc.get(),
+                                          base::Unretained(&reader_delegate)));
+
+  // Write (queueing) and read, for a variety of sizes, both below and above
+  // the threshold.
+  std::vector<uint32_t> expected_sizes;
+  for (uint32_t size = 1; size < 5 * 1000 * 1000; size += size / 2 + 1)
+    expected_sizes.push_back(size);
+  reader_delegate.SetExpectedSizes(expected_sizes);
+  for (uint32_t size = 1; size < 5 * 1000 * 1000; size += size / 2 + 1)
+    EXPECT_TRUE(writer_rc->WriteMessage(MakeTestMessage(size)));
+  reader_delegate.Wait();
+
+  io_thread()->PostTaskAndWait(
+      FROM_HERE,
+      base::Bind(&RawChannel::Shutdown, base::Unretained(reader_rc.get())));
+  io_thread()->PostTaskAndWait(
+      FROM_HERE,
+      base::Bind(&RawChannel::Shutdown, base::Unretained(writer_rc.get())));
+}
+
 // RawChannelTest.WriteMessageAndOnReadMessage ---------------------------------
 
 class RawChannelWriterThread : public base::SimpleThread {
@@ -853,6 +942,121 @@ TEST_F(RawChannelTest, MAYBE_ReadWritePlatformHandles) {
       base::Bind(&RawChannel::Shutdown, base::Unretained(rc_write.get())));
 }
 
+// RawChannelTest.BatchedWritesWithPlatformHandles -----------------------------
+
+class ReadCountdownWithPlatformHandlesRawChannelDelegate
+    : public RawChannel::Delegate {
+ public:
+  explicit ReadCountdownWithPlatformHandlesRawChannelDelegate(
+      size_t expected_count)
+      : done_event_(false, false),
+        expected_count_(expected_count),
+        count_(0),
+        num_platform_handles_(0) {}
+  ~ReadCountdownWithPlatformHandlesRawChannelDelegate() override {}
+
+  // |RawChannel::Delegate| implementation (called on the I/O thread):
+  void OnReadMessage(
+      const MessageInTransit::View& message_view,
+      embedder::ScopedPlatformHandleVectorPtr platform_handles) override {
+    EXPECT_LT(count_, expected_count_);
+    count_++;
+
+    EXPECT_TRUE(
+        CheckMessageData(message_view.bytes(), message_view.num_bytes()));
+
+    if (platform_handles) {
+      for (size_t i = 0; i < platform_handles->size(); i++) {
+        EXPECT_TRUE(platform_handles->at(i).is_valid());
+        num_platform_handles_++;
+      }
+    }
+
+    if (count_ >= expected_count_)
+      done_event_.Signal();
+  }
+  void OnError(Error error) override {
+    // We'll get a read (shutdown) error when the connection is closed.
+    CHECK_EQ(error, ERROR_READ_SHUTDOWN);
+  }
+
+  // Waits for all the messages to have been seen.
+  void Wait() { done_event_.Wait(); }
+
+  // Only call this after |Wait()| has returned.
+  size_t num_platform_handles() const { return num_platform_handles_; }
+
+ private:
+  base::WaitableEvent done_event_;
+  size_t expected_count_;
+  size_t count_;
+  size_t num_platform_handles_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(
+      ReadCountdownWithPlatformHandlesRawChannelDelegate);
+};
+
+#if defined(OS_POSIX)
+#define MAYBE_BatchedWritesWithPlatformHandles BatchedWritesWithPlatformHandles
+#else
+// Not yet implemented (on Windows).
+#define MAYBE_BatchedWritesWithPlatformHandles \
+  DISABLED_BatchedWritesWithPlatformHandles
+#endif
+TEST_F(RawChannelTest, MAYBE_BatchedWritesWithPlatformHandles) {
+  static const size_t kNumLargeMessages = 20;
+  static const uint32_t kLargeMessageSize = 100 * 1000;
+  // Each message has two platform handles attached, so the platform handles
+  // for all these messages don't fit in a single |sendmsg()|.
+  static const size_t kNumMessagesWithPlatformHandles = 100;
+
+  // Make sure that the large messages are sent inline.
+  ScopedMinSharedMemoryMessageNumBytes inline_only(0);
+
+  WriteOnlyRawChannelDelegate write_delegate;
+  scoped_ptr<RawChannel> rc_write(RawChannel::Create(handles[0].Pass()));
+  io_thread()->PostTaskAndWait(FROM_HERE,
+                               base::Bind(&InitOnIOThread, rc_write.get(),
+                                          base::Unretained(&write_delegate)));
+
+  // Nothing is reading yet, so this will fill up the OS's buffers, and the
+  // messages after that will be queued (and then written in batches).
+  for (size_t i = 0; i < kNumLargeMessages; i++)
+    EXPECT_TRUE(rc_write->WriteMessage(MakeTestMessage(kLargeMessageSize)));
+  for (size_t i = 0; i < kNumMessagesWithPlatformHandles; i++) {
+    embedder::PlatformChannelPair channel_pair;
+    embedder::ScopedPlatformHandleVectorPtr platform_handles(
+        new embedder::PlatformHandleVector());
+    platform_handles->push_back(channel_pair.PassServerHandle().release());
+    platform_handles->push_back(channel_pair.PassClientHandle().release());
+
+    scoped_ptr<MessageInTransit> message(
+        MakeTestMessage(static_cast<uint32_t>(i + 1)));
+    message->SetTransportData(make_scoped_ptr(new TransportData(
+        platform_handles.Pass(), rc_write->GetSerializedPlatformHandleSize())));
+    EXPECT_TRUE(rc_write->WriteMessage(message.Pass()));
+  }
+
+  ReadCountdownWithPlatformHandlesRawChannelDelegate read_delegate(
+      kNumLargeMessages + kNumMessagesWithPlatformHandles);
+  scoped_ptr<RawChannel> rc_read(RawChannel::Create(handles[1].Pass()));
+  io_thread()->PostTaskAndWait(FROM_HERE,
+                               base::Bind(&InitOnIOThread, rc_read.get(),
+                                          base::Unretained(&read_delegate)));
+
+  read_delegate.Wait();
+  EXPECT_EQ(2 * kNumMessagesWithPlatformHandles,
+            read_delegate.num_platform_handles());
+  EXPECT_TRUE(rc_write->IsWriteBufferEmpty());
+
+  io_thread()->PostTaskAndWait(
+      FROM_HERE,
+      base::Bind(&RawChannel::Shutdown, base::Unretained(rc_read.get())));
+  io_thread()->PostTaskAndWait(
+      FROM_HERE,
+      base::Bind(&RawChannel::Shutdown, base::Unretained(rc_write.get())));
+}
+
 }  // namespace
 }  // namespace system
 }  // namespace mojo
@@ -70,10 +70,25 @@ RemoteConsumerDataPipeImpl::RemoteConsumerDataPipeImpl(
     ChannelEndpoint* channel_endpoint,
     size_t consumer_num_bytes)
     : channel_endpoint_(channel_endpoint),
-      consumer_num_bytes_(consumer_num_bytes) {
+      consumer_num_bytes_(consumer_num_bytes),
+      write_index_(0) {
   // Note: |buffer_| is lazily allocated.
 }
 
+RemoteConsumerDataPipeImpl::RemoteConsumerDataPipeImpl(
+    ChannelEndpoint* channel_endpoint,
+    size_t consumer_num_bytes,
+    scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+    size_t write_index)
+    : channel_endpoint_(channel_endpoint),
+      consumer_num_bytes_(consumer_num_bytes),
+      shared_buffer_(shared_buffer),
+      shared_buffer_mapping_(shared_buffer_mapping.Pass()),
+      write_index_(write_index) {
+  DCHECK_EQ(!shared_buffer_, !shared_buffer_mapping_);
+}
+
 RemoteConsumerDataPipeImpl::~RemoteConsumerDataPipeImpl() {
 }
 
@@ -137,6 +152,24 @@ MojoResult RemoteConsumerDataPipeImpl::ProducerWriteData(
   if (num_bytes_to_write == 0)
     return MOJO_RESULT_SHOULD_WAIT;
 
+  if (shared_buffer_) {
+    char* buffer = static_cast<char*>(shared_buffer_mapping_->GetBase());
+    // The amount we can write in our first copy.
+    size_t num_bytes_to_write_first =
+        std::min(num_bytes_to_write, capacity_num_bytes() - write_index_);
+    // Do the first (and possibly only) copy.
+    elements.GetArray(buffer + write_index_, num_bytes_to_write_first);
+    if (num_bytes_to_write_first < num_bytes_to_write) {
+      // The "second write index" is zero.
+      elements.At(num_bytes_to_write_first)
+          .GetArray(buffer, num_bytes_to_write - num_bytes_to_write_first);
+    }
+
+    CommitSharedWrite(num_bytes_to_write);
+    num_bytes.Put(static_cast<uint32_t>(num_bytes_to_write));
+    return MOJO_RESULT_OK;
+  }
+
   // The maximum amount of data to send per message (make it a multiple of the
   // element size.
   // TODO(vtl): Copied from |LocalDataPipeImpl::ConvertDataToMessages()|.
@@ -181,6 +214,11 @@ MojoResult RemoteConsumerDataPipeImpl::ProducerBeginWriteData(
   DCHECK_EQ(consumer_num_bytes_ % element_num_bytes(), 0u);
 
   size_t max_num_bytes_to_write = capacity_num_bytes() - consumer_num_bytes_;
+  // If the buffer is shared, we can only write (contiguously) up to its end.
+  if (shared_buffer_) {
+    max_num_bytes_to_write = std::min(max_num_bytes_to_write,
+                                      capacity_num_bytes() - write_index_);
+  }
   if (min_num_bytes_to_write > max_num_bytes_to_write) {
     // Don't return "should wait" since you can't wait for a specified amount
     // of data.
@@ -191,8 +229,13 @@ MojoResult RemoteConsumerDataPipeImpl::ProducerBeginWriteData(
   if (max_num_bytes_to_write == 0)
     return MOJO_RESULT_SHOULD_WAIT;
 
-  EnsureBuffer();
-  buffer.Put(buffer_.get());
+  if (shared_buffer_) {
+    buffer.Put(static_cast<char*>(shared_buffer_mapping_->GetBase()) +
+               write_index_);
+  } else {
+    EnsureBuffer();
+    buffer.Put(buffer_.get());
+  }
   buffer_num_bytes.Put(static_cast<uint32_t>(max_num_bytes_to_write));
   set_producer_two_phase_max_num_bytes_written(
       static_cast<uint32_t>(max_num_bytes_to_write));
@@ -206,12 +249,19 @@ MojoResult RemoteConsumerDataPipeImpl::ProducerEndWriteData(
   DCHECK_LE(num_bytes_written, capacity_num_bytes() - consumer_num_bytes_);
 
   if (!consumer_open()) {
-    DCHECK(buffer_);
+    DCHECK(buffer_ || shared_buffer_);
     set_producer_two_phase_max_num_bytes_written(0);
     DestroyBuffer();
     return MOJO_RESULT_OK;
   }
 
+  if (shared_buffer_) {
+    set_producer_two_phase_max_num_bytes_written(0);
+    if (num_bytes_written > 0)
+      CommitSharedWrite(num_bytes_written);
+    return MOJO_RESULT_OK;
+  }
+
   // TODO(vtl): The following code is copied almost verbatim from
   // |ProducerWriteData()| (it's touchy to factor it out since it uses a
   // |UserPointer| while we have a plain pointer.
@@ -269,7 +319,7 @@ void RemoteConsumerDataPipeImpl::ProducerStartSerialize(
     size_t* max_platform_handles) {
   *max_size = sizeof(SerializedDataPipeProducerDispatcher) +
               channel->GetSerializedEndpointSize();
-  *max_platform_handles = 0;
+  *max_platform_handles = shared_buffer_ ? 1 : 0;
 }
 
 bool RemoteConsumerDataPipeImpl::ProducerEndSerialize(
@@ -280,6 +330,8 @@ bool RemoteConsumerDataPipeImpl::ProducerEndSerialize(
   SerializedDataPipeProducerDispatcher* s =
       static_cast<SerializedDataPipeProducerDispatcher*>(destination);
   s->validated_options = validated_options();
+  s->shared_buffer_platform_handle_index = kNoSharedBuffer;
+  s->shared_buffer_write_index = 0;
   void* destination_for_endpoint = static_cast<char*>(destination) +
                                    sizeof(SerializedDataPipeProducerDispatcher);
 
@@ -293,6 +345,17 @@ bool RemoteConsumerDataPipeImpl::ProducerEndSerialize(
   // Case 2: The consumer isn't closed. We pass |channel_endpoint| back to the
   // |Channel|. There's no reason for us to continue to exist afterwards.
 
+  // If the buffer is shared, the new producer has to write to it (at the same
+  // place), since that's what the consumer expects.
+  if (shared_buffer_) {
+    if (!SerializeSharedBuffer(shared_buffer_.get(), platform_handles,
+                               &s->shared_buffer_platform_handle_index)) {
+      Disconnect();
+      return false;
+    }
+    s->shared_buffer_write_index = static_cast<uint32_t>(write_index_);
+  }
+
   s->consumer_num_bytes = consumer_num_bytes_;
   // Note: We don't use |port|.
   scoped_refptr<ChannelEndpoint> channel_endpoint;
@@ -407,6 +470,10 @@ void RemoteConsumerDataPipeImpl::EnsureBuffer() {
 }
 
 void RemoteConsumerDataPipeImpl::DestroyBuffer() {
+  // Note: Don't scribble on the shared buffer, since the consumer may still be
+  // reading from it.
+  shared_buffer_mapping_.reset();
+  shared_buffer_ = nullptr;
 #ifndef NDEBUG
   // Scribble on the buffer to help detect use-after-frees. (This also helps the
   // unit test detect certain bugs without needing ASAN or similar.)
@@ -416,6 +483,22 @@ void RemoteConsumerDataPipeImpl::DestroyBuffer() {
   buffer_.reset();
 }
 
+void RemoteConsumerDataPipeImpl::CommitSharedWrite(size_t num_bytes) {
+  DCHECK(consumer_open());
+  DCHECK(channel_endpoint_);
+  DCHECK(shared_buffer_);
+  DCHECK_LE(num_bytes, capacity_num_bytes() - consumer_num_bytes_);
+
+  write_index_ += num_bytes;
+  write_index_ %= capacity_num_bytes();
+  consumer_num_bytes_ += num_bytes;
+
+  // Note: Since the data is written before the message is sent, the consumer
+  // will see the data once it gets the message.
+  if (!channel_endpoint_->EnqueueMessage(CreateSharedWriteMessage(num_bytes)))
+    Disconnect();
+}
+
 void RemoteConsumerDataPipeImpl::Disconnect() {
   DCHECK(consumer_open());
   DCHECK(channel_endpoint_);
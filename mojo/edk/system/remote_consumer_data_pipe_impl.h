@@ -8,6 +8,7 @@
 #include "base/memory/aligned_memory.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "mojo/edk/embedder/platform_shared_buffer.h"
 #include "mojo/edk/system/channel_endpoint.h"
 #include "mojo/edk/system/data_pipe_impl.h"
 #include "mojo/edk/system/system_impl_export.h"
@@ -19,11 +20,26 @@ namespace system {
 // |RemoteConsumerDataPipeImpl| is a subclass that "implements" |DataPipe| for
 // data pipes whose producer is local and whose consumer is remote. See
 // |DataPipeImpl| for more details.
+//
+// If the data pipe's (circular) buffer is in shared memory (see
+// |embedder::Configuration::min_shared_memory_data_pipe_capacity_bytes|), data
+// is written directly into the consumer's buffer (and two-phase writes are
+// done in place), and only the amounts written are sent to the consumer.
+// Otherwise, the data itself is sent (in messages).
 class MOJO_SYSTEM_IMPL_EXPORT RemoteConsumerDataPipeImpl final
     : public DataPipeImpl {
  public:
   RemoteConsumerDataPipeImpl(ChannelEndpoint* channel_endpoint,
                              size_t consumer_num_bytes);
+  // For a data pipe whose buffer is shared. |shared_buffer_mapping| should map
+  // all of |shared_buffer|, and |write_index| is the index (in the circular
+  // buffer) at which to write next.
+  RemoteConsumerDataPipeImpl(
+      ChannelEndpoint* channel_endpoint,
+      size_t consumer_num_bytes,
+      scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+      size_t write_index);
   ~RemoteConsumerDataPipeImpl() override;
 
   // Processes messages that were received and queued by an |IncomingEndpoint|.
@@ -87,6 +103,11 @@ class MOJO_SYSTEM_IMPL_EXPORT RemoteConsumerDataPipeImpl final
   void EnsureBuffer();
   void DestroyBuffer();
 
+  // Commits |num_bytes| bytes of data, which must already have been written to
+  // the shared buffer (starting at |write_index_|), and tells the consumer
+  // about them.
+  void CommitSharedWrite(size_t num_bytes);
+
   void Disconnect();
 
   // Should be valid if and only if |consumer_open()| returns true.
@@ -96,9 +117,15 @@ class MOJO_SYSTEM_IMPL_EXPORT RemoteConsumerDataPipeImpl final
   // consumed.
   size_t consumer_num_bytes_;
 
-  // Used for two-phase writes.
+  // Used for two-phase writes (if the buffer isn't shared).
   scoped_ptr<char, base::AlignedFreeDeleter> buffer_;
 
+  // Set if the buffer is shared (until it's destroyed); the mapping is of the
+  // entire buffer, and |write_index_| is the index at which to write next.
+  scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer_;
+  scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping_;
+  size_t write_index_;
+
   MOJO_DISALLOW_COPY_AND_ASSIGN(RemoteConsumerDataPipeImpl);
 };
 
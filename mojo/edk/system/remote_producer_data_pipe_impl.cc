@@ -24,21 +24,44 @@ namespace system {
 
 namespace {
 
+// Validates |message|, which should contain data (or, if |buffer_is_shared|,
+// indicate that data was written to the shared buffer). On success, sets
+// |*num_bytes| to the amount of data.
 bool ValidateIncomingMessage(size_t element_num_bytes,
                              size_t capacity_num_bytes,
                              size_t current_num_bytes,
-                             const MessageInTransit* message) {
+                             bool buffer_is_shared,
+                             const MessageInTransit* message,
+                             size_t* num_bytes_out) {
   // We should only receive endpoint client messages.
   DCHECK_EQ(message->type(), MessageInTransit::Type::ENDPOINT_CLIENT);
 
-  // But we should check the subtype; only take data messages.
-  if (message->subtype() != MessageInTransit::Subtype::ENDPOINT_CLIENT_DATA) {
+  // But we should check the subtype; only take data messages (or shared write
+  // messages, if the buffer is shared).
+  const MessageInTransit::Subtype expected_subtype =
+      buffer_is_shared
+          ? MessageInTransit::Subtype::ENDPOINT_CLIENT_DATA_PIPE_SHARED_WRITE
+          : MessageInTransit::Subtype::ENDPOINT_CLIENT_DATA;
+  if (message->subtype() != expected_subtype) {
     LOG(WARNING) << "Received message of unexpected subtype: "
                  << message->subtype();
     return false;
   }
 
-  const size_t num_bytes = message->num_bytes();
+  size_t num_bytes;
+  if (buffer_is_shared) {
+    if (message->num_bytes() != sizeof(RemoteDataPipeSharedWrite)) {
+      LOG(WARNING) << "Incorrect message size: " << message->num_bytes()
+                   << " bytes (expected: " << sizeof(RemoteDataPipeSharedWrite)
+                   << " bytes)";
+      return false;
+    }
+    num_bytes = static_cast<const RemoteDataPipeSharedWrite*>(message->bytes())
+                    ->num_bytes_written;
+  } else {
+    num_bytes = message->num_bytes();
+  }
+
   const size_t max_num_bytes = capacity_num_bytes - current_num_bytes;
   if (num_bytes > max_num_bytes) {
     LOG(WARNING) << "Received too much data: " << num_bytes
@@ -53,6 +76,7 @@ bool ValidateIncomingMessage(size_t element_num_bytes,
     return false;
   }
 
+  *num_bytes_out = num_bytes;
   return true;
 }
 
@@ -78,6 +102,21 @@ RemoteProducerDataPipeImpl::RemoteProducerDataPipeImpl(
   DCHECK(buffer_ || !current_num_bytes);
 }
 
+RemoteProducerDataPipeImpl::RemoteProducerDataPipeImpl(
+    ChannelEndpoint* channel_endpoint,
+    scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+    scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+    size_t start_index,
+    size_t current_num_bytes)
+    : channel_endpoint_(channel_endpoint),
+      shared_buffer_(shared_buffer),
+      shared_buffer_mapping_(shared_buffer_mapping.Pass()),
+      start_index_(start_index),
+      current_num_bytes_(current_num_bytes) {
+  DCHECK(shared_buffer_);
+  DCHECK(shared_buffer_mapping_);
+}
+
 // static
 bool RemoteProducerDataPipeImpl::ProcessMessagesFromIncomingEndpoint(
     const MojoCreateDataPipeOptions& validated_options,
@@ -97,15 +136,17 @@ bool RemoteProducerDataPipeImpl::ProcessMessagesFromIncomingEndpoint(
   if (messages) {
     while (!messages->IsEmpty()) {
       scoped_ptr<MessageInTransit> message(messages->GetMessage());
+      size_t num_bytes = 0;
       if (!ValidateIncomingMessage(element_num_bytes, capacity_num_bytes,
-                                   current_num_bytes, message.get())) {
+                                   current_num_bytes, false, message.get(),
+                                   &num_bytes)) {
         messages->Clear();
         return false;
       }
 
       memcpy(new_buffer.get() + current_num_bytes, message->bytes(),
-             message->num_bytes());
-      current_num_bytes += message->num_bytes();
+             num_bytes);
+      current_num_bytes += num_bytes;
     }
   }
 
@@ -114,6 +155,34 @@ bool RemoteProducerDataPipeImpl::ProcessMessagesFromIncomingEndpoint(
   return true;
 }
 
+// static
+bool RemoteProducerDataPipeImpl::ProcessSharedWritesFromIncomingEndpoint(
+    const MojoCreateDataPipeOptions& validated_options,
+    MessageInTransitQueue* messages,
+    size_t* buffer_num_bytes) {
+  const size_t element_num_bytes = validated_options.element_num_bytes;
+  const size_t capacity_num_bytes = validated_options.capacity_num_bytes;
+
+  size_t current_num_bytes = 0;
+  if (messages) {
+    while (!messages->IsEmpty()) {
+      scoped_ptr<MessageInTransit> message(messages->GetMessage());
+      size_t num_bytes = 0;
+      if (!ValidateIncomingMessage(element_num_bytes, capacity_num_bytes,
+                                   current_num_bytes, true, message.get(),
+                                   &num_bytes)) {
+        messages->Clear();
+        return false;
+      }
+
+      current_num_bytes += num_bytes;
+    }
+  }
+
+  *buffer_num_bytes = current_num_bytes;
+  return true;
+}
+
 RemoteProducerDataPipeImpl::~RemoteProducerDataPipeImpl() {
 }
 
@@ -198,12 +267,12 @@ MojoResult RemoteProducerDataPipeImpl::ConsumerReadData(
   // The amount we can read in our first |memcpy()|.
   size_t num_bytes_to_read_first =
       std::min(num_bytes_to_read, GetMaxNumBytesToRead());
-  elements.PutArray(buffer_.get() + start_index_, num_bytes_to_read_first);
+  elements.PutArray(GetBuffer() + start_index_, num_bytes_to_read_first);
 
   if (num_bytes_to_read_first < num_bytes_to_read) {
     // The "second read index" is zero.
     elements.At(num_bytes_to_read_first)
-        .PutArray(buffer_.get(), num_bytes_to_read - num_bytes_to_read_first);
+        .PutArray(GetBuffer(), num_bytes_to_read - num_bytes_to_read_first);
   }
 
   if (!peek)
@@ -265,7 +334,7 @@ MojoResult RemoteProducerDataPipeImpl::ConsumerBeginReadData(
                            : MOJO_RESULT_FAILED_PRECONDITION;
   }
 
-  buffer.Put(buffer_.get() + start_index_);
+  buffer.Put(GetBuffer() + start_index_);
   buffer_num_bytes.Put(static_cast<uint32_t>(max_num_bytes_to_read));
   set_consumer_two_phase_max_num_bytes_read(
       static_cast<uint32_t>(max_num_bytes_to_read));
@@ -304,7 +373,7 @@ void RemoteProducerDataPipeImpl::ConsumerStartSerialize(
     size_t* max_platform_handles) {
   *max_size = sizeof(SerializedDataPipeConsumerDispatcher) +
               channel->GetSerializedEndpointSize();
-  *max_platform_handles = 0;
+  *max_platform_handles = shared_buffer_ ? 1 : 0;
 }
 
 bool RemoteProducerDataPipeImpl::ConsumerEndSerialize(
@@ -315,12 +384,30 @@ bool RemoteProducerDataPipeImpl::ConsumerEndSerialize(
   SerializedDataPipeConsumerDispatcher* s =
       static_cast<SerializedDataPipeConsumerDispatcher*>(destination);
   s->validated_options = validated_options();
+  s->shared_buffer_platform_handle_index = kNoSharedBuffer;
+  s->shared_buffer_read_index = 0;
   void* destination_for_endpoint = static_cast<char*>(destination) +
                                    sizeof(SerializedDataPipeConsumerDispatcher);
 
   MessageInTransitQueue message_queue;
-  ConvertDataToMessages(buffer_.get(), &start_index_, &current_num_bytes_,
-                        &message_queue);
+  if (shared_buffer_) {
+    // The data stays where it is (the producer will continue writing to the
+    // shared buffer), so we only have to tell the new consumer where it is.
+    if (!SerializeSharedBuffer(shared_buffer_.get(), platform_handles,
+                               &s->shared_buffer_platform_handle_index)) {
+      if (producer_open())
+        Disconnect();
+      return false;
+    }
+    s->shared_buffer_read_index = static_cast<uint32_t>(start_index_);
+    if (current_num_bytes_ > 0)
+      message_queue.AddMessage(CreateSharedWriteMessage(current_num_bytes_));
+    start_index_ = 0;
+    current_num_bytes_ = 0;
+  } else {
+    ConvertDataToMessages(buffer_.get(), &start_index_, &current_num_bytes_,
+                          &message_queue);
+  }
 
   if (!producer_open()) {
     // Case 1: The producer is closed.
@@ -357,13 +444,21 @@ bool RemoteProducerDataPipeImpl::OnReadMessage(unsigned /*port*/,
     return true;
   }
 
+  size_t num_bytes = 0;
   if (!ValidateIncomingMessage(element_num_bytes(), capacity_num_bytes(),
-                               current_num_bytes_, msg.get())) {
+                               current_num_bytes_, !!shared_buffer_, msg.get(),
+                               &num_bytes)) {
     Disconnect();
     return true;
   }
 
-  size_t num_bytes = msg->num_bytes();
+  if (shared_buffer_) {
+    // The data is already in the shared buffer.
+    current_num_bytes_ += num_bytes;
+    DCHECK_LE(current_num_bytes_, capacity_num_bytes());
+    return true;
+  }
+
   // The amount we can write in our first copy.
   size_t num_bytes_to_copy_first = std::min(num_bytes, GetMaxNumBytesToWrite());
   // Do the first (and possibly only) copy.
@@ -404,6 +499,10 @@ void RemoteProducerDataPipeImpl::EnsureBuffer() {
 }
 
 void RemoteProducerDataPipeImpl::DestroyBuffer() {
+  // Note: Don't scribble on the shared buffer, since the producer may still be
+  // writing to it.
+  shared_buffer_mapping_.reset();
+  shared_buffer_ = nullptr;
 #ifndef NDEBUG
   // Scribble on the buffer to help detect use-after-frees. (This also helps the
   // unit test detect certain bugs without needing ASAN or similar.)
@@ -413,6 +512,12 @@ void RemoteProducerDataPipeImpl::DestroyBuffer() {
   buffer_.reset();
 }
 
+char* RemoteProducerDataPipeImpl::GetBuffer() {
+  if (shared_buffer_mapping_)
+    return static_cast<char*>(shared_buffer_mapping_->GetBase());
+  return buffer_.get();
+}
+
 size_t RemoteProducerDataPipeImpl::GetMaxNumBytesToWrite() {
   size_t next_index = start_index_ + current_num_bytes_;
   if (next_index >= capacity_num_bytes()) {
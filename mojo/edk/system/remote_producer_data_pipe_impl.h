@@ -8,6 +8,7 @@
 #include "base/memory/aligned_memory.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "mojo/edk/embedder/platform_shared_buffer.h"
 #include "mojo/edk/system/channel_endpoint.h"
 #include "mojo/edk/system/data_pipe_impl.h"
 #include "mojo/edk/system/system_impl_export.h"
@@ -21,6 +22,13 @@ class MessageInTransitQueue;
 // |RemoteProducerDataPipeImpl| is a subclass that "implements" |DataPipe| for
 // data pipes whose producer is remote and whose consumer is local. See
 // |DataPipeImpl| for more details.
+//
+// If the data pipe's (circular) buffer is in shared memory, the producer writes
+// directly into it and only tells us how much it wrote, so reads (in
+// particular, two-phase reads) are directly from the shared buffer. Note that
+// the producer can modify the shared buffer at any time, so we never rely on
+// its contents (our state, e.g., |start_index_| and |current_num_bytes_|, is
+// all local).
 class MOJO_SYSTEM_IMPL_EXPORT RemoteProducerDataPipeImpl final
     : public DataPipeImpl {
  public:
@@ -29,6 +37,14 @@ class MOJO_SYSTEM_IMPL_EXPORT RemoteProducerDataPipeImpl final
                              scoped_ptr<char, base::AlignedFreeDeleter> buffer,
                              size_t start_index,
                              size_t current_num_bytes);
+  // For a data pipe whose buffer is shared. |shared_buffer_mapping| should map
+  // all of |shared_buffer|.
+  RemoteProducerDataPipeImpl(
+      ChannelEndpoint* channel_endpoint,
+      scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer,
+      scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping,
+      size_t start_index,
+      size_t current_num_bytes);
   ~RemoteProducerDataPipeImpl() override;
 
   // Processes messages that were received and queued by an |IncomingEndpoint|.
@@ -41,6 +57,15 @@ class MOJO_SYSTEM_IMPL_EXPORT RemoteProducerDataPipeImpl final
       scoped_ptr<char, base::AlignedFreeDeleter>* buffer,
       size_t* buffer_num_bytes);
 
+  // Like |ProcessMessagesFromIncomingEndpoint()|, but for a data pipe whose
+  // buffer is shared, in which case the messages only indicate how much data
+  // was written (to the shared buffer). On success, returns true and sets
+  // |*buffer_num_bytes|. On failure, returns false. Always clears |*messages|.
+  static bool ProcessSharedWritesFromIncomingEndpoint(
+      const MojoCreateDataPipeOptions& validated_options,
+      MessageInTransitQueue* messages,
+      size_t* buffer_num_bytes);
+
  private:
   // |DataPipeImpl| implementation:
   // Note: None of the |Producer...()| methods should be called, except
@@ -92,6 +117,9 @@ class MOJO_SYSTEM_IMPL_EXPORT RemoteProducerDataPipeImpl final
   void EnsureBuffer();
   void DestroyBuffer();
 
+  // Gets the circular buffer (which is either |buffer_| or the shared buffer).
+  char* GetBuffer();
+
   // Get the maximum (single) write/read size right now (in number of elements);
   // result fits in a |uint32_t|.
   size_t GetMaxNumBytesToWrite();
@@ -108,6 +136,10 @@ class MOJO_SYSTEM_IMPL_EXPORT RemoteProducerDataPipeImpl final
   scoped_refptr<ChannelEndpoint> channel_endpoint_;
 
   scoped_ptr<char, base::AlignedFreeDeleter> buffer_;
+  // Set if the buffer is shared (until it's destroyed), in which case |buffer_|
+  // is not used; the mapping is of the entire buffer.
+  scoped_refptr<embedder::PlatformSharedBuffer> shared_buffer_;
+  scoped_ptr<embedder::PlatformSharedBufferMapping> shared_buffer_mapping_;
   // Circular buffer.
   size_t start_index_;
   size_t current_num_bytes_;
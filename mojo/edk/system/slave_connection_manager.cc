@@ -134,7 +134,7 @@ void SlaveConnectionManager::InitOnPrivateThread(
   AssertOnPrivateThread();
 
   raw_channel_ = RawChannel::Create(platform_handle.Pass());
-  raw_channel_->Init(this);
+  raw_channel_->Init(this, platform_support());
   event_.Signal();
 }
 
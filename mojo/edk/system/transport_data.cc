@@ -10,6 +10,7 @@
 #include "mojo/edk/system/channel.h"
 #include "mojo/edk/system/configuration.h"
 #include "mojo/edk/system/message_in_transit.h"
+#include "mojo/edk/system/message_in_transit_buffer_pool.h"
 
 namespace mojo {
 namespace system {
@@ -114,7 +115,7 @@ TransportData::TransportData(scoped_ptr<DispatcherVector> dispatchers,
   }
 
   buffer_.reset(static_cast<char*>(
-      base::AlignedAlloc(estimated_size, MessageInTransit::kMessageAlignment)));
+      MessageInTransitBufferPool::Allocate(estimated_size)));
   // Entirely clear out the secondary buffer, since then we won't have to worry
   // about clearing padding or unused space (e.g., if a dispatcher fails to
   // serialize).
@@ -198,8 +199,8 @@ TransportData::TransportData(
   buffer_size_ = MessageInTransit::RoundUpMessageAlignment(
       sizeof(Header) +
       platform_handles_->size() * serialized_platform_handle_size);
-  buffer_.reset(static_cast<char*>(
-      base::AlignedAlloc(buffer_size_, MessageInTransit::kMessageAlignment)));
+  buffer_.reset(
+      static_cast<char*>(MessageInTransitBufferPool::Allocate(buffer_size_)));
   memset(buffer_.get(), 0, buffer_size_);
 
   Header* header = reinterpret_cast<Header*>(buffer_.get());
@@ -9,12 +9,12 @@
 
 #include <vector>
 
-#include "base/memory/aligned_memory.h"
 #include "base/memory/scoped_ptr.h"
 #include "build/build_config.h"
 #include "mojo/edk/embedder/platform_handle.h"
 #include "mojo/edk/embedder/platform_handle_vector.h"
 #include "mojo/edk/system/dispatcher.h"
+#include "mojo/edk/system/message_in_transit_buffer_pool.h"
 #include "mojo/edk/system/system_impl_export.h"
 #include "mojo/public/cpp/system/macros.h"
 
@@ -101,6 +101,15 @@ class MOJO_SYSTEM_IMPL_EXPORT TransportData {
 
   ~TransportData();
 
+  // Like |MessageInTransit|s, |TransportData|s are allocated from the
+  // |MessageInTransitBufferPool|.
+  static void* operator new(size_t size) {
+    return MessageInTransitBufferPool::Allocate(size);
+  }
+  static void operator delete(void* ptr) {
+    MessageInTransitBufferPool::Free(ptr);
+  }
+
   const void* buffer() const { return buffer_.get(); }
   void* buffer() { return buffer_.get(); }
   size_t buffer_size() const { return buffer_size_; }
@@ -174,7 +183,8 @@ class MOJO_SYSTEM_IMPL_EXPORT TransportData {
   }
 
   size_t buffer_size_;
-  scoped_ptr<char, base::AlignedFreeDeleter> buffer_;  // Never null.
+  // Never null.
+  scoped_ptr<char, MessageInTransitBufferPool::Deleter> buffer_;
 
   // Any platform-specific handles attached to this message (for inter-process
   // transport). The vector (if any) owns the handles that it contains (and is
@@ -0,0 +1,320 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/edk/system/wait_set.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/time/time.h"
+#include "mojo/edk/system/dispatcher.h"
+#include "mojo/edk/system/mutex.h"
+
+namespace mojo {
+namespace system {
+
+// WaitSet::Entry --------------------------------------------------------------
+
+// An |Entry| is referenced by its |WaitSet| (while it's in the set and/or on the
+// ready queue) and, while it's registered with its dispatcher, by "itself"
+// (since an |AwakableList| only has a raw pointer). An entry that is still
+// registered when it's removed from the set (or when the set is closed) drops
+// the latter reference the next time it's awoken.
+class WaitSet::Entry final : public Awakable,
+                             public base::RefCountedThreadSafe<Entry> {
+ public:
+  Entry(scoped_refptr<WaitSet> wait_set,
+        scoped_refptr<Dispatcher> dispatcher,
+        MojoHandleSignals signals,
+        uint64_t cookie)
+      : wait_set_(wait_set),
+        dispatcher_(dispatcher),
+        signals_(signals),
+        cookie_(cookie),
+        is_registered_(false),
+        is_ready_(false),
+        is_removed_(false) {}
+
+  Dispatcher* dispatcher() const { return dispatcher_.get(); }
+  MojoHandleSignals signals() const { return signals_; }
+  uint64_t cookie() const { return cookie_; }
+
+  // |Awakable| implementation:
+  bool Awake(MojoResult result, uintptr_t /*context*/) override {
+    bool keep = true;
+    {
+      base::AutoLock locker(wait_set_->lock_);
+      // Note: On |MOJO_RESULT_CANCELLED|, the |AwakableList| drops us no matter
+      // what we return.
+      if (result == MOJO_RESULT_CANCELLED || is_removed_ ||
+          wait_set_->is_closed_) {
+        DCHECK(is_registered_);
+        is_registered_ = false;
+        keep = false;
+      }
+      if (!is_removed_ && !wait_set_->is_closed_)
+        wait_set_->MakeReadyNoLock(this);
+    }
+    // Drop the reference for the registration. (This may destroy |this|, so
+    // must be done without |wait_set_->lock_| held.)
+    if (!keep)
+      Release();
+    return keep;
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<Entry>;
+  friend class WaitSet;
+
+  ~Entry() { DCHECK(!is_registered_); }
+
+  const scoped_refptr<WaitSet> wait_set_;
+  const scoped_refptr<Dispatcher> dispatcher_;
+  const MojoHandleSignals signals_;
+  const uint64_t cookie_;
+
+  // Held while registering with or unregistering from |dispatcher_|. This is
+  // taken before |dispatcher_|'s lock (and never under |wait_set_->lock_|).
+  Mutex registration_mutex_;
+
+  // These are protected by |wait_set_->lock_|:
+  // Set if we're (or are about to be) in |dispatcher_|'s |AwakableList|.
+  bool is_registered_;
+  // Set if we're on |wait_set_->ready_queue_|.
+  bool is_ready_;
+  // Set if we've been removed from |wait_set_|.
+  bool is_removed_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(Entry);
+};
+
+// WaitSet ---------------------------------------------------------------------
+
+WaitSet::WaitSet() : cv_(&lock_), is_closed_(false) {
+}
+
+WaitSet::~WaitSet() {
+  DCHECK(is_closed_);
+  DCHECK(entries_.empty());
+  DCHECK(ready_queue_.empty());
+}
+
+MojoResult WaitSet::Add(scoped_refptr<Dispatcher> dispatcher,
+                        MojoHandleSignals signals,
+                        uint64_t cookie) {
+  DCHECK(dispatcher);
+
+  base::AutoLock locker(lock_);
+  if (is_closed_)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+  if (entries_.find(cookie) != entries_.end())
+    return MOJO_RESULT_ALREADY_EXISTS;
+
+  // Don't register the entry with |dispatcher| here (we can't call out with
+  // |lock_| held). Instead, just make it ready; the next |Wait()| will either
+  // report it or register it.
+  scoped_refptr<Entry> entry(
+      new Entry(make_scoped_refptr(this), dispatcher, signals, cookie));
+  entries_[cookie] = entry;
+  MakeReadyNoLock(entry.get());
+  return MOJO_RESULT_OK;
+}
+
+MojoResult WaitSet::Remove(uint64_t cookie) {
+  scoped_refptr<Entry> entry;
+  {
+    base::AutoLock locker(lock_);
+    if (is_closed_)
+      return MOJO_RESULT_INVALID_ARGUMENT;
+    EntryMap::iterator it = entries_.find(cookie);
+    if (it == entries_.end())
+      return MOJO_RESULT_NOT_FOUND;
+    entry = it->second;
+    entries_.erase(it);
+    // If it's on the ready queue, it'll be dropped when it's dequeued.
+    entry->is_removed_ = true;
+  }
+
+  MutexLocker registration_locker(&entry->registration_mutex_);
+  entry->dispatcher()->RemoveAwakable(entry.get(), nullptr);
+  bool was_registered;
+  {
+    base::AutoLock locker(lock_);
+    was_registered = entry->is_registered_;
+    entry->is_registered_ = false;
+  }
+  if (was_registered)
+    entry->Release();
+  return MOJO_RESULT_OK;
+}
+
+MojoResult WaitSet::Wait(MojoDeadline deadline,
+                         uint32_t max_results,
+                         MojoWaitSetResult* results,
+                         uint32_t* num_results) {
+  DCHECK_GT(max_results, 0u);
+  DCHECK(results);
+  DCHECK(num_results);
+
+  // See the comment in |Waiter::Wait()| about the handling of |deadline|.
+  const bool is_indefinite =
+      deadline > static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+  const base::TimeTicks end_time =
+      is_indefinite ? base::TimeTicks()
+                    : base::TimeTicks::Now() +
+                          base::TimeDelta::FromMicroseconds(
+                              static_cast<int64_t>(deadline));
+
+  std::vector<scoped_refptr<Entry>> candidates;
+  for (;;) {
+    {
+      base::AutoLock locker(lock_);
+      while (!is_closed_ && ready_queue_.empty()) {
+        if (is_indefinite) {
+          cv_.Wait();
+        } else {
+          base::TimeTicks now_time = base::TimeTicks::Now();
+          if (now_time >= end_time)
+            return MOJO_RESULT_DEADLINE_EXCEEDED;
+          cv_.TimedWait(end_time - now_time);
+        }
+      }
+      if (is_closed_)
+        return MOJO_RESULT_CANCELLED;
+
+      // Only look at (at most) as many entries as we can report. Anything that
+      // we report goes to the back of the queue, so the next wait will start
+      // with the entries that we didn't get to.
+      size_t num_candidates =
+          std::min(ready_queue_.size(), static_cast<size_t>(max_results));
+      candidates.clear();
+      candidates.reserve(num_candidates);
+      for (size_t i = 0; i < num_candidates; i++) {
+        scoped_refptr<Entry> entry = ready_queue_.front();
+        ready_queue_.pop_front();
+        entry->is_ready_ = false;
+        if (!entry->is_removed_)
+          candidates.push_back(entry);
+      }
+    }
+
+    uint32_t count = 0;
+    for (size_t i = 0; i < candidates.size(); i++) {
+      if (CheckEntry(candidates[i].get(), &results[count]))
+        count++;
+    }
+    // If none of the candidates was actually ready, none of them was put back
+    // on the ready queue, so it's safe to just try again.
+    if (count > 0) {
+      *num_results = count;
+      return MOJO_RESULT_OK;
+    }
+  }
+}
+
+void WaitSet::Close() {
+  EntryMap entries;
+  std::deque<scoped_refptr<Entry>> ready_queue;
+  {
+    base::AutoLock locker(lock_);
+    DCHECK(!is_closed_);
+    is_closed_ = true;
+    for (EntryMap::iterator it = entries_.begin(); it != entries_.end(); ++it)
+      it->second->is_removed_ = true;
+    std::swap(entries, entries_);
+    std::swap(ready_queue, ready_queue_);
+    cv_.Broadcast();
+  }
+  // Note: We can't call out to the entries' dispatchers (we're called under our
+  // dispatcher's lock), so entries that are still registered stay registered
+  // until they're next awoken (or their dispatchers are closed).
+}
+
+void WaitSet::MakeReadyNoLock(Entry* entry) {
+  lock_.AssertAcquired();
+  DCHECK(!is_closed_);
+  DCHECK(!entry->is_removed_);
+
+  if (!entry->is_ready_) {
+    entry->is_ready_ = true;
+    ready_queue_.push_back(make_scoped_refptr(entry));
+  }
+  cv_.Signal();
+}
+
+bool WaitSet::CheckEntry(Entry* entry, MojoWaitSetResult* result) {
+  // Registering and unregistering (in |Remove()|) must not interleave.
+  MutexLocker registration_locker(&entry->registration_mutex_);
+
+  bool was_registered;
+  {
+    base::AutoLock locker(lock_);
+    if (entry->is_removed_)
+      return false;
+    was_registered = entry->is_registered_;
+    if (!was_registered) {
+      // Claim the registration (and take a reference for it) before actually
+      // registering, since we may be awoken as soon as we're registered.
+      entry->is_registered_ = true;
+      entry->AddRef();
+    }
+  }
+
+  HandleSignalsState state;
+  MojoResult wait_result;
+  if (was_registered) {
+    state = entry->dispatcher()->GetHandleSignalsState();
+    if (state.satisfies(entry->signals()))
+      wait_result = MOJO_RESULT_OK;
+    else if (!state.can_satisfy(entry->signals()))
+      wait_result = MOJO_RESULT_FAILED_PRECONDITION;
+    else
+      return false;  // We'll be awoken when the state changes.
+  } else {
+    MojoResult rv =
+        entry->dispatcher()->AddAwakable(entry, entry->signals(), 0, &state);
+    if (rv == MOJO_RESULT_OK)
+      return false;  // Registered: We'll be awoken when the state changes.
+
+    // Not registered, so we can undo our claim.
+    {
+      base::AutoLock locker(lock_);
+      entry->is_registered_ = false;
+    }
+    entry->Release();
+
+    switch (rv) {
+      case MOJO_RESULT_ALREADY_EXISTS:
+        wait_result = MOJO_RESULT_OK;
+        break;
+      case MOJO_RESULT_FAILED_PRECONDITION:
+        wait_result = MOJO_RESULT_FAILED_PRECONDITION;
+        break;
+      default:
+        // The dispatcher has been closed.
+        DCHECK_EQ(rv, MOJO_RESULT_INVALID_ARGUMENT);
+        wait_result = MOJO_RESULT_CANCELLED;
+        state = HandleSignalsState();
+        break;
+    }
+  }
+
+  result->cookie = entry->cookie();
+  result->wait_result = wait_result;
+  result->reserved = 0;
+  result->signals_state = state;
+
+  // Still ready, so put it back (at the end of the queue).
+  {
+    base::AutoLock locker(lock_);
+    if (!entry->is_removed_ && !is_closed_)
+      MakeReadyNoLock(entry);
+  }
+  return true;
+}
+
+}  // namespace system
+}  // namespace mojo
@@ -0,0 +1,101 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_EDK_SYSTEM_WAIT_SET_H_
+#define MOJO_EDK_SYSTEM_WAIT_SET_H_
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "mojo/edk/system/awakable.h"
+#include "mojo/edk/system/handle_signals_state.h"
+#include "mojo/edk/system/system_impl_export.h"
+#include "mojo/public/c/system/types.h"
+#include "mojo/public/c/system/wait_set.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace system {
+
+class Dispatcher;
+
+// |WaitSet| is the secondary object implementing a wait set (see the
+// explanatory comment in core.cc). It is owned by the |WaitSetDispatcher|.
+//
+// Each entry is an |Awakable| that stays registered with its dispatcher (via
+// |Dispatcher::AddAwakable()|) across waits. When an entry is awoken, it is
+// put on a ready queue; |Wait()| only looks at entries on the ready queue, so
+// its cost is proportional to the number of ready entries rather than to the
+// size of the set. Entries are level-triggered: an entry is taken off the
+// ready queue only once |Wait()| finds that its condition no longer holds (at
+// which point it is registered again).
+//
+// |lock_| is a "terminal" lock (at the same level as |Waiter| locks -- see the
+// comment in core.cc), since entries are awoken under other objects' locks.
+// In particular, |WaitSet| never calls out to dispatchers with |lock_| held.
+//
+// This class is thread-safe.
+class MOJO_SYSTEM_IMPL_EXPORT WaitSet final
+    : public base::RefCountedThreadSafe<WaitSet> {
+ public:
+  WaitSet();
+
+  // Adds an entry for |dispatcher| (which must not be null), watching for
+  // |signals|. See |MojoWaitSetAdd()| for more details.
+  MojoResult Add(scoped_refptr<Dispatcher> dispatcher,
+                 MojoHandleSignals signals,
+                 uint64_t cookie);
+
+  // Removes the entry for |cookie|. See |MojoWaitSetRemove()|.
+  MojoResult Remove(uint64_t cookie);
+
+  // Waits for at least one entry to become ready, writing up to |max_results|
+  // (which must be nonzero) results to |results| and setting |*num_results| to
+  // the number written. See |MojoWaitSetWait()|.
+  MojoResult Wait(MojoDeadline deadline,
+                  uint32_t max_results,
+                  MojoWaitSetResult* results,
+                  uint32_t* num_results);
+
+  // Cancels any ongoing waits and drops all entries. No other methods may be
+  // called after this.
+  void Close();
+
+ private:
+  friend class base::RefCountedThreadSafe<WaitSet>;
+
+  class Entry;
+
+  using EntryMap = std::map<uint64_t, scoped_refptr<Entry>>;
+
+  ~WaitSet();
+
+  // Called (under |lock_|) by |Entry::Awake()|.
+  void MakeReadyNoLock(Entry* entry);
+
+  // Checks the current state of |entry| (which has been taken off the ready
+  // queue), registering it with its dispatcher if it is no longer ready.
+  // Returns true (and fills in |*result|) if |entry| is ready, in which case it
+  // is put back at the end of the ready queue. Must be called without |lock_|.
+  bool CheckEntry(Entry* entry, MojoWaitSetResult* result);
+
+  base::ConditionVariable cv_;  // Associated to |lock_|.
+  base::Lock lock_;             // Protects the following members.
+  bool is_closed_;
+  EntryMap entries_;
+  // Entries that may be ready, in the order in which they should be reported.
+  std::deque<scoped_refptr<Entry>> ready_queue_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(WaitSet);
+};
+
+}  // namespace system
+}  // namespace mojo
+
+#endif  // MOJO_EDK_SYSTEM_WAIT_SET_H_
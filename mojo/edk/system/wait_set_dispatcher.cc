@@ -0,0 +1,117 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/edk/system/wait_set_dispatcher.h"
+
+#include "base/logging.h"
+#include "mojo/edk/system/options_validation.h"
+#include "mojo/edk/system/wait_set.h"
+
+namespace mojo {
+namespace system {
+
+// static
+const MojoCreateWaitSetOptions WaitSetDispatcher::kDefaultCreateOptions = {
+    static_cast<uint32_t>(sizeof(MojoCreateWaitSetOptions)),
+    MOJO_CREATE_WAIT_SET_OPTIONS_FLAG_NONE};
+
+// static
+scoped_refptr<WaitSetDispatcher> WaitSetDispatcher::Create(
+    const MojoCreateWaitSetOptions& /*validated_options*/) {
+  return make_scoped_refptr(new WaitSetDispatcher(nullptr));
+}
+
+// static
+MojoResult WaitSetDispatcher::ValidateCreateOptions(
+    UserPointer<const MojoCreateWaitSetOptions> in_options,
+    MojoCreateWaitSetOptions* out_options) {
+  const MojoCreateWaitSetOptionsFlags kKnownFlags =
+      MOJO_CREATE_WAIT_SET_OPTIONS_FLAG_NONE;
+
+  *out_options = kDefaultCreateOptions;
+  if (in_options.IsNull())
+    return MOJO_RESULT_OK;
+
+  UserOptionsReader<MojoCreateWaitSetOptions> reader(in_options);
+  if (!reader.is_valid())
+    return MOJO_RESULT_INVALID_ARGUMENT;
+
+  if (!OPTIONS_STRUCT_HAS_MEMBER(MojoCreateWaitSetOptions, flags, reader))
+    return MOJO_RESULT_OK;
+  if ((reader.options().flags & ~kKnownFlags))
+    return MOJO_RESULT_UNIMPLEMENTED;
+  out_options->flags = reader.options().flags;
+
+  // Checks for fields beyond |flags|:
+
+  // (Nothing here yet.)
+
+  return MOJO_RESULT_OK;
+}
+
+Dispatcher::Type WaitSetDispatcher::GetType() const {
+  return Type::WAIT_SET;
+}
+
+MojoResult WaitSetDispatcher::Add(scoped_refptr<Dispatcher> dispatcher,
+                                  MojoHandleSignals signals,
+                                  uint64_t cookie) {
+  DCHECK(dispatcher);
+  DCHECK_NE(dispatcher.get(), this);
+
+  scoped_refptr<WaitSet> wait_set = GetWaitSet();
+  if (!wait_set)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+  return wait_set->Add(dispatcher, signals, cookie);
+}
+
+MojoResult WaitSetDispatcher::Remove(uint64_t cookie) {
+  scoped_refptr<WaitSet> wait_set = GetWaitSet();
+  if (!wait_set)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+  return wait_set->Remove(cookie);
+}
+
+MojoResult WaitSetDispatcher::Wait(MojoDeadline deadline,
+                                   uint32_t max_results,
+                                   MojoWaitSetResult* results,
+                                   uint32_t* num_results) {
+  scoped_refptr<WaitSet> wait_set = GetWaitSet();
+  if (!wait_set)
+    return MOJO_RESULT_INVALID_ARGUMENT;
+  return wait_set->Wait(deadline, max_results, results, num_results);
+}
+
+WaitSetDispatcher::WaitSetDispatcher(scoped_refptr<WaitSet> wait_set)
+    : wait_set_(wait_set ? wait_set : make_scoped_refptr(new WaitSet())) {
+}
+
+WaitSetDispatcher::~WaitSetDispatcher() {
+  // |Close()|/|CloseImplNoLock()| should have taken care of the wait set.
+  DCHECK(!wait_set_);
+}
+
+scoped_refptr<WaitSet> WaitSetDispatcher::GetWaitSet() {
+  MutexLocker locker(&mutex());
+  return wait_set_;
+}
+
+void WaitSetDispatcher::CloseImplNoLock() {
+  mutex().AssertHeld();
+  wait_set_->Close();
+  wait_set_ = nullptr;
+}
+
+scoped_refptr<Dispatcher>
+WaitSetDispatcher::CreateEquivalentDispatcherAndCloseImplNoLock() {
+  mutex().AssertHeld();
+
+  scoped_refptr<WaitSetDispatcher> rv =
+      make_scoped_refptr(new WaitSetDispatcher(wait_set_));
+  wait_set_ = nullptr;
+  return scoped_refptr<Dispatcher>(rv.get());
+}
+
+}  // namespace system
+}  // namespace mojo
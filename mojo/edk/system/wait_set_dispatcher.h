@@ -0,0 +1,84 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_EDK_SYSTEM_WAIT_SET_DISPATCHER_H_
+#define MOJO_EDK_SYSTEM_WAIT_SET_DISPATCHER_H_
+
+#include <stdint.h>
+
+#include "base/memory/ref_counted.h"
+#include "mojo/edk/system/dispatcher.h"
+#include "mojo/edk/system/memory.h"
+#include "mojo/edk/system/system_impl_export.h"
+#include "mojo/public/c/system/wait_set.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace system {
+
+class WaitSet;
+
+// This is the |Dispatcher| implementation for wait sets (created by the Mojo
+// primitive |MojoCreateWaitSet()|). Unlike other dispatchers, the wait set
+// operations are not done under the |Dispatcher| lock (since they must call
+// out to other dispatchers, and |Wait()| blocks); |WaitSet| does its own
+// locking. This class is thread-safe.
+class MOJO_SYSTEM_IMPL_EXPORT WaitSetDispatcher final : public Dispatcher {
+ public:
+  // The default options to use for |MojoCreateWaitSet()|. (Real uses should
+  // obtain this via |ValidateCreateOptions()| with a null |in_options|; this is
+  // exposed directly for testing convenience.)
+  static const MojoCreateWaitSetOptions kDefaultCreateOptions;
+
+  static scoped_refptr<WaitSetDispatcher> Create(
+      const MojoCreateWaitSetOptions& validated_options);
+
+  // Validates and/or sets default options for |MojoCreateWaitSetOptions|. If
+  // non-null, |in_options| must point to a struct of at least
+  // |in_options->struct_size| bytes. |out_options| must point to a (current)
+  // |MojoCreateWaitSetOptions| and will be entirely overwritten on success (it
+  // may be partly overwritten on failure).
+  static MojoResult ValidateCreateOptions(
+      UserPointer<const MojoCreateWaitSetOptions> in_options,
+      MojoCreateWaitSetOptions* out_options);
+
+  // |Dispatcher| public methods:
+  Type GetType() const override;
+
+  // These implement |MojoWaitSetAdd()|, |MojoWaitSetRemove()|, and
+  // |MojoWaitSetWait()|, respectively. |dispatcher| must not be null (nor
+  // |this|). For |Wait()|, |max_results| must be nonzero; |*num_results| is
+  // only set on success.
+  MojoResult Add(scoped_refptr<Dispatcher> dispatcher,
+                 MojoHandleSignals signals,
+                 uint64_t cookie);
+  MojoResult Remove(uint64_t cookie);
+  MojoResult Wait(MojoDeadline deadline,
+                  uint32_t max_results,
+                  MojoWaitSetResult* results,
+                  uint32_t* num_results);
+
+ private:
+  // If |wait_set| is null, a new |WaitSet| is created.
+  explicit WaitSetDispatcher(scoped_refptr<WaitSet> wait_set);
+  ~WaitSetDispatcher() override;
+
+  // Gets |wait_set_| (under |mutex()|); returns null if closed.
+  scoped_refptr<WaitSet> GetWaitSet();
+
+  // |Dispatcher| protected methods:
+  void CloseImplNoLock() override;
+  scoped_refptr<Dispatcher> CreateEquivalentDispatcherAndCloseImplNoLock()
+      override;
+
+  // This will be null if closed.
+  scoped_refptr<WaitSet> wait_set_ MOJO_GUARDED_BY(mutex());
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(WaitSetDispatcher);
+};
+
+}  // namespace system
+}  // namespace mojo
+
+#endif  // MOJO_EDK_SYSTEM_WAIT_SET_DISPATCHER_H_
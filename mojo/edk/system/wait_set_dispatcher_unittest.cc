@@ -0,0 +1,249 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// NOTE(vtl): Some of these tests are inherently flaky (e.g., if run on a
+// heavily-loaded system). Sorry. |test::EpsilonDeadline()| may be increased to
+// increase tolerance and reduce observed flakiness (though doing so reduces the
+// meaningfulness of the test).
+
+#include "mojo/edk/system/wait_set_dispatcher.h"
+
+#include "base/memory/ref_counted.h"
+#include "base/threading/simple_thread.h"
+#include "mojo/edk/system/message_pipe.h"
+#include "mojo/edk/system/message_pipe_dispatcher.h"
+#include "mojo/edk/system/test_utils.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace system {
+namespace {
+
+class WaitSetDispatcherTest : public testing::Test {
+ public:
+  WaitSetDispatcherTest() {}
+  ~WaitSetDispatcherTest() override {}
+
+  void SetUp() override {
+    d0_ = MessagePipeDispatcher::Create(
+        MessagePipeDispatcher::kDefaultCreateOptions);
+    d1_ = MessagePipeDispatcher::Create(
+        MessagePipeDispatcher::kDefaultCreateOptions);
+    scoped_refptr<MessagePipe> mp(MessagePipe::CreateLocalLocal());
+    d0_->Init(mp, 0);
+    d1_->Init(mp, 1);
+  }
+
+  void TearDown() override {
+    if (d0_)
+      EXPECT_EQ(MOJO_RESULT_OK, d0_->Close());
+    if (d1_)
+      EXPECT_EQ(MOJO_RESULT_OK, d1_->Close());
+  }
+
+ protected:
+  void WriteTo(Dispatcher* dispatcher) {
+    static const char kHello[] = "hello";
+    EXPECT_EQ(MOJO_RESULT_OK,
+              dispatcher->WriteMessage(UserPointer<const void>(kHello),
+                                       sizeof(kHello), nullptr,
+                                       MOJO_WRITE_MESSAGE_FLAG_NONE));
+  }
+
+  void ReadFrom(Dispatcher* dispatcher) {
+    char buffer[100];
+    uint32_t buffer_size = static_cast<uint32_t>(sizeof(buffer));
+    EXPECT_EQ(MOJO_RESULT_OK,
+              dispatcher->ReadMessage(UserPointer<void>(buffer),
+                                      MakeUserPointer(&buffer_size), nullptr,
+                                      nullptr, MOJO_READ_MESSAGE_FLAG_NONE));
+  }
+
+  scoped_refptr<MessagePipeDispatcher> d0_;
+  scoped_refptr<MessagePipeDispatcher> d1_;
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(WaitSetDispatcherTest);
+};
+
+TEST_F(WaitSetDispatcherTest, Basic) {
+  scoped_refptr<WaitSetDispatcher> ws =
+      WaitSetDispatcher::Create(WaitSetDispatcher::kDefaultCreateOptions);
+  EXPECT_EQ(Dispatcher::Type::WAIT_SET, ws->GetType());
+
+  MojoWaitSetResult results[2];
+  uint32_t num_results = 0;
+
+  // Empty: times out.
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            ws->Wait(0, 2, results, &num_results));
+
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Add(d0_, MOJO_HANDLE_SIGNAL_READABLE, 123));
+  EXPECT_EQ(MOJO_RESULT_ALREADY_EXISTS,
+            ws->Add(d1_, MOJO_HANDLE_SIGNAL_READABLE, 123));
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Add(d1_, MOJO_HANDLE_SIGNAL_WRITABLE, 456));
+
+  // |d1_| is writable.
+  num_results = 0;
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Wait(0, 2, results, &num_results));
+  ASSERT_EQ(1u, num_results);
+  EXPECT_EQ(456u, results[0].cookie);
+  EXPECT_EQ(MOJO_RESULT_OK, results[0].wait_result);
+  EXPECT_TRUE(results[0].signals_state.satisfied_signals &
+              MOJO_HANDLE_SIGNAL_WRITABLE);
+
+  // Stop watching |d1_|; now nothing is ready.
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Remove(456));
+  EXPECT_EQ(MOJO_RESULT_NOT_FOUND, ws->Remove(456));
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            ws->Wait(0, 2, results, &num_results));
+
+  // Make |d0_| readable. It stays ready until it's read from.
+  WriteTo(d1_.get());
+  for (int i = 0; i < 2; i++) {
+    num_results = 0;
+    EXPECT_EQ(MOJO_RESULT_OK, ws->Wait(MOJO_DEADLINE_INDEFINITE, 2, results,
+                                       &num_results));
+    ASSERT_EQ(1u, num_results);
+    EXPECT_EQ(123u, results[0].cookie);
+    EXPECT_EQ(MOJO_RESULT_OK, results[0].wait_result);
+  }
+  ReadFrom(d0_.get());
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            ws->Wait(0, 2, results, &num_results));
+
+  // And again (now that the entry is registered with |d0_|).
+  WriteTo(d1_.get());
+  num_results = 0;
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Wait(0, 2, results, &num_results));
+  ASSERT_EQ(1u, num_results);
+  EXPECT_EQ(123u, results[0].cookie);
+
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Close());
+}
+
+TEST_F(WaitSetDispatcherTest, PeerClosedAndCancelled) {
+  scoped_refptr<WaitSetDispatcher> ws =
+      WaitSetDispatcher::Create(WaitSetDispatcher::kDefaultCreateOptions);
+
+  MojoWaitSetResult results[1];
+  uint32_t num_results = 0;
+
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Add(d0_, MOJO_HANDLE_SIGNAL_READABLE, 1));
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            ws->Wait(0, 1, results, &num_results));
+
+  // Closing the peer makes |d0_| never readable.
+  EXPECT_EQ(MOJO_RESULT_OK, d1_->Close());
+  d1_ = nullptr;
+  num_results = 0;
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Wait(0, 1, results, &num_results));
+  ASSERT_EQ(1u, num_results);
+  EXPECT_EQ(1u, results[0].cookie);
+  EXPECT_EQ(MOJO_RESULT_FAILED_PRECONDITION, results[0].wait_result);
+
+  // Closing |d0_| itself cancels the entry.
+  EXPECT_EQ(MOJO_RESULT_OK, d0_->Close());
+  d0_ = nullptr;
+  num_results = 0;
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Wait(0, 1, results, &num_results));
+  ASSERT_EQ(1u, num_results);
+  EXPECT_EQ(1u, results[0].cookie);
+  EXPECT_EQ(MOJO_RESULT_CANCELLED, results[0].wait_result);
+
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Remove(1));
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            ws->Wait(0, 1, results, &num_results));
+
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Close());
+}
+
+TEST_F(WaitSetDispatcherTest, RoundRobin) {
+  scoped_refptr<WaitSetDispatcher> ws =
+      WaitSetDispatcher::Create(WaitSetDispatcher::kDefaultCreateOptions);
+
+  // Both ends are writable.
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Add(d0_, MOJO_HANDLE_SIGNAL_WRITABLE, 0));
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Add(d1_, MOJO_HANDLE_SIGNAL_WRITABLE, 1));
+
+  // With room for only one result, the two entries should alternate.
+  MojoWaitSetResult results[1];
+  uint32_t num_results = 0;
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Wait(0, 1, results, &num_results));
+  ASSERT_EQ(1u, num_results);
+  uint64_t first = results[0].cookie;
+  for (int i = 1; i < 6; i++) {
+    num_results = 0;
+    EXPECT_EQ(MOJO_RESULT_OK, ws->Wait(0, 1, results, &num_results));
+    ASSERT_EQ(1u, num_results);
+    EXPECT_EQ((first + i) % 2, results[0].cookie);
+  }
+
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Close());
+}
+
+class WaitSetWaitThread : public base::SimpleThread {
+ public:
+  explicit WaitSetWaitThread(scoped_refptr<WaitSetDispatcher> wait_set)
+      : base::SimpleThread("wait_set_wait_thread"),
+        wait_set_(wait_set),
+        result_(MOJO_RESULT_INTERNAL),
+        num_results_(0) {}
+  ~WaitSetWaitThread() override {}
+
+  MojoResult result() const { return result_; }
+  uint32_t num_results() const { return num_results_; }
+  const MojoWaitSetResult& first_result() const { return results_[0]; }
+
+ private:
+  void Run() override {
+    result_ = wait_set_->Wait(MOJO_DEADLINE_INDEFINITE, 1, results_,
+                              &num_results_);
+  }
+
+  scoped_refptr<WaitSetDispatcher> wait_set_;
+  MojoResult result_;
+  uint32_t num_results_;
+  MojoWaitSetResult results_[1];
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(WaitSetWaitThread);
+};
+
+TEST_F(WaitSetDispatcherTest, WaitOnOtherThread) {
+  scoped_refptr<WaitSetDispatcher> ws =
+      WaitSetDispatcher::Create(WaitSetDispatcher::kDefaultCreateOptions);
+  EXPECT_EQ(MOJO_RESULT_OK, ws->Add(d0_, MOJO_HANDLE_SIGNAL_READABLE, 7));
+
+  // Awoken by a state change.
+  {
+    WaitSetWaitThread thread(ws);
+    thread.Start();
+    test::Sleep(2 * test::EpsilonDeadline());
+    WriteTo(d1_.get());
+    thread.Join();
+    EXPECT_EQ(MOJO_RESULT_OK, thread.result());
+    ASSERT_EQ(1u, thread.num_results());
+    EXPECT_EQ(7u, thread.first_result().cookie);
+  }
+  ReadFrom(d0_.get());
+
+  // Cancelled by closing the wait set.
+  {
+    WaitSetWaitThread thread(ws);
+    thread.Start();
+    test::Sleep(2 * test::EpsilonDeadline());
+    EXPECT_EQ(MOJO_RESULT_OK, ws->Close());
+    thread.Join();
+    EXPECT_EQ(MOJO_RESULT_CANCELLED, thread.result());
+  }
+
+  // The entry is still registered with |d0_|; it should be dropped (without
+  // incident) when |d0_| next changes state.
+  WriteTo(d1_.get());
+}
+
+}  // namespace
+}  // namespace system
+}  // namespace mojo
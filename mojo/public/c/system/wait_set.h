@@ -0,0 +1,146 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file contains types/constants and functions specific to wait sets.
+//
+// A wait set is a persistent set of (handle, signals) pairs that may be waited
+// on. Unlike |MojoWaitMany()|, the set of handles is only described to the
+// system once (via |MojoWaitSetAdd()|), and the cost of a wait is proportional
+// to the number of handles that are ready rather than to the number of handles
+// in the set.
+//
+// Note: This header should be compilable as C.
+
+#ifndef MOJO_PUBLIC_C_SYSTEM_WAIT_SET_H_
+#define MOJO_PUBLIC_C_SYSTEM_WAIT_SET_H_
+
+#include "mojo/public/c/system/macros.h"
+#include "mojo/public/c/system/system_export.h"
+#include "mojo/public/c/system/types.h"
+
+// |MojoCreateWaitSetOptions|: Used to specify creation parameters for a wait
+// set to |MojoCreateWaitSet()|.
+//   |uint32_t struct_size|: Set to the size of the |MojoCreateWaitSetOptions|
+//       struct. (Used to allow for future extensions.)
+//   |MojoCreateWaitSetOptionsFlags flags|: Reserved for future use.
+//       |MOJO_CREATE_WAIT_SET_OPTIONS_FLAG_NONE|: No flags; default mode.
+
+typedef uint32_t MojoCreateWaitSetOptionsFlags;
+
+#ifdef __cplusplus
+const MojoCreateWaitSetOptionsFlags MOJO_CREATE_WAIT_SET_OPTIONS_FLAG_NONE = 0;
+#else
+#define MOJO_CREATE_WAIT_SET_OPTIONS_FLAG_NONE \
+  ((MojoCreateWaitSetOptionsFlags)0)
+#endif
+
+MOJO_STATIC_ASSERT(MOJO_ALIGNOF(int64_t) == 8, "int64_t has weird alignment");
+struct MOJO_ALIGNAS(8) MojoCreateWaitSetOptions {
+  uint32_t struct_size;
+  MojoCreateWaitSetOptionsFlags flags;
+};
+MOJO_STATIC_ASSERT(sizeof(MojoCreateWaitSetOptions) == 8,
+                   "MojoCreateWaitSetOptions has wrong size");
+
+// |MojoWaitSetResult|: Returned by |MojoWaitSetWait()| to indicate the state of
+// a handle in a wait set. Members are as follows:
+//   - |cookie|: The cookie that was given to |MojoWaitSetAdd()| for the entry.
+//   - |wait_result|: The result for the entry, with the same meaning as the
+//         result of |MojoWait()| for the entry's handle and signals, i.e.:
+//         |MOJO_RESULT_OK| if some signal is satisfied,
+//         |MOJO_RESULT_FAILED_PRECONDITION| if none of the signals can ever be
+//         satisfied, or |MOJO_RESULT_CANCELLED| if the handle was closed.
+//   - |reserved|: Always set to zero.
+//   - |signals_state|: The signals state of the handle. (This is not valid if
+//         |wait_result| is |MOJO_RESULT_CANCELLED|.)
+struct MOJO_ALIGNAS(8) MojoWaitSetResult {
+  uint64_t cookie;
+  MojoResult wait_result;
+  uint32_t reserved;
+  struct MojoHandleSignalsState signals_state;
+};
+MOJO_STATIC_ASSERT(sizeof(MojoWaitSetResult) == 24,
+                   "MojoWaitSetResult has wrong size");
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Note: See the comment in functions.h about the meaning of the "optional"
+// label for pointer parameters.
+
+// Creates a new, empty wait set. |options| may be set to null for a wait set
+// with the default options.
+//
+// On success, |*wait_set_handle| is set to a handle to the new wait set.
+//
+// Returns:
+//   |MOJO_RESULT_OK| on success.
+//   |MOJO_RESULT_INVALID_ARGUMENT| if some argument was invalid (e.g.,
+//       |*options| is invalid).
+//   |MOJO_RESULT_RESOURCE_EXHAUSTED| if a process/system/quota/etc. limit has
+//       been reached.
+//   |MOJO_RESULT_UNIMPLEMENTED| if an unsupported flag was set in |*options|.
+MOJO_SYSTEM_EXPORT MojoResult MojoCreateWaitSet(
+    const struct MojoCreateWaitSetOptions* options,  // Optional.
+    MojoHandle* wait_set_handle);                    // Out.
+
+// Adds an entry to the wait set given by |wait_set_handle|, which will watch
+// |handle| for |signals|. The entry is identified by |cookie|, which must be
+// unique within the wait set. |handle| itself is not affected (in particular,
+// it must still be closed by the caller); if it is closed, the entry is
+// reported with |MOJO_RESULT_CANCELLED| until it is removed.
+//
+// Returns:
+//   |MOJO_RESULT_OK| on success.
+//   |MOJO_RESULT_INVALID_ARGUMENT| if |wait_set_handle| is not a valid wait set
+//       handle, or |handle| is not a valid handle (or is |wait_set_handle|).
+//   |MOJO_RESULT_ALREADY_EXISTS| if there is already an entry with |cookie|.
+MOJO_SYSTEM_EXPORT MojoResult MojoWaitSetAdd(MojoHandle wait_set_handle,
+                                             MojoHandle handle,
+                                             MojoHandleSignals signals,
+                                             uint64_t cookie);
+
+// Removes the entry identified by |cookie| from the wait set given by
+// |wait_set_handle|.
+//
+// Returns:
+//   |MOJO_RESULT_OK| on success.
+//   |MOJO_RESULT_INVALID_ARGUMENT| if |wait_set_handle| is not a valid wait set
+//       handle.
+//   |MOJO_RESULT_NOT_FOUND| if there is no entry with |cookie|.
+MOJO_SYSTEM_EXPORT MojoResult MojoWaitSetRemove(MojoHandle wait_set_handle,
+                                                uint64_t cookie);
+
+// Waits on the wait set given by |wait_set_handle| until at least one of its
+// entries is ready (i.e., |MojoWait()| on the entry's handle and signals would
+// return immediately), or until |deadline| has passed. See |MojoWait()| for
+// more details about |deadline|.
+//
+// |*num_results| must be set to the number of elements of |results| on input,
+// and must be at least 1. On success, it is set to the number of elements of
+// |results| that were filled in. Entries remain ready (and will be reported by
+// subsequent waits) for as long as the condition that made them ready holds;
+// ready entries are reported in round-robin order, so that a wait with a small
+// |*num_results| does not starve some entries.
+//
+// Returns:
+//   |MOJO_RESULT_OK| if some entry was ready; |results| is filled in.
+//   |MOJO_RESULT_INVALID_ARGUMENT| if |wait_set_handle| is not a valid wait set
+//       handle or |*num_results| is zero.
+//   |MOJO_RESULT_CANCELLED| if |wait_set_handle| was closed (necessarily from
+//       another thread) during the wait.
+//   |MOJO_RESULT_DEADLINE_EXCEEDED| if the deadline has passed without any
+//       entry becoming ready.
+MOJO_SYSTEM_EXPORT MojoResult
+    MojoWaitSetWait(MojoHandle wait_set_handle,
+                    MojoDeadline deadline,
+                    uint32_t* num_results,               // In/out.
+                    struct MojoWaitSetResult* results);  // Out.
+
+#ifdef __cplusplus
+}  // extern "C"
+#endif
+
+#endif  // MOJO_PUBLIC_C_SYSTEM_WAIT_SET_H_
@@ -0,0 +1,89 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_ARRAY_VIEW_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_ARRAY_VIEW_H_
+
+#include <stddef.h>
+
+#include "mojo/public/cpp/bindings/lib/array_internal.h"
+#include "mojo/public/cpp/bindings/lib/template_util.h"
+#include "mojo/public/cpp/environment/logging.h"
+
+namespace mojo {
+namespace internal {
+
+// Determines whether |T| is a view type (i.e., |StringView|, |ArrayView|, or a
+// generated struct view), all of which define |Data_|.
+template <typename T>
+struct IsView {
+  template <typename U>
+  static YesType Test(typename U::Data_*);
+  template <typename U>
+  static NoType Test(...);
+
+  static const bool value = sizeof(Test<T>(0)) == sizeof(YesType);
+};
+
+template <typename T, bool is_view = IsView<T>::value>
+struct ArrayViewTraits;
+
+// Arrays of plain values (numbers and bools): Elements are read directly.
+template <typename T>
+struct ArrayViewTraits<T, false> {
+  typedef Array_Data<T> DataType;
+  typedef typename DataType::ConstRef ElementType;
+
+  static inline ElementType At(const DataType* data, size_t offset) {
+    return data->at(offset);
+  }
+};
+
+// Arrays of strings, arrays or structs: Elements are returned as views.
+template <typename T>
+struct ArrayViewTraits<T, true> {
+  typedef Array_Data<typename T::Data_*> DataType;
+  typedef T ElementType;
+
+  static inline ElementType At(const DataType* data, size_t offset) {
+    return T(data->at(offset));
+  }
+};
+
+}  // namespace internal
+
+// A read-only view of a serialized array, which reads the elements directly out
+// of the (validated) message buffer instead of copying them into an |Array|.
+// |T| is either the element type (for arrays of numbers or bools) or the view
+// type for the elements (e.g., |StringView| for arrays of strings). A view
+// doesn't own anything, so it's only valid while the message that it points
+// into is. Like |Array|, a view can be null.
+template <typename T>
+class ArrayView {
+ public:
+  typedef internal::ArrayViewTraits<T> Traits;
+  typedef typename Traits::DataType Data_;
+  typedef typename Traits::ElementType ElementType;
+
+  ArrayView() : data_(nullptr) {}
+  explicit ArrayView(Data_* data) : data_(data) {}
+
+  bool is_null() const { return !data_; }
+
+  size_t size() const { return data_ ? data_->size() : 0; }
+
+  ElementType operator[](size_t offset) const {
+    MOJO_DCHECK(offset < size());
+    return Traits::At(data_, offset);
+  }
+
+  Data_* GetData_() const { return data_; }
+
+ private:
+  Data_* data_;
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_ARRAY_VIEW_H_
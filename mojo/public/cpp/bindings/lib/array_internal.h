@@ -162,6 +162,10 @@ struct ArraySerializationHelper<T, false> {
                                        ElementType* elements,
                                        std::vector<Handle>* handles) {}
 
+  static void RelocatePointers(const ArrayHeader* header,
+                               ElementType* elements,
+                               const ChunkedBuffer& buffer) {}
+
   static bool ValidateElements(const ArrayHeader* header,
                                const ElementType* elements,
                                BoundsChecker* bounds_checker,
@@ -186,6 +190,10 @@ struct ArraySerializationHelper<Handle, true> {
                                        ElementType* elements,
                                        std::vector<Handle>* handles);
 
+  static void RelocatePointers(const ArrayHeader* header,
+                               ElementType* elements,
+                               const ChunkedBuffer& buffer) {}
+
   static bool ValidateElements(const ArrayHeader* header,
                                const ElementType* elements,
                                BoundsChecker* bounds_checker,
@@ -231,6 +239,10 @@ struct ArraySerializationHelper<H, true> {
         header, elements, handles);
   }
 
+  static void RelocatePointers(const ArrayHeader* header,
+                               ElementType* elements,
+                               const ChunkedBuffer& buffer) {}
+
   static bool ValidateElements(const ArrayHeader* header,
                                const ElementType* elements,
                                BoundsChecker* bounds_checker,
@@ -258,6 +270,13 @@ struct ArraySerializationHelper<P*, false> {
       Decode(&elements[i], handles);
   }
 
+  static void RelocatePointers(const ArrayHeader* header,
+                               ElementType* elements,
+                               const ChunkedBuffer& buffer) {
+    for (uint32_t i = 0; i < header->num_elements; ++i)
+      Relocate(&elements[i], buffer);
+  }
+
   static bool ValidateElements(const ArrayHeader* header,
                                const ElementType* elements,
                                BoundsChecker* bounds_checker,
@@ -423,6 +442,10 @@ class Array_Data {
     Helper::DecodePointersAndHandles(&header_, storage(), handles);
   }
 
+  void RelocatePointers(const ChunkedBuffer& buffer) {
+    Helper::RelocatePointers(&header_, storage(), buffer);
+  }
+
  private:
   Array_Data(uint32_t num_bytes, uint32_t num_elements) {
     header_.num_bytes = num_bytes;
@@ -9,6 +9,7 @@
 
 #include "mojo/public/cpp/bindings/interface_ptr.h"
 #include "mojo/public/cpp/bindings/lib/bindings_internal.h"
+#include "mojo/public/cpp/bindings/lib/chunked_buffer.h"
 #include "mojo/public/cpp/system/core.h"
 
 namespace mojo {
@@ -70,6 +71,16 @@ inline void Decode(T* obj, std::vector<Handle>* handles) {
     obj->ptr->DecodePointersAndHandles(handles);
 }
 
+// Used by |ChunkedBuffer::Linearize()| to update the pointers to all objects
+// (structs and arrays) in a consistent manner.
+template <typename T>
+inline void Relocate(T* obj, const ChunkedBuffer& buffer) {
+  if (obj->ptr) {
+    obj->ptr = buffer.GetRelocated(obj->ptr);
+    obj->ptr->RelocatePointers(buffer);
+  }
+}
+
 template <typename T>
 inline void InterfacePointerToData(InterfacePtr<T> input,
                                    Interface_Data* output) {
@@ -0,0 +1,126 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/chunked_buffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include "mojo/public/cpp/bindings/lib/bindings_serialization.h"
+#include "mojo/public/cpp/environment/logging.h"
+
+namespace mojo {
+namespace internal {
+
+namespace {
+
+// The smallest chunk that's allocated. Most messages fit in this, so that a
+// reasonable |initial_size| needn't be known.
+const size_t kMinChunkSize = 512;
+
+}  // namespace
+
+ChunkedBuffer::ChunkedBuffer(size_t initial_size)
+    : initial_size_(Align(initial_size)), size_(0) {
+}
+
+ChunkedBuffer::~ChunkedBuffer() {
+  free(first_chunk_.data);
+  for (size_t i = 0; i < more_chunks_.size(); i++)
+    free(more_chunks_[i].data);
+}
+
+void* ChunkedBuffer::Allocate(size_t delta) {
+  delta = Align(delta);
+
+  if (delta == 0) {
+    MOJO_DCHECK(false) << "Not reached";
+    return nullptr;
+  }
+
+  Chunk* chunk = current_chunk();
+  if (delta > chunk->capacity - chunk->used)
+    chunk = AddChunk(delta);
+
+  char* result = chunk->data + chunk->used;
+  chunk->used += delta;
+  size_ += delta;
+  return result;
+}
+
+void* ChunkedBuffer::Leak() {
+  MOJO_DCHECK(is_contiguous());
+  char* ptr = first_chunk_.data;
+  first_chunk_ = Chunk();
+  size_ = 0;
+  return ptr;
+}
+
+ChunkedBuffer::Chunk* ChunkedBuffer::AddChunk(size_t min_capacity) {
+  // Make each chunk at least as large as all the previous ones, so that the
+  // number of chunks is logarithmic in the total size.
+  Chunk chunk;
+  chunk.capacity = std::max(min_capacity, kMinChunkSize);
+  if (!first_chunk_.data)
+    chunk.capacity = std::max(chunk.capacity, initial_size_);
+  else
+    chunk.capacity = std::max(chunk.capacity, size_);
+  // calloc() required to zero memory and thus avoid info leaks.
+  chunk.data = static_cast<char*>(calloc(chunk.capacity, 1));
+  MOJO_CHECK(chunk.data);
+  chunk.offset = size_;
+
+  if (!first_chunk_.data) {
+    first_chunk_ = chunk;
+    return &first_chunk_;
+  }
+  more_chunks_.push_back(chunk);
+  return &more_chunks_.back();
+}
+
+void ChunkedBuffer::CopyChunks() {
+  MOJO_DCHECK(old_chunks_.empty());
+
+  Chunk linearized;
+  linearized.capacity = size_;
+  linearized.data = static_cast<char*>(malloc(linearized.capacity));
+  MOJO_CHECK(linearized.data);
+  linearized.used = size_;
+
+  old_chunks_.push_back(first_chunk_);
+  old_chunks_.insert(old_chunks_.end(), more_chunks_.begin(),
+                     more_chunks_.end());
+  for (size_t i = 0; i < old_chunks_.size(); i++) {
+    memcpy(linearized.data + old_chunks_[i].offset, old_chunks_[i].data,
+           old_chunks_[i].used);
+  }
+
+  first_chunk_ = linearized;
+  more_chunks_.clear();
+}
+
+void ChunkedBuffer::FreeOldChunks() {
+  for (size_t i = 0; i < old_chunks_.size(); i++)
+    free(old_chunks_[i].data);
+  old_chunks_.clear();
+}
+
+void* ChunkedBuffer::GetRelocatedRaw(const void* ptr) const {
+  MOJO_DCHECK(is_contiguous());
+
+  const char* p = static_cast<const char*>(ptr);
+  // There are only ever a few chunks, so a linear search is fine.
+  for (size_t i = 0; i < old_chunks_.size(); i++) {
+    const Chunk& chunk = old_chunks_[i];
+    if (p >= chunk.data && p < chunk.data + chunk.used)
+      return first_chunk_.data + chunk.offset + (p - chunk.data);
+  }
+  MOJO_CHECK(false) << "Pointer not in buffer";
+  return nullptr;
+}
+
+}  // namespace internal
+}  // namespace mojo
@@ -0,0 +1,105 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_CHUNKED_BUFFER_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_CHUNKED_BUFFER_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "mojo/public/cpp/bindings/lib/buffer.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+namespace internal {
+
+// A |Buffer| that grows as needed, so that an object graph can be serialized
+// in a single pass, without first computing its exact size.
+//
+// Serialization keeps pointers into memory that it has already allocated, so
+// memory can't move while it's in progress. Instead, memory is allocated in
+// chunks (each at least as large as everything allocated before it). Offsets
+// into the buffer are as they would be for a single contiguous buffer, and if
+// more than one chunk was needed, |Linearize()| copies the chunks into a
+// single block and updates the pointers in the serialized data to match.
+class ChunkedBuffer : public Buffer {
+ public:
+  // The first chunk will have room for at least |initial_size| bytes. (If
+  // this is at least the total size needed, no copying is ever done.)
+  explicit ChunkedBuffer(size_t initial_size);
+  ~ChunkedBuffer() override;
+
+  // Grows the buffer by |num_bytes| and returns a pointer to the start of the
+  // addition. The resulting address is 8-byte aligned, and the content of the
+  // memory is zero-filled.
+  void* Allocate(size_t num_bytes) override;
+
+  // Returns the total number of bytes allocated.
+  size_t size() const { return size_; }
+
+  bool is_contiguous() const { return more_chunks_.empty(); }
+
+  // Makes the buffer contiguous (if it isn't already). |root| should be the
+  // root of the serialized data (i.e., an object with a |RelocatePointers()|
+  // method), all of whose pointers are updated; returns the new address of
+  // |root|. Any other pointers into the buffer are invalidated.
+  template <typename T>
+  T* Linearize(T* root) {
+    if (is_contiguous())
+      return root;
+    CopyChunks();
+    T* result = GetRelocated(root);
+    result->RelocatePointers(*this);
+    FreeOldChunks();
+    return result;
+  }
+
+  // For use by |RelocatePointers()| (during |Linearize()|): Returns the new
+  // address of the memory at |ptr|.
+  template <typename T>
+  T* GetRelocated(T* ptr) const {
+    return static_cast<T*>(GetRelocatedRaw(ptr));
+  }
+
+  // Returns the memory owned by the buffer (which must be contiguous) to the
+  // caller, who becomes responsible for |free()|ing it, and resets the buffer.
+  void* Leak();
+
+ private:
+  struct Chunk {
+    Chunk() : data(nullptr), capacity(0), used(0), offset(0) {}
+
+    char* data;
+    size_t capacity;
+    size_t used;
+    // The offset of the start of the chunk in the buffer as a whole.
+    size_t offset;
+  };
+
+  Chunk* current_chunk() {
+    return more_chunks_.empty() ? &first_chunk_ : &more_chunks_.back();
+  }
+
+  Chunk* AddChunk(size_t min_capacity);
+  void CopyChunks();
+  void FreeOldChunks();
+  void* GetRelocatedRaw(const void* ptr) const;
+
+  const size_t initial_size_;
+  // The first chunk is kept separately, since usually it's the only one.
+  Chunk first_chunk_;
+  std::vector<Chunk> more_chunks_;
+  // The chunks that were copied by |CopyChunks()|, which are kept until all
+  // pointers into them have been updated.
+  std::vector<Chunk> old_chunks_;
+  size_t size_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ChunkedBuffer);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_CHUNKED_BUFFER_H_
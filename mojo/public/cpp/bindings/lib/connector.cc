@@ -9,6 +9,16 @@
 namespace mojo {
 namespace internal {
 
+namespace {
+
+// The largest data buffer that |Connector| holds on to between messages. A
+// buffer grown for a bigger (rare) message is freed once the message has been
+// dispatched, so that one large message doesn't pin its memory for the
+// lifetime of the connection.
+const uint32_t kMaxReusableMessageCapacity = 64 * 1024;
+
+}  // namespace
+
 // ----------------------------------------------------------------------------
 
 Connector::Connector(ScopedMessagePipeHandle message_pipe,
@@ -147,8 +157,14 @@ bool Connector::ReadSingleMessage(MojoResult* read_result) {
   bool* previous_destroyed_flag = destroyed_flag_;
   destroyed_flag_ = &was_destroyed_during_dispatch;
 
-  MojoResult rv = ReadAndDispatchMessage(
-      message_pipe_.get(), incoming_receiver_, &receiver_result);
+  // Read into the data buffer left over from the previous message (if any).
+  // Note that |message| must live on the stack, since |this| may be destroyed
+  // during dispatch.
+  Message message;
+  message.Swap(&reusable_message_);
+  MojoResult rv = ReadMessage(message_pipe_.get(), &message);
+  if (incoming_receiver_ && rv == MOJO_RESULT_OK)
+    receiver_result = incoming_receiver_->Accept(&message);
   if (read_result)
     *read_result = rv;
 
@@ -159,6 +175,13 @@ bool Connector::ReadSingleMessage(MojoResult* read_result) {
   }
   destroyed_flag_ = previous_destroyed_flag;
 
+  // Keep the data buffer for the next message, unless it's too big (in which
+  // case it's freed along with |message|).
+  if (message.data_capacity() <= kMaxReusableMessageCapacity) {
+    message.Reset();
+    reusable_message_.Swap(&message);
+  }
+
   if (rv == MOJO_RESULT_SHOULD_WAIT)
     return true;
 
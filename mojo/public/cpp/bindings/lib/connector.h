@@ -104,6 +104,12 @@ class Connector : public MessageReceiver {
   bool drop_writes_;
   bool enforce_errors_from_incoming_receiver_;
 
+  // An empty (reset) message, whose data buffer is reused to read incoming
+  // messages so that reading doesn't have to allocate for each message. Its
+  // buffer is dropped rather than kept if it grows past a limit (see
+  // |kMaxReusableMessageCapacity| in connector.cc).
+  Message reusable_message_;
+
   // If non-null, this will be set to true when the Connector is destroyed.  We
   // use this flag to allow for the Connector to be destroyed as a side-effect
   // of dispatching an incoming message.
@@ -126,6 +126,11 @@ class Map_Data {
     Decode(&values, handles);
   }
 
+  void RelocatePointers(const ChunkedBuffer& buffer) {
+    Relocate(&keys, buffer);
+    Relocate(&values, buffer);
+  }
+
  private:
   Map_Data() {
     header_.num_bytes = sizeof(*this);
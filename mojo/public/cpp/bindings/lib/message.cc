@@ -12,66 +12,95 @@
 
 namespace mojo {
 
-Message::Message() : data_num_bytes_(0), data_(nullptr) {
+Message::Message() : data_num_bytes_(0), data_capacity_(0), data_(nullptr) {
 }
 
 Message::~Message() {
   free(data_);
-
-  for (std::vector<Handle>::iterator it = handles_.begin();
-       it != handles_.end();
-       ++it) {
-    if (it->is_valid())
-      CloseRaw(*it);
-  }
+  CloseHandles();
 }
 
 void Message::AllocUninitializedData(uint32_t num_bytes) {
-  MOJO_DCHECK(!data_);
+  MOJO_DCHECK(!data_num_bytes_);
+  if (num_bytes > data_capacity_) {
+    free(data_);
+    data_ = static_cast<internal::MessageData*>(malloc(num_bytes));
+    data_capacity_ = num_bytes;
+  }
   data_num_bytes_ = num_bytes;
-  data_ = static_cast<internal::MessageData*>(malloc(num_bytes));
 }
 
 void Message::AdoptData(uint32_t num_bytes, internal::MessageData* data) {
-  MOJO_DCHECK(!data_);
+  MOJO_DCHECK(!data_num_bytes_);
+  free(data_);
   data_num_bytes_ = num_bytes;
+  data_capacity_ = num_bytes;
   data_ = data;
 }
 
 void Message::Swap(Message* other) {
   std::swap(data_num_bytes_, other->data_num_bytes_);
+  std::swap(data_capacity_, other->data_capacity_);
   std::swap(data_, other->data_);
   std::swap(handles_, other->handles_);
 }
 
+void Message::Reset() {
+  CloseHandles();
+  handles_.clear();
+  data_num_bytes_ = 0;
+}
+
+void Message::CloseHandles() {
+  for (std::vector<Handle>::iterator it = handles_.begin();
+       it != handles_.end();
+       ++it) {
+    if (it->is_valid())
+      CloseRaw(*it);
+  }
+}
+
+MojoResult ReadMessage(MessagePipeHandle handle, Message* message) {
+  MOJO_DCHECK(!message->data_num_bytes_);
+  MOJO_DCHECK(message->handles_.empty());
+
+  // First try reading into the buffers that |message| already has, which (if
+  // it has been used to read messages before) are likely to be big enough.
+  // Only if they aren't do we have to allocate and read again.
+  std::vector<Handle>* handles = &message->handles_;
+  handles->resize(handles->capacity());
+  uint32_t num_bytes = message->data_capacity_;
+  uint32_t num_handles = static_cast<uint32_t>(handles->size());
+  MojoResult rv = ReadMessageRaw(
+      handle, message->data_, &num_bytes,
+      handles->empty() ? nullptr
+                       : reinterpret_cast<MojoHandle*>(&handles->front()),
+      &num_handles, MOJO_READ_MESSAGE_FLAG_NONE);
+  if (rv == MOJO_RESULT_RESOURCE_EXHAUSTED) {
+    message->AllocUninitializedData(num_bytes);
+    handles->resize(num_handles);
+    rv = ReadMessageRaw(
+        handle, message->data_, &num_bytes,
+        handles->empty() ? nullptr
+                         : reinterpret_cast<MojoHandle*>(&handles->front()),
+        &num_handles, MOJO_READ_MESSAGE_FLAG_NONE);
+  }
+  if (rv != MOJO_RESULT_OK) {
+    message->data_num_bytes_ = 0;
+    handles->clear();
+    return rv;
+  }
+
+  message->data_num_bytes_ = num_bytes;
+  handles->resize(num_handles);
+  return MOJO_RESULT_OK;
+}
+
 MojoResult ReadAndDispatchMessage(MessagePipeHandle handle,
                                   MessageReceiver* receiver,
                                   bool* receiver_result) {
-  MojoResult rv;
-
-  uint32_t num_bytes = 0, num_handles = 0;
-  rv = ReadMessageRaw(handle,
-                      nullptr,
-                      &num_bytes,
-                      nullptr,
-                      &num_handles,
-                      MOJO_READ_MESSAGE_FLAG_NONE);
-  if (rv != MOJO_RESULT_RESOURCE_EXHAUSTED)
-    return rv;
-
   Message message;
-  message.AllocUninitializedData(num_bytes);
-  message.mutable_handles()->resize(num_handles);
-
-  rv = ReadMessageRaw(
-      handle,
-      message.mutable_data(),
-      &num_bytes,
-      message.mutable_handles()->empty()
-          ? nullptr
-          : reinterpret_cast<MojoHandle*>(&message.mutable_handles()->front()),
-      &num_handles,
-      MOJO_READ_MESSAGE_FLAG_NONE);
+  MojoResult rv = ReadMessage(handle, &message);
   if (receiver && rv == MOJO_RESULT_OK)
     *receiver_result = receiver->Accept(&message);
 
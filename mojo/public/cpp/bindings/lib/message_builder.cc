@@ -5,6 +5,7 @@
 #include "mojo/public/cpp/bindings/lib/message_builder.h"
 
 #include "mojo/public/cpp/bindings/message.h"
+#include "mojo/public/cpp/environment/logging.h"
 
 namespace mojo {
 namespace internal {
@@ -27,6 +28,7 @@ MessageBuilder::~MessageBuilder() {
 }
 
 void MessageBuilder::Finish(Message* message) {
+  MOJO_DCHECK(buf_.is_contiguous());
   uint32_t num_bytes = static_cast<uint32_t>(buf_.size());
   message->AdoptData(num_bytes, static_cast<MessageData*>(buf_.Leak()));
 }
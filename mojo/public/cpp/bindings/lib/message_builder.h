@@ -7,7 +7,7 @@
 
 #include <stdint.h>
 
-#include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
+#include "mojo/public/cpp/bindings/lib/chunked_buffer.h"
 #include "mojo/public/cpp/bindings/lib/message_internal.h"
 
 namespace mojo {
@@ -15,6 +15,9 @@ class Message;
 
 namespace internal {
 
+// Note: |payload_size| need only be an estimate of the size of the payload;
+// the buffer grows as needed. (If it's accurate, the message is built in place;
+// otherwise, |Linearize()| must be called.)
 class MessageBuilder {
  public:
   MessageBuilder(uint32_t name, size_t payload_size);
@@ -22,14 +25,22 @@ class MessageBuilder {
 
   Buffer* buffer() { return &buf_; }
 
-  // Call Finish when done making allocations in |buffer()|. Upon return,
-  // |message| will contain the message data, and |buffer()| will no longer be
-  // valid to reference.
+  // Call Linearize when done making allocations in |buffer()|, with the root of
+  // the payload (before encoding the pointers in it). It returns the new
+  // address of |payload|, which may have had to be moved.
+  template <typename T>
+  T* Linearize(T* payload) {
+    return buf_.Linearize(payload);
+  }
+
+  // Call Finish when done making allocations in |buffer()| (and after
+  // |Linearize()|). Upon return, |message| will contain the message data, and
+  // |buffer()| will no longer be valid to reference.
   void Finish(Message* message);
 
  protected:
   explicit MessageBuilder(size_t size);
-  FixedBuffer buf_;
+  ChunkedBuffer buf_;
 
   MOJO_DISALLOW_COPY_AND_ASSIGN(MessageBuilder);
 };
@@ -0,0 +1,89 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/lib/responder_table.h"
+
+#include "mojo/public/cpp/bindings/message.h"
+#include "mojo/public/cpp/environment/logging.h"
+
+namespace mojo {
+namespace internal {
+
+ResponderTable::ResponderTable()
+    : free_head_(kNone), oldest_(kNone), newest_(kNone), size_(0) {
+}
+
+ResponderTable::~ResponderTable() {
+  for (size_t i = 0; i < slots_.size(); i++)
+    delete slots_[i].responder;
+}
+
+uint64_t ResponderTable::Add(MessageReceiver* responder,
+                             MojoTimeTicks send_time) {
+  MOJO_DCHECK(responder);
+
+  uint32_t index = free_head_;
+  if (index == kNone) {
+    // The index must leave room for the plus one in the request ID.
+    MOJO_CHECK(slots_.size() < kNone - 1u);
+    index = static_cast<uint32_t>(slots_.size());
+    Slot new_slot = {};
+    slots_.push_back(new_slot);
+  } else {
+    free_head_ = slots_[index].next;
+  }
+
+  Slot& slot = slots_[index];
+  slot.responder = responder;
+  slot.send_time = send_time;
+  slot.prev = newest_;
+  slot.next = kNone;
+  if (newest_ == kNone)
+    oldest_ = index;
+  else
+    slots_[newest_].next = index;
+  newest_ = index;
+  size_++;
+
+  return (static_cast<uint64_t>(slot.generation) << 32) | (index + 1u);
+}
+
+MessageReceiver* ResponderTable::Remove(uint64_t request_id) {
+  uint32_t index = static_cast<uint32_t>(request_id) - 1u;
+  uint32_t generation = static_cast<uint32_t>(request_id >> 32);
+  if (index >= slots_.size())
+    return nullptr;
+
+  Slot& slot = slots_[index];
+  if (!slot.responder || slot.generation != generation)
+    return nullptr;
+
+  MessageReceiver* responder = slot.responder;
+  Unlink(index);
+  slot.responder = nullptr;
+  slot.generation++;
+  slot.next = free_head_;
+  free_head_ = index;
+  size_--;
+  return responder;
+}
+
+MojoTimeTicks ResponderTable::oldest_send_time() const {
+  return oldest_ == kNone ? 0 : slots_[oldest_].send_time;
+}
+
+void ResponderTable::Unlink(uint32_t index) {
+  Slot& slot = slots_[index];
+  if (slot.prev == kNone)
+    oldest_ = slot.next;
+  else
+    slots_[slot.prev].next = slot.next;
+  if (slot.next == kNone)
+    newest_ = slot.prev;
+  else
+    slots_[slot.next].prev = slot.prev;
+}
+
+}  // namespace internal
+}  // namespace mojo
@@ -0,0 +1,84 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_RESPONDER_TABLE_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_LIB_RESPONDER_TABLE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "mojo/public/c/system/types.h"
+#include "mojo/public/cpp/system/macros.h"
+
+namespace mojo {
+
+class MessageReceiver;
+
+namespace internal {
+
+// Holds the responders for requests that are awaiting responses, keyed by
+// request ID. Adding, finding, and removing a responder are all O(1), and
+// don't allocate (except occasionally to grow the table).
+//
+// A request ID is made up of the index of the responder's slot in the table
+// (plus one, so that no request ID is zero) in its low 32 bits and the slot's
+// "generation" in its high 32 bits. The generation is incremented whenever
+// the slot is freed, so that a late or bogus response with an old request ID
+// doesn't find the responder of a later request.
+//
+// The responders are also kept in a list in the order in which they were
+// added, so that the age of the oldest one is available.
+class ResponderTable {
+ public:
+  ResponderTable();
+  // Deletes any responders remaining in the table.
+  ~ResponderTable();
+
+  // Adds |responder| (taking ownership of it) for a request that was sent at
+  // |send_time|, and returns the request ID for it, which is never zero.
+  uint64_t Add(MessageReceiver* responder, MojoTimeTicks send_time);
+
+  // Removes the responder for |request_id|, passing ownership of it to the
+  // caller. Returns null if there's no such responder.
+  MessageReceiver* Remove(uint64_t request_id);
+
+  // Returns the number of responders in the table.
+  size_t size() const { return size_; }
+
+  // Returns the send time of the oldest request in the table, or zero if the
+  // table is empty.
+  MojoTimeTicks oldest_send_time() const;
+
+ private:
+  static const uint32_t kNone = static_cast<uint32_t>(-1);
+
+  struct Slot {
+    // Null if the slot is free.
+    MessageReceiver* responder;
+    MojoTimeTicks send_time;
+    uint32_t generation;
+    // If the slot is in use, the adjacent slots in the list of responders in
+    // the order in which they were added. If the slot is free, |next| is the
+    // next slot in the free list.
+    uint32_t prev;
+    uint32_t next;
+  };
+
+  void Unlink(uint32_t index);
+
+  std::vector<Slot> slots_;
+  uint32_t free_head_;
+  uint32_t oldest_;
+  uint32_t newest_;
+  size_t size_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ResponderTable);
+};
+
+}  // namespace internal
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_LIB_RESPONDER_TABLE_H_
@@ -5,6 +5,7 @@
 #include "mojo/public/cpp/bindings/lib/router.h"
 
 #include "mojo/public/cpp/environment/logging.h"
+#include "mojo/public/cpp/system/functions.h"
 
 namespace mojo {
 namespace internal {
@@ -78,7 +79,6 @@ Router::Router(ScopedMessagePipeHandle message_pipe,
       connector_(message_pipe.Pass(), waiter),
       weak_self_(this),
       incoming_receiver_(nullptr),
-      next_request_id_(0),
       testing_mode_(false) {
   filters_.SetSink(&thunk_);
   connector_.set_incoming_receiver(filters_.GetHead());
@@ -86,12 +86,6 @@ Router::Router(ScopedMessagePipeHandle message_pipe,
 
 Router::~Router() {
   weak_self_.set_value(nullptr);
-
-  for (ResponderMap::const_iterator i = responders_.begin();
-       i != responders_.end();
-       ++i) {
-    delete i->second;
-  }
 }
 
 bool Router::Accept(Message* message) {
@@ -102,20 +96,26 @@ bool Router::Accept(Message* message) {
 bool Router::AcceptWithResponder(Message* message, MessageReceiver* responder) {
   MOJO_DCHECK(message->has_flag(kMessageExpectsResponse));
 
-  // Reserve 0 in case we want it to convey special meaning in the future.
-  uint64_t request_id = next_request_id_++;
-  if (request_id == 0)
-    request_id = next_request_id_++;
-
+  // Request IDs are never 0 (which is reserved in case we want it to convey
+  // special meaning in the future).
+  uint64_t request_id = responders_.Add(responder, GetTimeTicksNow());
   message->set_request_id(request_id);
-  if (!connector_.Accept(message))
+  if (!connector_.Accept(message)) {
+    // The caller retains ownership of |responder|.
+    responders_.Remove(request_id);
     return false;
+  }
 
   // We assume ownership of |responder|.
-  responders_[request_id] = responder;
   return true;
 }
 
+MojoTimeTicks Router::GetOldestPendingResponseAge() const {
+  if (!responders_.size())
+    return 0;
+  return GetTimeTicksNow() - responders_.oldest_send_time();
+}
+
 void Router::EnableTestingMode() {
   testing_mode_ = true;
   connector_.set_enforce_errors_from_incoming_receiver(false);
@@ -135,14 +135,11 @@ bool Router::HandleIncomingMessage(Message* message) {
     // listening, then we have no choice but to tear down the pipe.
     connector_.CloseMessagePipe();
   } else if (message->has_flag(kMessageIsResponse)) {
-    uint64_t request_id = message->request_id();
-    ResponderMap::iterator it = responders_.find(request_id);
-    if (it == responders_.end()) {
+    MessageReceiver* responder = responders_.Remove(message->request_id());
+    if (!responder) {
       MOJO_DCHECK(testing_mode_);
       return false;
     }
-    MessageReceiver* responder = it->second;
-    responders_.erase(it);
     bool ok = responder->Accept(message);
     delete responder;
     return ok;
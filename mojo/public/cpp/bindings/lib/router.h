@@ -5,11 +5,10 @@
 #ifndef MOJO_PUBLIC_CPP_BINDINGS_LIB_ROUTER_H_
 #define MOJO_PUBLIC_CPP_BINDINGS_LIB_ROUTER_H_
 
-#include <map>
-
 #include "mojo/public/cpp/bindings/callback.h"
 #include "mojo/public/cpp/bindings/lib/connector.h"
 #include "mojo/public/cpp/bindings/lib/filter_chain.h"
+#include "mojo/public/cpp/bindings/lib/responder_table.h"
 #include "mojo/public/cpp/bindings/lib/shared_data.h"
 #include "mojo/public/cpp/environment/environment.h"
 
@@ -68,9 +67,14 @@ class Router : public MessageReceiverWithResponder {
 
   MessagePipeHandle handle() const { return connector_.handle(); }
 
- private:
-  typedef std::map<uint64_t, MessageReceiver*> ResponderMap;
+  // Returns the number of requests sent that are still awaiting responses.
+  size_t num_pending_responses() const { return responders_.size(); }
 
+  // Returns how long ago the oldest request that is still awaiting a response
+  // was sent, or zero if there are none.
+  MojoTimeTicks GetOldestPendingResponseAge() const;
+
+ private:
   class HandleIncomingMessageThunk : public MessageReceiver {
    public:
     HandleIncomingMessageThunk(Router* router);
@@ -90,8 +94,7 @@ class Router : public MessageReceiverWithResponder {
   Connector connector_;
   SharedData<Router*> weak_self_;
   MessageReceiverWithResponderStatus* incoming_receiver_;
-  ResponderMap responders_;
-  uint64_t next_request_id_;
+  ResponderTable responders_;
   bool testing_mode_;
 };
 
@@ -21,15 +21,25 @@ class Message {
   Message();
   ~Message();
 
-  // These may only be called on a newly created Message object.
+  // These may only be called on a newly created (or reset) Message object.
+  // |AllocUninitializedData()| reuses the existing data buffer if it's large
+  // enough.
   void AllocUninitializedData(uint32_t num_bytes);
   void AdoptData(uint32_t num_bytes, internal::MessageData* data);
 
   // Swaps data and handles between this Message and another.
   void Swap(Message* other);
 
+  // Closes any handles and clears the data, but holds on to the data buffer
+  // (and the storage for handles) so that it can be reused, e.g., by
+  // |ReadMessage()|.
+  void Reset();
+
   uint32_t data_num_bytes() const { return data_num_bytes_; }
 
+  // The size of the data buffer, which may be larger than |data_num_bytes()|.
+  uint32_t data_capacity() const { return data_capacity_; }
+
   // Access the raw bytes of the message.
   const uint8_t* data() const {
     return reinterpret_cast<const uint8_t*>(data_);
@@ -72,7 +82,12 @@ class Message {
   std::vector<Handle>* mutable_handles() { return &handles_; }
 
  private:
+  friend MojoResult ReadMessage(MessagePipeHandle handle, Message* message);
+
+  void CloseHandles();
+
   uint32_t data_num_bytes_;
+  uint32_t data_capacity_;
   internal::MessageData* data_;  // Heap-allocated using malloc.
   std::vector<Handle> handles_;
 
@@ -139,6 +154,17 @@ class MessageReceiverWithResponderStatus : public MessageReceiver {
       MOJO_WARN_UNUSED_RESULT = 0;
 };
 
+// Reads a single message from the pipe into |message|, which must be newly
+// created or reset. Any data buffer (and handle storage) that |message|
+// already has is reused if it's large enough, so that reading a sequence of
+// messages into the same (reset) Message normally takes a single call to
+// |ReadMessageRaw()| and no allocations per message. Returns MOJO_RESULT_OK
+// on success; otherwise returns the result of |ReadMessageRaw()| (e.g.,
+// MOJO_RESULT_SHOULD_WAIT), in which case |message| is left empty.
+//
+// NOTE: The message hasn't been validated and may be malformed!
+MojoResult ReadMessage(MessagePipeHandle handle, Message* message);
+
 // Read a single message from the pipe and dispatch to the given receiver.  The
 // receiver may be null, in which case the message is simply discarded.
 // Returns MOJO_RESULT_SHOULD_WAIT if the caller should wait on the handle to
@@ -0,0 +1,43 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_STRING_VIEW_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_STRING_VIEW_H_
+
+#include <stddef.h>
+
+#include <string>
+
+#include "mojo/public/cpp/bindings/lib/array_internal.h"
+
+namespace mojo {
+
+// A read-only view of a serialized string, which reads the characters directly
+// out of the (validated) message buffer instead of copying them into a
+// |String|. A view doesn't own anything, so it's only valid while the message
+// that it points into is. Like |String|, a view can be null.
+class StringView {
+ public:
+  typedef internal::String_Data Data_;
+
+  StringView() : data_(nullptr) {}
+  explicit StringView(Data_* data) : data_(data) {}
+
+  bool is_null() const { return !data_; }
+
+  // Note that the characters are not null-terminated.
+  const char* data() const { return data_ ? data_->storage() : nullptr; }
+  size_t size() const { return data_ ? data_->size() : 0; }
+
+  std::string ToString() const { return std::string(data(), size()); }
+
+  Data_* GetData_() const { return data_; }
+
+ private:
+  Data_* data_;
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_STRING_VIEW_H_
@@ -0,0 +1,36 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef MOJO_PUBLIC_CPP_BINDINGS_STRUCT_WRITER_H_
+#define MOJO_PUBLIC_CPP_BINDINGS_STRUCT_WRITER_H_
+
+#include "mojo/public/cpp/bindings/lib/buffer.h"
+
+namespace mojo {
+
+// A struct writer serializes a mojom struct of type |S| (e.g., |Foo|, for a
+// |FooPtr| parameter) directly out of some other data structure, so that it
+// doesn't have to be converted to a |StructPtr| first just to be serialized.
+// The proxies of interfaces with the CppProxyMode="writers" attribute take
+// writers for their struct parameters (in the |...WithWriters()| methods),
+// which they have serialize the structs straight into the request message.
+//
+// The serialized struct must be exactly what |S|'s generated serialization
+// would produce (including any nested structs and arrays), except that its
+// pointers need not be encoded.
+template <typename S>
+class StructWriter {
+ public:
+  typedef typename S::Data_ Data_;
+
+  virtual ~StructWriter() {}
+
+  // Allocates the struct (and everything that it points to) in |buf| and sets
+  // |*output| to point to it. May be called more than once.
+  virtual void Serialize(internal::Buffer* buf, Data_** output) const = 0;
+};
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_BINDINGS_STRUCT_WRITER_H_
@@ -5,6 +5,7 @@
 #include <limits>
 
 #include "mojo/public/cpp/bindings/lib/bindings_serialization.h"
+#include "mojo/public/cpp/bindings/lib/chunked_buffer.h"
 #include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -66,6 +67,51 @@ TEST(FixedBufferTest, Leak) {
   free(buf_ptr);
 }
 
+// Tests that ChunkedBuffer allocates zeroed memory aligned to 8 byte
+// boundaries, and grows as needed.
+TEST(ChunkedBufferTest, Allocate) {
+  internal::ChunkedBuffer buf(16);
+  EXPECT_EQ(0u, buf.size());
+
+  void* a = buf.Allocate(10);
+  ASSERT_TRUE(a);
+  EXPECT_TRUE(IsZero(a, 10));
+  EXPECT_EQ(0, reinterpret_cast<ptrdiff_t>(a) % 8);
+  EXPECT_EQ(16u, buf.size());
+  EXPECT_TRUE(buf.is_contiguous());
+
+  // Allocations larger than the remaining space start a new chunk, but the
+  // memory that was already allocated stays where it is.
+  memset(a, 1, 10);
+  void* b = buf.Allocate(4096);
+  ASSERT_TRUE(b);
+  EXPECT_TRUE(IsZero(b, 4096));
+  EXPECT_EQ(0, reinterpret_cast<ptrdiff_t>(b) % 8);
+  EXPECT_EQ(16u + 4096u, buf.size());
+  EXPECT_FALSE(buf.is_contiguous());
+  EXPECT_EQ(1, static_cast<char*>(a)[9]);
+}
+
+// Tests that ChunkedBuffer::Leak passes ownership to the caller.
+TEST(ChunkedBufferTest, Leak) {
+  void* ptr = nullptr;
+  void* buf_ptr = nullptr;
+  {
+    internal::ChunkedBuffer buf(64);
+    ptr = buf.Allocate(8);
+    ASSERT_TRUE(ptr);
+    buf_ptr = buf.Leak();
+    EXPECT_EQ(ptr, buf_ptr);
+
+    // The ChunkedBuffer should be empty now.
+    EXPECT_EQ(0u, buf.size());
+    EXPECT_FALSE(buf.Leak());
+  }
+
+  memset(ptr, 1, 8);
+  free(buf_ptr);
+}
+
 #if defined(NDEBUG) && !defined(DCHECK_ALWAYS_ON)
 TEST(FixedBufferTest, TooBig) {
   internal::FixedBuffer buf(24);
@@ -5,6 +5,9 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <string>
+#include <vector>
+
 #include "mojo/public/cpp/bindings/lib/connector.h"
 #include "mojo/public/cpp/bindings/lib/message_builder.h"
 #include "mojo/public/cpp/bindings/tests/message_queue.h"
@@ -71,6 +74,27 @@ class ReentrantMessageAccumulator : public MessageAccumulator {
   int number_of_calls_;
 };
 
+// Records the payload and the data buffer capacity of each message it
+// receives, without taking the message (so that the |Connector| keeps it).
+class CapacityRecordingReceiver : public MessageReceiver {
+ public:
+  CapacityRecordingReceiver() {}
+
+  bool Accept(Message* message) override {
+    payloads_.push_back(
+        std::string(reinterpret_cast<const char*>(message->payload())));
+    capacities_.push_back(message->data_capacity());
+    return true;
+  }
+
+  const std::vector<std::string>& payloads() const { return payloads_; }
+  const std::vector<uint32_t>& capacities() const { return capacities_; }
+
+ private:
+  std::vector<std::string> payloads_;
+  std::vector<uint32_t> capacities_;
+};
+
 class ConnectorTest : public testing::Test {
  public:
   ConnectorTest() {}
@@ -389,6 +413,90 @@ TEST_F(ConnectorTest, WaitForIncomingMessageWithReentrancy) {
   ASSERT_EQ(2, accumulator.number_of_calls());
 }
 
+TEST_F(ConnectorTest, ReadMessageReusesBuffer) {
+  internal::Connector connector0(handle0_.Pass());
+
+  const char kText1[] = "hello world";
+  const char kText2[] = "hi";
+  const std::string text3(1000, 'x');
+
+  Message message;
+  AllocMessage(kText1, &message);
+  connector0.Accept(&message);
+  Message message2;
+  AllocMessage(kText2, &message2);
+  connector0.Accept(&message2);
+  Message message3;
+  AllocMessage(text3.c_str(), &message3);
+  MessagePipe pipe;
+  message3.mutable_handles()->push_back(pipe.handle0.release());
+  connector0.Accept(&message3);
+
+  Message message_received;
+  ASSERT_EQ(MOJO_RESULT_OK, ReadMessage(handle1_.get(), &message_received));
+  EXPECT_EQ(
+      std::string(kText1),
+      std::string(reinterpret_cast<const char*>(message_received.payload())));
+  EXPECT_TRUE(message_received.handles()->empty());
+  const uint8_t* data = message_received.data();
+
+  // The second (smaller) message should be read into the same buffer.
+  message_received.Reset();
+  ASSERT_EQ(MOJO_RESULT_OK, ReadMessage(handle1_.get(), &message_received));
+  EXPECT_EQ(
+      std::string(kText2),
+      std::string(reinterpret_cast<const char*>(message_received.payload())));
+  EXPECT_EQ(data, message_received.data());
+
+  // The buffer has to grow for the third message (which also has a handle).
+  message_received.Reset();
+  ASSERT_EQ(MOJO_RESULT_OK, ReadMessage(handle1_.get(), &message_received));
+  EXPECT_EQ(
+      text3,
+      std::string(reinterpret_cast<const char*>(message_received.payload())));
+  ASSERT_EQ(1u, message_received.handles()->size());
+  EXPECT_TRUE(message_received.handles()->front().is_valid());
+
+  // Resetting closes the handle.
+  message_received.Reset();
+  EXPECT_EQ(MOJO_RESULT_FAILED_PRECONDITION,
+            Wait(pipe.handle1.get(), MOJO_HANDLE_SIGNAL_READABLE,
+                 MOJO_DEADLINE_INDEFINITE, nullptr));
+
+  EXPECT_EQ(MOJO_RESULT_SHOULD_WAIT,
+            ReadMessage(handle1_.get(), &message_received));
+  EXPECT_EQ(0u, message_received.data_num_bytes());
+  EXPECT_TRUE(message_received.handles()->empty());
+}
+
+TEST_F(ConnectorTest, LargeMessageBufferNotReused) {
+  internal::Connector connector0(handle0_.Pass());
+  internal::Connector connector1(handle1_.Pass());
+
+  const std::string kTexts[] = {"hello", "hi", std::string(100 * 1024, 'x'),
+                                "world"};
+  for (const std::string& text : kTexts) {
+    Message message;
+    AllocMessage(text.c_str(), &message);
+    connector0.Accept(&message);
+  }
+
+  CapacityRecordingReceiver receiver;
+  connector1.set_incoming_receiver(&receiver);
+
+  PumpMessages();
+
+  ASSERT_EQ(4u, receiver.payloads().size());
+  for (size_t i = 0; i < 4u; i++)
+    EXPECT_EQ(kTexts[i], receiver.payloads()[i]);
+
+  // The first message's buffer is reused for the second ...
+  EXPECT_EQ(receiver.capacities()[0], receiver.capacities()[1]);
+  // ... but the (large) third message's buffer isn't kept for the fourth.
+  EXPECT_GT(receiver.capacities()[2], 100u * 1024u);
+  EXPECT_LT(receiver.capacities()[3], 1024u);
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace mojo
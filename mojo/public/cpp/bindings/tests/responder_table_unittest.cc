@@ -0,0 +1,126 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <set>
+
+#include "mojo/public/cpp/bindings/lib/responder_table.h"
+#include "mojo/public/cpp/bindings/message.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+// A responder that counts how many instances of it are alive.
+class CountingResponder : public MessageReceiver {
+ public:
+  explicit CountingResponder(int* num_alive) : num_alive_(num_alive) {
+    (*num_alive_)++;
+  }
+  ~CountingResponder() override { (*num_alive_)--; }
+
+  bool Accept(Message* message) override { return true; }
+
+ private:
+  int* const num_alive_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(CountingResponder);
+};
+
+TEST(ResponderTableTest, AddAndRemove) {
+  int num_alive = 0;
+  internal::ResponderTable table;
+  EXPECT_EQ(0u, table.size());
+  EXPECT_EQ(0, table.oldest_send_time());
+
+  MessageReceiver* r1 = new CountingResponder(&num_alive);
+  MessageReceiver* r2 = new CountingResponder(&num_alive);
+  uint64_t id1 = table.Add(r1, 100);
+  uint64_t id2 = table.Add(r2, 200);
+  EXPECT_NE(0u, id1);
+  EXPECT_NE(0u, id2);
+  EXPECT_NE(id1, id2);
+  EXPECT_EQ(2u, table.size());
+  EXPECT_EQ(100, table.oldest_send_time());
+
+  // Unknown IDs don't find anything.
+  EXPECT_FALSE(table.Remove(0));
+  EXPECT_FALSE(table.Remove(id2 + 1000));
+  EXPECT_EQ(2u, table.size());
+
+  EXPECT_EQ(r1, table.Remove(id1));
+  EXPECT_EQ(1u, table.size());
+  EXPECT_EQ(200, table.oldest_send_time());
+  // Each responder can only be removed once.
+  EXPECT_FALSE(table.Remove(id1));
+  delete r1;
+
+  EXPECT_EQ(r2, table.Remove(id2));
+  EXPECT_EQ(0u, table.size());
+  EXPECT_EQ(0, table.oldest_send_time());
+  delete r2;
+
+  EXPECT_EQ(0, num_alive);
+}
+
+// Tests that a request ID isn't reused right away when its slot is reused, so
+// that a stale response doesn't find a later request's responder.
+TEST(ResponderTableTest, ReusedSlot) {
+  int num_alive = 0;
+  internal::ResponderTable table;
+
+  MessageReceiver* r1 = new CountingResponder(&num_alive);
+  uint64_t id1 = table.Add(r1, 1);
+  EXPECT_EQ(r1, table.Remove(id1));
+  delete r1;
+
+  MessageReceiver* r2 = new CountingResponder(&num_alive);
+  uint64_t id2 = table.Add(r2, 2);
+  EXPECT_NE(id1, id2);
+  EXPECT_FALSE(table.Remove(id1));
+  EXPECT_EQ(r2, table.Remove(id2));
+  delete r2;
+}
+
+// Tests that the oldest send time is maintained as responders are removed in
+// an arbitrary order, and that the table deletes any remaining responders.
+TEST(ResponderTableTest, ManyResponders) {
+  const size_t kNumResponders = 1000;
+  int num_alive = 0;
+  {
+    internal::ResponderTable table;
+    uint64_t ids[kNumResponders];
+    std::set<uint64_t> unique_ids;
+    for (size_t i = 0; i < kNumResponders; i++) {
+      ids[i] = table.Add(new CountingResponder(&num_alive),
+                         static_cast<MojoTimeTicks>(i + 1));
+      unique_ids.insert(ids[i]);
+    }
+    EXPECT_EQ(kNumResponders, unique_ids.size());
+    EXPECT_EQ(kNumResponders, table.size());
+
+    // Remove the odd ones, and then the even ones in the first half.
+    for (size_t i = 1; i < kNumResponders; i += 2)
+      delete table.Remove(ids[i]);
+    EXPECT_EQ(1, table.oldest_send_time());
+    for (size_t i = 0; i < kNumResponders / 2; i += 2)
+      delete table.Remove(ids[i]);
+    EXPECT_EQ(static_cast<MojoTimeTicks>(kNumResponders / 2 + 1),
+              table.oldest_send_time());
+
+    // Reuse some of the freed slots.
+    for (size_t i = 0; i < kNumResponders / 2; i++)
+      table.Add(new CountingResponder(&num_alive), 5000);
+    EXPECT_EQ(kNumResponders * 3 / 4, table.size());
+    EXPECT_EQ(static_cast<MojoTimeTicks>(kNumResponders / 2 + 1),
+              table.oldest_send_time());
+    EXPECT_EQ(static_cast<int>(kNumResponders * 3 / 4), num_alive);
+  }
+  EXPECT_EQ(0, num_alive);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
@@ -298,6 +298,34 @@ TEST_F(RouterTest, LazyResponses) {
             std::string(reinterpret_cast<const char*>(response.payload())));
 }
 
+// Tests that the router keeps track of the requests awaiting responses.
+TEST_F(RouterTest, PendingResponses) {
+  internal::Router router0(handle0_.Pass(), internal::FilterChain());
+  internal::Router router1(handle1_.Pass(), internal::FilterChain());
+
+  LazyResponseGenerator generator;
+  router1.set_incoming_receiver(&generator);
+
+  EXPECT_EQ(0u, router0.num_pending_responses());
+  EXPECT_EQ(0, router0.GetOldestPendingResponseAge());
+
+  Message request;
+  AllocRequestMessage(1, "hello", &request);
+  MessageQueue message_queue;
+  router0.AcceptWithResponder(&request, new MessageAccumulator(&message_queue));
+  PumpMessages();
+
+  EXPECT_EQ(1u, router0.num_pending_responses());
+  EXPECT_GE(router0.GetOldestPendingResponseAge(), 0);
+
+  generator.CompleteWithResponse();
+  PumpMessages();
+
+  EXPECT_FALSE(message_queue.IsEmpty());
+  EXPECT_EQ(0u, router0.num_pending_responses());
+  EXPECT_EQ(0, router0.GetOldestPendingResponseAge());
+}
+
 // Tests that if the receiving application destroys the responder_ without
 // sending a response, then we close the Pipe as a way of signalling an
 // error condition to the caller.
@@ -0,0 +1,181 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string>
+#include <vector>
+
+#include "mojo/public/cpp/bindings/array.h"
+#include "mojo/public/cpp/bindings/lib/array_serialization.h"
+#include "mojo/public/cpp/bindings/lib/chunked_buffer.h"
+#include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
+#include "mojo/public/cpp/bindings/lib/map_serialization.h"
+#include "mojo/public/cpp/bindings/map.h"
+#include "mojo/public/cpp/bindings/string.h"
+#include "mojo/public/cpp/environment/environment.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/test_support/test_support.h"
+#include "mojo/public/interfaces/bindings/tests/test_structs.mojom.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace {
+
+const double kMojoTicksPerSecond = 1000000.0;
+
+double MojoTicksToSeconds(MojoTimeTicks ticks) {
+  return ticks / kMojoTicksPerSecond;
+}
+
+// The number of objects serialized by each measurement. (Serialization
+// consumes its input, so this many copies are made before timing starts.)
+const size_t kIterations = 10000;
+
+typedef mojo::internal::Array_Data<mojo::internal::String_Data*>
+    StringArray_Data;
+typedef mojo::internal::Map_Data<mojo::internal::String_Data*,
+                                 mojo::internal::String_Data*>
+    StringMap_Data;
+
+test::NamedRegionPtr MakeNamedRegion() {
+  test::NamedRegionPtr region(test::NamedRegion::New());
+  region->name = "a region with a fairly long name";
+  region->rects = Array<test::RectPtr>::New(16);
+  for (size_t i = 0; i < region->rects.size(); i++) {
+    region->rects[i] = test::Rect::New();
+    region->rects[i]->x = static_cast<int32_t>(i);
+    region->rects[i]->width = 100;
+  }
+  return region.Pass();
+}
+
+Array<String> MakeStringArray() {
+  Array<String> strings(64);
+  for (size_t i = 0; i < strings.size(); i++)
+    strings[i] = std::string(8 + i % 32, 'a' + i % 26);
+  return strings.Pass();
+}
+
+Map<String, String> MakeStringMap() {
+  Map<String, String> map;
+  for (size_t i = 0; i < 32; i++)
+    map.insert(std::string(8, 'a' + i % 26) + std::string(i, 'k'), "value");
+  return map.Pass();
+}
+
+void SerializeTo(test::NamedRegionPtr input,
+                 mojo::internal::Buffer* buf,
+                 test::internal::NamedRegion_Data** output) {
+  Serialize_(input.Pass(), buf, output);
+}
+
+void SerializeTo(Array<String> input,
+                 mojo::internal::Buffer* buf,
+                 StringArray_Data** output) {
+  const mojo::internal::ArrayValidateParams validate_params(
+      0, false, new mojo::internal::ArrayValidateParams(0, false, nullptr));
+  SerializeArray_(input.Pass(), buf, output, &validate_params);
+}
+
+void SerializeTo(Map<String, String> input,
+                 mojo::internal::Buffer* buf,
+                 StringMap_Data** output) {
+  const mojo::internal::ArrayValidateParams validate_params(
+      0, false, new mojo::internal::ArrayValidateParams(0, false, nullptr));
+  SerializeMap_(input.Pass(), buf, output, &validate_params);
+}
+
+// Serializes each of |inputs| by first computing its exact size and then
+// serializing into a |FixedBuffer| of that size (i.e., in two passes).
+template <typename T, typename DataType>
+void SerializeTwoPass(std::vector<T>* inputs) {
+  for (size_t i = 0; i < inputs->size(); i++) {
+    mojo::internal::FixedBuffer buf(GetSerializedSize_((*inputs)[i]));
+    DataType* data = nullptr;
+    SerializeTo((*inputs)[i].Pass(), &buf, &data);
+    free(buf.Leak());
+  }
+}
+
+// Serializes each of |inputs| in a single pass into a |ChunkedBuffer| whose
+// first chunk has room for |initial_size| bytes.
+template <typename T, typename DataType>
+void SerializeOnePass(std::vector<T>* inputs, size_t initial_size) {
+  for (size_t i = 0; i < inputs->size(); i++) {
+    mojo::internal::ChunkedBuffer buf(initial_size);
+    DataType* data = nullptr;
+    SerializeTo((*inputs)[i].Pass(), &buf, &data);
+    data = buf.Linearize(data);
+    free(buf.Leak());
+  }
+}
+
+template <typename T>
+void MakeInputs(const T& input, std::vector<T>* inputs) {
+  inputs->clear();
+  for (size_t i = 0; i < kIterations; i++)
+    inputs->push_back(input.Clone());
+}
+
+// Measures serializing copies of |input| in two passes, in one pass without a
+// size hint (so that the data typically spans several chunks), and in one
+// pass with an exact size hint (as a proxy would have after the first
+// message).
+template <typename T, typename DataType>
+void MeasureSerialization(const char* test_name, const T& input) {
+  std::vector<T> inputs;
+
+  MakeInputs(input, &inputs);
+  MojoTimeTicks start_time = MojoGetTimeTicksNow();
+  SerializeTwoPass<T, DataType>(&inputs);
+  MojoTimeTicks end_time = MojoGetTimeTicksNow();
+  test::LogPerfResult(test_name, "TwoPass",
+                      kIterations / MojoTicksToSeconds(end_time - start_time),
+                      "serializations/second");
+
+  MakeInputs(input, &inputs);
+  start_time = MojoGetTimeTicksNow();
+  SerializeOnePass<T, DataType>(&inputs, 0);
+  end_time = MojoGetTimeTicksNow();
+  test::LogPerfResult(test_name, "OnePass_NoHint",
+                      kIterations / MojoTicksToSeconds(end_time - start_time),
+                      "serializations/second");
+
+  const size_t size_hint = GetSerializedSize_(input);
+  MakeInputs(input, &inputs);
+  start_time = MojoGetTimeTicksNow();
+  SerializeOnePass<T, DataType>(&inputs, size_hint);
+  end_time = MojoGetTimeTicksNow();
+  test::LogPerfResult(test_name, "OnePass_Hint",
+                      kIterations / MojoTicksToSeconds(end_time - start_time),
+                      "serializations/second");
+}
+
+class MojoSerializationPerftest : public testing::Test {
+ public:
+  MojoSerializationPerftest() {}
+  ~MojoSerializationPerftest() override {}
+
+ private:
+  Environment env_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(MojoSerializationPerftest);
+};
+
+TEST_F(MojoSerializationPerftest, Struct) {
+  MeasureSerialization<test::NamedRegionPtr, test::internal::NamedRegion_Data>(
+      "SerializeStruct", MakeNamedRegion());
+}
+
+TEST_F(MojoSerializationPerftest, ArrayOfStrings) {
+  MeasureSerialization<Array<String>, StringArray_Data>(
+      "SerializeArrayOfStrings", MakeStringArray());
+}
+
+TEST_F(MojoSerializationPerftest, Map) {
+  MeasureSerialization<Map<String, String>, StringMap_Data>(
+      "SerializeMap", MakeStringMap());
+}
+
+}  // namespace
+}  // namespace mojo
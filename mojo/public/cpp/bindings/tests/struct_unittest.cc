@@ -4,6 +4,7 @@
 
 #include <string.h>
 
+#include "mojo/public/cpp/bindings/lib/chunked_buffer.h"
 #include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
 #include "mojo/public/cpp/environment/environment.h"
 #include "mojo/public/cpp/system/message_pipe.h"
@@ -242,6 +243,40 @@ TEST_F(StructTest, Serialization_NullArrayPointers) {
   EXPECT_TRUE(region2->rects.is_null());
 }
 
+// Serialization test of a struct that doesn't fit in the first chunk of a
+// ChunkedBuffer, so that the serialized data must be linearized.
+TEST_F(StructTest, Serialization_ChunkedBuffer) {
+  NamedRegionPtr region(NamedRegion::New());
+  region->name = "region";
+  region->rects = Array<RectPtr>::New(100);
+  for (size_t i = 0; i < region->rects.size(); ++i)
+    region->rects[i] = MakeRect(static_cast<int32_t>(i) + 1);
+  size_t size = GetSerializedSize_(region);
+
+  mojo::internal::ChunkedBuffer buf(0);
+  internal::NamedRegion_Data* data;
+  Serialize_(region.Pass(), &buf, &data);
+  EXPECT_EQ(size, buf.size());
+  EXPECT_FALSE(buf.is_contiguous());
+
+  data = buf.Linearize(data);
+  EXPECT_TRUE(buf.is_contiguous());
+  EXPECT_EQ(size, buf.size());
+
+  // (In debug builds, encoding checks that all the pointers point forward.)
+  std::vector<Handle> handles;
+  data->EncodePointersAndHandles(&handles);
+  data->DecodePointersAndHandles(&handles);
+
+  NamedRegionPtr region2;
+  Deserialize_(data, &region2);
+
+  EXPECT_EQ(String("region"), region2->name);
+  EXPECT_EQ(100U, region2->rects.size());
+  for (size_t i = 0; i < region2->rects.size(); ++i)
+    CheckRect(*region2->rects[i], static_cast<int32_t>(i) + 1);
+}
+
 // Tests deserializing structs as a newer version.
 TEST_F(StructTest, Versioning_OldToNew) {
   {
@@ -0,0 +1,286 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "mojo/public/cpp/bindings/array_view.h"
+#include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
+#include "mojo/public/cpp/bindings/string_view.h"
+#include "mojo/public/cpp/environment/environment.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/system/message_pipe.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+#include "mojo/public/interfaces/bindings/tests/test_structs.mojom.h"
+#include "mojo/public/interfaces/bindings/tests/test_views.mojom.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+RectPtr MakeRect(int32_t factor) {
+  RectPtr rect(Rect::New());
+  rect->x = 1 * factor;
+  rect->y = 2 * factor;
+  rect->width = 10 * factor;
+  rect->height = 20 * factor;
+  return rect.Pass();
+}
+
+void CheckRect(RectView rect, int32_t factor) {
+  ASSERT_FALSE(rect.is_null());
+  EXPECT_EQ(1 * factor, rect.x());
+  EXPECT_EQ(2 * factor, rect.y());
+  EXPECT_EQ(10 * factor, rect.width());
+  EXPECT_EQ(20 * factor, rect.height());
+}
+
+ViewedStructPtr MakeViewedStruct() {
+  ViewedStructPtr s(ViewedStruct::New());
+  s->f_bool = true;
+  s->f_int8 = -5;
+  s->f_uint64 = 1234567890123ULL;
+  s->f_double = 2.5;
+  s->f_shape = ViewedStruct::SHAPE_CIRCLE;
+  s->f_string = "hello";
+  s->f_rect = MakeRect(1);
+  s->f_bytes = Array<uint8_t>(3);
+  s->f_bytes[0] = 1;
+  s->f_bytes[1] = 2;
+  s->f_bytes[2] = 3;
+  s->f_bools = Array<bool>(10);
+  s->f_bools[9] = true;
+  s->f_strings = Array<String>(2);
+  s->f_strings[0] = "a";
+  s->f_strings[1] = "bc";
+  s->f_rects = Array<RectPtr>(2);
+  s->f_rects[1] = MakeRect(2);
+  s->f_nested = Array<Array<int32_t>>(2);
+  s->f_nested[0] = Array<int32_t>(0);
+  s->f_nested[1] = Array<int32_t>(1);
+  s->f_nested[1][0] = 42;
+  return s.Pass();
+}
+
+void CheckViewedStruct(ViewedStructView view) {
+  ASSERT_FALSE(view.is_null());
+  EXPECT_TRUE(view.f_bool());
+  EXPECT_EQ(-5, view.f_int8());
+  EXPECT_EQ(1234567890123ULL, view.f_uint64());
+  EXPECT_EQ(2.5, view.f_double());
+  EXPECT_EQ(ViewedStruct::SHAPE_CIRCLE, view.f_shape());
+
+  StringView string = view.f_string();
+  ASSERT_FALSE(string.is_null());
+  EXPECT_EQ(5u, string.size());
+  EXPECT_EQ(0, memcmp("hello", string.data(), 5u));
+  EXPECT_EQ("hello", string.ToString());
+  EXPECT_TRUE(view.f_nullable_string().is_null());
+
+  CheckRect(view.f_rect(), 1);
+  EXPECT_TRUE(view.f_nullable_rect().is_null());
+
+  ArrayView<uint8_t> bytes = view.f_bytes();
+  ASSERT_EQ(3u, bytes.size());
+  EXPECT_EQ(1u, bytes[0]);
+  EXPECT_EQ(2u, bytes[1]);
+  EXPECT_EQ(3u, bytes[2]);
+
+  ArrayView<bool> bools = view.f_bools();
+  ASSERT_EQ(10u, bools.size());
+  for (size_t i = 0; i < 9; i++)
+    EXPECT_FALSE(bools[i]);
+  EXPECT_TRUE(bools[9]);
+
+  ArrayView<StringView> strings = view.f_strings();
+  ASSERT_EQ(2u, strings.size());
+  EXPECT_EQ("a", strings[0].ToString());
+  EXPECT_EQ("bc", strings[1].ToString());
+
+  ArrayView<RectView> rects = view.f_rects();
+  ASSERT_EQ(2u, rects.size());
+  EXPECT_TRUE(rects[0].is_null());
+  CheckRect(rects[1], 2);
+
+  ArrayView<ArrayView<int32_t>> nested = view.f_nested();
+  ASSERT_EQ(2u, nested.size());
+  EXPECT_FALSE(nested[0].is_null());
+  EXPECT_EQ(0u, nested[0].size());
+  ASSERT_EQ(1u, nested[1].size());
+  EXPECT_EQ(42, nested[1][0]);
+}
+
+// Serializes |input| into |buf| and then encodes and decodes the pointers in
+// it (as would happen when sending it in a message), returning the result.
+template <typename T>
+typename mojo::internal::WrapperTraits<T>::DataType SerializeAndDecode(
+    T input,
+    mojo::internal::FixedBuffer* buf) {
+  typename mojo::internal::WrapperTraits<T>::DataType data;
+  Serialize_(input.Pass(), buf, &data);
+
+  std::vector<Handle> handles;
+  data->EncodePointersAndHandles(&handles);
+  data->DecodePointersAndHandles(&handles);
+  return data;
+}
+
+class ViewTest : public testing::Test {
+ public:
+  ViewTest() {}
+  ~ViewTest() override {}
+
+  RunLoop& loop() { return loop_; }
+
+ private:
+  Environment env_;
+  RunLoop loop_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ViewTest);
+};
+
+TEST_F(ViewTest, Null) {
+  ViewedStructView view;
+  EXPECT_TRUE(view.is_null());
+
+  StringView string;
+  EXPECT_TRUE(string.is_null());
+  EXPECT_EQ(0u, string.size());
+  EXPECT_EQ(std::string(), string.ToString());
+
+  ArrayView<int32_t> array;
+  EXPECT_TRUE(array.is_null());
+  EXPECT_EQ(0u, array.size());
+}
+
+TEST_F(ViewTest, Fields) {
+  ViewedStructPtr input(MakeViewedStruct());
+  mojo::internal::FixedBuffer buf(GetSerializedSize_(input));
+  CheckViewedStruct(ViewedStructView(SerializeAndDecode(input.Pass(), &buf)));
+}
+
+// Tests that fields that aren't present in data from an older version read as
+// their default values.
+TEST_F(ViewTest, Versioning) {
+  MultiVersionStructV1Ptr input(MultiVersionStructV1::New());
+  input->f_int32 = 123;
+  input->f_rect = MakeRect(5);
+
+  mojo::internal::FixedBuffer buf(GetSerializedSize_(input));
+  MultiVersionStructView view(
+      reinterpret_cast<internal::MultiVersionStruct_Data*>(
+          SerializeAndDecode(input.Pass(), &buf)));
+
+  EXPECT_EQ(123, view.f_int32());
+  CheckRect(view.f_rect(), 5);
+  EXPECT_TRUE(view.f_string().is_null());
+  EXPECT_TRUE(view.f_array().is_null());
+  EXPECT_FALSE(view.f_bool());
+  EXPECT_EQ(0, view.f_int16());
+}
+
+// An implementation that only implements the methods that take views.
+class ViewConsumerViewImpl : public ViewConsumer {
+ public:
+  ViewConsumerViewImpl() {}
+  ~ViewConsumerViewImpl() override {}
+
+  const std::string& last_string() const { return last_string_; }
+
+  // |ViewConsumer| implementation:
+  void Consume(ViewedStructPtr s,
+               int32_t tag,
+               const ConsumeCallback& callback) override {
+    ADD_FAILURE() << "Consume() shouldn't be called";
+  }
+  void ConsumeWithViews(ViewedStructView s,
+                        int32_t tag,
+                        const ConsumeCallback& callback) override {
+    EXPECT_EQ(7, tag);
+    CheckViewedStruct(s);
+    callback.Run(static_cast<uint32_t>(s.f_rects().size()));
+  }
+  void ConsumeString(const String& s) override {
+    ADD_FAILURE() << "ConsumeString() shouldn't be called";
+  }
+  void ConsumeStringWithViews(StringView s) override {
+    last_string_ = s.ToString();
+  }
+  void ConsumeHandle(ScopedMessagePipeHandle h) override {
+    EXPECT_TRUE(h.is_valid());
+  }
+
+ private:
+  std::string last_string_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ViewConsumerViewImpl);
+};
+
+// An implementation that relies on the default implementations of the methods
+// that take views.
+class ViewConsumerDeserializingImpl : public ViewConsumer {
+ public:
+  ViewConsumerDeserializingImpl() {}
+  ~ViewConsumerDeserializingImpl() override {}
+
+  const String& last_string() const { return last_string_; }
+
+  // |ViewConsumer| implementation:
+  void Consume(ViewedStructPtr s,
+               int32_t tag,
+               const ConsumeCallback& callback) override {
+    EXPECT_EQ(7, tag);
+    EXPECT_TRUE(s->Equals(*MakeViewedStruct()));
+    callback.Run(static_cast<uint32_t>(s->f_rects.size()));
+  }
+  void ConsumeString(const String& s) override { last_string_ = s; }
+  void ConsumeHandle(ScopedMessagePipeHandle h) override {
+    EXPECT_TRUE(h.is_valid());
+  }
+
+ private:
+  String last_string_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(ViewConsumerDeserializingImpl);
+};
+
+TEST_F(ViewTest, StubPassesViews) {
+  ViewConsumerViewImpl impl;
+  ViewConsumerPtr ptr;
+  Binding<ViewConsumer> binding(&impl, GetProxy(&ptr));
+
+  uint32_t num_rects = 0;
+  ptr->Consume(MakeViewedStruct(), 7,
+               [&num_rects](uint32_t n) { num_rects = n; });
+  ptr->ConsumeString("hi");
+  loop().RunUntilIdle();
+
+  EXPECT_EQ(2u, num_rects);
+  EXPECT_EQ("hi", impl.last_string());
+}
+
+TEST_F(ViewTest, DefaultWithViewsDeserializes) {
+  ViewConsumerDeserializingImpl impl;
+  ViewConsumerPtr ptr;
+  Binding<ViewConsumer> binding(&impl, GetProxy(&ptr));
+
+  uint32_t num_rects = 0;
+  ptr->Consume(MakeViewedStruct(), 7,
+               [&num_rects](uint32_t n) { num_rects = n; });
+  ptr->ConsumeString("hi");
+  MessagePipe pipe;
+  ptr->ConsumeHandle(pipe.handle0.Pass());
+  loop().RunUntilIdle();
+
+  EXPECT_EQ(2u, num_rects);
+  EXPECT_EQ("hi", impl.last_string());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
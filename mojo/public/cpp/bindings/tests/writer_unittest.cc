@@ -0,0 +1,182 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/bindings/struct_writer.h"
+#include "mojo/public/cpp/environment/environment.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/public/cpp/utility/run_loop.h"
+#include "mojo/public/interfaces/bindings/tests/test_writers.mojom.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace mojo {
+namespace test {
+namespace {
+
+RectPtr MakeRect(int32_t factor) {
+  RectPtr rect(Rect::New());
+  rect->x = 1 * factor;
+  rect->y = 2 * factor;
+  rect->width = 10 * factor;
+  rect->height = 20 * factor;
+  return rect.Pass();
+}
+
+internal::Rect_Data* WriteRect(int32_t factor,
+                               mojo::internal::Buffer* buf) {
+  internal::Rect_Data* rect = internal::Rect_Data::New(buf);
+  rect->x = 1 * factor;
+  rect->y = 2 * factor;
+  rect->width = 10 * factor;
+  rect->height = 20 * factor;
+  return rect;
+}
+
+// Writes the rects of |MakeRect()| for the given factors (with a factor of 0
+// meaning a null rect), without building a |Rect|.
+class RectWriter : public StructWriter<Rect> {
+ public:
+  explicit RectWriter(int32_t factor) : factor_(factor) {}
+  ~RectWriter() override {}
+
+  void Serialize(mojo::internal::Buffer* buf,
+                 internal::Rect_Data** output) const override {
+    *output = factor_ ? WriteRect(factor_, buf) : nullptr;
+  }
+
+ private:
+  const int32_t factor_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(RectWriter);
+};
+
+class RectPairWriter : public StructWriter<RectPair> {
+ public:
+  RectPairWriter(int32_t first_factor, int32_t second_factor)
+      : first_(first_factor), second_(second_factor) {}
+  ~RectPairWriter() override {}
+
+  void Serialize(mojo::internal::Buffer* buf,
+                 internal::RectPair_Data** output) const override {
+    internal::RectPair_Data* pair = internal::RectPair_Data::New(buf);
+    first_.Serialize(buf, &pair->first.ptr);
+    second_.Serialize(buf, &pair->second.ptr);
+    *output = pair;
+  }
+
+ private:
+  RectWriter first_;
+  RectWriter second_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(RectPairWriter);
+};
+
+class RectConsumerImpl : public RectConsumer {
+ public:
+  RectConsumerImpl() : last_tag_(0) {}
+  ~RectConsumerImpl() override {}
+
+  const RectPairPtr& last_pair() const { return last_pair_; }
+  const RectPtr& last_rect() const { return last_rect_; }
+  int32_t last_tag() const { return last_tag_; }
+
+  // |RectConsumer| implementation:
+  void ConsumePair(RectPairPtr pair,
+                   int32_t tag,
+                   const ConsumePairCallback& callback) override {
+    last_tag_ = tag;
+    callback.Run(pair->first->width * pair->first->height);
+    last_pair_ = pair.Pass();
+  }
+  void ConsumeRect(RectPtr rect) override { last_rect_ = rect.Pass(); }
+  void ConsumeTag(int32_t tag) override { last_tag_ = tag; }
+
+ private:
+  RectPairPtr last_pair_;
+  RectPtr last_rect_;
+  int32_t last_tag_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(RectConsumerImpl);
+};
+
+class WriterTest : public testing::Test {
+ public:
+  WriterTest() {}
+  ~WriterTest() override {}
+
+  RunLoop& loop() { return loop_; }
+
+ private:
+  Environment env_;
+  RunLoop loop_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(WriterTest);
+};
+
+TEST_F(WriterTest, ProxyTakesWriters) {
+  RectConsumerImpl impl;
+  RectConsumerPtr ptr;
+  Binding<RectConsumer> binding(&impl, GetProxy(&ptr));
+
+  int32_t area = 0;
+  ptr->ConsumePairWithWriters(RectPairWriter(3, 0), 7,
+                              [&area](int32_t a) { area = a; });
+  loop().RunUntilIdle();
+
+  EXPECT_EQ(30 * 60, area);
+  EXPECT_EQ(7, impl.last_tag());
+  ASSERT_TRUE(impl.last_pair());
+  EXPECT_TRUE(impl.last_pair()->first.Equals(MakeRect(3)));
+  EXPECT_TRUE(impl.last_pair()->second.is_null());
+
+  ptr->ConsumeRectWithWriters(RectWriter(2));
+  loop().RunUntilIdle();
+  EXPECT_TRUE(impl.last_rect().Equals(MakeRect(2)));
+
+  ptr->ConsumeRectWithWriters(RectWriter(0));
+  loop().RunUntilIdle();
+  EXPECT_TRUE(impl.last_rect().is_null());
+}
+
+// Tests that writing a struct gives the same message as serializing it, by
+// mixing the two (messages of the same kind share a size hint).
+TEST_F(WriterTest, SameAsSerializing) {
+  RectConsumerImpl impl;
+  RectConsumerPtr ptr;
+  Binding<RectConsumer> binding(&impl, GetProxy(&ptr));
+
+  RectPairPtr pair(RectPair::New());
+  pair->first = MakeRect(1);
+  pair->second = MakeRect(4);
+  ptr->ConsumePair(pair.Clone(), 1, [](int32_t a) {});
+  loop().RunUntilIdle();
+  EXPECT_TRUE(impl.last_pair().Equals(pair));
+
+  ptr->ConsumePairWithWriters(RectPairWriter(1, 4), 2, [](int32_t a) {});
+  loop().RunUntilIdle();
+  EXPECT_EQ(2, impl.last_tag());
+  EXPECT_TRUE(impl.last_pair().Equals(pair));
+}
+
+// Methods called directly on the implementation (not through the proxy)
+// deserialize what the writers write.
+TEST_F(WriterTest, DefaultWithWritersDeserializes) {
+  RectConsumerImpl impl;
+
+  int32_t area = 0;
+  impl.ConsumePairWithWriters(RectPairWriter(2, 5), 9,
+                              [&area](int32_t a) { area = a; });
+  EXPECT_EQ(20 * 40, area);
+  EXPECT_EQ(9, impl.last_tag());
+  ASSERT_TRUE(impl.last_pair());
+  EXPECT_TRUE(impl.last_pair()->first.Equals(MakeRect(2)));
+  EXPECT_TRUE(impl.last_pair()->second.Equals(MakeRect(5)));
+
+  impl.ConsumeRectWithWriters(RectWriter(0));
+  EXPECT_TRUE(impl.last_rect().is_null());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace mojo
@@ -489,6 +489,43 @@ TEST(CoreCppTest, ScopedHandleMoveCtorSelf) {
   EXPECT_TRUE(buffer1.is_valid());
 }
 
+TEST(CoreCppTest, WaitSet) {
+  ScopedWaitSetHandle wait_set;
+  EXPECT_EQ(MOJO_RESULT_OK, CreateWaitSet(nullptr, &wait_set));
+  EXPECT_TRUE(wait_set.is_valid());
+
+  ScopedMessagePipeHandle h0;
+  ScopedMessagePipeHandle h1;
+  EXPECT_EQ(MOJO_RESULT_OK, CreateMessagePipe(nullptr, &h0, &h1));
+
+  EXPECT_EQ(MOJO_RESULT_OK, WaitSetAdd(wait_set.get(), h0.get(),
+                                       MOJO_HANDLE_SIGNAL_READABLE, 1));
+  EXPECT_EQ(MOJO_RESULT_ALREADY_EXISTS,
+            WaitSetAdd(wait_set.get(), h1.get(), MOJO_HANDLE_SIGNAL_READABLE,
+                       1));
+
+  MojoWaitSetResult results[1];
+  uint32_t num_results = 1;
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            WaitSetWait(wait_set.get(), 0, &num_results, results));
+
+  EXPECT_EQ(MOJO_RESULT_OK,
+            WriteMessageRaw(h1.get(), "x", 1, nullptr, 0,
+                            MOJO_WRITE_MESSAGE_FLAG_NONE));
+  num_results = 1;
+  EXPECT_EQ(MOJO_RESULT_OK, WaitSetWait(wait_set.get(),
+                                        MOJO_DEADLINE_INDEFINITE, &num_results,
+                                        results));
+  EXPECT_EQ(1u, num_results);
+  EXPECT_EQ(1u, results[0].cookie);
+  EXPECT_EQ(MOJO_RESULT_OK, results[0].wait_result);
+
+  EXPECT_EQ(MOJO_RESULT_OK, WaitSetRemove(wait_set.get(), 1));
+  num_results = 1;
+  EXPECT_EQ(MOJO_RESULT_DEADLINE_EXCEEDED,
+            WaitSetWait(wait_set.get(), 0, &num_results, results));
+}
+
 // TODO(vtl): Write data pipe tests.
 
 }  // namespace
@@ -0,0 +1,75 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// This file provides a C++ wrapping around the Mojo C API for wait sets,
+// replacing the prefix of "Mojo" with a "mojo" namespace, and using more
+// strongly-typed representations of |MojoHandle|s.
+//
+// Please see "mojo/public/c/system/wait_set.h" for complete documentation of
+// the API.
+
+#ifndef MOJO_PUBLIC_CPP_SYSTEM_WAIT_SET_H_
+#define MOJO_PUBLIC_CPP_SYSTEM_WAIT_SET_H_
+
+#include <assert.h>
+
+#include "mojo/public/c/system/wait_set.h"
+#include "mojo/public/cpp/system/handle.h"
+
+namespace mojo {
+
+// A strongly-typed representation of a |MojoHandle| to a wait set.
+class WaitSetHandle : public Handle {
+ public:
+  WaitSetHandle() {}
+  explicit WaitSetHandle(MojoHandle value) : Handle(value) {}
+
+  // Copying and assignment allowed.
+};
+
+static_assert(sizeof(WaitSetHandle) == sizeof(Handle),
+              "Bad size for C++ WaitSetHandle");
+
+typedef ScopedHandleBase<WaitSetHandle> ScopedWaitSetHandle;
+static_assert(sizeof(ScopedWaitSetHandle) == sizeof(WaitSetHandle),
+              "Bad size for C++ ScopedWaitSetHandle");
+
+// Creates a wait set. See |MojoCreateWaitSet()| for complete documentation.
+inline MojoResult CreateWaitSet(const MojoCreateWaitSetOptions* options,
+                                ScopedWaitSetHandle* wait_set) {
+  assert(wait_set);
+  WaitSetHandle handle;
+  MojoResult rv = MojoCreateWaitSet(options, handle.mutable_value());
+  // Reset even on failure (reduces the chances that a "stale"/incorrect handle
+  // will be used).
+  wait_set->reset(handle);
+  return rv;
+}
+
+// Adds an entry to a wait set. See |MojoWaitSetAdd()| for complete
+// documentation.
+inline MojoResult WaitSetAdd(WaitSetHandle wait_set,
+                             Handle handle,
+                             MojoHandleSignals signals,
+                             uint64_t cookie) {
+  return MojoWaitSetAdd(wait_set.value(), handle.value(), signals, cookie);
+}
+
+// Removes an entry from a wait set. See |MojoWaitSetRemove()| for complete
+// documentation.
+inline MojoResult WaitSetRemove(WaitSetHandle wait_set, uint64_t cookie) {
+  return MojoWaitSetRemove(wait_set.value(), cookie);
+}
+
+// Waits on a wait set. See |MojoWaitSetWait()| for complete documentation.
+inline MojoResult WaitSetWait(WaitSetHandle wait_set,
+                              MojoDeadline deadline,
+                              uint32_t* num_results,
+                              MojoWaitSetResult* results) {
+  return MojoWaitSetWait(wait_set.value(), deadline, num_results, results);
+}
+
+}  // namespace mojo
+
+#endif  // MOJO_PUBLIC_CPP_SYSTEM_WAIT_SET_H_
@@ -225,3 +225,39 @@ MojoResult _MojoGetInitialHandle(MojoHandle* handle) {
   return irt_mojo->_MojoGetInitialHandle(handle);
 }
 
+MojoResult MojoCreateWaitSet(const struct MojoCreateWaitSetOptions* options,
+                             MojoHandle* wait_set_handle) {
+  struct nacl_irt_mojo* irt_mojo = get_irt_mojo();
+  if (irt_mojo == NULL)
+    return MOJO_RESULT_INTERNAL;
+  return irt_mojo->MojoCreateWaitSet(options, wait_set_handle);
+}
+
+MojoResult MojoWaitSetAdd(MojoHandle wait_set_handle,
+                          MojoHandle handle,
+                          MojoHandleSignals signals,
+                          uint64_t cookie) {
+  struct nacl_irt_mojo* irt_mojo = get_irt_mojo();
+  if (irt_mojo == NULL)
+    return MOJO_RESULT_INTERNAL;
+  return irt_mojo->MojoWaitSetAdd(wait_set_handle, handle, signals, cookie);
+}
+
+MojoResult MojoWaitSetRemove(MojoHandle wait_set_handle, uint64_t cookie) {
+  struct nacl_irt_mojo* irt_mojo = get_irt_mojo();
+  if (irt_mojo == NULL)
+    return MOJO_RESULT_INTERNAL;
+  return irt_mojo->MojoWaitSetRemove(wait_set_handle, cookie);
+}
+
+MojoResult MojoWaitSetWait(MojoHandle wait_set_handle,
+                           MojoDeadline deadline,
+                           uint32_t* num_results,
+                           struct MojoWaitSetResult* results) {
+  struct nacl_irt_mojo* irt_mojo = get_irt_mojo();
+  if (irt_mojo == NULL)
+    return MOJO_RESULT_INTERNAL;
+  return irt_mojo->MojoWaitSetWait(wait_set_handle, deadline, num_results,
+                                   results);
+}
+
@@ -12,6 +12,7 @@
 #include "mojo/public/c/system/data_pipe.h"
 #include "mojo/public/c/system/message_pipe.h"
 #include "mojo/public/c/system/types.h"
+#include "mojo/public/c/system/wait_set.h"
 
 #define NACL_IRT_MOJO_v0_1 "nacl-irt-mojo-0.1"
 
@@ -83,6 +84,18 @@ struct nacl_irt_mojo {
                                 uint32_t* num_handles,
                                 MojoReadMessageFlags flags);
   MojoResult (*_MojoGetInitialHandle)(MojoHandle* handle);
+  MojoResult (*MojoCreateWaitSet)(
+      const struct MojoCreateWaitSetOptions* options,
+      MojoHandle* wait_set_handle);
+  MojoResult (*MojoWaitSetAdd)(MojoHandle wait_set_handle,
+                               MojoHandle handle,
+                               MojoHandleSignals signals,
+                               uint64_t cookie);
+  MojoResult (*MojoWaitSetRemove)(MojoHandle wait_set_handle, uint64_t cookie);
+  MojoResult (*MojoWaitSetWait)(MojoHandle wait_set_handle,
+                                MojoDeadline deadline,
+                                uint32_t* num_results,
+                                struct MojoWaitSetResult* results);
 };
 
 #ifdef __cplusplus
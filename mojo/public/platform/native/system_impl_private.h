@@ -137,6 +137,26 @@ MOJO_SYSTEM_EXPORT MojoResult MojoSystemImplMapBuffer(MojoSystemImpl system,
                                                       MojoMapBufferFlags flags);
 MOJO_SYSTEM_EXPORT MojoResult
 MojoSystemImplUnmapBuffer(MojoSystemImpl system, void* buffer);
+MOJO_SYSTEM_EXPORT MojoResult MojoSystemImplCreateWaitSet(
+    MojoSystemImpl system,
+    const struct MojoCreateWaitSetOptions* options,
+    MojoHandle* wait_set_handle);
+MOJO_SYSTEM_EXPORT MojoResult
+MojoSystemImplWaitSetAdd(MojoSystemImpl system,
+                         MojoHandle wait_set_handle,
+                         MojoHandle handle,
+                         MojoHandleSignals signals,
+                         uint64_t cookie);
+MOJO_SYSTEM_EXPORT MojoResult
+MojoSystemImplWaitSetRemove(MojoSystemImpl system,
+                            MojoHandle wait_set_handle,
+                            uint64_t cookie);
+MOJO_SYSTEM_EXPORT MojoResult
+MojoSystemImplWaitSetWait(MojoSystemImpl system,
+                          MojoHandle wait_set_handle,
+                          MojoDeadline deadline,
+                          uint32_t* num_results,
+                          struct MojoWaitSetResult* results);
 }  // extern "C"
 
 #endif  // MOJO_PUBLIC_PLATFORM_NATIVE_SYSTEM_IMPL_PRIVATE_H_
@@ -203,6 +203,41 @@ MojoResult MojoSystemImplUnmapBuffer(MojoSystemImpl system, void* buffer) {
   return g_system_impl_thunks.UnmapBuffer(system, buffer);
 }
 
+MojoResult MojoSystemImplCreateWaitSet(
+    MojoSystemImpl system,
+    const struct MojoCreateWaitSetOptions* options,
+    MojoHandle* wait_set_handle) {
+  assert(g_system_impl_thunks.CreateWaitSet);
+  return g_system_impl_thunks.CreateWaitSet(system, options, wait_set_handle);
+}
+
+MojoResult MojoSystemImplWaitSetAdd(MojoSystemImpl system,
+                                    MojoHandle wait_set_handle,
+                                    MojoHandle handle,
+                                    MojoHandleSignals signals,
+                                    uint64_t cookie) {
+  assert(g_system_impl_thunks.WaitSetAdd);
+  return g_system_impl_thunks.WaitSetAdd(system, wait_set_handle, handle,
+                                         signals, cookie);
+}
+
+MojoResult MojoSystemImplWaitSetRemove(MojoSystemImpl system,
+                                       MojoHandle wait_set_handle,
+                                       uint64_t cookie) {
+  assert(g_system_impl_thunks.WaitSetRemove);
+  return g_system_impl_thunks.WaitSetRemove(system, wait_set_handle, cookie);
+}
+
+MojoResult MojoSystemImplWaitSetWait(MojoSystemImpl system,
+                                     MojoHandle wait_set_handle,
+                                     MojoDeadline deadline,
+                                     uint32_t* num_results,
+                                     struct MojoWaitSetResult* results) {
+  assert(g_system_impl_thunks.WaitSetWait);
+  return g_system_impl_thunks.WaitSetWait(system, wait_set_handle, deadline,
+                                          num_results, results);
+}
+
 extern "C" THUNK_EXPORT size_t MojoSetSystemImplControlThunksPrivate(
     const MojoSystemImplControlThunksPrivate* system_thunks) {
   if (system_thunks->size >= sizeof(g_system_impl_control_thunks))
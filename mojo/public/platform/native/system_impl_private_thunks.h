@@ -107,6 +107,22 @@ struct MojoSystemImplThunksPrivate {
                           void** buffer,
                           MojoMapBufferFlags flags);
   MojoResult (*UnmapBuffer)(MojoSystemImpl system, void* buffer);
+  MojoResult (*CreateWaitSet)(MojoSystemImpl system,
+                              const struct MojoCreateWaitSetOptions* options,
+                              MojoHandle* wait_set_handle);
+  MojoResult (*WaitSetAdd)(MojoSystemImpl system,
+                           MojoHandle wait_set_handle,
+                           MojoHandle handle,
+                           MojoHandleSignals signals,
+                           uint64_t cookie);
+  MojoResult (*WaitSetRemove)(MojoSystemImpl system,
+                              MojoHandle wait_set_handle,
+                              uint64_t cookie);
+  MojoResult (*WaitSetWait)(MojoSystemImpl system,
+                            MojoHandle wait_set_handle,
+                            MojoDeadline deadline,
+                            uint32_t* num_results,
+                            struct MojoWaitSetResult* results);
 };
 #pragma pack(pop)
 
@@ -141,7 +157,11 @@ inline MojoSystemImplThunksPrivate MojoMakeSystemImplThunksPrivate() {
       MojoSystemImplCreateSharedBuffer,
       MojoSystemImplDuplicateBufferHandle,
       MojoSystemImplMapBuffer,
-      MojoSystemImplUnmapBuffer};
+      MojoSystemImplUnmapBuffer,
+      MojoSystemImplCreateWaitSet,
+      MojoSystemImplWaitSetAdd,
+      MojoSystemImplWaitSetRemove,
+      MojoSystemImplWaitSetWait};
   return system_thunks;
 }
 
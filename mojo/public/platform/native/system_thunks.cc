@@ -5,6 +5,8 @@
 #include "mojo/public/platform/native/system_thunks.h"
 
 #include <assert.h>
+#include <stddef.h>
+#include <string.h>
 
 #include "mojo/public/platform/native/thunk_export.h"
 
@@ -158,10 +160,47 @@ MojoResult MojoUnmapBuffer(void* buffer) {
   return g_thunks.UnmapBuffer(buffer);
 }
 
+MojoResult MojoCreateWaitSet(const struct MojoCreateWaitSetOptions* options,
+                             MojoHandle* wait_set_handle) {
+  // Older embedders don't provide wait sets.
+  if (!g_thunks.CreateWaitSet)
+    return MOJO_RESULT_UNIMPLEMENTED;
+  return g_thunks.CreateWaitSet(options, wait_set_handle);
+}
+
+MojoResult MojoWaitSetAdd(MojoHandle wait_set_handle,
+                          MojoHandle handle,
+                          MojoHandleSignals signals,
+                          uint64_t cookie) {
+  if (!g_thunks.WaitSetAdd)
+    return MOJO_RESULT_UNIMPLEMENTED;
+  return g_thunks.WaitSetAdd(wait_set_handle, handle, signals, cookie);
+}
+
+MojoResult MojoWaitSetRemove(MojoHandle wait_set_handle, uint64_t cookie) {
+  if (!g_thunks.WaitSetRemove)
+    return MOJO_RESULT_UNIMPLEMENTED;
+  return g_thunks.WaitSetRemove(wait_set_handle, cookie);
+}
+
+MojoResult MojoWaitSetWait(MojoHandle wait_set_handle,
+                           MojoDeadline deadline,
+                           uint32_t* num_results,
+                           struct MojoWaitSetResult* results) {
+  if (!g_thunks.WaitSetWait)
+    return MOJO_RESULT_UNIMPLEMENTED;
+  return g_thunks.WaitSetWait(wait_set_handle, deadline, num_results, results);
+}
+
 extern "C" THUNK_EXPORT size_t MojoSetSystemThunks(
     const MojoSystemThunks* system_thunks) {
-  if (system_thunks->size >= sizeof(g_thunks))
+  if (system_thunks->size >= sizeof(g_thunks)) {
     g_thunks = *system_thunks;
+  } else if (system_thunks->size >= offsetof(MojoSystemThunks, CreateWaitSet)) {
+    // An older embedder, whose thunks predate wait sets: take the functions it
+    // has, and leave the rest null (see |MojoCreateWaitSet()|).
+    memcpy(&g_thunks, system_thunks, system_thunks->size);
+  }
   return sizeof(g_thunks);
 }
 
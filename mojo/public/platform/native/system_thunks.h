@@ -101,6 +101,17 @@ struct MojoSystemThunks {
                           void** buffer,
                           MojoMapBufferFlags flags);
   MojoResult (*UnmapBuffer)(void* buffer);
+  MojoResult (*CreateWaitSet)(const struct MojoCreateWaitSetOptions* options,
+                              MojoHandle* wait_set_handle);
+  MojoResult (*WaitSetAdd)(MojoHandle wait_set_handle,
+                           MojoHandle handle,
+                           MojoHandleSignals signals,
+                           uint64_t cookie);
+  MojoResult (*WaitSetRemove)(MojoHandle wait_set_handle, uint64_t cookie);
+  MojoResult (*WaitSetWait)(MojoHandle wait_set_handle,
+                            MojoDeadline deadline,
+                            uint32_t* num_results,
+                            struct MojoWaitSetResult* results);
 };
 #pragma pack(pop)
 
@@ -127,7 +138,11 @@ inline MojoSystemThunks MojoMakeSystemThunks() {
                                     MojoCreateSharedBuffer,
                                     MojoDuplicateBufferHandle,
                                     MojoMapBuffer,
-                                    MojoUnmapBuffer};
+                                    MojoUnmapBuffer,
+                                    MojoCreateWaitSet,
+                                    MojoWaitSetAdd,
+                                    MojoWaitSetRemove,
+                                    MojoWaitSetWait};
   return system_thunks;
 }
 #endif
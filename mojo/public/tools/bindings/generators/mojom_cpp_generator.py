@@ -206,6 +206,68 @@ def GetCppConstWrapperType(kind):
     print "missing:", kind.spec
   return _kind_to_cpp_type[kind]
 
+def GetCppViewType(kind):
+  """Returns the type that a struct view returns for a field of the given kind,
+  or None if views don't expose fields of that kind."""
+  if mojom.IsStructKind(kind):
+    return "%sView" % GetNameForKind(kind)
+  if mojom.IsStringKind(kind):
+    return "mojo::StringView"
+  if mojom.IsArrayKind(kind):
+    # Arrays of enums are stored as arrays of int32s, so there's no view type
+    # for them.
+    if mojom.IsEnumKind(kind.kind):
+      return None
+    element_type = GetCppViewType(kind.kind)
+    if element_type is None:
+      return None
+    return "mojo::ArrayView<%s>" % element_type
+  if mojom.IsEnumKind(kind):
+    return GetNameForKind(kind)
+  if mojom.IsAnyHandleKind(kind) or not kind in _kind_to_cpp_type:
+    return None
+  return _kind_to_cpp_type[kind]
+
+def IsViewableKind(kind):
+  return GetCppViewType(kind) is not None
+
+def IsViewParamKind(kind):
+  """Returns true if a stub that uses views passes a parameter of the given kind
+  as a view (instead of deserializing it). Kinds that (transitively) contain
+  handles never are, since the handles would otherwise not be owned by
+  anyone."""
+  return ((mojom.IsStructKind(kind) or mojom.IsStringKind(kind) or
+           mojom.IsArrayKind(kind)) and
+          IsViewableKind(kind) and mojom.IsCloneableKind(kind))
+
+def MethodUsesViews(method):
+  """Returns true if the stub for |method| should pass views to the
+  implementation, which is the case if its interface has the attribute
+  CppStubMode="views" (and it has any parameters that can be views)."""
+  attributes = method.interface.attributes
+  if not attributes or attributes.get("CppStubMode") != "views":
+    return False
+  return any(IsViewParamKind(param.kind) for param in method.parameters)
+
+def GetCppWriterType(kind):
+  return "mojo::StructWriter<%s>" % GetNameForKind(kind)
+
+def IsWriterParamKind(kind):
+  """Returns true if a proxy that takes writers takes a parameter of the given
+  kind as a writer. Only structs without handles are, since writers can't
+  transfer handles."""
+  return mojom.IsStructKind(kind) and mojom.IsCloneableKind(kind)
+
+def MethodUsesWriters(method):
+  """Returns true if the proxy for |method| should have a variant of it that
+  takes writers for the struct parameters, which is the case if its interface
+  has the attribute CppProxyMode="writers" (and it has any parameters that can
+  be writers)."""
+  attributes = method.interface.attributes
+  if not attributes or attributes.get("CppProxyMode") != "writers":
+    return False
+  return any(IsWriterParamKind(param.kind) for param in method.parameters)
+
 def GetCppFieldType(kind):
   if mojom.IsStructKind(kind):
     return ("mojo::internal::StructPointer<%s_Data>" %
@@ -351,7 +413,9 @@ class Generator(generator.Generator):
     "cpp_result_type": GetCppResultWrapperType,
     "cpp_type": GetCppType,
     "cpp_union_getter_return_type": GetUnionGetterReturnType,
+    "cpp_view_type": GetCppViewType,
     "cpp_wrapper_type": GetCppWrapperType,
+    "cpp_writer_type": GetCppWriterType,
     "default_value": DefaultValue,
     "expression_to_text": ExpressionToText,
     "get_array_validate_params_ctor_args": GetArrayValidateParamsCtorArgs,
@@ -375,10 +439,15 @@ class Generator(generator.Generator):
     "is_string_kind": mojom.IsStringKind,
     "is_struct_kind": mojom.IsStructKind,
     "is_union_kind": mojom.IsUnionKind,
+    "is_view_param_kind": IsViewParamKind,
+    "is_viewable_kind": IsViewableKind,
+    "is_writer_param_kind": IsWriterParamKind,
     "struct_size": lambda ps: ps.GetTotalSize() + _HEADER_SIZE,
     "stylize_method": generator.StudlyCapsToCamel,
     "to_all_caps": generator.CamelCaseToAllCaps,
     "under_to_camel": generator.UnderToCamel,
+    "uses_views": MethodUsesViews,
+    "uses_writers": MethodUsesWriters,
   }
 
   def GetJinjaExports(self):
@@ -320,6 +320,66 @@ static MojoResult irt__MojoGetInitialHandle(MojoHandle* handle) {
   return result;
 };
 
+static MojoResult irt_MojoCreateWaitSet(
+    const struct MojoCreateWaitSetOptions* options,
+    MojoHandle* wait_set_handle) {
+  uint32_t params[4];
+  MojoResult result = MOJO_RESULT_INVALID_ARGUMENT;
+  params[0] = 19;
+  params[1] = (uint32_t)(options);
+  params[2] = (uint32_t)(wait_set_handle);
+  params[3] = (uint32_t)(&result);
+  DoMojoCall(params, sizeof(params));
+  return result;
+};
+
+static MojoResult irt_MojoWaitSetAdd(
+    MojoHandle wait_set_handle,
+    MojoHandle handle,
+    MojoHandleSignals signals,
+    uint64_t cookie) {
+  uint32_t params[6];
+  MojoResult result = MOJO_RESULT_INVALID_ARGUMENT;
+  params[0] = 20;
+  params[1] = (uint32_t)(&wait_set_handle);
+  params[2] = (uint32_t)(&handle);
+  params[3] = (uint32_t)(&signals);
+  params[4] = (uint32_t)(&cookie);
+  params[5] = (uint32_t)(&result);
+  DoMojoCall(params, sizeof(params));
+  return result;
+};
+
+static MojoResult irt_MojoWaitSetRemove(
+    MojoHandle wait_set_handle,
+    uint64_t cookie) {
+  uint32_t params[4];
+  MojoResult result = MOJO_RESULT_INVALID_ARGUMENT;
+  params[0] = 21;
+  params[1] = (uint32_t)(&wait_set_handle);
+  params[2] = (uint32_t)(&cookie);
+  params[3] = (uint32_t)(&result);
+  DoMojoCall(params, sizeof(params));
+  return result;
+};
+
+static MojoResult irt_MojoWaitSetWait(
+    MojoHandle wait_set_handle,
+    MojoDeadline deadline,
+    uint32_t* num_results,
+    struct MojoWaitSetResult* results) {
+  uint32_t params[6];
+  MojoResult result = MOJO_RESULT_INVALID_ARGUMENT;
+  params[0] = 22;
+  params[1] = (uint32_t)(&wait_set_handle);
+  params[2] = (uint32_t)(&deadline);
+  params[3] = (uint32_t)(num_results);
+  params[4] = (uint32_t)(results);
+  params[5] = (uint32_t)(&result);
+  DoMojoCall(params, sizeof(params));
+  return result;
+};
+
 struct nacl_irt_mojo kIrtMojo = {
   &irt_MojoCreateSharedBuffer,
   &irt_MojoDuplicateBufferHandle,
@@ -340,6 +400,10 @@ struct nacl_irt_mojo kIrtMojo = {
   &irt_MojoWriteMessage,
   &irt_MojoReadMessage,
   &irt__MojoGetInitialHandle,
+  &irt_MojoCreateWaitSet,
+  &irt_MojoWaitSetAdd,
+  &irt_MojoWaitSetRemove,
+  &irt_MojoWaitSetWait,
 };
 
 
@@ -665,6 +665,155 @@ ssize_t MojoDescSendMsg(void* handle,
         *result_ptr = result_value;
       }
 
+      return 0;
+    }
+    case 19: {
+      if (num_params != 4) {
+        return -1;
+      }
+      const struct MojoCreateWaitSetOptions* options;
+      MojoHandle volatile* wait_set_handle_ptr;
+      MojoHandle wait_set_handle_value;
+      MojoResult volatile* result_ptr;
+      MojoResult result_value;
+      {
+        ScopedCopyLock copy_lock(nap);
+        if (!ConvertExtensibleStructInput(nap, params[1], true, &options)) {
+          return -1;
+        }
+        if (!ConvertScalarInOut(nap, params[2], false, &wait_set_handle_value,
+                                &wait_set_handle_ptr)) {
+          return -1;
+        }
+        if (!ConvertScalarOutput(nap, params[3], false, &result_ptr)) {
+          return -1;
+        }
+      }
+
+      result_value = MojoSystemImplCreateWaitSet(g_mojo_system, options,
+                                                 &wait_set_handle_value);
+
+      {
+        ScopedCopyLock copy_lock(nap);
+        *wait_set_handle_ptr = wait_set_handle_value;
+        *result_ptr = result_value;
+      }
+
+      return 0;
+    }
+    case 20: {
+      if (num_params != 6) {
+        return -1;
+      }
+      MojoHandle wait_set_handle_value;
+      MojoHandle handle_value;
+      MojoHandleSignals signals_value;
+      uint64_t cookie_value;
+      MojoResult volatile* result_ptr;
+      MojoResult result_value;
+      {
+        ScopedCopyLock copy_lock(nap);
+        if (!ConvertScalarInput(nap, params[1], &wait_set_handle_value)) {
+          return -1;
+        }
+        if (!ConvertScalarInput(nap, params[2], &handle_value)) {
+          return -1;
+        }
+        if (!ConvertScalarInput(nap, params[3], &signals_value)) {
+          return -1;
+        }
+        if (!ConvertScalarInput(nap, params[4], &cookie_value)) {
+          return -1;
+        }
+        if (!ConvertScalarOutput(nap, params[5], false, &result_ptr)) {
+          return -1;
+        }
+      }
+
+      result_value =
+          MojoSystemImplWaitSetAdd(g_mojo_system, wait_set_handle_value,
+                                   handle_value, signals_value, cookie_value);
+
+      {
+        ScopedCopyLock copy_lock(nap);
+        *result_ptr = result_value;
+      }
+
+      return 0;
+    }
+    case 21: {
+      if (num_params != 4) {
+        return -1;
+      }
+      MojoHandle wait_set_handle_value;
+      uint64_t cookie_value;
+      MojoResult volatile* result_ptr;
+      MojoResult result_value;
+      {
+        ScopedCopyLock copy_lock(nap);
+        if (!ConvertScalarInput(nap, params[1], &wait_set_handle_value)) {
+          return -1;
+        }
+        if (!ConvertScalarInput(nap, params[2], &cookie_value)) {
+          return -1;
+        }
+        if (!ConvertScalarOutput(nap, params[3], false, &result_ptr)) {
+          return -1;
+        }
+      }
+
+      result_value = MojoSystemImplWaitSetRemove(
+          g_mojo_system, wait_set_handle_value, cookie_value);
+
+      {
+        ScopedCopyLock copy_lock(nap);
+        *result_ptr = result_value;
+      }
+
+      return 0;
+    }
+    case 22: {
+      if (num_params != 6) {
+        return -1;
+      }
+      MojoHandle wait_set_handle_value;
+      MojoDeadline deadline_value;
+      uint32_t volatile* num_results_ptr;
+      uint32_t num_results_value;
+      struct MojoWaitSetResult* results;
+      MojoResult volatile* result_ptr;
+      MojoResult result_value;
+      {
+        ScopedCopyLock copy_lock(nap);
+        if (!ConvertScalarInput(nap, params[1], &wait_set_handle_value)) {
+          return -1;
+        }
+        if (!ConvertScalarInput(nap, params[2], &deadline_value)) {
+          return -1;
+        }
+        if (!ConvertScalarInOut(nap, params[3], false, &num_results_value,
+                                &num_results_ptr)) {
+          return -1;
+        }
+        if (!ConvertScalarOutput(nap, params[5], false, &result_ptr)) {
+          return -1;
+        }
+        if (!ConvertArray(nap, params[4], num_results_value, sizeof(*results),
+                          true, &results)) {
+          return -1;
+        }
+      }
+
+      result_value = MojoSystemImplWaitSetWait(
+          g_mojo_system, wait_set_handle_value, deadline_value,
+          &num_results_value, results);
+
+      {
+        ScopedCopyLock copy_lock(nap);
+        *num_results_ptr = num_results_value;
+        *result_ptr = result_value;
+      }
+
       return 0;
     }
   }
@@ -129,6 +129,30 @@ def MakeInterface():
   f = mojo.Func('_MojoGetInitialHandle', 'MojoResult')
   f.Param('handle').Out('MojoHandle')
 
+  # New functions are appended so that the message IDs of the existing ones
+  # stay the same.
+  f = mojo.Func('MojoCreateWaitSet', 'MojoResult')
+  p = f.Param('options')
+  p.InExtensibleStruct('MojoCreateWaitSetOptions').Optional()
+  f.Param('wait_set_handle').Out('MojoHandle')
+
+  f = mojo.Func('MojoWaitSetAdd', 'MojoResult')
+  f.Param('wait_set_handle').In('MojoHandle')
+  f.Param('handle').In('MojoHandle')
+  f.Param('signals').In('MojoHandleSignals')
+  f.Param('cookie').In('uint64_t')
+
+  f = mojo.Func('MojoWaitSetRemove', 'MojoResult')
+  f.Param('wait_set_handle').In('MojoHandle')
+  f.Param('cookie').In('uint64_t')
+
+  f = mojo.Func('MojoWaitSetWait', 'MojoResult')
+  f.Param('wait_set_handle').In('MojoHandle')
+  f.Param('deadline').In('MojoDeadline')
+  f.Param('num_results').InOut('uint32_t')
+  p = f.Param('results')
+  p.OutFixedStructArray('MojoWaitSetResult', 'num_results').Optional()
+
   mojo.Finalize()
 
   return mojo
@@ -4,6 +4,9 @@
 
 #include "services/debugger/trace_collector.h"
 
+#include "base/logging.h"
+#include "mojo/common/trace_records.h"
+
 namespace debugger {
 
 TraceCollector::TraceCollector(mojo::ScopedDataPipeConsumerHandle source)
@@ -37,7 +40,13 @@ void TraceCollector::OnDataComplete() {
 }
 
 std::string TraceCollector::GetTraceAsString() {
-  return std::string(&trace_.front(), trace_.size());
+  std::string json;
+  if (!trace_.empty() &&
+      !mojo::common::AppendTraceStreamAsJSON(&trace_.front(), trace_.size(),
+                                             &json)) {
+    LOG(WARNING) << "Invalid trace data from the tracing service";
+  }
+  return json;
 }
 
 }  // namespace debugger
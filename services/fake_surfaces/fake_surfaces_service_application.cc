@@ -105,6 +105,15 @@ class FakeSurfaceImpl : public Surface {
 
   void DestroySurface(uint32_t local_id) override {}
 
+  void SubmitFrameDelta(uint32_t local_id,
+                        mojo::FrameDeltaPtr frame_delta,
+                        const SubmitFrameDeltaCallback& callback) override {
+    callback.Run(true);
+    if (frame_delta->resources.size() == 0u || !returner_)
+      return;
+    ReturnAll(frame_delta->resources, returner_.get());
+  }
+
  private:
   const uint32_t id_namespace_;
   ResourceReturnerPtr returner_;
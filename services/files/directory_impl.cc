@@ -12,11 +12,13 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "base/bind.h"
 #include "base/files/scoped_temp_dir.h"
+#include "base/location.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/posix/eintr_wrapper.h"
-#include "build/build_config.h"
+#include "services/files/directory_reader_impl.h"
 #include "services/files/file_impl.h"
 #include "services/files/shared_impl.h"
 #include "services/files/util.h"
@@ -26,11 +28,38 @@ namespace files {
 
 namespace {
 
-// Calls |closedir()| on a |DIR*|.
-struct DIRDeleter {
-  void operator()(DIR* dir) const { PCHECK(closedir(dir) == 0); }
+// The maximum number of paths that a single |StatMultiple()| may stat, to bound
+// the size of the response (and the time spent on the worker thread).
+const size_t kMaxStatMultipleCount = 1000;
+
+// The state of a |StatMultiple()|: the paths are stat-ed (relative to a
+// duplicate of the directory's FD) on the worker thread.
+struct StatMultipleState {
+  StatMultipleState(base::ScopedFD dir_fd, Array<String> paths)
+      : dir_fd(dir_fd.Pass()),
+        paths(paths.Pass()),
+        result(this->paths.size()) {}
+
+  base::ScopedFD dir_fd;
+  Array<String> paths;
+  Array<FileInformationPtr> result;
 };
-using ScopedDIR = scoped_ptr<DIR, DIRDeleter>;
+
+void BlockingStatMultiple(StatMultipleState* state) {
+  for (size_t i = 0; i < state->paths.size(); i++) {
+    DCHECK(!state->paths[i].is_null());
+    // See the TODOs about |path| in |DirectoryImpl::OpenFile()|.
+    if (IsPathValid(state->paths[i]) != ERROR_OK)
+      continue;
+    StatAt(state->dir_fd.get(), state->paths[i].get().c_str(),
+           &state->result[i]);
+  }
+}
+
+void DidStatMultiple(const Directory::StatMultipleCallback& callback,
+                     StatMultipleState* state) {
+  callback.Run(ERROR_OK, state->result.Pass());
+}
 
 Error ValidateOpenFlags(uint32_t open_flags, bool is_directory) {
   // Treat unknown flags as "unimplemented".
@@ -96,10 +125,12 @@ Error ValidateDeleteFlags(uint32_t delete_flags) {
 
 DirectoryImpl::DirectoryImpl(InterfaceRequest<Directory> request,
                              base::ScopedFD dir_fd,
-                             scoped_ptr<base::ScopedTempDir> temp_dir)
+                             scoped_ptr<base::ScopedTempDir> temp_dir,
+                             scoped_refptr<base::TaskRunner> worker_runner)
     : binding_(this, request.Pass()),
       dir_fd_(dir_fd.Pass()),
-      temp_dir_(temp_dir.Pass()) {
+      temp_dir_(temp_dir.Pass()),
+      worker_runner_(worker_runner) {
   DCHECK(dir_fd_.is_valid());
 }
 
@@ -125,49 +156,44 @@ void DirectoryImpl::Read(const ReadCallback& callback) {
     return;
   }
 
+  // Read one more entry than will be returned, to detect truncation.
   Array<DirectoryEntryPtr> result(0);
+  if (Error error = ReadDirEntries(dir.get(), kMaxReadCount + 1, &result)) {
+    callback.Run(error, Array<DirectoryEntryPtr>());
+    return;
+  }
 
-// Warning: This is not portable (per POSIX.1 -- |buffer| may not be large
-// enough), but it's fine for Linux.
-#if !defined(OS_ANDROID) && !defined(OS_LINUX)
-#error "Use of struct dirent for readdir_r() buffer not portable; please check."
-#endif
-  struct dirent buffer;
-  for (size_t n = 0;;) {
-    struct dirent* entry = nullptr;
-    if (int error = readdir_r(dir.get(), &buffer, &entry)) {
-      // |error| is effectively an errno (for |readdir_r()|), AFAICT.
-      callback.Run(ErrnoToError(error), Array<DirectoryEntryPtr>());
-      return;
-    }
+  if (result.size() > kMaxReadCount) {
+    LOG(WARNING) << "Directory contents truncated";
+    result.resize(kMaxReadCount);
+    callback.Run(ERROR_OUT_OF_RANGE, result.Pass());
+    return;
+  }
 
-    if (!entry)
-      break;
+  callback.Run(ERROR_OK, result.Pass());
+}
 
-    n++;
-    if (n > kMaxReadCount) {
-      LOG(WARNING) << "Directory contents truncated";
-      callback.Run(ERROR_OUT_OF_RANGE, result.Pass());
-      return;
-    }
+void DirectoryImpl::OpenReader(InterfaceRequest<DirectoryReader> reader,
+                               const OpenReaderCallback& callback) {
+  DCHECK(dir_fd_.is_valid());
 
-    DirectoryEntryPtr e = DirectoryEntry::New();
-    switch (entry->d_type) {
-      case DT_DIR:
-        e->type = FILE_TYPE_DIRECTORY;
-        break;
-      case DT_REG:
-        e->type = FILE_TYPE_REGULAR_FILE;
-        break;
-      default:
-        e->type = FILE_TYPE_UNKNOWN;
-        break;
-    }
-    e->name = String(entry->d_name);
-    result.push_back(e.Pass());
+  // Unlike a |dup()|ed FD, this has its own position, so that it can be read
+  // independently of other readers (and of |Read()|).
+  base::ScopedFD fd(
+      HANDLE_EINTR(openat(dir_fd_.get(), ".", O_RDONLY | O_DIRECTORY)));
+  if (!fd.is_valid()) {
+    callback.Run(ErrnoToError(errno));
+    return;
   }
 
-  callback.Run(ERROR_OK, result.Pass());
+  ScopedDIR dir(fdopendir(fd.release()));
+  if (!dir) {
+    callback.Run(ErrnoToError(errno));
+    return;
+  }
+
+  new DirectoryReaderImpl(reader.Pass(), dir.Pass(), worker_runner_);
+  callback.Run(ERROR_OK);
 }
 
 void DirectoryImpl::Stat(const StatCallback& callback) {
@@ -224,7 +250,7 @@ void DirectoryImpl::OpenFile(const String& path,
   }
 
   if (file.is_pending())
-    new FileImpl(file.Pass(), file_fd.Pass());
+    new FileImpl(file.Pass(), file_fd.Pass(), worker_runner_);
   callback.Run(ERROR_OK);
 }
 
@@ -273,7 +299,8 @@ void DirectoryImpl::OpenDirectory(const String& path,
   }
 
   if (directory.is_pending())
-    new DirectoryImpl(directory.Pass(), new_dir_fd.Pass(), nullptr);
+    new DirectoryImpl(directory.Pass(), new_dir_fd.Pass(), nullptr,
+                      worker_runner_);
   callback.Run(ERROR_OK);
 }
 
@@ -349,5 +376,28 @@ void DirectoryImpl::Delete(const String& path,
   callback.Run(ErrnoToError(errno));
 }
 
+void DirectoryImpl::StatMultiple(Array<String> paths,
+                                 const StatMultipleCallback& callback) {
+  DCHECK(!paths.is_null());
+  DCHECK(dir_fd_.is_valid());
+
+  if (paths.size() > kMaxStatMultipleCount) {
+    callback.Run(ERROR_OUT_OF_RANGE, Array<FileInformationPtr>());
+    return;
+  }
+
+  // The worker gets its own FD, since |this| may be destroyed first.
+  base::ScopedFD fd(dup(dir_fd_.get()));
+  if (!fd.is_valid()) {
+    callback.Run(ErrnoToError(errno), Array<FileInformationPtr>());
+    return;
+  }
+
+  StatMultipleState* state = new StatMultipleState(fd.Pass(), paths.Pass());
+  worker_runner_->PostTaskAndReply(
+      FROM_HERE, base::Bind(&BlockingStatMultiple, base::Unretained(state)),
+      base::Bind(&DidStatMultiple, callback, base::Owned(state)));
+}
+
 }  // namespace files
 }  // namespace mojo
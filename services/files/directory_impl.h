@@ -7,7 +7,9 @@
 
 #include "base/files/scoped_file.h"
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/task_runner.h"
 #include "mojo/public/cpp/bindings/interface_request.h"
 #include "mojo/public/cpp/bindings/strong_binding.h"
 #include "mojo/services/files/public/interfaces/directory.mojom.h"
@@ -22,14 +24,18 @@ namespace files {
 class DirectoryImpl : public Directory {
  public:
   // Set |temp_dir| only if there's a temporary directory that should be deleted
-  // when this object is destroyed.
+  // when this object is destroyed. |worker_runner| is used for operations that
+  // may block for a long time.
   DirectoryImpl(InterfaceRequest<Directory> request,
                 base::ScopedFD dir_fd,
-                scoped_ptr<base::ScopedTempDir> temp_dir);
+                scoped_ptr<base::ScopedTempDir> temp_dir,
+                scoped_refptr<base::TaskRunner> worker_runner);
   ~DirectoryImpl() override;
 
   // |Directory| implementation:
   void Read(const ReadCallback& callback) override;
+  void OpenReader(InterfaceRequest<DirectoryReader> reader,
+                  const OpenReaderCallback& callback) override;
   void Stat(const StatCallback& callback) override;
   void Touch(TimespecOrNowPtr atime,
              TimespecOrNowPtr mtime,
@@ -48,11 +54,14 @@ class DirectoryImpl : public Directory {
   void Delete(const String& path,
               uint32_t delete_flags,
               const DeleteCallback& callback) override;
+  void StatMultiple(Array<String> paths,
+                    const StatMultipleCallback& callback) override;
 
  private:
   StrongBinding<Directory> binding_;
   base::ScopedFD dir_fd_;
   scoped_ptr<base::ScopedTempDir> temp_dir_;
+  scoped_refptr<base::TaskRunner> worker_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(DirectoryImpl);
 };
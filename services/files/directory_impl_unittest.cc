@@ -4,7 +4,10 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
+#include "base/strings/stringprintf.h"
+#include "mojo/public/cpp/bindings/type_converter.h"
 #include "services/files/files_test_base.h"
 
 namespace mojo {
@@ -191,6 +194,158 @@ TEST_F(DirectoryImplTest, BasicRenameDelete) {
   EXPECT_EQ(ERROR_UNKNOWN, error);
 }
 
+TEST_F(DirectoryImplTest, OpenReader) {
+  DirectoryPtr directory;
+  GetTemporaryRoot(&directory);
+  Error error;
+
+  // Make some files, with different sizes (file i has size i).
+  const size_t kNumFiles = 25;
+  std::map<std::string, int64_t> expected_sizes;
+  for (size_t i = 0; i < kNumFiles; i++) {
+    std::string name = base::StringPrintf("my_file%d", static_cast<int>(i));
+    FilePtr file;
+    error = ERROR_INTERNAL;
+    directory->OpenFile(name, GetProxy(&file),
+                        kOpenFlagWrite | kOpenFlagCreate, Capture(&error));
+    ASSERT_TRUE(directory.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_OK, error);
+
+    if (i > 0) {
+      error = ERROR_INTERNAL;
+      uint32_t num_bytes_written = 0;
+      file->Write(Array<uint8_t>::From(std::vector<uint8_t>(i, 'x')), 0,
+                  WHENCE_FROM_CURRENT, Capture(&error, &num_bytes_written));
+      ASSERT_TRUE(file.WaitForIncomingResponse());
+      EXPECT_EQ(ERROR_OK, error);
+      EXPECT_EQ(i, num_bytes_written);
+    }
+    expected_sizes[name] = static_cast<int64_t>(i);
+  }
+  // Make a directory.
+  error = ERROR_INTERNAL;
+  directory->OpenDirectory("my_dir", nullptr,
+                           kOpenFlagRead | kOpenFlagWrite | kOpenFlagCreate,
+                           Capture(&error));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+
+  DirectoryReaderPtr reader;
+  error = ERROR_INTERNAL;
+  directory->OpenReader(GetProxy(&reader), Capture(&error));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+
+  // Read in batches of (at most) 10, sending two reads at a time.
+  std::map<std::string, FileInformationPtr> entries;
+  for (;;) {
+    Error errors[2] = {ERROR_INTERNAL, ERROR_INTERNAL};
+    Array<DirectoryEntryPtr> directory_contents[2];
+    reader->Read(10, Capture(&errors[0], &directory_contents[0]));
+    reader->Read(10, Capture(&errors[1], &directory_contents[1]));
+    ASSERT_TRUE(reader.WaitForIncomingResponse());
+    ASSERT_TRUE(reader.WaitForIncomingResponse());
+
+    for (size_t i = 0; i < 2; i++) {
+      EXPECT_EQ(ERROR_OK, errors[i]);
+      ASSERT_FALSE(directory_contents[i].is_null());
+      EXPECT_LE(directory_contents[i].size(), 10u);
+      for (size_t j = 0; j < directory_contents[i].size(); j++) {
+        DirectoryEntryPtr& entry = directory_contents[i][j];
+        ASSERT_TRUE(entry);
+        ASSERT_TRUE(entry->information);
+        EXPECT_EQ(entry->type, entry->information->type);
+        EXPECT_TRUE(entries.find(entry->name) == entries.end());
+        entries[entry->name] = entry->information.Pass();
+      }
+    }
+    if (directory_contents[1].size() == 0)
+      break;
+  }
+
+  // Check the contents: the files, my_dir, ".", and "..".
+  EXPECT_EQ(kNumFiles + 3, entries.size());
+  for (const auto& it : expected_sizes) {
+    auto entry = entries.find(it.first);
+    ASSERT_TRUE(entry != entries.end());
+    EXPECT_EQ(FILE_TYPE_REGULAR_FILE, entry->second->type);
+    EXPECT_EQ(it.second, entry->second->size);
+  }
+  ASSERT_TRUE(entries.find("my_dir") != entries.end());
+  EXPECT_EQ(FILE_TYPE_DIRECTORY, entries["my_dir"]->type);
+  ASSERT_TRUE(entries.find(".") != entries.end());
+  EXPECT_EQ(FILE_TYPE_DIRECTORY, entries["."]->type);
+
+  // Reading more gives nothing.
+  error = ERROR_INTERNAL;
+  Array<DirectoryEntryPtr> directory_contents;
+  reader->Read(10, Capture(&error, &directory_contents));
+  ASSERT_TRUE(reader.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  ASSERT_FALSE(directory_contents.is_null());
+  EXPECT_EQ(0u, directory_contents.size());
+}
+
+TEST_F(DirectoryImplTest, StatMultiple) {
+  DirectoryPtr directory;
+  GetTemporaryRoot(&directory);
+  Error error;
+
+  // Make a file (with some contents) and a directory.
+  {
+    FilePtr file;
+    error = ERROR_INTERNAL;
+    directory->OpenFile("my_file", GetProxy(&file),
+                        kOpenFlagWrite | kOpenFlagCreate, Capture(&error));
+    ASSERT_TRUE(directory.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_OK, error);
+
+    error = ERROR_INTERNAL;
+    uint32_t num_bytes_written = 0;
+    file->Write(Array<uint8_t>::From(std::vector<uint8_t>(123, 'x')), 0,
+                WHENCE_FROM_CURRENT, Capture(&error, &num_bytes_written));
+    ASSERT_TRUE(file.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_OK, error);
+  }
+  error = ERROR_INTERNAL;
+  directory->OpenDirectory("my_dir", nullptr,
+                           kOpenFlagRead | kOpenFlagWrite | kOpenFlagCreate,
+                           Capture(&error));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+
+  std::vector<std::string> paths;
+  paths.push_back("my_file");
+  paths.push_back("nonexistent");
+  paths.push_back("my_dir");
+  paths.push_back("/absolute");
+  error = ERROR_INTERNAL;
+  Array<FileInformationPtr> file_information;
+  directory->StatMultiple(Array<String>::From(paths),
+                          Capture(&error, &file_information));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  ASSERT_EQ(paths.size(), file_information.size());
+
+  ASSERT_TRUE(file_information[0]);
+  EXPECT_EQ(FILE_TYPE_REGULAR_FILE, file_information[0]->type);
+  EXPECT_EQ(123, file_information[0]->size);
+  EXPECT_TRUE(file_information[0]->mtime);
+  EXPECT_FALSE(file_information[1]);
+  ASSERT_TRUE(file_information[2]);
+  EXPECT_EQ(FILE_TYPE_DIRECTORY, file_information[2]->type);
+  EXPECT_FALSE(file_information[3]);
+
+  // Too many paths.
+  paths.assign(1001, "my_file");
+  error = ERROR_INTERNAL;
+  directory->StatMultiple(Array<String>::From(paths),
+                          Capture(&error, &file_information));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OUT_OF_RANGE, error);
+  EXPECT_TRUE(file_information.is_null());
+}
+
 // TODO(vtl): Test that an open file can be moved (by someone else) without
 // operations on it being affected.
 // TODO(vtl): Test delete flags.
@@ -0,0 +1,106 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "services/files/directory_reader_impl.h"
+
+#include <dirent.h>
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+
+namespace mojo {
+namespace files {
+
+// The maximum number of entries read by a single |Read()|, to bound the size
+// of the response (and the time spent on the worker thread).
+const uint32_t kMaxReadCount = 1000;
+
+// The state of a |Read()|: the directory is handed to the worker thread, which
+// reads (and stats) the entries and hands it back.
+struct DirectoryReaderImpl::ReadState {
+  ReadState(ScopedDIR dir, uint32_t max_count)
+      : dir(dir.Pass()), max_count(max_count), error(ERROR_OK), entries(0) {}
+
+  ScopedDIR dir;
+  const uint32_t max_count;
+  Error error;
+  Array<DirectoryEntryPtr> entries;
+};
+
+// static
+void DirectoryReaderImpl::BlockingReadAndStat(ReadState* state) {
+  state->error =
+      ReadDirEntries(state->dir.get(), state->max_count, &state->entries);
+  if (state->error != ERROR_OK)
+    return;
+
+  // If an entry can't be stat-ed (e.g., if it was just deleted or is a
+  // dangling symlink), just leave out its information.
+  int dir_fd = dirfd(state->dir.get());
+  for (size_t i = 0; i < state->entries.size(); i++) {
+    DirectoryEntryPtr& e = state->entries[i];
+    if (StatAt(dir_fd, e->name.data(), &e->information) == ERROR_OK)
+      e->type = e->information->type;
+  }
+}
+
+DirectoryReaderImpl::DirectoryReaderImpl(
+    InterfaceRequest<DirectoryReader> request,
+    ScopedDIR dir,
+    scoped_refptr<base::TaskRunner> worker_runner)
+    : binding_(this, request.Pass()),
+      dir_(dir.Pass()),
+      worker_runner_(worker_runner),
+      weak_factory_(this) {
+  DCHECK(dir_);
+}
+
+DirectoryReaderImpl::~DirectoryReaderImpl() {
+}
+
+void DirectoryReaderImpl::Read(uint32_t max_count,
+                               const ReadCallback& callback) {
+  if (!max_count) {
+    callback.Run(ERROR_INVALID_ARGUMENT, Array<DirectoryEntryPtr>());
+    return;
+  }
+
+  // Only one read may use the directory at a time.
+  if (!dir_) {
+    pending_reads_.push_back(base::Bind(&DirectoryReaderImpl::Read,
+                                        base::Unretained(this), max_count,
+                                        callback));
+    return;
+  }
+
+  // If |this| is destroyed before the read completes, |state| (and the
+  // directory) is just deleted.
+  ReadState* state =
+      new ReadState(dir_.Pass(), std::min(max_count, kMaxReadCount));
+  worker_runner_->PostTaskAndReply(
+      FROM_HERE, base::Bind(&BlockingReadAndStat, base::Unretained(state)),
+      base::Bind(&DirectoryReaderImpl::DidRead, weak_factory_.GetWeakPtr(),
+                 callback, base::Owned(state)));
+}
+
+void DirectoryReaderImpl::DidRead(const ReadCallback& callback,
+                                  ReadState* state) {
+  dir_ = state->dir.Pass();
+  if (state->error != ERROR_OK)
+    callback.Run(state->error, Array<DirectoryEntryPtr>());
+  else
+    callback.Run(ERROR_OK, state->entries.Pass());
+
+  if (!pending_reads_.empty()) {
+    base::Closure read = pending_reads_.front();
+    pending_reads_.pop_front();
+    read.Run();
+  }
+}
+
+}  // namespace files
+}  // namespace mojo
@@ -0,0 +1,58 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SERVICES_FILES_DIRECTORY_READER_IMPL_H_
+#define SERVICES_FILES_DIRECTORY_READER_IMPL_H_
+
+#include <deque>
+
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/task_runner.h"
+#include "mojo/public/cpp/bindings/interface_request.h"
+#include "mojo/public/cpp/bindings/strong_binding.h"
+#include "mojo/services/files/public/interfaces/directory.mojom.h"
+#include "services/files/shared_impl.h"
+
+namespace mojo {
+namespace files {
+
+class DirectoryReaderImpl : public DirectoryReader {
+ public:
+  // |dir| must be valid. Its entries are read from its current position.
+  // |worker_runner| is used to read (and stat) the entries.
+  DirectoryReaderImpl(InterfaceRequest<DirectoryReader> request,
+                      ScopedDIR dir,
+                      scoped_refptr<base::TaskRunner> worker_runner);
+  ~DirectoryReaderImpl() override;
+
+  // |DirectoryReader| implementation:
+  void Read(uint32_t max_count, const ReadCallback& callback) override;
+
+ private:
+  struct ReadState;
+
+  // Reads (and stats) the entries for |state|; this blocks, so it's run on the
+  // worker thread.
+  static void BlockingReadAndStat(ReadState* state);
+  void DidRead(const ReadCallback& callback, ReadState* state);
+
+  StrongBinding<DirectoryReader> binding_;
+  // Null while a read is in progress on the worker thread (which has it).
+  ScopedDIR dir_;
+  scoped_refptr<base::TaskRunner> worker_runner_;
+  // The reads requested while a read was in progress.
+  std::deque<base::Closure> pending_reads_;
+
+  base::WeakPtrFactory<DirectoryReaderImpl> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(DirectoryReaderImpl);
+};
+
+}  // namespace files
+}  // namespace mojo
+
+#endif  // SERVICES_FILES_DIRECTORY_READER_IMPL_H_
@@ -10,11 +10,18 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <limits>
 
+#include "base/bind.h"
 #include "base/files/scoped_file.h"
+#include "base/location.h"
 #include "base/logging.h"
 #include "base/posix/eintr_wrapper.h"
+#include "base/task_runner_util.h"
+#include "mojo/common/handle_watcher.h"
+#include "mojo/public/cpp/system/buffer.h"
+#include "mojo/public/cpp/system/data_pipe.h"
 #include "services/files/shared_impl.h"
 #include "services/files/util.h"
 
@@ -26,8 +33,284 @@ namespace files {
 
 const size_t kMaxReadSize = 1 * 1024 * 1024;  // 1 MB.
 
-FileImpl::FileImpl(InterfaceRequest<File> request, base::ScopedFD file_fd)
-    : binding_(this, request.Pass()), file_fd_(file_fd.Pass()) {
+namespace {
+
+// The maximum number of bytes read or written by each task posted to the
+// worker thread by |ReadToStream()| and |WriteFromStream()|.
+const size_t kMaxStreamChunkSize = 256 * 1024;  // 256 KB.
+
+// The functions below block, so they're run on the worker thread. They use
+// |pread()|/|pwrite()|, so they don't change the file position.
+
+// Reads (at most) |num_bytes| bytes from |fd| starting at |position| into
+// |buffer|, setting |*num_bytes_read| to the number of bytes read.
+Error BlockingRead(int fd,
+                   void* buffer,
+                   size_t num_bytes,
+                   int64_t position,
+                   size_t* num_bytes_read) {
+  ssize_t result =
+      HANDLE_EINTR(pread(fd, buffer, num_bytes, static_cast<off_t>(position)));
+  if (result < 0)
+    return ErrnoToError(errno);
+  *num_bytes_read = static_cast<size_t>(result);
+  return ERROR_OK;
+}
+
+// Writes the |num_bytes| bytes of |buffer| to |fd| starting at |position|.
+Error BlockingWrite(int fd,
+                    const void* buffer,
+                    size_t num_bytes,
+                    int64_t position) {
+  size_t num_bytes_written = 0;
+  while (num_bytes_written < num_bytes) {
+    ssize_t result = HANDLE_EINTR(
+        pwrite(fd, static_cast<const char*>(buffer) + num_bytes_written,
+               num_bytes - num_bytes_written,
+               static_cast<off_t>(position + num_bytes_written)));
+    if (result < 0)
+      return ErrnoToError(errno);
+    num_bytes_written += static_cast<size_t>(result);
+  }
+  return ERROR_OK;
+}
+
+// Reads (at most) |num_bytes_to_read| bytes from a file into a data pipe, and
+// then calls back (after closing the data pipe) and deletes itself. The data
+// is read directly into the data pipe's buffer (using two-phase writes): the
+// data pipe is waited on on the calling thread, and only the reads themselves
+// (of at most |kMaxStreamChunkSize| bytes each) are done on the worker thread.
+class FileToStreamCopier {
+ public:
+  FileToStreamCopier(base::ScopedFD fd,
+                     int64_t position,
+                     int64_t num_bytes_to_read,
+                     ScopedDataPipeProducerHandle destination,
+                     scoped_refptr<base::TaskRunner> worker_runner,
+                     const Callback<void(Error)>& callback)
+      : fd_(fd.Pass()),
+        position_(position),
+        num_bytes_to_read_(num_bytes_to_read),
+        destination_(destination.Pass()),
+        worker_runner_(worker_runner),
+        callback_(callback),
+        num_bytes_read_(0) {}
+
+  void Start() { BeginWrite(); }
+
+ private:
+  ~FileToStreamCopier() {}
+
+  void BeginWrite() {
+    if (num_bytes_to_read_ <= 0) {
+      Finish(ERROR_OK);
+      return;
+    }
+
+    void* buffer = nullptr;
+    uint32_t buffer_num_bytes = 0;
+    MojoResult result =
+        BeginWriteDataRaw(destination_.get(), &buffer, &buffer_num_bytes,
+                          MOJO_WRITE_DATA_FLAG_NONE);
+    if (result == MOJO_RESULT_SHOULD_WAIT) {
+      handle_watcher_.Start(destination_.get(), MOJO_HANDLE_SIGNAL_WRITABLE,
+                            MOJO_DEADLINE_INDEFINITE,
+                            base::Bind(&FileToStreamCopier::OnWritable,
+                                       base::Unretained(this)));
+      return;
+    }
+    if (result != MOJO_RESULT_OK) {
+      // The consumer was closed before all the data was read.
+      Finish(ERROR_CLOSED);
+      return;
+    }
+
+    size_t num_bytes = static_cast<size_t>(
+        std::min(std::min(static_cast<int64_t>(buffer_num_bytes),
+                          static_cast<int64_t>(kMaxStreamChunkSize)),
+                 num_bytes_to_read_));
+    base::PostTaskAndReplyWithResult(
+        worker_runner_.get(), FROM_HERE,
+        base::Bind(&BlockingRead, fd_.get(), buffer, num_bytes, position_,
+                   base::Unretained(&num_bytes_read_)),
+        base::Bind(&FileToStreamCopier::DidRead, base::Unretained(this)));
+  }
+
+  void OnWritable(MojoResult result) { BeginWrite(); }
+
+  void DidRead(Error error) {
+    if (error != ERROR_OK) {
+      EndWriteDataRaw(destination_.get(), 0u);
+      Finish(error);
+      return;
+    }
+    EndWriteDataRaw(destination_.get(), static_cast<uint32_t>(num_bytes_read_));
+    // Stop at the end of the file.
+    if (num_bytes_read_ == 0) {
+      Finish(ERROR_OK);
+      return;
+    }
+
+    position_ += static_cast<int64_t>(num_bytes_read_);
+    num_bytes_to_read_ -= static_cast<int64_t>(num_bytes_read_);
+    BeginWrite();
+  }
+
+  void Finish(Error error) {
+    destination_.reset();
+    callback_.Run(error);
+    delete this;
+  }
+
+  base::ScopedFD fd_;
+  int64_t position_;
+  int64_t num_bytes_to_read_;
+  ScopedDataPipeProducerHandle destination_;
+  scoped_refptr<base::TaskRunner> worker_runner_;
+  Callback<void(Error)> callback_;
+  common::HandleWatcher handle_watcher_;
+  // Set on the worker thread by the read in progress (if any).
+  size_t num_bytes_read_;
+
+  DISALLOW_COPY_AND_ASSIGN(FileToStreamCopier);
+};
+
+// Writes all the data from a data pipe (until its producer is closed) to a
+// file, and then calls back and deletes itself. The data is written directly
+// from the data pipe's buffer (using two-phase reads): the data pipe is
+// waited on on the calling thread, and only the writes themselves (of at most
+// |kMaxStreamChunkSize| bytes each) are done on the worker thread.
+class StreamToFileCopier {
+ public:
+  StreamToFileCopier(base::ScopedFD fd,
+                     int64_t position,
+                     ScopedDataPipeConsumerHandle source,
+                     scoped_refptr<base::TaskRunner> worker_runner,
+                     const Callback<void(Error)>& callback)
+      : fd_(fd.Pass()),
+        position_(position),
+        source_(source.Pass()),
+        worker_runner_(worker_runner),
+        callback_(callback),
+        num_bytes_writing_(0) {}
+
+  void Start() { BeginRead(); }
+
+ private:
+  ~StreamToFileCopier() {}
+
+  void BeginRead() {
+    const void* buffer = nullptr;
+    uint32_t buffer_num_bytes = 0;
+    MojoResult result = BeginReadDataRaw(source_.get(), &buffer,
+                                         &buffer_num_bytes,
+                                         MOJO_READ_DATA_FLAG_NONE);
+    if (result == MOJO_RESULT_SHOULD_WAIT) {
+      handle_watcher_.Start(source_.get(), MOJO_HANDLE_SIGNAL_READABLE,
+                            MOJO_DEADLINE_INDEFINITE,
+                            base::Bind(&StreamToFileCopier::OnReadable,
+                                       base::Unretained(this)));
+      return;
+    }
+    // The producer was closed, and all the data has been written.
+    if (result == MOJO_RESULT_FAILED_PRECONDITION) {
+      Finish(ERROR_OK);
+      return;
+    }
+    if (result != MOJO_RESULT_OK) {
+      Finish(ERROR_UNKNOWN);
+      return;
+    }
+
+    num_bytes_writing_ = std::min(static_cast<size_t>(buffer_num_bytes),
+                                  kMaxStreamChunkSize);
+    base::PostTaskAndReplyWithResult(
+        worker_runner_.get(), FROM_HERE,
+        base::Bind(&BlockingWrite, fd_.get(), buffer, num_bytes_writing_,
+                   position_),
+        base::Bind(&StreamToFileCopier::DidWrite, base::Unretained(this)));
+  }
+
+  void OnReadable(MojoResult result) { BeginRead(); }
+
+  void DidWrite(Error error) {
+    if (error != ERROR_OK) {
+      EndReadDataRaw(source_.get(), 0u);
+      Finish(error);
+      return;
+    }
+    EndReadDataRaw(source_.get(), static_cast<uint32_t>(num_bytes_writing_));
+    position_ += static_cast<int64_t>(num_bytes_writing_);
+    BeginRead();
+  }
+
+  void Finish(Error error) {
+    source_.reset();
+    callback_.Run(error);
+    delete this;
+  }
+
+  base::ScopedFD fd_;
+  int64_t position_;
+  ScopedDataPipeConsumerHandle source_;
+  scoped_refptr<base::TaskRunner> worker_runner_;
+  Callback<void(Error)> callback_;
+  common::HandleWatcher handle_watcher_;
+  // The size of the write in progress (if any).
+  size_t num_bytes_writing_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamToFileCopier);
+};
+
+// Reads the |num_bytes| bytes of |fd| into |buffer| (which must be at least
+// that big).
+Error BlockingReadToBuffer(base::ScopedFD fd,
+                           uint64_t num_bytes,
+                           SharedBufferHandle buffer) {
+  void* data = nullptr;
+  if (MapBuffer(buffer, 0, num_bytes, &data, MOJO_MAP_BUFFER_FLAG_NONE) !=
+      MOJO_RESULT_OK) {
+    return ERROR_INTERNAL;
+  }
+
+  Error error = ERROR_OK;
+  uint64_t position = 0;
+  while (position < num_bytes) {
+    ssize_t num_bytes_read = HANDLE_EINTR(
+        pread(fd.get(), static_cast<char*>(data) + position,
+              static_cast<size_t>(num_bytes - position),
+              static_cast<off_t>(position)));
+    if (num_bytes_read < 0) {
+      error = ErrnoToError(errno);
+      break;
+    }
+    // The file may have been truncated meanwhile; the rest of the buffer is
+    // left zeroed.
+    if (num_bytes_read == 0)
+      break;
+    position += static_cast<uint64_t>(num_bytes_read);
+  }
+
+  CHECK_EQ(UnmapBuffer(data), MOJO_RESULT_OK);
+  return error;
+}
+
+void RunAsBufferCallback(const File::AsBufferCallback& callback,
+                         ScopedSharedBufferHandle buffer,
+                         Error error) {
+  if (error != ERROR_OK)
+    buffer.reset();
+  callback.Run(error, buffer.Pass());
+}
+
+}  // namespace
+
+FileImpl::FileImpl(InterfaceRequest<File> request,
+                   base::ScopedFD file_fd,
+                   scoped_refptr<base::TaskRunner> worker_runner)
+    : binding_(this, request.Pass()),
+      file_fd_(file_fd.Pass()),
+      worker_runner_(worker_runner) {
   DCHECK(file_fd_.is_valid());
 }
 
@@ -180,10 +463,24 @@ void FileImpl::ReadToStream(ScopedDataPipeProducerHandle source,
     callback.Run(error);
     return;
   }
+  if (num_bytes_to_read < 0) {
+    callback.Run(ERROR_INVALID_ARGUMENT);
+    return;
+  }
+
+  int64_t position = 0;
+  if (Error error = GetAbsolutePosition(offset, whence, &position)) {
+    callback.Run(error);
+    return;
+  }
+  base::ScopedFD fd;
+  if (Error error = DupFD(&fd)) {
+    callback.Run(error);
+    return;
+  }
 
-  // TODO(vtl): FIXME soon
-  NOTIMPLEMENTED();
-  callback.Run(ERROR_UNIMPLEMENTED);
+  (new FileToStreamCopier(fd.Pass(), position, num_bytes_to_read,
+                          source.Pass(), worker_runner_, callback))->Start();
 }
 
 void FileImpl::WriteFromStream(ScopedDataPipeConsumerHandle sink,
@@ -203,9 +500,19 @@ void FileImpl::WriteFromStream(ScopedDataPipeConsumerHandle sink,
     return;
   }
 
-  // TODO(vtl): FIXME soon
-  NOTIMPLEMENTED();
-  callback.Run(ERROR_UNIMPLEMENTED);
+  int64_t position = 0;
+  if (Error error = GetAbsolutePosition(offset, whence, &position)) {
+    callback.Run(error);
+    return;
+  }
+  base::ScopedFD fd;
+  if (Error error = DupFD(&fd)) {
+    callback.Run(error);
+    return;
+  }
+
+  (new StreamToFileCopier(fd.Pass(), position, sink.Pass(), worker_runner_,
+                          callback))->Start();
 }
 
 void FileImpl::Tell(const TellCallback& callback) {
@@ -290,7 +597,7 @@ void FileImpl::Dup(InterfaceRequest<File> file, const DupCallback& callback) {
     return;
   }
 
-  new FileImpl(file.Pass(), file_fd.Pass());
+  new FileImpl(file.Pass(), file_fd.Pass(), worker_runner_);
   callback.Run(ERROR_OK);
 }
 
@@ -313,9 +620,39 @@ void FileImpl::AsBuffer(const AsBufferCallback& callback) {
     return;
   }
 
-  // TODO(vtl): FIXME soon
-  NOTIMPLEMENTED();
-  callback.Run(ERROR_UNIMPLEMENTED, ScopedSharedBufferHandle());
+  // Ideally, the buffer would be a mapping of the file (so that it would need
+  // no copying, and would be writable), but a shared buffer can't be created
+  // from a file. Instead, the file is read directly into the buffer (so it is
+  // still copied only once), on the worker thread.
+  struct stat buf;
+  if (fstat(file_fd_.get(), &buf) != 0) {
+    callback.Run(ErrnoToError(errno), ScopedSharedBufferHandle());
+    return;
+  }
+  // An empty buffer can't be created.
+  if (buf.st_size <= 0) {
+    callback.Run(ERROR_OK, ScopedSharedBufferHandle());
+    return;
+  }
+
+  const uint64_t num_bytes = static_cast<uint64_t>(buf.st_size);
+  ScopedSharedBufferHandle buffer;
+  if (CreateSharedBuffer(nullptr, num_bytes, &buffer) != MOJO_RESULT_OK) {
+    callback.Run(ERROR_OUT_OF_RANGE, ScopedSharedBufferHandle());
+    return;
+  }
+  base::ScopedFD fd;
+  if (Error error = DupFD(&fd)) {
+    callback.Run(error, ScopedSharedBufferHandle());
+    return;
+  }
+
+  SharedBufferHandle buffer_handle = buffer.get();
+  base::PostTaskAndReplyWithResult(
+      worker_runner_.get(), FROM_HERE,
+      base::Bind(&BlockingReadToBuffer, base::Passed(&fd), num_bytes,
+                 buffer_handle),
+      base::Bind(&RunAsBufferCallback, callback, base::Passed(&buffer)));
 }
 
 void FileImpl::Ioctl(uint32_t request,
@@ -331,5 +668,43 @@ void FileImpl::Ioctl(uint32_t request,
   callback.Run(ERROR_UNAVAILABLE, Array<uint32_t>());
 }
 
+Error FileImpl::GetAbsolutePosition(int64_t offset,
+                                    Whence whence,
+                                    int64_t* position) {
+  off_t base = 0;
+  switch (whence) {
+    case WHENCE_FROM_START:
+      break;
+    case WHENCE_FROM_CURRENT:
+      base = lseek(file_fd_.get(), 0, SEEK_CUR);
+      if (base < 0)
+        return ErrnoToError(errno);
+      break;
+    case WHENCE_FROM_END: {
+      struct stat buf;
+      if (fstat(file_fd_.get(), &buf) != 0)
+        return ErrnoToError(errno);
+      base = buf.st_size;
+      break;
+    }
+  }
+
+  // Both |base| and |offset| fit in an |off_t|, so the sum fits in an
+  // |int64_t|.
+  *position = static_cast<int64_t>(base) + offset;
+  if (*position < 0)
+    return ERROR_INVALID_ARGUMENT;
+  if (Error error = IsOffsetValid(*position))
+    return error;
+  return ERROR_OK;
+}
+
+Error FileImpl::DupFD(base::ScopedFD* fd) {
+  fd->reset(dup(file_fd_.get()));
+  if (!fd->is_valid())
+    return ErrnoToError(errno);
+  return ERROR_OK;
+}
+
 }  // namespace files
 }  // namespace mojo
@@ -7,6 +7,8 @@
 
 #include "base/files/scoped_file.h"
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/task_runner.h"
 #include "mojo/public/cpp/bindings/interface_request.h"
 #include "mojo/public/cpp/bindings/strong_binding.h"
 #include "mojo/services/files/public/interfaces/directory.mojom.h"
@@ -17,7 +19,11 @@ namespace files {
 class FileImpl : public File {
  public:
   // TODO(vtl): Will need more for, e.g., |Reopen()|.
-  FileImpl(InterfaceRequest<File> request, base::ScopedFD file_fd);
+  // |worker_runner| is used for the file I/O of the operations that may block
+  // for a long time (|ReadToStream()|, |WriteFromStream()|, and |AsBuffer()|).
+  FileImpl(InterfaceRequest<File> request,
+           base::ScopedFD file_fd,
+           scoped_refptr<base::TaskRunner> worker_runner);
   ~FileImpl() override;
 
   // |File| implementation:
@@ -58,8 +64,18 @@ class FileImpl : public File {
              const IoctlCallback& callback) override;
 
  private:
+  // Gets the position specified by |offset|/|whence| (from the beginning of the
+  // file), without changing the file position.
+  Error GetAbsolutePosition(int64_t offset, Whence whence, int64_t* position);
+
+  // Duplicates |file_fd_|, for use on the worker thread: the operations done
+  // there don't use (or change) the file position, and |file_fd_| may be
+  // closed meanwhile.
+  Error DupFD(base::ScopedFD* fd);
+
   StrongBinding<File> binding_;
   base::ScopedFD file_fd_;
+  scoped_refptr<base::TaskRunner> worker_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(FileImpl);
 };
@@ -2,10 +2,16 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
+#include <string>
 #include <vector>
 
+#include "mojo/common/data_pipe_utils.h"
 #include "mojo/public/cpp/bindings/interface_request.h"
 #include "mojo/public/cpp/bindings/type_converter.h"
+#include "mojo/public/cpp/system/buffer.h"
+#include "mojo/public/cpp/system/data_pipe.h"
 #include "services/files/files_test_base.h"
 
 namespace mojo {
@@ -14,6 +20,14 @@ namespace {
 
 using FileImplTest = FilesTestBase;
 
+// Makes |size| bytes of data that aren't all the same.
+std::string MakeTestData(size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++)
+    data[i] = static_cast<char>(i * 7 + i / 256);
+  return data;
+}
+
 TEST_F(FileImplTest, CreateWriteCloseRenameOpenRead) {
   DirectoryPtr directory;
   GetTemporaryRoot(&directory);
@@ -688,6 +702,194 @@ TEST_F(FileImplTest, Ioctl) {
   EXPECT_TRUE(out_values.is_null());
 }
 
+TEST_F(FileImplTest, ReadToStream) {
+  DirectoryPtr directory;
+  GetTemporaryRoot(&directory);
+  Error error;
+
+  // Create my_file.
+  FilePtr file;
+  error = ERROR_INTERNAL;
+  directory->OpenFile("my_file", GetProxy(&file),
+                      kOpenFlagRead | kOpenFlagWrite | kOpenFlagCreate,
+                      Capture(&error));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+
+  // Write more data than fits in a data pipe (with the default capacity) to it.
+  const std::string data = MakeTestData(3 * 1024 * 1024);
+  error = ERROR_INTERNAL;
+  uint32_t num_bytes_written = 0;
+  file->Write(Array<uint8_t>::From(
+                  std::vector<uint8_t>(data.begin(), data.end())),
+              0, WHENCE_FROM_CURRENT, Capture(&error, &num_bytes_written));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  EXPECT_EQ(data.size(), num_bytes_written);
+
+  // Read all of it (from the start), asking for more than there is.
+  {
+    DataPipe data_pipe;
+    error = ERROR_INTERNAL;
+    file->ReadToStream(data_pipe.producer_handle.Pass(), 0, WHENCE_FROM_START,
+                       static_cast<int64_t>(data.size()) + 100,
+                       Capture(&error));
+    std::string data_read;
+    EXPECT_TRUE(common::BlockingCopyToString(
+        data_pipe.consumer_handle.Pass(), &data_read));
+    ASSERT_TRUE(file.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_OK, error);
+    EXPECT_TRUE(data_read == data);
+  }
+
+  // Read part of it, relative to the end.
+  {
+    DataPipe data_pipe;
+    error = ERROR_INTERNAL;
+    file->ReadToStream(data_pipe.producer_handle.Pass(), -1000,
+                       WHENCE_FROM_END, 10, Capture(&error));
+    std::string data_read;
+    EXPECT_TRUE(common::BlockingCopyToString(
+        data_pipe.consumer_handle.Pass(), &data_read));
+    ASSERT_TRUE(file.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_OK, error);
+    EXPECT_EQ(data.substr(data.size() - 1000, 10), data_read);
+  }
+
+  // The file position isn't changed.
+  error = ERROR_INTERNAL;
+  int64_t position = -1;
+  file->Tell(Capture(&error, &position));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  EXPECT_EQ(static_cast<int64_t>(data.size()), position);
+
+  // Closing the consumer before all the data has been read makes the read
+  // fail (rather than wait forever).
+  {
+    DataPipe data_pipe;
+    error = ERROR_INTERNAL;
+    file->ReadToStream(data_pipe.producer_handle.Pass(), 0, WHENCE_FROM_START,
+                       static_cast<int64_t>(data.size()), Capture(&error));
+    data_pipe.consumer_handle.reset();
+    ASSERT_TRUE(file.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_CLOSED, error);
+  }
+
+  // Reading before the start of the file fails.
+  {
+    DataPipe data_pipe;
+    error = ERROR_INTERNAL;
+    file->ReadToStream(data_pipe.producer_handle.Pass(), -1, WHENCE_FROM_START,
+                       10, Capture(&error));
+    ASSERT_TRUE(file.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_INVALID_ARGUMENT, error);
+  }
+}
+
+TEST_F(FileImplTest, WriteFromStream) {
+  DirectoryPtr directory;
+  GetTemporaryRoot(&directory);
+  Error error;
+
+  // Create my_file.
+  FilePtr file;
+  error = ERROR_INTERNAL;
+  directory->OpenFile("my_file", GetProxy(&file),
+                      kOpenFlagRead | kOpenFlagWrite | kOpenFlagCreate,
+                      Capture(&error));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+
+  // Write more data than fits in a data pipe (with the default capacity) to it,
+  // starting at offset 10.
+  const std::string data = MakeTestData(3 * 1024 * 1024);
+  {
+    DataPipe data_pipe;
+    error = ERROR_INTERNAL;
+    file->WriteFromStream(data_pipe.consumer_handle.Pass(), 10,
+                          WHENCE_FROM_START, Capture(&error));
+    EXPECT_TRUE(
+        common::BlockingCopyFromString(data, data_pipe.producer_handle));
+    data_pipe.producer_handle.reset();
+    ASSERT_TRUE(file.WaitForIncomingResponse());
+    EXPECT_EQ(ERROR_OK, error);
+  }
+
+  // Check the size.
+  error = ERROR_INTERNAL;
+  FileInformationPtr file_info;
+  file->Stat(Capture(&error, &file_info));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  ASSERT_FALSE(file_info.is_null());
+  EXPECT_EQ(static_cast<int64_t>(data.size()) + 10, file_info->size);
+
+  // The file position isn't changed.
+  error = ERROR_INTERNAL;
+  int64_t position = -1;
+  file->Tell(Capture(&error, &position));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  EXPECT_EQ(0, position);
+
+  // Read back some of the data.
+  Array<uint8_t> bytes_read;
+  error = ERROR_INTERNAL;
+  file->Read(100, 1024 * 1024, WHENCE_FROM_START, Capture(&error, &bytes_read));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  ASSERT_EQ(100u, bytes_read.size());
+  EXPECT_EQ(0, memcmp(&bytes_read[0], &data[1024 * 1024 - 10], 100u));
+}
+
+TEST_F(FileImplTest, AsBuffer) {
+  DirectoryPtr directory;
+  GetTemporaryRoot(&directory);
+  Error error;
+
+  // Create my_file.
+  FilePtr file;
+  error = ERROR_INTERNAL;
+  directory->OpenFile("my_file", GetProxy(&file),
+                      kOpenFlagRead | kOpenFlagWrite | kOpenFlagCreate,
+                      Capture(&error));
+  ASSERT_TRUE(directory.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+
+  // There's no buffer for an empty file.
+  ScopedSharedBufferHandle buffer;
+  error = ERROR_INTERNAL;
+  file->AsBuffer(Capture(&error, &buffer));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  EXPECT_FALSE(buffer.is_valid());
+
+  // Write to it.
+  const std::string data = MakeTestData(100 * 1024);
+  error = ERROR_INTERNAL;
+  uint32_t num_bytes_written = 0;
+  file->Write(Array<uint8_t>::From(
+                  std::vector<uint8_t>(data.begin(), data.end())),
+              0, WHENCE_FROM_CURRENT, Capture(&error, &num_bytes_written));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  EXPECT_EQ(data.size(), num_bytes_written);
+
+  // Get it as a buffer, and check its contents.
+  error = ERROR_INTERNAL;
+  file->AsBuffer(Capture(&error, &buffer));
+  ASSERT_TRUE(file.WaitForIncomingResponse());
+  EXPECT_EQ(ERROR_OK, error);
+  ASSERT_TRUE(buffer.is_valid());
+
+  void* mapped = nullptr;
+  ASSERT_EQ(MOJO_RESULT_OK, MapBuffer(buffer.get(), 0, data.size(), &mapped,
+                                      MOJO_MAP_BUFFER_FLAG_NONE));
+  EXPECT_EQ(0, memcmp(mapped, data.data(), data.size()));
+  EXPECT_EQ(MOJO_RESULT_OK, UnmapBuffer(mapped));
+}
+
 }  // namespace
 }  // namespace files
 }  // namespace mojo
@@ -52,8 +52,9 @@ base::ScopedFD OpenMojoDebugDirectory() {
 }  // namespace
 
 FilesImpl::FilesImpl(ApplicationConnection* connection,
-                     InterfaceRequest<Files> request)
-    : binding_(this, request.Pass()) {
+                     InterfaceRequest<Files> request,
+                     scoped_refptr<base::TaskRunner> worker_runner)
+    : binding_(this, request.Pass()), worker_runner_(worker_runner) {
   // TODO(vtl): record other app's URL
 }
 
@@ -88,7 +89,8 @@ void FilesImpl::OpenFileSystem(const mojo::String& file_system,
     return;
   }
 
-  new DirectoryImpl(directory.Pass(), dir_fd.Pass(), temp_dir.Pass());
+  new DirectoryImpl(directory.Pass(), dir_fd.Pass(), temp_dir.Pass(),
+                    worker_runner_);
   callback.Run(ERROR_OK);
 }
 
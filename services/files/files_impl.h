@@ -6,6 +6,8 @@
 #define SERVICES_FILES_FILES_IMPL_H_
 
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/task_runner.h"
 #include "mojo/public/cpp/bindings/interface_request.h"
 #include "mojo/public/cpp/bindings/strong_binding.h"
 #include "mojo/services/files/public/interfaces/files.mojom.h"
@@ -18,7 +20,10 @@ namespace files {
 
 class FilesImpl : public Files {
  public:
-  FilesImpl(ApplicationConnection* connection, InterfaceRequest<Files> request);
+  // |worker_runner| is used for operations that may block for a long time.
+  FilesImpl(ApplicationConnection* connection,
+            InterfaceRequest<Files> request,
+            scoped_refptr<base::TaskRunner> worker_runner);
   ~FilesImpl() override;
 
   // |Files| implementation:
@@ -31,6 +36,7 @@ class FilesImpl : public Files {
 
  private:
   StrongBinding<Files> binding_;
+  scoped_refptr<base::TaskRunner> worker_runner_;
 
   DISALLOW_COPY_AND_ASSIGN(FilesImpl);
 };
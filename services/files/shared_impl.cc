@@ -5,35 +5,62 @@
 #include "services/files/shared_impl.h"
 
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <time.h>
 #include <unistd.h>
 
 #include "base/logging.h"
+#include "build/build_config.h"
 #include "services/files/futimens.h"
 #include "services/files/util.h"
 
 namespace mojo {
 namespace files {
 
-void StatFD(int fd, FileType type, const StatFDCallback& callback) {
-  DCHECK_NE(fd, -1);
+void DIRDeleter::operator()(DIR* dir) const {
+  PCHECK(closedir(dir) == 0);
+}
 
-  struct stat buf;
-  if (fstat(fd, &buf) != 0) {
-    callback.Run(ErrnoToError(errno), nullptr);
-    return;
+Error ReadDirEntries(DIR* dir,
+                     size_t max_count,
+                     Array<DirectoryEntryPtr>* entries) {
+  DCHECK(dir);
+
+// Warning: This is not portable (per POSIX.1 -- |buffer| may not be large
+// enough), but it's fine for Linux.
+#if !defined(OS_ANDROID) && !defined(OS_LINUX)
+#error "Use of struct dirent for readdir_r() buffer not portable; please check."
+#endif
+  struct dirent buffer;
+  for (size_t n = 0; n < max_count; n++) {
+    struct dirent* entry = nullptr;
+    if (int error = readdir_r(dir, &buffer, &entry)) {
+      // |error| is effectively an errno (for |readdir_r()|), AFAICT.
+      return ErrnoToError(error);
+    }
+
+    if (!entry)
+      break;
+
+    DirectoryEntryPtr e = DirectoryEntry::New();
+    e->type = DirentTypeToFileType(entry->d_type);
+    e->name = String(entry->d_name);
+    entries->push_back(e.Pass());
   }
+  return ERROR_OK;
+}
 
+FileInformationPtr MakeFileInformation(const struct stat& buf) {
   FileInformationPtr file_info(FileInformation::New());
-  file_info->type = type;
   // Only fill in |size| for files.
   if (S_ISREG(buf.st_mode)) {
+    file_info->type = FILE_TYPE_REGULAR_FILE;
     file_info->size = static_cast<int64_t>(buf.st_size);
   } else {
-    LOG_IF(WARNING, !S_ISDIR(buf.st_mode))
-        << "Unexpected fstat() of special file";
+    file_info->type =
+        S_ISDIR(buf.st_mode) ? FILE_TYPE_DIRECTORY : FILE_TYPE_UNKNOWN;
     file_info->size = 0;
   }
   file_info->atime = Timespec::New();
@@ -49,7 +76,32 @@ void StatFD(int fd, FileType type, const StatFDCallback& callback) {
   file_info->mtime->seconds = static_cast<int64_t>(buf.st_mtim.tv_sec);
   file_info->mtime->nanoseconds = static_cast<int32_t>(buf.st_mtim.tv_nsec);
 #endif
+  return file_info.Pass();
+}
 
+Error StatAt(int dir_fd, const char* path, FileInformationPtr* file_info) {
+  DCHECK_NE(dir_fd, -1);
+
+  struct stat buf;
+  if (fstatat(dir_fd, path, &buf, 0) != 0)
+    return ErrnoToError(errno);
+  *file_info = MakeFileInformation(buf);
+  return ERROR_OK;
+}
+
+void StatFD(int fd, FileType type, const StatFDCallback& callback) {
+  DCHECK_NE(fd, -1);
+
+  struct stat buf;
+  if (fstat(fd, &buf) != 0) {
+    callback.Run(ErrnoToError(errno), nullptr);
+    return;
+  }
+
+  LOG_IF(WARNING, !S_ISREG(buf.st_mode) && !S_ISDIR(buf.st_mode))
+      << "Unexpected fstat() of special file";
+  FileInformationPtr file_info = MakeFileInformation(buf);
+  file_info->type = type;
   callback.Run(ERROR_OK, file_info.Pass());
 }
 
@@ -8,12 +8,40 @@
 #ifndef SERVICES_FILES_SHARED_IMPL_H_
 #define SERVICES_FILES_SHARED_IMPL_H_
 
+#include <dirent.h>
+
+#include "base/memory/scoped_ptr.h"
+#include "mojo/public/cpp/bindings/array.h"
 #include "mojo/public/cpp/bindings/callback.h"
 #include "mojo/services/files/public/interfaces/types.mojom.h"
 
+struct stat;
+
 namespace mojo {
 namespace files {
 
+// Calls |closedir()| on a |DIR*|.
+struct DIRDeleter {
+  void operator()(DIR* dir) const;
+};
+using ScopedDIR = scoped_ptr<DIR, DIRDeleter>;
+
+// Reads (at most) |max_count| of the next entries of |dir|, appending them to
+// |entries|, with their |type| determined from the |struct dirent| (their
+// |information| isn't set). Fewer than |max_count| entries are read only at the
+// end of the directory.
+Error ReadDirEntries(DIR* dir,
+                     size_t max_count,
+                     Array<DirectoryEntryPtr>* entries);
+
+// Makes a |FileInformation| from the result of a |stat()|, with its type
+// determined from |buf.st_mode|.
+FileInformationPtr MakeFileInformation(const struct stat& buf);
+
+// Stats the given |path| (relative to |dir_fd|, which must be valid). On
+// success, sets |*file_info|.
+Error StatAt(int dir_fd, const char* path, FileInformationPtr* file_info);
+
 // Stats the given FD (which must be valid), calling |callback| appropriately.
 // The type in the |FileInformation| given to the callback will be assigned from
 // |type|.
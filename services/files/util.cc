@@ -4,6 +4,7 @@
 
 #include "services/files/util.h"
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
@@ -46,6 +47,17 @@ Error ErrnoToError(int errno_value) {
   return ERROR_UNKNOWN;
 }
 
+FileType DirentTypeToFileType(unsigned char d_type) {
+  switch (d_type) {
+    case DT_DIR:
+      return FILE_TYPE_DIRECTORY;
+    case DT_REG:
+      return FILE_TYPE_REGULAR_FILE;
+    default:
+      return FILE_TYPE_UNKNOWN;
+  }
+}
+
 int WhenceToStandardWhence(Whence whence) {
   DCHECK_EQ(IsWhenceValid(whence), ERROR_OK);
   switch (whence) {
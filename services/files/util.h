@@ -36,6 +36,9 @@ Error IsOffsetValid(int64_t offset);
 // Converts a standard errno value (|E...|) to an |Error| value.
 Error ErrnoToError(int errno_value);
 
+// Converts a |struct dirent|'s |d_type| value (|DT_...|) to a |FileType|.
+FileType DirentTypeToFileType(unsigned char d_type);
+
 // Converts a |Whence| value to a standard whence value (|SEEK_...|).
 int WhenceToStandardWhence(Whence whence);
 
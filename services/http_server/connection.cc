@@ -12,6 +12,14 @@
 namespace http_server {
 namespace {
 
+// How long a connection is kept open while waiting for the client to send a
+// request.
+const int kIdleTimeoutSeconds = 30;
+
+// The maximum number of pipelined requests that are handled at once on a
+// connection.
+const size_t kMaxPipelinedRequests = 16;
+
 const char* GetHttpReasonPhrase(uint32_t code_in) {
   switch (code_in) {
 #define HTTP_STATUS(label, code, reason) \
@@ -32,35 +40,172 @@ const char* GetHttpReasonPhrase(uint32_t code_in) {
 Connection::Connection(mojo::TCPConnectedSocketPtr conn,
                        mojo::ScopedDataPipeProducerHandle sender,
                        mojo::ScopedDataPipeConsumerHandle receiver,
-                       const Callback& callback)
+                       const Callback& callback,
+                       const base::Closure& closed_callback)
     : connection_(conn.Pass()),
       sender_(sender.Pass()),
       receiver_(receiver.Pass()),
-      request_waiter_(
-          receiver_.get(),
-          MOJO_HANDLE_SIGNAL_READABLE,
-          base::Bind(&Connection::OnRequestDataReady, base::Unretained(this))),
       content_length_(0),
       handle_request_callback_(callback),
-      response_offset_(0) {
+      closed_callback_(closed_callback),
+      next_request_id_(0),
+      writing_response_(false),
+      receiver_closed_(false),
+      close_after_responses_(false),
+      response_offset_(0),
+      weak_ptr_factory_(this) {
+  ReadRequests();
 }
 
 Connection::~Connection() {
+  closed_callback_.Run();
+}
+
+void Connection::SendResponse(uint32_t request_id, HttpResponsePtr response) {
+  for (PendingResponse* pending_response : pending_responses_) {
+    if (pending_response->request_id == request_id) {
+      DCHECK(!pending_response->response) << "Responded twice.";
+      pending_response->response = response.Pass();
+      WriteNextResponse();
+      return;
+    }
+  }
+  NOTREACHED() << "Response to unknown request " << request_id;
+}
+
+base::WeakPtr<Connection> Connection::GetWeakPtr() {
+  return weak_ptr_factory_.GetWeakPtr();
+}
+
+void Connection::WaitForRequestData() {
+  request_waiter_.reset(new mojo::AsyncWaiter(
+      receiver_.get(), MOJO_HANDLE_SIGNAL_READABLE,
+      base::Bind(&Connection::OnRequestDataReady, base::Unretained(this))));
+}
+
+void Connection::OnRequestDataReady(MojoResult result) {
+  // The waiter has fired, it is deleted when this returns. If the client closed
+  // the connection, ReadRequests() finds out when reading.
+  scoped_ptr<mojo::AsyncWaiter> request_waiter(request_waiter_.Pass());
+  ReadRequests();
+}
+
+void Connection::OnContentPipeReady(MojoResult result) {
+  // If the handler closed the pipe, the parser skips the rest of the content.
+  scoped_ptr<mojo::AsyncWaiter> content_waiter(content_waiter_.Pass());
+  ReadRequests();
+}
+
+void Connection::ReadRequests() {
+  base::WeakPtr<Connection> self(weak_ptr_factory_.GetWeakPtr());
+  bool wait_for_data = false;
+  // The content of the request being read is always read. Otherwise, the
+  // number of requests in flight is bounded: the following ones are left in
+  // the pipe until some responses are sent. Requests after one that isn't
+  // keep-alive are ignored.
+  while (request_parser_.IsParsingContent() ||
+         (!close_after_responses_ &&
+          pending_responses_.size() < kMaxPipelinedRequests)) {
+    const void* buffer = nullptr;
+    uint32_t num_bytes = 0;
+    MojoResult result = BeginReadDataRaw(receiver_.get(), &buffer, &num_bytes,
+                                         MOJO_READ_DATA_FLAG_NONE);
+    if (result == MOJO_RESULT_SHOULD_WAIT) {
+      wait_for_data = true;
+      break;
+    }
+    if (result != MOJO_RESULT_OK) {
+      // The client closed the connection (at least for writing) and all the
+      // data it sent has been read. The requests already received are still
+      // responded to, unless one was cut short.
+      if (request_parser_.IsParsingContent()) {
+        delete this;
+        return;
+      }
+      receiver_closed_ = true;
+      break;
+    }
+
+    size_t num_bytes_consumed = 0;
+    HttpRequestParser::ParseResult parse_result = request_parser_.Parse(
+        base::StringPiece(static_cast<const char*>(buffer), num_bytes),
+        &num_bytes_consumed);
+    EndReadDataRaw(receiver_.get(), static_cast<uint32_t>(num_bytes_consumed));
+
+    if (parse_result == HttpRequestParser::CONTENT_PIPE_FULL) {
+      // Leave the rest in the pipe until the handler reads some content.
+      content_waiter_.reset(new mojo::AsyncWaiter(
+          request_parser_.content_producer(), MOJO_HANDLE_SIGNAL_WRITABLE,
+          base::Bind(&Connection::OnContentPipeReady,
+                     base::Unretained(this))));
+      break;
+    }
+    if (parse_result == HttpRequestParser::PARSE_ERROR) {
+      close_after_responses_ = true;
+      break;
+    }
+    if (parse_result != HttpRequestParser::ACCEPTED)
+      continue;
+
+    const bool keep_alive = request_parser_.ShouldKeepAlive();
+    const uint32_t request_id = next_request_id_++;
+    pending_responses_.push_back(new PendingResponse(request_id, keep_alive));
+    if (!keep_alive)
+      close_after_responses_ = true;
+
+    // The request may be responded to (and |this| deleted) synchronously.
+    handle_request_callback_.Run(this, request_id,
+                                 request_parser_.GetRequest());
+    if (!self)
+      return;
+  }
+
+  if ((close_after_responses_ || receiver_closed_) &&
+      !request_parser_.IsParsingContent()) {
+    // No more requests will come.
+    if (pending_responses_.empty())
+      delete this;
+    return;
+  }
+
+  if (wait_for_data) {
+    if (!request_waiter_)
+      WaitForRequestData();
+  } else {
+    request_waiter_.reset();
+  }
+
+  // Only the connections that are waiting for the client time out.
+  if (pending_responses_.empty()) {
+    idle_timer_.Start(FROM_HERE,
+                      base::TimeDelta::FromSeconds(kIdleTimeoutSeconds), this,
+                      &Connection::OnIdleTimeout);
+  } else {
+    idle_timer_.Stop();
+  }
 }
 
-void Connection::SendResponse(HttpResponsePtr response) {
+void Connection::WriteNextResponse() {
+  if (writing_response_ || pending_responses_.empty() ||
+      !pending_responses_.front()->response) {
+    return;
+  }
+  writing_response_ = true;
+  HttpResponsePtr response = pending_responses_.front()->response.Pass();
   std::string http_reason_phrase(GetHttpReasonPhrase(response->status_code));
 
   // TODO: should we send http/1.0 for http/1.0.requests?
   base::StringAppendF(&response_, "HTTP/1.1 %d %s\r\n", response->status_code,
                       http_reason_phrase.c_str());
-  base::StringAppendF(&response_, "Connection: close\r\n");
+  base::StringAppendF(
+      &response_, "Connection: %s\r\n",
+      pending_responses_.front()->keep_alive ? "keep-alive" : "close");
 
+  // The length is always sent so that the client can find the end of the
+  // response without the connection being closed.
   content_length_ = response->content_length;
-  if (content_length_) {
-    base::StringAppendF(&response_, "Content-Length: %" PRIuS "\r\n",
-                        static_cast<size_t>(content_length_));
-  }
+  base::StringAppendF(&response_, "Content-Length: %" PRIuS "\r\n",
+                      static_cast<size_t>(content_length_));
   base::StringAppendF(&response_, "Content-Type: %s\r\n",
                       response->content_type.data());
   for (auto it = response->custom_headers.begin();
@@ -78,24 +223,6 @@ void Connection::SendResponse(HttpResponsePtr response) {
   WriteMore();
 }
 
-void Connection::OnRequestDataReady(MojoResult result) {
-  uint32_t num_bytes = 0;
-  result =
-      ReadDataRaw(receiver_.get(), NULL, &num_bytes, MOJO_READ_DATA_FLAG_QUERY);
-  if (!num_bytes)
-    return;
-
-  scoped_ptr<uint8_t[]> buffer(new uint8_t[num_bytes]);
-  result = ReadDataRaw(receiver_.get(), buffer.get(), &num_bytes,
-                       MOJO_READ_DATA_FLAG_ALL_OR_NONE);
-
-  request_parser_.ProcessChunk(
-      base::StringPiece(reinterpret_cast<char*>(buffer.get()), num_bytes));
-  if (request_parser_.ParseRequest() == HttpRequestParser::ACCEPTED) {
-    handle_request_callback_.Run(this, request_parser_.GetRequest());
-  }
-}
-
 void Connection::WriteMore() {
   uint32_t response_bytes_available =
       static_cast<uint32_t>(response_.size() - response_offset_);
@@ -127,7 +254,7 @@ void Connection::WriteMore() {
 
   // response_ is all sent, and there's no more data so we're done.
   if (!content_length_) {
-    delete this;
+    OnResponseSent();
     return;
   }
 
@@ -160,6 +287,27 @@ void Connection::WriteMore() {
       base::Bind(&Connection::OnSenderReady, base::Unretained(this))));
 }
 
+void Connection::OnResponseSent() {
+  const bool keep_alive = pending_responses_.front()->keep_alive;
+  pending_responses_.erase(pending_responses_.begin());
+  writing_response_ = false;
+  response_.clear();
+  response_offset_ = 0;
+  content_.reset();
+
+  if (!keep_alive) {
+    delete this;
+    return;
+  }
+
+  base::WeakPtr<Connection> self(weak_ptr_factory_.GetWeakPtr());
+  WriteNextResponse();
+  if (!self)
+    return;
+  // There is room for more requests now.
+  ReadRequests();
+}
+
 void Connection::OnResponseDataReady(MojoResult result) {
   if (result != MOJO_RESULT_OK) {
     LOG(ERROR) << "Error waiting to read data " << result;
@@ -178,4 +326,17 @@ void Connection::OnSenderReady(MojoResult result) {
   WriteMore();
 }
 
+void Connection::OnIdleTimeout() {
+  DCHECK(pending_responses_.empty());
+  delete this;
+}
+
+Connection::PendingResponse::PendingResponse(uint32_t request_id,
+                                             bool keep_alive)
+    : request_id(request_id), keep_alive(keep_alive) {
+}
+
+Connection::PendingResponse::~PendingResponse() {
+}
+
 }  // namespace http_server
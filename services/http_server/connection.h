@@ -7,6 +7,9 @@
 
 #include "base/callback.h"
 #include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/memory/weak_ptr.h"
+#include "base/timer/timer.h"
 #include "mojo/public/cpp/environment/async_waiter.h"
 #include "mojo/public/cpp/system/data_pipe.h"
 #include "mojo/services/http_server/public/interfaces/http_request.mojom.h"
@@ -18,37 +21,88 @@ namespace http_server {
 
 // Represents one connection to a client. This connection will manage its own
 // lifetime and will delete itself when the connection is closed.
+//
+// Connections are persistent (unless the client asks otherwise or uses
+// HTTP/1.0), and requests can be pipelined: the next requests are parsed and
+// handled while the response to the previous one is pending, and the responses
+// are sent in the order of the requests. A connection that has no request in
+// progress is closed after a while.
 class Connection {
  public:
   // Callback called when a request is parsed. Response should be sent
-  // using Connection::SendResponse() on the |connection| argument.
-  typedef base::Callback<void(Connection*, HttpRequestPtr)> Callback;
+  // using Connection::SendResponse() on the |connection| argument, with the
+  // same |request_id|.
+  typedef base::Callback<void(Connection*, uint32_t, HttpRequestPtr)> Callback;
 
+  // |closed_callback| is called when the connection is deleted.
   Connection(mojo::TCPConnectedSocketPtr conn,
              mojo::ScopedDataPipeProducerHandle sender,
              mojo::ScopedDataPipeConsumerHandle receiver,
-             const Callback& callback);
+             const Callback& callback,
+             const base::Closure& closed_callback);
 
   ~Connection();
 
-  void SendResponse(HttpResponsePtr response);
+  void SendResponse(uint32_t request_id, HttpResponsePtr response);
+
+  base::WeakPtr<Connection> GetWeakPtr();
 
  private:
+  // A request that was handed to the handler and still has to be responded
+  // to.
+  struct PendingResponse {
+    PendingResponse(uint32_t request_id, bool keep_alive);
+    ~PendingResponse();
+
+    const uint32_t request_id;
+    // Whether the connection is kept open after this response.
+    const bool keep_alive;
+    // Null until the handler has responded.
+    HttpResponsePtr response;
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(PendingResponse);
+  };
+
+  void WaitForRequestData();
+
   // Called when we have more data available from the request.
   void OnRequestDataReady(MojoResult result);
 
+  // Called when the handler has read some of the request content, so that more
+  // of it can be written to the body pipe.
+  void OnContentPipeReady(MojoResult result);
+
+  // Reads and handles the requests that have been received so far, and then
+  // waits for more data if more requests can be accepted on the connection.
+  // The data is parsed directly in the buffers of the pipe, without copying.
+  // This may delete |this|.
+  void ReadRequests();
+
+  // Starts sending the response at the front of |pending_responses_| if it is
+  // ready and no other response is being sent.
+  void WriteNextResponse();
+
   void WriteMore();
 
+  // Called when the response at the front of |pending_responses_| is sent.
+  void OnResponseSent();
+
   void OnResponseDataReady(MojoResult result);
 
   void OnSenderReady(MojoResult result);
 
+  void OnIdleTimeout();
+
   mojo::TCPConnectedSocketPtr connection_;
   mojo::ScopedDataPipeProducerHandle sender_;
   mojo::ScopedDataPipeConsumerHandle receiver_;
 
-  // Used to wait for the request data.
-  mojo::AsyncWaiter request_waiter_;
+  // Used to wait for the request data. Null when we aren't waiting for it.
+  scoped_ptr<mojo::AsyncWaiter> request_waiter_;
+
+  // Used to wait for room in the body pipe of the request being read.
+  scoped_ptr<mojo::AsyncWaiter> content_waiter_;
 
   int content_length_;
   mojo::ScopedDataPipeConsumerHandle content_;
@@ -64,10 +118,35 @@ class Connection {
   // Callback to run once all of the request has been read.
   const Callback handle_request_callback_;
 
+  const base::Closure closed_callback_;
+
+  uint32_t next_request_id_;
+
+  // The requests that haven't been responded to yet, in order.
+  ScopedVector<PendingResponse> pending_responses_;
+
+  // Whether the response at the front of |pending_responses_| is being sent.
+  bool writing_response_;
+
+  // Whether the client closed its side of the connection. The requests that
+  // were already received are still handled.
+  bool receiver_closed_;
+
+  // Set when the last request wasn't keep-alive (or couldn't be parsed): no
+  // more requests are handled, and the connection is closed once the pending
+  // ones are responded to.
+  bool close_after_responses_;
+
   // Contains response data to write to the pipe. Initially it is the headers,
   // and then when they're written it contains chunks of the body.
   std::string response_;
   size_t response_offset_;
+
+  base::OneShotTimer<Connection> idle_timer_;
+
+  base::WeakPtrFactory<Connection> weak_ptr_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(Connection);
 };
 
 }  // namespace http_server
@@ -16,7 +16,8 @@ namespace http_server {
 
 namespace {
 
-size_t kRequestSizeLimit = 64 * 1024 * 1024;  // 64 mb.
+// The maximum size of the request line and headers of a request.
+const size_t kMaxHeadersSize = 64 * 1024;
 
 // Helper function used to trim tokens in http request headers.
 std::string Trim(const std::string& value) {
@@ -29,162 +30,212 @@ std::string Trim(const std::string& value) {
 
 HttpRequestParser::HttpRequestParser()
     : http_request_(HttpRequest::New()),
-      buffer_position_(0),
-      state_(STATE_HEADERS),
-      remaining_content_bytes_(0) {
+      headers_size_(0),
+      state_(STATE_REQUEST_LINE),
+      remaining_content_bytes_(0),
+      keep_alive_(false) {
 }
 
 HttpRequestParser::~HttpRequestParser() {
 }
 
-void HttpRequestParser::ProcessChunk(const base::StringPiece& data) {
-  data.AppendToString(&buffer_);
-  DCHECK_LE(buffer_.size() + data.size(), kRequestSizeLimit) <<
-      "The HTTP request is too large.";
-}
-
-std::string HttpRequestParser::ShiftLine() {
-  size_t eoln_position = buffer_.find("\r\n", buffer_position_);
-  DCHECK_NE(std::string::npos, eoln_position);
-  const int line_length = eoln_position - buffer_position_;
-  std::string result = buffer_.substr(buffer_position_, line_length);
-  buffer_position_ += line_length + 2;
-  return result;
-}
-
-HttpRequestParser::ParseResult HttpRequestParser::ParseRequest() {
+HttpRequestParser::ParseResult HttpRequestParser::Parse(
+    const base::StringPiece& data,
+    size_t* num_bytes_consumed) {
   DCHECK_NE(STATE_ACCEPTED, state_);
-  // Parse the request from beginning. However, entire request may not be
-  // available in the buffer.
-  if (state_ == STATE_HEADERS) {
-    ParseResult parse_result = ParseHeaders();
-    if (parse_result == ACCEPTED || parse_result == PARSE_ERROR)
-      return parse_result;
-  }
-  // This should not be 'else if' of the previous block, as |state_| can be
-  // changed in ParseHeaders().
-  if (state_ == STATE_CONTENT) {
-    if (ParseContent() == ACCEPTED)
+  *num_bytes_consumed = 0;
+  if (state_ == STATE_ERROR)
+    return PARSE_ERROR;
+  if (state_ == STATE_CONTENT)
+    return ParseContent(data, num_bytes_consumed);
+
+  // Parse the request line and the headers, line by line.
+  size_t position = 0;
+  while (position < data.size()) {
+    size_t eoln_position = data.find('\n', position);
+    size_t line_end =
+        eoln_position == base::StringPiece::npos ? data.size() : eoln_position;
+    headers_size_ += line_end - position;
+    if (headers_size_ > kMaxHeadersSize) {
+      LOG(ERROR) << "The HTTP request headers are too large.";
+      state_ = STATE_ERROR;
+      return PARSE_ERROR;
+    }
+    if (eoln_position == base::StringPiece::npos) {
+      // Keep the beginning of the line until the rest of it arrives.
+      data.substr(position).AppendToString(&partial_line_);
+      *num_bytes_consumed = data.size();
+      return WAITING;
+    }
+
+    std::string line;
+    line.swap(partial_line_);
+    data.substr(position, line_end - position).AppendToString(&line);
+    position = eoln_position + 1;
+    *num_bytes_consumed = position;
+    // Lines should end with \r\n, but a bare \n is accepted too.
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.resize(line.size() - 1);
+
+    const bool success = state_ == STATE_REQUEST_LINE
+                             ? ParseRequestLine(line)
+                             : ParseHeaderLine(line);
+    if (!success) {
+      state_ = STATE_ERROR;
+      return PARSE_ERROR;
+    }
+    if (state_ == STATE_ACCEPTED)
       return ACCEPTED;
   }
   return WAITING;
 }
 
-HttpRequestParser::ParseResult HttpRequestParser::ParseHeaders() {
-  // Check if the all request headers are available.
-  if (buffer_.find("\r\n\r\n", buffer_position_) == std::string::npos)
-    return WAITING;
+bool HttpRequestParser::ParseRequestLine(const std::string& line) {
+  // Empty lines before a request are ignored (RFC 7230, section 3.5).
+  if (line.empty())
+    return true;
 
-  // Parse request's the first header line.
   // Request main main header, eg. GET /foobar.html HTTP/1.1
-  {
-    const std::string header_line = ShiftLine();
-    std::vector<std::string> header_line_tokens;
-    base::SplitString(header_line, ' ', &header_line_tokens);
-    DCHECK_EQ(3u, header_line_tokens.size());
-    // Method.
-    http_request_->method = header_line_tokens[0];
-    // Address.
-    // Don't build an absolute URL as the parser does not know (should not
-    // know) anything about the server address.
-    http_request_->relative_url = header_line_tokens[1];
-    // Protocol.
-    const std::string protocol =
-        base::StringToLowerASCII(header_line_tokens[2]);
-    CHECK(protocol == "http/1.0" || protocol == "http/1.1") <<
-        "Protocol not supported: " << protocol;
+  std::vector<std::string> tokens;
+  base::SplitString(line, ' ', &tokens);
+  if (tokens.size() != 3u) {
+    LOG(ERROR) << "Malformed request line: " << line;
+    return false;
+  }
+  // Method.
+  http_request_->method = tokens[0];
+  // Address.
+  // Don't build an absolute URL as the parser does not know (should not
+  // know) anything about the server address.
+  http_request_->relative_url = tokens[1];
+  // Protocol.
+  const std::string protocol = base::StringToLowerASCII(tokens[2]);
+  if (protocol != "http/1.0" && protocol != "http/1.1") {
+    LOG(ERROR) << "Protocol not supported: " << protocol;
+    return false;
+  }
+  // HTTP/1.1 connections are persistent by default, HTTP/1.0 ones aren't.
+  keep_alive_ = protocol == "http/1.1";
+  state_ = STATE_HEADERS;
+  return true;
+}
+
+bool HttpRequestParser::ParseHeaderLine(const std::string& line) {
+  if (line.empty())
+    return OnHeadersComplete();
+
+  if (line[0] == ' ' || line[0] == '\t') {
+    // Continuation of the previous multi-line header.
+    if (last_header_name_.empty()) {
+      LOG(ERROR) << "Continuation line without a header.";
+      return false;
+    }
+    std::string header_value = Trim(line.substr(1, line.size() - 1));
+    std::string old_value = http_request_->headers[last_header_name_];
+    http_request_->headers[last_header_name_] = old_value + " " + header_value;
+    return true;
+  }
+
+  // New header.
+  size_t delimiter_pos = line.find(":");
+  if (delimiter_pos == std::string::npos) {
+    LOG(ERROR) << "Malformed header: " << line;
+    return false;
   }
+  last_header_name_ = Trim(line.substr(0, delimiter_pos));
+  http_request_->headers[last_header_name_] =
+      Trim(line.substr(delimiter_pos + 1, line.size() - delimiter_pos - 1));
+  return true;
+}
 
-  // Parse further headers.
-  {
-    std::string header_name;
-    while (true) {
-      std::string header_line = ShiftLine();
-      if (header_line.empty())
-        break;
-
-      if (header_line[0] == ' ' || header_line[0] == '\t') {
-        // Continuation of the previous multi-line header.
-        std::string header_value =
-            Trim(header_line.substr(1, header_line.size() - 1));
-        std::string old_value = http_request_->headers[header_name];
-        http_request_->headers[header_name] = old_value + " " + header_value;
-      } else {
-        // New header.
-        size_t delimiter_pos = header_line.find(":");
-        DCHECK_NE(std::string::npos, delimiter_pos) << "Syntax error.";
-        header_name = Trim(header_line.substr(0, delimiter_pos));
-        std::string header_value = Trim(header_line.substr(
-            delimiter_pos + 1,
-            header_line.size() - delimiter_pos - 1));
-        http_request_->headers[header_name] = header_value;
-      }
+bool HttpRequestParser::OnHeadersComplete() {
+  // The "Connection" header overrides the default for the protocol.
+  for (auto it = http_request_->headers.begin();
+       it != http_request_->headers.end(); ++it) {
+    if (!base::LowerCaseEqualsASCII(it.GetKey().To<std::string>(),
+                                    "connection")) {
+      continue;
     }
+    const std::string& value = it.GetValue();
+    if (base::LowerCaseEqualsASCII(value, "close"))
+      keep_alive_ = false;
+    else if (base::LowerCaseEqualsASCII(value, "keep-alive"))
+      keep_alive_ = true;
   }
 
-  // Headers done. Is any content data attached to the request?
+  // Is any content data attached to the request?
   size_t declared_content_length = 0;
   if (http_request_->headers.find("Content-Length") !=
       http_request_->headers.end()) {
-    const bool success = base::StringToSizeT(
-        http_request_->headers["Content-Length"].To<std::string>(),
-        &declared_content_length);
-    DCHECK(success) << "Malformed Content-Length header's value.";
-  }
-  if (declared_content_length == 0) {
-    // No content data, so parsing is finished.
-    state_ = STATE_ACCEPTED;
-    return ACCEPTED;
+    if (!base::StringToSizeT(
+            http_request_->headers["Content-Length"].To<std::string>(),
+            &declared_content_length)) {
+      LOG(ERROR) << "Malformed Content-Length header's value.";
+      return false;
+    }
   }
+  remaining_content_bytes_ = declared_content_length;
 
-  // If we ever want to support really large content length (currently pipe max
-  // 256 MB), then we'll have to stream data from parser to handler.
-  MojoCreateDataPipeOptions options = {sizeof(MojoCreateDataPipeOptions),
-                                       MOJO_CREATE_DATA_PIPE_OPTIONS_FLAG_NONE,
-                                       1,
-                                       declared_content_length};
-  MojoResult result = CreateDataPipe(
-      &options, &producer_handle_, &http_request_->body);
-  if (result != MOJO_RESULT_OK) {
-    NOTREACHED() << "Couldn't create data pipe of size "
-                 << declared_content_length;
-    return PARSE_ERROR;
+  if (declared_content_length) {
+    // The content is streamed to the handler through the pipe as it arrives,
+    // so its size isn't bounded by the capacity of the pipe.
+    MojoResult result =
+        CreateDataPipe(nullptr, &content_producer_, &http_request_->body);
+    if (result != MOJO_RESULT_OK) {
+      LOG(ERROR) << "Couldn't create data pipe " << result;
+      return false;
+    }
   }
 
-  // The request has not yet been parsed yet, content data is still to be
-  // processed.
-  remaining_content_bytes_ = declared_content_length;
-  state_ = STATE_CONTENT;
-  return WAITING;
+  state_ = STATE_ACCEPTED;
+  return true;
 }
 
-HttpRequestParser::ParseResult HttpRequestParser::ParseContent() {
-  // Bytes available for read in the input buffer.
-  const size_t available_bytes = buffer_.size() - buffer_position_;
-  uint32_t fetch_bytes = std::min(available_bytes, remaining_content_bytes_);
-
-  MojoResult result = WriteDataRaw(
-      producer_handle_.get(),
-      buffer_.data() + buffer_position_,
-      &fetch_bytes,
-      MOJO_WRITE_DATA_FLAG_ALL_OR_NONE);
-  DCHECK_EQ(result, MOJO_RESULT_OK);
-  buffer_position_ += fetch_bytes;
-  remaining_content_bytes_ -= fetch_bytes;
-
-  if (remaining_content_bytes_ == 0) {
-    state_ = STATE_ACCEPTED;
-    producer_handle_.reset();
-    return ACCEPTED;
+HttpRequestParser::ParseResult HttpRequestParser::ParseContent(
+    const base::StringPiece& data,
+    size_t* num_bytes_consumed) {
+  uint32_t num_bytes = static_cast<uint32_t>(
+      std::min(static_cast<size_t>(data.size()), remaining_content_bytes_));
+  if (num_bytes) {
+    MojoResult result = WriteDataRaw(content_producer_.get(), data.data(),
+                                     &num_bytes, MOJO_WRITE_DATA_FLAG_NONE);
+    if (result == MOJO_RESULT_SHOULD_WAIT)
+      return CONTENT_PIPE_FULL;
+    // If the handler doesn't want the content (it closed the pipe), the rest
+    // of it is skipped.
+    if (result != MOJO_RESULT_OK)
+      content_producer_.reset();
   }
+  *num_bytes_consumed = num_bytes;
+  remaining_content_bytes_ -= num_bytes;
 
-  state_ = STATE_CONTENT;
+  if (remaining_content_bytes_ == 0)
+    Reset();
   return WAITING;
 }
 
 HttpRequestPtr HttpRequestParser::GetRequest() {
   DCHECK_EQ(STATE_ACCEPTED, state_);
-  return http_request_.Pass();
+  HttpRequestPtr request = http_request_.Pass();
+  if (remaining_content_bytes_)
+    state_ = STATE_CONTENT;
+  else
+    Reset();
+  return request.Pass();
+}
+
+bool HttpRequestParser::ShouldKeepAlive() const {
+  DCHECK_EQ(STATE_ACCEPTED, state_);
+  return keep_alive_;
+}
+
+void HttpRequestParser::Reset() {
+  http_request_ = HttpRequest::New();
+  content_producer_.reset();
+  headers_size_ = 0;
+  last_header_name_.clear();
+  state_ = STATE_REQUEST_LINE;
+  remaining_content_bytes_ = 0;
 }
 
 }  // namespace http_server
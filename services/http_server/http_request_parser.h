@@ -10,64 +10,105 @@
 
 #include "base/basictypes.h"
 #include "base/strings/string_piece.h"
+#include "mojo/public/cpp/system/data_pipe.h"
 #include "mojo/services/http_server/public/interfaces/http_request.mojom.h"
 
 namespace http_server {
 
-// Parses the input data and produces a valid HttpRequest object. If there is
-// more than one request in one chunk, then only the first one will be parsed.
+// Parses the data received on a connection and produces valid HttpRequest
+// objects. The data is parsed incrementally as it arrives, directly from the
+// caller's buffers (typically those of two-phase reads): the parser only keeps
+// a copy of a header line split across two buffers, and nothing of the content.
+//
+// A request is produced as soon as its headers are parsed; its content is
+// then streamed to the data pipe of HttpRequest::body as it is parsed. Once the
+// content is all written, the parser moves on to the next (pipelined) request.
 class HttpRequestParser {
  public:
   // Parsing result.
   enum ParseResult {
-    WAITING,  // A request is not completed yet, waiting for more data.
-    ACCEPTED,  // A request has been parsed and it is ready to be processed.
-    PARSE_ERROR,  // There was an error parsing the request.
+    // More data is needed. Parse() should be called again with the data that
+    // wasn't consumed, if any, and then with the next data received.
+    WAITING,
+    // The headers of a request have been parsed and it is ready to be
+    // processed. GetRequest() should be called before parsing more data.
+    ACCEPTED,
+    // The request content can't be written as the body data pipe is full.
+    // Parse() should be called again once content_producer() is writable.
+    CONTENT_PIPE_FULL,
+    // There was an error parsing the request. No more data can be parsed.
+    PARSE_ERROR,
   };
 
   HttpRequestParser();
   ~HttpRequestParser();
 
-  // Adds chunk of data into the internal buffer.
-  void ProcessChunk(const base::StringPiece& data);
-
-  // Parses the http request (including data - if provided).
-  // If returns ACCEPTED, then it means that the whole request has been found
-  // in the internal buffer (and parsed).
-  ParseResult ParseRequest();
+  // Parses |data| and sets |num_bytes_consumed| to the number of bytes of it
+  // that were used. This stops after the headers of each request, after the
+  // content of each request, and when the body data pipe is full (so that not
+  // all of |data| may be consumed, even if WAITING is returned).
+  ParseResult Parse(const base::StringPiece& data, size_t* num_bytes_consumed);
 
   // Retrieves parsed request. Can be only called when the parser is in
-  // STATE_ACCEPTED state.
+  // STATE_ACCEPTED state. Afterwards, the parser is ready to parse the content
+  // of the request, if any, and then the next request.
   HttpRequestPtr GetRequest();
 
+  // Returns whether the connection should be kept open after responding to the
+  // parsed request, according to its HTTP version and "Connection" header. Can
+  // be only called when the parser is in STATE_ACCEPTED state.
+  bool ShouldKeepAlive() const;
+
+  // Whether the content of the last request is being parsed.
+  bool IsParsingContent() const { return state_ == STATE_CONTENT; }
+
+  // The producer of the body of the last request. Only valid when parsing its
+  // content.
+  mojo::DataPipeProducerHandle content_producer() const {
+    return content_producer_.get();
+  }
+
  private:
   // Parser state.
   enum State {
+    STATE_REQUEST_LINE,  // Waiting for the request line.
     STATE_HEADERS,  // Waiting for a request headers.
+    STATE_ACCEPTED,  // Request headers have been parsed.
     STATE_CONTENT,  // Waiting for content data.
-    STATE_ACCEPTED,  // Request has been parsed.
+    STATE_ERROR,  // The data couldn't be parsed.
   };
 
-  // Parses headers and returns ACCEPTED if whole request was parsed. Otherwise
-  // returns WAITING.
-  ParseResult ParseHeaders();
+  // Parses the request line (eg. GET /foobar.html HTTP/1.1). Returns false if
+  // it is malformed.
+  bool ParseRequestLine(const std::string& line);
+
+  // Parses a header line, or the empty line ending the headers. Returns false
+  // if it is malformed.
+  bool ParseHeaderLine(const std::string& line);
+
+  // Handles the end of the headers: prepares for the content, if any.
+  bool OnHeadersComplete();
 
-  // Parses request's content data and returns ACCEPTED if all of it have been
-  // processed. Chunked Transfer Encoding *is not* supported.
-  ParseResult ParseContent();
+  // Writes as much of |data| as possible to the body of the request and sets
+  // |num_bytes_consumed| accordingly.
+  ParseResult ParseContent(const base::StringPiece& data,
+                           size_t* num_bytes_consumed);
 
-  // Fetches the next line from the buffer. Result does not contain \r\n.
-  // Returns an empty string for an empty line. It will assert if there is
-  // no line available.
-  std::string ShiftLine();
+  // Gets ready for the next request.
+  void Reset();
 
   HttpRequestPtr http_request_;
-  mojo::ScopedDataPipeProducerHandle producer_handle_;
-  std::string buffer_;
-  size_t buffer_position_;  // Current position in the internal buffer.
+  mojo::ScopedDataPipeProducerHandle content_producer_;
+  // The beginning of a line that was split between two chunks of data.
+  std::string partial_line_;
+  // The total size of the request line and headers received so far.
+  size_t headers_size_;
+  // The name of the last header, for multi-line headers.
+  std::string last_header_name_;
   State state_;
   // Remaining bytes of the request content not yet put onto request->body.
   size_t remaining_content_bytes_;
+  bool keep_alive_;
 
   DISALLOW_COPY_AND_ASSIGN(HttpRequestParser);
 };
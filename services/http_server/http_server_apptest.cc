@@ -128,14 +128,19 @@ http_server::HttpServerPtr HttpServerApplicationTest::CreateHttpServer() {
   return http_server.Pass();
 }
 
-void CheckServerResponse(mojo::URLResponsePtr response) {
+void CheckServerResponseBody(const std::string& expected_body,
+                             mojo::URLResponsePtr response) {
   EXPECT_EQ(200u, response->status_code);
   std::string response_body;
   mojo::common::BlockingCopyToString(response->body.Pass(), &response_body);
-  EXPECT_EQ(kExampleMessage, response_body);
+  EXPECT_EQ(expected_body, response_body);
   base::MessageLoop::current()->Quit();
 }
 
+void CheckServerResponse(mojo::URLResponsePtr response) {
+  CheckServerResponseBody(kExampleMessage, response.Pass());
+}
+
 // Verifies that the server responds to http GET requests using example
 // GetHandler.
 TEST_F(HttpServerApplicationTest, ServerResponse) {
@@ -194,4 +199,40 @@ TEST_F(HttpServerApplicationTest, PostData) {
   run_loop.Run();
 }
 
+// Verifies that a POST request payload larger than the capacity of a data pipe
+// is streamed to the handler.
+TEST_F(HttpServerApplicationTest, PostLargeData) {
+  http_server::HttpServerPtr http_server(CreateHttpServer());
+  uint16_t assigned_port;
+  http_server->GetPort([&assigned_port](uint16_t p) { assigned_port = p; });
+  http_server.WaitForIncomingResponse();
+
+  HttpHandlerPtr http_handler_ptr;
+  PostHandler handler(GetProxy(&http_handler_ptr).Pass());
+
+  // Set the test handler and wait for confirmation.
+  http_server->SetHandler("/post", http_handler_ptr.Pass(),
+                          [](bool result) { EXPECT_TRUE(result); });
+  http_server.WaitForIncomingResponse();
+
+  mojo::URLLoaderPtr url_loader;
+  network_service_->CreateURLLoader(GetProxy(&url_loader));
+
+  std::string message;
+  for (size_t i = 0; i < 4 * 1024 * 1024; i++)
+    message += static_cast<char>('a' + i % 26);
+
+  mojo::URLRequestPtr url_request = mojo::URLRequest::New();
+  url_request->url =
+      base::StringPrintf("http://127.0.0.1:%u/post", assigned_port);
+  url_request->method = "POST";
+  url_request->body.resize(1);
+  WriteMessageToDataPipe(message, &url_request->body[0]);
+
+  url_loader->Start(url_request.Pass(),
+                    base::Bind(&CheckServerResponseBody, message));
+  base::RunLoop run_loop;
+  run_loop.Run();
+}
+
 }  // namespace http_server
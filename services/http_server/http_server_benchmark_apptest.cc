@@ -0,0 +1,346 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Measures the throughput of the http server for small requests, sent from a
+// raw TCP connection: with a new connection for each request, with persistent
+// connections, and with pipelined requests. The number of connections used
+// is reported too, to check that they are reused.
+
+#include <algorithm>
+#include <string>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "base/time/time.h"
+#include "mojo/public/cpp/application/application_impl.h"
+#include "mojo/public/cpp/application/application_test_base.h"
+#include "mojo/public/cpp/bindings/binding.h"
+#include "mojo/public/cpp/environment/async_waiter.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "mojo/public/cpp/system/macros.h"
+#include "mojo/services/http_server/public/cpp/http_server_util.h"
+#include "mojo/services/http_server/public/interfaces/http_server.mojom.h"
+#include "mojo/services/http_server/public/interfaces/http_server_factory.mojom.h"
+#include "mojo/services/network/public/interfaces/net_address.mojom.h"
+#include "mojo/services/network/public/interfaces/network_service.mojom.h"
+#include "mojo/services/network/public/interfaces/tcp_bound_socket.mojom.h"
+#include "mojo/services/network/public/interfaces/tcp_connected_socket.mojom.h"
+#include "testing/perf/perf_test.h"
+
+namespace http_server {
+
+namespace {
+
+const char kExampleMessage[] = "Hello, world!";
+
+// The number of requests sent for each measurement.
+const size_t kNumRequests = 1000;
+
+// The number of requests sent at once when pipelining.
+const size_t kPipelineDepth = 16;
+
+mojo::NetAddressPtr CreateLocalAddress(uint16_t port) {
+  mojo::NetAddressPtr address(mojo::NetAddress::New());
+  address->family = mojo::NET_ADDRESS_FAMILY_IPV4;
+  address->ipv4 = mojo::NetAddressIPv4::New();
+  address->ipv4->addr.resize(4);
+  address->ipv4->addr[0] = 127;
+  address->ipv4->addr[1] = 0;
+  address->ipv4->addr[2] = 0;
+  address->ipv4->addr[3] = 1;
+  address->ipv4->port = port;
+  return address.Pass();
+}
+
+// Test handler that responds to all requests with the status OK and
+// kExampleMessage.
+class GetHandler : public HttpHandler {
+ public:
+  GetHandler(mojo::InterfaceRequest<HttpHandler> request)
+      : binding_(this, request.Pass()) {}
+  ~GetHandler() override {}
+
+ private:
+  // HttpHandler:
+  void HandleRequest(
+      HttpRequestPtr request,
+      const mojo::Callback<void(HttpResponsePtr)>& callback) override {
+    callback.Run(CreateHttpResponse(200, kExampleMessage));
+  }
+
+  mojo::Binding<HttpHandler> binding_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(GetHandler);
+};
+
+// A minimal http client, which writes requests to a TCP connection and reads
+// the responses synchronously. It opens a new connection whenever the server
+// has closed the previous one.
+class TestClient {
+ public:
+  TestClient(mojo::NetworkServicePtr* network_service, uint16_t port)
+      : network_service_(network_service), port_(port), num_connections_(0) {}
+  ~TestClient() {}
+
+  // Sends |num_requests| requests, |depth| at a time (that is, the client
+  // waits for the responses before sending more), and checks the responses.
+  // If |keep_alive| is false, the requests ask for the connection to be closed
+  // after the response. Returns false on failure.
+  bool SendRequests(size_t num_requests, size_t depth, bool keep_alive) {
+    std::string request = "GET /test HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+    if (!keep_alive)
+      request += "Connection: close\r\n";
+    request += "\r\n";
+
+    size_t num_sent = 0;
+    while (num_sent < num_requests) {
+      if (!socket_ && !Connect())
+        return false;
+
+      // Requests sent after one that closes the connection would be ignored.
+      size_t batch_size =
+          keep_alive ? std::min(depth, num_requests - num_sent) : 1;
+      std::string requests;
+      for (size_t i = 0; i < batch_size; i++)
+        requests += request;
+      if (!Write(requests))
+        return false;
+
+      for (size_t i = 0; i < batch_size; i++) {
+        bool connection_closed = false;
+        if (!ReadResponse(&connection_closed))
+          return false;
+        if (connection_closed) {
+          Disconnect();
+          if (i + 1 != batch_size)
+            return false;
+        }
+      }
+      num_sent += batch_size;
+    }
+    Disconnect();
+    return true;
+  }
+
+  size_t num_connections() const { return num_connections_; }
+
+ private:
+  bool Connect() {
+    mojo::NetAddressPtr any_address(CreateLocalAddress(0));
+    any_address->ipv4->addr[0] = 0;
+    mojo::TCPBoundSocketPtr bound_socket;
+    bool success = false;
+    (*network_service_)
+        ->CreateTCPBoundSocket(
+            any_address.Pass(), GetProxy(&bound_socket),
+            [&success](mojo::NetworkErrorPtr err,
+                       mojo::NetAddressPtr bound_address) {
+              success = err->code == 0;
+            });
+    if (!network_service_->WaitForIncomingResponse() || !success)
+      return false;
+
+    mojo::ScopedDataPipeConsumerHandle send_consumer;
+    mojo::ScopedDataPipeProducerHandle receive_producer;
+    if (CreateDataPipe(nullptr, &send_producer_, &send_consumer) !=
+            MOJO_RESULT_OK ||
+        CreateDataPipe(nullptr, &receive_producer, &receive_consumer_) !=
+            MOJO_RESULT_OK) {
+      return false;
+    }
+
+    bound_socket->Connect(CreateLocalAddress(port_), send_consumer.Pass(),
+                          receive_producer.Pass(), GetProxy(&socket_),
+                          [&success](mojo::NetworkErrorPtr err) {
+                            success = err->code == 0;
+                          });
+    if (!bound_socket.WaitForIncomingResponse() || !success)
+      return false;
+    num_connections_++;
+    return true;
+  }
+
+  void Disconnect() {
+    socket_.reset();
+    send_producer_.reset();
+    receive_consumer_.reset();
+    buffer_.clear();
+  }
+
+  // Waits for |handle| to satisfy |signals|. The message loop runs meanwhile,
+  // so that the handler (which lives in this application) can respond.
+  MojoResult WaitForSignals(mojo::Handle handle, MojoHandleSignals signals) {
+    MojoResult result = MOJO_RESULT_UNKNOWN;
+    base::RunLoop run_loop;
+    mojo::AsyncWaiter waiter(handle, signals,
+                             [&result, &run_loop](MojoResult r) {
+                               result = r;
+                               run_loop.Quit();
+                             });
+    run_loop.Run();
+    return result;
+  }
+
+  bool Write(const std::string& data) {
+    while (true) {
+      uint32_t num_bytes = static_cast<uint32_t>(data.size());
+      MojoResult result =
+          WriteDataRaw(send_producer_.get(), data.data(), &num_bytes,
+                       MOJO_WRITE_DATA_FLAG_ALL_OR_NONE);
+      if (result != MOJO_RESULT_SHOULD_WAIT &&
+          result != MOJO_RESULT_OUT_OF_RANGE) {
+        return result == MOJO_RESULT_OK;
+      }
+      if (WaitForSignals(send_producer_.get(), MOJO_HANDLE_SIGNAL_WRITABLE) !=
+          MOJO_RESULT_OK) {
+        return false;
+      }
+    }
+  }
+
+  // Appends the data available on the connection to |buffer_|, waiting for
+  // some if needed. Returns false if the connection is closed.
+  bool ReadMore() {
+    while (true) {
+      char data[4096];
+      uint32_t num_bytes = sizeof(data);
+      MojoResult result = ReadDataRaw(receive_consumer_.get(), data,
+                                      &num_bytes, MOJO_READ_DATA_FLAG_NONE);
+      if (result == MOJO_RESULT_OK) {
+        buffer_.append(data, num_bytes);
+        return true;
+      }
+      if (result != MOJO_RESULT_SHOULD_WAIT ||
+          WaitForSignals(receive_consumer_.get(),
+                         MOJO_HANDLE_SIGNAL_READABLE) != MOJO_RESULT_OK) {
+        return false;
+      }
+    }
+  }
+
+  // Reads one response and checks that it is the one sent by GetHandler. Sets
+  // |connection_closed| if the server closes the connection after it.
+  bool ReadResponse(bool* connection_closed) {
+    size_t headers_end;
+    while ((headers_end = buffer_.find("\r\n\r\n")) == std::string::npos) {
+      if (!ReadMore())
+        return false;
+    }
+    const std::string headers =
+        base::StringToLowerASCII(buffer_.substr(0, headers_end));
+    if (!StartsWithASCII(headers, "http/1.1 200 ", true))
+      return false;
+    *connection_closed =
+        headers.find("\r\nconnection: close") != std::string::npos;
+
+    const char kContentLength[] = "\r\ncontent-length: ";
+    size_t content_length = 0;
+    size_t content_length_pos = headers.find(kContentLength);
+    if (content_length_pos == std::string::npos)
+      return false;
+    content_length_pos += arraysize(kContentLength) - 1;
+    if (!base::StringToSizeT(
+            headers.substr(content_length_pos,
+                           headers.find("\r\n", content_length_pos) -
+                               content_length_pos),
+            &content_length)) {
+      return false;
+    }
+
+    const size_t body_start = headers_end + 4;
+    while (buffer_.size() < body_start + content_length) {
+      if (!ReadMore())
+        return false;
+    }
+    const bool body_ok =
+        buffer_.compare(body_start, content_length, kExampleMessage) == 0;
+    buffer_.erase(0, body_start + content_length);
+    return body_ok;
+  }
+
+  mojo::NetworkServicePtr* const network_service_;
+  const uint16_t port_;
+  size_t num_connections_;
+
+  mojo::TCPConnectedSocketPtr socket_;
+  mojo::ScopedDataPipeProducerHandle send_producer_;
+  mojo::ScopedDataPipeConsumerHandle receive_consumer_;
+  // Data received and not consumed yet.
+  std::string buffer_;
+
+  MOJO_DISALLOW_COPY_AND_ASSIGN(TestClient);
+};
+
+class HttpServerBenchmarkTest : public mojo::test::ApplicationTestBase {
+ public:
+  HttpServerBenchmarkTest() : ApplicationTestBase(), port_(0) {}
+  ~HttpServerBenchmarkTest() override {}
+
+ protected:
+  // ApplicationTestBase:
+  void SetUp() override {
+    ApplicationTestBase::SetUp();
+
+    application_impl()->ConnectToService("mojo:http_server",
+                                         &http_server_factory_);
+    application_impl()->ConnectToService("mojo:network_service",
+                                         &network_service_);
+
+    http_server_factory_->CreateHttpServer(GetProxy(&http_server_).Pass(),
+                                           CreateLocalAddress(0));
+    uint16_t* port = &port_;
+    http_server_->GetPort([port](uint16_t p) { *port = p; });
+    ASSERT_TRUE(http_server_.WaitForIncomingResponse());
+
+    HttpHandlerPtr http_handler_ptr;
+    handler_.reset(new GetHandler(GetProxy(&http_handler_ptr).Pass()));
+    http_server_->SetHandler("/test", http_handler_ptr.Pass(),
+                             [](bool result) { EXPECT_TRUE(result); });
+    ASSERT_TRUE(http_server_.WaitForIncomingResponse());
+  }
+
+  // Sends kNumRequests requests (see TestClient::SendRequests()), and logs
+  // the number of requests per second and the number of connections used.
+  // Returns the number of connections used.
+  size_t Measure(const std::string& trace, size_t depth, bool keep_alive) {
+    TestClient client(&network_service_, port_);
+    base::TimeTicks start_time = base::TimeTicks::Now();
+    EXPECT_TRUE(client.SendRequests(kNumRequests, depth, keep_alive));
+    base::TimeDelta elapsed = base::TimeTicks::Now() - start_time;
+
+    perf_test::PrintResult("http_server_throughput", "", trace,
+                           kNumRequests / elapsed.InSecondsF(), "requests/s",
+                           true);
+    perf_test::PrintResult("http_server_connections", "", trace,
+                           client.num_connections(), "connections", false);
+    return client.num_connections();
+  }
+
+  http_server::HttpServerFactoryPtr http_server_factory_;
+  mojo::NetworkServicePtr network_service_;
+  http_server::HttpServerPtr http_server_;
+  scoped_ptr<GetHandler> handler_;
+  uint16_t port_;
+
+ private:
+  MOJO_DISALLOW_COPY_AND_ASSIGN(HttpServerBenchmarkTest);
+};
+
+}  // namespace
+
+TEST_F(HttpServerBenchmarkTest, ConnectionPerRequest) {
+  EXPECT_EQ(kNumRequests, Measure("connection_per_request", 1, false));
+}
+
+TEST_F(HttpServerBenchmarkTest, KeepAlive) {
+  EXPECT_EQ(1u, Measure("keep_alive", 1, true));
+}
+
+TEST_F(HttpServerBenchmarkTest, Pipelined) {
+  EXPECT_EQ(1u, Measure("pipelined", kPipelineDepth, true));
+}
+
+}  // namespace http_server
@@ -13,6 +13,13 @@
 #include "services/http_server/http_server_factory_impl.h"
 
 namespace http_server {
+namespace {
+
+// The maximum number of connections open at once. Connections are persistent,
+// so this also bounds the number of idle ones.
+const size_t kMaxConnections = 256;
+
+}  // namespace
 
 HttpServerImpl::HttpServerImpl(mojo::ApplicationImpl* app,
                                HttpServerFactoryImpl* factory,
@@ -20,6 +27,7 @@ HttpServerImpl::HttpServerImpl(mojo::ApplicationImpl* app,
     : factory_(factory),
       requested_local_address_(requested_local_address.Pass()),
       assigned_port_(0),
+      num_connections_(0),
       weak_ptr_factory_(this) {
   app->ConnectToService("mojo:network_service", &network_service_);
   Start();
@@ -100,10 +108,15 @@ void HttpServerImpl::OnConnectionAccepted(mojo::NetworkErrorPtr err,
   new Connection(pending_connected_socket_.Pass(), pending_send_handle_.Pass(),
                  pending_receive_handle_.Pass(),
                  base::Bind(&HttpServerImpl::HandleRequest,
+                            weak_ptr_factory_.GetWeakPtr()),
+                 base::Bind(&HttpServerImpl::OnConnectionClosed,
                             weak_ptr_factory_.GetWeakPtr()));
+  num_connections_++;
 
-  // Ready for another connection.
-  WaitForNextConnection();
+  // Ready for another connection, unless there are too many already (in which
+  // case we wait for one to be closed).
+  if (num_connections_ < kMaxConnections)
+    WaitForNextConnection();
 }
 
 void HttpServerImpl::WaitForNextConnection() {
@@ -139,23 +152,36 @@ void HttpServerImpl::Start() {
   WaitForNextConnection();
 }
 
+void HttpServerImpl::OnConnectionClosed() {
+  DCHECK_GT(num_connections_, 0u);
+  // If we were at the limit, we stopped accepting connections.
+  if (num_connections_-- == kMaxConnections)
+    WaitForNextConnection();
+}
+
 void HttpServerImpl::HandleRequest(Connection* connection,
+                                   uint32_t request_id,
                                    HttpRequestPtr request) {
   for (auto& handler : handlers_) {
     if (RE2::FullMatch(request->relative_url.data(), *handler->pattern)) {
+      // The connection may be closed before the handler responds.
       handler->http_handler->HandleRequest(
-          request.Pass(), base::Bind(&HttpServerImpl::OnResponse,
-                                     base::Unretained(this), connection));
+          request.Pass(),
+          base::Bind(&HttpServerImpl::OnResponse, base::Unretained(this),
+                     connection->GetWeakPtr(), request_id));
       return;
     }
   }
 
-  connection->SendResponse(CreateHttpResponse(404, "No registered handler\n"));
+  connection->SendResponse(request_id,
+                           CreateHttpResponse(404, "No registered handler\n"));
 }
 
-void HttpServerImpl::OnResponse(Connection* connection,
+void HttpServerImpl::OnResponse(base::WeakPtr<Connection> connection,
+                                uint32_t request_id,
                                 HttpResponsePtr response) {
-  connection->SendResponse(response.Pass());
+  if (connection)
+    connection->SendResponse(request_id, response.Pass());
 }
 
 HttpServerImpl::Handler::Handler(const std::string& pattern,
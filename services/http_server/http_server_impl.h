@@ -65,9 +65,15 @@ class HttpServerImpl : public HttpServer {
 
   void Start();
 
-  void HandleRequest(Connection* connection, HttpRequestPtr request);
+  void OnConnectionClosed();
 
-  void OnResponse(Connection* connection, HttpResponsePtr response);
+  void HandleRequest(Connection* connection,
+                     uint32_t request_id,
+                     HttpRequestPtr request);
+
+  void OnResponse(base::WeakPtr<Connection> connection,
+                  uint32_t request_id,
+                  HttpResponsePtr response);
 
   HttpServerFactoryImpl* factory_;
 
@@ -85,6 +91,10 @@ class HttpServerImpl : public HttpServer {
   mojo::ScopedDataPipeConsumerHandle pending_receive_handle_;
   mojo::TCPConnectedSocketPtr pending_connected_socket_;
 
+  // The number of open connections. No new connections are accepted while
+  // there are too many.
+  size_t num_connections_;
+
   // TODO(vtl): Maybe this should be an std::set or unordered_set, which would
   // simplify OnHandlerConnectionError().
   ScopedVector<Handler> handlers_;
@@ -6,6 +6,7 @@
 
 #include "base/trace_event/trace_event.h"
 #include "cc/output/compositor_frame.h"
+#include "cc/output/delegated_frame_data.h"
 #include "cc/resources/returned_resource.h"
 #include "cc/surfaces/surface_id_allocator.h"
 #include "mojo/converters/geometry/geometry_type_converters.h"
@@ -20,6 +21,12 @@ namespace {
 void CallCallback(const mojo::Closure& callback, cc::SurfaceDrawStatus status) {
   callback.Run();
 }
+
+void CallFrameDeltaCallback(
+    const mojo::Surface::SubmitFrameDeltaCallback& callback,
+    cc::SurfaceDrawStatus status) {
+  callback.Run(true);
+}
 }
 
 SurfacesImpl::SurfacesImpl(cc::SurfaceManager* manager,
@@ -54,16 +61,45 @@ void SurfacesImpl::SubmitFrame(uint32_t local_id,
                                mojo::FramePtr frame,
                                const mojo::Closure& callback) {
   TRACE_EVENT0("mojo", "SurfacesImpl::SubmitFrame");
-  factory_.SubmitFrame(QualifyIdentifier(local_id),
-                       frame.To<scoped_ptr<cc::CompositorFrame>>(),
-                       base::Bind(&CallCallback, callback));
-  scheduler_->SetNeedsDraw();
+  SubmitCompositorFrame(local_id, frame.To<scoped_ptr<cc::CompositorFrame>>(),
+                        base::Bind(&CallCallback, callback));
+}
+
+void SurfacesImpl::SubmitFrameWithViews(uint32_t local_id,
+                                        mojo::FrameView frame,
+                                        const mojo::Closure& callback) {
+  TRACE_EVENT0("mojo", "SurfacesImpl::SubmitFrameWithViews");
+  SubmitCompositorFrame(
+      local_id, mojo::ConvertTo<scoped_ptr<cc::CompositorFrame>>(frame),
+      base::Bind(&CallCallback, callback));
 }
 
 void SurfacesImpl::DestroySurface(uint32_t local_id) {
+  delta_surfaces_.erase(local_id);
+  last_frame_passes_.erase(local_id);
   factory_.Destroy(QualifyIdentifier(local_id));
 }
 
+void SurfacesImpl::SubmitFrameDelta(
+    uint32_t local_id,
+    mojo::FrameDeltaPtr frame_delta,
+    const Surface::SubmitFrameDeltaCallback& callback) {
+  TRACE_EVENT0("mojo", "SurfacesImpl::SubmitFrameDelta");
+  // Start keeping this surface's frames. Until one has been kept, the delta
+  // only applies if it has the whole frame.
+  delta_surfaces_.insert(local_id);
+  const cc::RenderPassList no_passes;
+  const cc::RenderPassList* last_passes = last_frame_passes_.get(local_id);
+  scoped_ptr<cc::CompositorFrame> frame = mojo::ConvertFrameDelta(
+      frame_delta, last_passes ? *last_passes : no_passes);
+  if (!frame) {
+    callback.Run(false);
+    return;
+  }
+  SubmitCompositorFrame(local_id, frame.Pass(),
+                        base::Bind(&CallFrameDeltaCallback, callback));
+}
+
 void SurfacesImpl::ReturnResources(const cc::ReturnedResourceArray& resources) {
   if (resources.empty() || !returner_)
     return;
@@ -78,4 +114,20 @@ cc::SurfaceId SurfacesImpl::QualifyIdentifier(uint32_t local_id) {
   return cc::SurfaceId(static_cast<uint64_t>(id_namespace_) << 32 | local_id);
 }
 
+void SurfacesImpl::SubmitCompositorFrame(
+    uint32_t local_id,
+    scoped_ptr<cc::CompositorFrame> frame,
+    const cc::SurfaceFactory::DrawCallback& callback) {
+  if (frame && delta_surfaces_.count(local_id)) {
+    scoped_ptr<cc::RenderPassList> passes(new cc::RenderPassList);
+    cc::RenderPass::CopyAll(frame->delegated_frame_data->render_pass_list,
+                            passes.get());
+    last_frame_passes_.set(local_id, passes.Pass());
+  } else {
+    last_frame_passes_.erase(local_id);
+  }
+  factory_.SubmitFrame(QualifyIdentifier(local_id), frame.Pass(), callback);
+  scheduler_->SetNeedsDraw();
+}
+
 }  // namespace mojo
@@ -5,6 +5,10 @@
 #ifndef SERVICES_SURFACES_SURFACES_IMPL_H_
 #define SERVICES_SURFACES_SURFACES_IMPL_H_
 
+#include <set>
+
+#include "base/containers/scoped_ptr_hash_map.h"
+#include "cc/quads/render_pass.h"
 #include "cc/surfaces/display_client.h"
 #include "cc/surfaces/surface_factory.h"
 #include "cc/surfaces/surface_factory_client.h"
@@ -41,7 +45,14 @@ class SurfacesImpl : public mojo::Surface, public cc::SurfaceFactoryClient {
   void SubmitFrame(uint32_t local_id,
                    mojo::FramePtr frame,
                    const mojo::Closure& callback) override;
+  void SubmitFrameWithViews(uint32_t local_id,
+                            mojo::FrameView frame,
+                            const mojo::Closure& callback) override;
   void DestroySurface(uint32_t local_id) override;
+  void SubmitFrameDelta(
+      uint32_t local_id,
+      mojo::FrameDeltaPtr frame_delta,
+      const Surface::SubmitFrameDeltaCallback& callback) override;
 
   // SurfaceFactoryClient implementation.
   void ReturnResources(const cc::ReturnedResourceArray& resources) override;
@@ -51,12 +62,26 @@ class SurfacesImpl : public mojo::Surface, public cc::SurfaceFactoryClient {
  private:
   cc::SurfaceId QualifyIdentifier(uint32_t local_id);
 
+  // Submits |frame| to the surface, keeping a copy of its render passes for
+  // the next frame delta if the surface has been sent deltas.
+  void SubmitCompositorFrame(uint32_t local_id,
+                             scoped_ptr<cc::CompositorFrame> frame,
+                             const cc::SurfaceFactory::DrawCallback& callback);
+
   cc::SurfaceManager* manager_;
   cc::SurfaceFactory factory_;
   const uint32_t id_namespace_;
   SurfacesScheduler* scheduler_;
   mojo::ScopedMessagePipeHandle command_buffer_handle_;
   mojo::ResourceReturnerPtr returner_;
+  // The surfaces that have been sent a frame delta. Only these keep the render
+  // passes of their last frame, so that surfaces only ever given whole frames
+  // don't pay for copying them.
+  std::set<uint32_t> delta_surfaces_;
+  // The render passes of the last frame submitted to each surface in
+  // |delta_surfaces_|.
+  base::ScopedPtrHashMap<uint32_t, scoped_ptr<cc::RenderPassList>>
+      last_frame_passes_;
   mojo::StrongBinding<Surface> binding_;
 
   DISALLOW_COPY_AND_ASSIGN(SurfacesImpl);
@@ -23,7 +23,15 @@ mojo::Handle CollectorImpl::TraceDataCollectorHandle() const {
 }
 
 void CollectorImpl::DataCollected(const mojo::String& json) {
-  sink_->AddChunk(json.To<std::string>());
+  sink_->AddChunk(mojo::common::TRACE_CHUNK_JSON, json.get().data(),
+                  json.size());
+}
+
+void CollectorImpl::RecordsCollected(mojo::Array<uint8_t> records) {
+  if (records.size()) {
+    sink_->AddChunk(mojo::common::TRACE_CHUNK_RECORDS, &records.front(),
+                    records.size());
+  }
 }
 
 }  // namespace tracing
@@ -31,6 +31,7 @@ class CollectorImpl : public TraceDataCollector {
  private:
   // tracing::TraceDataCollector implementation.
   void DataCollected(const mojo::String& json) override;
+  void RecordsCollected(mojo::Array<uint8_t> records) override;
 
   TraceDataSink* sink_;
   mojo::Binding<TraceDataCollector> binding_;
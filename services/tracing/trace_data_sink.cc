@@ -4,28 +4,141 @@
 
 #include "services/tracing/trace_data_sink.h"
 
+#include "base/bind.h"
 #include "base/logging.h"
-#include "mojo/common/data_pipe_utils.h"
-
-using mojo::common::BlockingCopyFromString;
 
 namespace tracing {
 
+// static
+const size_t TraceDataSink::kMaxBufferedBytes;
+
 TraceDataSink::TraceDataSink(mojo::ScopedDataPipeProducerHandle pipe)
-    : pipe_(pipe.Pass()), empty_(true) {
+    : pipe_(pipe.Pass()),
+      closing_(false),
+      buffer_offset_(0),
+      buffered_bytes_(0),
+      num_dropped_chunks_(0),
+      watching_(false) {
 }
 
 TraceDataSink::~TraceDataSink() {
+  if (has_buffered_data()) {
+    LOG(WARNING) << "Discarding " << buffered_bytes_
+                 << " bytes of unwritten trace data";
+  }
+  if (num_dropped_chunks_) {
+    LOG(WARNING) << "Dropped " << num_dropped_chunks_
+                 << " chunks of trace data";
+  }
   if (pipe_.is_valid())
     pipe_.reset();
   DCHECK(!pipe_.is_valid());
 }
 
-void TraceDataSink::AddChunk(const std::string& json) {
-  if (!empty_)
-    BlockingCopyFromString(",", pipe_);
-  empty_ = false;
-  BlockingCopyFromString(json, pipe_);
+void TraceDataSink::AddChunk(mojo::common::TraceChunkType type,
+                             const void* data,
+                             size_t num_bytes) {
+  if (closing_ || !pipe_.is_valid())
+    return;
+
+  // Chunks are dropped whole, so that the stream stays readable.
+  mojo::common::TraceChunkHeader header;
+  if (buffered_bytes_ + sizeof(header) + num_bytes > kMaxBufferedBytes) {
+    if (!num_dropped_chunks_)
+      LOG(WARNING) << "Trace data isn't being consumed; dropping chunks";
+    num_dropped_chunks_++;
+    return;
+  }
+
+  header.type = type;
+  header.num_bytes = static_cast<uint32_t>(num_bytes);
+  Write(reinterpret_cast<const char*>(&header), sizeof(header));
+  Write(static_cast<const char*>(data), num_bytes);
+}
+
+void TraceDataSink::WriteBufferedData() {
+  while (!buffer_.empty() && pipe_.is_valid()) {
+    const std::string& front = buffer_.front();
+    size_t num_bytes = front.size() - buffer_offset_;
+    size_t num_written = WriteNoWait(front.data() + buffer_offset_, num_bytes);
+    buffered_bytes_ -= num_written;
+    if (num_written < num_bytes) {
+      buffer_offset_ += num_written;
+      break;
+    }
+    buffer_.pop_front();
+    buffer_offset_ = 0;
+  }
+
+  if (!pipe_.is_valid()) {
+    buffer_.clear();
+    buffer_offset_ = 0;
+    buffered_bytes_ = 0;
+  }
+
+  if (has_buffered_data()) {
+    WatchPipe();
+    return;
+  }
+  if (watching_) {
+    watcher_.Stop();
+    watching_ = false;
+  }
+  if (closing_)
+    pipe_.reset();
+}
+
+void TraceDataSink::Close() {
+  closing_ = true;
+  if (!has_buffered_data())
+    pipe_.reset();
+}
+
+void TraceDataSink::Write(const char* data, size_t num_bytes) {
+  if (buffer_.empty()) {
+    size_t num_written = WriteNoWait(data, num_bytes);
+    data += num_written;
+    num_bytes -= num_written;
+  }
+  if (!num_bytes || !pipe_.is_valid())
+    return;
+
+  buffer_.push_back(std::string(data, num_bytes));
+  buffered_bytes_ += num_bytes;
+  WatchPipe();
+}
+
+size_t TraceDataSink::WriteNoWait(const char* data, size_t num_bytes) {
+  uint32_t num_written = static_cast<uint32_t>(num_bytes);
+  MojoResult result = mojo::WriteDataRaw(pipe_.get(), data, &num_written,
+                                         MOJO_WRITE_DATA_FLAG_NONE);
+  if (result == MOJO_RESULT_OK)
+    return num_written;
+  if (result != MOJO_RESULT_SHOULD_WAIT) {
+    // The consumer has gone away, so there's no point in writing any more.
+    LOG(WARNING) << "Trace data pipe closed by consumer";
+    pipe_.reset();
+  }
+  return 0;
+}
+
+void TraceDataSink::WatchPipe() {
+  if (watching_)
+    return;
+  watching_ = true;
+  watcher_.Start(pipe_.get(), MOJO_HANDLE_SIGNAL_WRITABLE,
+                 MOJO_DEADLINE_INDEFINITE,
+                 base::Bind(&TraceDataSink::OnPipeWritable,
+                            base::Unretained(this)));
+}
+
+void TraceDataSink::OnPipeWritable(MojoResult result) {
+  watching_ = false;
+  if (result != MOJO_RESULT_OK) {
+    // The consumer has gone away (or the message loop is shutting down).
+    pipe_.reset();
+  }
+  WriteBufferedData();
 }
 
 }  // namespace tracing
@@ -5,23 +5,73 @@
 #ifndef SERVICES_TRACING_TRACE_DATA_SINK_H_
 #define SERVICES_TRACING_TRACE_DATA_SINK_H_
 
+#include <deque>
 #include <string>
 
 #include "base/basictypes.h"
+#include "mojo/common/handle_watcher.h"
+#include "mojo/common/trace_records.h"
 #include "mojo/public/cpp/system/data_pipe.h"
 
 namespace tracing {
 
+// TraceDataSink writes the trace data from all the collectors to the data pipe
+// given to the trace coordinator, as a trace stream (see
+// mojo/common/trace_records.h).
+//
+// It never blocks on the data pipe. Data that the pipe won't take right away
+// is buffered (up to |kMaxBufferedBytes|; chunks that would exceed that are
+// dropped) and written when the pipe becomes writable.
 class TraceDataSink {
  public:
+  // The most data that will be buffered while waiting for the pipe's consumer.
+  static const size_t kMaxBufferedBytes = 64 * 1024 * 1024;
+
   explicit TraceDataSink(mojo::ScopedDataPipeProducerHandle pipe);
   ~TraceDataSink();
 
-  void AddChunk(const std::string& json);
+  // Adds a chunk of trace data of the given type (see
+  // mojo/common/trace_records.h) to the stream.
+  void AddChunk(mojo::common::TraceChunkType type,
+                const void* data,
+                size_t num_bytes);
+
+  // Writes as much buffered data as the pipe will take without blocking. (This
+  // is done automatically when the pipe becomes writable, but only if the
+  // message loop is running.)
+  void WriteBufferedData();
+
+  // Closes the pipe once all the buffered data has been written.
+  void Close();
+
+  bool has_buffered_data() const { return !buffer_.empty(); }
+  bool is_closed() const { return !pipe_.is_valid(); }
+  mojo::Handle handle() const { return pipe_.get(); }
 
  private:
+  // Writes |num_bytes| bytes from |data| (after any buffered data), buffering
+  // whatever the pipe won't take right away.
+  void Write(const char* data, size_t num_bytes);
+
+  // Writes as much of |data| as the pipe will take without blocking, returning
+  // the number of bytes written.
+  size_t WriteNoWait(const char* data, size_t num_bytes);
+
+  void WatchPipe();
+  void OnPipeWritable(MojoResult result);
+
   mojo::ScopedDataPipeProducerHandle pipe_;
-  bool empty_;
+  bool closing_;
+
+  // Data waiting to be written. (|buffer_offset_| bytes of the first string
+  // have already been written.)
+  std::deque<std::string> buffer_;
+  size_t buffer_offset_;
+  size_t buffered_bytes_;
+  size_t num_dropped_chunks_;
+
+  mojo::common::HandleWatcher watcher_;
+  bool watching_;
 
   DISALLOW_COPY_AND_ASSIGN(TraceDataSink);
 };
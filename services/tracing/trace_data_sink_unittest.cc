@@ -0,0 +1,200 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "services/tracing/trace_data_sink.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "mojo/common/message_pump_mojo.h"
+#include "mojo/common/trace_records.h"
+#include "mojo/public/cpp/system/data_pipe.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace tracing {
+namespace {
+
+using mojo::common::TRACE_CHUNK_JSON;
+using mojo::common::TRACE_CHUNK_RECORDS;
+using mojo::common::TraceChunkHeader;
+using mojo::common::TraceChunkType;
+
+struct Chunk {
+  uint32_t type;
+  std::string data;
+};
+
+class TraceDataSinkTest : public testing::Test {
+ public:
+  TraceDataSinkTest()
+      : message_loop_(mojo::common::MessagePumpMojo::Create()) {}
+  ~TraceDataSinkTest() override {}
+
+ protected:
+  // Creates |sink_| with a data pipe of the given capacity.
+  void CreateSink(uint32_t capacity_num_bytes) {
+    MojoCreateDataPipeOptions options = {
+        sizeof(MojoCreateDataPipeOptions),
+        MOJO_CREATE_DATA_PIPE_OPTIONS_FLAG_NONE, 1, capacity_num_bytes};
+    mojo::DataPipe data_pipe(options);
+    consumer_ = data_pipe.consumer_handle.Pass();
+    sink_.reset(new TraceDataSink(data_pipe.producer_handle.Pass()));
+  }
+
+  // Reads whatever the pipe has now, returning false if the sink has closed it
+  // (and there's nothing left to read).
+  bool ReadAvailableData() {
+    char buffer[4096];
+    uint32_t num_bytes = sizeof(buffer);
+    MojoResult result = mojo::ReadDataRaw(consumer_.get(), buffer, &num_bytes,
+                                          MOJO_READ_DATA_FLAG_NONE);
+    if (result == MOJO_RESULT_OK)
+      stream_.append(buffer, num_bytes);
+    else
+      EXPECT_TRUE(result == MOJO_RESULT_SHOULD_WAIT ||
+                  result == MOJO_RESULT_FAILED_PRECONDITION);
+    return result != MOJO_RESULT_FAILED_PRECONDITION;
+  }
+
+  // Reads from the pipe (letting the sink write its buffered data) until the
+  // sink closes it.
+  void ReadUntilClosed() {
+    while (ReadAvailableData())
+      base::RunLoop().RunUntilIdle();
+  }
+
+  // Returns the chunks of the stream read so far.
+  std::vector<Chunk> GetChunks() {
+    std::vector<Chunk> chunks;
+    size_t offset = 0;
+    while (offset + sizeof(TraceChunkHeader) <= stream_.size()) {
+      TraceChunkHeader header;
+      memcpy(&header, stream_.data() + offset, sizeof(header));
+      offset += sizeof(header);
+      EXPECT_LE(offset + header.num_bytes, stream_.size());
+      Chunk chunk = {header.type, stream_.substr(offset, header.num_bytes)};
+      chunks.push_back(chunk);
+      offset += header.num_bytes;
+    }
+    EXPECT_EQ(stream_.size(), offset);
+    return chunks;
+  }
+
+  void AddChunk(TraceChunkType type, const std::string& data) {
+    sink_->AddChunk(type, data.data(), data.size());
+  }
+
+  base::MessageLoop message_loop_;
+  mojo::ScopedDataPipeConsumerHandle consumer_;
+  scoped_ptr<TraceDataSink> sink_;
+  std::string stream_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TraceDataSinkTest);
+};
+
+TEST_F(TraceDataSinkTest, WritesChunks) {
+  CreateSink(1024);
+  AddChunk(TRACE_CHUNK_JSON, "{}");
+  AddChunk(TRACE_CHUNK_RECORDS, std::string(10, 'r'));
+  EXPECT_FALSE(sink_->has_buffered_data());
+  sink_->Close();
+  EXPECT_TRUE(sink_->is_closed());
+
+  ReadUntilClosed();
+  std::vector<Chunk> chunks = GetChunks();
+  ASSERT_EQ(2u, chunks.size());
+  EXPECT_EQ(static_cast<uint32_t>(TRACE_CHUNK_JSON), chunks[0].type);
+  EXPECT_EQ("{}", chunks[0].data);
+  EXPECT_EQ(static_cast<uint32_t>(TRACE_CHUNK_RECORDS), chunks[1].type);
+  EXPECT_EQ(std::string(10, 'r'), chunks[1].data);
+}
+
+TEST_F(TraceDataSinkTest, BuffersWhilePipeIsFull) {
+  CreateSink(64);
+  const std::string data1(100, '1');
+  const std::string data2(200, '2');
+  AddChunk(TRACE_CHUNK_JSON, data1);
+  EXPECT_TRUE(sink_->has_buffered_data());
+  AddChunk(TRACE_CHUNK_JSON, data2);
+  EXPECT_TRUE(sink_->has_buffered_data());
+
+  // Making room in the pipe lets the sink write more of its buffered data.
+  ASSERT_TRUE(ReadAvailableData());
+  EXPECT_EQ(64u, stream_.size());
+  base::RunLoop().RunUntilIdle();
+  ASSERT_TRUE(ReadAvailableData());
+  EXPECT_EQ(128u, stream_.size());
+
+  // Writing it directly works too.
+  sink_->WriteBufferedData();
+  ASSERT_TRUE(ReadAvailableData());
+  EXPECT_EQ(192u, stream_.size());
+
+  sink_->Close();
+  ReadUntilClosed();
+  EXPECT_FALSE(sink_->has_buffered_data());
+  std::vector<Chunk> chunks = GetChunks();
+  ASSERT_EQ(2u, chunks.size());
+  EXPECT_EQ(data1, chunks[0].data);
+  EXPECT_EQ(data2, chunks[1].data);
+}
+
+TEST_F(TraceDataSinkTest, DropsChunksBeyondBufferLimit) {
+  const uint32_t kPipeCapacity = 1024;
+  CreateSink(kPipeCapacity);
+  const std::string big_data(
+      TraceDataSink::kMaxBufferedBytes / 2 + kPipeCapacity, 'b');
+  // The first chunk doesn't fit in the pipe, so most of it is buffered.
+  AddChunk(TRACE_CHUNK_JSON, big_data);
+  EXPECT_TRUE(sink_->has_buffered_data());
+  // The second one would take the buffer past its limit, so it's dropped.
+  AddChunk(TRACE_CHUNK_RECORDS, big_data);
+  // But smaller chunks still fit.
+  AddChunk(TRACE_CHUNK_RECORDS, "small");
+
+  sink_->Close();
+  ReadUntilClosed();
+  std::vector<Chunk> chunks = GetChunks();
+  ASSERT_EQ(2u, chunks.size());
+  EXPECT_EQ(static_cast<uint32_t>(TRACE_CHUNK_JSON), chunks[0].type);
+  EXPECT_TRUE(chunks[0].data == big_data);
+  EXPECT_EQ(static_cast<uint32_t>(TRACE_CHUNK_RECORDS), chunks[1].type);
+  EXPECT_EQ("small", chunks[1].data);
+}
+
+TEST_F(TraceDataSinkTest, ClosesPipeAfterWritingBufferedData) {
+  CreateSink(64);
+  const std::string data(1000, 'd');
+  AddChunk(TRACE_CHUNK_JSON, data);
+  sink_->Close();
+  EXPECT_FALSE(sink_->is_closed());
+  // Nothing is added after the sink has been closed.
+  AddChunk(TRACE_CHUNK_JSON, "late");
+
+  ReadUntilClosed();
+  EXPECT_TRUE(sink_->is_closed());
+  std::vector<Chunk> chunks = GetChunks();
+  ASSERT_EQ(1u, chunks.size());
+  EXPECT_EQ(data, chunks[0].data);
+}
+
+TEST_F(TraceDataSinkTest, ConsumerClosed) {
+  CreateSink(64);
+  AddChunk(TRACE_CHUNK_JSON, std::string(1000, 'd'));
+  EXPECT_TRUE(sink_->has_buffered_data());
+
+  // Once the consumer has gone away, there's no point in keeping the data.
+  consumer_.reset();
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(sink_->is_closed());
+  EXPECT_FALSE(sink_->has_buffered_data());
+}
+
+}  // namespace
+}  // namespace tracing
@@ -47,6 +47,11 @@ void TracingApp::Create(mojo::ApplicationConnection* connection,
 void TracingApp::Start(mojo::ScopedDataPipeProducerHandle stream,
                        const mojo::String& categories) {
   tracing_categories_ = categories;
+  DeleteClosedSinks();
+  if (sink_) {
+    sink_->Close();
+    closing_sinks_.push_back(sink_.release());
+  }
   sink_.reset(new TraceDataSink(stream.Pass()));
   controller_ptrs_.ForAllPtrs([categories, this](TraceController* controller) {
     TraceDataCollectorPtr ptr;
@@ -93,6 +98,14 @@ void TracingApp::StopAndFlush() {
       signals.push_back(MOJO_HANDLE_SIGNAL_READABLE |
                         MOJO_HANDLE_SIGNAL_PEER_CLOSED);
     }
+    // The message loop isn't running, so the sink can't wait for its pipe to
+    // become writable by itself. (It's last, so that the indices of the
+    // collectors are unaffected.)
+    const bool wait_for_sink = sink_ && sink_->has_buffered_data();
+    if (wait_for_sink) {
+      handles.push_back(sink_->handle());
+      signals.push_back(MOJO_HANDLE_SIGNAL_WRITABLE);
+    }
     std::vector<MojoHandleSignalsState> signals_states(signals.size());
     const mojo::WaitManyResult wait_many_result =
         mojo::WaitMany(handles, signals, mojo_deadline, &signals_states);
@@ -102,6 +115,10 @@ void TracingApp::StopAndFlush() {
       break;
     }
     if (wait_many_result.IsIndexValid()) {
+      if (wait_for_sink) {
+        signals_states.pop_back();
+        sink_->WriteBufferedData();
+      }
       // Iterate backwards so we can remove closed pipes from |collector_impls_|
       // without invalidating subsequent offsets.
       for (size_t i = signals_states.size(); i != 0; --i) {
@@ -121,7 +138,19 @@ void TracingApp::StopAndFlush() {
 
 void TracingApp::AllDataCollected() {
   collector_impls_.clear();
-  sink_.reset();
+  // The sink may still have buffered data to write, so keep it until it's done.
+  if (sink_) {
+    sink_->Close();
+    closing_sinks_.push_back(sink_.release());
+  }
+  DeleteClosedSinks();
+}
+
+void TracingApp::DeleteClosedSinks() {
+  for (size_t i = closing_sinks_.size(); i != 0; --i) {
+    if (closing_sinks_[i - 1]->is_closed())
+      closing_sinks_.erase(closing_sinks_.begin() + (i - 1));
+  }
 }
 
 }  // namespace tracing
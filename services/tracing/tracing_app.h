@@ -41,7 +41,12 @@ class TracingApp : public mojo::ApplicationDelegate,
 
   void AllDataCollected();
 
+  // Deletes the sinks in |closing_sinks_| that have finished writing.
+  void DeleteClosedSinks();
+
   scoped_ptr<TraceDataSink> sink_;
+  // Sinks from previous traces that are still writing buffered data.
+  ScopedVector<TraceDataSink> closing_sinks_;
   ScopedVector<CollectorImpl> collector_impls_;
   mojo::InterfacePtrSet<TraceController> controller_ptrs_;
   mojo::Binding<TraceCoordinator> coordinator_binding_;
@@ -4,15 +4,49 @@
 
 #include "services/url_response_disk_cache/url_response_disk_cache_app.h"
 
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
+#include "mojo/public/cpp/application/application_impl.h"
 #include "services/url_response_disk_cache/url_response_disk_cache_impl.h"
 
 namespace mojo {
 
+namespace {
+
+// Sets the maximum total size in bytes of the cached responses (of all
+// origins), e.g., --max-size=104857600.
+const char kMaxSizeArg[] = "--max-size=";
+
+const uint64_t kDefaultMaxSize = 256 * 1024 * 1024;
+
+// The number of threads that extract archives.
+const size_t kMaxExtractionThreads = 4;
+
+}  // namespace
+
 URLResponseDiskCacheApp::URLResponseDiskCacheApp(base::TaskRunner* task_runner)
-    : task_runner_(task_runner) {
+    : task_runner_(task_runner),
+      extraction_pool_(new base::SequencedWorkerPool(kMaxExtractionThreads,
+                                                     "extraction_pool")),
+      max_size_(kDefaultMaxSize) {
 }
 
 URLResponseDiskCacheApp::~URLResponseDiskCacheApp() {
+  extraction_pool_->Shutdown();
+  // Save the last access times that haven't been saved yet.
+  for (const auto& it : indexes_)
+    it.second->SaveIfDirty();
+}
+
+void URLResponseDiskCacheApp::Initialize(ApplicationImpl* app) {
+  for (const std::string& arg : app->args()) {
+    if (StartsWithASCII(arg, kMaxSizeArg, true)) {
+      LOG_IF(ERROR, !base::StringToUint64(arg.substr(strlen(kMaxSizeArg)),
+                                          &max_size_))
+          << "Invalid argument: " << arg;
+    }
+  }
+  size_limit_ = new URLResponseDiskCacheSizeLimit(max_size_);
 }
 
 bool URLResponseDiskCacheApp::ConfigureIncomingConnection(
@@ -24,8 +58,15 @@ bool URLResponseDiskCacheApp::ConfigureIncomingConnection(
 void URLResponseDiskCacheApp::Create(
     ApplicationConnection* connection,
     InterfaceRequest<URLResponseDiskCache> request) {
-  new URLResponseDiskCacheImpl(
-      task_runner_, connection->GetRemoteApplicationURL(), request.Pass());
+  base::FilePath base_directory = URLResponseDiskCacheIndex::GetBaseDirectory(
+      connection->GetRemoteApplicationURL());
+  scoped_refptr<URLResponseDiskCacheIndex>& index = indexes_[base_directory];
+  if (!index) {
+    index = new URLResponseDiskCacheIndex(task_runner_, base_directory,
+                                          size_limit_);
+  }
+  new URLResponseDiskCacheImpl(task_runner_, extraction_pool_.get(), index,
+                               request.Pass());
 }
 
 }  // namespace mojo
@@ -5,13 +5,18 @@
 #ifndef SERVICES_URL_RESPONSE_DISK_CACHE_URL_RESPONSE_DISK_CACHE_APP_H_
 #define SERVICES_URL_RESPONSE_DISK_CACHE_URL_RESPONSE_DISK_CACHE_APP_H_
 
+#include <map>
+
+#include "base/files/file_path.h"
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
 #include "base/task_runner.h"
 #include "base/threading/sequenced_worker_pool.h"
 #include "mojo/public/cpp/application/application_connection.h"
 #include "mojo/public/cpp/application/application_delegate.h"
 #include "mojo/public/cpp/application/interface_factory.h"
 #include "mojo/services/url_response_disk_cache/public/interfaces/url_response_disk_cache.mojom.h"
+#include "services/url_response_disk_cache/url_response_disk_cache_index.h"
 
 namespace mojo {
 
@@ -23,6 +28,7 @@ class URLResponseDiskCacheApp : public ApplicationDelegate,
 
  private:
   // ApplicationDelegate
+  void Initialize(ApplicationImpl* app) override;
   bool ConfigureIncomingConnection(ApplicationConnection* connection) override;
 
   // InterfaceFactory<URLResponseDiskCache>
@@ -30,6 +36,18 @@ class URLResponseDiskCacheApp : public ApplicationDelegate,
               InterfaceRequest<URLResponseDiskCache> request) override;
 
   base::TaskRunner* task_runner_;
+  // Extracts archives, so that extracting a big one can't take up all the
+  // threads behind |task_runner_| (which, in the shell, also load
+  // applications).
+  scoped_refptr<base::SequencedWorkerPool> extraction_pool_;
+  // The maximum total size of the cached responses (of all origins).
+  uint64_t max_size_;
+  // The limit shared by all the indexes, created with |max_size_| once the
+  // arguments have been read.
+  scoped_refptr<URLResponseDiskCacheSizeLimit> size_limit_;
+  // The index of each cache directory, shared by all the connections that use
+  // that directory.
+  std::map<base::FilePath, scoped_refptr<URLResponseDiskCacheIndex>> indexes_;
 
   DISALLOW_COPY_AND_ASSIGN(URLResponseDiskCacheApp);
 };
@@ -113,6 +113,64 @@ TEST_F(URLResponseDiskCacheAppTest, GetExtractedContent) {
   EXPECT_EQ("world\n", file_content);
 }
 
+TEST_F(URLResponseDiskCacheAppTest, ConcurrentGetExtractedContent) {
+  std::string etag_value = base::StringPrintf("%f", base::RandDouble());
+  URLResponsePtr url_response = mojo::URLResponse::New();
+  url_response->url = "http://www.example.com/4";
+  {
+    auto etag_header = HttpHeader::New();
+    etag_header->name = "ETag";
+    etag_header->value = etag_value;
+    url_response->headers.push_back(etag_header.Pass());
+  }
+  DataPipe pipe;
+  uint32_t num_bytes = kTestData.size;
+  ASSERT_EQ(MOJO_RESULT_OK,
+            WriteDataRaw(pipe.producer_handle.get(), kTestData.data, &num_bytes,
+                         MOJO_WRITE_DATA_FLAG_ALL_OR_NONE));
+  ASSERT_EQ(kTestData.size, num_bytes);
+  pipe.producer_handle.reset();
+  url_response->body = pipe.consumer_handle.Pass();
+  base::FilePath file;
+  url_response_disk_cache_->GetFile(
+      url_response.Pass(),
+      [&file](Array<uint8_t> received_file_path,
+              Array<uint8_t> received_cache_dir_path) {
+        file = toPath(received_file_path.Pass());
+      });
+  url_response_disk_cache_.WaitForIncomingResponse();
+  ASSERT_FALSE(file.empty());
+
+  // Ask for the extracted content of the (now cached) response twice, without
+  // waiting for the first answer. Both requests share a single extraction.
+  base::FilePath extracted_dirs[2];
+  for (base::FilePath& extracted_dir : extracted_dirs) {
+    url_response = mojo::URLResponse::New();
+    url_response->url = "http://www.example.com/4";
+    auto etag_header = HttpHeader::New();
+    etag_header->name = "ETag";
+    etag_header->value = etag_value;
+    url_response->headers.push_back(etag_header.Pass());
+    url_response_disk_cache_->GetExtractedContent(
+        url_response.Pass(),
+        [&extracted_dir](Array<uint8_t> received_extracted_dir,
+                         Array<uint8_t> received_cache_dir_path) {
+          extracted_dir = toPath(received_extracted_dir.Pass());
+        });
+  }
+  url_response_disk_cache_.WaitForIncomingResponse();
+  url_response_disk_cache_.WaitForIncomingResponse();
+  ASSERT_FALSE(extracted_dirs[0].empty());
+  EXPECT_EQ(extracted_dirs[0], extracted_dirs[1]);
+  std::string file_content;
+  ASSERT_TRUE(
+      base::ReadFileToString(extracted_dirs[0].Append("file1"), &file_content));
+  EXPECT_EQ("hello\n", file_content);
+  ASSERT_TRUE(
+      base::ReadFileToString(extracted_dirs[0].Append("file2"), &file_content));
+  EXPECT_EQ("world\n", file_content);
+}
+
 TEST_F(URLResponseDiskCacheAppTest, CacheTest) {
   URLResponsePtr url_response = mojo::URLResponse::New();
   url_response->url = "http://www.example.com/3";
@@ -4,60 +4,44 @@
 
 #include "services/url_response_disk_cache/url_response_disk_cache_impl.h"
 
-#include <type_traits>
+#include <algorithm>
 
 #include "base/bind.h"
 #include "base/files/file_util.h"
-#include "base/files/important_file_writer.h"
 #include "base/location.h"
 #include "base/logging.h"
+#include "base/memory/ref_counted.h"
 #include "base/strings/string_util.h"
-#include "base/strings/stringprintf.h"
+#include "base/sys_info.h"
+#include "base/task_runner_util.h"
+#include "base/time/time.h"
 #include "mojo/common/data_pipe_utils.h"
-#include "mojo/public/cpp/application/application_connection.h"
-#include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
-#include "services/url_response_disk_cache/url_response_disk_cache_entry.mojom.h"
 #include "third_party/zlib/google/zip_reader.h"
-#include "url/gurl.h"
 
 namespace mojo {
 
 namespace {
 
-// The current version of the cache. This should only be incremented. When this
-// is incremented, all current cache entries will be invalidated.
-const uint32_t kCurrentVersion = 2;
-
 const char kEtagHeader[] = "etag";
 
-template <typename T>
-void Serialize(T input, std::string* output) {
-  typedef typename mojo::internal::WrapperTraits<T>::DataType DataType;
-  size_t size = GetSerializedSize_(input);
-  mojo::internal::FixedBuffer buf(size);
-  DataType data_type;
-  Serialize_(input.Pass(), &buf, &data_type);
-  std::vector<Handle> handles;
-  data_type->EncodePointersAndHandles(&handles);
-  void* serialized_data = buf.Leak();
-  *output = std::string(static_cast<char*>(serialized_data), size);
-  free(serialized_data);
-}
+// The maximum number of tasks to extract an archive with.
+const int kMaxExtractionTasks = 4;
 
-template <typename T>
-bool Deserialize(std::string input, T* output) {
-  typedef typename mojo::internal::WrapperTraits<T>::DataType DataType;
-  mojo::internal::BoundsChecker bounds_checker(&input[0], input.size(), 0);
-  if (!std::remove_pointer<DataType>::type::Validate(&input[0],
-                                                     &bounds_checker)) {
-    return false;
-  }
-  DataType data_type = reinterpret_cast<DataType>(&input[0]);
-  std::vector<Handle> handles;
-  data_type->DecodePointersAndHandles(&handles);
-  Deserialize_(data_type, output);
-  return true;
-}
+// The results of the tasks extracting an archive. This is only used on the
+// service's thread.
+struct ExtractionState : public base::RefCounted<ExtractionState> {
+  explicit ExtractionState(int num_tasks)
+      : num_pending_tasks(num_tasks), success(true), extracted_size(0) {}
+
+  int num_pending_tasks;
+  bool success;
+  uint64_t extracted_size;
+
+ private:
+  friend class base::RefCounted<ExtractionState>;
+
+  ~ExtractionState() {}
+};
 
 Array<uint8_t> PathToArray(const base::FilePath& path) {
   if (path.empty())
@@ -68,69 +52,96 @@ Array<uint8_t> PathToArray(const base::FilePath& path) {
   return result.Pass();
 }
 
-// Encode a string in ascii. This uses _ as an escape character. It also escapes
-// ':' because it is an usual path separator, and '#' because dart refuses it in
-// URLs.
-std::string EncodeString(const std::string& string) {
-  std::string result = "";
-  for (size_t i = 0; i < string.size(); ++i) {
-    unsigned char c = string[i];
-    if (c >= 32 && c < 128 && c != '_' && c != ':' && c != '#') {
-      result += c;
-    } else {
-      result += base::StringPrintf("_%02x", c);
-    }
-  }
-  return result;
-}
-
-// This service use a directory under HOME to store all of its data,
-base::FilePath GetBaseDirectory() {
-  return base::FilePath(getenv("HOME")).Append(".mojo_url_response_disk_cache");
-}
-
-// Returns the directory used store cached data for the given |url|, under
-// |base_directory|.
-base::FilePath GetDirName(base::FilePath base_directory,
-                          const std::string& url) {
-  // TODO(qsr): If the speed of directory traversal is problematic, this might
-  // need to change to use less directories.
-  return base_directory.Append(EncodeString(url));
-}
-
 // Returns the directory that the consumer can use to cache its own data.
 base::FilePath GetConsumerCacheDirectory(const base::FilePath& main_cache) {
   return main_cache.Append("consumer_cache");
 }
 
-// Returns the path of the sentinel used to keep track of a zipped response has
-// already been extracted.
-base::FilePath GetExtractedSentinel(const base::FilePath& main_cache) {
-  return main_cache.Append("extracted_sentinel");
-}
-
 // Runs the given callback. If |success| is false, call back with an error.
-// Otherwise, store |entry| in |entry_path|, then call back with the given
+// Otherwise, add |entry| for |url| to |index|, then call back with the given
 // paths.
 void RunCallbackWithSuccess(
     const URLResponseDiskCacheImpl::FilePathPairCallback& callback,
+    scoped_refptr<URLResponseDiskCacheIndex> index,
+    const std::string& url,
     const base::FilePath& content_path,
     const base::FilePath& cache_dir,
-    const base::FilePath& entry_path,
-    CacheEntryPtr entry,
+    URLResponseDiskCacheIndex::Entry entry,
     bool success) {
   if (!success) {
     callback.Run(base::FilePath(), base::FilePath());
     return;
   }
-  std::string serialized_entry;
-  Serialize(entry.Pass(), &serialized_entry);
-  // We can ignore write error, as it will just force to clear the cache on the
-  // next request.
-  base::ImportantFileWriter::WriteFileAtomically(entry_path, serialized_entry);
+  int64_t size = 0;
+  if (base::GetFileSize(content_path, &size))
+    entry.size = static_cast<uint64_t>(size);
+  entry.last_access_time = base::Time::Now().ToInternalValue();
+  index->Put(url, entry);
   callback.Run(content_path, cache_dir);
 }
 
+// Extracts the entries of the zip file |content| whose index modulo
+// |num_tasks| is |task_index| into |extracted_dir|. Returns the total size of
+// the extracted entries, or -1 in case of error.
+int64_t ExtractEntries(const base::FilePath& content,
+                       const base::FilePath& extracted_dir,
+                       int task_index,
+                       int num_tasks) {
+  // Each task uses its own reader, so that they can inflate entries at the
+  // same time.
+  zip::ZipReader reader;
+  if (!reader.Open(content))
+    return -1;
+  int64_t extracted_size = 0;
+  for (int i = 0; reader.HasMore(); i++) {
+    if (i % num_tasks == task_index) {
+      if (!reader.OpenCurrentEntryInZip() ||
+          !reader.ExtractCurrentEntryIntoDirectory(extracted_dir)) {
+        return -1;
+      }
+      if (reader.current_entry_info()->original_size() > 0)
+        extracted_size += reader.current_entry_info()->original_size();
+    }
+    if (!reader.AdvanceToNextEntry())
+      return -1;
+  }
+  return extracted_size;
+}
+
+// Called with the result of each |ExtractEntries()| task for a response. Once
+// all the tasks are done, marks the response as extracted in |index| (if all
+// the tasks succeeded) and finishes the extraction, calling back everyone
+// waiting for it.
+void DidExtractEntries(scoped_refptr<URLResponseDiskCacheIndex> index,
+                       const std::string& url,
+                       scoped_refptr<ExtractionState> state,
+                       int64_t extracted_size) {
+  if (extracted_size < 0)
+    state->success = false;
+  else
+    state->extracted_size += static_cast<uint64_t>(extracted_size);
+  if (--state->num_pending_tasks > 0)
+    return;
+
+  if (state->success)
+    index->SetExtracted(url, state->extracted_size);
+  index->FinishExtraction(url, state->success);
+}
+
+// Calls back with the given paths if the extraction succeeded, or with an
+// error otherwise.
+void DidExtractContent(
+    const URLResponseDiskCacheImpl::FilePathPairCallback& callback,
+    const base::FilePath& extracted_dir,
+    const base::FilePath& cache_dir,
+    bool success) {
+  if (!success) {
+    callback.Run(base::FilePath(), base::FilePath());
+    return;
+  }
+  callback.Run(extracted_dir, cache_dir);
+}
+
 // Run the given mojo callback with the given paths.
 void RunMojoCallback(
     const Callback<void(Array<uint8_t>, Array<uint8_t>)>& callback,
@@ -153,66 +164,74 @@ std::vector<std::string> GetHeaderValues(const std::string& header_name,
   return result;
 }
 
-// Returns whether the given directory |dir| constains a valid entry file for
-// the given |response|. If this is the case and |output| is not |nullptr|, then
-// the deserialized entry is returned in |*output|.
-bool IsCacheEntryValid(const base::FilePath& dir,
-                       URLResponse* response,
-                       CacheEntryPtr* output) {
-  // Find the entry file, and deserialize it.
-  base::FilePath entry_path = dir.Append("entry");
-  if (!base::PathExists(entry_path))
-    return false;
-  std::string serialized_entry;
-  if (!ReadFileToString(entry_path, &serialized_entry))
-    return false;
-  CacheEntryPtr entry;
-  if (!Deserialize(serialized_entry, &entry))
-    return false;
-
-  // Obsolete entries are invalidated.
-  if (entry->version != kCurrentVersion)
-    return false;
+// Returns the first etag of |response|, or the empty string if it has none.
+std::string GetEtag(URLResponse* response) {
+  if (response->headers.is_null())
+    return std::string();
+  std::vector<std::string> etags =
+      GetHeaderValues(kEtagHeader, response->headers);
+  return etags.empty() ? std::string() : etags[0];
+}
 
-  // If |entry| or |response| has not headers, it is not possible to check if
-  // the entry is valid, so returns |false|.
-  if (entry->headers.is_null() || response->headers.is_null())
+// Returns whether the given cache |entry| is valid for the given |response|.
+bool IsCacheEntryValid(const URLResponseDiskCacheIndex::Entry* entry,
+                       URLResponse* response) {
+  if (!entry)
     return false;
 
-  // Only handle etag for the moment.
-  std::string etag_header_name = kEtagHeader;
-  std::vector<std::string> entry_etags =
-      GetHeaderValues(etag_header_name, entry->headers);
-  if (entry_etags.size() == 0)
-    return false;
-  std::vector<std::string> response_etags =
-      GetHeaderValues(etag_header_name, response->headers);
-  if (response_etags.size() == 0)
-    return false;
+  // Only handle etag for the moment. If |entry| or |response| has no etag, it
+  // is not possible to check if the entry is valid, so returns |false|.
+  std::string etag = GetEtag(response);
+  return !entry->etag.empty() && !etag.empty() && entry->etag == etag;
+}
 
-  // Looking for the first etag header.
-  bool result = entry_etags[0] == response_etags[0];
+// Caches the body of |response| as a new entry in |index| (which has no entry
+// for the response's URL), then calls back with the paths of the cached file
+// and of the consumer cache directory.
+void CacheResponse(
+    scoped_refptr<base::TaskRunner> task_runner,
+    scoped_refptr<URLResponseDiskCacheIndex> index,
+    URLResponsePtr response,
+    const URLResponseDiskCacheImpl::FilePathPairCallback& callback) {
+  base::FilePath dir = index->GetEntryDirectory(response->url);
 
-  // Returns |entry| if requested.
-  if (output)
-    *output = entry.Pass();
+  // If the response has not a valid body, and it is not possible to create
+  // either the cache directory or the consumer cache directory, returns an
+  // error.
+  if (!response->body.is_valid() ||
+      !base::CreateDirectoryAndGetError(dir, nullptr) ||
+      !base::CreateDirectoryAndGetError(GetConsumerCacheDirectory(dir),
+                                        nullptr)) {
+    callback.Run(base::FilePath(), base::FilePath());
+    return;
+  }
 
-  return result;
+  // Fill the entry values for the request.
+  base::FilePath content;
+  CHECK(CreateTemporaryFileInDir(dir, &content));
+  URLResponseDiskCacheIndex::Entry new_entry;
+  new_entry.content_path = content.value();
+  new_entry.etag = GetEtag(response.get());
+  // Asynchronously copy the response body to the cached file. The entry is send
+  // to the callback so that it is added to the index only if the copy of the
+  // body succeded.
+  common::CopyToFile(response->body.Pass(), content, task_runner.get(),
+                     base::Bind(&RunCallbackWithSuccess, callback, index,
+                                response->url.get(), content,
+                                GetConsumerCacheDirectory(dir), new_entry));
 }
 
 }  // namespace
 
 URLResponseDiskCacheImpl::URLResponseDiskCacheImpl(
     base::TaskRunner* task_runner,
-    const std::string& remote_application_url,
+    base::TaskRunner* extraction_runner,
+    scoped_refptr<URLResponseDiskCacheIndex> index,
     InterfaceRequest<URLResponseDiskCache> request)
-    : task_runner_(task_runner), binding_(this, request.Pass()) {
-  base_directory_ = GetBaseDirectory();
-  // The cached files are shared only for application of the same origin.
-  if (remote_application_url != "") {
-    base_directory_ = base_directory_.Append(
-        EncodeString(GURL(remote_application_url).GetOrigin().spec()));
-  }
+    : task_runner_(task_runner),
+      extraction_runner_(extraction_runner),
+      index_(index),
+      binding_(this, request.Pass()) {
 }
 
 URLResponseDiskCacheImpl::~URLResponseDiskCacheImpl() {
@@ -227,31 +246,34 @@ void URLResponseDiskCacheImpl::GetFile(URLResponsePtr response,
 void URLResponseDiskCacheImpl::GetExtractedContent(
     URLResponsePtr response,
     const GetExtractedContentCallback& callback) {
-  base::FilePath dir = GetDirName(base_directory_, response->url);
+  base::FilePath dir = index_->GetEntryDirectory(response->url);
   base::FilePath extracted_dir = dir.Append("extracted");
-  if (IsCacheEntryValid(dir, response.get(), nullptr) &&
-      PathExists(GetExtractedSentinel(dir))) {
+  const URLResponseDiskCacheIndex::Entry* entry =
+      index_->Lookup(response->url);
+  if (IsCacheEntryValid(entry, response.get()) && entry->extracted) {
     callback.Run(PathToArray(extracted_dir),
                  PathToArray(GetConsumerCacheDirectory(dir)));
     return;
   }
 
+  std::string url = response->url;
   GetFileInternal(
       response.Pass(),
       base::Bind(&URLResponseDiskCacheImpl::GetExtractedContentInternal,
                  base::Unretained(this), base::Bind(&RunMojoCallback, callback),
-                 dir, extracted_dir));
+                 url, extracted_dir));
 }
 
 void URLResponseDiskCacheImpl::GetFileInternal(
     URLResponsePtr response,
     const FilePathPairCallback& callback) {
-  base::FilePath dir = GetDirName(base_directory_, response->url);
+  base::FilePath dir = index_->GetEntryDirectory(response->url);
 
   // Check if the response is cached and valid. If that's the case, returns the
   // cached value.
-  CacheEntryPtr entry;
-  if (IsCacheEntryValid(dir, response.get(), &entry)) {
+  const URLResponseDiskCacheIndex::Entry* entry =
+      index_->Lookup(response->url);
+  if (IsCacheEntryValid(entry, response.get())) {
     callback.Run(base::FilePath(entry->content_path),
                  GetConsumerCacheDirectory(dir));
     return;
@@ -259,52 +281,15 @@ void URLResponseDiskCacheImpl::GetFileInternal(
 
   // As the response was either not cached or the cached value is not valid, if
   // the cache directory for the response exists, it needs to be cleaned.
-  if (base::PathExists(dir)) {
-    base::FilePath to_delete;
-    CHECK(CreateTemporaryDirInDir(base_directory_, "to_delete", &to_delete));
-    CHECK(Move(dir, to_delete));
-    task_runner_->PostTask(
-        FROM_HERE,
-        base::Bind(base::IgnoreResult(&base::DeleteFile), to_delete, true));
-  }
-
-  // If the response has not a valid body, and it is not possible to create
-  // either the cache directory or the consumer cache directory, returns an
-  // error.
-  if (!response->body.is_valid() ||
-      !base::CreateDirectoryAndGetError(dir, nullptr) ||
-      !base::CreateDirectoryAndGetError(GetConsumerCacheDirectory(dir),
-                                        nullptr)) {
-    callback.Run(base::FilePath(), base::FilePath());
-    return;
-  }
-
-  // Fill the entry values for the request.
-  base::FilePath entry_path = dir.Append("entry");
-  base::FilePath content;
-  CHECK(CreateTemporaryFileInDir(dir, &content));
-  entry = CacheEntry::New();
-  entry->version = kCurrentVersion;
-  entry->url = response->url;
-  entry->content_path = content.value();
-  for (size_t i = 0u; i < response->headers.size(); ++i) {
-    auto cache_header = CacheHeaders::New();
-    cache_header->name = response->headers[i]->name;
-    cache_header->value = response->headers[i]->value;
-    entry->headers.push_back(cache_header.Pass());
-  }
-  // Asynchronously copy the response body to the cached file. The entry is send
-  // to the callback so that it is saved on disk only if the copy of the body
-  // succeded.
-  common::CopyToFile(response->body.Pass(), content, task_runner_,
-                     base::Bind(&RunCallbackWithSuccess, callback, content,
-                                GetConsumerCacheDirectory(dir), entry_path,
-                                base::Passed(entry.Pass())));
+  std::string url = response->url;
+  index_->Remove(url, base::Bind(&CacheResponse,
+                                 make_scoped_refptr(task_runner_), index_,
+                                 base::Passed(&response), callback));
 }
 
 void URLResponseDiskCacheImpl::GetExtractedContentInternal(
     const FilePathPairCallback& callback,
-    const base::FilePath& base_dir,
+    const std::string& url,
     const base::FilePath& extracted_dir,
     const base::FilePath& content,
     const base::FilePath& cache_dir) {
@@ -314,26 +299,25 @@ void URLResponseDiskCacheImpl::GetExtractedContentInternal(
     return;
   }
 
-  // Unzip the content to the extracted directory. In case of any error, returns
-  // an error.
-  zip::ZipReader reader;
-  if (!reader.Open(content)) {
-    callback.Run(base::FilePath(), base::FilePath());
+  // If the content is already being extracted (for another request for the
+  // same response), wait for that extraction instead of starting another one
+  // into the same directory.
+  if (!index_->StartExtraction(url, base::Bind(&DidExtractContent, callback,
+                                               extracted_dir, cache_dir))) {
     return;
   }
-  while (reader.HasMore()) {
-    bool success = reader.OpenCurrentEntryInZip();
-    success = success && reader.ExtractCurrentEntryIntoDirectory(extracted_dir);
-    success = success && reader.AdvanceToNextEntry();
-    if (!success) {
-      callback.Run(base::FilePath(), base::FilePath());
-      return;
-    }
+
+  // Unzip the content to the extracted directory, splitting the entries
+  // between several tasks so that they're inflated in parallel.
+  int num_tasks =
+      std::min(kMaxExtractionTasks, base::SysInfo::NumberOfProcessors());
+  scoped_refptr<ExtractionState> state(new ExtractionState(num_tasks));
+  for (int i = 0; i < num_tasks; i++) {
+    base::PostTaskAndReplyWithResult(
+        extraction_runner_, FROM_HERE,
+        base::Bind(&ExtractEntries, content, extracted_dir, i, num_tasks),
+        base::Bind(&DidExtractEntries, index_, url, state));
   }
-  // We can ignore write error, as it will just force to clear the cache on the
-  // next request.
-  WriteFile(GetExtractedSentinel(base_dir), nullptr, 0);
-  callback.Run(extracted_dir, cache_dir);
 }
 
 }  // namespace mojo
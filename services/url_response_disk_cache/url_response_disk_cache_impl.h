@@ -7,9 +7,11 @@
 
 #include "base/files/file_path.h"
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
 #include "base/task_runner.h"
 #include "mojo/public/cpp/bindings/strong_binding.h"
 #include "mojo/services/url_response_disk_cache/public/interfaces/url_response_disk_cache.mojom.h"
+#include "services/url_response_disk_cache/url_response_disk_cache_index.h"
 
 namespace mojo {
 
@@ -18,8 +20,11 @@ class URLResponseDiskCacheImpl : public URLResponseDiskCache {
   using FilePathPairCallback =
       base::Callback<void(const base::FilePath&, const base::FilePath&)>;
 
+  // Archives are extracted on |extraction_runner|, and everything else that
+  // blocks is done on |task_runner|.
   URLResponseDiskCacheImpl(base::TaskRunner* task_runner,
-                           const std::string& remote_application_url,
+                           base::TaskRunner* extraction_runner,
+                           scoped_refptr<URLResponseDiskCacheIndex> index,
                            InterfaceRequest<URLResponseDiskCache> request);
   ~URLResponseDiskCacheImpl() override;
 
@@ -38,19 +43,20 @@ class URLResponseDiskCacheImpl : public URLResponseDiskCache {
   // Internal implementation of |GetExtractedContent|. The parameters are:
   // |callback|: The callback to return values to the caller. It uses FilePath
   //             instead of mojo arrays.
-  // |base_dir|: The base directory for caching data associated to the response.
+  // |url|: The URL of the response.
   // |extracted_dir|: The directory where the file content must be extracted. It
   //                  will be  returned to the consumer.
   // |content|: The content of the body of the response.
   // |cache_dir|: The directory the user can user to cache its own content.
   void GetExtractedContentInternal(const FilePathPairCallback& callback,
-                                   const base::FilePath& base_dir,
+                                   const std::string& url,
                                    const base::FilePath& extracted_dir,
                                    const base::FilePath& content,
                                    const base::FilePath& cache_dir);
 
   base::TaskRunner* task_runner_;
-  base::FilePath base_directory_;
+  base::TaskRunner* extraction_runner_;
+  scoped_refptr<URLResponseDiskCacheIndex> index_;
   StrongBinding<URLResponseDiskCache> binding_;
 
   DISALLOW_COPY_AND_ASSIGN(URLResponseDiskCacheImpl);
@@ -0,0 +1,374 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "services/url_response_disk_cache/url_response_disk_cache_index.h"
+
+#include <type_traits>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "mojo/public/cpp/bindings/lib/fixed_buffer.h"
+#include "services/url_response_disk_cache/url_response_disk_cache_entry.mojom.h"
+#include "url/gurl.h"
+
+namespace mojo {
+
+namespace {
+
+// The current version of the cache. This should only be incremented. When this
+// is incremented, all current cache entries will be invalidated.
+const uint32_t kCurrentVersion = 3;
+
+const char kIndexFileName[] = "index";
+
+// How long after a lookup the updated last access times are saved.
+const int64_t kDelayedSaveSeconds = 30;
+
+template <typename T>
+void Serialize(T input, std::string* output) {
+  typedef typename mojo::internal::WrapperTraits<T>::DataType DataType;
+  size_t size = GetSerializedSize_(input);
+  mojo::internal::FixedBuffer buf(size);
+  DataType data_type;
+  Serialize_(input.Pass(), &buf, &data_type);
+  std::vector<Handle> handles;
+  data_type->EncodePointersAndHandles(&handles);
+  void* serialized_data = buf.Leak();
+  *output = std::string(static_cast<char*>(serialized_data), size);
+  free(serialized_data);
+}
+
+template <typename T>
+bool Deserialize(std::string input, T* output) {
+  typedef typename mojo::internal::WrapperTraits<T>::DataType DataType;
+  mojo::internal::BoundsChecker bounds_checker(&input[0], input.size(), 0);
+  if (!std::remove_pointer<DataType>::type::Validate(&input[0],
+                                                     &bounds_checker)) {
+    return false;
+  }
+  DataType data_type = reinterpret_cast<DataType>(&input[0]);
+  std::vector<Handle> handles;
+  data_type->DecodePointersAndHandles(&handles);
+  Deserialize_(data_type, output);
+  return true;
+}
+
+// Encode a string in ascii. This uses _ as an escape character. It also escapes
+// ':' because it is an usual path separator, and '#' because dart refuses it in
+// URLs.
+std::string EncodeString(const std::string& string) {
+  std::string result = "";
+  for (size_t i = 0; i < string.size(); ++i) {
+    unsigned char c = string[i];
+    if (c >= 32 && c < 128 && c != '_' && c != ':' && c != '#') {
+      result += c;
+    } else {
+      result += base::StringPrintf("_%02x", c);
+    }
+  }
+  return result;
+}
+
+void WriteIndexFile(const base::FilePath& path, const std::string& data) {
+  // We can ignore write error, as it will just force to clear the cache on the
+  // next start.
+  base::ImportantFileWriter::WriteFileAtomically(path, data);
+}
+
+}  // namespace
+
+URLResponseDiskCacheSizeLimit::URLResponseDiskCacheSizeLimit(uint64_t max_size)
+    : max_size_(max_size) {
+}
+
+URLResponseDiskCacheSizeLimit::~URLResponseDiskCacheSizeLimit() {
+  DCHECK(indexes_.empty());
+}
+
+void URLResponseDiskCacheSizeLimit::EvictIfNeeded(
+    URLResponseDiskCacheIndex* keep_index,
+    const std::string& keep_url) {
+  std::set<URLResponseDiskCacheIndex*> evicted_from;
+  for (;;) {
+    uint64_t total_size = 0;
+    for (URLResponseDiskCacheIndex* index : indexes_)
+      total_size += index->total_size();
+    if (total_size <= max_size_)
+      break;
+
+    // There are few enough entries that a linear search for the least recently
+    // used one is fine.
+    URLResponseDiskCacheIndex* lru_index = nullptr;
+    URLResponseDiskCacheIndex::EntryMap::iterator lru_it;
+    for (URLResponseDiskCacheIndex* index : indexes_) {
+      auto it = index->FindEvictionCandidate(
+          index == keep_index ? keep_url : std::string());
+      if (it == index->entries_.end())
+        continue;
+      if (!lru_index ||
+          it->second.last_access_time < lru_it->second.last_access_time) {
+        lru_index = index;
+        lru_it = it;
+      }
+    }
+    if (!lru_index)
+      break;
+    lru_index->Evict(lru_it);
+    evicted_from.insert(lru_index);
+  }
+
+  // |keep_index| saves itself after the change that made it evict.
+  for (URLResponseDiskCacheIndex* index : evicted_from) {
+    if (index != keep_index)
+      index->ScheduleSave();
+  }
+}
+
+URLResponseDiskCacheIndex::Entry::Entry()
+    : extracted(false), size(0), last_access_time(0) {
+}
+
+URLResponseDiskCacheIndex::Entry::~Entry() {
+}
+
+// static
+base::FilePath URLResponseDiskCacheIndex::GetBaseDirectory(
+    const std::string& remote_application_url) {
+  // This service use a directory under HOME to store all of its data,
+  base::FilePath base_directory =
+      base::FilePath(getenv("HOME")).Append(".mojo_url_response_disk_cache");
+  if (remote_application_url != "") {
+    base_directory = base_directory.Append(
+        EncodeString(GURL(remote_application_url).GetOrigin().spec()));
+  }
+  return base_directory;
+}
+
+URLResponseDiskCacheIndex::URLResponseDiskCacheIndex(
+    base::TaskRunner* task_runner,
+    const base::FilePath& base_directory,
+    scoped_refptr<URLResponseDiskCacheSizeLimit> size_limit)
+    : task_runner_(task_runner),
+      base_directory_(base_directory),
+      size_limit_(size_limit),
+      total_size_(0),
+      dirty_(false),
+      save_in_progress_(false),
+      save_needed_(false) {
+  Load();
+  size_limit_->indexes_.insert(this);
+}
+
+URLResponseDiskCacheIndex::~URLResponseDiskCacheIndex() {
+  size_limit_->indexes_.erase(this);
+}
+
+base::FilePath URLResponseDiskCacheIndex::GetEntryDirectory(
+    const std::string& url) const {
+  return base_directory_.Append(EncodeString(url));
+}
+
+const URLResponseDiskCacheIndex::Entry* URLResponseDiskCacheIndex::Lookup(
+    const std::string& url) {
+  auto it = entries_.find(url);
+  if (it == entries_.end())
+    return nullptr;
+  it->second.last_access_time = base::Time::Now().ToInternalValue();
+  dirty_ = true;
+  ScheduleDelayedSave();
+  return &it->second;
+}
+
+void URLResponseDiskCacheIndex::Put(const std::string& url,
+                                    const Entry& entry) {
+  auto it = entries_.find(url);
+  if (it != entries_.end())
+    total_size_ -= it->second.size;
+  entries_[url] = entry;
+  total_size_ += entry.size;
+  size_limit_->EvictIfNeeded(this, url);
+  ScheduleSave();
+}
+
+void URLResponseDiskCacheIndex::SetExtracted(const std::string& url,
+                                             uint64_t extracted_size) {
+  auto it = entries_.find(url);
+  if (it == entries_.end())
+    return;
+  it->second.extracted = true;
+  it->second.size += extracted_size;
+  total_size_ += extracted_size;
+  size_limit_->EvictIfNeeded(this, url);
+  ScheduleSave();
+}
+
+bool URLResponseDiskCacheIndex::StartExtraction(
+    const std::string& url,
+    const ExtractionCallback& callback) {
+  std::vector<ExtractionCallback>& callbacks = extractions_[url];
+  callbacks.push_back(callback);
+  return callbacks.size() == 1u;
+}
+
+void URLResponseDiskCacheIndex::FinishExtraction(const std::string& url,
+                                                 bool success) {
+  auto it = extractions_.find(url);
+  if (it == extractions_.end())
+    return;
+  std::vector<ExtractionCallback> callbacks;
+  callbacks.swap(it->second);
+  extractions_.erase(it);
+  for (const ExtractionCallback& callback : callbacks)
+    callback.Run(success);
+}
+
+void URLResponseDiskCacheIndex::Remove(const std::string& url,
+                                       const base::Closure& callback) {
+  auto extraction_it = extractions_.find(url);
+  if (extraction_it != extractions_.end()) {
+    extraction_it->second.push_back(
+        base::Bind(&URLResponseDiskCacheIndex::RemoveAfterExtraction, this, url,
+                   callback));
+    return;
+  }
+
+  auto it = entries_.find(url);
+  if (it != entries_.end()) {
+    total_size_ -= it->second.size;
+    entries_.erase(it);
+    ScheduleSave();
+  }
+  DeleteDirectory(GetEntryDirectory(url));
+  callback.Run();
+}
+
+void URLResponseDiskCacheIndex::SaveIfDirty() {
+  if (dirty_)
+    ScheduleSave();
+}
+
+void URLResponseDiskCacheIndex::Load() {
+  std::string serialized_index;
+  if (!base::ReadFileToString(base_directory_.Append(kIndexFileName),
+                              &serialized_index)) {
+    return;
+  }
+  CacheIndexPtr index;
+  if (!Deserialize(serialized_index, &index)) {
+    LOG(WARNING) << "Ignoring invalid cache index in "
+                 << base_directory_.value();
+    return;
+  }
+  // Obsolete entries are invalidated.
+  if (index->version != kCurrentVersion)
+    return;
+
+  for (size_t i = 0u; i < index->entries.size(); ++i) {
+    const CacheEntryPtr& cache_entry = index->entries[i];
+    Entry& entry = entries_[cache_entry->url];
+    entry.content_path = cache_entry->content_path;
+    entry.etag = cache_entry->etag.get();
+    entry.extracted = cache_entry->extracted;
+    entry.size = cache_entry->size;
+    entry.last_access_time = cache_entry->last_access_time;
+    total_size_ += entry.size;
+  }
+}
+
+URLResponseDiskCacheIndex::EntryMap::iterator
+URLResponseDiskCacheIndex::FindEvictionCandidate(const std::string& keep_url) {
+  auto lru_it = entries_.end();
+  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+    if (it->first == keep_url || extractions_.count(it->first))
+      continue;
+    if (lru_it == entries_.end() ||
+        it->second.last_access_time < lru_it->second.last_access_time) {
+      lru_it = it;
+    }
+  }
+  return lru_it;
+}
+
+void URLResponseDiskCacheIndex::Evict(EntryMap::iterator it) {
+  DVLOG(1) << "Evicting " << it->first << " from the cache";
+  total_size_ -= it->second.size;
+  DeleteDirectory(GetEntryDirectory(it->first));
+  entries_.erase(it);
+  dirty_ = true;
+}
+
+void URLResponseDiskCacheIndex::RemoveAfterExtraction(
+    const std::string& url,
+    const base::Closure& callback,
+    bool extraction_success) {
+  Remove(url, callback);
+}
+
+void URLResponseDiskCacheIndex::DeleteDirectory(const base::FilePath& dir) {
+  if (!base::PathExists(dir))
+    return;
+  base::FilePath to_delete;
+  CHECK(CreateTemporaryDirInDir(base_directory_, "to_delete", &to_delete));
+  CHECK(Move(dir, to_delete));
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::Bind(base::IgnoreResult(&base::DeleteFile), to_delete, true));
+}
+
+void URLResponseDiskCacheIndex::ScheduleSave() {
+  save_timer_.Stop();
+  dirty_ = true;
+  if (save_in_progress_) {
+    save_needed_ = true;
+    return;
+  }
+
+  CacheIndexPtr index = CacheIndex::New();
+  index->version = kCurrentVersion;
+  index->entries = Array<CacheEntryPtr>::New(0);
+  for (const auto& it : entries_) {
+    CacheEntryPtr cache_entry = CacheEntry::New();
+    cache_entry->url = it.first;
+    cache_entry->content_path = it.second.content_path;
+    if (!it.second.etag.empty())
+      cache_entry->etag = it.second.etag;
+    cache_entry->extracted = it.second.extracted;
+    cache_entry->size = it.second.size;
+    cache_entry->last_access_time = it.second.last_access_time;
+    index->entries.push_back(cache_entry.Pass());
+  }
+  std::string serialized_index;
+  Serialize(index.Pass(), &serialized_index);
+
+  dirty_ = false;
+  save_in_progress_ = true;
+  task_runner_->PostTaskAndReply(
+      FROM_HERE, base::Bind(&WriteIndexFile,
+                            base_directory_.Append(kIndexFileName),
+                            serialized_index),
+      base::Bind(&URLResponseDiskCacheIndex::DidSave, this));
+}
+
+void URLResponseDiskCacheIndex::ScheduleDelayedSave() {
+  if (save_timer_.IsRunning())
+    return;
+  save_timer_.Start(FROM_HERE,
+                    base::TimeDelta::FromSeconds(kDelayedSaveSeconds), this,
+                    &URLResponseDiskCacheIndex::ScheduleSave);
+}
+
+void URLResponseDiskCacheIndex::DidSave() {
+  save_in_progress_ = false;
+  if (save_needed_) {
+    save_needed_ = false;
+    ScheduleSave();
+  }
+}
+
+}  // namespace mojo
@@ -0,0 +1,197 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SERVICES_URL_RESPONSE_DISK_CACHE_URL_RESPONSE_DISK_CACHE_INDEX_H_
+#define SERVICES_URL_RESPONSE_DISK_CACHE_URL_RESPONSE_DISK_CACHE_INDEX_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/task_runner.h"
+#include "base/timer/timer.h"
+
+namespace mojo {
+
+class URLResponseDiskCacheIndex;
+
+// The maximum total size of the responses cached in a set of indexes (one per
+// cache directory, i.e., per origin). When the indexes together go over it,
+// the least recently used entries of all of them are evicted.
+//
+// This must be used on a single thread (the one that the indexes are used on).
+class URLResponseDiskCacheSizeLimit
+    : public base::RefCounted<URLResponseDiskCacheSizeLimit> {
+ public:
+  explicit URLResponseDiskCacheSizeLimit(uint64_t max_size);
+
+ private:
+  friend class base::RefCounted<URLResponseDiskCacheSizeLimit>;
+  friend class URLResponseDiskCacheIndex;
+
+  ~URLResponseDiskCacheSizeLimit();
+
+  // Evicts the least recently used entries of the indexes (other than the one
+  // for |keep_url| in |keep_index|, and those being extracted) until their
+  // total size is at most |max_size_|.
+  void EvictIfNeeded(URLResponseDiskCacheIndex* keep_index,
+                     const std::string& keep_url);
+
+  const uint64_t max_size_;
+  // The indexes sharing the limit. They add and remove themselves.
+  std::set<URLResponseDiskCacheIndex*> indexes_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLResponseDiskCacheSizeLimit);
+};
+
+// The index of the responses cached in one cache directory, which is kept in
+// memory (so that looking up a response doesn't touch the disk) and saved to
+// an "index" file in the directory whenever entries are added or removed.
+// Updates to the last access times of entries (on lookups) are saved lazily:
+// they are coalesced and saved after a delay, or by |SaveIfDirty()|.
+//
+// The total size of the cached responses is bounded by a
+// |URLResponseDiskCacheSizeLimit| shared with the indexes of the other cache
+// directories: when it goes over the maximum, the least recently used entries
+// are evicted (their directories are deleted on |task_runner|). Entries whose
+// content is being extracted are never evicted.
+//
+// This must be used on a single thread.
+class URLResponseDiskCacheIndex
+    : public base::RefCounted<URLResponseDiskCacheIndex> {
+ public:
+  // Called with whether the content of an entry was extracted successfully.
+  using ExtractionCallback = base::Callback<void(bool success)>;
+
+  struct Entry {
+    Entry();
+    ~Entry();
+
+    std::string content_path;
+    // Empty if the cached response had no etag.
+    std::string etag;
+    bool extracted;
+    uint64_t size;
+    int64_t last_access_time;
+  };
+
+  // Returns the directory in which the responses fetched for the application
+  // at |remote_application_url| are cached. (The cached files are shared only
+  // by applications of the same origin.)
+  static base::FilePath GetBaseDirectory(
+      const std::string& remote_application_url);
+
+  // Loads the index from |base_directory| (starting with an empty index if
+  // there isn't a valid one).
+  URLResponseDiskCacheIndex(
+      base::TaskRunner* task_runner,
+      const base::FilePath& base_directory,
+      scoped_refptr<URLResponseDiskCacheSizeLimit> size_limit);
+
+  // Returns the directory used to store the cached data for |url|.
+  base::FilePath GetEntryDirectory(const std::string& url) const;
+
+  // Returns the entry for |url| and marks it as just used (without saving the
+  // index right away), or returns null if there is no entry for |url|. The
+  // returned entry is only valid until the index is next modified.
+  const Entry* Lookup(const std::string& url);
+
+  // Adds an entry for |url| (replacing any existing one), and then evicts
+  // other entries if the cache is now too big.
+  void Put(const std::string& url, const Entry& entry);
+
+  // Marks the entry for |url| as having its content extracted, with the
+  // extracted content taking |extracted_size| bytes.
+  void SetExtracted(const std::string& url, uint64_t extracted_size);
+
+  // Registers |callback| to be called when the content of the entry for |url|
+  // has been extracted. Returns true if there was no extraction of that
+  // content in progress, in which case the caller must do the extraction and
+  // then call |FinishExtraction()|; otherwise |callback| is called when the
+  // extraction in progress finishes.
+  bool StartExtraction(const std::string& url,
+                       const ExtractionCallback& callback);
+
+  // Calls (and forgets) the callbacks registered by |StartExtraction()| for
+  // |url|.
+  void FinishExtraction(const std::string& url, bool success);
+
+  // Removes the entry for |url|, if any, and deletes its directory, then calls
+  // |callback|. If the content of the entry is being extracted, this waits for
+  // the extraction to finish, so that it doesn't write into a directory that
+  // is being deleted (or reused for a new entry).
+  void Remove(const std::string& url, const base::Closure& callback);
+
+  // Saves the index now if it has changes that haven't been saved yet, e.g.,
+  // on shutdown.
+  void SaveIfDirty();
+
+  uint64_t total_size() const { return total_size_; }
+
+ private:
+  friend class base::RefCounted<URLResponseDiskCacheIndex>;
+  friend class URLResponseDiskCacheSizeLimit;
+
+  using EntryMap = std::map<std::string, Entry>;
+
+  ~URLResponseDiskCacheIndex();
+
+  void Load();
+
+  // Returns the least recently used entry that can be evicted, i.e., that isn't
+  // the one for |keep_url| and isn't being extracted, or |entries_.end()| if
+  // there is none.
+  EntryMap::iterator FindEvictionCandidate(const std::string& keep_url);
+
+  // Removes the entry at |it| and deletes its directory, without saving the
+  // index.
+  void Evict(EntryMap::iterator it);
+
+  // Calls |Remove()| once an extraction of the content of the entry for |url|
+  // has finished.
+  void RemoveAfterExtraction(const std::string& url,
+                             const base::Closure& callback,
+                             bool extraction_success);
+
+  // Moves |dir| out of the way (so that a new entry can be created in its
+  // place right away) and deletes it on |task_runner_|.
+  void DeleteDirectory(const base::FilePath& dir);
+
+  // Saves the index to disk on |task_runner_|. Only one save is in progress at
+  // a time, so that they can't complete out of order.
+  void ScheduleSave();
+  // Saves the index after a delay (unless it's saved before then), so that the
+  // changes made by many lookups are saved together.
+  void ScheduleDelayedSave();
+  void DidSave();
+
+  base::TaskRunner* const task_runner_;
+  const base::FilePath base_directory_;
+  const scoped_refptr<URLResponseDiskCacheSizeLimit> size_limit_;
+
+  EntryMap entries_;
+  // The callbacks waiting for each extraction in progress, by URL.
+  std::map<std::string, std::vector<ExtractionCallback>> extractions_;
+  uint64_t total_size_;
+
+  // Whether the index changed since the last save was started.
+  bool dirty_;
+  bool save_in_progress_;
+  // Whether a save was requested while the save in progress was running.
+  bool save_needed_;
+  base::OneShotTimer<URLResponseDiskCacheIndex> save_timer_;
+
+  DISALLOW_COPY_AND_ASSIGN(URLResponseDiskCacheIndex);
+};
+
+}  // namespace mojo
+
+#endif  // SERVICES_URL_RESPONSE_DISK_CACHE_URL_RESPONSE_DISK_CACHE_INDEX_H_
@@ -4,16 +4,27 @@
 
 #include "shell/application_manager/application_manager.h"
 
+#if defined(OS_LINUX)
+#include <fcntl.h>
+#endif
+
 #include "base/bind.h"
 #include "base/command_line.h"
+#include "base/files/scoped_file.h"
+#include "base/location.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/message_loop/message_loop.h"
+#include "base/posix/eintr_wrapper.h"
 #include "base/strings/string_util.h"
+#include "base/threading/sequenced_worker_pool.h"
+#include "base/time/time.h"
 #include "base/trace_event/trace_event.h"
 #include "mojo/public/cpp/bindings/binding.h"
 #include "mojo/services/authenticating_url_loader_interceptor/public/interfaces/authenticating_url_loader_interceptor_meta_factory.mojom.h"
 #include "mojo/services/authentication/public/interfaces/authentication.mojom.h"
 #include "mojo/services/content_handler/public/interfaces/content_handler.mojom.h"
+#include "shell/application_manager/dependency_profiles.h"
 #include "shell/application_manager/fetcher.h"
 #include "shell/application_manager/local_fetcher.h"
 #include "shell/application_manager/network_fetcher.h"
@@ -44,8 +55,42 @@ std::vector<std::string> Concatenate(const std::vector<std::string>& v1,
   return result;
 }
 
+// Connections that an application makes within this time after it is started
+// are recorded as its dependencies.
+const int64_t kDependencyRecordingPeriodSeconds = 10;
+
+// How long a prefetched application is kept if nothing connects to it.
+const int64_t kPrefetchedApplicationLifetimeSeconds = 30;
+
+#if defined(OS_LINUX)
+// Asks the kernel to read the files at |paths| into the page cache (in the
+// background), so that they're there by the time they're loaded. This only
+// opens each file; it doesn't wait for the reads.
+void ReadAheadFiles(const std::vector<base::FilePath>& paths) {
+  TRACE_EVENT1("mojo_shell", "ReadAheadFiles", "count", paths.size());
+  for (const base::FilePath& path : paths) {
+    base::ScopedFD fd(HANDLE_EINTR(open(path.value().c_str(), O_RDONLY)));
+    if (fd.is_valid())
+      posix_fadvise(fd.get(), 0, 0, POSIX_FADV_WILLNEED);
+  }
+}
+#endif
+
 }  // namespace
 
+// An application that has been fetched ahead of time (or is being fetched),
+// because it's a recorded dependency of an application that is being started.
+struct ApplicationManager::PrefetchedApplication {
+  explicit PrefetchedApplication(uint64_t id) : id(id) {}
+  ~PrefetchedApplication() {}
+
+  const uint64_t id;
+  // Set once the fetch has succeeded (a failed prefetch is just dropped).
+  scoped_ptr<Fetcher> fetcher;
+  // Set if a connection to the application is waiting for the fetch.
+  FetchCallback callback;
+};
+
 class ApplicationManager::ContentHandlerConnection {
  public:
   ContentHandlerConnection(ApplicationManager* manager,
@@ -100,6 +145,7 @@ ApplicationManager::ApplicationManager(const Options& options,
       delegate_(delegate),
       blocking_pool_(nullptr),
       initialized_authentication_interceptor_(false),
+      next_prefetch_id_(0),
       weak_ptr_factory_(this) {
 }
 
@@ -133,16 +179,26 @@ void ApplicationManager::ConnectToApplicationWithParameters(
       TRACE_EVENT_SCOPE_THREAD, "requested_url", requested_url.spec());
   DCHECK(requested_url.is_valid());
 
+  RecordDependency(requestor_url, requested_url);
+
   // We check both the mapped and resolved urls for existing shell_impls because
   // external applications can be registered for the unresolved mojo:foo urls.
 
-  GURL mapped_url = delegate_->ResolveMappings(requested_url);
+  GURL mapped_url;
+  {
+    TRACE_EVENT0("mojo_shell", "ApplicationManager::ResolveMappings");
+    mapped_url = delegate_->ResolveMappings(requested_url);
+  }
   if (ConnectToRunningApplication(mapped_url, requestor_url, &services,
                                   &exposed_services)) {
     return;
   }
 
-  GURL resolved_url = delegate_->ResolveMojoURL(mapped_url);
+  GURL resolved_url;
+  {
+    TRACE_EVENT0("mojo_shell", "ApplicationManager::ResolveMojoURL");
+    resolved_url = delegate_->ResolveMojoURL(mapped_url);
+  }
   if (ConnectToRunningApplication(resolved_url, requestor_url, &services,
                                   &exposed_services)) {
     return;
@@ -176,6 +232,14 @@ void ApplicationManager::ConnectToApplicationWithParameters(
       base::Passed(exposed_services.Pass()), on_application_end,
       parameters);
 
+  if (!UsePrefetchedApplication(resolved_url, callback))
+    StartFetch(resolved_url, callback);
+
+  PrefetchDependencies(resolved_url);
+}
+
+void ApplicationManager::StartFetch(const GURL& resolved_url,
+                                    const FetchCallback& callback) {
   if (resolved_url.SchemeIsFile()) {
     new LocalFetcher(resolved_url, GetBaseURLAndQuery(resolved_url, nullptr),
                      callback);
@@ -324,10 +388,22 @@ void ApplicationManager::HandleFetchCallback(
       RegisterShell(fetcher->GetURL(), requestor_url, services.Pass(),
                     exposed_services.Pass(), on_application_end, parameters));
 
-  // If the response begins with a #!mojo <content-handler-url>, use it.
-  GURL content_handler_url;
-  std::string shebang;
-  if (fetcher->PeekContentHandler(&shebang, &content_handler_url)) {
+  // If the response begins with a #!mojo <content-handler-url>, use it. (This
+  // doesn't block: we carry on once the beginning of the response arrives.)
+  Fetcher* raw_fetcher = fetcher.get();
+  raw_fetcher->PeekContentHandler(
+      blocking_pool_,
+      base::Bind(&ApplicationManager::LoadFetchedApplication,
+                 weak_ptr_factory_.GetWeakPtr(), base::Passed(request.Pass()),
+                 base::Passed(fetcher.Pass())));
+}
+
+void ApplicationManager::LoadFetchedApplication(
+    InterfaceRequest<Application> request,
+    scoped_ptr<Fetcher> fetcher,
+    const std::string& shebang,
+    const GURL& content_handler_url) {
+  if (content_handler_url.is_valid()) {
     LoadWithContentHandler(
         content_handler_url, request.Pass(),
         fetcher->AsURLResponse(blocking_pool_,
@@ -510,4 +586,171 @@ void ApplicationManager::CleanupRunner(NativeRunner* runner) {
       std::find(native_runners_.begin(), native_runners_.end(), runner));
 }
 
+DependencyProfiles* ApplicationManager::GetDependencyProfiles() {
+  if (!dependency_profiles_ && blocking_pool_ &&
+      !options_.dependency_profiles_directory.empty()) {
+    dependency_profiles_.reset(new DependencyProfiles(
+        blocking_pool_->GetSequencedTaskRunner(
+            blocking_pool_->GetSequenceToken()),
+        options_.dependency_profiles_directory));
+  }
+  return dependency_profiles_.get();
+}
+
+void ApplicationManager::RecordDependency(const GURL& requestor_url,
+                                          const GURL& requested_url) {
+  if (requestor_url.is_empty() || !GetDependencyProfiles())
+    return;
+
+  ShellImpl* requestor = GetShellImpl(requestor_url);
+  if (!requestor ||
+      base::TimeTicks::Now() - requestor->start_time() >
+          base::TimeDelta::FromSeconds(kDependencyRecordingPeriodSeconds)) {
+    return;
+  }
+  GetDependencyProfiles()->AddDependency(
+      GetBaseURLAndQuery(requestor_url, nullptr), requested_url);
+}
+
+void ApplicationManager::PrefetchDependencies(const GURL& resolved_url) {
+  if (!GetDependencyProfiles())
+    return;
+
+  GURL app_url = GetBaseURLAndQuery(resolved_url, nullptr);
+  GetDependencyProfiles()->RecordStart(app_url);
+  GetDependencyProfiles()->GetDependencies(
+      app_url, base::Bind(&ApplicationManager::PrefetchApplications,
+                          weak_ptr_factory_.GetWeakPtr()));
+}
+
+void ApplicationManager::PrefetchApplications(
+    const std::vector<GURL>& requested_urls) {
+  std::vector<base::FilePath> local_paths;
+  for (const GURL& requested_url : requested_urls)
+    PrefetchApplication(requested_url, &local_paths);
+
+  // The read-ahead of all the local applications is done by one worker (and
+  // doesn't hold up shutdown), so that it doesn't compete with the blocking
+  // pool's other work.
+#if defined(OS_LINUX)
+  if (!local_paths.empty()) {
+    blocking_pool_->PostWorkerTaskWithShutdownBehavior(
+        FROM_HERE, base::Bind(&ReadAheadFiles, local_paths),
+        base::SequencedWorkerPool::CONTINUE_ON_SHUTDOWN);
+  }
+#endif
+}
+
+void ApplicationManager::PrefetchApplication(
+    const GURL& requested_url,
+    std::vector<base::FilePath>* local_paths) {
+  // Only applications that would be fetched (i.e., that aren't running and
+  // don't have a loader) are prefetched.
+  GURL mapped_url = delegate_->ResolveMappings(requested_url);
+  if (GetShellImpl(GetBaseURLAndQuery(mapped_url, nullptr)) ||
+      GetLoaderForURL(mapped_url)) {
+    return;
+  }
+  GURL resolved_url = delegate_->ResolveMojoURL(mapped_url);
+  if (GetShellImpl(GetBaseURLAndQuery(resolved_url, nullptr)) ||
+      GetLoaderForURL(resolved_url) || default_loader_ ||
+      url_to_prefetched_application_.find(resolved_url) !=
+          url_to_prefetched_application_.end()) {
+    return;
+  }
+
+  TRACE_EVENT1("mojo_shell", "ApplicationManager::PrefetchApplication", "url",
+               resolved_url.spec());
+  // A local application doesn't need fetching, but it can be read ahead so
+  // that it loads faster.
+  if (resolved_url.SchemeIsFile()) {
+    local_paths->push_back(
+        LocalFetcher::UrlToFile(GetBaseURLAndQuery(resolved_url, nullptr)));
+    return;
+  }
+
+  uint64_t prefetch_id = next_prefetch_id_++;
+  url_to_prefetched_application_[resolved_url] =
+      make_scoped_ptr(new PrefetchedApplication(prefetch_id));
+  StartFetch(resolved_url,
+             base::Bind(&ApplicationManager::OnPrefetchFetched,
+                        weak_ptr_factory_.GetWeakPtr(), resolved_url,
+                        prefetch_id));
+}
+
+void ApplicationManager::OnPrefetchFetched(const GURL& resolved_url,
+                                           uint64_t prefetch_id,
+                                           scoped_ptr<Fetcher> fetcher) {
+  auto it = url_to_prefetched_application_.find(resolved_url);
+  if (it == url_to_prefetched_application_.end() ||
+      it->second->id != prefetch_id) {
+    return;
+  }
+
+  FetchCallback callback = it->second->callback;
+  if (!fetcher || !callback.is_null()) {
+    url_to_prefetched_application_.erase(it);
+    // If a connection is waiting, give it the fetcher (or, if the prefetch
+    // failed, try again).
+    if (!callback.is_null()) {
+      if (fetcher)
+        callback.Run(fetcher.Pass());
+      else
+        StartFetch(resolved_url, callback);
+    }
+    return;
+  }
+
+  it->second->fetcher = fetcher.Pass();
+  base::MessageLoop::current()->task_runner()->PostDelayedTask(
+      FROM_HERE,
+      base::Bind(&ApplicationManager::ExpirePrefetchedApplication,
+                 weak_ptr_factory_.GetWeakPtr(), resolved_url, prefetch_id),
+      base::TimeDelta::FromSeconds(kPrefetchedApplicationLifetimeSeconds));
+}
+
+void ApplicationManager::ExpirePrefetchedApplication(const GURL& resolved_url,
+                                                     uint64_t prefetch_id) {
+  auto it = url_to_prefetched_application_.find(resolved_url);
+  if (it == url_to_prefetched_application_.end() ||
+      it->second->id != prefetch_id) {
+    return;
+  }
+
+  DVLOG(1) << "Dropping unused prefetched application " << resolved_url;
+  TRACE_EVENT_INSTANT1("mojo_shell",
+                       "ApplicationManager::ExpirePrefetchedApplication",
+                       TRACE_EVENT_SCOPE_THREAD, "url", resolved_url.spec());
+  url_to_prefetched_application_.erase(it);
+}
+
+bool ApplicationManager::UsePrefetchedApplication(
+    const GURL& resolved_url,
+    const FetchCallback& callback) {
+  // Local applications aren't prefetched as such.
+  if (!GetDependencyProfiles() || resolved_url.SchemeIsFile())
+    return false;
+
+  auto it = url_to_prefetched_application_.find(resolved_url);
+  // Only one connection can wait for a prefetch; others fetch as usual.
+  bool hit = it != url_to_prefetched_application_.end() &&
+             it->second->callback.is_null();
+  TRACE_EVENT_INSTANT2(
+      "mojo_shell", "ApplicationManager::UsePrefetchedApplication",
+      TRACE_EVENT_SCOPE_THREAD, "url", resolved_url.spec(), "hit", hit);
+  if (!hit)
+    return false;
+
+  if (!it->second->fetcher) {
+    // Still being fetched.
+    it->second->callback = callback;
+    return true;
+  }
+
+  scoped_ptr<Fetcher> fetcher = it->second->fetcher.Pass();
+  url_to_prefetched_application_.erase(it);
+  callback.Run(fetcher.Pass());
+  return true;
+}
+
 }  // namespace shell
@@ -7,6 +7,8 @@
 
 #include <map>
 
+#include "base/callback.h"
+#include "base/files/file_path.h"
 #include "base/macros.h"
 #include "base/memory/scoped_ptr.h"
 #include "base/memory/scoped_vector.h"
@@ -23,12 +25,12 @@
 #include "url/gurl.h"
 
 namespace base {
-class FilePath;
 class SequencedWorkerPool;
 }
 
 namespace shell {
 
+class DependencyProfiles;
 class Fetcher;
 class ShellImpl;
 
@@ -38,6 +40,10 @@ class ApplicationManager {
     Options() : disable_cache(false) {}
 
     bool disable_cache;
+    // If set, the URLs that each application connects to as it starts are
+    // recorded in profiles in this directory, and they are then fetched
+    // ahead of time (in parallel) whenever the application is started again.
+    base::FilePath dependency_profiles_directory;
   };
 
   class Delegate {
@@ -139,6 +145,7 @@ class ApplicationManager {
 
  private:
   class ContentHandlerConnection;
+  struct PrefetchedApplication;
 
   typedef std::map<GURL, scoped_ptr<ApplicationLoader>> URLToLoaderMap;
   typedef std::map<std::string, scoped_ptr<ApplicationLoader>>
@@ -149,6 +156,9 @@ class ApplicationManager {
   typedef std::map<GURL, std::vector<std::string>> URLToArgsMap;
   typedef std::map<std::string, GURL> MimeTypeToURLMap;
   typedef std::map<GURL, NativeRunnerFactory::Options> URLToNativeOptionsMap;
+  typedef std::map<GURL, scoped_ptr<PrefetchedApplication>>
+      URLToPrefetchedApplicationMap;
+  typedef base::Callback<void(scoped_ptr<Fetcher>)> FetchCallback;
 
   void ConnectToApplicationWithParameters(
       const GURL& application_url,
@@ -190,6 +200,9 @@ class ApplicationManager {
                        mojo::InterfaceRequest<mojo::ServiceProvider> services,
                        mojo::ServiceProviderPtr exposed_services);
 
+  // Starts fetching the application at |resolved_url|.
+  void StartFetch(const GURL& resolved_url, const FetchCallback& callback);
+
   void HandleFetchCallback(
       const GURL& requestor_url,
       mojo::InterfaceRequest<mojo::ServiceProvider> services,
@@ -198,6 +211,15 @@ class ApplicationManager {
       const std::vector<std::string>& parameters,
       scoped_ptr<Fetcher> fetcher);
 
+  // Loads the application fetched by |fetcher|, once we know whether it
+  // specifies a content handler (in which case |content_handler_url| is
+  // valid).
+  void LoadFetchedApplication(
+      mojo::InterfaceRequest<mojo::Application> request,
+      scoped_ptr<Fetcher> fetcher,
+      const std::string& shebang,
+      const GURL& content_handler_url);
+
   void RunNativeApplication(
       mojo::InterfaceRequest<mojo::Application> application_request,
       const NativeRunnerFactory::Options& options,
@@ -222,6 +244,34 @@ class ApplicationManager {
 
   void CleanupRunner(NativeRunner* runner);
 
+  // Dependency prefetching ----------------------------------------------------
+
+  // Returns null if prefetching is disabled.
+  DependencyProfiles* GetDependencyProfiles();
+
+  // Records that the application at |requestor_url| connected to
+  // |requested_url|, if it's still starting.
+  void RecordDependency(const GURL& requestor_url, const GURL& requested_url);
+
+  // Starts prefetching the recorded dependencies of the application at
+  // |resolved_url| (which is being started).
+  void PrefetchDependencies(const GURL& resolved_url);
+  void PrefetchApplications(const std::vector<GURL>& requested_urls);
+  // Starts prefetching the application at |requested_url|, or adds its path to
+  // |local_paths| if it's local (so that it can be read ahead).
+  void PrefetchApplication(const GURL& requested_url,
+                           std::vector<base::FilePath>* local_paths);
+  void OnPrefetchFetched(const GURL& resolved_url,
+                         uint64_t prefetch_id,
+                         scoped_ptr<Fetcher> fetcher);
+  void ExpirePrefetchedApplication(const GURL& resolved_url,
+                                   uint64_t prefetch_id);
+
+  // If the application at |resolved_url| has been (or is being) prefetched,
+  // arranges for |callback| to get its fetcher and returns true.
+  bool UsePrefetchedApplication(const GURL& resolved_url,
+                                const FetchCallback& callback);
+
   const Options options_;
   Delegate* const delegate_;
   // Loader management.
@@ -243,6 +293,10 @@ class ApplicationManager {
   MimeTypeToURLMap mime_type_to_url_;
   ScopedVector<NativeRunner> native_runners_;
   bool initialized_authentication_interceptor_;
+  scoped_ptr<DependencyProfiles> dependency_profiles_;
+  // Note: The keys are URLs after mapping and resolving.
+  URLToPrefetchedApplicationMap url_to_prefetched_application_;
+  uint64_t next_prefetch_id_;
   base::WeakPtrFactory<ApplicationManager> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(ApplicationManager);
@@ -7,7 +7,9 @@
 #include <stdint.h>
 
 #include "base/bind.h"
+#include "base/location.h"
 #include "base/macros.h"
+#include "base/time/time.h"
 
 namespace shell {
 
@@ -137,6 +139,10 @@ PeekStatus PeekNBytes(size_t bytes_length,
   return PeekStatus::kKeepReading;
 }
 
+// How long |DataPipePeek| waits before looking again when the data available
+// isn't enough.
+const int kRetryDelayMs = 10;
+
 }  // namespace
 
 bool BlockingPeekNBytes(mojo::DataPipeConsumerHandle source,
@@ -155,4 +161,105 @@ bool BlockingPeekLine(mojo::DataPipeConsumerHandle source,
   return BlockingPeekHelper(source, line, timeout, peek_line);
 }
 
+DataPipePeek::DataPipePeek()
+    : type_(PEEK_LINE), length_(0) {
+}
+
+DataPipePeek::~DataPipePeek() {
+}
+
+void DataPipePeek::PeekLine(mojo::DataPipeConsumerHandle source,
+                            size_t max_line_length,
+                            const PeekCallback& callback) {
+  Start(source, PEEK_LINE, max_line_length, callback);
+}
+
+void DataPipePeek::PeekNBytes(mojo::DataPipeConsumerHandle source,
+                              size_t bytes_length,
+                              const PeekCallback& callback) {
+  Start(source, PEEK_N_BYTES, bytes_length, callback);
+}
+
+void DataPipePeek::Start(mojo::DataPipeConsumerHandle source,
+                         PeekType type,
+                         size_t length,
+                         const PeekCallback& callback) {
+  DCHECK(!is_peeking());
+  DCHECK(!callback.is_null());
+  source_ = source;
+  type_ = type;
+  length_ = length;
+  callback_ = callback;
+  // Even if there's data already, look at it from the message loop, so that
+  // |callback| isn't called synchronously.
+  WaitForData();
+}
+
+void DataPipePeek::WaitForData() {
+  handle_watcher_.Start(
+      source_, MOJO_HANDLE_SIGNAL_READABLE, MOJO_DEADLINE_INDEFINITE,
+      base::Bind(&DataPipePeek::OnHandleReady, base::Unretained(this)));
+}
+
+void DataPipePeek::OnHandleReady(MojoResult result) {
+  if (result != MOJO_RESULT_OK) {
+    Finish(false, std::string());
+    return;
+  }
+  Peek();
+}
+
+void DataPipePeek::Peek() {
+  const void* buffer;
+  uint32_t num_bytes;
+  MojoResult result =
+      BeginReadDataRaw(source_, &buffer, &num_bytes, MOJO_READ_DATA_FLAG_NONE);
+  if (result == MOJO_RESULT_SHOULD_WAIT) {
+    WaitForData();
+    return;
+  }
+  if (result != MOJO_RESULT_OK) {
+    Finish(false, std::string());
+    return;
+  }
+
+  std::string value;
+  PeekStatus status =
+      (type_ == PEEK_LINE)
+          ? shell::PeekLine(length_, buffer, num_bytes, &value)
+          : shell::PeekNBytes(length_, buffer, num_bytes, &value);
+  CHECK_EQ(EndReadDataRaw(source_, 0), MOJO_RESULT_OK);
+  switch (status) {
+    case PeekStatus::kSuccess:
+      Finish(true, value);
+      return;
+    case PeekStatus::kFail:
+      Finish(false, std::string());
+      return;
+    case PeekStatus::kKeepReading:
+      break;
+  }
+
+  // More data is needed, but the data pipe won't signal when it arrives, so
+  // look again shortly, unless no more data can arrive.
+  if (Wait(source_, MOJO_HANDLE_SIGNAL_PEER_CLOSED, 0, nullptr) ==
+      MOJO_RESULT_OK) {
+    Finish(false, std::string());
+    return;
+  }
+  retry_timer_.Start(FROM_HERE,
+                     base::TimeDelta::FromMilliseconds(kRetryDelayMs), this,
+                     &DataPipePeek::Peek);
+}
+
+void DataPipePeek::Finish(bool success, const std::string& value) {
+  // Reset our state first, since |callback| may start a new peek or destroy
+  // us.
+  PeekCallback callback = callback_;
+  callback_.Reset();
+  handle_watcher_.Stop();
+  retry_timer_.Stop();
+  callback.Run(success, value);
+}
+
 }  // namespace shell
@@ -5,8 +5,14 @@
 #ifndef SHELL_APPLICATION_MANAGER_DATA_PIPE_SEEK_H_
 #define SHELL_APPLICATION_MANAGER_DATA_PIPE_SEEK_H_
 
+#include <stddef.h>
+
 #include <string>
 
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/timer/timer.h"
+#include "mojo/common/handle_watcher.h"
 #include "mojo/public/cpp/system/core.h"
 
 namespace shell {
@@ -31,6 +37,62 @@ bool BlockingPeekNBytes(mojo::DataPipeConsumerHandle source,
                         size_t bytes_length,
                         MojoDeadline timeout);
 
+// Peeks at the beginning of a data pipe like the functions above, but
+// asynchronously, so that no thread is blocked while waiting for the data: it
+// waits for the data pipe to become readable with a |HandleWatcher|. As a data
+// pipe can't signal that more data has arrived, when the data available isn't
+// enough, it looks again after a short delay (until there's enough data or the
+// producer is closed).
+//
+// This must be used on a thread with a message loop. Destroying it cancels the
+// peek in progress, if any.
+class DataPipePeek {
+ public:
+  // Called with true and the value peeked, or false and an empty string.
+  typedef base::Callback<void(bool, const std::string&)> PeekCallback;
+
+  DataPipePeek();
+  ~DataPipePeek();
+
+  // Calls |callback| with the first newline terminated line from |source|, or
+  // fails if more than |max_line_length| bytes are scanned without seeing a
+  // newline. |callback| is never called synchronously, and a new peek may be
+  // started from it.
+  void PeekLine(mojo::DataPipeConsumerHandle source,
+                size_t max_line_length,
+                const PeekCallback& callback);
+
+  // Calls |callback| with the first |bytes_length| bytes from |source|. Like
+  // |PeekLine()|, otherwise.
+  void PeekNBytes(mojo::DataPipeConsumerHandle source,
+                  size_t bytes_length,
+                  const PeekCallback& callback);
+
+  bool is_peeking() const { return !callback_.is_null(); }
+
+ private:
+  enum PeekType { PEEK_LINE, PEEK_N_BYTES };
+
+  void Start(mojo::DataPipeConsumerHandle source,
+             PeekType type,
+             size_t length,
+             const PeekCallback& callback);
+  void WaitForData();
+  void OnHandleReady(MojoResult result);
+  void Peek();
+  void Finish(bool success, const std::string& value);
+
+  mojo::DataPipeConsumerHandle source_;
+  PeekType type_;
+  size_t length_;
+  PeekCallback callback_;
+
+  mojo::common::HandleWatcher handle_watcher_;
+  base::OneShotTimer<DataPipePeek> retry_timer_;
+
+  DISALLOW_COPY_AND_ASSIGN(DataPipePeek);
+};
+
 }  // namespace shell
 
 #endif  // SHELL_APPLICATION_MANAGER_DATA_PIPE_SEEK_H_
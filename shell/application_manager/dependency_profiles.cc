@@ -0,0 +1,237 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shell/application_manager/dependency_profiles.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/sequenced_task_runner.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/task_runner_util.h"
+#include "crypto/sha2.h"
+
+namespace shell {
+
+namespace {
+
+// A profile file consists of the application's URL followed by its
+// dependencies, one per line, each given as its age and its URL (separated by a
+// space). This returns the dependency lines.
+std::vector<std::string> ReadProfile(const base::FilePath& path,
+                                     const std::string& app_url) {
+  std::vector<std::string> lines;
+  std::string contents;
+  if (!base::ReadFileToString(path, &contents))
+    return lines;
+  base::SplitString(contents, '\n', &lines);
+  // Ignore a profile that's for another application (on a hash collision).
+  if (lines.empty() || lines[0] != app_url)
+    return std::vector<std::string>();
+  lines.erase(lines.begin());
+  lines.erase(std::remove(lines.begin(), lines.end(), std::string()),
+              lines.end());
+  return lines;
+}
+
+void CreateProfilesDirectory(const base::FilePath& directory) {
+  // We can ignore errors: the profiles are only an optimization (and failing
+  // to write them is also ignored).
+  base::CreateDirectory(directory);
+}
+
+}  // namespace
+
+// static
+const size_t DependencyProfiles::kMaxDependencies = 50;
+// static
+const int DependencyProfiles::kMaxDependencyAge = 5;
+
+class DependencyProfiles::Profile
+    : public base::ImportantFileWriter::DataSerializer {
+ public:
+  Profile(const GURL& app_url,
+          const base::FilePath& path,
+          const scoped_refptr<base::SequencedTaskRunner>& task_runner)
+      : loaded(false),
+        num_pending_starts(0),
+        app_url_(app_url),
+        writer_(path, task_runner) {}
+
+  ~Profile() override {
+    if (writer_.HasPendingWrite())
+      writer_.DoScheduledWrite();
+  }
+
+  void ScheduleSave() { writer_.ScheduleWrite(this); }
+
+  // Ages the dependencies by |num_starts| starts, dropping those that get too
+  // old.
+  void Age(int num_starts) {
+    if (dependencies.empty())
+      return;
+    for (Dependency& dependency : dependencies)
+      dependency.age += num_starts;
+    dependencies.erase(
+        std::remove_if(dependencies.begin(), dependencies.end(),
+                       [](const Dependency& dependency) {
+                         return dependency.age >= kMaxDependencyAge;
+                       }),
+        dependencies.end());
+    ScheduleSave();
+  }
+
+  // |base::ImportantFileWriter::DataSerializer|:
+  bool SerializeData(std::string* data) override {
+    *data = app_url_.spec() + "\n";
+    for (const Dependency& dependency : dependencies) {
+      *data += base::IntToString(dependency.age) + " " +
+               dependency.url.spec() + "\n";
+    }
+    return true;
+  }
+
+  bool loaded;
+  std::vector<Dependency> dependencies;
+  // Starts recorded, and dependencies added, before the profile was loaded.
+  int num_pending_starts;
+  std::vector<GURL> added_dependencies;
+  std::vector<GetDependenciesCallback> pending_callbacks;
+
+ private:
+  const GURL app_url_;
+  // Writes the profile (in batches).
+  base::ImportantFileWriter writer_;
+
+  DISALLOW_COPY_AND_ASSIGN(Profile);
+};
+
+DependencyProfiles::DependencyProfiles(
+    scoped_refptr<base::SequencedTaskRunner> task_runner,
+    const base::FilePath& directory)
+    : task_runner_(task_runner), directory_(directory), weak_factory_(this) {
+  task_runner_->PostTask(FROM_HERE,
+                         base::Bind(&CreateProfilesDirectory, directory_));
+}
+
+DependencyProfiles::~DependencyProfiles() {
+}
+
+void DependencyProfiles::GetDependencies(
+    const GURL& app_url,
+    const GetDependenciesCallback& callback) {
+  Profile* profile = GetProfile(app_url);
+  if (!profile->loaded) {
+    profile->pending_callbacks.push_back(callback);
+    return;
+  }
+
+  std::vector<GURL> dependencies;
+  for (const Dependency& dependency : profile->dependencies)
+    dependencies.push_back(dependency.url);
+  callback.Run(dependencies);
+}
+
+void DependencyProfiles::RecordStart(const GURL& app_url) {
+  Profile* profile = GetProfile(app_url);
+  if (profile->loaded)
+    profile->Age(1);
+  else
+    profile->num_pending_starts++;
+}
+
+void DependencyProfiles::AddDependency(const GURL& app_url,
+                                       const GURL& dependency_url) {
+  DCHECK(dependency_url.is_valid());
+  Profile* profile = GetProfile(app_url);
+  // If the profile isn't loaded yet, the dependency is added once it is.
+  if (!profile->loaded) {
+    std::vector<GURL>& added = profile->added_dependencies;
+    if (added.size() < kMaxDependencies &&
+        std::find(added.begin(), added.end(), dependency_url) == added.end()) {
+      added.push_back(dependency_url);
+    }
+    return;
+  }
+
+  std::vector<Dependency>& dependencies = profile->dependencies;
+  auto it = std::find_if(dependencies.begin(), dependencies.end(),
+                         [&dependency_url](const Dependency& dependency) {
+                           return dependency.url == dependency_url;
+                         });
+  if (it != dependencies.end()) {
+    if (it->age == 0)
+      return;
+    it->age = 0;
+  } else {
+    if (dependencies.size() >= kMaxDependencies)
+      return;
+    Dependency dependency = {dependency_url, 0};
+    dependencies.push_back(dependency);
+  }
+  profile->ScheduleSave();
+}
+
+DependencyProfiles::Profile* DependencyProfiles::GetProfile(
+    const GURL& app_url) {
+  scoped_ptr<Profile>& profile = profiles_[app_url];
+  if (profile)
+    return profile.get();
+
+  profile.reset(new Profile(app_url, GetProfilePath(app_url), task_runner_));
+  base::PostTaskAndReplyWithResult(
+      task_runner_.get(), FROM_HERE,
+      base::Bind(&ReadProfile, GetProfilePath(app_url), app_url.spec()),
+      base::Bind(&DependencyProfiles::DidLoadProfile,
+                 weak_factory_.GetWeakPtr(), app_url));
+  return profile.get();
+}
+
+void DependencyProfiles::DidLoadProfile(const GURL& app_url,
+                                        const std::vector<std::string>& lines) {
+  Profile* profile = profiles_[app_url].get();
+  DCHECK(profile && !profile->loaded);
+  profile->loaded = true;
+
+  for (const std::string& line : lines) {
+    size_t space = line.find(' ');
+    Dependency dependency;
+    if (space == std::string::npos ||
+        !base::StringToInt(line.substr(0, space), &dependency.age) ||
+        dependency.age < 0) {
+      continue;
+    }
+    dependency.url = GURL(line.substr(space + 1));
+    if (dependency.url.is_valid() &&
+        profile->dependencies.size() < kMaxDependencies) {
+      profile->dependencies.push_back(dependency);
+    }
+  }
+
+  if (profile->num_pending_starts) {
+    profile->Age(profile->num_pending_starts);
+    profile->num_pending_starts = 0;
+  }
+  std::vector<GURL> added_dependencies;
+  added_dependencies.swap(profile->added_dependencies);
+  for (const GURL& dependency_url : added_dependencies)
+    AddDependency(app_url, dependency_url);
+
+  std::vector<GetDependenciesCallback> callbacks;
+  callbacks.swap(profile->pending_callbacks);
+  for (const GetDependenciesCallback& callback : callbacks)
+    GetDependencies(app_url, callback);
+}
+
+base::FilePath DependencyProfiles::GetProfilePath(const GURL& app_url) const {
+  std::string hash = crypto::SHA256HashString(app_url.spec());
+  return directory_.AppendASCII(base::HexEncode(hash.data(), hash.size()));
+}
+
+}  // namespace shell
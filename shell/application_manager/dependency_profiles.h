@@ -0,0 +1,98 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHELL_APPLICATION_MANAGER_DEPENDENCY_PROFILES_H_
+#define SHELL_APPLICATION_MANAGER_DEPENDENCY_PROFILES_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/weak_ptr.h"
+#include "url/gurl.h"
+
+namespace base {
+class SequencedTaskRunner;
+}
+
+namespace shell {
+
+// Records the URLs that each application connects to as it starts (its
+// dependencies), so that they can be fetched ahead of time the next time the
+// application is started. Each application's dependency profile is kept in a
+// file in |directory| (which is read and written on |task_runner|). Changes to
+// a profile are written in batches, at most once per commit interval of
+// |base::ImportantFileWriter| (and when this object is destroyed).
+//
+// A dependency that isn't recorded again in |kMaxDependencyAge| starts of its
+// application is dropped from the profile.
+//
+// This must be used on a single thread.
+class DependencyProfiles {
+ public:
+  typedef base::Callback<void(const std::vector<GURL>&)>
+      GetDependenciesCallback;
+
+  // The maximum number of dependencies recorded for an application.
+  static const size_t kMaxDependencies;
+
+  // The number of starts of an application after which a dependency that
+  // hasn't been recorded again is dropped.
+  static const int kMaxDependencyAge;
+
+  DependencyProfiles(scoped_refptr<base::SequencedTaskRunner> task_runner,
+                     const base::FilePath& directory);
+  ~DependencyProfiles();
+
+  // Calls |callback| with the dependencies of the application at |app_url|
+  // (which should not have a query), in the order that they were first
+  // recorded. This loads the profile first if needed; otherwise |callback| is
+  // called synchronously.
+  void GetDependencies(const GURL& app_url,
+                       const GetDependenciesCallback& callback);
+
+  // Records that the application at |app_url| is being started, which ages its
+  // dependencies (dropping those that are too old). This should be called
+  // before the dependencies of this start are added.
+  void RecordStart(const GURL& app_url);
+
+  // Records |dependency_url| as a dependency of the application at |app_url|
+  // (if it isn't already), and schedules the profile to be saved.
+  void AddDependency(const GURL& app_url, const GURL& dependency_url);
+
+ private:
+  struct Dependency {
+    GURL url;
+    // The number of starts of the application since the dependency was last
+    // recorded.
+    int age;
+  };
+
+  class Profile;
+
+  // Returns the profile for |app_url|, starting to load it if needed.
+  Profile* GetProfile(const GURL& app_url);
+  void DidLoadProfile(const GURL& app_url,
+                      const std::vector<std::string>& lines);
+
+  base::FilePath GetProfilePath(const GURL& app_url) const;
+
+  scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  const base::FilePath directory_;
+
+  std::map<GURL, scoped_ptr<Profile>> profiles_;
+
+  base::WeakPtrFactory<DependencyProfiles> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(DependencyProfiles);
+};
+
+}  // namespace shell
+
+#endif  // SHELL_APPLICATION_MANAGER_DEPENDENCY_PROFILES_H_
@@ -0,0 +1,171 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shell/application_manager/dependency_profiles.h"
+
+#include "base/bind.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace shell {
+namespace {
+
+void CopyDependencies(std::vector<GURL>* result,
+                      bool* called,
+                      const std::vector<GURL>& dependencies) {
+  *result = dependencies;
+  *called = true;
+}
+
+class DependencyProfilesTest : public testing::Test {
+ public:
+  DependencyProfilesTest() {}
+  ~DependencyProfilesTest() override {}
+
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+ protected:
+  scoped_ptr<DependencyProfiles> CreateProfiles() {
+    return make_scoped_ptr(
+        new DependencyProfiles(message_loop_.task_runner(), temp_dir_.path()));
+  }
+
+  std::vector<GURL> GetDependencies(DependencyProfiles* profiles,
+                                    const GURL& app_url) {
+    std::vector<GURL> result;
+    bool called = false;
+    profiles->GetDependencies(
+        app_url, base::Bind(&CopyDependencies, &result, &called));
+    base::RunLoop().RunUntilIdle();
+    EXPECT_TRUE(called);
+    return result;
+  }
+
+  size_t CountProfileFiles() {
+    base::RunLoop().RunUntilIdle();
+    size_t count = 0;
+    base::FileEnumerator enumerator(temp_dir_.path(), false,
+                                    base::FileEnumerator::FILES);
+    while (!enumerator.Next().empty())
+      count++;
+    return count;
+  }
+
+ private:
+  base::MessageLoop message_loop_;
+  base::ScopedTempDir temp_dir_;
+
+  DISALLOW_COPY_AND_ASSIGN(DependencyProfilesTest);
+};
+
+TEST_F(DependencyProfilesTest, Basic) {
+  const GURL kApp1("http://example.com/app1.mojo");
+  const GURL kApp2("http://example.com/app2.mojo");
+  const GURL kDependency1("mojo:dependency1");
+  const GURL kDependency2("http://example.com/dependency2.mojo");
+
+  {
+    scoped_ptr<DependencyProfiles> profiles = CreateProfiles();
+    EXPECT_TRUE(GetDependencies(profiles.get(), kApp1).empty());
+
+    profiles->AddDependency(kApp1, kDependency2);
+    profiles->AddDependency(kApp1, kDependency1);
+    profiles->AddDependency(kApp1, kDependency2);
+    // Added before the profile is loaded.
+    profiles->AddDependency(kApp2, kDependency1);
+
+    std::vector<GURL> dependencies = GetDependencies(profiles.get(), kApp1);
+    ASSERT_EQ(2u, dependencies.size());
+    EXPECT_EQ(kDependency2, dependencies[0]);
+    EXPECT_EQ(kDependency1, dependencies[1]);
+    base::RunLoop().RunUntilIdle();
+  }
+
+  // The profiles should have been saved.
+  {
+    scoped_ptr<DependencyProfiles> profiles = CreateProfiles();
+    std::vector<GURL> dependencies = GetDependencies(profiles.get(), kApp1);
+    ASSERT_EQ(2u, dependencies.size());
+    EXPECT_EQ(kDependency2, dependencies[0]);
+    EXPECT_EQ(kDependency1, dependencies[1]);
+
+    dependencies = GetDependencies(profiles.get(), kApp2);
+    ASSERT_EQ(1u, dependencies.size());
+    EXPECT_EQ(kDependency1, dependencies[0]);
+
+    EXPECT_TRUE(
+        GetDependencies(profiles.get(), GURL("mojo:no_such_app")).empty());
+  }
+}
+
+TEST_F(DependencyProfilesTest, MaxDependencies) {
+  const GURL kApp("http://example.com/app.mojo");
+
+  scoped_ptr<DependencyProfiles> profiles = CreateProfiles();
+  for (size_t i = 0; i < DependencyProfiles::kMaxDependencies + 10; i++) {
+    profiles->AddDependency(kApp, GURL(base::StringPrintf(
+                                      "mojo:dependency%d", static_cast<int>(i))));
+  }
+  std::vector<GURL> dependencies = GetDependencies(profiles.get(), kApp);
+  ASSERT_EQ(DependencyProfiles::kMaxDependencies, dependencies.size());
+  EXPECT_EQ(GURL("mojo:dependency0"), dependencies[0]);
+}
+
+TEST_F(DependencyProfilesTest, AgesOutDependencies) {
+  const GURL kApp("http://example.com/app.mojo");
+  const GURL kDependency1("mojo:dependency1");
+  const GURL kDependency2("mojo:dependency2");
+
+  {
+    scoped_ptr<DependencyProfiles> profiles = CreateProfiles();
+    profiles->RecordStart(kApp);
+    profiles->AddDependency(kApp, kDependency1);
+    profiles->AddDependency(kApp, kDependency2);
+    EXPECT_EQ(2u, GetDependencies(profiles.get(), kApp).size());
+  }
+
+  // Only |kDependency1| is recorded again, so |kDependency2| is dropped once
+  // the application has been started |kMaxDependencyAge| times without it.
+  for (int i = 0; i < DependencyProfiles::kMaxDependencyAge; i++) {
+    scoped_ptr<DependencyProfiles> profiles = CreateProfiles();
+    profiles->RecordStart(kApp);
+    std::vector<GURL> dependencies = GetDependencies(profiles.get(), kApp);
+    if (i < DependencyProfiles::kMaxDependencyAge - 1) {
+      ASSERT_EQ(2u, dependencies.size());
+    } else {
+      ASSERT_EQ(1u, dependencies.size());
+      EXPECT_EQ(kDependency1, dependencies[0]);
+    }
+    profiles->AddDependency(kApp, kDependency1);
+  }
+
+  // Recording a dependency again keeps it.
+  scoped_ptr<DependencyProfiles> profiles = CreateProfiles();
+  std::vector<GURL> dependencies = GetDependencies(profiles.get(), kApp);
+  ASSERT_EQ(1u, dependencies.size());
+  EXPECT_EQ(kDependency1, dependencies[0]);
+}
+
+TEST_F(DependencyProfilesTest, BatchesWrites) {
+  const GURL kApp("http://example.com/app.mojo");
+
+  scoped_ptr<DependencyProfiles> profiles = CreateProfiles();
+  EXPECT_TRUE(GetDependencies(profiles.get(), kApp).empty());
+  profiles->RecordStart(kApp);
+  profiles->AddDependency(kApp, GURL("mojo:dependency1"));
+  profiles->AddDependency(kApp, GURL("mojo:dependency2"));
+  // Nothing is written until the commit interval has passed ...
+  EXPECT_EQ(0u, CountProfileFiles());
+
+  // ... or the profiles are destroyed.
+  profiles.reset();
+  EXPECT_EQ(1u, CountProfileFiles());
+}
+
+}  // namespace
+}  // namespace shell
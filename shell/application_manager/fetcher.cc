@@ -4,6 +4,7 @@
 
 #include "shell/application_manager/fetcher.h"
 
+#include "base/bind.h"
 #include "url/gurl.h"
 
 namespace shell {
@@ -18,19 +19,23 @@ Fetcher::Fetcher(const FetchCallback& loader_callback)
 Fetcher::~Fetcher() {
 }
 
-bool Fetcher::PeekContentHandler(std::string* mojo_shebang,
-                                 GURL* mojo_content_handler_url) {
+void Fetcher::PeekContentHandler(base::TaskRunner* task_runner,
+                                 const PeekContentHandlerCallback& callback) {
   // TODO(aa): I guess this should just go in ApplicationManager now.
-  std::string shebang;
-  if (HasMojoMagic() && PeekFirstLine(&shebang)) {
+  PeekShebang(task_runner, base::Bind(&Fetcher::DidPeekShebang, callback));
+}
+
+// static
+void Fetcher::DidPeekShebang(const PeekContentHandlerCallback& callback,
+                             const std::string& shebang) {
+  if (!shebang.empty()) {
     GURL url(shebang.substr(arraysize(kMojoMagic) - 1, std::string::npos));
     if (url.is_valid()) {
-      *mojo_shebang = shebang;
-      *mojo_content_handler_url = url;
-      return true;
+      callback.Run(shebang, url);
+      return;
     }
   }
-  return false;
+  callback.Run(std::string(), GURL());
 }
 
 }  // namespace shell
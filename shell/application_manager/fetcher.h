@@ -5,6 +5,8 @@
 #ifndef SHELL_APPLICATION_MANAGER_FETCHER_H_
 #define SHELL_APPLICATION_MANAGER_FETCHER_H_
 
+#include <string>
+
 #include "base/callback.h"
 #include "base/memory/scoped_ptr.h"
 
@@ -35,6 +37,10 @@ class Fetcher {
   // - network error
   // - 4x or 5x HTTP errors
   typedef base::Callback<void(scoped_ptr<Fetcher>)> FetchCallback;
+  typedef base::Callback<void(const std::string&)> PeekShebangCallback;
+  typedef base::Callback<void(const std::string& mojo_shebang,
+                              const GURL& mojo_content_handler_url)>
+      PeekContentHandlerCallback;
 
   Fetcher(const FetchCallback& fetch_callback);
   virtual ~Fetcher();
@@ -55,18 +61,30 @@ class Fetcher {
 
   virtual std::string MimeType() = 0;
 
-  virtual bool HasMojoMagic() = 0;
-
-  virtual bool PeekFirstLine(std::string* line) = 0;
-
-  bool PeekContentHandler(std::string* mojo_shebang,
-                          GURL* mojo_content_handler_url);
+  // Asynchronously calls |callback| with the first line of the content
+  // (including its newline) if the content begins with |kMojoMagic| and the
+  // line is at most |kMaxShebangLength| bytes long, or with an empty string
+  // otherwise. This doesn't block a thread while waiting for the content, but
+  // |task_runner| may be used for blocking IO.
+  virtual void PeekShebang(base::TaskRunner* task_runner,
+                           const PeekShebangCallback& callback) = 0;
+
+  // Asynchronously checks whether the content begins with a line of the form
+  // "#!mojo <content-handler-url>". |callback| is called with that line and
+  // the URL if so, or with an empty string and an invalid URL otherwise. The
+  // fetcher must be kept alive until then.
+  void PeekContentHandler(base::TaskRunner* task_runner,
+                          const PeekContentHandlerCallback& callback);
 
  protected:
   static const char kMojoMagic[];
   static const size_t kMaxShebangLength;
 
   FetchCallback loader_callback_;
+
+ private:
+  static void DidPeekShebang(const PeekContentHandlerCallback& callback,
+                             const std::string& shebang);
 };
 
 }  // namespace shell
@@ -11,6 +11,7 @@
 #include "base/message_loop/message_loop.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/task_runner_util.h"
 #include "base/trace_event/trace_event.h"
 #include "mojo/common/common_type_converters.h"
 #include "mojo/common/data_pipe_utils.h"
@@ -24,6 +25,22 @@ namespace {
 void IgnoreResult(bool result) {
 }
 
+// Returns the first line of the file at |path| (including its newline) if it
+// begins with |magic| and is at most |max_length| bytes long, or an empty
+// string otherwise.
+std::string ReadShebang(const base::FilePath& path,
+                        const std::string& magic,
+                        size_t max_length) {
+  std::string start_of_file;
+  ReadFileToString(path, &start_of_file, max_length);
+  size_t return_position = start_of_file.find('\n');
+  if (return_position == std::string::npos ||
+      start_of_file.compare(0, magic.size(), magic) != 0) {
+    return std::string();
+  }
+  return start_of_file.substr(0, return_position + 1);
+}
+
 }  // namespace
 
 // A loader for local files.
@@ -89,20 +106,13 @@ std::string LocalFetcher::MimeType() {
   return "";
 }
 
-bool LocalFetcher::HasMojoMagic() {
-  std::string magic;
-  ReadFileToString(path_, &magic, strlen(kMojoMagic));
-  return magic == kMojoMagic;
-}
-
-bool LocalFetcher::PeekFirstLine(std::string* line) {
-  std::string start_of_file;
-  ReadFileToString(path_, &start_of_file, kMaxShebangLength);
-  size_t return_position = start_of_file.find('\n');
-  if (return_position == std::string::npos)
-    return false;
-  *line = start_of_file.substr(0, return_position + 1);
-  return true;
+void LocalFetcher::PeekShebang(base::TaskRunner* task_runner,
+                               const PeekShebangCallback& callback) {
+  base::PostTaskAndReplyWithResult(
+      task_runner, FROM_HERE,
+      base::Bind(&ReadShebang, path_, std::string(kMojoMagic),
+                 kMaxShebangLength),
+      callback);
 }
 
 }  // namespace shell
@@ -19,9 +19,11 @@ class LocalFetcher : public Fetcher {
                const GURL& url_without_query,
                const FetchCallback& loader_callback);
 
- private:
+  // Returns the path of the file at |url| (which must be a file: URL without a
+  // query).
   static base::FilePath UrlToFile(const GURL& url);
 
+ private:
   const GURL& GetURL() const override;
   GURL GetRedirectURL() const override;
 
@@ -34,9 +36,8 @@ class LocalFetcher : public Fetcher {
 
   std::string MimeType() override;
 
-  bool HasMojoMagic() override;
-
-  bool PeekFirstLine(std::string* line) override;
+  void PeekShebang(base::TaskRunner* task_runner,
+                   const PeekShebangCallback& callback) override;
 
   GURL url_;
   base::FilePath path_;
@@ -20,7 +20,6 @@
 #include "crypto/sha2.h"
 #include "mojo/common/common_type_converters.h"
 #include "mojo/common/data_pipe_utils.h"
-#include "shell/application_manager/data_pipe_peek.h"
 
 namespace shell {
 
@@ -104,6 +103,8 @@ void NetworkFetcher::OnFileRetrievedFromCache(
     base::Callback<void(const base::FilePath&, bool)> callback,
     mojo::Array<uint8_t> path_as_array,
     mojo::Array<uint8_t> cache_dir) {
+  TRACE_EVENT_ASYNC_END0("mojo_shell", "NetworkFetcher::GetFileFromCache",
+                         this);
   bool success = !path_as_array.is_null();
   if (success) {
     path_ = base::FilePath(std::string(
@@ -121,6 +122,8 @@ void NetworkFetcher::AsPath(
   // This should only called once, when we have a response.
   DCHECK(response_.get());
 
+  TRACE_EVENT_ASYNC_BEGIN1("mojo_shell", "NetworkFetcher::GetFileFromCache",
+                           this, "url", url_.spec());
   url_response_disk_cache_->GetFile(
       response_.Pass(), base::Bind(&NetworkFetcher::OnFileRetrievedFromCache,
                                    weak_ptr_factory_.GetWeakPtr(), callback));
@@ -130,16 +133,31 @@ std::string NetworkFetcher::MimeType() {
   return response_->mime_type;
 }
 
-bool NetworkFetcher::HasMojoMagic() {
-  std::string magic;
-  return BlockingPeekNBytes(response_->body.get(), &magic, strlen(kMojoMagic),
-                            kPeekTimeout) &&
-         magic == kMojoMagic;
+void NetworkFetcher::PeekShebang(base::TaskRunner* task_runner,
+                                 const PeekShebangCallback& callback) {
+  // Look at the magic first, so that we don't wait for a newline that a
+  // (binary) response that doesn't begin with it may not have.
+  peek_.PeekNBytes(response_->body.get(), strlen(kMojoMagic),
+                   base::Bind(&NetworkFetcher::OnPeekMojoMagic,
+                              base::Unretained(this), callback));
 }
 
-bool NetworkFetcher::PeekFirstLine(std::string* line) {
-  return BlockingPeekLine(response_->body.get(), line, kMaxShebangLength,
-                          kPeekTimeout);
+void NetworkFetcher::OnPeekMojoMagic(const PeekShebangCallback& callback,
+                                     bool success,
+                                     const std::string& magic) {
+  if (!success || magic != kMojoMagic) {
+    callback.Run(std::string());
+    return;
+  }
+  peek_.PeekLine(response_->body.get(), kMaxShebangLength,
+                 base::Bind(&NetworkFetcher::OnPeekFirstLine, callback));
+}
+
+// static
+void NetworkFetcher::OnPeekFirstLine(const PeekShebangCallback& callback,
+                                     bool success,
+                                     const std::string& line) {
+  callback.Run(success ? line : std::string());
 }
 
 void NetworkFetcher::StartNetworkRequest(RequestType request_type) {
@@ -12,6 +12,7 @@
 #include "mojo/services/network/public/interfaces/network_service.mojom.h"
 #include "mojo/services/network/public/interfaces/url_loader.mojom.h"
 #include "mojo/services/url_response_disk_cache/public/interfaces/url_response_disk_cache.mojom.h"
+#include "shell/application_manager/data_pipe_peek.h"
 #include "url/gurl.h"
 
 namespace shell {
@@ -28,9 +29,6 @@ class NetworkFetcher : public Fetcher {
   ~NetworkFetcher() override;
 
  private:
-  // TODO(hansmuller): Revisit this when a real peek operation is available.
-  static const MojoDeadline kPeekTimeout = MOJO_DEADLINE_INDEFINITE;
-
   // The network fetcher will first try to request an application from the
   // network. If that request fails, it will then try to request the application
   // from the cache.
@@ -59,9 +57,15 @@ class NetworkFetcher : public Fetcher {
 
   std::string MimeType() override;
 
-  bool HasMojoMagic() override;
+  void PeekShebang(base::TaskRunner* task_runner,
+                   const PeekShebangCallback& callback) override;
 
-  bool PeekFirstLine(std::string* line) override;
+  void OnPeekMojoMagic(const PeekShebangCallback& callback,
+                       bool success,
+                       const std::string& magic);
+  static void OnPeekFirstLine(const PeekShebangCallback& callback,
+                              bool success,
+                              const std::string& line);
 
   void StartNetworkRequest(RequestType request_type);
 
@@ -74,6 +78,7 @@ class NetworkFetcher : public Fetcher {
   mojo::URLLoaderPtr url_loader_;
   mojo::URLResponsePtr response_;
   base::FilePath path_;
+  DataPipePeek peek_;
   base::WeakPtrFactory<NetworkFetcher> weak_ptr_factory_;
 
   DISALLOW_COPY_AND_ASSIGN(NetworkFetcher);
@@ -4,6 +4,7 @@
 
 #include "shell/application_manager/shell_impl.h"
 
+#include "base/trace_event/trace_event.h"
 #include "mojo/common/common_type_converters.h"
 #include "mojo/services/content_handler/public/interfaces/content_handler.mojom.h"
 #include "shell/application_manager/application_manager.h"
@@ -20,8 +21,10 @@ ShellImpl::ShellImpl(mojo::ApplicationPtr application,
     : manager_(manager),
       identity_(identity),
       on_application_end_(on_application_end),
+      start_time_(base::TimeTicks::Now()),
       application_(application.Pass()),
-      binding_(this) {
+      binding_(this),
+      received_message_(false) {
   binding_.set_connection_error_handler(
       [this]() { manager_->OnShellImplError(this); });
 }
@@ -32,6 +35,10 @@ ShellImpl::~ShellImpl() {
 void ShellImpl::InitializeApplication(mojo::Array<mojo::String> args) {
   mojo::ShellPtr shell;
   binding_.Bind(mojo::GetProxy(&shell));
+  // Ends when the application first calls us, which shows how long it took to
+  // get started (for applications that connect to others at startup).
+  TRACE_EVENT_ASYNC_BEGIN1("mojo_shell", "ShellImpl::WaitForFirstMessage",
+                           this, "url", identity_.url.spec());
   application_->Initialize(shell.Pass(), args.Pass(), identity_.url.spec());
 }
 
@@ -50,6 +57,12 @@ void ShellImpl::ConnectToApplication(
     const mojo::String& app_url,
     mojo::InterfaceRequest<ServiceProvider> services,
     ServiceProviderPtr exposed_services) {
+  if (!received_message_) {
+    received_message_ = true;
+    TRACE_EVENT_ASYNC_END0("mojo_shell", "ShellImpl::WaitForFirstMessage",
+                           this);
+  }
+
   GURL app_gurl(app_url);
   if (!app_gurl.is_valid()) {
     LOG(ERROR) << "Error: invalid URL: " << app_url;
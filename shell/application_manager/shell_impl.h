@@ -6,6 +6,7 @@
 #define SHELL_APPLICATION_MANAGER_SHELL_IMPL_H_
 
 #include "base/callback.h"
+#include "base/time/time.h"
 #include "mojo/public/cpp/bindings/binding.h"
 #include "mojo/public/interfaces/application/application.mojom.h"
 #include "mojo/public/interfaces/application/shell.mojom.h"
@@ -35,6 +36,8 @@ class ShellImpl : public mojo::Shell {
   mojo::Application* application() { return application_.get(); }
   const Identity& identity() const { return identity_; }
   base::Closure on_application_end() const { return on_application_end_; }
+  // When the application was started (i.e., when this was created).
+  base::TimeTicks start_time() const { return start_time_; }
 
  private:
   // mojo::Shell implementation:
@@ -46,8 +49,12 @@ class ShellImpl : public mojo::Shell {
   ApplicationManager* const manager_;
   const Identity identity_;
   base::Closure on_application_end_;
+  const base::TimeTicks start_time_;
   mojo::ApplicationPtr application_;
   mojo::Binding<mojo::Shell> binding_;
+  // Whether the application has sent us a message yet (this is only used for
+  // tracing).
+  bool received_message_;
 
   DISALLOW_COPY_AND_ASSIGN(ShellImpl);
 };
@@ -16,6 +16,7 @@
 #include "base/process/launch.h"
 #include "base/task_runner.h"
 #include "base/task_runner_util.h"
+#include "base/trace_event/trace_event.h"
 #include "mojo/edk/embedder/embedder.h"
 #include "mojo/edk/embedder/platform_channel_pair.h"
 #include "mojo/public/cpp/system/message_pipe.h"
@@ -44,6 +45,9 @@ ChildProcessHost::~ChildProcessHost() {
 
 void ChildProcessHost::Start() {
   DCHECK(!child_process_.IsValid());
+  // Ends when the child has connected to us (which is after it's been spawned
+  // and has initialized the EDK).
+  TRACE_EVENT_ASYNC_BEGIN0("mojo_shell", "ChildProcessHost::Launch", this);
 
   scoped_ptr<LaunchData> launch_data(new LaunchData());
   launch_data->child_path = context_->mojo_shell_child_path();
@@ -112,9 +116,11 @@ void ChildProcessHost::DidStart(base::Process child_process) {
 // Callback for |mojo::embedder::ConnectToSlave()|.
 void ChildProcessHost::DidConnectToSlave() {
   DVLOG(2) << "ChildProcessHost::DidConnectToSlave()";
+  TRACE_EVENT_ASYNC_END0("mojo_shell", "ChildProcessHost::Launch", this);
 }
 
 base::Process ChildProcessHost::DoLaunch(scoped_ptr<LaunchData> launch_data) {
+  TRACE_EVENT0("mojo_shell", "ChildProcessHost::DoLaunch");
   static const char* kForwardSwitches[] = {
       switches::kTraceToConsole, switches::kV, switches::kVModule,
   };
@@ -59,6 +59,10 @@ class ChildProcessHost {
                 const ChildController::StartAppCallback& on_app_complete);
   void ExitNow(int32_t exit_code);
 
+  // Returns true if the connection to the child has been found to be broken
+  // (e.g., because the child exited). May be called after |Start()|.
+  bool encountered_error() const { return controller_.encountered_error(); }
+
   // TODO(vtl): This is virtual, so tests can override it, but really |Start()|
   // should take a callback (see above) and this should be private.
   virtual void DidStart(base::Process child_process);
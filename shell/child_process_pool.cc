@@ -0,0 +1,163 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shell/child_process_pool.h"
+
+#include <algorithm>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/process/process.h"
+#include "base/run_loop.h"
+#include "base/trace_event/trace_event.h"
+#include "shell/child_process_host.h"
+
+namespace shell {
+
+// A |ChildProcessHost| that tells the pool when it has been started.
+class ChildProcessPool::PooledChildProcessHost : public ChildProcessHost {
+ public:
+  PooledChildProcessHost(Context* context, ChildProcessPool* pool)
+      : ChildProcessHost(context), pool_(pool), did_start_(false) {}
+  ~PooledChildProcessHost() override {}
+
+  bool did_start() const { return did_start_; }
+
+  // |ChildProcessHost| method:
+  void DidStart(base::Process child_process) override {
+    bool success = child_process.IsValid();
+    ChildProcessHost::DidStart(child_process.Pass());
+    did_start_ = true;
+    // Note: This may delete us.
+    pool_->DidStartChild(this, success);
+  }
+
+ private:
+  ChildProcessPool* const pool_;
+  bool did_start_;
+
+  DISALLOW_COPY_AND_ASSIGN(PooledChildProcessHost);
+};
+
+ChildProcessPool::ChildProcessPool(Context* context, size_t size)
+    : context_(context),
+      size_(size),
+      num_launching_(0),
+      num_hits_(0),
+      num_misses_(0),
+      is_shutting_down_(false),
+      weak_factory_(this) {
+}
+
+ChildProcessPool::~ChildProcessPool() {
+  DCHECK(children_.empty());
+  DCHECK_EQ(num_launching_, 0u);
+}
+
+void ChildProcessPool::Fill() {
+  if (is_shutting_down_)
+    return;
+
+  while (children_.size() < size_) {
+    TRACE_EVENT0("mojo_shell", "ChildProcessPool::Fill");
+    PooledChildProcessHost* child = new PooledChildProcessHost(context_, this);
+    children_.push_back(child);
+    num_launching_++;
+    child->Start();
+  }
+}
+
+scoped_ptr<ChildProcessHost> ChildProcessPool::TakeChildProcessHost() {
+  scoped_ptr<ChildProcessHost> rv;
+  bool removed_any = false;
+  for (auto it = children_.begin(); it != children_.end();) {
+    PooledChildProcessHost* child = *it;
+    if (!child->did_start()) {
+      ++it;
+      continue;
+    }
+    removed_any = true;
+    it = children_.weak_erase(it);
+    // An idle child whose connection failed has exited (or is exiting).
+    if (child->encountered_error()) {
+      LOG(WARNING) << "Idle child process lost its connection";
+      child->Join();
+      delete child;
+      continue;
+    }
+    rv.reset(child);
+    break;
+  }
+
+  if (rv)
+    num_hits_++;
+  else
+    num_misses_++;
+  TRACE_EVENT_INSTANT1("mojo_shell", "ChildProcessPool::TakeChildProcessHost",
+                       TRACE_EVENT_SCOPE_THREAD, "hit", !!rv);
+
+  // Refill in the background (so that launching doesn't delay starting the
+  // app in the child we're returning).
+  if (removed_any) {
+    base::MessageLoop::current()->task_runner()->PostTask(
+        FROM_HERE,
+        base::Bind(&ChildProcessPool::Fill, weak_factory_.GetWeakPtr()));
+  }
+  return rv.Pass();
+}
+
+void ChildProcessPool::Shutdown() {
+  TRACE_EVENT0("mojo_shell", "ChildProcessPool::Shutdown");
+  is_shutting_down_ = true;
+  weak_factory_.InvalidateWeakPtrs();
+
+  // Children being launched can't be joined until they've been started. (Note
+  // that this runs the message loop, but we no longer launch children.)
+  if (num_launching_ > 0) {
+    base::RunLoop run_loop;
+    did_start_all_closure_ = run_loop.QuitClosure();
+    run_loop.Run();
+    did_start_all_closure_.Reset();
+  }
+  DCHECK_EQ(num_launching_, 0u);
+
+  for (PooledChildProcessHost* child : children_)
+    ExitAndJoin(child);
+  children_.clear();
+}
+
+size_t ChildProcessPool::GetNumIdleChildren() const {
+  return static_cast<size_t>(std::count_if(
+      children_.begin(), children_.end(),
+      [](const PooledChildProcessHost* child) { return child->did_start(); }));
+}
+
+void ChildProcessPool::DidStartChild(PooledChildProcessHost* child,
+                                     bool success) {
+  DCHECK_GT(num_launching_, 0u);
+  num_launching_--;
+
+  if (!success) {
+    // Don't try again (until the next child is taken): launching will probably
+    // keep failing.
+    auto it = std::find(children_.begin(), children_.end(), child);
+    DCHECK(it != children_.end());
+    children_.erase(it);
+  }
+
+  if (num_launching_ == 0 && !did_start_all_closure_.is_null())
+    did_start_all_closure_.Run();
+}
+
+// static
+void ChildProcessPool::ExitAndJoin(ChildProcessHost* child) {
+  if (!child->encountered_error())
+    child->ExitNow(0);
+  int exit_code = child->Join();
+  DVLOG(2) << "Joined idle child: exit_code = " << exit_code;
+}
+
+}  // namespace shell
@@ -0,0 +1,87 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef SHELL_CHILD_PROCESS_POOL_H_
+#define SHELL_CHILD_PROCESS_POOL_H_
+
+#include <stddef.h>
+
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/memory/scoped_vector.h"
+#include "base/memory/weak_ptr.h"
+
+namespace shell {
+
+class ChildProcessHost;
+class Context;
+
+// A pool of idle child processes, launched ahead of time so that an app can be
+// started out of process (see |OutOfProcessNativeRunner|) without waiting for a
+// child process to be launched and to connect to us. Whenever an idle child is
+// taken from the pool, a replacement is launched in the background.
+//
+// This class is not thread-safe. It should be created/used/destroyed on a
+// single thread (the one on which |ChildProcessHost|s are used).
+class ChildProcessPool {
+ public:
+  // Keeps up to |size| idle children (once |Fill()| has been called).
+  ChildProcessPool(Context* context, size_t size);
+  ~ChildProcessPool();
+
+  // Launches children until there are |size| of them (idle or being launched).
+  void Fill();
+
+  // Returns an idle child that has been started (see |ChildProcessHost|), on
+  // which |StartApp()| may be called, or null if there is none (in which case
+  // the caller should start a child of its own).
+  scoped_ptr<ChildProcessHost> TakeChildProcessHost();
+
+  // Makes all the children exit and waits for them (first waiting for the ones
+  // being launched to be started). No more children are launched afterwards.
+  // This must be called before destruction, while IPC support is still up.
+  void Shutdown();
+
+  // Returns the number of idle children that have been started.
+  size_t GetNumIdleChildren() const;
+
+  // The number of calls to |TakeChildProcessHost()| that returned a child and
+  // that returned null, respectively.
+  size_t num_hits() const { return num_hits_; }
+  size_t num_misses() const { return num_misses_; }
+
+ private:
+  class PooledChildProcessHost;
+
+  // Called (by |child|) when |child| has been started or failed to start.
+  void DidStartChild(PooledChildProcessHost* child, bool success);
+
+  // Makes |child| (which must have been started) exit, if it's still
+  // connected, and waits for it.
+  static void ExitAndJoin(ChildProcessHost* child);
+
+  Context* const context_;
+  const size_t size_;
+
+  // Idle children and children being launched, in the order that they were
+  // launched.
+  ScopedVector<PooledChildProcessHost> children_;
+  size_t num_launching_;
+
+  size_t num_hits_;
+  size_t num_misses_;
+
+  bool is_shutting_down_;
+  // Set during |Shutdown()| while waiting for children to be started.
+  base::Closure did_start_all_closure_;
+
+  base::WeakPtrFactory<ChildProcessPool> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChildProcessPool);
+};
+
+}  // namespace shell
+
+#endif  // SHELL_CHILD_PROCESS_POOL_H_
@@ -0,0 +1,93 @@
+// Copyright 2015 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "shell/child_process_pool.h"
+
+#include "base/logging.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/threading/platform_thread.h"
+#include "base/time/time.h"
+#include "build/build_config.h"
+#include "mojo/common/message_pump_mojo.h"
+#include "shell/child_process_host.h"
+#include "shell/context.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace shell {
+namespace {
+
+// Runs the message loop until |pool| has |num_idle_children| started idle
+// children.
+void WaitForIdleChildren(ChildProcessPool* pool, size_t num_idle_children) {
+  while (pool->GetNumIdleChildren() < num_idle_children) {
+    base::RunLoop().RunUntilIdle();
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(10));
+  }
+}
+
+#if defined(OS_ANDROID)
+// TODO(qsr): Multiprocess shell tests are not supported on android.
+#define MAYBE_TakeAndRefill DISABLED_TakeAndRefill
+#else
+#define MAYBE_TakeAndRefill TakeAndRefill
+#endif  // defined(OS_ANDROID)
+// Tests taking idle children from the pool, and that the pool gets refilled.
+TEST(ChildProcessPoolTest, MAYBE_TakeAndRefill) {
+  Context context;
+  base::MessageLoop message_loop(
+      scoped_ptr<base::MessagePump>(new mojo::common::MessagePumpMojo()));
+  context.Init();
+  ChildProcessPool pool(&context, 2);
+  pool.Fill();
+  WaitForIdleChildren(&pool, 2);
+
+  for (int i = 0; i < 3; i++) {
+    scoped_ptr<ChildProcessHost> child = pool.TakeChildProcessHost();
+    ASSERT_TRUE(child);
+    EXPECT_FALSE(child->encountered_error());
+    child->ExitNow(123 + i);
+    EXPECT_EQ(123 + i, child->Join());
+
+    // The pool should get refilled.
+    WaitForIdleChildren(&pool, 2);
+  }
+  EXPECT_EQ(3u, pool.num_hits());
+  EXPECT_EQ(0u, pool.num_misses());
+
+  pool.Shutdown();
+  EXPECT_EQ(0u, pool.GetNumIdleChildren());
+
+  context.Shutdown();
+}
+
+#if defined(OS_ANDROID)
+// TODO(qsr): Multiprocess shell tests are not supported on android.
+#define MAYBE_ShutdownWhileLaunching DISABLED_ShutdownWhileLaunching
+#else
+#define MAYBE_ShutdownWhileLaunching ShutdownWhileLaunching
+#endif  // defined(OS_ANDROID)
+// Tests that there are no idle children before they've been started, and that
+// shutting down waits for the children being launched.
+TEST(ChildProcessPoolTest, MAYBE_ShutdownWhileLaunching) {
+  Context context;
+  base::MessageLoop message_loop(
+      scoped_ptr<base::MessagePump>(new mojo::common::MessagePumpMojo()));
+  context.Init();
+  ChildProcessPool pool(&context, 3);
+  pool.Fill();
+
+  // Nothing has been started yet, since the message loop hasn't run.
+  EXPECT_FALSE(pool.TakeChildProcessHost());
+  EXPECT_EQ(0u, pool.num_hits());
+  EXPECT_EQ(1u, pool.num_misses());
+
+  pool.Shutdown();
+  EXPECT_EQ(0u, pool.GetNumIdleChildren());
+
+  context.Shutdown();
+}
+
+}  // namespace
+}  // namespace shell
@@ -17,6 +17,7 @@
 #include "base/memory/scoped_vector.h"
 #include "base/path_service.h"
 #include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
 #include "base/trace_event/trace_event.h"
@@ -32,6 +33,7 @@
 #include "shell/application_manager/application_loader.h"
 #include "shell/application_manager/application_manager.h"
 #include "shell/background_application_loader.h"
+#include "shell/child_process_pool.h"
 #include "shell/command_line_util.h"
 #include "shell/filename_util.h"
 #include "shell/in_process_native_runner.h"
@@ -47,6 +49,10 @@ using mojo::ServiceProviderPtr;
 namespace shell {
 namespace {
 
+// The default number of idle child processes to keep around when running apps
+// out of process (see |ChildProcessPool|).
+const size_t kDefaultChildProcessPoolSize = 1;
+
 // Used to ensure we only init once.
 class Setup {
  public:
@@ -63,8 +69,13 @@ class Setup {
 
 ApplicationManager::Options MakeApplicationManagerOptions() {
   ApplicationManager::Options options;
-  options.disable_cache = base::CommandLine::ForCurrentProcess()->HasSwitch(
-      switches::kDisableCache);
+  const base::CommandLine& command_line =
+      *base::CommandLine::ForCurrentProcess();
+  options.disable_cache = command_line.HasSwitch(switches::kDisableCache);
+  if (command_line.HasSwitch(switches::kEnablePrefetch)) {
+    options.dependency_profiles_directory =
+        base::GetHomeDir().Append(".mojo_shell_dependency_profiles");
+  }
   return options;
 }
 
@@ -287,16 +298,30 @@ bool Context::InitWithPaths(const base::FilePath& shell_child_path) {
     return false;
   if (!ConfigureURLMappings(command_line, this))
     return false;
+  size_t child_process_pool_size = kDefaultChildProcessPoolSize;
+  if (command_line.HasSwitch(switches::kChildProcessPoolSize) &&
+      !base::StringToSizeT(
+          command_line.GetSwitchValueASCII(switches::kChildProcessPoolSize),
+          &child_process_pool_size)) {
+    LOG(ERROR) << "Invalid value for --" << switches::kChildProcessPoolSize;
+    return false;
+  }
 
   mojo::embedder::InitIPCSupport(
       mojo::embedder::ProcessType::MASTER, task_runners_->shell_runner(), this,
       task_runners_->io_runner(), mojo::embedder::ScopedPlatformHandle());
 
   scoped_ptr<NativeRunnerFactory> runner_factory;
-  if (command_line.HasSwitch(switches::kEnableMultiprocess))
+  if (command_line.HasSwitch(switches::kEnableMultiprocess)) {
     runner_factory.reset(new OutOfProcessNativeRunnerFactory(this));
-  else
+    if (child_process_pool_size > 0) {
+      child_process_pool_.reset(
+          new ChildProcessPool(this, child_process_pool_size));
+      child_process_pool_->Fill();
+    }
+  } else {
     runner_factory.reset(new InProcessNativeRunnerFactory(this));
+  }
   application_manager_.set_blocking_pool(task_runners_->blocking_pool());
   application_manager_.set_native_runner_factory(runner_factory.Pass());
 
@@ -326,6 +351,10 @@ void Context::Shutdown() {
   TRACE_EVENT0("mojo_shell", "Context::Shutdown");
   DCHECK_EQ(base::MessageLoop::current()->task_runner(),
             task_runners_->shell_runner());
+  if (child_process_pool_) {
+    child_process_pool_->Shutdown();
+    child_process_pool_.reset();
+  }
   mojo::embedder::ShutdownIPCSupport();
   // We'll quit when we get OnShutdownComplete().
   base::MessageLoop::current()->Run();
@@ -14,6 +14,7 @@
 #include "shell/url_resolver.h"
 
 namespace shell {
+class ChildProcessPool;
 class Tracer;
 
 // The "global" context for the shell's main process.
@@ -65,6 +66,8 @@ class Context : public ApplicationManager::Delegate,
     return mojo_shell_child_path_;
   }
   TaskRunners* task_runners() { return task_runners_.get(); }
+  // Null unless running apps out of process (with a nonzero pool size).
+  ChildProcessPool* child_process_pool() { return child_process_pool_.get(); }
 
  private:
   class NativeViewportApplicationLoader;
@@ -85,6 +88,7 @@ class Context : public ApplicationManager::Delegate,
 
   base::FilePath mojo_shell_child_path_;
   scoped_ptr<TaskRunners> task_runners_;
+  scoped_ptr<ChildProcessPool> child_process_pool_;
 
   std::set<GURL> app_urls_;
   GURL shell_file_root_;
@@ -4,12 +4,47 @@
 
 #include "shell/application_manager/data_pipe_peek.h"
 
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/location.h"
+#include "base/message_loop/message_loop.h"
+#include "base/run_loop.h"
+#include "base/time/time.h"
 #include "shell/context.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace shell {
 namespace {
 
+void WriteString(mojo::DataPipeProducerHandle producer, const std::string& s) {
+  uint32_t num_bytes = static_cast<uint32_t>(s.size());
+  EXPECT_EQ(MOJO_RESULT_OK, WriteDataRaw(producer, s.data(), &num_bytes,
+                                         MOJO_WRITE_DATA_FLAG_ALL_OR_NONE));
+  EXPECT_EQ(s.size(), num_bytes);
+}
+
+void ClosePipe(mojo::ScopedDataPipeProducerHandle* producer) {
+  producer->reset();
+}
+
+void OnPeek(bool* success,
+            std::string* value,
+            const base::Closure& quit_closure,
+            bool peek_success,
+            const std::string& peek_value) {
+  *success = peek_success;
+  *value = peek_value;
+  quit_closure.Run();
+}
+
+// Runs |peek| (which must have been started) to completion.
+void RunPeek(DataPipePeek* peek, base::RunLoop* run_loop) {
+  // The callback must not be called synchronously.
+  EXPECT_TRUE(peek->is_peeking());
+  run_loop->Run();
+  EXPECT_FALSE(peek->is_peeking());
+}
+
 TEST(DataPipePeek, PeekNBytes) {
   Context::EnsureEmbedderIsInitialized();
 
@@ -107,5 +142,104 @@ TEST(DataPipePeek, PeekLine) {
   EXPECT_FALSE(BlockingPeekLine(consumer, &str, max_str_length, timeout));
 }
 
+TEST(DataPipePeek, AsyncPeekNBytes) {
+  Context::EnsureEmbedderIsInitialized();
+  base::MessageLoop message_loop;
+
+  mojo::DataPipe data_pipe;
+  mojo::DataPipeConsumerHandle consumer(data_pipe.consumer_handle.get());
+  mojo::DataPipeProducerHandle producer(data_pipe.producer_handle.get());
+  DataPipePeek peek;
+  bool success = false;
+  std::string bytes;
+
+  // Peeking for 4 bytes should wait until they have all been written.
+  {
+    base::RunLoop run_loop;
+    peek.PeekNBytes(consumer, 4, base::Bind(&OnPeek, &success, &bytes,
+                                            run_loop.QuitClosure()));
+    message_loop.PostTask(FROM_HERE, base::Bind(&WriteString, producer, "12"));
+    message_loop.PostDelayedTask(FROM_HERE,
+                                 base::Bind(&WriteString, producer, "34"),
+                                 base::TimeDelta::FromMilliseconds(50));
+    RunPeek(&peek, &run_loop);
+    EXPECT_TRUE(success);
+    EXPECT_EQ("1234", bytes);
+  }
+
+  // We're not consuming data, so peeking for 4 bytes again should succeed.
+  {
+    base::RunLoop run_loop;
+    peek.PeekNBytes(consumer, 4, base::Bind(&OnPeek, &success, &bytes,
+                                            run_loop.QuitClosure()));
+    RunPeek(&peek, &run_loop);
+    EXPECT_TRUE(success);
+    EXPECT_EQ("1234", bytes);
+  }
+
+  // Peeking for 5 bytes should fail once the producer is closed.
+  {
+    base::RunLoop run_loop;
+    peek.PeekNBytes(consumer, 5, base::Bind(&OnPeek, &success, &bytes,
+                                            run_loop.QuitClosure()));
+    message_loop.PostDelayedTask(
+        FROM_HERE, base::Bind(&ClosePipe, &data_pipe.producer_handle),
+        base::TimeDelta::FromMilliseconds(50));
+    RunPeek(&peek, &run_loop);
+    EXPECT_FALSE(success);
+    EXPECT_EQ(std::string(), bytes);
+  }
+}
+
+TEST(DataPipePeek, AsyncPeekLine) {
+  Context::EnsureEmbedderIsInitialized();
+  base::MessageLoop message_loop;
+
+  mojo::DataPipe data_pipe;
+  mojo::DataPipeConsumerHandle consumer(data_pipe.consumer_handle.get());
+  mojo::DataPipeProducerHandle producer(data_pipe.producer_handle.get());
+  DataPipePeek peek;
+  bool success = false;
+  std::string line;
+
+  // Peeking for a line should wait for the newline.
+  WriteString(producer, "1234");
+  {
+    base::RunLoop run_loop;
+    peek.PeekLine(consumer, 5, base::Bind(&OnPeek, &success, &line,
+                                          run_loop.QuitClosure()));
+    message_loop.PostDelayedTask(FROM_HERE,
+                                 base::Bind(&WriteString, producer, "\n"),
+                                 base::TimeDelta::FromMilliseconds(50));
+    RunPeek(&peek, &run_loop);
+    EXPECT_TRUE(success);
+    EXPECT_EQ("1234\n", line);
+  }
+
+  // If the max_line_length parameter is less than the length of the
+  // newline terminated string, then peek should fail.
+  {
+    base::RunLoop run_loop;
+    peek.PeekLine(consumer, 3, base::Bind(&OnPeek, &success, &line,
+                                          run_loop.QuitClosure()));
+    RunPeek(&peek, &run_loop);
+    EXPECT_FALSE(success);
+  }
+
+  // Destroying a peek in progress cancels it.
+  {
+    line = "not peeked";
+    mojo::DataPipe empty_data_pipe;
+    scoped_ptr<DataPipePeek> empty_peek(new DataPipePeek());
+    empty_peek->PeekLine(empty_data_pipe.consumer_handle.get(), 5,
+                         base::Bind(&OnPeek, &success, &line,
+                                    base::Bind(&base::DoNothing)));
+    empty_peek.reset();
+    WriteString(empty_data_pipe.producer_handle.get(), "1234\n");
+    base::RunLoop().RunUntilIdle();
+    EXPECT_EQ("not peeked", line);
+  }
+}
+
 }  // namespace
 }  // namespace shell
@@ -30,10 +30,12 @@ void Usage() {
   std::cerr
       << "Usage: mojo_shell"
       << " [--" << switches::kArgsFor << "=<mojo-app>]"
+      << " [--" << switches::kChildProcessPoolSize << "=<count>]"
       << " [--" << switches::kContentHandlers << "=<handlers>]"
       << " [--" << switches::kCPUProfile << "]"
       << " [--" << switches::kDisableCache << "]"
       << " [--" << switches::kEnableMultiprocess << "]"
+      << " [--" << switches::kEnablePrefetch << "]"
       << " [--" << switches::kOrigin << "=<url-lib-path>]"
       << " [--" << switches::kTraceStartup << "[=\"list,of,categories\"]]"
       << " [--" << switches::kTraceStartupDuration << "=<seconds>]"
@@ -7,6 +7,7 @@
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
 #include "base/logging.h"
+#include "base/trace_event/trace_event.h"
 #include "mojo/public/platform/native/gles2_impl_chromium_miscellaneous_thunks.h"
 #include "mojo/public/platform/native/gles2_impl_chromium_resize_thunks.h"
 #include "mojo/public/platform/native/gles2_impl_chromium_sub_image_thunks.h"
@@ -45,6 +46,8 @@ bool SetThunks(Thunks (*make_thunks)(),
 
 base::NativeLibrary LoadNativeApplication(const base::FilePath& app_path) {
   DVLOG(2) << "Loading Mojo app in process from library: " << app_path.value();
+  TRACE_EVENT1("mojo_shell", "LoadNativeApplication", "path",
+               app_path.AsUTF8Unsafe());
 
   base::NativeLibraryLoadError error;
   base::NativeLibrary app_library = base::LoadNativeLibrary(app_path, &error);
@@ -10,6 +10,8 @@
 #include "base/logging.h"
 #include "shell/child_controller.mojom.h"
 #include "shell/child_process_host.h"
+#include "shell/child_process_pool.h"
+#include "shell/context.h"
 #include "shell/in_process_native_runner.h"
 
 namespace shell {
@@ -36,8 +38,14 @@ void OutOfProcessNativeRunner::Start(
   DCHECK(app_completed_callback_.is_null());
   app_completed_callback_ = app_completed_callback;
 
-  child_process_host_.reset(new ChildProcessHost(context_));
-  child_process_host_->Start();
+  // Use an idle child from the pool if we can; otherwise launch a new one.
+  ChildProcessPool* child_process_pool = context_->child_process_pool();
+  if (child_process_pool)
+    child_process_host_ = child_process_pool->TakeChildProcessHost();
+  if (!child_process_host_) {
+    child_process_host_.reset(new ChildProcessHost(context_));
+    child_process_host_->Start();
+  }
 
   // TODO(vtl): |app_path.AsUTF8Unsafe()| is unsafe.
   child_process_host_->StartApp(
@@ -21,6 +21,11 @@ const char kV[] = "v";
 // --args-for='mojo:wget http://www.google.com'
 const char kArgsFor[] = "args-for";
 
+// In multiprocess mode, the number of idle child processes to launch ahead of
+// time, so that apps can be started without waiting for a child process to be
+// launched. 0 disables this.
+const char kChildProcessPoolSize[] = "child-process-pool-size";
+
 // Comma separated list like:
 // text/html,mojo:html_viewer,application/bravo,https://abarth.com/bravo
 const char kContentHandlers[] = "content-handlers";
@@ -33,6 +38,7 @@ const char kCPUProfile[] = "cpu-profile";
 // instructions.
 const char kDisableCache[] = "disable-cache";
 
+
 // If set apps downloaded are not deleted.
 const char kDontDeleteOnDownload[] = "dont-delete-on-download";
 
@@ -41,6 +47,11 @@ const char kDontDeleteOnDownload[] = "dont-delete-on-download";
 // change it to "single-process") when it works.
 const char kEnableMultiprocess[] = "enable-multiprocess";
 
+// Record which apps each app connects to as it starts (in
+// ~/.mojo_shell_dependency_profiles), and use those records to fetch the
+// dependencies of an app ahead of time when it's started again.
+const char kEnablePrefetch[] = "enable-prefetch";
+
 // In multiprocess mode, force these apps to be loaded in the main process.
 // Comma-separate list of URLs. Example:
 // --force-in-process=mojo:native_viewport_service,mojo:network_service
@@ -74,11 +85,13 @@ const char kURLMappings[] = "url-mappings";
 // Switches valid for the main process (i.e., that the user may pass in).
 const char* kSwitchArray[] = {kV,
                               kArgsFor,
+                              kChildProcessPoolSize,
                               kContentHandlers,
                               kCPUProfile,
                               kDisableCache,
                               kDontDeleteOnDownload,
                               kEnableMultiprocess,
+                              kEnablePrefetch,
                               kForceInProcess,
                               kHelp,
                               kMapOrigin,
@@ -14,11 +14,13 @@ namespace switches {
 // alongside the definition of their values in the .cc file and, as needed, in
 // desktop/main.cc's Usage() function.
 extern const char kArgsFor[];
+extern const char kChildProcessPoolSize[];
 extern const char kContentHandlers[];
 extern const char kCPUProfile[];
 extern const char kDisableCache[];
 extern const char kDontDeleteOnDownload[];
 extern const char kEnableMultiprocess[];
+extern const char kEnablePrefetch[];
 extern const char kForceInProcess[];
 extern const char kHelp[];
 extern const char kMapOrigin[];
@@ -13,6 +13,7 @@
 #include "base/threading/thread.h"
 #include "base/trace_event/trace_config.h"
 #include "base/trace_event/trace_event.h"
+#include "mojo/common/trace_records.h"
 
 namespace shell {
 
@@ -145,12 +146,15 @@ void Tracer::OnDataAvailable(const void* data, size_t num_bytes) {
 }
 
 void Tracer::OnDataComplete() {
-  if (!trace_service_data_.empty()) {
+  std::string json;
+  if (!mojo::common::AppendTraceStreamAsJSON(
+          trace_service_data_.data(), trace_service_data_.size(), &json)) {
+    LOG(WARNING) << "Invalid trace data from the tracing service";
+  }
+  trace_service_data_ = std::string();
+  if (!json.empty()) {
     WriteCommaIfNeeded();
-    const char* const chars = trace_service_data_.data();
-    size_t num_bytes = trace_service_data_.length();
-    PCHECK(fwrite(chars, 1, num_bytes, trace_file_) == num_bytes);
-    trace_service_data_ = std::string();
+    PCHECK(fwrite(json.data(), 1, json.size(), trace_file_) == json.size());
   }
   drainer_.reset();
   coordinator_.reset();